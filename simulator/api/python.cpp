@@ -0,0 +1,54 @@
+/*
+ * python.cpp - Python module of embedded performance simulation
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "simulation.h"
+
+namespace py = pybind11;
+
+// values of options are passed as on the command line, so numbers and booleans are converted to strings
+static Simulation::Options get_options( const py::dict& values)
+{
+    Simulation::Options options;
+    for ( const auto& item : values)
+    {
+        const auto value = py::isinstance<py::bool_>( item.second)
+                         ? std::string( item.second.cast<bool>() ? "true" : "false")
+                         : py::str( item.second).cast<std::string>();
+        options.emplace( py::str( item.first).cast<std::string>(), value);
+    }
+    return options;
+}
+
+PYBIND11_MODULE( mipt_mips, module)
+{
+    module.doc() = "Performance simulation of MIPS and RISC-V in-order pipeline";
+
+    py::class_<Simulation::Result>( module, "Result")
+        .def_readonly( "instrs", &Simulation::Result::executed_instrs)
+        .def_readonly( "cycles", &Simulation::Result::cycles)
+        .def_readonly( "counters", &Simulation::Result::counters)
+        .def_property_readonly( "ipc", &Simulation::Result::get_ipc);
+
+    // simulations do not hold GIL, so Python threads may run them in parallel
+    py::class_<Simulation>( module, "Simulation")
+        .def( py::init<std::string, std::string>(), py::arg( "binary"), py::arg( "isa") = "mips")
+        .def( "run", []( const Simulation& simulation, const py::dict& values, uint64 instrs) {
+                const auto options = get_options( values);
+                const py::gil_scoped_release release;
+                return simulation.run( options, instrs);
+            }, py::arg( "options") = py::dict(), py::arg( "instrs") = MAX_VAL64)
+        .def( "run_all", []( const Simulation& simulation, const std::vector<py::dict>& values, uint64 instrs, uint32 jobs) {
+                std::vector<Simulation::Options> points;
+                for ( const auto& value : values)
+                    points.push_back( get_options( value));
+                const py::gil_scoped_release release;
+                return simulation.run_all( points, instrs, jobs);
+            }, py::arg( "points"), py::arg( "instrs") = MAX_VAL64, py::arg( "jobs") = 1)
+        .def_property_readonly( "binary", &Simulation::get_binary)
+        .def_property_readonly( "isa", &Simulation::get_isa);
+}
@@ -0,0 +1,89 @@
+/*
+ * simulation.cpp - performance simulation embedded into other programs
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include <core/perf_sim.h>
+#include <infra/config/config.h>
+#include <infra/memory/memory.h>
+#include <mips/mips.h>
+#include <risc_v/risc_v.h>
+
+#include "simulation.h"
+
+template<typename ISA>
+static Simulation::Result run_simulation( const std::string& binary, uint64 instrs_to_run, const std::string& checkpoint)
+{
+    PerfSim<ISA> sim( false);
+    sim.set_statistics_output( false);
+    sim.set_checkpoints( checkpoint, "");
+    sim.run( binary, instrs_to_run);
+
+    Simulation::Result result;
+    result.executed_instrs = sim.get_executed_instrs();
+    result.cycles = ( sim.get_cycles() - 0_Cl).to_size_t();
+    result.counters = sim.get_stats().get_values();
+    return result;
+}
+
+Simulation::Simulation( std::string binary, std::string isa)
+    : binary( std::move( binary))
+    , isa( std::move( isa))
+{
+    if ( this->isa != "mips" && this->isa != "riscv32" && this->isa != "riscv64" && this->isa != "riscv128")
+    {
+        std::cerr << "ERROR. Invalid ISA " << this->isa << ", supported ISAs: mips, riscv32, riscv64, riscv128" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    // memories of the runs take the image cached while this one exists
+    image = std::make_unique<const FuncMemory>( this->binary);
+}
+
+Simulation::~Simulation() = default;
+
+Simulation::Result Simulation::run( const Options& options, uint64 instrs_to_run, const std::string& checkpoint) const
+{
+    config::LocalValues local( options);
+    if ( isa == "riscv32")
+        return run_simulation<RISCV32>( binary, instrs_to_run, checkpoint);
+    if ( isa == "riscv64")
+        return run_simulation<RISCV64>( binary, instrs_to_run, checkpoint);
+    if ( isa == "riscv128")
+        return run_simulation<RISCV128>( binary, instrs_to_run, checkpoint);
+    return run_simulation<MIPS>( binary, instrs_to_run, checkpoint);
+}
+
+std::vector<Simulation::Result> Simulation::run_all( const std::vector<Options>& points, uint64 instrs_to_run, uint32 jobs) const
+{
+    if ( jobs == 0)
+    {
+        std::cerr << "ERROR. Simulation needs at least one job" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    std::vector<Result> results( points.size());
+
+    // each thread takes the next point when it finishes the previous one
+    std::atomic<size_t> next_point{ 0};
+    auto worker = [&]() {
+        for ( size_t i = next_point++; i < points.size(); i = next_point++)
+            results[ i] = run( points[ i], instrs_to_run);
+    };
+
+    std::vector<std::thread> threads;
+    const auto threads_num = std::min<size_t>( jobs, points.size());
+    for ( size_t i = 0; i < threads_num; ++i)
+        threads.emplace_back( worker);
+
+    for ( auto& thread : threads)
+        thread.join();
+
+    return results;
+}
@@ -0,0 +1,65 @@
+/*
+ * simulation.h - performance simulation embedded into other programs
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <infra/types.h>
+
+class FuncMemory;
+
+/*
+ * Simulations of in-order pipeline run in the process of the caller,
+ * so short runs of optimizers do not spawn processes and parse command lines.
+ * ELF image of the binary is parsed once and kept by the object,
+ * each run copies its pages only on write. Options of a run override
+ * the defaults in the calling thread only, so runs may go in parallel.
+ * Invalid options and binaries terminate the process, as on the command line.
+ */
+class Simulation
+{
+public:
+    // values by names of options without the leading dashes, e.g. { "bp-mode", "gshare"}
+    using Options = std::map<std::string, std::string>;
+
+    struct Result
+    {
+        uint64 executed_instrs = 0;
+        uint64 cycles = 0;
+        std::map<std::string, uint64> counters; // performance counters by names, e.g. "fetch.icache.misses"
+
+        double get_ipc() const { return cycles == 0 ? 0 : static_cast<double>( executed_instrs) / static_cast<double>( cycles); }
+    };
+
+    // ISA is one of mips, riscv32, riscv64 and riscv128
+    explicit Simulation( std::string binary, std::string isa = "mips");
+    ~Simulation();
+
+    // the run starts from the checkpoint of the binary if it is given
+    Result run( const Options& options, uint64 instrs_to_run = MAX_VAL64, const std::string& checkpoint = "") const;
+
+    // runs are taken by threads of the pool, results go in the order of options
+    std::vector<Result> run_all( const std::vector<Options>& points, uint64 instrs_to_run = MAX_VAL64, uint32 jobs = 1) const;
+
+    const std::string& get_binary() const { return binary; }
+    const std::string& get_isa() const { return isa; }
+
+    Simulation( const Simulation&) = delete;
+    Simulation( Simulation&&) = delete;
+    Simulation& operator=( const Simulation&) = delete;
+    Simulation& operator=( Simulation&&) = delete;
+
+private:
+    const std::string binary;
+    const std::string isa;
+    std::unique_ptr<const FuncMemory> image;
+};
+
+#endif // SIMULATION_H
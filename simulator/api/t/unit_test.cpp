@@ -0,0 +1,63 @@
+// generic C
+#include <cstdlib>
+
+// Google Test library
+#include <gtest/gtest.h>
+
+// Module
+#include "../simulation.h"
+
+static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
+
+TEST( Simulation, Run)
+{
+    const Simulation simulation( valid_elf_file);
+    const auto result = simulation.run( { });
+    ASSERT_EQ( result.cycles, 21360u);
+    ASSERT_EQ( result.counters.at( "writeback.instrs"), result.executed_instrs);
+    ASSERT_GT( result.get_ipc(), 0);
+
+    // the image is shared by runs, and the first one does not change it
+    const auto wide = simulation.run( { { "width", "2"}, { "checker", "off"}});
+    ASSERT_EQ( wide.executed_instrs, result.executed_instrs);
+    ASSERT_LT( wide.cycles, result.cycles);
+    ASSERT_EQ( simulation.run( { }).cycles, result.cycles);
+
+    ASSERT_EQ( simulation.run( { }, 100).executed_instrs, 100u);
+}
+
+TEST( Simulation, Run_All)
+{
+    const Simulation simulation( valid_elf_file);
+    const std::vector<Simulation::Options> points = { { }, { { "width", "2"}}, { { "bp-mode", "static_always_taken"}}};
+    const auto parallel = simulation.run_all( points, MAX_VAL64, 2);
+    ASSERT_EQ( parallel.size(), points.size());
+    for ( size_t i = 0; i < points.size(); ++i)
+    {
+        const auto sequential = simulation.run( points[ i]);
+        ASSERT_EQ( parallel[ i].cycles, sequential.cycles);
+        ASSERT_EQ( parallel[ i].counters, sequential.counters);
+    }
+}
+
+TEST( Simulation, RISCV)
+{
+    const Simulation simulation( TEST_PATH "/riscv_fib.out", "riscv32");
+    ASSERT_EQ( simulation.get_isa(), "riscv32");
+    ASSERT_NE( simulation.run( { }).executed_instrs, 0u);
+}
+
+TEST( Simulation, Invalid)
+{
+    ASSERT_EXIT( Simulation( valid_elf_file, "arm"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    const Simulation simulation( valid_elf_file);
+    ASSERT_EXIT( simulation.run( { { "no-such-option", "1"}}), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( simulation.run_all( { }, MAX_VAL64, 0), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
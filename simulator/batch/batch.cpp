@@ -0,0 +1,87 @@
+/*
+ * batch.cpp - functional simulation of many independent programs in one process
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <func_sim/func_sim.h>
+#include <infra/string/csv.h>
+#include <mips/mips.h>
+
+#include "batch.h"
+
+Batch::Batch( std::vector<std::string> binaries) : binaries( std::move( binaries)), results( this->binaries.size()) { }
+
+Batch Batch::load( const std::string& filename)
+{
+    std::ifstream file( filename);
+    if ( !file.is_open())
+    {
+        std::cerr << "ERROR. Could not open batch file " << filename << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    std::vector<std::string> binaries;
+    for ( std::string line; std::getline( file, line);)
+        if ( !line.empty() && line.front() != '#')
+            binaries.emplace_back( std::move( line));
+
+    return Batch( std::move( binaries));
+}
+
+Batch::Result Batch::run_binary( const std::string& binary, uint64 instrs_to_run)
+{
+    FuncSim<MIPS> sim;
+    sim.run( binary, instrs_to_run);
+
+    return Result{ sim.get_executed_instrs(), sim.is_halted(), sim.get_rf().hash(), sim.get_memory().hash()};
+}
+
+void Batch::run( uint64 instrs_to_run, uint32 jobs)
+{
+    if ( jobs == 0)
+    {
+        std::cerr << "ERROR. Batch needs at least one job" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    results.assign( binaries.size(), Result());
+
+    // programs are short, so each thread takes the next one when it finishes the previous
+    std::atomic<size_t> next_binary{ 0};
+    auto worker = [&]() {
+        for ( size_t i = next_binary++; i < binaries.size(); i = next_binary++)
+            results[ i] = run_binary( binaries[ i], instrs_to_run);
+    };
+
+    std::vector<std::thread> threads;
+    const auto threads_num = std::min<size_t>( jobs, binaries.size());
+    for ( size_t i = 0; i < threads_num; ++i)
+        threads.emplace_back( worker);
+
+    for ( auto& thread : threads)
+        thread.join();
+}
+
+void Batch::dump_csv( std::ostream& out) const
+{
+    const auto flags = out.flags();
+    const auto fill = out.fill();
+    out << "binary,instrs,halted,rf_hash,memory_hash" << std::endl;
+    for ( size_t i = 0; i < binaries.size(); ++i)
+    {
+        const auto& result = results.at( i);
+        out << csv_field( binaries[ i]) << ',' << std::dec << result.executed_instrs << ',' << result.is_halted << ','
+            << std::hex << std::setfill( '0') << std::setw( 16) << result.rf_hash << ','
+            << std::setw( 16) << result.memory_hash << std::endl;
+    }
+    out.flags( flags);
+    out.fill( fill);
+}
@@ -0,0 +1,45 @@
+/*
+ * batch.h - functional simulation of many independent programs in one process
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <infra/types.h>
+
+// Runs functional simulations of small programs on a pool of threads,
+// so each program costs neither start of a process nor parsing of options
+class Batch
+{
+public:
+    explicit Batch( std::vector<std::string> binaries);
+
+    // Loads list of binaries, one file name per line, empty lines and lines starting with '#' are skipped
+    static Batch load( const std::string& filename);
+
+    void run( uint64 instrs_to_run, uint32 jobs);
+
+    // Final states of programs to compare them with reference runs, one line per binary
+    void dump_csv( std::ostream& out) const;
+
+private:
+    struct Result
+    {
+        uint64 executed_instrs = 0;
+        bool is_halted = false;
+        uint64 rf_hash = 0;
+        uint64 memory_hash = 0;
+    };
+
+    static Result run_binary( const std::string& binary, uint64 instrs_to_run);
+
+    const std::vector<std::string> binaries;
+    std::vector<Result> results;
+};
+
+#endif // BATCH_H
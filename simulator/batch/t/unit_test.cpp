@@ -0,0 +1,95 @@
+// generic C
+#include <cstdlib>
+
+// generic C++
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// Google Test library
+#include <gtest/gtest.h>
+
+// Module
+#include <func_sim/func_sim.h>
+#include <mips/mips.h>
+#include "../batch.h"
+
+static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
+static const std::string matmul = TEST_PATH "/bench/matmul.out";
+
+static std::string run_batch( uint64 instrs_to_run, uint32 jobs)
+{
+    std::ofstream( "./batch.txt") << "# programs\n" << valid_elf_file << "\n\n" << matmul << '\n' << valid_elf_file << '\n';
+    auto batch = Batch::load( "./batch.txt");
+    batch.run( instrs_to_run, jobs);
+
+    std::ostringstream oss;
+    batch.dump_csv( oss);
+    return oss.str();
+}
+
+TEST( Batch, Results_Of_Programs)
+{
+    FuncSim<MIPS> sim;
+    sim.run_no_limit( valid_elf_file);
+
+    std::istringstream iss( run_batch( MAX_VAL64, 1));
+    std::string line;
+    std::getline( iss, line);
+    ASSERT_EQ( line, "binary,instrs,halted,rf_hash,memory_hash");
+
+    std::ostringstream expected;
+    expected << valid_elf_file << ',' << sim.get_executed_instrs() << ",1,"
+             << std::hex << std::setfill( '0') << std::setw( 16) << sim.get_rf().hash() << ','
+             << std::setw( 16) << sim.get_memory().hash();
+    std::getline( iss, line);
+    ASSERT_EQ( line, expected.str());
+
+    std::getline( iss, line);
+    ASSERT_EQ( line.substr( 0, matmul.size() + 1), matmul + ',');
+    std::getline( iss, line);
+    ASSERT_EQ( line, expected.str());
+    ASSERT_FALSE( std::getline( iss, line));
+}
+
+TEST( Batch, Quoted_Binary)
+{
+    Batch batch( { "./with,comma.out"});
+
+    std::ostringstream oss;
+    batch.dump_csv( oss);
+    std::istringstream iss( oss.str());
+    std::string line;
+    std::getline( iss, line);
+    std::getline( iss, line);
+    ASSERT_EQ( line.substr( 0, 19), "\"./with,comma.out\",");
+}
+
+TEST( Batch, Instruction_Limit)
+{
+    std::istringstream iss( run_batch( 100, 1));
+    std::string line;
+    std::getline( iss, line);
+    std::getline( iss, line);
+    ASSERT_EQ( line.substr( 0, valid_elf_file.size() + 6), valid_elf_file + ",100,0");
+}
+
+TEST( Batch, Parallel_Run_Is_Same_As_Serial)
+{
+    ASSERT_EQ( run_batch( MAX_VAL64, 1), run_batch( MAX_VAL64, 3));
+}
+
+TEST( Batch, Wrong_Batch_File)
+{
+    ASSERT_EXIT( Batch::load( "./1234567890/qwertyuiop"),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( Batch( { valid_elf_file}).run( MAX_VAL64, 0),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
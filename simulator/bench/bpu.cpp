@@ -0,0 +1,51 @@
+/*
+ * bpu.cpp - benchmarks of branch predictors
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <bpu/bpu.h>
+
+#include <random>
+#include <vector>
+
+// branches of loops and biased conditions over hundred PCs
+static std::vector<BPInterface> get_branches()
+{
+    std::mt19937 generator( 42);
+    std::uniform_int_distribution<Addr> pc( 0, 127);
+    std::bernoulli_distribution is_biased_taken( 0.9);
+    std::vector<BPInterface> branches( 4096);
+    for ( size_t i = 0; i < branches.size(); ++i)
+    {
+        const Addr PC = 0x400000 + pc( generator) * 4;
+        const bool is_loop = PC % 8 == 0;
+        const bool is_taken = is_loop ? i % 8 != 0 : is_biased_taken( generator);
+        branches[ i] = BPInterface( PC, is_taken, is_taken ? PC - 0x40 : PC + 4);
+    }
+    return branches;
+}
+
+static void BP_Predict_Update( benchmark::State& state, const std::string& mode)
+{
+    const auto bp = BPFactory().create( mode, 128, 16);
+    const auto branches = get_branches();
+
+    size_t i = 0;
+    for ( auto _ : state)
+    {
+        const auto& branch = branches[ i];
+        benchmark::DoNotOptimize( bp->is_taken( branch.pc));
+        bp->update( branch);
+        i = ( i + 1) % branches.size();
+    }
+}
+BENCHMARK_CAPTURE( BP_Predict_Update, static_always_taken, "static_always_taken");
+BENCHMARK_CAPTURE( BP_Predict_Update, static_backward_jumps, "static_backward_jumps");
+BENCHMARK_CAPTURE( BP_Predict_Update, dynamic_one_bit, "dynamic_one_bit");
+BENCHMARK_CAPTURE( BP_Predict_Update, dynamic_two_bit, "dynamic_two_bit");
+BENCHMARK_CAPTURE( BP_Predict_Update, adaptive_two_level, "adaptive_two_level");
+BENCHMARK_CAPTURE( BP_Predict_Update, gshare, "gshare");
+BENCHMARK_CAPTURE( BP_Predict_Update, hashed_perceptron, "hashed_perceptron");
+BENCHMARK_CAPTURE( BP_Predict_Update, tage, "tage");
@@ -0,0 +1,96 @@
+/*
+ * cache.cpp - benchmarks of LRU cache and cache tag array
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <infra/cache/cache_tag_array.h>
+#include <infra/instrcache/LRUCache.h>
+
+#include <random>
+#include <vector>
+
+// the cache keeps one value per key
+struct Entry
+{
+    Addr value = 0;
+    explicit Entry( Addr value) : value( value) { }
+    bool is_same( const Entry& rhs) const { return value == rhs.value; }
+};
+
+// addresses with locality: mostly hits of a small working set and some misses
+static std::vector<Addr> get_addresses( Addr working_set)
+{
+    std::mt19937 generator( 42);
+    std::geometric_distribution<Addr> distance( 0.01);
+    std::vector<Addr> addresses( 4096);
+    for ( auto& addr : addresses)
+        addr = ( distance( generator) % working_set) * 4;
+    return addresses;
+}
+
+static void LRUCache_Find( benchmark::State& state)
+{
+    LRUCache<Addr, Entry> cache( 8192);
+    const auto addresses = get_addresses( 16384);
+    for ( const auto addr : addresses)
+        cache.update( addr, Entry( addr));
+
+    size_t i = 0;
+    for ( auto _ : state)
+    {
+        benchmark::DoNotOptimize( cache.find( addresses[ i]).first);
+        i = ( i + 1) % addresses.size();
+    }
+}
+BENCHMARK( LRUCache_Find);
+
+static void LRUCache_Update( benchmark::State& state)
+{
+    LRUCache<Addr, Entry> cache( 8192);
+    const auto addresses = get_addresses( 16384);
+
+    size_t i = 0;
+    for ( auto _ : state)
+    {
+        cache.update( addresses[ i], Entry( addresses[ i]));
+        i = ( i + 1) % addresses.size();
+    }
+    benchmark::DoNotOptimize( cache.size());
+}
+BENCHMARK( LRUCache_Update);
+
+static void CacheTagArray_Read( benchmark::State& state, const std::string& replacement)
+{
+    CacheTagArray tags( 2048, 4, 64, 32, replacement);
+    const auto addresses = get_addresses( 4096);
+
+    size_t i = 0;
+    for ( auto _ : state)
+    {
+        benchmark::DoNotOptimize( tags.read( addresses[ i]));
+        i = ( i + 1) % addresses.size();
+    }
+}
+BENCHMARK_CAPTURE( CacheTagArray_Read, lru, "lru");
+BENCHMARK_CAPTURE( CacheTagArray_Read, plru, "plru");
+BENCHMARK_CAPTURE( CacheTagArray_Read, nru, "nru");
+BENCHMARK_CAPTURE( CacheTagArray_Read, random, "random");
+
+static void CacheTagArray_Write( benchmark::State& state, const std::string& replacement)
+{
+    CacheTagArray tags( 2048, 4, 64, 32, replacement);
+    const auto addresses = get_addresses( 4096);
+
+    size_t i = 0;
+    for ( auto _ : state)
+    {
+        benchmark::DoNotOptimize( tags.write( addresses[ i]));
+        i = ( i + 1) % addresses.size();
+    }
+}
+BENCHMARK_CAPTURE( CacheTagArray_Write, lru, "lru");
+BENCHMARK_CAPTURE( CacheTagArray_Write, plru, "plru");
+BENCHMARK_CAPTURE( CacheTagArray_Write, nru, "nru");
+BENCHMARK_CAPTURE( CacheTagArray_Write, random, "random");
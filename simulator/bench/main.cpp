@@ -0,0 +1,133 @@
+/*
+ * main.cpp - runner of microbenchmarks with comparison to a baseline
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+// collects CPU time of each benchmark in nanoseconds per iteration
+class CollectingReporter : public benchmark::ConsoleReporter
+{
+    public:
+        void ReportRuns( const std::vector<Run>& reports) override
+        {
+            for ( const auto& run : reports)
+                if ( run.run_type == Run::RT_Iteration && !run.error_occurred)
+                    times[ run.benchmark_name()] = run.GetAdjustedCPUTime() * to_ns( run.time_unit);
+            ConsoleReporter::ReportRuns( reports);
+        }
+
+        const auto& get_times() const { return times; }
+
+        static double to_ns( benchmark::TimeUnit unit)
+        {
+            switch ( unit)
+            {
+                case benchmark::kSecond:      return 1e9;
+                case benchmark::kMillisecond: return 1e6;
+                case benchmark::kMicrosecond: return 1e3;
+                default:                      return 1;
+            }
+        }
+
+    private:
+        std::map<std::string, double> times;
+};
+
+static double to_ns( const std::string& unit)
+{
+    if ( unit == "s")
+        return 1e9;
+    if ( unit == "ms")
+        return 1e6;
+    if ( unit == "us")
+        return 1e3;
+    return 1;
+}
+
+// returns the number of benchmarks slower than the baseline by more than the tolerance
+static int compare_to_baseline( const std::map<std::string, double>& times, const std::string& filename, double tolerance)
+{
+    boost::property_tree::ptree baseline;
+    try
+    {
+        boost::property_tree::read_json( filename, baseline);
+    }
+    catch ( const boost::property_tree::json_parser_error& e)
+    {
+        std::cerr << "ERROR. Could not read baseline " << e.what() << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    int regressions = 0;
+    std::cout << std::endl << "Comparison to " << filename << " with tolerance " << tolerance << "%" << std::endl;
+    for ( const auto& entry : baseline.get_child( "benchmarks"))
+    {
+        const auto& benchmark = entry.second;
+        if ( benchmark.get<std::string>( "run_type", "iteration") != "iteration")
+            continue;
+
+        const auto name = benchmark.get<std::string>( "name");
+        const auto it = times.find( name);
+        if ( it == times.end())
+            continue;
+
+        const double base_time = benchmark.get<double>( "cpu_time") * to_ns( benchmark.get<std::string>( "time_unit", "ns"));
+        const double change = ( it->second / base_time - 1) * 100;
+        const bool is_regression = change > tolerance;
+        if ( is_regression)
+            ++regressions;
+
+        std::cout << ( is_regression ? "REGRESSION " : "ok         ") << name
+                  << ": " << base_time << " ns -> " << it->second << " ns ("
+                  << ( change >= 0 ? "+" : "") << change << "%)" << std::endl;
+    }
+    return regressions;
+}
+
+int main( int argc, char** argv)
+{
+    benchmark::Initialize( &argc, argv);
+
+    std::string baseline;
+    double tolerance = 20;
+    for ( int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[ i];
+        if ( arg.rfind( "--baseline=", 0) == 0)
+        {
+            baseline = arg.substr( std::string( "--baseline=").size());
+        }
+        else if ( arg.rfind( "--tolerance=", 0) == 0)
+        {
+            tolerance = std::stod( arg.substr( std::string( "--tolerance=").size()));
+        }
+        else
+        {
+            std::cerr << "ERROR. Unknown option " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    CollectingReporter reporter;
+    benchmark::RunSpecifiedBenchmarks( &reporter);
+
+    if ( baseline.empty())
+        return EXIT_SUCCESS;
+
+    const int regressions = compare_to_baseline( reporter.get_times(), baseline, tolerance);
+    if ( regressions != 0)
+    {
+        std::cerr << "ERROR. " << regressions << " benchmarks are slower than the baseline" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
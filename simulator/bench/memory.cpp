@@ -0,0 +1,47 @@
+/*
+ * memory.cpp - benchmarks of functional memory
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <infra/memory/memory.h>
+
+static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
+
+// accesses walk over 64 KB of data with a stride of cache line
+static const Addr DATA_BASE = 0x10000000;
+static const Addr DATA_SIZE = 1 << 16;
+static const Addr STRIDE = 68;
+
+static void FuncMemory_Read( benchmark::State& state)
+{
+    FuncMemory memory( valid_elf_file);
+    for ( Addr offset = 0; offset < DATA_SIZE; offset += 4)
+        memory.write( offset, DATA_BASE + offset);
+
+    Addr offset = 0;
+    for ( auto _ : state)
+    {
+        benchmark::DoNotOptimize( memory.read( DATA_BASE + offset, 4));
+        offset = ( offset + STRIDE) % DATA_SIZE;
+    }
+}
+BENCHMARK( FuncMemory_Read);
+
+static void FuncMemory_Write( benchmark::State& state)
+{
+    FuncMemory memory( valid_elf_file);
+    // pages are allocated before measurement
+    for ( Addr offset = 0; offset < DATA_SIZE; offset += 4)
+        memory.write( 0, DATA_BASE + offset);
+
+    Addr offset = 0;
+    for ( auto _ : state)
+    {
+        memory.write( offset, DATA_BASE + offset, 4);
+        offset = ( offset + STRIDE) % DATA_SIZE;
+    }
+    benchmark::DoNotOptimize( memory.read( DATA_BASE));
+}
+BENCHMARK( FuncMemory_Write);
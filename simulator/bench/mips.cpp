@@ -0,0 +1,90 @@
+/*
+ * mips.cpp - benchmarks of MIPS instructions
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <func_sim/func_sim.h>
+#include <mips/mips.h>
+
+#include <vector>
+
+static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
+
+// instruction words in order of execution of the test program
+static std::vector<std::pair<uint32, Addr>> get_instructions()
+{
+    FuncSim<MIPS> sim;
+    sim.init( valid_elf_file);
+    std::vector<std::pair<uint32, Addr>> instructions( 4096, { 0, 0});
+    for ( auto& instr : instructions)
+    {
+        const auto executed = sim.step();
+        instr = { executed.get_bytes(), executed.get_PC()};
+    }
+    return instructions;
+}
+
+static void MIPSInstr_Decode( benchmark::State& state)
+{
+    const auto instructions = get_instructions();
+    size_t i = 0;
+    for ( auto _ : state)
+    {
+        MIPSInstr instr( instructions[ i].first, instructions[ i].second);
+        benchmark::DoNotOptimize( instr.is_jump());
+        i = ( i + 1) % instructions.size();
+    }
+}
+BENCHMARK( MIPSInstr_Decode);
+
+static void MIPSInstr_Decode_Execute( benchmark::State& state)
+{
+    const auto instructions = get_instructions();
+    size_t i = 0;
+    for ( auto _ : state)
+    {
+        MIPSInstr instr( instructions[ i].first, instructions[ i].second);
+        instr.set_v_src( static_cast<uint32>( i), 0);
+        instr.set_v_src( 3, 1);
+        instr.execute();
+        benchmark::DoNotOptimize( instr.get_v_dst());
+        i = ( i + 1) % instructions.size();
+    }
+}
+BENCHMARK( MIPSInstr_Decode_Execute);
+
+// member pointer dispatch of performance model against switch dispatch of functional simulation
+template<typename Execute>
+static void execute_decoded( benchmark::State& state, Execute execute)
+{
+    const auto bytes = get_instructions();
+    std::vector<MIPSInstr> instructions;
+    for ( const auto& instr : bytes)
+        instructions.emplace_back( instr.first, instr.second);
+
+    size_t i = 0;
+    for ( auto _ : state)
+    {
+        // branches accumulate their targets, so each execution needs a fresh copy
+        auto instr = instructions[ i];
+        instr.set_v_src( static_cast<uint32>( i), 0);
+        instr.set_v_src( 3, 1);
+        execute( &instr);
+        benchmark::DoNotOptimize( instr.get_new_PC());
+        i = ( i + 1) % instructions.size();
+    }
+}
+
+static void MIPSInstr_Execute( benchmark::State& state)
+{
+    execute_decoded( state, []( MIPSInstr* instr) { instr->execute(); });
+}
+BENCHMARK( MIPSInstr_Execute);
+
+static void MIPSInstr_Execute_Dispatched( benchmark::State& state)
+{
+    execute_decoded( state, []( MIPSInstr* instr) { instr->execute_dispatched(); });
+}
+BENCHMARK( MIPSInstr_Execute_Dispatched);
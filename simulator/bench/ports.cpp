@@ -0,0 +1,28 @@
+/*
+ * ports.cpp - benchmarks of ports
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <infra/ports/ports.h>
+
+static void Port_Round_Trip( benchmark::State& state)
+{
+    auto port_map = PortMap::create_port_map();
+    auto wp = make_write_port<uint64>( "BENCH", PORT_BW, PORT_FANOUT);
+    auto rp = make_read_port<uint64>( "BENCH", PORT_LATENCY);
+    port_map->init();
+
+    // each cycle a token is written and the one of the previous cycle is read
+    Cycle cycle = 0_Cl;
+    for ( auto _ : state)
+    {
+        wp->write( static_cast<uint64>( static_cast<double>( cycle)), cycle);
+        if ( rp->is_ready( cycle))
+            benchmark::DoNotOptimize( rp->read( cycle));
+        cycle.inc();
+    }
+    port_map->destroy();
+}
+BENCHMARK( Port_Round_Trip);
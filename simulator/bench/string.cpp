@@ -0,0 +1,32 @@
+/*
+ * string.cpp - benchmarks of copy-on-write string
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <infra/string/cow_string.h>
+
+static void CowString_Copy( benchmark::State& state)
+{
+    const CowString original( "0x4000f0: lui $at, 0x41");
+    for ( auto _ : state)
+    {
+        CowString copy = original;
+        benchmark::DoNotOptimize( copy.data());
+    }
+}
+BENCHMARK( CowString_Copy);
+
+static void CowString_Append( benchmark::State& state)
+{
+    const CowString original( "0x4000f0: lui $at, 0x41");
+    for ( auto _ : state)
+    {
+        // the first append of a copy allocates a new string
+        CowString copy = original;
+        copy += std::string_view( "\t [ $at = 0x410000 ]");
+        benchmark::DoNotOptimize( copy.data());
+    }
+}
+BENCHMARK( CowString_Append);
@@ -0,0 +1,136 @@
+/*
+ * workloads.cpp - end-to-end throughput of simulation of standard kernels
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <core/perf_sim.h>
+#include <func_sim/func_sim.h>
+#include <infra/config/config.h>
+#include <mips/mips.h>
+#include <risc_v/risc_v.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <streambuf>
+#include <string>
+
+static const std::string workloads_path = TEST_PATH "/bench/";
+
+enum class Mode { FUNCTIONAL, PERFORMANCE, CHECKED_PERFORMANCE };
+
+// statistics of performance simulation are not mixed with results of benchmarks
+class SilentOutput
+{
+    public:
+        SilentOutput() : old( std::cout.rdbuf( &sink)) { }
+        ~SilentOutput() { std::cout.rdbuf( old); }
+
+        SilentOutput( const SilentOutput&) = delete;
+        SilentOutput( SilentOutput&&) = delete;
+        SilentOutput& operator=( const SilentOutput&) = delete;
+        SilentOutput& operator=( SilentOutput&&) = delete;
+
+    private:
+        struct NullBuffer : std::streambuf
+        {
+            int overflow( int c) final { return c; }
+        } sink;
+        std::streambuf* const old;
+};
+
+// peak resident memory of the process is reset, so it is measured for each workload
+static void reset_peak_rss()
+{
+#ifdef __linux__
+    std::ofstream( "/proc/self/clear_refs") << "5";
+#endif
+}
+
+// returns peak resident memory in kilobytes, zero if the system does not report it
+static double get_peak_rss()
+{
+#ifdef __linux__
+    std::ifstream status( "/proc/self/status");
+    std::string line;
+    while ( std::getline( status, line))
+        if ( line.rfind( "VmHWM:", 0) == 0)
+            return std::stod( line.substr( 6));
+#endif
+    return 0;
+}
+
+template<typename ISA>
+static uint64 count_instructions( const std::string& binary)
+{
+    FuncSim<ISA> sim;
+    sim.init( binary);
+    uint64 instrs = 1;
+    while ( !sim.step().is_halt())
+        ++instrs;
+    return instrs;
+}
+
+template<typename ISA>
+static void run_workload( benchmark::State& state, const std::string& binary, Mode mode)
+{
+    const uint64 instrs = count_instructions<ISA>( binary);
+    uint64 simulated_instrs = 0;
+    uint64 cycles = 0;
+
+    config::LocalValues checker( std::map<std::string, std::string>{ { "checker", mode == Mode::CHECKED_PERFORMANCE ? "structured" : "off"}});
+    SilentOutput silent_output;
+    reset_peak_rss();
+
+    for ( auto _ : state)
+    {
+        if ( mode == Mode::FUNCTIONAL)
+        {
+            FuncSim<ISA> sim;
+            sim.run_no_limit( binary);
+            simulated_instrs += instrs;
+        }
+        else
+        {
+            PerfSim<ISA> sim( false);
+            sim.run_no_limit( binary);
+            simulated_instrs += sim.get_executed_instrs();
+            cycles += static_cast<uint64>( static_cast<double>( sim.get_cycles()));
+        }
+    }
+
+    state.counters["kIPS"] = benchmark::Counter( simulated_instrs / 1000.0, benchmark::Counter::kIsRate);
+    if ( mode != Mode::FUNCTIONAL)
+        state.counters["cycles_per_sec"] = benchmark::Counter( static_cast<double>( cycles), benchmark::Counter::kIsRate);
+    state.counters["peak_rss_kb"] = get_peak_rss();
+}
+
+template<typename ISA>
+static void register_workload( const std::string& isa, const std::string& name)
+{
+    static const std::map<Mode, std::string> modes = {
+        { Mode::FUNCTIONAL,          "functional"},
+        { Mode::PERFORMANCE,         "performance"},
+        { Mode::CHECKED_PERFORMANCE, "performance_checker"}
+    };
+
+    const std::string binary = workloads_path + ( isa == "mips" ? "" : "riscv_") + name + ".out";
+    for ( const auto& mode : modes)
+        benchmark::RegisterBenchmark( ( "Workload/" + isa + "/" + name + "/" + mode.second).c_str(), run_workload<ISA>, binary, mode.first)
+            ->UseRealTime()
+            ->Unit( benchmark::kMillisecond);
+}
+
+static bool register_workloads()
+{
+    for ( const auto& name : { "pointer_chase", "matmul", "sort", "recursion"})
+    {
+        register_workload<MIPS>( "mips", name);
+        register_workload<RISCV32>( "riscv32", name);
+    }
+    return true;
+}
+
+static const bool workloads_are_registered = register_workloads();
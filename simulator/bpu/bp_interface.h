@@ -9,21 +9,60 @@
 
 #include <infra/types.h>
 
-/*the structure of data sent from memory to fetch stage */
+/* kind of control transfer, it is known by fetch from predecoded instruction */
+enum class BranchType : uint8
+{
+    NONE,          // not a jump
+    BRANCH,        // direct jump or branch
+    CALL,          // direct jump and link
+    RETURN,        // indirect jump to return address
+    INDIRECT,      // other indirect jumps
+    INDIRECT_CALL  // indirect jump and link
+};
+
+/* state of return address stack before prediction */
+struct RASCheckpoint {
+    uint32 top = 0;
+    uint32 size = 0;
+    Addr value = NO_VAL32;
+};
+
+/* prediction with speculative state of predictor which is repaired by update */
 struct BPInterface {
     Addr pc = NO_VAL32;
     bool is_taken = false;
     Addr target = NO_VAL32;
 
+    /* global history used for prediction, it repairs the speculative one on misprediction */
+    uint64 history = 0;
+    bool is_misprediction = false;
+
+    /* speculative state of target predictors used for prediction */
+    BranchType type = BranchType::NONE;
+    RASCheckpoint ras = {};
+    uint64 path_history = 0;
+
     BPInterface() = default;
 
-    BPInterface( Addr pc, bool is_taken, Addr target)
+    BPInterface( Addr pc, bool is_taken, Addr target, uint64 history = 0, bool is_misprediction = false)
         : pc( pc)
 	, is_taken( is_taken)
         , target( target)
+        , history( history)
+        , is_misprediction( is_misprediction)
     { }
 };
 
+/* outcome of a jump sent from memory to fetch stage, the prediction is kept by fetch under the id */
+struct BPResolution {
+    uint32 prediction_id = 0;
+    Addr pc = NO_VAL32;
+    Addr target = NO_VAL32;
+    bool is_taken = false;
+    bool is_misprediction = false;
+    BranchType type = BranchType::NONE;
+};
+
 #endif // BP_INTERFACE_H_
 
 
@@ -57,7 +57,7 @@ public:
 class BPEntryOneBit final : public BPEntry
 {
 private:
-    enum class State
+    enum class State : uint8
     {
         NT = 0,
         T = 1
@@ -91,7 +91,7 @@ class BPEntryTwoBit : public BPEntry
 public:
     class State
     {
-        enum class StateValue
+        enum class StateValue : uint8
         {
             NT  = 0, // NOT TAKEN
             WNT = 1, // WEAKLY NOT TAKEN
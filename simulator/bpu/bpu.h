@@ -11,14 +11,18 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <string>
+#include <variant>
 
 // MIPT_MIPS modules
 #include <infra/cache/cache_tag_array.h>
 #include <infra/log.h>
+#include <infra/stats/stats.h>
 #include <infra/types.h>
 
 #include "bp_interface.h"
 #include "bpentry.h"
+#include "direction_predictor.h"
 
 /*
  *******************************************************************************
@@ -33,6 +37,15 @@ public:
     virtual BPInterface get_bp_info( Addr PC) const = 0;
     virtual void update( const BPInterface& bp_upd) = 0;
 
+    /* prediction made by fetch, it may update speculative state of predictor */
+    virtual BPInterface predict( Addr PC, BranchType /* type */) { return get_bp_info( PC); }
+
+    /* instructions are fetched again, so speculative state recorded in their first prediction is restored */
+    virtual void restore( const BPInterface& /* prediction */) { }
+
+    /* counters of internal structures are registered with the prefix */
+    virtual void register_stats( StatsRegistry* /* stats */, const std::string& /* prefix */) const { }
+
     BaseBP() = default;
     virtual ~BaseBP() = default;
     BaseBP( const BaseBP&) = default;
@@ -45,70 +58,174 @@ public:
 template<typename T>
 class BP final: public BaseBP
 {
-    std::vector<std::vector<T>> data;
     CacheTagArray tags;
+    std::vector<T> data; // entries of one set are contiguous
+
+    T& entry( uint32 set, uint32 way) { return data[ set * tags.ways + way]; }
+    const T& entry( uint32 set, uint32 way) const { return data[ set * tags.ways + way]; }
 
 public:
     BP( uint32 size_in_entries,
         uint32 ways,
-        uint32 branch_ip_size_in_bits) :
+        uint32 branch_ip_size_in_bits,
+        const std::string& replacement) :
 
-        data( ways, std::vector<T>( size_in_entries / ways)),
         tags( size_in_entries,
               ways,
               // we're reusing existing CacheTagArray functionality,
               // but here we don't split memory in blocks, storing
               // IP's only, so hardcoding here the granularity of 4 bytes:
               4,
-              branch_ip_size_in_bits)
+              branch_ip_size_in_bits,
+              replacement),
+        data( tags.sets * tags.ways)
         { }
 
     /* prediction */
-    bool is_taken( Addr PC) const final
+    bool is_taken( Addr PC) const final { return get_bp_info( PC).is_taken; }
+    Addr get_target( Addr PC) const final { return get_bp_info( PC).target; }
+
+    /* update */
+    void update( const BPInterface& bp_upd) final
     {
-        // do not update LRU information on prediction,
-        // so "no_touch" version of "tags.read" is used:
-        const auto[ is_hit, way] = tags.read_no_touch( PC);
+        const auto set = tags.set( bp_upd.pc);
+        auto[ is_hit, way] = tags.read( bp_upd.pc);
+
+        if ( !is_hit) { // miss
+            way = tags.write( bp_upd.pc); // add new entry to cache
+            auto& new_entry = entry( set, way);
+            new_entry.reset();
+            new_entry.update_target( bp_upd.target);
+        }
 
-        return is_hit && data[ way][ tags.set(PC)].is_taken( PC);
+        entry( set, way).update( bp_upd.is_taken, bp_upd.target);
     }
 
-    Addr get_target( Addr PC) const final
+    void register_stats( StatsRegistry* stats, const std::string& prefix) const final
+    {
+        tags.register_stats( stats, prefix + ".btb");
+    }
+
+    /* direction and target are taken from the entry found by a single lookup */
+    BPInterface get_bp_info( Addr PC) const final
     {
         // do not update LRU information on prediction,
         // so "no_touch" version of "tags.read" is used:
         const auto[ is_hit, way] = tags.read_no_touch( PC);
+        if ( !is_hit)
+            return BPInterface( PC, false, PC + 4);
 
         // return saved target only in case it is predicted taken
-        if ( is_hit && is_taken( PC))
-            return data[ way][ tags.set(PC)].getTarget();
+        const auto& found = entry( tags.set( PC), way);
+        const bool is_taken = found.is_taken( PC);
+        return BPInterface( PC, is_taken, is_taken ? found.getTarget() : PC + 4);
+    }
+
+    BPInterface predict( Addr PC, BranchType /* type */) final { return get_bp_info( PC); }
+};
+
+
+/* BTB with a separate direction predictor and speculative global history.
+ * History is updated by predictions of fetch and repaired with the history
+ * recorded in the mispredicted instruction.
+ */
+template<typename D>
+class HistoryBP final: public BaseBP
+{
+    CacheTagArray tags;
+    std::vector<Addr> targets; // targets of one set are contiguous
+    D direction;
 
-        return PC + 4;
+    uint64 history = 0;
+
+    std::pair<bool, uint32> find( Addr PC) const
+    {
+        const auto[ is_hit, way] = tags.read_no_touch( PC);
+        return { is_hit, tags.set( PC) * tags.ways + way};
     }
 
-    /* update */
-    void update( const BPInterface& bp_upd) final
+    BPInterface get_bp_info( Addr PC, bool is_hit, uint32 index) const
     {
-        const auto set = tags.set( bp_upd.pc);
-        auto[ is_hit, way] = tags.read( bp_upd.pc);
+        const bool is_taken = is_hit && direction.is_taken( PC, history);
+        return BPInterface( PC, is_taken, is_taken ? targets[ index] : PC + 4, history);
+    }
 
-        if ( !is_hit) { // miss
-            way = tags.write( bp_upd.pc); // add new entry to cache
-            auto& entry = data[ way][ set];
-            entry.reset();
-            entry.update_target( bp_upd.target);
-        }
+public:
+    HistoryBP( uint32 size_in_entries,
+               uint32 ways,
+               uint32 branch_ip_size_in_bits,
+               const std::string& replacement,
+               uint32 direction_size_in_bytes) :
 
-        data[ way][ set].update( bp_upd.is_taken, bp_upd.target);
-    }
+        tags( size_in_entries, ways, 4, branch_ip_size_in_bits, replacement),
+        targets( tags.sets * tags.ways, NO_VAL32),
+        direction( direction_size_in_bytes)
+        { }
+
+    /* prediction */
+    bool is_taken( Addr PC) const final { return get_bp_info( PC).is_taken; }
+    Addr get_target( Addr PC) const final { return get_bp_info( PC).target; }
 
     BPInterface get_bp_info( Addr PC) const final
     {
-        return BPInterface( PC, is_taken( PC), get_target( PC)); 
+        const auto[ is_hit, index] = find( PC);
+        return get_bp_info( PC, is_hit, index);
+    }
+
+    BPInterface predict( Addr PC, BranchType /* type */) final
+    {
+        const auto[ is_hit, index] = find( PC);
+        const auto info = get_bp_info( PC, is_hit, index);
+
+        // only branches known by BTB are tracked by history
+        if ( is_hit)
+            history = ( history << 1) | uint64{ info.is_taken};
+
+        return info;
+    }
+
+    void restore( const BPInterface& prediction) final { history = prediction.history; }
+
+    void register_stats( StatsRegistry* stats, const std::string& prefix) const final
+    {
+        tags.register_stats( stats, prefix + ".btb");
+    }
+
+    /* update */
+    void update( const BPInterface& bp_upd) final
+    {
+        direction.update( bp_upd.pc, bp_upd.history, bp_upd.is_taken);
+
+        auto[ is_hit, way] = tags.read( bp_upd.pc);
+        if ( !is_hit)
+            way = tags.write( bp_upd.pc);
+
+        auto& target = targets[ tags.set( bp_upd.pc) * tags.ways + way];
+        if ( !is_hit || bp_upd.is_taken)
+            target = bp_upd.target;
+
+        // younger predictions are flushed, so history is restored
+        if ( bp_upd.is_misprediction)
+        {
+            history = ( bp_upd.history << 1) | uint64{ bp_upd.is_taken};
+        }
     }
 };
 
 
+/* All the predictors created by the factory. The one selected by name is kept
+ * by value, so it is called without virtual dispatch on each fetched instruction.
+ */
+using AnyBP = std::variant<BP<BPEntryAlwaysTaken>,
+                           BP<BPEntryBackwardJumps>,
+                           BP<BPEntryOneBit>,
+                           BP<BPEntryTwoBit>,
+                           BP<BPEntryAdaptive<2>>,
+                           HistoryBP<GShare>,
+                           HistoryBP<HashedPerceptron>,
+                           HistoryBP<TAGE>>;
+
+
 /*
  *******************************************************************************
  *                                FACTORY CLASS                                *
@@ -119,7 +236,14 @@ class BPFactory {
     public:
         virtual std::unique_ptr<BaseBP> create(uint32 size_in_entries,
                                                uint32 ways,
-                                               uint32 branch_ip_size_in_bits) const = 0;
+                                               uint32 branch_ip_size_in_bits,
+                                               const std::string& replacement,
+                                               uint32 direction_size_in_bytes) const = 0;
+        virtual AnyBP create_any(uint32 size_in_entries,
+                                 uint32 ways,
+                                 uint32 branch_ip_size_in_bits,
+                                 const std::string& replacement,
+                                 uint32 direction_size_in_bytes) const = 0;
         BaseBPCreator() = default;
         virtual ~BaseBPCreator() = default;
         BaseBPCreator( const BaseBPCreator&) = delete;
@@ -133,42 +257,109 @@ class BPFactory {
     public:
         std::unique_ptr<BaseBP> create(uint32 size_in_entries,
                                        uint32 ways,
-                                       uint32 branch_ip_size_in_bits) const final
+                                       uint32 branch_ip_size_in_bits,
+                                       const std::string& replacement,
+                                       uint32 /* direction_size_in_bytes */) const final
         {
             return std::make_unique<BP<T>>( size_in_entries,
                                             ways,
-                                            branch_ip_size_in_bits);
+                                            branch_ip_size_in_bits,
+                                            replacement);
+        }
+        AnyBP create_any(uint32 size_in_entries,
+                         uint32 ways,
+                         uint32 branch_ip_size_in_bits,
+                         const std::string& replacement,
+                         uint32 /* direction_size_in_bytes */) const final
+        {
+            return AnyBP( std::in_place_type<BP<T>>,
+                          size_in_entries,
+                          ways,
+                          branch_ip_size_in_bits,
+                          replacement);
         }
         BPCreator() = default;
     };
 
+    template<typename T>
+    class HistoryBPCreator : public BaseBPCreator {
+    public:
+        std::unique_ptr<BaseBP> create(uint32 size_in_entries,
+                                       uint32 ways,
+                                       uint32 branch_ip_size_in_bits,
+                                       const std::string& replacement,
+                                       uint32 direction_size_in_bytes) const final
+        {
+            return std::make_unique<HistoryBP<T>>( size_in_entries,
+                                                   ways,
+                                                   branch_ip_size_in_bits,
+                                                   replacement,
+                                                   direction_size_in_bytes);
+        }
+        AnyBP create_any(uint32 size_in_entries,
+                         uint32 ways,
+                         uint32 branch_ip_size_in_bits,
+                         const std::string& replacement,
+                         uint32 direction_size_in_bytes) const final
+        {
+            return AnyBP( std::in_place_type<HistoryBP<T>>,
+                          size_in_entries,
+                          ways,
+                          branch_ip_size_in_bits,
+                          replacement,
+                          direction_size_in_bytes);
+        }
+        HistoryBPCreator() = default;
+    };
+
     const std::map<std::string, BaseBPCreator*> map;
 
+    const BaseBPCreator* get_creator( const std::string& name) const
+    {
+        if ( map.find(name) == map.end())
+        {
+             std::cerr << "ERROR. Invalid branch prediction mode " << name << std::endl
+                       << "Supported modes:" << std::endl;
+             for ( const auto& map_name : map)
+                 std::cerr << "\t" << map_name.first << std::endl;
+
+             std::exit( EXIT_FAILURE);
+        }
+
+        return map.at( name);
+    }
+
 public:
     BPFactory() :
         map({ { "static_always_taken",   new BPCreator<BPEntryAlwaysTaken>},
               { "static_backward_jumps", new BPCreator<BPEntryBackwardJumps>},
               { "dynamic_one_bit",       new BPCreator<BPEntryOneBit>},
               { "dynamic_two_bit",       new BPCreator<BPEntryTwoBit>},
-              { "adaptive_two_level",    new BPCreator<BPEntryAdaptive<2>>}})
+              { "adaptive_two_level",    new BPCreator<BPEntryAdaptive<2>>},
+              { "gshare",                new HistoryBPCreator<GShare>},
+              { "hashed_perceptron",     new HistoryBPCreator<HashedPerceptron>},
+              { "tage",                  new HistoryBPCreator<TAGE>}})
     { }
 
     auto create( const std::string& name,
                  uint32 size_in_entries,
                  uint32 ways,
-                 uint32 branch_ip_size_in_bits = 32) const
+                 uint32 branch_ip_size_in_bits = 32,
+                 const std::string& replacement = "lru",
+                 uint32 direction_size_in_bytes = 4096) const
     {
-        if ( map.find(name) == map.end())
-        {
-             std::cerr << "ERROR. Invalid branch prediction mode " << name << std::endl
-                       << "Supported modes:" << std::endl;
-             for ( const auto& map_name : map)
-                 std::cerr << "\t" << map_name.first << std::endl;
-
-             std::exit( EXIT_FAILURE);
-        }
+        return get_creator( name)->create( size_in_entries, ways, branch_ip_size_in_bits, replacement, direction_size_in_bytes);
+    }
 
-        return map.at( name)->create( size_in_entries, ways, branch_ip_size_in_bits);
+    /* the predictor is returned by value to be called without virtual dispatch */
+    AnyBP create_any( const std::string& name,
+                      uint32 size_in_entries,
+                      uint32 ways,
+                      uint32 branch_ip_size_in_bits = 32,
+                      const std::string& replacement = "lru",
+                      uint32 direction_size_in_bytes = 4096) const
+    {
+        return get_creator( name)->create_any( size_in_entries, ways, branch_ip_size_in_bits, replacement, direction_size_in_bytes);
     }
 
     ~BPFactory()
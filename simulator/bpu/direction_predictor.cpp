@@ -0,0 +1,164 @@
+/*
+ * direction_predictor.cpp - global history direction predictors
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "direction_predictor.h"
+#include "folded_history.h"
+
+/* GShare */
+GShare::GShare( uint32 size_in_bytes)
+    // each byte keeps 4 two-bit counters
+    : table( floor_power_of_two( uint64{ size_in_bytes} * 4))
+    , index_bits( log_2( static_cast<uint32>( table.size())))
+{ }
+
+uint32 GShare::index( Addr PC, uint64 history) const
+{
+    return ( ( PC >> 2) ^ fold_history( history, index_bits, index_bits)) & bitmask<uint32>( index_bits);
+}
+
+/* Hashed perceptron */
+HashedPerceptron::HashedPerceptron( uint32 size_in_bytes)
+    : weights( history_lengths.size() * floor_power_of_two( size_in_bytes / history_lengths.size()), 0)
+    , index_bits( log_2( floor_power_of_two( size_in_bytes / history_lengths.size())))
+{ }
+
+uint32 HashedPerceptron::index( size_t table, Addr PC, uint64 history) const
+{
+    const uint32 hash = ( PC >> 2) ^ ( PC >> ( 2 + index_bits)) ^ fold_history( history, history_lengths[ table], index_bits);
+    return static_cast<uint32>( ( table << index_bits) + ( hash & bitmask<uint32>( index_bits)));
+}
+
+int32 HashedPerceptron::output( Addr PC, uint64 history) const
+{
+    int32 sum = 0;
+    for ( size_t i = 0; i < history_lengths.size(); ++i)
+        sum += weights[ index( i, PC, history)];
+    return sum;
+}
+
+void HashedPerceptron::update( Addr PC, uint64 history, bool is_taken)
+{
+    const auto sum = output( PC, history);
+    if ( ( sum >= 0) == is_taken && std::abs( sum) > threshold)
+        return;
+
+    for ( size_t i = 0; i < history_lengths.size(); ++i)
+    {
+        auto& weight = weights[ index( i, PC, history)];
+        weight = static_cast<int8>( std::clamp( weight + ( is_taken ? 1 : -1), min_weight, max_weight));
+    }
+}
+
+/* TAGE */
+TAGE::TAGE( uint32 size_in_bytes)
+    // a quarter of the budget is given to two-bit counters of the base predictor,
+    // the rest is shared by tagged tables with 2-byte entries
+    : base( floor_power_of_two( size_in_bytes))
+    , tables( history_lengths.size() * floor_power_of_two( uint64{ size_in_bytes} * 3 / 32))
+    , table_size( floor_power_of_two( uint64{ size_in_bytes} * 3 / 32))
+    , index_bits( log_2( table_size))
+{ }
+
+TAGE::Lookup TAGE::lookup( Addr PC, uint64 history) const
+{
+    Lookup result;
+    for ( size_t i = 0; i < history_lengths.size(); ++i)
+    {
+        const auto length = history_lengths[ i];
+        const uint32 hash = ( PC >> 2) ^ ( PC >> ( 2 + index_bits)) ^ fold_history( history, length, index_bits);
+        result.indices[ i] = hash & bitmask<uint32>( index_bits);
+        result.tags[ i] = static_cast<uint8>( ( ( PC >> 2) ^ fold_history( history, length, tag_bits)
+                                                ^ ( fold_history( history, length, tag_bits - 1) << 1)) & bitmask<uint32>( tag_bits));
+    }
+
+    // the longest history match provides the prediction
+    for ( size_t i = history_lengths.size(); i-- > 0;)
+    {
+        const auto& candidate = entry( i, result.indices[ i]);
+        if ( !candidate.is_valid || candidate.tag != result.tags[ i])
+            continue;
+
+        if ( result.provider == no_table)
+        {
+            result.provider = i;
+        }
+        else
+        {
+            result.alternate = i;
+            break;
+        }
+    }
+
+    result.alternate_prediction = result.alternate != no_table
+        ? entry( result.alternate, result.indices[ result.alternate]).counter >= 0
+        : base.is_taken( base_index( PC));
+
+    if ( result.provider == no_table)
+    {
+        result.prediction = result.alternate_prediction;
+        return result;
+    }
+
+    // newly allocated entries are not trusted until they become strong or useful
+    const auto& provider = entry( result.provider, result.indices[ result.provider]);
+    const bool is_weak = ( provider.counter == 0 || provider.counter == -1) && provider.useful == 0;
+    result.provider_prediction = provider.counter >= 0;
+    result.prediction = is_weak ? result.alternate_prediction : result.provider_prediction;
+    return result;
+}
+
+void TAGE::allocate( const Lookup& result, bool is_taken)
+{
+    const size_t first = result.provider == no_table ? 0 : result.provider + 1;
+    for ( size_t i = first; i < history_lengths.size(); ++i)
+    {
+        auto& candidate = entry( i, result.indices[ i]);
+        if ( !candidate.is_valid || candidate.useful == 0)
+        {
+            candidate = { static_cast<int8>( is_taken ? 0 : -1), result.tags[ i], 0, true};
+            return;
+        }
+    }
+
+    // no free entries, make them older
+    for ( size_t i = first; i < history_lengths.size(); ++i)
+    {
+        auto& candidate = entry( i, result.indices[ i]);
+        candidate.useful = static_cast<uint8>( candidate.useful > 0 ? candidate.useful - 1 : 0);
+    }
+}
+
+void TAGE::update( Addr PC, uint64 history, bool is_taken)
+{
+    const auto result = lookup( PC, history);
+
+    if ( result.provider != no_table)
+    {
+        auto& provider = entry( result.provider, result.indices[ result.provider]);
+        if ( result.provider_prediction != result.alternate_prediction)
+        {
+            if ( result.provider_prediction == is_taken)
+                provider.useful = static_cast<uint8>( std::min<int>( provider.useful + 1, max_useful));
+            else
+                provider.useful = static_cast<uint8>( provider.useful > 0 ? provider.useful - 1 : 0);
+        }
+        provider.counter = static_cast<int8>( std::clamp<int>( provider.counter + ( is_taken ? 1 : -1), min_counter, max_counter));
+    }
+    else
+    {
+        base.update( base_index( PC), is_taken);
+    }
+
+    if ( result.prediction != is_taken)
+        allocate( result, is_taken);
+
+    // periodic aging of usefulness counters
+    if ( ++updates % u_reset_period == 0)
+        for ( auto& elem : tables)
+            elem.useful >>= 1u;
+}
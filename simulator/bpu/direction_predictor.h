@@ -0,0 +1,127 @@
+/*
+ * direction_predictor.h - global history direction predictors
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef DIRECTION_PREDICTOR_H
+#define DIRECTION_PREDICTOR_H
+
+#include <array>
+#include <vector>
+
+#include <infra/types.h>
+
+#include "two_bit_counters.h"
+
+/* Direction predictors are separated from BTB, they predict only
+ * whether the branch is taken using its PC and global history.
+ * Storage budget is given in bytes, tables are rounded down to powers of 2.
+ */
+class DirectionPredictor
+{
+public:
+    virtual bool is_taken( Addr PC, uint64 history) const = 0;
+    virtual void update( Addr PC, uint64 history, bool is_taken) = 0;
+
+    DirectionPredictor() = default;
+    virtual ~DirectionPredictor() = default;
+    DirectionPredictor( const DirectionPredictor&) = delete;
+    DirectionPredictor( DirectionPredictor&&) = delete;
+    DirectionPredictor& operator=( const DirectionPredictor&) = delete;
+    DirectionPredictor& operator=( DirectionPredictor&&) = delete;
+};
+
+/* Two-bit counters indexed by xor of PC and global history */
+class GShare final : public DirectionPredictor
+{
+public:
+    explicit GShare( uint32 size_in_bytes);
+
+    bool is_taken( Addr PC, uint64 history) const final { return table.is_taken( index( PC, history)); }
+    void update( Addr PC, uint64 history, bool is_taken) final { table.update( index( PC, history), is_taken); }
+
+private:
+    uint32 index( Addr PC, uint64 history) const;
+
+    TwoBitCounters table;
+    const uint32 index_bits;
+};
+
+/* Hashed perceptron: sum of weights selected by hashes of PC
+ * and global history segments of different lengths
+ */
+class HashedPerceptron final : public DirectionPredictor
+{
+public:
+    explicit HashedPerceptron( uint32 size_in_bytes);
+
+    bool is_taken( Addr PC, uint64 history) const final { return output( PC, history) >= 0; }
+    void update( Addr PC, uint64 history, bool is_taken) final;
+
+private:
+    static constexpr const std::array<uint32, 8> history_lengths = {{ 0, 2, 4, 8, 12, 16, 24, 32}};
+    static constexpr const int32 max_weight = 127;
+    static constexpr const int32 min_weight = -128;
+    // weights are not trained on correct predictions with outputs greater than the threshold
+    static constexpr const int32 threshold = 30;
+
+    uint32 index( size_t table, Addr PC, uint64 history) const;
+    int32 output( Addr PC, uint64 history) const;
+
+    std::vector<int8> weights; // tables of weights one after another
+    const uint32 index_bits;
+};
+
+/* TAGE: bimodal base predictor and tagged tables indexed
+ * by geometrically increasing global history lengths
+ */
+class TAGE final : public DirectionPredictor
+{
+public:
+    explicit TAGE( uint32 size_in_bytes);
+
+    bool is_taken( Addr PC, uint64 history) const final { return lookup( PC, history).prediction; }
+    void update( Addr PC, uint64 history, bool is_taken) final;
+
+private:
+    static constexpr const std::array<uint32, 4> history_lengths = {{ 5, 12, 27, 60}};
+    static constexpr const uint32 tag_bits = 8;
+    static constexpr const uint32 u_reset_period = 1u << 18;
+    static constexpr const int8 max_counter = 3;
+    static constexpr const int8 min_counter = -4;
+    static constexpr const uint8 max_useful = 3;
+    static constexpr const size_t no_table = history_lengths.size();
+
+    struct Entry
+    {
+        int8 counter = 0; // 3-bit signed counter, taken if not negative
+        uint8 tag = 0;
+        uint8 useful = 0; // 2-bit usefulness counter
+        bool is_valid = false;
+    };
+
+    struct Lookup
+    {
+        std::array<uint32, history_lengths.size()> indices = {{}};
+        std::array<uint8, history_lengths.size()> tags = {{}};
+        size_t provider = no_table;
+        size_t alternate = no_table;
+        bool provider_prediction = false;
+        bool alternate_prediction = false;
+        bool prediction = false;
+    };
+
+    uint32 base_index( Addr PC) const { return ( PC >> 2) & ( static_cast<uint32>( base.size()) - 1); }
+    Entry& entry( size_t table, uint32 index) { return tables[ table * table_size + index]; }
+    const Entry& entry( size_t table, uint32 index) const { return tables[ table * table_size + index]; }
+    Lookup lookup( Addr PC, uint64 history) const;
+    void allocate( const Lookup& result, bool is_taken);
+
+    TwoBitCounters base;
+    std::vector<Entry> tables; // tagged tables one after another
+    const uint32 table_size;
+    const uint32 index_bits;
+    uint32 updates = 0;
+};
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * folded_history.h - hashing of global history for predictor tables
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef FOLDED_HISTORY_H
+#define FOLDED_HISTORY_H
+
+#include <algorithm>
+
+#include <infra/macro.h>
+#include <infra/types.h>
+
+// the largest power of 2 which is not greater than the value, at least 1
+inline uint32 floor_power_of_two( uint64 value)
+{
+    uint32 result = 1;
+    while ( uint64{ result} * 2 <= value && result < ( 1u << 31))
+        result *= 2;
+    return result;
+}
+
+inline uint32 log_2( uint32 power_of_two)
+{
+    uint32 result = 0;
+    while ( ( 1u << result) < power_of_two)
+        ++result;
+    return result;
+}
+
+// xor of history chunks of the given width, only 'length' youngest bits are used
+inline uint32 fold_history( uint64 history, uint32 length, uint32 width)
+{
+    if ( width == 0)
+        return 0;
+
+    auto bits = history & bitmask<uint64>( std::min( length, 64u));
+    uint32 result = 0;
+    while ( bits != 0)
+    {
+        result ^= static_cast<uint32>( bits & bitmask<uint64>( width));
+        bits = width < 64 ? bits >> width : 0;
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * hot_branches.cpp - branches of the most mispredictions in a bounded table
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+
+#include "hot_branches.h"
+
+HotBranches::HotBranches( size_t capacity) : capacity( capacity)
+{
+    heap.reserve( capacity);
+    positions.reserve( capacity);
+}
+
+void HotBranches::swap( size_t lhs, size_t rhs)
+{
+    std::swap( heap[ lhs], heap[ rhs]);
+    positions[ heap[ lhs].PC] = lhs;
+    positions[ heap[ rhs].PC] = rhs;
+}
+
+void HotBranches::sift_down( size_t position)
+{
+    while ( true)
+    {
+        const size_t left = 2 * position + 1;
+        const size_t right = left + 1;
+        size_t smallest = position;
+        if ( left < heap.size() && heap[ left].mispredictions < heap[ smallest].mispredictions)
+            smallest = left;
+        if ( right < heap.size() && heap[ right].mispredictions < heap[ smallest].mispredictions)
+            smallest = right;
+        if ( smallest == position)
+            return;
+
+        swap( position, smallest);
+        position = smallest;
+    }
+}
+
+void HotBranches::update_tracked( Addr PC, bool is_taken, bool is_misprediction)
+{
+    const auto it = positions.find( PC);
+    if ( it != positions.end())
+    {
+        auto& branch = heap[ it->second];
+        ++branch.executions;
+        branch.taken += is_taken ? 1 : 0;
+        if ( is_misprediction)
+        {
+            ++branch.mispredictions;
+            sift_down( it->second);
+        }
+        return;
+    }
+
+    // correctly predicted branches do not replace tracked ones
+    if ( !is_misprediction)
+        return;
+
+    if ( heap.size() < capacity)
+    {
+        heap.push_back( { PC, 1, is_taken ? 1u : 0u, 1, 0});
+        size_t position = heap.size() - 1;
+        positions.emplace( PC, position);
+        while ( position != 0 && heap[ ( position - 1) / 2].mispredictions > heap[ position].mispredictions)
+        {
+            swap( position, ( position - 1) / 2);
+            position = ( position - 1) / 2;
+        }
+        return;
+    }
+
+    const uint64 min_mispredictions = heap.front().mispredictions;
+    positions.erase( heap.front().PC);
+    heap.front() = { PC, 1, is_taken ? 1u : 0u, min_mispredictions + 1, min_mispredictions};
+    positions.emplace( PC, 0);
+    sift_down( 0);
+}
+
+std::vector<HotBranches::Branch> HotBranches::get_top( size_t number) const
+{
+    auto result = heap;
+    std::sort( result.begin(), result.end(), []( const Branch& lhs, const Branch& rhs) {
+        return lhs.mispredictions != rhs.mispredictions ? lhs.mispredictions > rhs.mispredictions : lhs.PC < rhs.PC;
+    });
+    result.resize( std::min( number, result.size()));
+    return result;
+}
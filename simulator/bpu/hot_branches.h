@@ -0,0 +1,58 @@
+/*
+ * hot_branches.h - branches of the most mispredictions in a bounded table
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef HOT_BRANCHES_H
+#define HOT_BRANCHES_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <infra/types.h>
+
+/* Space-saving summary of mispredicted branches. A mispredicted branch which
+ * is not tracked replaces the tracked branch of the fewest mispredictions and
+ * inherits its count as the error, so any branch of more than total / capacity
+ * mispredictions is tracked. Executions and taken jumps are counted since the
+ * branch is tracked. Branches are kept in a min-heap of mispredictions, so
+ * updates take logarithmic time and the table never grows over its capacity.
+ */
+class HotBranches
+{
+public:
+    struct Branch
+    {
+        Addr PC = NO_VAL32;
+        uint64 executions = 0;
+        uint64 taken = 0;
+        uint64 mispredictions = 0;
+        uint64 error = 0; // mispredictions counted before the branch was tracked
+
+        double get_taken_rate() const { return executions == 0 ? 0 : static_cast<double>( taken) / static_cast<double>( executions); }
+    };
+
+    // zero capacity disables tracking
+    explicit HotBranches( size_t capacity);
+
+    void update( Addr PC, bool is_taken, bool is_misprediction)
+    {
+        if ( capacity != 0)
+            update_tracked( PC, is_taken, is_misprediction);
+    }
+
+    // branches of the most mispredictions go first
+    std::vector<Branch> get_top( size_t number) const;
+    size_t size() const { return heap.size(); }
+
+private:
+    void update_tracked( Addr PC, bool is_taken, bool is_misprediction);
+    void sift_down( size_t position);
+    void swap( size_t lhs, size_t rhs);
+
+    const size_t capacity;
+    std::vector<Branch> heap;
+    std::unordered_map<Addr, size_t> positions;
+};
+
+#endif // HOT_BRANCHES_H
@@ -7,6 +7,8 @@
 
 // MIPT-MIPS modules
 #include "../bpu.h"
+#include "../hot_branches.h"
+#include "../target_predictor.h"
 
 
 TEST( Initialization, WrongParameters)
@@ -116,6 +118,295 @@ TEST( Overload, LRU)
     ASSERT_EQ( bp->get_target(PCconst), target);
 }
 
+// runs a branch with the pattern, returns number of mispredictions in the last runs
+static uint32 count_mispredictions( BaseBP* bp, const std::vector<bool>& pattern, uint32 runs, uint32 checked_runs)
+{
+    const Addr PC = 0x100;
+    const Addr target = 0x80;
+    uint32 mispredictions = 0;
+    for ( uint32 i = 0; i < runs * pattern.size(); ++i)
+    {
+        const bool is_taken = pattern[ i % pattern.size()];
+        const auto info = bp->predict( PC, BranchType::BRANCH);
+        const bool is_misprediction = info.is_taken != is_taken || info.target != ( is_taken ? target : PC + 4);
+        if ( is_misprediction && i >= ( runs - checked_runs) * pattern.size())
+            ++mispredictions;
+
+        bp->update( BPInterface( PC, is_taken, is_taken ? target : PC + 4, info.history, is_misprediction));
+    }
+    return mispredictions;
+}
+
+TEST( GlobalHistory, LoopPattern)
+{
+    BPFactory bp_factory;
+    const std::vector<bool> loop = { true, true, true, true, true, true, false};
+
+    // per-branch two-bit counters miss the exit of each loop
+    auto two_bit = bp_factory.create( "dynamic_two_bit", 128, 16);
+    ASSERT_EQ( count_mispredictions( two_bit.get(), loop, 1000, 100), 100u);
+
+    for ( const auto& mode : { "gshare", "hashed_perceptron", "tage"})
+    {
+        auto bp = bp_factory.create( mode, 128, 16, 32, "lru", 1024);
+        ASSERT_EQ( count_mispredictions( bp.get(), loop, 1000, 100), 0u) << mode;
+    }
+}
+
+TEST( GlobalHistory, Repair)
+{
+    BPFactory bp_factory;
+    auto bp = bp_factory.create( "gshare", 128, 16);
+
+    const Addr PC = 0x100;
+    bp->update( BPInterface( PC, true, 0x80, 0, true));
+    const auto history = bp->get_bp_info( PC).history;
+    ASSERT_EQ( history, 1u);
+
+    // branches known by BTB shift history speculatively
+    const auto info = bp->predict( PC, BranchType::BRANCH);
+    ASSERT_EQ( info.history, history);
+    ASSERT_EQ( bp->get_bp_info( PC).history, ( history << 1) | uint64{ info.is_taken});
+
+    // stalled instruction is predicted once more
+    bp->restore( info);
+    ASSERT_EQ( bp->get_bp_info( PC).history, history);
+
+    // history is restored on misprediction
+    for ( int i = 0; i < 10; ++i)
+        bp->predict( PC, BranchType::BRANCH);
+    bp->update( BPInterface( PC, !info.is_taken, 0x80, info.history, true));
+    ASSERT_EQ( bp->get_bp_info( PC).history, ( history << 1) | uint64{ !info.is_taken});
+
+    // unknown branches do not change history
+    bp->predict( 0x200, BranchType::BRANCH);
+    ASSERT_EQ( bp->get_bp_info( PC).history, ( history << 1) | uint64{ !info.is_taken});
+}
+
+TEST( StaticDispatch, Same_Predictions)
+{
+    BPFactory bp_factory;
+    const std::vector<bool> pattern = { true, false, true, true, false, false, true};
+    for ( const auto& mode : { "static_always_taken", "static_backward_jumps", "dynamic_one_bit", "dynamic_two_bit",
+                               "adaptive_two_level", "gshare", "hashed_perceptron", "tage"})
+    {
+        auto bp = bp_factory.create( mode, 128, 16, 32, "lru", 1024);
+        auto any = bp_factory.create_any( mode, 128, 16, 32, "lru", 1024);
+
+        // predictors selected at construction behave as the ones called through the base class
+        for ( uint32 i = 0; i < 100 * pattern.size(); ++i)
+        {
+            const Addr PC = 0x100 + 4 * ( i % 3);
+            const bool is_taken = pattern[ i % pattern.size()];
+            const auto info = bp->predict( PC, BranchType::BRANCH);
+            const auto other = std::visit( [PC]( auto& predictor) { return predictor.predict( PC, BranchType::BRANCH); }, any);
+            ASSERT_EQ( info.is_taken, other.is_taken) << mode;
+            ASSERT_EQ( info.target, other.target) << mode;
+
+            const BPInterface update( PC, is_taken, is_taken ? 0x80 : PC + 4, info.history, info.is_taken != is_taken);
+            bp->update( update);
+            std::visit( [&update]( auto& predictor) { predictor.update( update); }, any);
+        }
+    }
+}
+
+TEST( TwoBitCounters, Packed_As_States)
+{
+    // counters of different words and of the word boundary are not mixed
+    TwoBitCounters counters( 70);
+    std::vector<BPEntryTwoBit::State> states( 70);
+    ASSERT_EQ( counters.size(), 70u);
+
+    for ( uint32 i = 0; i < 2000; ++i)
+    {
+        const size_t index = ( i * 7) % 70;
+        const bool is_taken = ( i * 13) % 5 < 2 + index % 2;
+        ASSERT_EQ( counters.is_taken( index), states[ index].is_taken()) << i;
+        counters.update( index, is_taken);
+        states[ index].update( is_taken);
+    }
+
+    for ( size_t index = 0; index < states.size(); ++index)
+        ASSERT_EQ( counters.is_taken( index), states[ index].is_taken()) << index;
+}
+
+TEST( HotBranches, Exact_Counts)
+{
+    HotBranches branches( 4);
+    for ( uint32 i = 0; i < 100; ++i)
+    {
+        branches.update( 0x40, i % 4 != 0, i % 2 == 0);
+        branches.update( 0x80, true, i % 10 == 0);
+        branches.update( 0xc0, false, false);
+    }
+
+    // branches are tracked since their first misprediction
+    const auto top = branches.get_top( 3);
+    ASSERT_EQ( top.size(), 2u);
+    ASSERT_EQ( top[ 0].PC, 0x40u);
+    ASSERT_EQ( top[ 0].executions, 100u);
+    ASSERT_EQ( top[ 0].taken, 75u);
+    ASSERT_EQ( top[ 0].mispredictions, 50u);
+    ASSERT_EQ( top[ 0].error, 0u);
+    ASSERT_DOUBLE_EQ( top[ 0].get_taken_rate(), 0.75);
+    ASSERT_EQ( top[ 1].PC, 0x80u);
+    ASSERT_EQ( top[ 1].mispredictions, 10u);
+    ASSERT_EQ( branches.get_top( 1).size(), 1u);
+}
+
+TEST( HotBranches, Bounded_Table)
+{
+    // branches of more than total / capacity mispredictions survive a stream of branches mispredicted once
+    HotBranches branches( 8);
+    for ( uint32 i = 0; i < 10000; ++i)
+    {
+        branches.update( 0x1000, true, i % 2 == 0);
+        branches.update( 0x2000, true, i % 3 == 0);
+        branches.update( 0x3000 + i * 4, true, true);
+        ASSERT_LE( branches.size(), 8u);
+    }
+
+    // counts are overestimated by no more than the error
+    const auto top = branches.get_top( 2);
+    ASSERT_EQ( top[ 0].PC, 0x1000u);
+    ASSERT_GE( top[ 0].mispredictions, 5000u);
+    ASSERT_LE( top[ 0].mispredictions - top[ 0].error, 5000u);
+    ASSERT_EQ( top[ 1].PC, 0x2000u);
+    ASSERT_GE( top[ 1].mispredictions, 3334u);
+    ASSERT_LE( top[ 1].mispredictions - top[ 1].error, 3334u);
+
+    // replaced branches inherit the fewest mispredictions as the error
+    const auto all = branches.get_top( 8);
+    ASSERT_EQ( all.size(), 8u);
+    ASSERT_NE( all.back().error, 0u);
+    ASSERT_EQ( all.back().mispredictions, all.back().error + 1);
+}
+
+TEST( HotBranches, Disabled)
+{
+    HotBranches branches( 0);
+    branches.update( 0x40, true, true);
+    ASSERT_EQ( branches.size(), 0u);
+    ASSERT_TRUE( branches.get_top( 10).empty());
+}
+
+TEST( ReturnAddressStack, Overflow_And_Repair)
+{
+    ReturnAddressStack ras( 2);
+    ASSERT_FALSE( ras.pop().has_value());
+
+    // the oldest address is overwritten
+    ras.push( 0x10);
+    ras.push( 0x20);
+    const auto checkpoint = ras.checkpoint();
+    ras.push( 0x30);
+    ASSERT_EQ( ras.pop(), 0x30u);
+    ASSERT_EQ( ras.pop(), 0x20u);
+    ASSERT_FALSE( ras.pop().has_value());
+
+    ras.restore( checkpoint);
+    ASSERT_EQ( ras.pop(), 0x20u);
+
+    // top entry is restored after pop and push
+    ras.restore( checkpoint);
+    ras.pop();
+    ras.push( 0x40);
+    ras.restore( checkpoint);
+    ASSERT_EQ( ras.pop(), 0x20u);
+}
+
+// predicts and updates the jump, returns true on misprediction
+static bool run_jump( BaseBP* bp, Addr PC, BranchType type, Addr target)
+{
+    const auto info = bp->predict( PC, type);
+    const bool is_misprediction = !info.is_taken || info.target != target;
+    auto bp_upd = info;
+    bp_upd.is_taken = true;
+    bp_upd.target = target;
+    bp_upd.is_misprediction = is_misprediction;
+    bp_upd.type = type;
+    bp->update( bp_upd);
+    return is_misprediction;
+}
+
+TEST( TargetBP, Returns_To_Different_Call_Sites)
+{
+    BPFactory bp_factory;
+    TargetBP bp( bp_factory.create( "dynamic_two_bit", 128, 16), 16, 0);
+    auto btb_only = bp_factory.create( "dynamic_two_bit", 128, 16);
+
+    const Addr function = 0x2000;
+    const Addr ret = 0x2010;
+    uint32 mispredictions = 0;
+    uint32 btb_mispredictions = 0;
+    for ( int i = 0; i < 10; ++i)
+        for ( Addr call : { 0x1000u, 0x1100u, 0x1200u})
+        {
+            run_jump( &bp, call, BranchType::CALL, function);
+            mispredictions += run_jump( &bp, ret, BranchType::RETURN, call + 4) ? 1 : 0;
+
+            run_jump( btb_only.get(), call, BranchType::CALL, function);
+            btb_mispredictions += run_jump( btb_only.get(), ret, BranchType::RETURN, call + 4) ? 1 : 0;
+        }
+
+    ASSERT_EQ( mispredictions, 0u);
+    ASSERT_EQ( btb_mispredictions, 30u);
+}
+
+TEST( TargetBP, Repair_On_Misprediction)
+{
+    BPFactory bp_factory;
+    TargetBP bp( bp_factory.create( "dynamic_two_bit", 128, 16), 16, 0);
+
+    // call is not known by BTB yet
+    const auto call = bp.predict( 0x1000, BranchType::CALL);
+    ASSERT_FALSE( call.is_taken);
+
+    // the wrong path pops the stack
+    const auto wrong_return = bp.predict( 0x1004, BranchType::RETURN);
+    ASSERT_EQ( wrong_return.target, 0x1004u);
+
+    auto bp_upd = call;
+    bp_upd.is_taken = true;
+    bp_upd.target = 0x2000;
+    bp_upd.is_misprediction = true;
+    bp_upd.type = BranchType::CALL;
+    bp.update( bp_upd);
+
+    // stalled call is fetched again
+    const auto stalled_call = bp.predict( 0x1100, BranchType::CALL);
+    bp.restore( stalled_call);
+    ASSERT_EQ( bp.predict( 0x2010, BranchType::RETURN).target, 0x1004u);
+}
+
+TEST( TargetBP, Indirect_Targets_Depend_On_Path)
+{
+    BPFactory bp_factory;
+    TargetBP bp( bp_factory.create( "dynamic_two_bit", 128, 16), 0, 4096);
+    auto btb_only = bp_factory.create( "dynamic_two_bit", 128, 16);
+
+    // the target of indirect jump is defined by the previous jump
+    const Addr indirect = 0x3000;
+    uint32 mispredictions = 0;
+    uint32 btb_mispredictions = 0;
+    for ( int i = 0; i < 100; ++i)
+        for ( Addr target : { 0x4000u, 0x5000u, 0x6000u})
+        {
+            run_jump( &bp, target - 0x800, BranchType::BRANCH, 0x2f00);
+            run_jump( btb_only.get(), target - 0x800, BranchType::BRANCH, 0x2f00);
+            const bool is_misprediction = run_jump( &bp, indirect, BranchType::INDIRECT, target);
+            const bool is_btb_misprediction = run_jump( btb_only.get(), indirect, BranchType::INDIRECT, target);
+            if ( i >= 90)
+            {
+                mispredictions += is_misprediction ? 1 : 0;
+                btb_mispredictions += is_btb_misprediction ? 1 : 0;
+            }
+        }
+
+    ASSERT_EQ( mispredictions, 0u);
+    ASSERT_EQ( btb_mispredictions, 30u);
+}
+
 int main( int argc, char* argv[])
 {
     ::testing::InitGoogleTest( &argc, argv);
@@ -0,0 +1,245 @@
+/*
+ * target_predictor.cpp - return address stack and indirect target predictor
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+
+#include "folded_history.h"
+#include "target_predictor.h"
+
+static bool is_call( BranchType type)
+{
+    return type == BranchType::CALL || type == BranchType::INDIRECT_CALL;
+}
+
+static bool is_indirect( BranchType type)
+{
+    return type == BranchType::RETURN || type == BranchType::INDIRECT || type == BranchType::INDIRECT_CALL;
+}
+
+/* Return address stack */
+void ReturnAddressStack::push( Addr address)
+{
+    if ( stack.empty())
+        return;
+
+    top = ( top + 1) % stack.size();
+    stack[ top] = address;
+    size = std::min<uint32>( size + 1, static_cast<uint32>( stack.size()));
+}
+
+std::optional<Addr> ReturnAddressStack::pop()
+{
+    if ( size == 0)
+        return std::nullopt;
+
+    const auto address = stack[ top];
+    top = static_cast<uint32>( ( top + stack.size() - 1) % stack.size());
+    --size;
+    return address;
+}
+
+void ReturnAddressStack::restore( const RASCheckpoint& state)
+{
+    if ( stack.empty())
+        return;
+
+    // the top entry may be overwritten by pop and push after the checkpoint
+    top = state.top;
+    size = state.size;
+    stack[ top] = state.value;
+}
+
+/* ITTAGE */
+ITTAGE::ITTAGE( uint32 size_in_bytes)
+    // entries take 8 bytes
+    : tables( history_lengths.size() * floor_power_of_two( size_in_bytes / ( history_lengths.size() * 8)))
+    , table_size( floor_power_of_two( size_in_bytes / ( history_lengths.size() * 8)))
+    , index_bits( log_2( table_size))
+{ }
+
+uint64 ITTAGE::update_history( uint64 history, Addr PC, Addr target)
+{
+    return ( history << 2) | fold_history( ( PC ^ target) >> 2, 30, 2);
+}
+
+ITTAGE::Lookup ITTAGE::lookup( Addr PC, uint64 history) const
+{
+    Lookup result;
+    for ( size_t i = 0; i < history_lengths.size(); ++i)
+    {
+        const auto length = history_lengths[ i];
+        const uint32 hash = ( PC >> 2) ^ ( PC >> ( 2 + index_bits)) ^ fold_history( history, length, index_bits);
+        result.indices[ i] = hash & bitmask<uint32>( index_bits);
+        result.tags[ i] = static_cast<uint16>( ( ( PC >> 2) ^ fold_history( history, length, tag_bits)
+                                                 ^ ( fold_history( history, length, tag_bits - 1) << 1)) & bitmask<uint32>( tag_bits));
+    }
+
+    // the longest history match provides the prediction
+    for ( size_t i = history_lengths.size(); i-- > 0;)
+    {
+        const auto& candidate = entry( i, result.indices[ i]);
+        if ( !candidate.is_valid || candidate.tag != result.tags[ i])
+            continue;
+
+        if ( result.provider == no_table)
+        {
+            result.provider = i;
+        }
+        else
+        {
+            result.alternate = i;
+            break;
+        }
+    }
+
+    return result;
+}
+
+std::optional<Addr> ITTAGE::predict( Addr PC, uint64 history) const
+{
+    const auto result = lookup( PC, history);
+    if ( result.provider == no_table)
+        return std::nullopt;
+
+    // target of the provider is not trusted until it is confirmed
+    const auto& provider = entry( result.provider, result.indices[ result.provider]);
+    if ( provider.confidence == 0 && result.alternate != no_table)
+        return entry( result.alternate, result.indices[ result.alternate]).target;
+
+    return provider.target;
+}
+
+void ITTAGE::allocate( const Lookup& result, Addr target)
+{
+    const size_t first = result.provider == no_table ? 0 : result.provider + 1;
+    for ( size_t i = first; i < history_lengths.size(); ++i)
+    {
+        auto& candidate = entry( i, result.indices[ i]);
+        if ( !candidate.is_valid || candidate.useful == 0)
+        {
+            candidate = { target, result.tags[ i], 0, 0, true};
+            return;
+        }
+    }
+
+    // no free entries, make them older
+    for ( size_t i = first; i < history_lengths.size(); ++i)
+    {
+        auto& candidate = entry( i, result.indices[ i]);
+        candidate.useful = static_cast<uint8>( candidate.useful > 0 ? candidate.useful - 1 : 0);
+    }
+}
+
+void ITTAGE::update( Addr PC, uint64 history, Addr target, bool is_misprediction)
+{
+    const auto result = lookup( PC, history);
+    bool is_correct = false;
+
+    if ( result.provider != no_table)
+    {
+        auto& provider = entry( result.provider, result.indices[ result.provider]);
+        is_correct = provider.target == target;
+
+        if ( result.alternate != no_table && entry( result.alternate, result.indices[ result.alternate]).target != provider.target)
+        {
+            if ( is_correct)
+                provider.useful = static_cast<uint8>( std::min<int>( provider.useful + 1, max_useful));
+            else
+                provider.useful = static_cast<uint8>( provider.useful > 0 ? provider.useful - 1 : 0);
+        }
+
+        if ( is_correct)
+            provider.confidence = static_cast<uint8>( std::min<int>( provider.confidence + 1, max_confidence));
+        else if ( provider.confidence > 0)
+            --provider.confidence;
+        else
+            provider.target = target;
+    }
+
+    if ( is_misprediction && !is_correct)
+        allocate( result, target);
+}
+
+/* Target predictors */
+TargetPredictors::TargetPredictors( uint32 ras_size, uint32 ittage_size_in_bytes)
+    : ras( ras_size)
+    , ittage( ittage_size_in_bytes != 0 ? std::make_unique<ITTAGE>( ittage_size_in_bytes) : nullptr)
+{ }
+
+void TargetPredictors::predict( BPInterface* info, Addr PC, BranchType type)
+{
+    info->type = type;
+    info->ras = ras.checkpoint();
+    info->path_history = path_history;
+
+    std::optional<Addr> target = std::nullopt;
+    if ( type == BranchType::RETURN)
+        target = ras.pop();
+    if ( !target.has_value() && ittage != nullptr && is_indirect( type))
+        target = ittage->predict( PC, path_history);
+
+    if ( target.has_value())
+    {
+        info->is_taken = true;
+        info->target = *target;
+    }
+
+    if ( is_call( type))
+        ras.push( PC + 4);
+
+    if ( info->is_taken && type != BranchType::NONE)
+        path_history = ITTAGE::update_history( path_history, PC, info->target);
+}
+
+void TargetPredictors::restore( const BPInterface& prediction)
+{
+    ras.restore( prediction.ras);
+    path_history = prediction.path_history;
+}
+
+void TargetPredictors::update( const BPInterface& bp_upd)
+{
+    if ( ittage != nullptr && is_indirect( bp_upd.type))
+        ittage->update( bp_upd.pc, bp_upd.path_history, bp_upd.target, bp_upd.is_misprediction);
+
+    if ( !bp_upd.is_misprediction)
+        return;
+
+    // younger predictions are flushed, so the state after the jump is restored
+    ras.restore( bp_upd.ras);
+    if ( bp_upd.type == BranchType::RETURN)
+        ras.pop();
+    if ( is_call( bp_upd.type))
+        ras.push( bp_upd.pc + 4);
+
+    path_history = bp_upd.path_history;
+    if ( bp_upd.is_taken)
+        path_history = ITTAGE::update_history( path_history, bp_upd.pc, bp_upd.target);
+}
+
+/* Branch predictor with target predictors */
+TargetBP::TargetBP( std::unique_ptr<BaseBP> bp, uint32 ras_size, uint32 ittage_size_in_bytes)
+    : bp( std::move( bp))
+    , targets( ras_size, ittage_size_in_bytes)
+{ }
+
+BPInterface TargetBP::predict( Addr PC, BranchType type)
+{
+    auto info = bp->predict( PC, type);
+    targets.predict( &info, PC, type);
+    return info;
+}
+
+void TargetBP::restore( const BPInterface& prediction)
+{
+    bp->restore( prediction);
+    targets.restore( prediction);
+}
+
+void TargetBP::update( const BPInterface& bp_upd)
+{
+    bp->update( bp_upd);
+    targets.update( bp_upd);
+}
@@ -0,0 +1,126 @@
+/*
+ * target_predictor.h - return address stack and indirect target predictor
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef TARGET_PREDICTOR_H
+#define TARGET_PREDICTOR_H
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <infra/types.h>
+
+#include "bpu.h"
+
+/* Circular stack of return addresses, the oldest entries are overwritten on overflow */
+class ReturnAddressStack
+{
+public:
+    explicit ReturnAddressStack( uint32 size) : stack( size, NO_VAL32) { }
+
+    void push( Addr address);
+    std::optional<Addr> pop();
+
+    RASCheckpoint checkpoint() const { return { top, size, stack.empty() ? NO_VAL32 : stack[ top]}; }
+    void restore( const RASCheckpoint& state);
+
+private:
+    std::vector<Addr> stack;
+    uint32 top = 0;
+    uint32 size = 0;
+};
+
+/* ITTAGE: tagged tables of targets indexed by geometrically
+ * increasing lengths of the path history
+ */
+class ITTAGE
+{
+public:
+    explicit ITTAGE( uint32 size_in_bytes);
+
+    std::optional<Addr> predict( Addr PC, uint64 history) const;
+    void update( Addr PC, uint64 history, Addr target, bool is_misprediction);
+
+    // two bits of each taken jump are shifted into path history
+    static uint64 update_history( uint64 history, Addr PC, Addr target);
+
+private:
+    static constexpr const std::array<uint32, 5> history_lengths = {{ 0, 8, 16, 32, 64}};
+    static constexpr const uint32 tag_bits = 10;
+    static constexpr const uint8 max_confidence = 3;
+    static constexpr const uint8 max_useful = 3;
+    static constexpr const size_t no_table = history_lengths.size();
+
+    struct Entry
+    {
+        Addr target = NO_VAL32;
+        uint16 tag = 0;
+        uint8 confidence = 0; // 2-bit counter of correct predictions
+        uint8 useful = 0;     // 2-bit usefulness counter
+        bool is_valid = false;
+    };
+
+    struct Lookup
+    {
+        std::array<uint32, history_lengths.size()> indices = {{}};
+        std::array<uint16, history_lengths.size()> tags = {{}};
+        size_t provider = no_table;
+        size_t alternate = no_table;
+    };
+
+    Entry& entry( size_t table, uint32 index) { return tables[ table * table_size + index]; }
+    const Entry& entry( size_t table, uint32 index) const { return tables[ table * table_size + index]; }
+    Lookup lookup( Addr PC, uint64 history) const;
+    void allocate( const Lookup& result, Addr target);
+
+    std::vector<Entry> tables; // tagged tables one after another
+    const uint32 table_size;
+    const uint32 index_bits;
+};
+
+/* Return address stack and indirect target predictor refining predictions
+ * of the underlying predictor, directions and targets of other jumps are kept.
+ * The state before each prediction is recorded in the instruction,
+ * so it is restored when the instruction is mispredicted.
+ */
+class TargetPredictors
+{
+public:
+    // zero sizes disable the stack or the indirect predictor
+    TargetPredictors( uint32 ras_size, uint32 ittage_size_in_bytes);
+
+    void predict( BPInterface* info, Addr PC, BranchType type);
+    void restore( const BPInterface& prediction);
+    void update( const BPInterface& bp_upd);
+
+private:
+    ReturnAddressStack ras;
+    std::unique_ptr<ITTAGE> ittage;
+    uint64 path_history = 0;
+};
+
+/* Branch predictor with target predictors over the underlying predictor */
+class TargetBP final : public BaseBP
+{
+public:
+    TargetBP( std::unique_ptr<BaseBP> bp, uint32 ras_size, uint32 ittage_size_in_bytes);
+
+    bool is_taken( Addr PC) const final { return bp->is_taken( PC); }
+    Addr get_target( Addr PC) const final { return bp->get_target( PC); }
+    BPInterface get_bp_info( Addr PC) const final { return bp->get_bp_info( PC); }
+
+    BPInterface predict( Addr PC, BranchType type) final;
+    void restore( const BPInterface& prediction) final;
+    void update( const BPInterface& bp_upd) final;
+
+    void register_stats( StatsRegistry* stats, const std::string& prefix) const final { bp->register_stats( stats, prefix); }
+
+private:
+    std::unique_ptr<BaseBP> bp;
+    TargetPredictors targets;
+};
+
+#endif
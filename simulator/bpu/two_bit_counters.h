@@ -0,0 +1,59 @@
+/*
+ * two_bit_counters.h - table of two-bit saturating counters packed into words
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef TWO_BIT_COUNTERS_H
+#define TWO_BIT_COUNTERS_H
+
+#include <vector>
+
+#include <infra/types.h>
+
+/* Counters behave as BPEntryTwoBit::State: they start weakly not taken
+ * and predict taken in two upper states. 32 counters share a 64-bit word,
+ * so large tables take as much memory as the modeled storage.
+ */
+class TwoBitCounters
+{
+public:
+    explicit TwoBitCounters( size_t size)
+        : words( ( size + COUNTERS_PER_WORD - 1) / COUNTERS_PER_WORD, WEAKLY_NOT_TAKEN_WORD)
+        , count( size)
+    { }
+
+    size_t size() const { return count; }
+
+    bool is_taken( size_t index) const { return get( index) >= WEAKLY_TAKEN; }
+
+    void update( size_t index, bool is_taken)
+    {
+        const auto value = get( index);
+        if ( is_taken && value != TAKEN)
+            set( index, value + 1);
+        else if ( !is_taken && value != NOT_TAKEN)
+            set( index, value - 1);
+    }
+
+private:
+    static constexpr const size_t COUNTERS_PER_WORD = 32;
+    static constexpr const uint64 WEAKLY_NOT_TAKEN_WORD = 0x5555'5555'5555'5555ull;
+    static constexpr const uint64 NOT_TAKEN = 0;
+    static constexpr const uint64 WEAKLY_TAKEN = 2;
+    static constexpr const uint64 TAKEN = 3;
+
+    static size_t shift( size_t index) { return ( index % COUNTERS_PER_WORD) * 2; }
+
+    uint64 get( size_t index) const { return ( words[ index / COUNTERS_PER_WORD] >> shift( index)) & TAKEN; }
+
+    void set( size_t index, uint64 value)
+    {
+        auto& word = words[ index / COUNTERS_PER_WORD];
+        word = ( word & ~( TAKEN << shift( index))) | ( value << shift( index));
+    }
+
+    std::vector<uint64> words;
+    const size_t count;
+};
+
+#endif // TWO_BIT_COUNTERS_H
@@ -11,8 +11,14 @@
 
 
 #include <array>
+#include <bitset>
+#include <cassert>
+#include <string>
+#include <vector>
 
 #include <core/perf_instr.h>
+#include <infra/ports/timing.h>
+#include <infra/stats/stats.h>
 
 
 class RegisterStage
@@ -25,21 +31,17 @@ class RegisterStage
 
         void inc() { ++value; }
 
-        static constexpr const uint8 BYPASSING_STAGES_NUMBER = 3;        
         static constexpr RegisterStage in_RF() { return RegisterStage( IN_RF_STAGE_VALUE); }
 
-        auto is_writeback() const { return value == WRITEBACK_STAGE_VALUE; }
-
     private:
-        uint8 value = 0;  // distance from first execute stage
+        uint8 value = 0;  // distance from last execute stage
                 
-        // EXECUTE   - 0  | Bypassing stage
-        // MEMORY    - 1  | Bypassing stage
-        // WRITEBACK - 2  | Bypassing stage
+        // EXECUTE   - 0            | Bypassing stage
+        // MEMORY    - 1 ... M      | Bypassing stage for each of M memory sub-stages
+        // WRITEBACK - M + 1        | Bypassing stage
         // IN_RF     - MAX_VAL8
 
         static constexpr const uint8 IN_RF_STAGE_VALUE = MAX_VAL8;
-        static constexpr const uint8 WRITEBACK_STAGE_VALUE = 2;
 };
 
 
@@ -60,22 +62,58 @@ class DataBypass
     using RegDstUInt = typename ISA::RegDstUInt;
 
     public:
+        explicit DataBypass( uint32 memory_stages = 1)
+            : memory_stages( static_cast<uint8>( memory_stages))
+            , writeback_stage( static_cast<uint8>( memory_stages + 1))
+            , bypasses( memory_stages + 2)
+        { }
+
         class BypassCommand
         {
             public:
-                BypassCommand( RegisterStage bypassing_stage, Register register_num)
+                BypassCommand( RegisterStage bypassing_stage, Register register_num, uint8 slot)
                     : bypassing_stage( bypassing_stage)
                     , register_num( register_num)
+                    , slot( slot)
                 { }
 
                 auto get_bypassing_stage() const { return bypassing_stage; }
                 auto get_register_num() const { return register_num; }
+                auto get_slot() const { return slot; }
 
             private:
                 const RegisterStage bypassing_stage;
                 const Register register_num;
+                const uint8 slot; // position of producer in the bundle of its stage
         };
 
+        // names the port of bypass commands for a source register of the instruction in the slot
+        static std::string get_command_port_name( uint32 slot, uint8 src_index)
+        {
+            const std::string name = "DECODE_2_EXECUTE_SRC" + std::to_string( src_index + 1) + "_COMMAND";
+            return slot == 0 ? name : name + "_" + std::to_string( slot);
+        }
+
+        // bypassing stages are execute, each of memory sub-stages and writeback
+        size_t get_bypassing_stages_number() const { return bypasses.size(); }
+
+        // names the port of data bypassed from the stage
+        static std::string get_bypass_port_name( uint8 stage, uint32 memory_stages)
+        {
+            if ( stage == 0)
+                return "EXECUTE_2_EXECUTE_BYPASS";
+            if ( stage > memory_stages)
+                return "WRITEBACK_2_EXECUTE_BYPASS";
+            return stage == 1 ? "MEMORY_2_EXECUTE_BYPASS" : "MEMORY" + std::to_string( stage) + "_2_EXECUTE_BYPASS";
+        }
+
+        // memory stage writes data of all its sub-stages at the first one,
+        // so they arrive after the number of the sub-stage
+        static Latency get_bypass_latency( uint8 stage, uint32 memory_stages)
+        {
+            return stage == 0 || stage > memory_stages ? PORT_LATENCY : Latency( stage);
+        }
+
         // checks whether the source register of passed instruction is in RF  
         auto is_in_RF( const Instr& instr, uint8 src_index) const
         {
@@ -90,19 +128,24 @@ class DataBypass
             return get_entry( reg_num).is_bypassible;
         }
 
-        // checks if the stall needed for passed instruction
+        // checks if the stall needed for passed instruction,
+        // results of older instructions of the same bundle can not be bypassed
         auto is_stall( const Instr& instr) const
         {
             return ( (!is_in_RF( instr, 0) && !is_bypassible( instr, 0)) ||
-                     (!is_in_RF( instr, 1) && !is_bypassible( instr, 1)) );
+                     (!is_in_RF( instr, 1) && !is_bypassible( instr, 1)) ||
+                     is_issued_in_bundle( instr.get_src_num( 0)) ||
+                     is_issued_in_bundle( instr.get_src_num( 1)) );
         }
 
         // returns bypass command for passed instruction and its source register
-        // in accordance with current state of the scoreboard
-        auto get_bypass_command( const Instr& instr, uint8 src_index) const
+        // in accordance with current state of the scoreboard, the command is counted by its stage
+        auto get_bypass_command( const Instr& instr, uint8 src_index)
         {
             const auto reg_num = instr.get_src_num( src_index);
-            return BypassCommand( get_current_stage( reg_num), reg_num);
+            const auto stage = get_current_stage( reg_num);
+            ++bypasses.at( static_cast<uint8>( stage));
+            return BypassCommand( stage, reg_num, get_entry( reg_num).slot);
         }
 
         // returns an index of the port where bypassed data should be get from
@@ -116,14 +159,33 @@ class DataBypass
         // transforms bypassed data if needed in accordance with passed bypass command
         static RegDstUInt adapt_bypassed_data( const BypassCommand& bypass_command, RegDstUInt bypassed_data);
 
-        // introduces new instruction to bypassing unit
-        void trace_new_instr( const Instr& instr);
+        // introduces new instruction to bypassing unit at its first execute cycle,
+        // slot is its position in the bundle leaving execute stage after the latency
+        void trace_new_instr( const Instr& instr, uint8 slot = 0, Latency latency = 1_Lt);
+
+        // remembers the instruction issued in the current cycle,
+        // so the younger ones of its bundle depending on it are stalled
+        void issue_in_bundle( const Instr& instr);
 
         // updates the scoreboard
         void update();
 
+        // checks whether updates of the scoreboard do not change it
+        bool is_idle() const { return traced_count == 0; }
+
         // removes the information about passed instruction from the scoreboard
         void untrace_instr( const Instr& instr);
+
+        // bypassed operands are counted as "<prefix>.execute", "<prefix>.memory" and "<prefix>.writeback",
+        // memory sub-stages of a deeper pipeline are "<prefix>.memory1", "<prefix>.memory2" and so on
+        void register_stats( StatsRegistry* stats, const std::string& prefix) const
+        {
+            stats->add_counter( prefix + ".execute", &bypasses[ 0]);
+            for ( uint8 stage = 1; stage <= memory_stages; ++stage)
+                stats->add_counter( prefix + ".memory" + ( memory_stages == 1 ? "" : std::to_string( stage)),
+                                    &bypasses[ stage]);
+            stats->add_counter( prefix + ".writeback", &bypasses[ writeback_stage]);
+        }
     
     private:
         struct RegisterInfo
@@ -132,18 +194,49 @@ class DataBypass
             RegisterStage ready_stage = RegisterStage::in_RF();
             bool is_bypassible = false;
             bool is_traced = false;
+            uint8 slot = 0;
+            uint8 execute_cycles_left = 0; // the value is not bypassed out of execute stage yet
+            uint16 older_cycles_left = 0; // an older producer of the register writes it back after this number of cycles
+            size_t traced_position = 0; // index in the list of traced registers
+
+            uint16 get_cycles_to_RF( RegisterStage writeback_stage) const
+            {
+                return static_cast<uint16>( execute_cycles_left + static_cast<uint8>( writeback_stage)
+                                            - static_cast<uint8>( current_stage) + 1);
+            }
         };
 
         std::array<RegisterInfo, Register::MAX_REG> scoreboard = {};
 
+        // registers in flight, so updates do not walk the whole scoreboard
+        std::array<size_t, Register::MAX_REG> traced_registers = {{}};
+        size_t traced_count = 0;
+
+        const uint8 memory_stages;
+        const uint8 writeback_stage;
+
+        // operands bypassed from each stage
+        std::vector<uint64> bypasses;
+
+        // destinations of instructions issued in the current cycle
+        std::bitset<Register::MAX_REG> bundle_destinations = {};
+
+        bool is_issued_in_bundle( Register num) const
+        {
+            return !num.is_zero() && bundle_destinations.test( num.to_size_t());
+        }
+
+        // registers are valid by construction, so they are checked in debug builds only
         RegisterInfo& get_entry( Register num)
         {
-            return scoreboard.at( num.to_size_t());
+            assert( num.to_size_t() < scoreboard.size());
+            return scoreboard[ num.to_size_t()];
         }
 
         const RegisterInfo& get_entry( Register num) const
         {
-            return scoreboard.at( num.to_size_t());
+            assert( num.to_size_t() < scoreboard.size());
+            return scoreboard[ num.to_size_t()];
         }
 
         // returns current stage of passed register
@@ -154,16 +247,40 @@ class DataBypass
         }
 
         // introduces a source register of a passed instruction to scoreboard 
-        void trace_new_register( const Instr& instr, Register num);
+        void trace_new_register( const Instr& instr, Register num, uint8 slot, Latency latency);
 
-        // discards the information about passed register
+        // discards the information about passed register,
+        // flushed producers may overwrite the older ones which are still in flight in a deep pipeline,
+        // so the register is not read until they write it back
         void untrace_register( Register num)
         {
             auto& entry = get_entry( num);
+            if ( entry.older_cycles_left > 0)
+            {
+                assert( entry.older_cycles_left <= MAX_VAL8);
+                entry.current_stage = RegisterStage( writeback_stage);
+                entry.ready_stage = RegisterStage::in_RF();
+                entry.is_bypassible = false;
+                entry.execute_cycles_left = static_cast<uint8>( entry.older_cycles_left - 1);
+                return;
+            }
+
+            if ( entry.is_traced)
+                remove_traced( entry);
 
             entry.current_stage = RegisterStage::in_RF();
             entry.is_bypassible = false;
             entry.is_traced = false; 
+            entry.execute_cycles_left = 0;
+        }
+
+        // the last traced register takes the place of the removed one
+        void remove_traced( const RegisterInfo& entry)
+        {
+            assert( traced_count > 0);
+            const auto last = traced_registers[ --traced_count];
+            traced_registers[ entry.traced_position] = last;
+            scoreboard[ last].traced_position = entry.traced_position;
         }
 };
 
@@ -184,25 +301,34 @@ typename ISA::RegDstUInt DataBypass<ISA>::adapt_bypassed_data( const BypassComma
 
 
 template <typename ISA>
-void DataBypass<ISA>::trace_new_register( const Instr& instr, Register num)
+void DataBypass<ISA>::trace_new_register( const Instr& instr, Register num, uint8 slot, Latency latency)
 {
     auto& entry = get_entry( num);
+    entry.slot = slot;
+    entry.older_cycles_left = entry.is_traced ? entry.get_cycles_to_RF( RegisterStage( writeback_stage)) : 0;
 
-    entry.current_stage = 0_RSG; // first execute stage
+    // the stages are counted from the last execute cycle of multi-cycle units
+    entry.current_stage = 0_RSG;
+    entry.execute_cycles_left = static_cast<uint8>( latency.to_size_t() - 1);
 
     if ( !instr.is_bypassible())
         entry.ready_stage = RegisterStage::in_RF();
     else
-        entry.ready_stage = instr.is_load() ? 1_RSG  // MEMORY
-                                            : 0_RSG; // EXECUTE
+        entry.ready_stage = instr.is_load() ? RegisterStage( memory_stages) // the last MEMORY sub-stage
+                                            : 0_RSG;                        // EXECUTE
 
-    entry.is_bypassible = ( entry.current_stage == entry.ready_stage);
+    entry.is_bypassible = entry.execute_cycles_left == 0 && entry.current_stage == entry.ready_stage;
+    if ( !entry.is_traced)
+    {
+        entry.traced_position = traced_count;
+        traced_registers[ traced_count++] = num.to_size_t();
+    }
     entry.is_traced = true;
 }
 
 
 template <typename ISA>
-void DataBypass<ISA>::trace_new_instr( const Instr& instr)
+void DataBypass<ISA>::trace_new_instr( const Instr& instr, uint8 slot, Latency latency)
 {    
     const auto dst_reg_num = instr.get_dst_num();
 
@@ -211,35 +337,59 @@ void DataBypass<ISA>::trace_new_instr( const Instr& instr)
     
     if ( dst_reg_num.is_mips_hi_lo())
     {
-        trace_new_register( instr, Register::mips_lo );
-        trace_new_register( instr, Register::mips_hi );
+        trace_new_register( instr, Register::mips_lo, slot, latency);
+        trace_new_register( instr, Register::mips_hi, slot, latency);
         return;
     }
 
-    trace_new_register( instr, dst_reg_num);
+    trace_new_register( instr, dst_reg_num, slot, latency);
+}
+
+
+template <typename ISA>
+void DataBypass<ISA>::issue_in_bundle( const Instr& instr)
+{
+    const auto dst_reg_num = instr.get_dst_num();
+    bundle_destinations.set( dst_reg_num.to_size_t());
+
+    if ( dst_reg_num.is_mips_hi_lo())
+    {
+        bundle_destinations.set( Register::mips_lo.to_size_t());
+        bundle_destinations.set( Register::mips_hi.to_size_t());
+    }
 }
 
 
 template <typename ISA>
 void DataBypass<ISA>::update()
 {
-    for ( auto& entry:scoreboard)
+    bundle_destinations.reset();
+
+    // the registers written back are removed from the list, so it is walked from its end
+    for ( size_t i = traced_count; i > 0; --i)
     {
-        if ( entry.is_traced)
+        auto& entry = scoreboard[ traced_registers[ i - 1]];
+        if ( entry.older_cycles_left > 0)
+            --entry.older_cycles_left;
+
+        if ( entry.execute_cycles_left > 0)
         {
-            if ( entry.current_stage.is_writeback())
-            {
-                entry.current_stage = RegisterStage::in_RF();
-                entry.is_bypassible = false;
-                entry.is_traced = false;
-            }
-            else
-            {
-                entry.current_stage.inc();
+            --entry.execute_cycles_left;
+            entry.is_bypassible = entry.execute_cycles_left == 0 && entry.current_stage == entry.ready_stage;
+        }
+        else if ( entry.current_stage == RegisterStage( writeback_stage))
+        {
+            remove_traced( entry);
+            entry.current_stage = RegisterStage::in_RF();
+            entry.is_bypassible = false;
+            entry.is_traced = false;
+        }
+        else
+        {
+            entry.current_stage.inc();
 
-                if ( entry.current_stage == entry.ready_stage)
-                    entry.is_bypassible = true;   
-            }
+            if ( entry.current_stage == entry.ready_stage)
+                entry.is_bypassible = true;   
         }
     }
 }
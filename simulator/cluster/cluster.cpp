@@ -0,0 +1,377 @@
+/*
+ * cluster.cpp - sweep of performance simulation distributed to worker processes
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <thread>
+
+#include <boost/asio.hpp>
+
+#include <api/simulation.h>
+#include <infra/string/csv.h>
+
+#include "cluster.h"
+
+namespace asio = boost::asio;
+using Tcp = asio::ip::tcp;
+
+// empty fields are kept, e.g. the checkpoint of a job starting from the beginning
+static std::vector<std::string> split_fields( const std::string& line)
+{
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for ( size_t end = line.find( '\t'); end != std::string::npos; end = line.find( '\t', start))
+    {
+        fields.push_back( line.substr( start, end - start));
+        start = end + 1;
+    }
+    fields.push_back( line.substr( start));
+    return fields;
+}
+
+static bool parse_number( const std::string& field, uint64* value)
+{
+    try {
+        size_t length = 0;
+        *value = std::stoull( field, &length);
+        return length == field.size();
+    }
+    catch ( const std::logic_error&) {
+        return false;
+    }
+}
+
+struct Coordinator::Server
+{
+    asio::io_context io;
+    Tcp::acceptor acceptor{ io};
+    std::vector<std::weak_ptr<Session>> sessions = {};
+};
+
+// Connection of a worker, it waits for a line and writes the reply
+class Coordinator::Session : public std::enable_shared_from_this<Session>
+{
+public:
+    Session( Coordinator* coordinator, Tcp::socket socket) : coordinator( coordinator), socket( std::move( socket)) { }
+
+    void read()
+    {
+        asio::async_read_until( socket, buffer, '\n', [self = shared_from_this()]( const boost::system::error_code& error, size_t) {
+            if ( error)
+            {
+                self->lose();
+                return;
+            }
+
+            std::istream in( &self->buffer);
+            std::string line;
+            std::getline( in, line);
+            bool is_last = false;
+            auto reply = self->coordinator->handle( self.get(), line, &is_last);
+            self->write( std::move( reply), is_last);
+        });
+    }
+
+    void close()
+    {
+        boost::system::error_code error;
+        socket.close( error);
+    }
+
+    size_t job = NO_JOB;
+
+private:
+    void write( std::string text, bool is_last)
+    {
+        auto data = std::make_shared<std::string>( std::move( text));
+        asio::async_write( socket, asio::buffer( *data), [self = shared_from_this(), data, is_last]( const boost::system::error_code& error, size_t) {
+            if ( error)
+                self->lose();
+            else if ( is_last)
+                self->close();
+            else
+                self->read();
+        });
+    }
+
+    void lose()
+    {
+        coordinator->release( this);
+        close();
+    }
+
+    Coordinator* const coordinator;
+    Tcp::socket socket;
+    asio::streambuf buffer;
+};
+
+Coordinator::Coordinator( const std::vector<Sweep::Point>& points, const std::vector<std::string>& checkpoints,
+                          std::string isa, uint64 instrs_to_run)
+    : isa( std::move( isa))
+    , instrs_to_run( instrs_to_run)
+    , server( std::make_unique<Server>())
+{
+    const auto& starts = checkpoints.empty() ? std::vector<std::string>{ ""} : checkpoints;
+    for ( const auto& point : points)
+        for ( const auto& checkpoint : starts)
+            jobs.push_back( { point, checkpoint});
+
+    results.assign( jobs.size(), Result());
+    copies.assign( jobs.size(), 0);
+    for ( size_t i = 0; i < jobs.size(); ++i)
+        pending.push_back( i);
+}
+
+Coordinator::~Coordinator() = default;
+
+uint16 Coordinator::listen( uint16 port)
+{
+    try {
+        const Tcp::endpoint endpoint( Tcp::v4(), port);
+        server->acceptor.open( endpoint.protocol());
+        server->acceptor.set_option( Tcp::acceptor::reuse_address( true));
+        server->acceptor.bind( endpoint);
+        server->acceptor.listen();
+    }
+    catch ( const boost::system::system_error& e) {
+        std::cerr << "ERROR. Could not listen at port " << port << ": " << e.what() << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    return server->acceptor.local_endpoint().port();
+}
+
+void Coordinator::serve()
+{
+    if ( !server->acceptor.is_open())
+    {
+        std::cerr << "ERROR. Coordinator does not listen for workers" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    if ( done_jobs == jobs.size())
+        return;
+
+    accept();
+    server->io.run();
+}
+
+void Coordinator::accept()
+{
+    server->acceptor.async_accept( [this]( const boost::system::error_code& error, Tcp::socket socket) {
+        // the acceptor is closed when all the jobs are done
+        if ( error)
+            return;
+
+        auto session = std::make_shared<Session>( this, std::move( socket));
+        server->sessions.push_back( session);
+        session->read();
+        accept();
+    });
+}
+
+std::string Coordinator::handle( Session* session, const std::string& line, bool* is_last)
+{
+    const auto fields = split_fields( line);
+    if ( fields.size() == 1 && fields[ 0] == "READY" && session->job == NO_JOB)
+        return "SIM\t" + isa + "\t" + std::to_string( instrs_to_run) + "\n" + assign( session, is_last);
+
+    Result result;
+    if ( fields.size() == 4 && fields[ 0] == "RESULT" && session->job != NO_JOB && fields[ 1] == std::to_string( session->job)
+        && parse_number( fields[ 2], &result.executed_instrs) && parse_number( fields[ 3], &result.cycles))
+    {
+        // the first result of duplicated job is taken
+        if ( !results[ session->job].is_done)
+        {
+            result.is_done = true;
+            results[ session->job] = result;
+            ++done_jobs;
+        }
+        release( session);
+        if ( done_jobs == jobs.size())
+            finish( session);
+        return assign( session, is_last);
+    }
+
+    std::cerr << "Worker is disconnected after invalid message \"" << line << "\"" << std::endl;
+    release( session);
+    *is_last = true;
+    return "";
+}
+
+std::string Coordinator::assign( Session* session, bool* is_last)
+{
+    if ( done_jobs == jobs.size())
+    {
+        *is_last = true;
+        return "DONE\n";
+    }
+
+    // all the jobs are running, so a copy of the least copied one replaces a possible straggler
+    size_t job = NO_JOB;
+    if ( !pending.empty())
+    {
+        job = pending.front();
+        pending.pop_front();
+    }
+    else
+    {
+        for ( size_t i = 0; i < jobs.size(); ++i)
+            if ( !results[ i].is_done && ( job == NO_JOB || copies[ i] < copies[ job]))
+                job = i;
+    }
+
+    ++copies[ job];
+    ++assignments;
+    session->job = job;
+
+    std::string line = "JOB\t" + std::to_string( job) + "\t" + jobs[ job].checkpoint;
+    for ( const auto& option : jobs[ job].point)
+        line += "\t" + option.first + "=" + option.second;
+    return line + "\n";
+}
+
+void Coordinator::release( Session* session)
+{
+    if ( session->job == NO_JOB)
+        return;
+
+    // job of a lost worker goes first to the next one
+    const auto job = session->job;
+    session->job = NO_JOB;
+    if ( --copies[ job] == 0 && !results[ job].is_done)
+        pending.push_front( job);
+}
+
+void Coordinator::finish( const Session* last)
+{
+    // workers running copies of the done jobs are disconnected
+    boost::system::error_code error;
+    server->acceptor.close( error);
+    for ( const auto& weak_session : server->sessions)
+    {
+        const auto session = weak_session.lock();
+        if ( session != nullptr && session.get() != last)
+            session->close();
+    }
+}
+
+void Coordinator::dump_csv( std::ostream& out) const
+{
+    std::set<std::string> options;
+    for ( const auto& job : jobs)
+        for ( const auto& value : job.point)
+            options.insert( value.first);
+
+    for ( const auto& option : options)
+        out << csv_field( option) << ',';
+    out << "checkpoint,instrs,cycles,ipc" << std::endl;
+
+    for ( size_t i = 0; i < jobs.size(); ++i)
+    {
+        for ( const auto& option : options)
+        {
+            const auto it = jobs[ i].point.find( option);
+            out << ( it == jobs[ i].point.end() ? "" : csv_field( it->second)) << ',';
+        }
+
+        const auto& result = results[ i];
+        out << csv_field( jobs[ i].checkpoint) << ',' << result.executed_instrs << ',' << result.cycles << ','
+            << ( result.cycles == 0 ? 0. : 1.0 * result.executed_instrs / static_cast<double>( result.cycles)) << std::endl;
+    }
+}
+
+void Worker::run( const std::string& host, uint16 port, uint32 threads)
+{
+    if ( threads == 0)
+    {
+        std::cerr << "ERROR. Worker needs at least one thread" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    std::vector<std::thread> connections;
+    for ( uint32 i = 0; i < threads; ++i)
+        connections.emplace_back( [this, &host, port]() { run_connection( host, port); });
+
+    for ( auto& connection : connections)
+        connection.join();
+}
+
+// workers may be started before the coordinator
+static const uint32 CONNECT_ATTEMPTS = 50;
+static const auto CONNECT_DELAY = std::chrono::milliseconds( 100);
+
+void Worker::run_connection( const std::string& host, uint16 port)
+{
+    asio::io_context io;
+    Tcp::socket socket( io);
+    Tcp::resolver resolver( io);
+    for ( uint32 attempt = 1;; ++attempt)
+    {
+        boost::system::error_code error;
+        const auto endpoints = resolver.resolve( host, std::to_string( port), error);
+        if ( !error)
+            asio::connect( socket, endpoints, error);
+        if ( !error)
+            break;
+
+        if ( attempt == CONNECT_ATTEMPTS)
+        {
+            std::cerr << "ERROR. Could not connect to coordinator " << host << ":" << port << ": " << error.message() << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+        std::this_thread::sleep_for( CONNECT_DELAY);
+    }
+
+    boost::system::error_code error;
+    asio::write( socket, asio::buffer( std::string( "READY\n")), error);
+
+    std::unique_ptr<Simulation> simulation = nullptr;
+    uint64 instrs_to_run = MAX_VAL64;
+    asio::streambuf buffer;
+    while ( !error)
+    {
+        // the coordinator disconnects the worker if its job is done by another one
+        asio::read_until( socket, buffer, '\n', error);
+        if ( error)
+            return;
+
+        std::istream in( &buffer);
+        std::string line;
+        std::getline( in, line);
+        const auto fields = split_fields( line);
+
+        if ( fields.size() == 1 && fields[ 0] == "DONE")
+            return;
+
+        if ( fields.size() == 3 && fields[ 0] == "SIM" && parse_number( fields[ 2], &instrs_to_run))
+        {
+            simulation = std::make_unique<Simulation>( binary, fields[ 1]);
+            continue;
+        }
+
+        Simulation::Options options;
+        bool is_valid = fields.size() >= 3 && fields[ 0] == "JOB" && simulation != nullptr;
+        for ( size_t i = 3; i < fields.size() && is_valid; ++i)
+        {
+            const auto separator = fields[ i].find( '=');
+            is_valid = separator != std::string::npos;
+            if ( is_valid)
+                options[ fields[ i].substr( 0, separator)] = fields[ i].substr( separator + 1);
+        }
+
+        if ( !is_valid)
+        {
+            std::cerr << "ERROR. Invalid message of coordinator \"" << line << "\"" << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+
+        const auto result = simulation->run( options, instrs_to_run, fields[ 2]);
+        ++done_jobs;
+        const std::string reply = "RESULT\t" + fields[ 1] + "\t" + std::to_string( result.executed_instrs) + "\t" + std::to_string( result.cycles) + "\n";
+        asio::write( socket, asio::buffer( reply), error);
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * cluster.h - sweep of performance simulation distributed to worker processes
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <infra/types.h>
+#include <sweep/sweep.h>
+
+/*
+ * Workers connect to the coordinator over TCP and exchange lines of tab-separated fields:
+ *     worker:      READY
+ *     coordinator: SIM <isa> <instructions to run>
+ *     coordinator: JOB <id> <checkpoint or empty> <option>=<value>...
+ *     worker:      RESULT <id> <instructions> <cycles>
+ *     coordinator: JOB ... or DONE
+ * Jobs are taken in order. When all of them are given, an idle worker gets
+ * the running job of the fewest copies, so stragglers do not delay the sweep;
+ * the first result is taken. Jobs of disconnected workers are given again.
+ * Workers simulate their own copy of the binary, and checkpoints are
+ * opened by workers at the paths given to the coordinator.
+ */
+class Coordinator
+{
+public:
+    struct Job
+    {
+        Sweep::Point point;
+        std::string checkpoint; // empty one starts from the beginning of the binary
+    };
+
+    // jobs are the points for each of the checkpoints
+    Coordinator( const std::vector<Sweep::Point>& points, const std::vector<std::string>& checkpoints,
+                 std::string isa, uint64 instrs_to_run);
+    ~Coordinator();
+
+    // returns the port, 0 takes any free one
+    uint16 listen( uint16 port);
+
+    // accepts workers until all the jobs are done
+    void serve();
+
+    // values of all the options, checkpoint and results, one line per job
+    void dump_csv( std::ostream& out) const;
+
+    // jobs are given more than once to replace stragglers and lost workers
+    uint64 get_assignments() const { return assignments; }
+
+    Coordinator( const Coordinator&) = delete;
+    Coordinator( Coordinator&&) = delete;
+    Coordinator& operator=( const Coordinator&) = delete;
+    Coordinator& operator=( Coordinator&&) = delete;
+
+private:
+    class Session;
+    struct Server;
+
+    struct Result
+    {
+        bool is_done = false;
+        uint64 executed_instrs = 0;
+        uint64 cycles = 0;
+    };
+
+    static constexpr const size_t NO_JOB = std::numeric_limits<size_t>::max();
+
+    const std::string isa;
+    const uint64 instrs_to_run;
+    std::vector<Job> jobs;
+    std::vector<Result> results;
+    std::vector<uint32> copies;   // number of workers running the job
+    std::deque<size_t> pending = {};
+    size_t done_jobs = 0;
+    uint64 assignments = 0;
+    std::unique_ptr<Server> server;
+
+    // reply to the line of the session, the session is closed after the reply if DONE is sent
+    std::string handle( Session* session, const std::string& line, bool* is_last);
+    std::string assign( Session* session, bool* is_last);
+    void release( Session* session);
+    void finish( const Session* last);
+    void accept();
+};
+
+// Connects threads to the coordinator and runs their jobs until they are done
+class Worker
+{
+public:
+    explicit Worker( std::string binary) : binary( std::move( binary)) { }
+
+    void run( const std::string& host, uint16 port, uint32 threads);
+
+    uint64 get_done_jobs() const { return done_jobs; }
+
+private:
+    void run_connection( const std::string& host, uint16 port);
+
+    const std::string binary;
+    std::atomic<uint64> done_jobs{ 0};
+};
+
+#endif // CLUSTER_H
@@ -0,0 +1,167 @@
+// generic C
+#include <cstdlib>
+
+// generic C++
+#include <sstream>
+#include <thread>
+
+// Google Test library
+#include <gtest/gtest.h>
+
+// Asio
+#include <boost/asio.hpp>
+
+// Module
+#include "../cluster.h"
+#include <func_sim/func_sim.h>
+#include <mips/mips.h>
+
+static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
+
+static const std::vector<Sweep::Point> points = {
+    { { "bp-mode", "dynamic_two_bit"}, { "icache-size", "2048"}},
+    { { "bp-mode", "static_always_taken"}},
+    { { "width", "2"}}
+};
+
+static std::string get_sweep_csv()
+{
+    Sweep sweep( points);
+    sweep.run( valid_elf_file, MAX_VAL64, 1);
+    std::ostringstream out;
+    sweep.dump_csv( out);
+    return out.str();
+}
+
+// results of jobs without checkpoints follow an empty column
+static std::string add_checkpoint_column( const std::string& csv)
+{
+    std::istringstream in( csv);
+    std::ostringstream out;
+    bool is_header = true;
+    for ( std::string row; std::getline( in, row); is_header = false)
+    {
+        size_t pos = row.size();
+        for ( size_t i = 0; i < 3; ++i)
+            pos = row.rfind( ',', pos - 1);
+        out << row.substr( 0, pos + 1) << ( is_header ? "checkpoint," : ",") << row.substr( pos + 1) << std::endl;
+    }
+    return out.str();
+}
+
+TEST( Cluster, Results_Are_Same_As_Sweep)
+{
+    Coordinator coordinator( points, { }, "mips", MAX_VAL64);
+    const auto port = coordinator.listen( 0);
+
+    Worker worker( valid_elf_file);
+    std::thread workers( [&]() { worker.run( "127.0.0.1", port, 2); });
+    coordinator.serve();
+    workers.join();
+
+    std::ostringstream out;
+    coordinator.dump_csv( out);
+    ASSERT_EQ( out.str(), add_checkpoint_column( get_sweep_csv()));
+    ASSERT_GE( worker.get_done_jobs(), points.size());
+    ASSERT_GE( coordinator.get_assignments(), points.size());
+}
+
+TEST( Cluster, Checkpoints)
+{
+    FuncSim<MIPS> first_part;
+    first_part.set_checkpoints( "", "./cluster.ckpt");
+    first_part.run( valid_elf_file, 5000);
+
+    Coordinator coordinator( { { }}, { "", "./cluster.ckpt"}, "mips", MAX_VAL64);
+    const auto port = coordinator.listen( 0);
+    std::thread workers( [&]() { Worker( valid_elf_file).run( "localhost", port, 1); });
+    coordinator.serve();
+    workers.join();
+
+    std::ostringstream out;
+    coordinator.dump_csv( out);
+    std::istringstream in( out.str());
+    std::string header;
+    std::string full;
+    std::string restored;
+    std::getline( in, header);
+    std::getline( in, full);
+    std::getline( in, restored);
+    ASSERT_EQ( header, "checkpoint,instrs,cycles,ipc");
+    ASSERT_EQ( full.find( ','), 0u);
+    ASSERT_EQ( restored.find( "./cluster.ckpt,"), 0u);
+
+    // the run from the checkpoint executes the rest of instructions
+    const auto instrs = []( const std::string& row) { return std::stoull( row.substr( row.find( ',') + 1)); };
+    ASSERT_EQ( instrs( full), instrs( restored) + 5000);
+}
+
+// worker which takes a job and does not answer or disconnects
+static void run_broken_worker( uint16 port, bool is_straggler)
+{
+    namespace asio = boost::asio;
+    asio::io_context io;
+    asio::ip::tcp::socket socket( io);
+    socket.connect( asio::ip::tcp::endpoint( asio::ip::make_address( "127.0.0.1"), port));
+    asio::write( socket, asio::buffer( std::string( "READY\n")));
+
+    asio::streambuf buffer;
+    asio::read_until( socket, buffer, "JOB");
+    if ( !is_straggler)
+        return;
+
+    // the coordinator disconnects the straggler when its job is done by the other worker
+    boost::system::error_code error;
+    while ( !error)
+        asio::read( socket, buffer, error);
+    ASSERT_EQ( error, asio::error::eof);
+}
+
+TEST( Cluster, Lost_Workers_And_Stragglers)
+{
+    for ( const bool is_straggler : { false, true})
+    {
+        Coordinator coordinator( points, { }, "mips", MAX_VAL64);
+        const auto port = coordinator.listen( 0);
+        std::thread broken( [&]() { run_broken_worker( port, is_straggler); });
+        std::thread server( [&]() { coordinator.serve(); });
+
+        // the real worker comes after the broken one has taken the job
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100));
+        Worker worker( valid_elf_file);
+        worker.run( "127.0.0.1", port, 1);
+        server.join();
+        broken.join();
+
+        std::ostringstream out;
+        coordinator.dump_csv( out);
+        ASSERT_EQ( out.str(), add_checkpoint_column( get_sweep_csv()));
+        ASSERT_EQ( worker.get_done_jobs(), points.size());
+        ASSERT_EQ( coordinator.get_assignments(), points.size() + 1);
+    }
+}
+
+TEST( Cluster, Quoted_Fields)
+{
+    Coordinator coordinator( { { { "trace-stages", "fetch,writeback"}}}, { "", "./with,comma.ckpt"}, "mips", MAX_VAL64);
+
+    std::ostringstream out;
+    coordinator.dump_csv( out);
+    ASSERT_EQ( out.str(), "trace-stages,checkpoint,instrs,cycles,ipc\n"
+                          "\"fetch,writeback\",,0,0,0\n"
+                          "\"fetch,writeback\",\"./with,comma.ckpt\",0,0,0\n");
+}
+
+TEST( Cluster, Invalid)
+{
+    Coordinator coordinator( points, { }, "mips", MAX_VAL64);
+    ASSERT_EXIT( coordinator.serve(), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( Worker( valid_elf_file).run( "127.0.0.1", 1, 0), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+/*
+ * cpi_stack.cpp - attribution of cycles of the pipeline to the causes of stalls
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "cpi_stack.h"
+
+#include <iomanip>
+#include <numeric>
+#include <string>
+
+static const std::array<std::string, CPIStack::CATEGORIES_NUM> category_names =
+    {{ "retiring", "frontend", "bad_speculation", "data_dependency", "execution_units", "memory"}};
+
+static CPIStack::Category get_stall_category( StageOutcome outcome)
+{
+    switch ( outcome)
+    {
+        case StageOutcome::FLUSH:
+        case StageOutcome::PASSED: // the slot is dropped by misprediction later
+            return CPIStack::BAD_SPECULATION;
+        case StageOutcome::DATA_HAZARD:
+            return CPIStack::DATA_DEPENDENCY;
+        case StageOutcome::STRUCTURAL_HAZARD:
+        case StageOutcome::WAIT_FOR_UNITS:
+            return CPIStack::EXECUTION_UNITS;
+        default:
+            return CPIStack::FRONTEND;
+    }
+}
+
+// ages are counted from the previous cycle, when the slot left the last memory sub-stage
+CPIStack::CPIStack( const PipelineDepth& depth)
+    : stage_ages( {{ depth.memory_stages - 1, depth.memory_stages, depth.memory_stages + depth.execute_stages,
+                     depth.memory_stages + depth.execute_stages + depth.get_frontend_latency().to_size_t()}})
+    , history( stage_ages.back() + 1)
+{ }
+
+CPIStack::Category CPIStack::get_empty_slot_category() const
+{
+    const std::array<StageOutcome, 4> path = {{ get_history( stage_ages[ 0]).mem, get_history( stage_ages[ 1]).execute,
+                                                get_history( stage_ages[ 2]).decode, get_history( stage_ages[ 3]).fetch}};
+
+    for ( const auto outcome : path)
+        if ( outcome != StageOutcome::BUBBLE)
+            return get_stall_category( outcome);
+
+    return FRONTEND;
+}
+
+void CPIStack::account( const Outcomes& outcomes, Latency memory_stall_cycles)
+{
+    const auto category = outcomes.writeback == StageOutcome::PASSED ? RETIRING : get_empty_slot_category();
+    ++cycles[ category];
+    cycles[ MEMORY] = memory_stall_cycles.to_size_t();
+
+    youngest = ( youngest + history.size() - 1) % history.size();
+    history[ youngest] = outcomes;
+}
+
+void CPIStack::account_idle_cycles( Latency idle_cycles)
+{
+    Outcomes outcomes;
+    outcomes.fetch = StageOutcome::ICACHE_MISS;
+
+    const auto memory_stall_cycles = Latency( static_cast<int64>( cycles[ MEMORY]));
+    for ( size_t i = 0; i < idle_cycles.to_size_t(); ++i)
+        account( outcomes, memory_stall_cycles);
+}
+
+uint64 CPIStack::get_total_cycles() const
+{
+    return std::accumulate( cycles.begin(), cycles.end(), uint64{ 0});
+}
+
+void CPIStack::print( std::ostream& out, uint64 instrs) const
+{
+    const auto total = static_cast<double>( get_total_cycles());
+    const auto per_instr = [instrs]( uint64 value) { return instrs == 0 ? 0. : 1.0 * value / instrs; };
+
+    out << "CPI stack:  " << per_instr( get_total_cycles());
+    for ( size_t i = 0; i < CATEGORIES_NUM; ++i)
+        out << std::endl << "  " << std::left << std::setw( 17) << category_names[ i] << std::right
+            << per_instr( cycles[ i]) << " (" << ( total == 0 ? 0. : cycles[ i] * 100 / total) << "%)";
+}
+
+const std::string& CPIStack::get_category_name( Category category)
+{
+    return category_names.at( category);
+}
+
+void CPIStack::register_stats( StatsRegistry* stats) const
+{
+    for ( size_t i = 0; i < CATEGORIES_NUM; ++i)
+        stats->add_counter( "cpi_stack." + category_names[ i], &cycles[ i]);
+}
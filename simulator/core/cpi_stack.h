@@ -0,0 +1,94 @@
+/*
+ * cpi_stack.h - attribution of cycles of the pipeline to the causes of stalls
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef CPI_STACK_H
+#define CPI_STACK_H
+
+#include <core/pipeline_depth.h>
+#include <infra/ports/timing.h>
+#include <infra/stats/stats.h>
+#include <infra/types.h>
+
+#include <array>
+#include <ostream>
+#include <vector>
+
+// result of the last clock of a pipeline stage
+enum class StageOutcome : uint8
+{
+    BUBBLE,            // nothing to process
+    PASSED,            // instructions are sent to the next stage
+    FLUSH,             // instructions are dropped by misprediction
+    ICACHE_MISS,       // fetch waits for instruction cache
+    DATA_HAZARD,       // decode waits for source operands
+    STRUCTURAL_HAZARD, // decode waits for a free execution unit
+    WAIT_FOR_UNITS     // execute waits for multi-cycle units
+};
+
+/*
+ * Each cycle is attributed to exactly one category at writeback.
+ * A cycle retiring instructions is a retiring one; otherwise the empty slot
+ * is traced back through the stages it passed: memory stage in the previous
+ * cycle, execute two cycles ago, decode three cycles ago and fetch four cycles ago
+ * in the pipeline of five stages, sub-stages of a deeper one move them back.
+ * The oldest stage which did not pass the slot further explains the cycle.
+ * Data cache stalls stop the whole pipeline, so they are the memory category.
+ */
+class CPIStack
+{
+    public:
+        enum Category : uint8
+        {
+            RETIRING,
+            FRONTEND,
+            BAD_SPECULATION,
+            DATA_DEPENDENCY,
+            EXECUTION_UNITS,
+            MEMORY,
+            CATEGORIES_NUM
+        };
+
+        struct Outcomes
+        {
+            StageOutcome fetch = StageOutcome::BUBBLE;
+            StageOutcome decode = StageOutcome::BUBBLE;
+            StageOutcome execute = StageOutcome::BUBBLE;
+            StageOutcome mem = StageOutcome::BUBBLE;
+            StageOutcome writeback = StageOutcome::BUBBLE;
+        };
+
+        explicit CPIStack( const PipelineDepth& depth = PipelineDepth());
+
+        // called after all the stages are clocked, data cache stalls are counted in total
+        void account( const Outcomes& outcomes, Latency memory_stall_cycles);
+
+        // cycles skipped while the pipeline is empty and fetch waits for instruction cache
+        void account_idle_cycles( Latency cycles);
+
+        uint64 get_cycles( Category category) const { return cycles.at( category); }
+        uint64 get_total_cycles() const;
+        // counter of the category is named "cpi_stack." followed by its name
+        static const std::string& get_category_name( Category category);
+
+        // cycles of each category per retired instruction
+        void print( std::ostream& out, uint64 instrs) const;
+
+        void register_stats( StatsRegistry* stats) const;
+
+    private:
+        // cycles from memory, execute, decode and fetch stages to writeback
+        const std::array<size_t, 4> stage_ages;
+
+        // outcomes of the last cycles, the youngest cycle goes first
+        std::vector<Outcomes> history;
+        size_t youngest = 0;
+
+        std::array<uint64, CATEGORIES_NUM> cycles = {{}};
+
+        const Outcomes& get_history( size_t age) const { return history[ ( youngest + age) % history.size()]; }
+        Category get_empty_slot_category() const;
+};
+
+#endif // CPI_STACK_H
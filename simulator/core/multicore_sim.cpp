@@ -0,0 +1,186 @@
+/*
+ * multicore_sim.cpp - performance simulator of cores sharing memory
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <infra/barrier.h>
+#include <infra/config/config.h>
+
+#include "multicore_sim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace config {
+    static Value<bool> core_threads = { "core-threads", false, "clock cores of multi-core simulation in parallel host threads"};
+    static Value<uint32> coherence_latency = { "coherence-latency", 10, "latency of invalidation or write-back of a line in data cache of another core (in cycles)"};
+} // namespace config
+
+template <typename ISA>
+MultiCoreSim<ISA>::MultiCoreSim( bool log, uint32 cores_num)
+    : Simulator( log)
+    , directory( Latency( config::coherence_latency))
+    , is_threaded( config::core_threads)
+{
+    if ( cores_num == 0)
+        serr << "ERROR. Multi-core simulation needs at least one core" << std::endl << critical;
+
+    // traces of cores would be mixed
+    if ( is_threaded && log)
+        serr << "ERROR. Cores simulated in parallel threads cannot be traced" << std::endl << critical;
+
+    for ( uint32 i = 0; i < cores_num; ++i)
+        cores.emplace_back( std::make_unique<PerfSim<ISA>>( log));
+}
+
+template <typename ISA>
+void MultiCoreSim<ISA>::set_PC( Addr value)
+{
+    for ( auto& core : cores)
+        core->set_PC( value);
+}
+
+template <typename ISA>
+uint64 MultiCoreSim<ISA>::get_executed_instrs() const
+{
+    uint64 result = 0;
+    for ( const auto& core : cores)
+        result += core->get_executed_instrs();
+    return result;
+}
+
+template <typename ISA>
+Cycle MultiCoreSim<ISA>::get_cycles() const
+{
+    Cycle result = 0_Cl;
+    for ( const auto& core : cores)
+        result = std::max( result, core->get_cycles());
+    return result;
+}
+
+template <typename ISA>
+void MultiCoreSim<ISA>::run( const std::string& tr, uint64 instrs_to_run)
+{
+    if ( !checkpoint_to_load.empty() || !checkpoint_to_save.empty())
+        serr << "ERROR. Checkpoints are not supported by multi-core simulation" << std::endl << critical;
+
+    if ( !profile_to_save.empty())
+        serr << "ERROR. Profiles are not supported by multi-core simulation" << std::endl << critical;
+
+    memory = std::make_unique<Memory>( tr);
+    for ( uint32 i = 0; i < cores.size(); ++i)
+    {
+        cores[ i]->set_core( i, memory.get(), &directory, is_threaded ? &memory_lock : nullptr);
+        cores[ i]->start( tr, instrs_to_run);
+    }
+
+    auto t_start = std::chrono::high_resolution_clock::now();
+    if ( is_threaded)
+        run_in_threads();
+    else
+        run_in_order();
+    auto t_end = std::chrono::high_resolution_clock::now();
+
+    const auto time = std::chrono::duration<double, std::milli>( t_end - t_start).count();
+    for ( auto& core : cores)
+        core->finish( time);
+
+    if ( statistics_output)
+        print_statistics( time);
+}
+
+template <typename ISA>
+void MultiCoreSim<ISA>::run_in_order()
+{
+    std::vector<bool> is_halted( cores.size(), false);
+    auto running = cores.size();
+    for ( auto cycle = 0_Cl; running > 0; cycle.inc())
+    {
+        for ( size_t i = 0; i < cores.size(); ++i)
+        {
+            // the core waiting for data cache is ahead of the cycle
+            if ( is_halted[ i] || cycle < cores[ i]->get_cycles())
+                continue;
+
+            if ( !cores[ i]->step()) {
+                is_halted[ i] = true;
+                --running;
+            }
+        }
+    }
+}
+
+template <typename ISA>
+void MultiCoreSim<ISA>::run_in_threads()
+{
+    // the cycle and the end are changed only by the last thread at the barrier
+    auto cycle = 0_Cl;
+    bool is_done = false;
+    std::atomic<size_t> running{ cores.size()};
+    Barrier barrier( cores.size());
+
+    auto worker = [&]( PerfSim<ISA>* core) {
+        bool is_halted = false;
+        while ( !is_done)
+        {
+            if ( !is_halted && !( cycle < core->get_cycles()) && !core->step()) {
+                is_halted = true;
+                --running;
+            }
+
+            barrier.wait( [&]() {
+                cycle.inc();
+                is_done = running == 0;
+            });
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for ( auto& core : cores)
+        threads.emplace_back( worker, core.get());
+
+    for ( auto& thread : threads)
+        thread.join();
+}
+
+template <typename ISA>
+void MultiCoreSim<ISA>::print_statistics( double time) const
+{
+    const auto cycles = get_cycles();
+    const auto instrs = get_executed_instrs();
+
+    std::cout << std::endl << "****************************"
+              << std::endl << "cores:      " << cores.size()
+              << std::endl << "instrs:     " << instrs
+              << std::endl << "cycles:     " << cycles
+              << std::endl << "IPC:        " << 1.0 * instrs / static_cast<double>( cycles)
+              << std::endl << "sim freq:   " << static_cast<double>( cycles) / time << " kHz"
+              << std::endl << "sim IPS:    " << instrs / time << " kips";
+
+    for ( size_t i = 0; i < cores.size(); ++i)
+        std::cout << std::endl << "core " << i << ":     " << cores[ i]->get_executed_instrs() << " instrs, "
+                                                  << cores[ i]->get_cycles() << " cycles";
+
+    std::cout << std::endl << "coherence:  " << directory.get_invalidations() << " invalidations, "
+                                            << directory.get_interventions() << " interventions";
+
+    const auto& l2 = directory.get_l2();
+    if ( l2 != nullptr)
+        std::cout << std::endl << "L2 cache:   " << l2->get_hits() << " hits, "
+                                                << l2->get_misses() << " misses, "
+                                                << l2->get_writebacks() << " writebacks";
+
+    std::cout << std::endl << "****************************"
+              << std::endl;
+}
+
+#include <mips/mips.h>
+#include <risc_v/risc_v.h>
+
+template class MultiCoreSim<MIPS>;
+template class MultiCoreSim<RISCV32>;
+template class MultiCoreSim<RISCV64>;
+template class MultiCoreSim<RISCV128>;
@@ -0,0 +1,61 @@
+/*
+ * multicore_sim.h - performance simulator of cores sharing memory
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef MULTICORE_SIM_H
+#define MULTICORE_SIM_H
+
+#include <simulator.h>
+#include <infra/cache/coherence.h>
+
+#include "perf_sim.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Cores are in-order pipelines with private data caches, they share
+ * memory and L2 cache. All the cores run the same program, which gets
+ * number of the core in its first argument register ($a0 or a0).
+ *
+ * Data cache stalls move the clock of a core ahead, so each cycle
+ * only the cores which are not ahead of it are clocked. The cores
+ * are clocked in their order, or in parallel host threads if requested;
+ * order of memory accesses of different cores in a cycle is not
+ * determined then.
+ */
+template <typename ISA>
+class MultiCoreSim : public Simulator
+{
+    using Memory = typename ISA::Memory;
+
+public:
+    MultiCoreSim( bool log, uint32 cores_num);
+    void run( const std::string& tr, uint64 instrs_to_run) final;
+    void set_PC( Addr value) final;
+
+    // Results of the run, instructions are counted for all the cores
+    uint64 get_executed_instrs() const;
+    Cycle get_cycles() const;
+    const PerfSim<ISA>& get_core( size_t index) const { return *cores.at( index); }
+    size_t get_cores_num() const { return cores.size(); }
+    const CoherenceDirectory& get_directory() const { return directory; }
+    void set_statistics_output( bool value) { statistics_output = value; }
+
+private:
+    std::vector<std::unique_ptr<PerfSim<ISA>>> cores;
+    std::unique_ptr<Memory> memory = nullptr;
+    CoherenceDirectory directory;
+    std::mutex memory_lock = {};
+    const bool is_threaded;
+    bool statistics_output = true;
+
+    void run_in_order();
+    void run_in_threads();
+    void print_statistics( double time) const;
+};
+
+#endif // MULTICORE_SIM_H
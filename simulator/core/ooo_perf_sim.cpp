@@ -0,0 +1,116 @@
+/*
+ * ooo_perf_sim.cpp - performance simulator of out-of-order core
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <chrono>
+#include <iostream>
+
+#include <func_sim/checkpoint.h>
+
+#include "ooo_perf_sim.h"
+#include "perf_sim.h"
+
+template <typename ISA>
+OOOPerfSim<ISA>::OOOPerfSim( bool log) :
+    Simulator( log),
+    rf( new RF<ISA>),
+    fetch( log, get_pipeline_width()),
+    core( log, get_pipeline_width()),
+    writeback( log, get_pipeline_width())
+{
+    if ( !get_pipeline_depth().is_classic())
+    {
+        std::cerr << "ERROR. Depth of pipeline and the stage resolving jumps are configurable for in-order core only" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    if ( get_pipeline_threads() != 1)
+    {
+        std::cerr << "ERROR. Hardware threads are supported by in-order core only" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    wp_core_2_fetch_target = make_write_port<Addr>("CORE_2_FETCH_TARGET", PORT_BW, PORT_FANOUT);
+    rp_halt = make_read_port<bool>("WRITEBACK_2_CORE_HALT", PORT_LATENCY);
+
+    port_map->init();
+}
+
+template <typename ISA>
+void OOOPerfSim<ISA>::set_PC( Addr value)
+{
+    wp_core_2_fetch_target->write( value, curr_cycle);
+    writeback.set_PC( value);
+}
+
+template<typename ISA>
+void OOOPerfSim<ISA>::run( const std::string& tr, uint64 instrs_to_run)
+{
+    if ( !profile_to_save.empty())
+        serr << "ERROR. Profiles are not supported by out-of-order simulation" << std::endl << critical;
+
+    memory = new Memory( tr);
+    fetch.set_memory( memory);
+    core.set_memory( memory);
+    core.set_RF( rf.get());
+    writeback.set_instrs_to_run( instrs_to_run);
+    writeback.set_RF( rf.get());
+    writeback.set_checkpoints( checkpoint_to_load, checkpoint_to_save);
+    writeback.init_checker( tr, memory);
+
+    const Addr PC = checkpoint_to_load.empty()
+                  ? memory->startPC()
+                  : checkpoint::load( checkpoint_to_load, rf.get(), memory);
+    set_PC( PC);
+
+    auto t_start = std::chrono::high_resolution_clock::now();
+
+    while (true)
+    {
+        if (rp_halt->is_ready( curr_cycle) && rp_halt->read( curr_cycle))
+            break;
+
+        writeback.clock( curr_cycle);
+        fetch.clock( curr_cycle);
+        core.clock( curr_cycle);
+        curr_cycle.inc();
+    }
+
+    auto t_end = std::chrono::high_resolution_clock::now();
+
+    if ( statistics_output)
+        print_statistics( std::chrono::duration<double, std::milli>( t_end - t_start).count());
+
+    writeback.check_final_state( *memory);
+    writeback.save_checkpoint();
+}
+
+template<typename ISA>
+void OOOPerfSim<ISA>::print_statistics( double time) const
+{
+    auto executed_instrs = writeback.get_executed_instrs();
+    auto frequency = static_cast<double>( get_cycles()) / time; // cycles per millisecond = kHz
+    auto ipc = 1.0 * executed_instrs / static_cast<double>( get_cycles());
+    auto simips = executed_instrs / time;
+    const auto& statistics = core.get_statistics();
+
+    std::cout << std::endl << "****************************"
+              << std::endl << "instrs:     " << executed_instrs
+              << std::endl << "cycles:     " << get_cycles()
+              << std::endl << "IPC:        " << ipc
+              << std::endl << "sim freq:   " << frequency << " kHz"
+              << std::endl << "sim IPS:    " << simips    << " kips"
+              << std::endl << "icache:     " << fetch.get_icache_statistics().demand_misses << " misses"
+              << std::endl << "mispredict: " << statistics.mispredictions
+              << std::endl << "ROB full:   " << statistics.rob_full << " cycles"
+              << std::endl << "IQ full:    " << statistics.iq_full << " cycles"
+              << std::endl << "LSQ full:   " << statistics.lsq_full << " cycles"
+              << std::endl << "****************************"
+              << std::endl;
+}
+
+
+#include <mips/mips.h>
+
+template class OOOPerfSim<MIPS>;
@@ -0,0 +1,63 @@
+/*
+ * ooo_perf_sim.h - performance simulator of out-of-order core
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef OOO_PERF_SIM_H
+#define OOO_PERF_SIM_H
+
+#include <simulator.h>
+#include <infra/ports/ports.h>
+#include <fetch/fetch.h>
+#include <ooo/ooo_core.h>
+#include <writeback/writeback.h>
+
+#include "perf_instr.h"
+
+/* Fetch and in-order writeback are shared with PerfSim,
+ * the stages between them are replaced by out-of-order core
+ */
+template <typename ISA>
+class OOOPerfSim : public Simulator
+{
+    using Memory = typename ISA::Memory;
+
+private:
+    // Ports of all the units are bound within this map, so it goes first
+    std::shared_ptr<PortMap> port_map = PortMap::create_port_map();
+
+    Cycle curr_cycle = 0_Cl;
+    bool statistics_output = true;
+
+    /* simulator units */
+    std::unique_ptr<RF<ISA>> rf = nullptr;
+    Memory* memory = nullptr;
+    Fetch<ISA> fetch;
+    OOOCore<ISA> core;
+    Writeback<ISA> writeback;
+
+    /* ports */
+    std::unique_ptr<WritePort<Addr>> wp_core_2_fetch_target = nullptr;
+    std::unique_ptr<ReadPort<bool>> rp_halt = nullptr;
+
+    void print_statistics( double time) const;
+
+public:
+    explicit OOOPerfSim( bool log);
+    ~OOOPerfSim() final { port_map->destroy(); }
+    void run( const std::string& tr, uint64 instrs_to_run) final;
+    void set_PC( Addr value) final;
+
+    // Results of the run, they are printed unless the output is disabled
+    auto get_executed_instrs() const { return writeback.get_executed_instrs(); }
+    Cycle get_cycles() const { return curr_cycle; }
+    void set_statistics_output( bool value) { statistics_output = value; }
+
+    // Rule of five
+    OOOPerfSim( const OOOPerfSim&) = delete;
+    OOOPerfSim( OOOPerfSim&&) = delete;
+    OOOPerfSim operator=( const OOOPerfSim&) = delete;
+    OOOPerfSim operator=( OOOPerfSim&&) = delete;
+};
+
+#endif
@@ -12,16 +12,70 @@
 template <typename FuncInstr>
 class PerfInstr : public FuncInstr
 {
-    /* info for branch misprediction unit */
-    const BPInterface bp_data = {};
+    /* prediction of fetch, its speculative state of predictor is kept by fetch under the id */
+    Addr predicted_target = NO_VAL32;
+    uint32 prediction_id = 0;
+
+    /* number of the instruction in pipeline trace */
+    uint64 trace_id = 0;
+
+    bool predicted_taken = false;
+
+    /* results are taken from instruction trace, they are not computed */
+    bool replayed = false;
+
+    /* hardware thread of the instruction */
+    uint8 thread = 0;
+
+    /* the thread was flushed, but the instruction keeps its slot in the bundles of other threads */
+    bool flushed = false;
 public:
-    PerfInstr( const FuncInstr& instr, const BPInterface& bp_info) : FuncInstr( instr), bp_data( bp_info) { }
+    PerfInstr( const FuncInstr& instr, const BPInterface& prediction, uint32 prediction_id = 0)
+        : FuncInstr( instr)
+        , predicted_target( prediction.target)
+        , prediction_id( prediction_id)
+        , predicted_taken( prediction.is_taken)
+    { }
 
-    bool is_misprediction() const { return bp_data.is_taken != this->is_jump_taken() || bp_data.target != this->get_new_PC(); }
-    auto get_predicted_target() const { return bp_data.target; }
-    BPInterface get_bp_upd() const { return BPInterface( this->get_PC(), this->is_jump_taken(), this->get_new_PC()); }
+    bool is_misprediction() const { return predicted_taken != this->is_jump_taken() || predicted_target != this->get_new_PC(); }
+    auto get_predicted_target() const { return predicted_target; }
+    BPResolution get_bp_resolution() const
+    {
+        BPResolution resolution;
+        resolution.prediction_id = prediction_id;
+        resolution.pc = this->get_PC();
+        resolution.target = this->get_new_PC();
+        resolution.is_taken = this->is_jump_taken();
+        resolution.is_misprediction = is_misprediction();
+        resolution.type = get_branch_type( *this);
+        return resolution;
+    }
+
+    static BranchType get_branch_type( const FuncInstr& instr)
+    {
+        if ( !instr.is_jump())
+            return BranchType::NONE;
+        if ( instr.is_return())
+            return BranchType::RETURN;
+        if ( instr.is_indirect_jump())
+            return instr.is_call() ? BranchType::INDIRECT_CALL : BranchType::INDIRECT;
+        return instr.is_call() ? BranchType::CALL : BranchType::BRANCH;
+    }
 
     auto is_bypassible() const { return !this->is_conditional_move(); }
+
+    void set_trace_id( uint64 value) { trace_id = value; }
+    auto get_trace_id() const { return trace_id; }
+
+    void set_replayed() { replayed = true; }
+    bool is_replayed() const { return replayed; }
+
+    void set_thread( uint8 value) { thread = value; }
+    auto get_thread() const { return thread; }
+
+    // flushed instructions pass the stages doing nothing, they are not traced and not retired
+    void set_flushed() { flushed = true; trace_id = 0; }
+    bool is_flushed() const { return flushed; }
 };
 
 #endif // PERF_INSTR_H
@@ -2,88 +2,711 @@
 
 #include <iostream>
 #include <chrono>
+#include <thread>
+#include <vector>
+
+#include <infra/barrier.h>
+#include <infra/config/config.h>
+#include <infra/self_profiler/self_profiler.h>
+
+#include <func_sim/checkpoint.h>
+#include <func_sim/func_sim.h>
 
 #include "perf_sim.h"
 
+namespace config {
+    static Value<std::string> trace_stages = { "trace-stages", "all", "stages traced with -d: all or comma-separated list of fetch, decode, execute, mem, writeback"};
+    static Value<uint64> fast_forward = { "fast-forward", 0, "number of instructions executed functionally before performance simulation"};
+    static Value<uint64> warmup = { "warmup", 0, "number of functionally executed instructions which warm up branch predictor and instruction cache"};
+    static Value<bool> no_cycle_skipping = { "no-cycle-skipping", false, "clock all the cycles of instruction cache misses"};
+    static Value<uint32> width = { "width", 1, "number of instructions fetched, decoded, executed and retired per cycle"};
+    static Value<uint32> fetch_stages = { "fetch-stages", 1, "number of cycles of fetch stage of in-order pipeline"};
+    static Value<uint32> decode_stages = { "decode-stages", 1, "number of cycles of decode stage, instructions are issued at the last one"};
+    static Value<uint32> execute_stages = { "execute-stages", 1, "number of cycles of execute stage, they are added to latencies of functional units"};
+    static Value<uint32> memory_stages = { "memory-stages", 1, "number of cycles of memory stage, results of loads are bypassed from the last one"};
+    static Value<std::string> branch_resolution = { "branch-resolution", "mem", "stage resolving jumps: execute or mem"};
+    static Value<std::string> stats_file = { "stats-file", "", "file with values of performance counters of all the units"};
+    static Value<std::string> stats_format = { "stats-format", "json", "format of statistics file: json or csv"};
+    static Value<uint64> stats_interval = { "stats-interval", 0, "number of cycles between snapshots in statistics file, 0 writes only the final values"};
+    static Value<std::string> phase_file = { "phase-file", "", "CSV file with IPC, prediction accuracy, miss rate and CPI stack of each interval and its phase"};
+    static Value<uint64> phase_interval = { "phase-interval", 100000, "length of intervals of phase file"};
+    static Value<std::string> phase_unit = { "phase-unit", "instrs", "unit of length of intervals of phase file: instrs or cycles"};
+    static Value<double> phase_threshold = { "phase-threshold", 0.25, "distance of CPI stacks of intervals from 0 to 1 which starts a new phase"};
+    static Value<std::string> telemetry_file = { "telemetry-file", "", "file mapped to memory with progress and key counters of the running simulation, it is read by mipt-mips-top"};
+    static Value<uint64> telemetry_interval = { "telemetry-interval", 100000, "number of cycles between updates of telemetry file"};
+    static Value<std::string> trace_replay = { "trace-replay", "", "instruction trace of functional simulation replayed instead of the binary"};
+    static Value<std::string> pipeline_trace = { "pipeline-trace", "", "binary file with pipeline stages passed by each instruction"};
+    static Value<uint32> stage_threads = { "stage-threads", 1, "number of host threads clocking the stages of in-order pipeline in each cycle"};
+    static Value<uint32> smt_threads = { "smt-threads", 1, "number of hardware threads running copies of the program on in-order pipeline"};
+} // namespace config
+
+// slots of instructions in bundles are kept in 8 bits
+uint32 get_pipeline_width()
+{
+    if ( config::width == 0 || config::width > MAX_VAL8)
+    {
+        std::cerr << "ERROR. Pipeline width must be from 1 to " << uint32{ MAX_VAL8} << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    return config::width;
+}
+
+// stages are pipelined, numbers of their cycles are limited to keep stages of the bypassing unit in 8 bits
+static const uint32 MAX_SUBSTAGES = 16;
+
+PipelineDepth get_pipeline_depth()
+{
+    PipelineDepth depth;
+    depth.fetch_stages = config::fetch_stages;
+    depth.decode_stages = config::decode_stages;
+    depth.execute_stages = config::execute_stages;
+    depth.memory_stages = config::memory_stages;
+
+    for ( const auto stages : { depth.fetch_stages, depth.decode_stages, depth.execute_stages, depth.memory_stages})
+    {
+        if ( stages == 0 || stages > MAX_SUBSTAGES)
+        {
+            std::cerr << "ERROR. Number of cycles of each pipeline stage must be from 1 to " << MAX_SUBSTAGES << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+    }
+
+    const std::string& resolution = config::branch_resolution;
+    if ( resolution != "execute" && resolution != "mem")
+    {
+        std::cerr << "ERROR. Invalid stage resolving jumps " << resolution << ", it should be execute or mem" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    depth.is_branch_resolved_in_execute = resolution == "execute";
+    return depth;
+}
+
+uint32 get_pipeline_threads()
+{
+    if ( config::smt_threads == 0 || config::smt_threads > MAX_HW_THREADS)
+    {
+        std::cerr << "ERROR. Number of hardware threads must be from 1 to " << MAX_HW_THREADS << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    return config::smt_threads;
+}
 
+static bool is_traced_stage( bool log, const std::string& stage)
+{
+    const std::string& stages = config::trace_stages;
+    if ( !log || stages == "all")
+        return log;
+
+    bool is_traced = false;
+    std::istringstream iss( stages);
+    for ( std::string name; std::getline( iss, name, ',');)
+    {
+        if ( name != "fetch" && name != "decode" && name != "execute" && name != "mem" && name != "writeback")
+        {
+            std::cerr << "ERROR. Invalid pipeline stage " << name << " in the list of traced stages" << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+        is_traced = is_traced || name == stage;
+    }
+    return is_traced;
+}
 
 template <typename ISA>
 PerfSim<ISA>::PerfSim(bool log) : 
     Simulator( log),
     rf( new RF<ISA>),
-    fetch( log),
-    decode( log),
-    execute( log),
-    mem( log),
-    writeback( log)
+    fetch( is_traced_stage( log, "fetch"), get_pipeline_width(), get_pipeline_threads()),
+    decode( is_traced_stage( log, "decode"), get_pipeline_width(), get_pipeline_depth(), get_pipeline_threads()),
+    execute( is_traced_stage( log, "execute"), get_pipeline_width(), get_pipeline_depth(), get_pipeline_threads()),
+    mem( is_traced_stage( log, "mem"), get_pipeline_width(), get_pipeline_depth(), get_pipeline_threads()),
+    writeback( is_traced_stage( log, "writeback"), get_pipeline_width(), get_pipeline_depth(), get_pipeline_threads()),
+    cpi_stack( get_pipeline_depth()),
+    stage_threads( config::stage_threads)
 {
-    wp_core_2_fetch_target = make_write_port<Addr>("CORE_2_FETCH_TARGET", PORT_BW, PORT_FANOUT);
+    if ( stage_threads == 0 || stage_threads > STAGE_GROUPS)
+        serr << "ERROR. Stages are clocked by 1 to " << STAGE_GROUPS << " threads" << std::endl << critical;
+
+    // traces of stages would be mixed
+    if ( stage_threads > 1 && log)
+        serr << "ERROR. Stages clocked in parallel threads cannot be traced" << std::endl << critical;
+
+    for ( uint32 thread = 0; thread < get_pipeline_threads(); ++thread)
+        wps_core_2_fetch_target.push_back( make_write_port<Addr>( get_thread_port_name( "CORE_2_FETCH_TARGET", thread),
+                                                                  PORT_BW, PORT_FANOUT));
+    for ( uint32 thread = 1; thread < get_pipeline_threads(); ++thread)
+        thread_rfs.push_back( std::make_unique<RF<ISA>>());
     rp_halt = make_read_port<bool>("WRITEBACK_2_CORE_HALT", PORT_LATENCY);
 
-    init_ports();
+    port_map->init();
+
+    fetch.register_stats( &stats);
+    decode.register_stats( &stats);
+    execute.register_stats( &stats);
+    mem.register_stats( &stats);
+    writeback.register_stats( &stats);
+    cpi_stack.register_stats( &stats);
 }
 
 
 template <typename ISA>
 void PerfSim<ISA>::set_PC( Addr value)
 {
-    wp_core_2_fetch_target->write( value, curr_cycle);
-    writeback.set_PC( value);
+    // threads start the copies of the program together
+    for ( uint32 thread = 0; thread < wps_core_2_fetch_target.size(); ++thread)
+    {
+        wps_core_2_fetch_target[ thread]->write( value, curr_cycle);
+        writeback.set_PC( value, thread);
+    }
+}
+
+template <typename ISA>
+void PerfSim<ISA>::set_core( uint32 id, Memory* common_memory, CoherenceDirectory* directory, std::mutex* memory_lock)
+{
+    if ( !static_cast<const std::string&>( config::trace_replay).empty() || config::fast_forward + config::warmup > 0
+        || !static_cast<const std::string&>( config::stats_file).empty() || !static_cast<const std::string&>( config::phase_file).empty()
+        || !static_cast<const std::string&>( config::telemetry_file).empty()
+        || !static_cast<const std::string&>( config::pipeline_trace).empty()
+        || stage_threads > 1 || !thread_rfs.empty())
+        serr << "ERROR. Trace replay, fast-forward, warm-up, statistics, phase, telemetry, pipeline trace files, "
+             << "parallel stages and SMT are not supported by multi-core simulation" << std::endl << critical;
+
+    rf->set_initial_value( ISA::Register::first_argument, id);
+
+    // other cores change the memory, so functional simulation cannot check the results
+    writeback.disable_checker();
+    statistics_output = false;
+
+    shared_memory = common_memory;
+    fetch.set_memory_lock( memory_lock);
+    mem.set_memory_lock( memory_lock);
+    mem.connect( directory);
 }
 
 template<typename ISA>
 void PerfSim<ISA>::run( const std::string& tr,
                     uint64 instrs_to_run)
 {
-    memory = new Memory( tr);
-    fetch.set_memory( memory);
+    start( tr, instrs_to_run);
+
+    auto t_start = std::chrono::high_resolution_clock::now();
+    if ( stage_threads > 1)
+        run_in_threads();
+    else
+        while ( step())
+            continue;
+    auto t_end = std::chrono::high_resolution_clock::now();
+
+    finish( std::chrono::duration<double, std::milli>( t_end - t_start).count());
+}
+
+template<typename ISA>
+void PerfSim<ISA>::start( const std::string& tr, uint64 instrs_to_run)
+{
     decode.set_RF( rf.get());
-    mem.set_memory( memory);
-    writeback.set_instrs_to_run( instrs_to_run);
     writeback.set_RF( rf.get());
-    writeback.init_checker( tr);
+    for ( uint32 thread = 1; thread <= thread_rfs.size(); ++thread)
+    {
+        decode.set_RF( thread_rfs[ thread - 1].get(), thread);
+        writeback.set_RF( thread_rfs[ thread - 1].get(), thread);
+    }
 
-    set_PC( memory->startPC());
+    const std::string& replay_file = config::trace_replay;
+    if ( !thread_rfs.empty() && ( !replay_file.empty() || config::fast_forward + config::warmup > 0
+        || !checkpoint_to_load.empty() || !checkpoint_to_save.empty() || !profile_to_save.empty() || stage_threads > 1))
+        serr << "ERROR. Trace replay, fast-forward, warm-up, checkpoints, profiles "
+             << "and parallel stages are not supported with SMT" << std::endl << critical;
 
-    auto t_start = std::chrono::high_resolution_clock::now();
+    const Addr PC = replay_file.empty() ? load_binary( tr) : open_instr_trace( replay_file);
+
+    // the trace is replayed until its end
+    writeback.set_instrs_to_run( instr_trace == nullptr ? instrs_to_run : std::min( instrs_to_run, instr_trace->get_remaining_instrs()));
+    set_PC( PC);
+
+    // idle cycles are traced, so they are not skipped with traces
+    is_cycle_skipping = !config::no_cycle_skipping && !sout.is_enabled();
+
+    open_stats_file();
+    open_phase_file();
+    open_telemetry_file();
+    const std::string& pipeline_trace_file = config::pipeline_trace;
+    if ( !pipeline_trace_file.empty() && stage_threads > 1)
+        serr << "ERROR. Stages clocked in parallel threads cannot write pipeline trace" << std::endl << critical;
 
-    while (true)
+    if ( !pipeline_trace_file.empty())
     {
-        if (rp_halt->is_ready( curr_cycle) && rp_halt->read( curr_cycle))
-            break;
+        pipeline_trace = std::make_unique<PipelineTrace>( pipeline_trace_file);
+        set_pipeline_trace( pipeline_trace.get());
+    }
 
-        writeback.clock( curr_cycle);
-        fetch.clock( curr_cycle);
-        decode.clock( curr_cycle);
-        execute.clock( curr_cycle);
-        mem.clock( curr_cycle);
-        curr_cycle.inc();
+    if ( !profile_to_save.empty() && stage_threads > 1)
+        serr << "ERROR. Stages clocked in parallel threads cannot be profiled" << std::endl << critical;
 
-        check_ports( curr_cycle);
+    if ( !profile_to_save.empty())
+    {
+        profiler = std::make_unique<Profiler>( tr, profile_period);
+        set_profiler( profiler.get());
     }
+}
 
-    auto t_end = std::chrono::high_resolution_clock::now();
+template<typename ISA>
+bool PerfSim<ISA>::begin_cycle()
+{
+    if ( is_cycle_skipping)
+        skip_idle_cycles();
+
+    return !( rp_halt->is_ready( curr_cycle) && rp_halt->read( curr_cycle));
+}
+
+template<typename ISA>
+void PerfSim<ISA>::end_cycle()
+{
+    cpi_stack.account( { fetch.get_outcome(), decode.get_outcome(), execute.get_outcome(),
+                         mem.get_outcome(), writeback.get_outcome()}, mem.get_stall_cycles());
+    curr_cycle.inc();
+
+    if ( stats_interval != 0 && next_stats_cycle <= curr_cycle)
+        write_stats();
+
+    if ( phase_file != nullptr && get_phase_position() >= next_phase_end)
+        write_phase();
+
+    if ( telemetry_file != nullptr && next_telemetry_cycle <= curr_cycle)
+        publish_telemetry();
+}
+
+template<typename ISA>
+bool PerfSim<ISA>::step()
+{
+    if ( !begin_cycle())
+        return false;
+
+    writeback.clock( curr_cycle);
+    fetch.clock( curr_cycle);
+    decode.clock( curr_cycle);
+    execute.clock( curr_cycle);
+    mem.clock( curr_cycle);
+    end_cycle();
+    return true;
+}
+
+template<typename ISA>
+void PerfSim<ISA>::clock_stage_group( size_t group, Cycle cycle)
+{
+    switch ( group)
+    {
+        case 0: writeback.clock( cycle); decode.clock( cycle); break;
+        case 1: fetch.clock( cycle); break;
+        case 2: execute.clock( cycle); break;
+        default: mem.clock( cycle); break;
+    }
+}
+
+template<typename ISA>
+void PerfSim<ISA>::run_in_threads()
+{
+    // the cycle and the end are changed only by the last thread at the barrier
+    bool is_done = !begin_cycle();
+    Barrier barrier( stage_threads);
+
+    auto worker = [&]( uint32 id) {
+        while ( !is_done)
+        {
+            for ( size_t group = id; group < STAGE_GROUPS; group += stage_threads)
+                clock_stage_group( group, curr_cycle);
+
+            barrier.wait( [&]() {
+                end_cycle();
+                is_done = !begin_cycle();
+            });
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for ( uint32 id = 1; id < stage_threads; ++id)
+        threads.emplace_back( worker, id);
+    worker( 0);
+
+    for ( auto& thread : threads)
+        thread.join();
+}
+
+template<typename ISA>
+void PerfSim<ISA>::finish( double time)
+{
+    if ( stats_file != nullptr)
+    {
+        stats_file->write( get_cycles());
+        stats_file = nullptr;
+    }
+
+    // the last interval may be shorter
+    if ( phase_file != nullptr)
+    {
+        phase_file->write( get_cycles(), get_executed_instrs());
+        phase_file = nullptr;
+    }
+
+    if ( telemetry_file != nullptr)
+    {
+        telemetry_file->finish( get_cycles(), get_executed_instrs());
+        telemetry_file = nullptr;
+    }
+
+    set_pipeline_trace( nullptr);
+    pipeline_trace = nullptr;
+    if ( profiler != nullptr)
+        profiler->save( profile_to_save);
+    set_profiler( nullptr);
+    profiler = nullptr;
+    fetch.set_instr_trace( nullptr);
+    instr_trace = nullptr;
+
+    if ( statistics_output)
+        print_statistics( time);
+
+    if ( memory != nullptr)
+        writeback.check_final_state( *memory);
+    for ( uint32 thread = 1; thread <= thread_memories.size(); ++thread)
+        writeback.check_final_state( *thread_memories[ thread - 1], thread);
+    writeback.save_checkpoint();
+}
+
+template<typename ISA>
+Addr PerfSim<ISA>::load_binary( const std::string& tr)
+{
+    if ( shared_memory == nullptr)
+        own_memory = std::make_unique<Memory>( tr);
+    memory = shared_memory != nullptr ? shared_memory : own_memory.get();
+    fetch.set_memory( memory);
+    mem.set_memory( memory);
+    writeback.set_checkpoints( checkpoint_to_load, checkpoint_to_save);
+
+    // the checker is clocked apart from fetch, so it does not share their decoded instructions then
+    writeback.init_checker( tr, stage_threads > 1 ? nullptr : memory);
+    for ( uint32 thread = 1; thread <= thread_rfs.size(); ++thread)
+    {
+        thread_memories.push_back( std::make_unique<Memory>( tr));
+        fetch.set_memory( thread_memories.back().get(), thread);
+        mem.set_memory( thread_memories.back().get(), thread);
+        writeback.init_checker( tr, thread_memories.back().get(), thread);
+    }
+    if ( stage_threads > 1)
+    {
+        fetch.set_memory_lock( &stage_memory_lock);
+        mem.set_memory_lock( &stage_memory_lock);
+    }
+
+    const Addr PC = checkpoint_to_load.empty()
+                  ? memory->startPC()
+                  : checkpoint::load( checkpoint_to_load, rf.get(), memory);
+
+    if ( config::fast_forward + config::warmup > 0)
+        return fast_forward( tr, config::fast_forward, config::warmup);
+
+    return PC;
+}
+
+template<typename ISA>
+Addr PerfSim<ISA>::open_instr_trace( const std::string& filename)
+{
+    if ( !checkpoint_to_load.empty() || !checkpoint_to_save.empty())
+    {
+        std::cerr << "ERROR. Checkpoints are not supported in replay of instruction trace" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    instr_trace = std::make_unique<InstrTraceReader>( filename);
+
+    // results of instructions are taken from the trace, so there is nothing to check
+    writeback.disable_checker();
+
+    // records of fast-forward are skipped, warm-up uses them like functional simulation
+    for ( uint64 i = 0; i < config::fast_forward && instr_trace->peek() != nullptr; ++i)
+        instr_trace->next();
+
+    for ( uint64 i = 0; i < config::warmup && instr_trace->peek() != nullptr; ++i)
+    {
+        const auto instr = instr_trace->peek()->template get_instr<FuncInstr>();
+        fetch.warm_up( instr);
+        mem.warm_up( instr);
+        instr_trace->next();
+    }
+
+    const auto* record = instr_trace->peek();
+    if ( record == nullptr)
+        serr << "Instruction trace ends during fast-forward and warm-up" << std::endl << critical;
+
+    fetch.set_instr_trace( instr_trace.get());
+    return record->PC;
+}
+
+template<typename ISA>
+void PerfSim<ISA>::skip_idle_cycles()
+{
+    // units have no state changed by clock while fetch waits for instruction cache,
+    // so the cycles until the next token in ports do nothing
+    if ( !fetch.is_waiting_for_miss() || !decode.is_idle() || !execute.is_idle())
+        return;
+
+    const auto next_event_cycle = std::min( port_map->get_next_event_cycle(), fetch.get_miss_ready_cycle());
+    if ( next_event_cycle != NO_EVENT_CYCLE && curr_cycle < next_event_cycle)
+    {
+        cpi_stack.account_idle_cycles( next_event_cycle - curr_cycle);
+        curr_cycle = next_event_cycle;
+    }
+}
+
+template<typename ISA>
+void PerfSim<ISA>::open_stats_file()
+{
+    const std::string& filename = config::stats_file;
+    if ( filename.empty())
+        return;
+
+    stats_file = std::make_unique<StatsFile>( stats, filename, config::stats_format);
+    stats_interval = config::stats_interval;
+    next_stats_cycle = curr_cycle + Latency( static_cast<int64>( stats_interval));
+}
+
+template<typename ISA>
+void PerfSim<ISA>::write_stats()
+{
+    // cycles skipped while waiting for memory may pass several intervals
+    stats_file->write( get_cycles());
+    while ( next_stats_cycle <= curr_cycle)
+        next_stats_cycle = next_stats_cycle + Latency( static_cast<int64>( stats_interval));
+}
+
+template<typename ISA>
+void PerfSim<ISA>::open_phase_file()
+{
+    const std::string& filename = config::phase_file;
+    if ( filename.empty())
+        return;
+
+    const std::string& unit = config::phase_unit;
+    if ( unit != "instrs" && unit != "cycles")
+        serr << "ERROR. Invalid unit of phase intervals " << unit << ", supported units: instrs, cycles" << std::endl << critical;
+
+    if ( config::phase_interval == 0)
+        serr << "ERROR. Phase intervals must not be empty" << std::endl << critical;
+
+    // phases are detected by the CPI stack per instruction, the other metrics describe them
+    const std::string bp_prefix = "fetch.bp." + fetch.get_bp_mode();
+    std::vector<PhaseFile::Metric> metrics = {
+        { "ipc", { "writeback.instrs"}, { }, false, false},
+        { "bp_accuracy", { bp_prefix + ".mispredictions"}, { bp_prefix + ".jumps"}, true, false},
+        { "icache_miss_rate", { "fetch.icache.misses"}, { "fetch.icache.hits", "fetch.icache.misses"}, false, false}
+    };
+    for ( size_t i = 0; i < CPIStack::CATEGORIES_NUM; ++i)
+    {
+        const auto& name = "cpi_stack." + CPIStack::get_category_name( static_cast<CPIStack::Category>( i));
+        metrics.push_back( { name, { name}, { "writeback.instrs"}, false, true});
+    }
+
+    phase_file = std::make_unique<PhaseFile>( stats, filename, std::move( metrics), config::phase_threshold);
+    is_phase_by_instrs = unit == "instrs";
+    phase_interval = config::phase_interval;
+    next_phase_end = get_phase_position() + phase_interval;
+}
+
+template<typename ISA>
+uint64 PerfSim<ISA>::get_phase_position() const
+{
+    return is_phase_by_instrs ? get_executed_instrs() : ( get_cycles() - 0_Cl).to_size_t();
+}
+
+template<typename ISA>
+void PerfSim<ISA>::write_phase()
+{
+    // cycles skipped while waiting for memory may pass several intervals
+    phase_file->write( get_cycles(), get_executed_instrs());
+    while ( next_phase_end <= get_phase_position())
+        next_phase_end += phase_interval;
+}
+
+template<typename ISA>
+void PerfSim<ISA>::open_telemetry_file()
+{
+    const std::string& filename = config::telemetry_file;
+    if ( filename.empty())
+        return;
+
+    if ( config::telemetry_interval == 0)
+        serr << "ERROR. Interval of telemetry updates must not be empty" << std::endl << critical;
+
+    // counters of the disabled units are not registered
+    const std::string bp_prefix = "fetch.bp." + fetch.get_bp_mode();
+    const std::vector<std::string> candidates = { "fetch.icache.misses", bp_prefix + ".jumps", bp_prefix + ".mispredictions",
+                                                  "decode.stalls.data_hazard", "mem.dcache.l1.misses", "mem.dcache.stall_cycles"};
+    std::vector<std::string> counters;
+    for ( const auto& name : candidates)
+        if ( stats.has_counter( name))
+            counters.push_back( name);
+
+    telemetry_file = std::make_unique<TelemetryFile>( stats, filename, counters);
+    telemetry_interval = config::telemetry_interval;
+    next_telemetry_cycle = curr_cycle;
+}
+
+template<typename ISA>
+void PerfSim<ISA>::publish_telemetry()
+{
+    // cycles skipped while waiting for memory may pass several intervals
+    telemetry_file->publish( get_cycles(), get_executed_instrs());
+    while ( next_telemetry_cycle <= curr_cycle)
+        next_telemetry_cycle = next_telemetry_cycle + Latency( static_cast<int64>( telemetry_interval));
+}
+
+template<typename ISA>
+void PerfSim<ISA>::set_pipeline_trace( PipelineTrace* trace)
+{
+    fetch.set_pipeline_trace( trace);
+    decode.set_pipeline_trace( trace);
+    execute.set_pipeline_trace( trace);
+    mem.set_pipeline_trace( trace);
+    writeback.set_pipeline_trace( trace);
+}
+
+template<typename ISA>
+void PerfSim<ISA>::set_profiler( Profiler* value)
+{
+    fetch.set_profiler( value);
+    writeback.set_profiler( value);
+}
+
+template<typename ISA>
+Addr PerfSim<ISA>::fast_forward( const std::string& tr, uint64 skip_instrs, uint64 warmup_instrs)
+{
+    FuncSim<ISA> func_sim;
+    func_sim.set_checkpoints( checkpoint_to_load, "");
+    func_sim.run( tr, skip_instrs);
+
+    bool is_halted = func_sim.is_halted();
+    for ( uint64 i = 0; i < warmup_instrs && !is_halted; ++i)
+    {
+        const auto instr = func_sim.step();
+        fetch.warm_up( instr);
+        mem.warm_up( instr);
+        is_halted = instr.is_halt();
+    }
+
+    if ( is_halted)
+        serr << "Program is halted by functional simulation during fast-forward and warm-up"
+             << std::endl << critical;
+
+    // architectural state is moved to the pipeline as a checkpoint in memory
+    std::stringstream state;
+    func_sim.save_checkpoint( state);
+    const Addr PC = checkpoint::load( state, rf.get(), memory, "fast-forward state");
 
+    state.seekg( 0);
+    writeback.fast_forward( state, skip_instrs + warmup_instrs);
+    return PC;
+}
+
+template<typename ISA>
+void PerfSim<ISA>::print_statistics( double time) const
+{
     auto executed_instrs = writeback.get_executed_instrs();
-    auto time = std::chrono::duration<double, std::milli>(t_end - t_start).count();
-    auto frequency = static_cast<double>( curr_cycle) / time; // cycles per millisecond = kHz
-    auto ipc = 1.0 * executed_instrs / static_cast<double>( curr_cycle);
+    auto frequency = static_cast<double>( get_cycles()) / time; // cycles per millisecond = kHz
+    auto ipc = 1.0 * executed_instrs / static_cast<double>( get_cycles());
     auto simips = executed_instrs / time;
 
     std::cout << std::endl << "****************************"
               << std::endl << "instrs:     " << executed_instrs
-              << std::endl << "cycles:     " << curr_cycle
+              << std::endl << "cycles:     " << get_cycles()
               << std::endl << "IPC:        " << ipc
               << std::endl << "sim freq:   " << frequency << " kHz"
               << std::endl << "sim IPS:    " << simips    << " kips"
-              << std::endl << "instr size: " << sizeof(Instr) << " bytes"
-              << std::endl << "****************************"
+              << std::endl << "instr size: " << sizeof(Instr) << " bytes";
+
+    for ( uint32 thread = 0; !thread_rfs.empty() && thread <= thread_rfs.size(); ++thread)
+        std::cout << std::endl << "thread " << thread << ":   " << writeback.get_executed_instrs( thread) << " instrs, IPC "
+                  << 1.0 * writeback.get_executed_instrs( thread) / static_cast<double>( get_cycles());
+
+    // replayed instructions do not access memory
+    if ( memory != nullptr)
+        std::cout << std::endl << "fetch TLB:  " << memory->get_instr_tlb().get_hits() << " hits, "
+                                                << memory->get_instr_tlb().get_misses() << " misses"
+                  << std::endl << "data TLB:   " << memory->get_data_tlb().get_hits() << " hits, "
+                                                << memory->get_data_tlb().get_misses() << " misses";
+
+    std::cout << std::endl << "icache:     " << fetch.get_icache_statistics().demand_misses << " misses";
+
+    if ( fetch.has_prefetcher())
+    {
+        const auto& icache = fetch.get_icache_statistics();
+        std::cout << std::endl << "prefetches: " << icache.prefetches << " issued, "
+                                                << icache.useful_prefetches << " useful, "
+                                                << icache.get_accuracy() * 100 << "% accuracy, "
+                                                << icache.get_coverage() * 100 << "% coverage";
+    }
+
+    if ( mem.get_data_cache() != nullptr)
+    {
+        const auto print_cache = []( const std::string& name, const CacheLevel& cache) {
+            std::cout << std::endl << name << cache.get_hits() << " hits, "
+                                           << cache.get_misses() << " misses, "
+                                           << cache.get_writebacks() << " writebacks";
+        };
+        print_cache( "L1 dcache:  ", mem.get_data_cache()->get_l1());
+        if ( mem.get_data_cache()->get_l2() != nullptr)
+            print_cache( "L2 cache:   ", *mem.get_data_cache()->get_l2());
+        std::cout << std::endl << "dcache stall: " << mem.get_stall_cycles() << " cycles";
+
+        const auto& dcache = *mem.get_data_cache();
+        if ( dcache.has_prefetcher())
+            std::cout << std::endl << "dprefetches: " << dcache.get_prefetches() << " issued, "
+                                                    << dcache.get_useful_prefetches() << " useful, "
+                                                    << dcache.get_late_prefetches() << " late, "
+                                                    << dcache.get_prefetch_pollution() << " misses of evicted lines";
+    }
+
+    std::cout << std::endl;
+    cpi_stack.print( std::cout, executed_instrs);
+    if constexpr ( SelfProfiler::is_enabled)
+    {
+        std::cout << std::endl;
+        SelfProfiler::print( std::cout, time, static_cast<double>( get_cycles()));
+    }
+    print_hot_branches();
+
+    std::cout << std::endl << "****************************"
               << std::endl;
 }
 
+template<typename ISA>
+void PerfSim<ISA>::print_hot_branches() const
+{
+    const auto branches = fetch.get_hot_branches();
+    if ( branches.empty())
+        return;
+
+    const auto total = static_cast<double>( fetch.get_mispredictions());
+    std::cout << std::endl << "hot branches:";
+    for ( const auto& branch : branches)
+    {
+        std::cout << std::endl << "  " << branch.mispredictions << " mispredictions ("
+                  << branch.mispredictions * 100 / total << "%";
+        if ( branch.error != 0)
+            std::cout << ", up to " << branch.error << " before tracking";
+        std::cout << "), " << branch.executions << " executions, " << branch.get_taken_rate() * 100 << "% taken: ";
+
+        // replayed instructions are not in memory
+        if ( memory != nullptr)
+            std::cout << FuncInstr( memory->fetch( branch.PC), branch.PC);
+        else
+            std::cout << "0x" << std::hex << branch.PC << std::dec;
+    }
+}
+
 
 
 #include <mips/mips.h>
 #include <risc_v/risc_v.h>
 
 template class PerfSim<MIPS>;
+template class PerfSim<RISCV32>;
+template class PerfSim<RISCV64>;
+template class PerfSim<RISCV128>;
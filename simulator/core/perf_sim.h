@@ -8,18 +8,36 @@
 
 #include <array>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <vector>
 #include <iomanip>
 
 #include <simulator.h>
 #include <infra/ports/ports.h>
+#include <infra/stats/phases.h>
+#include <infra/stats/stats.h>
+#include <infra/stats/telemetry.h>
 #include <fetch/fetch.h>
 #include <decode/decode.h>
 #include <execute/execute.h>
 #include <mem/mem.h>
 #include <writeback/writeback.h>
 
+#include "cpi_stack.h"
 #include "perf_instr.h"
+#include "pipeline_depth.h"
+#include "pipeline_trace.h"
+#include "smt.h"
+
+// number of instructions handled by each pipeline stage per cycle
+uint32 get_pipeline_width();
+
+// numbers of sub-stages of in-order pipeline and the stage resolving jumps
+PipelineDepth get_pipeline_depth();
+
+// number of hardware threads sharing the in-order pipeline
+uint32 get_pipeline_threads();
 
 template <typename ISA>
 class PerfSim : public Simulator
@@ -29,27 +47,117 @@ class PerfSim : public Simulator
     using Memory = typename ISA::Memory;
 
 private:
+    // Ports of all the units are bound within this map, so it goes first
+    std::shared_ptr<PortMap> port_map = PortMap::create_port_map();
+
     Cycle curr_cycle = 0_Cl;
+    bool statistics_output = true;
 
     /* simulator units */
     std::unique_ptr<RF<ISA>> rf = nullptr;
+    std::unique_ptr<Memory> own_memory = nullptr; // memory loaded by the core, it is freed with the simulator
     Memory* memory = nullptr;
+    Memory* shared_memory = nullptr; // memory of other cores, it is used instead of a new one
+
+    /* registers and memories of the other hardware threads, they run copies of the program */
+    std::vector<std::unique_ptr<RF<ISA>>> thread_rfs = {};
+    std::vector<std::unique_ptr<Memory>> thread_memories = {};
     Fetch<ISA> fetch;
     Decode<ISA> decode;
     Execute<ISA> execute;
     Mem<ISA> mem;
     Writeback<ISA> writeback;
 
+    /* counters of all the units, they are written to a file if requested */
+    StatsRegistry stats;
+    CPIStack cpi_stack;
+    std::unique_ptr<StatsFile> stats_file = nullptr;
+    uint64 stats_interval = 0;
+    Cycle next_stats_cycle = 0_Cl;
+
+    /* intervals of instructions or cycles classified into phases, written if requested */
+    std::unique_ptr<PhaseFile> phase_file = nullptr;
+    bool is_phase_by_instrs = true;
+    uint64 phase_interval = 0;
+    uint64 next_phase_end = 0;
+
+    /* progress and key counters shared with other processes, published if requested */
+    std::unique_ptr<TelemetryFile> telemetry_file = nullptr;
+    uint64 telemetry_interval = 0;
+    Cycle next_telemetry_cycle = 0_Cl;
+
+    /* events of instructions in stages, recorded if requested */
+    std::unique_ptr<PipelineTrace> pipeline_trace = nullptr;
+
+    /* events of guest functions, counted if requested */
+    std::unique_ptr<Profiler> profiler = nullptr;
+
+    /* instructions are replayed from the trace instead of the binary if requested */
+    std::unique_ptr<InstrTraceReader> instr_trace = nullptr;
+
     /* ports */
-    std::unique_ptr<WritePort<Addr>> wp_core_2_fetch_target = nullptr;
+    std::vector<std::unique_ptr<WritePort<Addr>>> wps_core_2_fetch_target = {}; // PC of each thread
     std::unique_ptr<ReadPort<bool>> rp_halt = nullptr;
 
+    bool is_cycle_skipping = true;
+
+    // Stages read only the tokens written in the previous cycles,
+    // so they are clocked in parallel threads if requested.
+    // Writeback updates the register file read by decode in the same cycle,
+    // so they are clocked together, and fetch and memory stage are
+    // synchronized by the lock of memory.
+    const uint32 stage_threads;
+    std::mutex stage_memory_lock = {};
+    static constexpr const size_t STAGE_GROUPS = 4;
+    void clock_stage_group( size_t group, Cycle cycle);
+    void run_in_threads();
+
+    // checks the halt and moves the clock before the stages are clocked, returns false after the halt
+    bool begin_cycle();
+    void end_cycle();
+
+    // return PC to start performance simulation from
+    Addr load_binary( const std::string& tr);
+    Addr open_instr_trace( const std::string& filename);
+    Addr fast_forward( const std::string& tr, uint64 skip_instrs, uint64 warmup_instrs);
+    void print_statistics( double time) const;
+    void print_hot_branches() const;
+    void open_stats_file();
+    void write_stats();
+    void open_phase_file();
+    uint64 get_phase_position() const;
+    void write_phase();
+    void open_telemetry_file();
+    void publish_telemetry();
+    void set_pipeline_trace( PipelineTrace* trace);
+    void set_profiler( Profiler* value);
+
+    // moves the clock to the next cycle when something happens in the pipeline
+    void skip_idle_cycles();
+
 public:
     explicit PerfSim( bool log);
-    ~PerfSim() final { destroy_ports(); }
+    ~PerfSim() final { port_map->destroy(); }
     void run( const std::string& tr, uint64 instrs_to_run) final;
     void set_PC( Addr value) final;
 
+    // The run is split into parts for simulation of several cores,
+    // step simulates a cycle and returns false after the halt
+    void start( const std::string& tr, uint64 instrs_to_run);
+    bool step();
+    void finish( double time);
+
+    // the core is one of cores sharing memory: the program gets number of the core in its first argument,
+    // data cache is kept coherent by the directory, the lock is set if cores are simulated in parallel threads
+    void set_core( uint32 id, Memory* common_memory, CoherenceDirectory* directory, std::mutex* memory_lock);
+
+    // Results of the run, they are printed unless the output is disabled
+    auto get_executed_instrs() const { return writeback.get_executed_instrs(); }
+    Cycle get_cycles() const { return curr_cycle + mem.get_stall_cycles(); }
+    void set_statistics_output( bool value) { statistics_output = value; }
+    const StatsRegistry& get_stats() const { return stats; }
+    const CPIStack& get_cpi_stack() const { return cpi_stack; }
+
     // Rule of five
     PerfSim( const PerfSim&) = delete;
     PerfSim( PerfSim&&) = delete;
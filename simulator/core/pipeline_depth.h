@@ -0,0 +1,37 @@
+/*
+ * pipeline_depth.h - numbers of sub-stages of in-order pipeline
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef PIPELINE_DEPTH_H
+#define PIPELINE_DEPTH_H
+
+#include <infra/ports/timing.h>
+
+/*
+ * Each stage may take several cycles. Instructions are issued by the last
+ * decode sub-stage, so the previous ones and fetch sub-stages only delay them.
+ * Execute sub-stages are added to latencies of all the functional units.
+ * Results are bypassed from each memory sub-stage, loads have data at the last one.
+ * Jumps are resolved at the end of execute stage or at the first memory sub-stage.
+ */
+struct PipelineDepth
+{
+    uint32 fetch_stages = 1;
+    uint32 decode_stages = 1;
+    uint32 execute_stages = 1;
+    uint32 memory_stages = 1;
+    bool is_branch_resolved_in_execute = false;
+
+    // cycles from fetch of an instruction to its issue
+    Latency get_frontend_latency() const { return Latency( fetch_stages + decode_stages - 1); }
+
+    // pipeline of five one-cycle stages resolving jumps at memory stage
+    bool is_classic() const
+    {
+        return fetch_stages == 1 && decode_stages == 1 && execute_stages == 1 && memory_stages == 1
+            && !is_branch_resolved_in_execute;
+    }
+};
+
+#endif // PIPELINE_DEPTH_H
@@ -0,0 +1,166 @@
+/*
+ * pipeline_trace.cpp - compact binary trace of the pipeline stages passed by instructions
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "pipeline_trace.h"
+
+#include <mips/mips.h>
+#include <risc_v/risc_v.h>
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+const char PipelineTrace::MAGIC[8] = { 'M', 'I', 'P', 'T', 'P', 'T', '0', '1'};
+
+PipelineTrace::PipelineTrace( const std::string& filename) : writer( filename)
+{
+    writer.write( MAGIC, sizeof( MAGIC));
+}
+
+static void report_corrupted_trace()
+{
+    std::cerr << "ERROR. Pipeline trace is corrupted" << std::endl;
+    std::exit( EXIT_FAILURE);
+}
+
+static uint64 get_unsigned( std::istream& trace)
+{
+    uint64 value = 0;
+    if ( !get_varint( trace, &value))
+        report_corrupted_trace();
+    return value;
+}
+
+// names of stages for Konata, they are started by the events
+static const std::array<const char*, 5> stage_names = {{ "F", "Dc", "Ex", "Mm", "Wb"}};
+
+template <typename ISA>
+void convert_pipeline_trace( std::istream& trace, const std::string& binary, std::ostream& out)
+{
+    std::array<char, sizeof( PipelineTrace::MAGIC)> magic = {{}};
+    trace.read( magic.data(), magic.size());
+    if ( !trace || std::memcmp( magic.data(), PipelineTrace::MAGIC, magic.size()) != 0)
+    {
+        std::cerr << "ERROR. Pipeline trace has wrong format" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    typename ISA::Memory memory( binary);
+
+    // stages of instructions in flight
+    std::unordered_map<uint64, PipelineEvent> stages;
+    std::vector<uint64> retired_in_cycle;
+    uint64 last_id = 0;
+    uint64 retired = 0;
+    Addr last_PC = 0;
+
+    // instructions are shown in writeback stage until the next cycle
+    const auto retire = [&]() {
+        for ( const auto id : retired_in_cycle)
+            out << "R\t" << id << '\t' << retired++ << "\t0\n";
+        retired_in_cycle.clear();
+    };
+
+    const auto flush = [&]( uint64 id, PipelineEvent stage) {
+        out << "E\t" << id << "\t0\t" << stage_names.at( static_cast<size_t>( stage)) << '\n'
+            << "R\t" << id << '\t' << id << "\t1\n";
+    };
+
+    const auto start_stage = [&]( uint64 id, PipelineEvent stage) {
+        auto& current = stages[ id];
+        out << "E\t" << id << "\t0\t" << stage_names.at( static_cast<size_t>( current)) << '\n'
+            << "S\t" << id << "\t0\t" << stage_names.at( static_cast<size_t>( stage)) << '\n';
+        current = stage;
+    };
+
+    out << "Kanata\t0004\nC=\t0\n";
+    for ( auto byte = trace.get(); byte != std::char_traits<char>::eof(); byte = trace.get())
+    {
+        if ( byte >= static_cast<int>( PipelineEvent::EVENTS_NUM))
+            report_corrupted_trace();
+
+        const auto event = static_cast<PipelineEvent>( byte);
+        const auto cycles = get_unsigned( trace);
+        if ( cycles != 0)
+        {
+            retire();
+            out << "C\t" << cycles << '\n';
+        }
+
+        if ( event == PipelineEvent::FETCH)
+        {
+            last_PC += static_cast<Addr>( zigzag_decode( get_unsigned( trace)));
+            const auto id = ++last_id;
+            out << "I\t" << id << '\t' << id << "\t0\n"
+                << "L\t" << id << "\t0\t" << memory.fetch_instr( last_PC) << '\n'
+                << "S\t" << id << "\t0\t" << stage_names[ 0] << '\n';
+            stages.emplace( id, PipelineEvent::FETCH);
+            continue;
+        }
+
+        const auto distance = get_unsigned( trace);
+        const auto id = last_id - distance;
+        const auto it = stages.find( id);
+        if ( distance > last_id || it == stages.end())
+            report_corrupted_trace();
+
+        switch ( event)
+        {
+            case PipelineEvent::STALL:
+            case PipelineEvent::DECODE:
+                if ( it->second == PipelineEvent::FETCH)
+                    start_stage( id, PipelineEvent::DECODE);
+                break;
+            case PipelineEvent::FLUSH:
+                flush( id, it->second);
+                stages.erase( it);
+                break;
+            case PipelineEvent::WRITEBACK:
+                start_stage( id, event);
+                stages.erase( id);
+                retired_in_cycle.push_back( id);
+                break;
+            default:
+                start_stage( id, event);
+                break;
+        }
+    }
+    out << "C\t1\n";
+    retire();
+
+    // instructions in flight at the end of simulation are never retired
+    std::map<uint64, PipelineEvent> in_flight( stages.begin(), stages.end());
+    for ( const auto& instr : in_flight)
+        flush( instr.first, instr.second);
+}
+
+void convert_pipeline_trace( const std::string& isa, const std::string& trace_file,
+                             const std::string& binary, std::ostream& out)
+{
+    std::ifstream trace( trace_file, std::ios::binary);
+    if ( !trace.is_open())
+    {
+        std::cerr << "ERROR. Could not open pipeline trace " << trace_file << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    if ( isa == "mips")
+        convert_pipeline_trace<MIPS>( trace, binary, out);
+    else if ( isa == "riscv32")
+        convert_pipeline_trace<RISCV32>( trace, binary, out);
+    else if ( isa == "riscv64")
+        convert_pipeline_trace<RISCV64>( trace, binary, out);
+    else if ( isa == "riscv128")
+        convert_pipeline_trace<RISCV128>( trace, binary, out);
+    else
+    {
+        std::cerr << "ERROR. Pipeline traces are not supported for ISA " << isa << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+}
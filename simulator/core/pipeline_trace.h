@@ -0,0 +1,90 @@
+/*
+ * pipeline_trace.h - compact binary trace of the pipeline stages passed by instructions
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef PIPELINE_TRACE_H
+#define PIPELINE_TRACE_H
+
+#include <infra/async_writer/async_writer.h>
+#include <infra/ports/timing.h>
+#include <infra/types.h>
+#include <infra/varint.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+enum class PipelineEvent : uint8
+{
+    FETCH,
+    DECODE,    // the instruction is issued
+    EXECUTE,
+    MEM,
+    WRITEBACK, // the instruction is retired
+    STALL,     // decode holds the instruction for one more cycle
+    FLUSH,     // the instruction is dropped
+    EVENTS_NUM
+};
+
+/*
+ * Events are written in order of cycles. Each record has the event type byte,
+ * the distance from the cycle of the previous record and the difference between
+ * identifiers of the last fetched instruction and the instruction of the event,
+ * both as variable-length integers. Instructions are numbered in order of fetch,
+ * so fetch records keep only the distance from the PC of the previous fetch.
+ * Usually a record takes two or three bytes.
+ */
+class PipelineTrace
+{
+    public:
+        explicit PipelineTrace( const std::string& filename);
+
+        // returns identifier of the fetched instruction
+        uint64 fetch( Addr PC, Cycle cycle)
+        {
+            put_header( PipelineEvent::FETCH, cycle);
+            put_varint( &writer, zigzag_encode( static_cast<int64>( PC - last_PC)));
+            last_PC = PC;
+            return ++last_id;
+        }
+
+        void record( PipelineEvent event, uint64 id, Cycle cycle)
+        {
+            put_header( event, cycle);
+            put_varint( &writer, last_id - id);
+        }
+
+        static const char MAGIC[8];
+
+    private:
+        AsyncWriter writer;
+        Cycle last_cycle = 0_Cl;
+        Addr last_PC = 0;
+        uint64 last_id = 0;
+
+        void put_header( PipelineEvent event, Cycle cycle)
+        {
+            writer.put( static_cast<char>( event));
+            put_varint( &writer, ( cycle - last_cycle).to_size_t());
+            last_cycle = cycle;
+        }
+};
+
+// records the event if the trace is enabled, bubbles are not traced
+template <typename Instr>
+inline void trace_event( PipelineTrace* trace, PipelineEvent event, const Instr& instr, Cycle cycle)
+{
+    if ( trace != nullptr && instr.get_trace_id() != 0)
+        trace->record( event, instr.get_trace_id(), cycle);
+}
+
+// prints the trace recorded from the binary in Konata format, disassembly is taken from the binary
+template <typename ISA>
+void convert_pipeline_trace( std::istream& trace, const std::string& binary, std::ostream& out);
+
+// runs the conversion for the ISA of the simulator
+void convert_pipeline_trace( const std::string& isa, const std::string& trace_file,
+                             const std::string& binary, std::ostream& out);
+
+#endif // PIPELINE_TRACE_H
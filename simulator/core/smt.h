@@ -0,0 +1,26 @@
+/*
+ * smt.h - hardware threads sharing the in-order pipeline
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef SMT_H
+#define SMT_H
+
+#include <infra/types.h>
+
+#include <array>
+#include <string>
+
+// up to 4 hardware threads share the pipeline, SMT is off with a single one
+static constexpr const uint32 MAX_HW_THREADS = 4;
+
+// numbers of instructions of each thread
+using ThreadCounts = std::array<uint32, MAX_HW_THREADS>;
+
+// each thread has its own copy of a per-thread port, the ones of thread 0 keep the names of single-threaded pipeline
+inline std::string get_thread_port_name( const std::string& name, uint32 thread)
+{
+    return thread == 0 ? name : name + "_THREAD" + std::to_string( thread);
+}
+
+#endif // SMT_H
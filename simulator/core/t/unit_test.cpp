@@ -1,20 +1,55 @@
 // generic C
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
 
 // Google Test library
 #include <gtest/gtest.h>
 
 // Module
+#include <func_sim/func_sim.h>
+#include <infra/config/config.h>
 #include <mips/mips.h>
+#include <risc_v/risc_v.h>
+#include "../multicore_sim.h"
+#include "../ooo_perf_sim.h"
 #include "../perf_sim.h"
 
 static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
 static const std::string smc_code = TEST_PATH "/smc.out";
+static const std::string riscv_elf_file = TEST_PATH "/riscv_fib.out";
 
 #define GTEST_ASSERT_NO_DEATH(statement) \
     ASSERT_EXIT({{ statement } ::exit(EXIT_SUCCESS); }, ::testing::ExitedWithCode(0), "")
 
+// all the allocations of the test program are counted
+static std::atomic<uint64> allocations{ 0};
+
+void* operator new( std::size_t size)
+{
+    ++allocations;
+    void* pointer = std::malloc( size == 0 ? 1 : size);
+    if ( pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+// GCC does not know that the replaced operator new is malloc
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete( void* pointer) noexcept { std::free( pointer); }
+void operator delete( void* pointer, std::size_t) noexcept { std::free( pointer); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
 TEST( Perf_Sim_init, Process_Correct_Args_Of_Constr)
 {
     // Just call a constructor
@@ -47,6 +82,872 @@ TEST( Perf_Sim, Run_SMC_Trace)
                  ::testing::ExitedWithCode( EXIT_FAILURE), "Mismatch:.*");
 }
 
+TEST( Perf_Sim, Run_Two_Simulators)
+{
+    // each simulator has own ports, so they do not interfere
+    PerfSim<MIPS> mips( false);
+    PerfSim<MIPS> other( false);
+    GTEST_ASSERT_NO_DEATH( mips.run( valid_elf_file, 100); );
+    GTEST_ASSERT_NO_DEATH( other.run_no_limit( valid_elf_file); );
+}
+
+TEST( Perf_Sim, Checkpoints)
+{
+    FuncSim<MIPS> func_sim;
+    func_sim.set_checkpoints( "", "./func_sim_for_perf.ckpt");
+    func_sim.run( valid_elf_file, 3000);
+
+    // continue with the checker, then save the state after 3000 more instructions
+    PerfSim<MIPS> mips( false);
+    mips.set_checkpoints( "./func_sim_for_perf.ckpt", "./perf_sim.ckpt");
+    mips.run( valid_elf_file, 3000);
+
+    FuncSim<MIPS> full;
+    full.run( valid_elf_file, 6000);
+
+    FuncSim<MIPS> restored;
+    restored.init( valid_elf_file);
+    restored.load_checkpoint( "./perf_sim.ckpt");
+    ASSERT_EQ( restored.get_rf().hash(), full.get_rf().hash());
+    ASSERT_EQ( restored.step().Dump(), full.step().Dump());
+}
+
+TEST( Perf_Sim, Fast_Forward_And_Warm_Up)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "fast-forward", "4000"}, { "warmup", "1000"}});
+
+    // the checker is synchronized with the state after fast-forward
+    PerfSim<MIPS> mips( false);
+    GTEST_ASSERT_NO_DEATH( mips.run_no_limit( valid_elf_file); );
+}
+
+TEST( Perf_Sim, Skip_Idle_Cycles)
+{
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    // skipping of instruction cache misses does not change timings
+    config::LocalValues options( std::map<std::string, std::string>{ { "no-cycle-skipping", "true"}});
+    PerfSim<MIPS> other( false);
+    other.set_statistics_output( false);
+    other.run_no_limit( valid_elf_file);
+
+    ASSERT_EQ( mips.get_executed_instrs(), other.get_executed_instrs());
+    ASSERT_EQ( mips.get_cycles(), other.get_cycles());
+}
+
+TEST( Perf_Sim, Instruction_Prefetch)
+{
+    config::LocalValues small_cache( std::map<std::string, std::string>{ { "icache-size", "256"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    for ( const auto& prefetcher : { "next-line", "stream"})
+    {
+        config::LocalValues prefetch( std::map<std::string, std::string>{ { "icache-prefetch", prefetcher}});
+        PerfSim<MIPS> other( false);
+        other.set_statistics_output( false);
+        other.run_no_limit( valid_elf_file);
+
+        // both prefetchers keep ahead of sequential fetch, so most of the missed lines are prefetched
+        const auto& stats = other.get_stats();
+        ASSERT_EQ( mips.get_executed_instrs(), other.get_executed_instrs());
+        ASSERT_LT( other.get_cycles(), mips.get_cycles()) << prefetcher;
+        ASSERT_GT( stats.get_counter( "fetch.icache.useful_prefetches"), stats.get_counter( "fetch.icache.demand_misses")) << prefetcher;
+    }
+}
+
+TEST( Perf_Sim, Data_Prefetchers)
+{
+    const std::string sort = TEST_PATH "/bench/sort.out";
+    config::LocalValues small_cache( std::map<std::string, std::string>{ { "dcache-size", "1024"}});
+    PerfSim<MIPS> plain( false);
+    plain.set_statistics_output( false);
+    plain.run( sort, 200000);
+
+    for ( const auto& prefetcher : { "stride", "stream"})
+    {
+        config::LocalValues prefetch( std::map<std::string, std::string>{ { "dcache-prefetch", prefetcher}});
+        PerfSim<MIPS> mips( false);
+        mips.set_statistics_output( false);
+        mips.run( sort, 200000);
+
+        ASSERT_EQ( mips.get_executed_instrs(), plain.get_executed_instrs());
+        ASSERT_LT( mips.get_cycles(), plain.get_cycles()) << prefetcher;
+        ASSERT_GT( mips.get_stats().get_counter( "mem.dcache.useful_prefetches"), 0u) << prefetcher;
+        ASSERT_LE( mips.get_stats().get_counter( "mem.dcache.useful_prefetches"),
+                   mips.get_stats().get_counter( "mem.dcache.prefetches")) << prefetcher;
+        ASSERT_LT( mips.get_stats().get_counter( "mem.dcache.l1.misses"), plain.get_stats().get_counter( "mem.dcache.l1.misses")) << prefetcher;
+    }
+}
+
+TEST( Perf_Sim, Superscalar)
+{
+    PerfSim<MIPS> scalar( false);
+    scalar.set_statistics_output( false);
+    scalar.run_no_limit( valid_elf_file);
+
+    // results of wide pipelines are compared with the checker
+    config::LocalValues two_wide( std::map<std::string, std::string>{ { "width", "2"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    config::LocalValues four_wide( std::map<std::string, std::string>{ { "width", "4"}});
+    PerfSim<MIPS> other( false);
+    other.set_statistics_output( false);
+    other.run_no_limit( valid_elf_file);
+
+    ASSERT_EQ( scalar.get_executed_instrs(), mips.get_executed_instrs());
+    ASSERT_EQ( scalar.get_executed_instrs(), other.get_executed_instrs());
+    ASSERT_LT( mips.get_cycles(), scalar.get_cycles());
+    ASSERT_LE( other.get_cycles(), mips.get_cycles());
+}
+
+TEST( Perf_Sim, Pipeline_Depth)
+{
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    // results of deep pipelines are compared with the checker
+    config::LocalValues deep( std::map<std::string, std::string>{ { "fetch-stages", "3"}, { "execute-stages", "2"}, { "memory-stages", "3"}});
+    PerfSim<MIPS> other( false);
+    other.set_statistics_output( false);
+    other.run_no_limit( valid_elf_file);
+
+    ASSERT_EQ( mips.get_executed_instrs(), other.get_executed_instrs());
+    ASSERT_LT( mips.get_cycles(), other.get_cycles());
+}
+
+TEST( Perf_Sim, Branch_Resolution_In_Execute)
+{
+    config::LocalValues late( std::map<std::string, std::string>{ { "width", "2"}, { "memory-stages", "3"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    config::LocalValues early( std::map<std::string, std::string>{ { "width", "2"}, { "memory-stages", "3"}, { "branch-resolution", "execute"}});
+    PerfSim<MIPS> other( false);
+    other.set_statistics_output( false);
+    other.run_no_limit( valid_elf_file);
+
+    ASSERT_EQ( mips.get_executed_instrs(), other.get_executed_instrs());
+    ASSERT_LE( other.get_cycles(), mips.get_cycles());
+}
+
+TEST( Perf_Sim_init, Zero_Memory_Stages)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "memory-stages", "0"}});
+    ASSERT_EXIT( PerfSim<MIPS> mips( false),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim, Parallel_Stages)
+{
+    config::LocalValues sequential( std::map<std::string, std::string>{ { "width", "2"}, { "memory-stages", "2"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    // stages see only the tokens of the previous cycles, so timing is the same
+    for ( const auto* threads : { "2", "3", "4"})
+    {
+        config::LocalValues parallel( std::map<std::string, std::string>{ { "width", "2"}, { "memory-stages", "2"}, { "stage-threads", threads}});
+        PerfSim<MIPS> other( false);
+        other.set_statistics_output( false);
+        other.run_no_limit( valid_elf_file);
+
+        ASSERT_EQ( mips.get_executed_instrs(), other.get_executed_instrs());
+        ASSERT_EQ( mips.get_cycles(), other.get_cycles());
+    }
+}
+
+TEST( Perf_Sim_init, Invalid_Stage_Threads)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "stage-threads", "5"}});
+    ASSERT_EXIT( PerfSim<MIPS> mips( false),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+
+    config::LocalValues traced( std::map<std::string, std::string>{ { "stage-threads", "2"}});
+    ASSERT_EXIT( PerfSim<MIPS> mips( true),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim_init, Invalid_Branch_Resolution)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "branch-resolution", "decode"}});
+    ASSERT_EXIT( PerfSim<MIPS> mips( false),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim_init, Zero_Instruction_Prefetch_Degree)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "icache-prefetch-degree", "0"}});
+    GTEST_ASSERT_NO_DEATH( PerfSim<MIPS> mips( false); );
+
+    for ( const auto& prefetcher : { "next-line", "stream"})
+    {
+        config::LocalValues prefetch( std::map<std::string, std::string>{ { "icache-prefetch", prefetcher}});
+        ASSERT_EXIT( PerfSim<MIPS> mips( false),
+                     ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    }
+}
+
+TEST( Perf_Sim_init, Zero_Width)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "width", "0"}});
+    ASSERT_EXIT( PerfSim<MIPS> mips( false),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim, Functional_Unit_Latency)
+{
+    config::LocalValues single_cycle( std::map<std::string, std::string>{ { "mul-latency", "1"}, { "div-latency", "1"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    // results of multi-cycle units are compared with the checker
+    config::LocalValues multi_cycle( std::map<std::string, std::string>{ { "width", "2"}, { "alu-latency", "2"}, { "agu-latency", "3"}});
+    PerfSim<MIPS> other( false);
+    other.set_statistics_output( false);
+    other.run_no_limit( valid_elf_file);
+
+    ASSERT_EQ( mips.get_executed_instrs(), other.get_executed_instrs());
+    ASSERT_LT( mips.get_cycles(), other.get_cycles());
+}
+
+TEST( Perf_Sim, Iterative_Units)
+{
+    config::LocalValues pipelined( std::map<std::string, std::string>{ { "iterative-units", "none"}, { "alu-latency", "3"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    config::LocalValues iterative( std::map<std::string, std::string>{ { "iterative-units", "alu,div"}, { "alu-latency", "3"}});
+    PerfSim<MIPS> other( false);
+    other.set_statistics_output( false);
+    other.run_no_limit( valid_elf_file);
+
+    ASSERT_EQ( mips.get_executed_instrs(), other.get_executed_instrs());
+    ASSERT_LT( mips.get_cycles(), other.get_cycles());
+}
+
+TEST( Perf_Sim_init, Invalid_Functional_Units)
+{
+    {
+        config::LocalValues zero_latency( std::map<std::string, std::string>{ { "mul-latency", "0"}});
+        ASSERT_EXIT( PerfSim<MIPS> mips( false),
+                     ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    }
+
+    config::LocalValues unknown_unit( std::map<std::string, std::string>{ { "iterative-units", "fpu"}});
+    ASSERT_EXIT( PerfSim<MIPS> mips( false),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*function.*");
+}
+
+TEST( Perf_Sim, Stats_Registry)
+{
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    const auto& stats = mips.get_stats();
+    ASSERT_EQ( stats.get_counter( "writeback.instrs"), mips.get_executed_instrs());
+    ASSERT_GE( stats.get_counter( "decode.instrs"), mips.get_executed_instrs());
+    ASSERT_GE( stats.get_counter( "fetch.instrs"), stats.get_counter( "decode.instrs"));
+    ASSERT_EQ( stats.get_counter( "mem.flushes"), stats.get_counter( "fetch.bp.dynamic_two_bit.mispredictions"));
+    ASSERT_EQ( stats.get_counter( "fetch.icache.demand_misses"), stats.get_counter( "fetch.icache.misses"));
+    ASSERT_NE( stats.get_counter( "decode.stalls.data_hazard"), 0u);
+    ASSERT_NE( stats.get_counter( "decode.bypass.execute"), 0u);
+    ASSERT_TRUE( stats.has_counter( "mem.dcache.l1.hits"));
+    ASSERT_FALSE( stats.has_counter( "mem.dcache.l2.hits"));
+}
+
+TEST( Perf_Sim, Stats_File)
+{
+    config::LocalValues periodic( std::map<std::string, std::string>{ { "stats-file", "perf_sim_stats.csv"}, { "stats-format", "csv"}, { "stats-interval", "1000"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    std::ifstream file( "perf_sim_stats.csv");
+    std::string header;
+    std::getline( file, header);
+    ASSERT_EQ( header.find( "cycle,fetch.instrs,"), 0u);
+
+    // snapshots are written every 1000 cycles and at the end,
+    // intervals skipped by the clock are merged into one snapshot
+    uint64 rows = 0;
+    for ( std::string row; std::getline( file, row);)
+        ++rows;
+    ASSERT_GT( rows, 1u);
+    ASSERT_LE( rows, static_cast<uint64>( static_cast<double>( mips.get_cycles())) / 1000 + 1);
+}
+
+TEST( Perf_Sim, Phase_File)
+{
+    config::LocalValues phases( std::map<std::string, std::string>{ { "phase-file", "perf_sim_phases.csv"}, { "phase-interval", "500"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    std::ifstream file( "perf_sim_phases.csv");
+    std::string header;
+    std::getline( file, header);
+    ASSERT_EQ( header, "interval,cycle,cycles,instrs,ipc,bp_accuracy,icache_miss_rate,cpi_stack.retiring,cpi_stack.frontend,"
+                       "cpi_stack.bad_speculation,cpi_stack.data_dependency,cpi_stack.execution_units,cpi_stack.memory,phase,change");
+
+    // intervals of 500 instructions and the last shorter one cover the whole run
+    uint64 rows = 0;
+    uint64 instrs = 0;
+    for ( std::string row; std::getline( file, row); ++rows)
+    {
+        std::istringstream fields( row);
+        std::string field;
+        for ( size_t i = 0; i < 4; ++i)
+            std::getline( fields, field, ',');
+        instrs += std::stoull( field);
+    }
+    ASSERT_GE( rows, mips.get_executed_instrs() / 500);
+    ASSERT_LE( rows, mips.get_executed_instrs() / 500 + 1);
+    ASSERT_EQ( instrs, mips.get_executed_instrs());
+
+    config::LocalValues invalid( std::map<std::string, std::string>{ { "phase-file", "perf_sim_phases.csv"}, { "phase-unit", "seconds"}});
+    PerfSim<MIPS> other( false);
+    ASSERT_EXIT( other.run_no_limit( valid_elf_file), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim, Telemetry_File)
+{
+    config::LocalValues telemetry( std::map<std::string, std::string>{ { "telemetry-file", "perf_sim_telemetry.bin"}, { "telemetry-interval", "1000"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    // updates at the start, every 1000 cycles and at the end
+    const auto sample = TelemetryReader( "perf_sim_telemetry.bin").read();
+    ASSERT_TRUE( sample.is_finished);
+    ASSERT_EQ( sample.instrs, mips.get_executed_instrs());
+    ASSERT_EQ( sample.cycles, ( mips.get_cycles() - 0_Cl).to_size_t());
+    ASSERT_GE( sample.updates, sample.cycles / 1000);
+    ASSERT_EQ( sample.counters.at( 0).first, "fetch.icache.misses");
+    ASSERT_EQ( sample.counters.at( 0).second, mips.get_stats().get_counter( "fetch.icache.misses"));
+
+    config::LocalValues invalid( std::map<std::string, std::string>{ { "telemetry-file", "perf_sim_telemetry.bin"}, { "telemetry-interval", "0"}});
+    PerfSim<MIPS> other( false);
+    ASSERT_EXIT( other.run_no_limit( valid_elf_file), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim, Store_Buffer)
+{
+    const std::string recursion = TEST_PATH "/bench/recursion.out";
+    config::LocalValues blocking( std::map<std::string, std::string>{ { "mshrs", "0"}});
+    PerfSim<MIPS> plain( false);
+    plain.set_statistics_output( false);
+    plain.run_no_limit( recursion);
+
+    config::LocalValues buffered( std::map<std::string, std::string>{ { "store-buffer", "2"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( recursion);
+
+    // stores spilled on calls are written to the cache while the calls go on
+    const auto& stats = mips.get_stats();
+    ASSERT_EQ( mips.get_executed_instrs(), plain.get_executed_instrs());
+    ASSERT_LT( mips.get_cycles(), plain.get_cycles());
+    ASSERT_NE( stats.get_counter( "mem.store_buffer.forwards"), 0u);
+    ASSERT_NE( stats.get_counter( "mem.store_buffer.full_stalls"), 0u);
+    ASSERT_FALSE( plain.get_stats().has_counter( "mem.store_buffer.forwards"));
+}
+
+TEST( Perf_Sim, Loop_Buffer)
+{
+    const std::string matmul = TEST_PATH "/bench/matmul.out";
+    config::LocalValues wide( std::map<std::string, std::string>{ { "width", "4"}});
+    PerfSim<MIPS> plain( false);
+    plain.set_statistics_output( false);
+    plain.run_no_limit( matmul);
+
+    config::LocalValues buffered( std::map<std::string, std::string>{ { "loop-buffer-size", "16"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( matmul);
+
+    // the inner loop of 8 instructions is streamed by the buffer, so instruction cache is rarely accessed
+    const auto& stats = mips.get_stats();
+    const auto icache_accesses = []( const auto& s) { return s.get_counter( "fetch.icache.hits") + s.get_counter( "fetch.icache.misses"); };
+    ASSERT_EQ( mips.get_executed_instrs(), plain.get_executed_instrs());
+    ASSERT_NE( stats.get_counter( "fetch.loop_buffer.loops"), 0u);
+    ASSERT_GT( stats.get_counter( "fetch.loop_buffer.instrs"), stats.get_counter( "fetch.instrs") / 2);
+    ASSERT_LT( icache_accesses( stats) * 4, icache_accesses( plain.get_stats()));
+    ASSERT_FALSE( plain.get_stats().has_counter( "fetch.loop_buffer.loops"));
+
+    // loops of matmul do not fit into a buffer of 4 instructions
+    config::LocalValues small( std::map<std::string, std::string>{ { "loop-buffer-size", "4"}});
+    PerfSim<MIPS> small_buffer( false);
+    small_buffer.set_statistics_output( false);
+    small_buffer.run_no_limit( matmul);
+    ASSERT_EQ( small_buffer.get_stats().get_counter( "fetch.loop_buffer.loops"), 0u);
+    ASSERT_EQ( small_buffer.get_cycles(), plain.get_cycles());
+}
+
+TEST( Perf_Sim, Uop_Cache)
+{
+    config::LocalValues small_icache( std::map<std::string, std::string>{ { "icache-size", "256"}, { "icache-ways", "1"}});
+    PerfSim<MIPS> plain( false);
+    plain.set_statistics_output( false);
+    plain.run_no_limit( valid_elf_file);
+
+    config::LocalValues cached( std::map<std::string, std::string>{ { "uop-cache-size", "256"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    // blocks found in micro-op cache do not miss in the small instruction cache
+    const auto& stats = mips.get_stats();
+    ASSERT_EQ( mips.get_executed_instrs(), plain.get_executed_instrs());
+    ASSERT_NE( stats.get_counter( "fetch.uop_cache.hits"), 0u);
+    ASSERT_LE( stats.get_counter( "fetch.uop_cache.instrs"), stats.get_counter( "fetch.instrs"));
+    ASSERT_LT( stats.get_counter( "fetch.icache.misses"), plain.get_stats().get_counter( "fetch.icache.misses"));
+    ASSERT_LT( mips.get_cycles(), plain.get_cycles());
+    ASSERT_FALSE( plain.get_stats().has_counter( "fetch.uop_cache.hits"));
+}
+
+TEST( Perf_Sim, Uop_Cache_Cold_Miss)
+{
+    config::LocalValues values( std::map<std::string, std::string>{ { "uop-cache-size", "4096"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run( valid_elf_file, 10);
+
+    // first instructions of the program are not repeated, so the blocks refetched after cold misses are not micro-op hits
+    const auto& stats = mips.get_stats();
+    ASSERT_NE( stats.get_counter( "fetch.icache.misses"), 0u);
+    ASSERT_EQ( stats.get_counter( "fetch.uop_cache.hits"), 0u);
+    ASSERT_EQ( stats.get_counter( "fetch.uop_cache.instrs"), 0u);
+}
+
+TEST( Perf_Sim, CPI_Stack)
+{
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    // every cycle is attributed to one category, scalar pipeline retires one instruction per cycle
+    const auto& cpi_stack = mips.get_cpi_stack();
+    ASSERT_EQ( static_cast<double>( cpi_stack.get_total_cycles()), static_cast<double>( mips.get_cycles()));
+    ASSERT_EQ( cpi_stack.get_cycles( CPIStack::RETIRING), mips.get_executed_instrs());
+    ASSERT_EQ( cpi_stack.get_cycles( CPIStack::MEMORY), mips.get_stats().get_counter( "mem.dcache.stall_cycles"));
+
+    config::LocalValues small_icache( std::map<std::string, std::string>{ { "icache-size", "256"}, { "icache-ways", "1"}, { "bp-mode", "static_always_taken"}, { "div-latency", "1"}});
+    PerfSim<MIPS> other( false);
+    other.set_statistics_output( false);
+    other.run_no_limit( valid_elf_file);
+
+    const auto& other_stack = other.get_cpi_stack();
+    ASSERT_EQ( static_cast<double>( other_stack.get_total_cycles()), static_cast<double>( other.get_cycles()));
+    ASSERT_GT( other_stack.get_cycles( CPIStack::FRONTEND), cpi_stack.get_cycles( CPIStack::FRONTEND));
+    ASSERT_GT( other_stack.get_cycles( CPIStack::BAD_SPECULATION), cpi_stack.get_cycles( CPIStack::BAD_SPECULATION));
+    ASSERT_LT( other_stack.get_cycles( CPIStack::EXECUTION_UNITS), cpi_stack.get_cycles( CPIStack::EXECUTION_UNITS));
+}
+
+static std::pair<uint64, uint64> count_konata_retires( const std::string& konata)
+{
+    uint64 retired = 0;
+    uint64 flushed = 0;
+    std::istringstream iss( konata);
+    for ( std::string line; std::getline( iss, line);)
+    {
+        if ( line.compare( 0, 2, "R\t") != 0)
+            continue;
+        if ( line.back() == '0')
+            ++retired;
+        else
+            ++flushed;
+    }
+    return { retired, flushed};
+}
+
+TEST( Perf_Sim, Pipeline_Trace)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "width", "2"}});
+    PerfSim<MIPS> plain( false);
+    plain.set_statistics_output( false);
+    plain.run_no_limit( valid_elf_file);
+
+    config::LocalValues trace( std::map<std::string, std::string>{ { "pipeline-trace", "perf_sim_pipeline.bin"}});
+    PerfSim<MIPS> two_wide( false);
+    two_wide.set_statistics_output( false);
+    two_wide.run_no_limit( valid_elf_file);
+
+    // the trace does not change the simulation
+    ASSERT_EQ( two_wide.get_executed_instrs(), plain.get_executed_instrs());
+    ASSERT_EQ( two_wide.get_cycles(), plain.get_cycles());
+
+    std::ostringstream konata;
+    convert_pipeline_trace( "mips", "perf_sim_pipeline.bin", valid_elf_file, konata);
+    ASSERT_EQ( konata.str().compare( 0, 12, "Kanata\t0004\n"), 0);
+
+    const auto retires = count_konata_retires( konata.str());
+    ASSERT_EQ( retires.first, two_wide.get_executed_instrs());
+    ASSERT_EQ( retires.second, two_wide.get_stats().get_counter( "fetch.instrs") - retires.first);
+    ASSERT_GT( retires.second, 0u);
+
+    std::ofstream( "perf_sim_pipeline.bin") << "MIPTPT01\x09";
+    ASSERT_EXIT( convert_pipeline_trace( "mips", "perf_sim_pipeline.bin", valid_elf_file, konata), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( convert_pipeline_trace( "mips", valid_elf_file, valid_elf_file, konata), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( convert_pipeline_trace( "mips", "./no/such/file.bin", valid_elf_file, konata), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim, Profile)
+{
+    const std::string recursion = TEST_PATH "/bench/recursion.out";
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.set_profile( "perf_sim_profile", 1);
+    mips.run_no_limit( recursion);
+
+    std::ifstream flat( "perf_sim_profile.csv");
+    std::string line;
+    std::getline( flat, line);
+    ASSERT_EQ( line, "function,instrs,cycles,icache_misses,mispredictions");
+
+    std::array<uint64, 4> totals = {};
+    while ( std::getline( flat, line))
+    {
+        std::istringstream row( line.substr( line.find( ',')));
+        for ( auto& total : totals)
+        {
+            uint64 value = 0;
+            row.ignore( 1) >> value;
+            total += value;
+        }
+    }
+
+    // cycles of draining the pipeline after the last retirement are not counted
+    const auto& stats = mips.get_stats();
+    const auto cycles = ( mips.get_cycles() - 0_Cl).to_size_t();
+    ASSERT_EQ( totals[ 0], mips.get_executed_instrs());
+    ASSERT_LE( totals[ 1], cycles);
+    ASSERT_GT( totals[ 1], cycles - 100);
+    ASSERT_EQ( totals[ 2], stats.get_counter( "fetch.icache.demand_misses"));
+    ASSERT_EQ( totals[ 3], stats.get_counter( "fetch.bp.dynamic_two_bit.mispredictions"));
+    ASSERT_TRUE( std::ifstream( "perf_sim_profile.cycles.folded").is_open());
+
+    // the profile does not change the simulation
+    PerfSim<MIPS> plain( false);
+    plain.set_statistics_output( false);
+    plain.run_no_limit( recursion);
+    ASSERT_EQ( plain.get_cycles(), mips.get_cycles());
+
+    config::LocalValues parallel( std::map<std::string, std::string>{ { "stage-threads", "2"}});
+    PerfSim<MIPS> threaded( false);
+    threaded.set_profile( "perf_sim_profile", 1);
+    ASSERT_EXIT( threaded.run_no_limit( recursion), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim, Replay_Instr_Trace)
+{
+    FuncSim<MIPS> recorder( false);
+    recorder.set_instr_trace( "perf_sim_instrs.trace");
+    recorder.run_no_limit( valid_elf_file);
+
+    config::LocalValues two_wide( std::map<std::string, std::string>{ { "width", "2"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    config::LocalValues replay( std::map<std::string, std::string>{ { "trace-replay", "perf_sim_instrs.trace"}});
+    PerfSim<MIPS> replayed( false);
+    replayed.set_statistics_output( false);
+    replayed.run_no_limit( valid_elf_file);
+
+    // wrong path is not fetched in replay, so timing differs only slightly
+    ASSERT_EQ( replayed.get_executed_instrs(), mips.get_executed_instrs());
+    ASSERT_LT( std::abs( static_cast<double>( replayed.get_cycles()) - static_cast<double>( mips.get_cycles())),
+               static_cast<double>( mips.get_cycles()) / 100);
+    ASSERT_EQ( replayed.get_stats().get_counter( "mem.loads"), mips.get_stats().get_counter( "mem.loads"));
+    ASSERT_EQ( replayed.get_stats().get_counter( "fetch.bp.dynamic_two_bit.mispredictions"),
+               mips.get_stats().get_counter( "fetch.bp.dynamic_two_bit.mispredictions"));
+
+    PerfSim<MIPS> limited( false);
+    limited.set_statistics_output( false);
+    limited.run( valid_elf_file, 1000);
+    ASSERT_EQ( limited.get_executed_instrs(), 1000u);
+
+    config::LocalValues fast_forward( std::map<std::string, std::string>{ { "fast-forward", "4000"}, { "warmup", "1000"}});
+    PerfSim<MIPS> skipped( false);
+    skipped.set_statistics_output( false);
+    skipped.run_no_limit( valid_elf_file);
+    ASSERT_EQ( skipped.get_executed_instrs(), mips.get_executed_instrs() - 5000);
+
+    PerfSim<MIPS> checkpoint( false);
+    checkpoint.set_checkpoints( "", "perf_sim.ckpt");
+    ASSERT_EXIT( checkpoint.run_no_limit( valid_elf_file), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim, RISCV_Full_Trace)
+{
+    // results are compared with the functional simulator
+    PerfSim<RISCV32> riscv32( false);
+    riscv32.set_statistics_output( false);
+    riscv32.run_no_limit( riscv_elf_file);
+
+    PerfSim<RISCV64> riscv64( false);
+    riscv64.set_statistics_output( false);
+    riscv64.run_no_limit( riscv_elf_file);
+
+    PerfSim<RISCV128> riscv128( false);
+    riscv128.set_statistics_output( false);
+    riscv128.run_no_limit( riscv_elf_file);
+
+    FuncSim<RISCV32> checker( false);
+    checker.run_no_limit( riscv_elf_file);
+
+    ASSERT_EQ( riscv32.get_executed_instrs(), checker.get_executed_instrs());
+    ASSERT_EQ( riscv32.get_executed_instrs(), riscv64.get_executed_instrs());
+    ASSERT_EQ( riscv32.get_executed_instrs(), riscv128.get_executed_instrs());
+    ASSERT_EQ( riscv32.get_cycles(), riscv64.get_cycles());
+    ASSERT_EQ( riscv32.get_cycles(), riscv128.get_cycles());
+    ASSERT_LT( riscv32.get_executed_instrs(), static_cast<double>( riscv32.get_cycles()));
+}
+
+TEST( Perf_Sim, Create_RISCV_Simulator)
+{
+    ASSERT_NE( dynamic_cast<PerfSim<RISCV32>*>( Simulator::create_simulator( "riscv32", false, false).get()), nullptr);
+    ASSERT_NE( dynamic_cast<PerfSim<RISCV64>*>( Simulator::create_simulator( "riscv64", false, false).get()), nullptr);
+    ASSERT_NE( dynamic_cast<FuncSim<RISCV64>*>( Simulator::create_simulator( "riscv64", true, false).get()), nullptr);
+    ASSERT_NE( dynamic_cast<PerfSim<RISCV128>*>( Simulator::create_simulator( "riscv128", false, false).get()), nullptr);
+    ASSERT_NE( dynamic_cast<FuncSim<RISCV128>*>( Simulator::create_simulator( "riscv128", true, false).get()), nullptr);
+    ASSERT_EQ( Simulator::create_simulator( "riscv32", false, false, true), nullptr);
+}
+
+TEST( OOO_Perf_Sim, Run_Full_Trace)
+{
+    // results of out-of-order execution are retired in order and compared with the checker
+    OOOPerfSim<MIPS> mips( false);
+    GTEST_ASSERT_NO_DEATH( mips.run_no_limit( valid_elf_file); );
+
+    config::LocalValues options( std::map<std::string, std::string>{ { "width", "4"}, { "bp-mode", "tage"}, { "ras-size", "8"}});
+    OOOPerfSim<MIPS> wide( false);
+    GTEST_ASSERT_NO_DEATH( wide.run_no_limit( valid_elf_file); );
+}
+
+static uint64 count_allocations( uint64 instrs_to_run, const std::string& binary = valid_elf_file)
+{
+    const uint64 before = allocations;
+    PerfSim<MIPS>( false).run( binary, instrs_to_run);
+    return allocations - before;
+}
+
+TEST( Perf_Sim, No_Allocations_In_Clock)
+{
+    // the first run loads the binary to the cache of images
+    count_allocations( 10000);
+
+    // memory is allocated on construction and load, so it does not depend on the number of cycles
+    ASSERT_EQ( count_allocations( 10000), count_allocations( 20000));
+
+    config::LocalValues two_wide( std::map<std::string, std::string>{ { "width", "2"}, { "mul-latency", "4"}});
+    ASSERT_EQ( count_allocations( 10000), count_allocations( 20000));
+
+    {
+        // prefetched lines are marked in the ways of data cache
+        const std::string matmul = TEST_PATH "/bench/matmul.out";
+        config::LocalValues prefetch( std::map<std::string, std::string>{ { "dcache-size", "1024"}, { "dcache-prefetch", "stride"}});
+        count_allocations( 10000, matmul);
+        ASSERT_EQ( count_allocations( 10000, matmul), count_allocations( 20000, matmul));
+    }
+
+    {
+        // prefetched lines are marked in the ways of instruction cache
+        config::LocalValues prefetch( std::map<std::string, std::string>{ { "icache-size", "256"}, { "icache-prefetch", "next-line"}});
+        ASSERT_EQ( count_allocations( 5000), count_allocations( 10000));
+    }
+
+    config::LocalValues smt( std::map<std::string, std::string>{ { "smt-threads", "2"}});
+    ASSERT_EQ( count_allocations( 10000), count_allocations( 20000));
+}
+
+TEST( Perf_Sim, SMT_Threads)
+{
+    PerfSim<MIPS> single( false);
+    single.set_statistics_output( false);
+    single.run_no_limit( valid_elf_file);
+    const auto get_cycles = []( const auto& sim) { return ( sim.get_cycles() - 0_Cl).to_size_t(); };
+
+    // each thread runs its copy of the program checked by its own functional simulator,
+    // so they are interleaved in stalls of each other
+    for ( const std::string policy : { "round-robin", "icount", "switch-on-miss"})
+    {
+        config::LocalValues options( std::map<std::string, std::string>{ { "smt-threads", "2"}, { "smt-fetch-policy", policy}});
+        PerfSim<MIPS> mips( false);
+        mips.set_statistics_output( false);
+        mips.run_no_limit( valid_elf_file);
+
+        const auto& stats = mips.get_stats();
+        ASSERT_EQ( mips.get_executed_instrs(), 2 * single.get_executed_instrs());
+        ASSERT_EQ( stats.get_counter( "writeback.thread0.instrs"), single.get_executed_instrs());
+        ASSERT_EQ( stats.get_counter( "writeback.thread1.instrs"), single.get_executed_instrs());
+        ASSERT_GT( get_cycles( mips), get_cycles( single));
+        ASSERT_LT( get_cycles( mips), 2 * get_cycles( single));
+    }
+    ASSERT_FALSE( single.get_stats().has_counter( "writeback.thread0.instrs"));
+}
+
+TEST( Perf_Sim, SMT_Wide_Pipeline)
+{
+    // flushed threads keep slots of bundles shared with others of the wide and deep pipeline
+    config::LocalValues options( std::map<std::string, std::string>{ { "smt-threads", "4"}, { "width", "2"}, { "mul-latency", "4"},
+                                                                     { "memory-stages", "2"}, { "branch-resolution", "execute"}});
+    PerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run( valid_elf_file, 5000);
+    ASSERT_EQ( mips.get_executed_instrs(), 4 * 5000u);
+
+    config::LocalValues riscv( std::map<std::string, std::string>{ { "smt-threads", "3"}, { "checker", "final"}});
+    PerfSim<RISCV32> fib( false);
+    fib.set_statistics_output( false);
+    GTEST_ASSERT_NO_DEATH( fib.run_no_limit( TEST_PATH "/riscv_fib.out"); );
+}
+
+TEST( Perf_Sim_init, Invalid_SMT)
+{
+    for ( const std::string threads : { "0", "5"})
+    {
+        config::LocalValues options( std::map<std::string, std::string>{ { "smt-threads", threads}});
+        ASSERT_EXIT( PerfSim<MIPS> mips( false), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    }
+
+    config::LocalValues policy( std::map<std::string, std::string>{ { "smt-fetch-policy", "random"}});
+    ASSERT_EXIT( PerfSim<MIPS> mips( false), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Perf_Sim, SMT_Unsupported_Modes)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "smt-threads", "2"}});
+    ASSERT_EXIT( OOOPerfSim<MIPS> mips( false), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+
+    PerfSim<MIPS> checkpoint( false);
+    checkpoint.set_checkpoints( "", "smt.ckpt");
+    ASSERT_EXIT( checkpoint.run_no_limit( valid_elf_file), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+
+    config::LocalValues fast_forward( std::map<std::string, std::string>{ { "fast-forward", "100"}});
+    PerfSim<MIPS> skipped( false);
+    ASSERT_EXIT( skipped.run_no_limit( valid_elf_file), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+
+    config::LocalValues loop_buffer( std::map<std::string, std::string>{ { "loop-buffer-size", "16"}});
+    ASSERT_EXIT( PerfSim<MIPS> mips( false), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( OOO_Perf_Sim, Small_Structures)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "width", "2"}, { "rob-size", "2"}, { "iq-size", "1"}, { "lsq-size", "1"}});
+    OOOPerfSim<MIPS> mips( false);
+    GTEST_ASSERT_NO_DEATH( mips.run_no_limit( valid_elf_file); );
+}
+
+TEST( OOO_Perf_Sim, Compare_With_In_Order)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "width", "2"}});
+    PerfSim<MIPS> in_order( false);
+    in_order.set_statistics_output( false);
+    in_order.run_no_limit( valid_elf_file);
+
+    OOOPerfSim<MIPS> out_of_order( false);
+    out_of_order.set_statistics_output( false);
+    out_of_order.run_no_limit( valid_elf_file);
+
+    ASSERT_EQ( in_order.get_executed_instrs(), out_of_order.get_executed_instrs());
+    ASSERT_LT( out_of_order.get_cycles(), in_order.get_cycles());
+}
+
+TEST( OOO_Perf_Sim, Reorder_Buffer_Size)
+{
+    config::LocalValues small( std::map<std::string, std::string>{ { "width", "2"}, { "rob-size", "4"}});
+    OOOPerfSim<MIPS> mips( false);
+    mips.set_statistics_output( false);
+    mips.run_no_limit( valid_elf_file);
+
+    config::LocalValues large( std::map<std::string, std::string>{ { "width", "2"}, { "rob-size", "32"}});
+    OOOPerfSim<MIPS> other( false);
+    other.set_statistics_output( false);
+    other.run_no_limit( valid_elf_file);
+
+    ASSERT_EQ( mips.get_executed_instrs(), other.get_executed_instrs());
+    ASSERT_LT( other.get_cycles(), mips.get_cycles());
+}
+
+TEST( OOO_Perf_Sim, Zero_Sizes)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "iq-size", "0"}});
+    ASSERT_EXIT( OOOPerfSim<MIPS> mips( false),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( OOO_Perf_Sim, Create_Simulator)
+{
+    ASSERT_NE( dynamic_cast<OOOPerfSim<MIPS>*>( Simulator::create_simulator( "mips", false, false, true).get()), nullptr);
+    ASSERT_NE( dynamic_cast<PerfSim<MIPS>*>( Simulator::create_simulator( "mips", false, false).get()), nullptr);
+
+    OOOPerfSim<MIPS> profiled( false);
+    profiled.set_profile( "ooo_profile", 1);
+    ASSERT_EXIT( profiled.run_no_limit( valid_elf_file), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+static void check_cores( const MultiCoreSim<MIPS>& sim)
+{
+    PerfSim<MIPS> single( false);
+    single.set_statistics_output( false);
+    single.run_no_limit( valid_elf_file);
+
+    // each core runs the whole program, they share lines written by all of them
+    ASSERT_EQ( sim.get_cores_num(), 2u);
+    for ( size_t i = 0; i < sim.get_cores_num(); ++i)
+        ASSERT_EQ( sim.get_core( i).get_executed_instrs(), single.get_executed_instrs());
+    ASSERT_EQ( sim.get_executed_instrs(), 2 * single.get_executed_instrs());
+    ASSERT_GT( sim.get_directory().get_invalidations(), 0u);
+    ASSERT_FALSE( sim.get_cycles() < single.get_cycles());
+}
+
+TEST( Multi_Core_Sim, Run_Full_Trace)
+{
+    MultiCoreSim<MIPS> sim( false, 2);
+    sim.run_no_limit( valid_elf_file);
+    check_cores( sim);
+}
+
+TEST( Multi_Core_Sim, Run_In_Threads)
+{
+    config::LocalValues options( std::map<std::string, std::string>{ { "core-threads", "true"}, { "l2-size", "16384"}});
+    MultiCoreSim<MIPS> sim( false, 2);
+    sim.run_no_limit( valid_elf_file);
+    check_cores( sim);
+    ASSERT_NE( sim.get_directory().get_l2(), nullptr);
+}
+
+TEST( Multi_Core_Sim, Unsupported_Modes)
+{
+    ASSERT_NE( dynamic_cast<MultiCoreSim<MIPS>*>( Simulator::create_simulator( "mips", false, false, false, 2).get()), nullptr);
+    ASSERT_NE( dynamic_cast<MultiCoreSim<RISCV32>*>( Simulator::create_simulator( "riscv32", false, false, false, 4).get()), nullptr);
+    ASSERT_EQ( Simulator::create_simulator( "mips", true, false, false, 2), nullptr);
+    ASSERT_EQ( Simulator::create_simulator( "mips", false, false, true, 2), nullptr);
+
+    MultiCoreSim<MIPS> sim( false, 2);
+    sim.set_checkpoints( "", "multicore.ckpt");
+    ASSERT_EXIT( sim.run_no_limit( valid_elf_file),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+
+    MultiCoreSim<MIPS> profiled( false, 2);
+    profiled.set_profile( "multicore_profile", 1);
+    ASSERT_EXIT( profiled.run_no_limit( valid_elf_file),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
 int main( int argc, char* argv[])
 {
     ::testing::InitGoogleTest( &argc, argv);
@@ -3,127 +3,240 @@
  * Copyright 2015-2018 MIPT-MIPS
  */
 
+#include <infra/self_profiler/self_profiler.h>
+
+#include <bitset>
+
 #include "decode.h"
 
 
 template <typename ISA>
-Decode<ISA>::Decode( bool log) : Log( log)
+Decode<ISA>::Decode( bool log, uint32 width, const PipelineDepth& depth, uint32 threads_num)
+    : Log( log)
+    , threads( threads_num)
+    , functional_units( width, depth.execute_stages)
+    , wps_command( width)
+    , issue_width( width + 1)
 {
-    wp_datapath = make_write_port<Instr>("DECODE_2_EXECUTE", PORT_BW, PORT_FANOUT);
-    rp_datapath = make_read_port<Instr>("FETCH_2_DECODE", PORT_LATENCY);
-
-    wp_stall_datapath = make_write_port<Instr>("DECODE_2_DECODE", PORT_BW, PORT_FANOUT);
-    rp_stall_datapath = make_read_port<Instr>("DECODE_2_DECODE", PORT_LATENCY);
+    wp_datapath = make_write_port<Instr>("DECODE_2_EXECUTE", width, PORT_FANOUT);
 
-    wp_stall = make_write_port<bool>("DECODE_2_FETCH_STALL", PORT_BW, PORT_FANOUT);
+    for ( uint32 i = 0; i < threads.size(); ++i)
+    {
+        auto& thread = threads[ i];
+        thread.input = std::make_unique<StallLatch<Instr>>( get_thread_port_name( "FETCH_2_DECODE", i),
+                                                            get_thread_port_name( "DECODE_2_FETCH_STALL", i),
+                                                            width, depth.get_frontend_latency());
+        thread.rp_flush = make_read_port<bool>( get_thread_port_name( "MEMORY_2_ALL_FLUSH", i), PORT_LATENCY);
+        thread.bypassing_unit = std::make_unique<BypassingUnit>( depth.memory_stages);
+    }
 
-    rp_flush = make_read_port<bool>("MEMORY_2_ALL_FLUSH", PORT_LATENCY);
+    if ( threads.size() > 1)
+        wp_decoded = make_write_port<ThreadCounts>("DECODE_2_FETCH_THREAD_INSTRS", PORT_BW, PORT_FANOUT);
 
-    wps_command[0] = make_write_port<typename BypassingUnit::BypassCommand>("DECODE_2_EXECUTE_SRC1_COMMAND",
-                                                                            PORT_BW, PORT_FANOUT);
-    wps_command[1] = make_write_port<typename BypassingUnit::BypassCommand>("DECODE_2_EXECUTE_SRC2_COMMAND",
-                                                                            PORT_BW, PORT_FANOUT);
+    for ( uint32 slot = 0; slot < width; ++slot)
+        for ( uint8 src_index = 0; src_index < SRC_REGISTERS_NUM; src_index++)
+            wps_command[ slot][ src_index] = make_write_port<typename BypassingUnit::BypassCommand>(
+                BypassingUnit::get_command_port_name( slot, src_index), PORT_BW, PORT_FANOUT);
     
-    wp_bypassing_unit_notify = make_write_port<Instr>("DECODE_2_BYPASSING_UNIT_NOTIFY", PORT_BW, PORT_FANOUT);
+    wp_bypassing_unit_notify = make_write_port<Instr>("DECODE_2_BYPASSING_UNIT_NOTIFY", width, PORT_FANOUT);
     rp_bypassing_unit_notify = make_read_port<Instr>("DECODE_2_BYPASSING_UNIT_NOTIFY", PORT_LATENCY);
 
     rps_bypassing_unit_flush_notify[0] = make_read_port<Instr>("EXECUTE_2_BYPASSING_UNIT_FLUSH_NOTIFY",
                                                                PORT_LATENCY);
     rps_bypassing_unit_flush_notify[1] = make_read_port<Instr>("MEMORY_2_BYPASSING_UNIT_FLUSH_NOTIFY",
                                                                PORT_LATENCY);
-    
-    bypassing_unit = std::make_unique<BypassingUnit>();
-}
-
 
-template <typename ISA>
-typename Decode<ISA>::Instr Decode<ISA>::read_instr( Cycle cycle)
-{
-    if ( rp_stall_datapath->is_ready( cycle))
-    {
-        rp_datapath->ignore( cycle);
-        return rp_stall_datapath->read( cycle);
-    }
-    return rp_datapath->read( cycle);
+    // memory is allocated once, so clock does not allocate it
+    issued_slots.reserve( width);
 }
 
 
 template <typename ISA>
 void Decode<ISA>::clock( Cycle cycle)
 {
-    sout << "decode  cycle " << std::dec << cycle << ": ";
+    SELF_PROFILE( DECODE);
+    TRACE( sout) << "decode  cycle " << std::dec << cycle << ": ";
 
-    /* receive flush signal */
-    const bool is_flush = rp_flush->is_ready( cycle) && rp_flush->read( cycle);
+    /* receive flush signals */
+    std::bitset<MAX_HW_THREADS> is_flush;
+    for ( size_t i = 0; i < threads.size(); ++i)
+        is_flush[ i] = threads[ i].rp_flush->is_ready( cycle) && threads[ i].rp_flush->read( cycle);
 
     // untrace instructions from flushed stages
     for ( auto& port:rps_bypassing_unit_flush_notify)
     {
-        if ( port->is_ready( cycle))
+        while ( port->is_ready( cycle))
         {
             const auto& instr = port->read( cycle);
-            bypassing_unit->untrace_instr( instr);
+            threads[ instr.get_thread()].bypassing_unit->untrace_instr( instr);
         }
     }
 
     /* update bypassing unit */
-    bypassing_unit->update();
+    for ( auto& thread : threads)
+        thread.bypassing_unit->update();
 
-    /* trace new instruction if needed */
-    if ( rp_bypassing_unit_notify->is_ready( cycle))
+    /* trace new instructions if needed */
+    for ( size_t i = 0; rp_bypassing_unit_notify->is_ready( cycle); ++i)
     {
         auto instr = rp_bypassing_unit_notify->read( cycle);
-        bypassing_unit->trace_new_instr( instr);
+        const auto latency = functional_units.get_latency( FunctionalUnits::get_unit_class( instr));
+        threads[ instr.get_thread()].bypassing_unit->trace_new_instr( instr, issued_slots.at( i), latency);
     }
+    issued_slots.clear();
+    decoded = {};
 
     /* branch misprediction */
-    if ( is_flush)
+    if ( threads.size() == 1 && is_flush[ 0])
     {
-        /* ignoring the upcoming instruction as it is invalid */
-        rp_datapath->ignore( cycle);
-        rp_stall_datapath->ignore( cycle);
-
-        sout << "flush\n";
+        /* all the instructions in execution are invalid */
+        functional_units.flush();
+        flush( &threads[ 0], cycle);
+        outcome = StageOutcome::FLUSH;
+        TRACE( sout) << "flush\n";
         return;
     }
+
+    /* flushed instructions of other threads stay in execution units, so their occupancy is kept */
+    bool is_empty = true;
+    for ( size_t i = 0; i < threads.size(); ++i)
+    {
+        if ( is_flush[ i])
+            flush( &threads[ i], cycle);
+        else
+            threads[ i].input->receive( cycle);
+        is_empty = is_empty && threads[ i].input->empty();
+    }
+
     /* check if there is something to process */
-    if ( !rp_datapath->is_ready( cycle) && !rp_stall_datapath->is_ready( cycle))
+    if ( is_empty)
     {
-        sout << "bubble\n";
+        outcome = is_flush.any() ? StageOutcome::FLUSH : StageOutcome::BUBBLE;
+        TRACE( sout) << ( is_flush.any() ? "flush\n" : "bubble\n");
+        if ( wp_decoded != nullptr && is_flush.any())
+            wp_decoded->write( decoded, cycle);
         return;
     }
 
-    auto instr = read_instr( cycle);
+    /* threads share the width, the first one is changed each cycle */
+    std::optional<StageOutcome> stall = std::nullopt;
+    for ( size_t i = 0; i < threads.size(); ++i)
+    {
+        auto& thread = threads[ ( first_thread + i) % threads.size()];
+        if ( thread.input->empty())
+            continue;
 
-    if ( bypassing_unit->is_stall( instr))
-    {   
-        // data hazard, stalling pipeline
-        wp_stall->write( true, cycle);
-        wp_stall_datapath->write( instr, cycle);
-        sout << instr << " (data hazard)\n";
-        return;   
+        const auto hazard = issue( &thread, cycle);
+        if ( !stall.has_value())
+            stall = hazard;
     }
+    first_thread = ( first_thread + 1) % threads.size();
+    issue_width.add( issued_slots.size());
+
+    if ( !issued_slots.empty())
+        outcome = StageOutcome::PASSED;
+    else if ( stall.has_value())
+        outcome = *stall;
+    else
+        outcome = is_flush.any() ? StageOutcome::FLUSH : StageOutcome::BUBBLE;
+
+    if ( wp_decoded != nullptr && ( !issued_slots.empty() || is_flush.any()))
+        wp_decoded->write( decoded, cycle);
+}
 
-    for ( uint8 src_index = 0; src_index < SRC_REGISTERS_NUM; src_index++)
+template <typename ISA>
+void Decode<ISA>::flush( Thread* thread, Cycle cycle)
+{
+    ++flushes;
+
+    /* ignoring the kept and the upcoming instructions as they are invalid */
+    if ( pipeline_trace == nullptr && wp_decoded == nullptr)
+        thread->input->flush( cycle);
+    else
+        thread->input->flush( cycle, [this, cycle]( const Instr& instr) {
+            ++decoded.at( instr.get_thread());
+            trace_event( pipeline_trace, PipelineEvent::FLUSH, instr, cycle);
+        });
+}
+
+template <typename ISA>
+std::optional<StageOutcome> Decode<ISA>::issue( Thread* thread, Cycle cycle)
+{
+    auto& input = *thread->input;
+
+    /* instructions are issued in order, so the first stalled one stalls the younger ones */
+    const auto bundle_size = input.get_bundle_size();
+    for ( size_t slot = 0; slot < bundle_size; ++slot)
     {
-        if ( bypassing_unit->is_in_RF( instr, src_index))
+        /* the width is taken by other threads */
+        if ( issued_slots.size() == wps_command.size())
         {
-            rf->read_source( &instr, src_index);
+            input.pass( slot, cycle);
+            return std::nullopt;
         }
-        else if ( bypassing_unit->is_bypassible( instr, src_index))
+
+        auto& instr = input[ slot];
+        const auto unit = FunctionalUnits::get_unit_class( instr);
+        const bool is_data_hazard = thread->bypassing_unit->is_stall( instr);
+        if ( is_data_hazard || !functional_units.is_available( unit, cycle))
         {
-            const auto bypass_command = bypassing_unit->get_bypass_command( instr, src_index);
-            wps_command[ src_index]->write( bypass_command, cycle);
+            // data or structural hazard, the instructions stay in the latch and stall fetch
+            ++( is_data_hazard ? data_hazard_stalls : structural_hazard_stalls);
+            for ( size_t i = slot; i < bundle_size; ++i)
+            {
+                trace_event( pipeline_trace, PipelineEvent::STALL, input[ i], cycle);
+                TRACE( sout) << input[ i] << ( is_data_hazard ? " (data hazard)\n" : " (structural hazard)\n");
+            }
+            input.pass( slot, cycle);
+            return is_data_hazard ? StageOutcome::DATA_HAZARD : StageOutcome::STRUCTURAL_HAZARD;
         }
-    }
 
-    /* notify bypassing unit about new instruction */
-    wp_bypassing_unit_notify->write( instr, cycle);
+        /* commands are sent by the position of the instruction in the issued bundle */
+        const auto position = issued_slots.size();
+        for ( uint8 src_index = 0; src_index < SRC_REGISTERS_NUM; src_index++)
+        {
+            if ( thread->bypassing_unit->is_in_RF( instr, src_index))
+            {
+                thread->rf->read_source( &instr, src_index);
+            }
+            else if ( thread->bypassing_unit->is_bypassible( instr, src_index))
+            {
+                const auto bypass_command = thread->bypassing_unit->get_bypass_command( instr, src_index);
+                wps_command[ position][ src_index]->write( bypass_command, cycle);
+            }
+        }
 
-    wp_datapath->write( instr, cycle);
+        thread->bypassing_unit->issue_in_bundle( instr);
+        issued_slots.push_back( functional_units.issue( unit, cycle));
+        ++decoded.at( instr.get_thread());
 
-    /* log */
-    sout << instr << std::endl;
+        /* notify bypassing unit about new instruction */
+        wp_bypassing_unit_notify->write( instr, cycle);
+
+        wp_datapath->write( instr, cycle);
+        trace_event( pipeline_trace, PipelineEvent::DECODE, instr, cycle);
+
+        ++issued_instrs;
+
+        /* log */
+        TRACE( sout) << instr << std::endl;
+    }
+    input.pass( bundle_size, cycle);
+    return std::nullopt;
+}
+
+
+template <typename ISA>
+void Decode<ISA>::register_stats( StatsRegistry* stats) const
+{
+    stats->add_counter( "decode.instrs", &issued_instrs);
+    stats->add_counter( "decode.stalls.data_hazard", &data_hazard_stalls);
+    stats->add_counter( "decode.stalls.structural_hazard", &structural_hazard_stalls);
+    stats->add_counter( "decode.flushes", &flushes);
+    stats->add_histogram( "decode.issue_width", &issue_width);
+    threads[ 0].bypassing_unit->register_stats( stats, "decode.bypass");
+    for ( size_t i = 1; i < threads.size(); ++i)
+        threads[ i].bypassing_unit->register_stats( stats, "decode.thread" + std::to_string( i) + ".bypass");
 }
 
 
@@ -9,9 +9,20 @@
 
 
 #include <infra/ports/ports.h>
+#include <infra/ports/stall_latch.h>
+#include <core/cpi_stack.h>
 #include <core/perf_instr.h>
+#include <core/pipeline_depth.h>
+#include <core/pipeline_trace.h>
+#include <core/smt.h>
 #include <bypass/data_bypass.h>
+#include <execute/functional_units.h>
 #include <func_sim/rf/rf.h>
+#include <infra/stats/stats.h>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
 
 
 template <typename ISA>
@@ -22,23 +33,40 @@ class Decode : public Log
     using BypassingUnit = DataBypass<ISA>;
 
     private:
-        RF<ISA>* rf = nullptr;
-        std::unique_ptr<BypassingUnit> bypassing_unit = nullptr;
+        // hardware threads have their own registers and scoreboards
+        struct Thread
+        {
+            RF<ISA>* rf = nullptr;
+            std::unique_ptr<BypassingUnit> bypassing_unit = nullptr;
 
-        std::unique_ptr<WritePort<Instr>> wp_datapath = nullptr;
-        std::unique_ptr<ReadPort<Instr>> rp_datapath = nullptr;
+            // fetched instructions, the stalled ones are kept there,
+            // they are received after fetch sub-stages and decode sub-stages before issue
+            std::unique_ptr<StallLatch<Instr>> input = nullptr;
 
-        std::unique_ptr<WritePort<Instr>> wp_stall_datapath = nullptr;
-        std::unique_ptr<ReadPort<Instr>> rp_stall_datapath = nullptr;
+            std::unique_ptr<ReadPort<bool>> rp_flush = nullptr;
+        };
+        std::vector<Thread> threads;
 
-        std::unique_ptr<WritePort<bool>> wp_stall = nullptr;
+        // threads take turns to be issued first
+        uint32 first_thread = 0;
+
+        // numbers of instructions of each thread issued or flushed in a cycle, they are sent to fetch with SMT
+        ThreadCounts decoded = {};
+        std::unique_ptr<WritePort<ThreadCounts>> wp_decoded = nullptr;
+
+        // occupancy of execution units by the issued instructions
+        FunctionalUnits functional_units;
+
+        // positions of the instructions issued in the last cycle in the bundles leaving execute stage
+        std::vector<uint8> issued_slots = {};
+
+        std::unique_ptr<WritePort<Instr>> wp_datapath = nullptr;
 
-        std::unique_ptr<ReadPort<bool>> rp_flush = nullptr;
-        
         static constexpr const uint8 SRC_REGISTERS_NUM = 2;
         static constexpr const uint8 BYPASSING_UNIT_FLUSH_NOTIFIERS_NUM = 2;
 
-        std::array<std::unique_ptr<WritePort<typename BypassingUnit::BypassCommand>>, SRC_REGISTERS_NUM>
+        // command ports of each source register of each slot in the bundle
+        std::vector<std::array<std::unique_ptr<WritePort<typename BypassingUnit::BypassCommand>>, SRC_REGISTERS_NUM>>
             wps_command;
         
         std::unique_ptr<WritePort<Instr>> wp_bypassing_unit_notify = nullptr;
@@ -46,13 +74,39 @@ class Decode : public Log
 
         std::array<std::unique_ptr<ReadPort<Instr>>, BYPASSING_UNIT_FLUSH_NOTIFIERS_NUM> 
             rps_bypassing_unit_flush_notify;
-        
-        Instr read_instr( Cycle cycle);
+
+        /* Counters of stalled cycles by cause and number of instructions issued per cycle */
+        uint64 issued_instrs = 0;
+        uint64 data_hazard_stalls = 0;
+        uint64 structural_hazard_stalls = 0;
+        uint64 flushes = 0;
+        Histogram issue_width;
+
+        /* Result of the last clock for CPI stack */
+        StageOutcome outcome = StageOutcome::BUBBLE;
+
+        PipelineTrace* pipeline_trace = nullptr;
+
+        void flush( Thread* thread, Cycle cycle);
+
+        // issues the oldest bundle of the thread in order, returns the hazard stalling it
+        std::optional<StageOutcome> issue( Thread* thread, Cycle cycle);
 
     public:
-        explicit Decode( bool log);
+        Decode( bool log, uint32 width, const PipelineDepth& depth = PipelineDepth(), uint32 threads = 1);
         void clock( Cycle cycle);
-        void set_RF( RF<ISA>* value) { rf = value;}
+        void set_RF( RF<ISA>* value, uint32 thread = 0) { threads.at( thread).rf = value;}
+        void set_pipeline_trace( PipelineTrace* value) { pipeline_trace = value; }
+        void register_stats( StatsRegistry* stats) const;
+        StageOutcome get_outcome() const { return outcome; }
+
+        // true if clocking without input tokens does not change the unit
+        bool is_idle() const
+        {
+            return std::all_of( threads.begin(), threads.end(), []( const Thread& thread) {
+                return thread.input->empty() && thread.bypassing_unit->is_idle();
+            });
+        }
 };
 
 
@@ -4,132 +4,266 @@
  */
 
 
+#include <algorithm>
+#include <bitset>
+
+#include <infra/self_profiler/self_profiler.h>
+
 #include "execute.h"
 
 
+// the flush is received by decode and execute stages
+static constexpr const uint32 FLUSHED_STAGES_NUM = 2;
+
+
 template <typename ISA>
-Execute<ISA>::Execute( bool log) : Log( log)
+Execute<ISA>::Execute( bool log, uint32 width, const PipelineDepth& depth, uint32 threads)
+    : Log( log)
+    , functional_units( width, depth.execute_stages)
+    , in_execution( get_max_instrs_in_execution( functional_units, width))
+    , rps_command( width)
 {
-    wp_datapath = make_write_port<Instr>("EXECUTE_2_MEMORY", PORT_BW, PORT_FANOUT);
+    wp_datapath = make_write_port<Instr>("EXECUTE_2_MEMORY", width, PORT_FANOUT);
     rp_datapath = make_read_port<Instr>("DECODE_2_EXECUTE", PORT_LATENCY);
 
-    rp_flush = make_read_port<bool>("MEMORY_2_ALL_FLUSH", PORT_LATENCY);
-
-    rps_command[0] = make_read_port<typename BypassingUnit::BypassCommand>("DECODE_2_EXECUTE_SRC1_COMMAND",
-                                                                           PORT_LATENCY);
-    rps_command[1] = make_read_port<typename BypassingUnit::BypassCommand>("DECODE_2_EXECUTE_SRC2_COMMAND",
-                                                                           PORT_LATENCY);
+    for ( uint32 thread = 0; thread < threads; ++thread)
+        rps_flush.push_back( make_read_port<bool>( get_thread_port_name( "MEMORY_2_ALL_FLUSH", thread), PORT_LATENCY));
 
-    wp_bypass = make_write_port<RegDstUInt>("EXECUTE_2_EXECUTE_BYPASS", PORT_BW, SRC_REGISTERS_NUM);
+    for ( uint32 slot = 0; slot < width; ++slot)
+        for ( uint8 src_index = 0; src_index < SRC_REGISTERS_NUM; src_index++)
+            rps_command[ slot][ src_index] = make_read_port<typename BypassingUnit::BypassCommand>(
+                BypassingUnit::get_command_port_name( slot, src_index), PORT_LATENCY);
 
-    rps_sources_bypass[0][0] = make_read_port<RegDstUInt>("EXECUTE_2_EXECUTE_BYPASS", PORT_LATENCY);
-    rps_sources_bypass[1][0] = make_read_port<RegDstUInt>("EXECUTE_2_EXECUTE_BYPASS", PORT_LATENCY);
+    wp_bypass = make_write_port<RegDstUInt>("EXECUTE_2_EXECUTE_BYPASS", width, PORT_FANOUT);
 
-    rps_sources_bypass[0][1] = make_read_port<RegDstUInt>("MEMORY_2_EXECUTE_BYPASS", PORT_LATENCY);
-    rps_sources_bypass[1][1] = make_read_port<RegDstUInt>("MEMORY_2_EXECUTE_BYPASS", PORT_LATENCY);
-
-    rps_sources_bypass[0][2] = make_read_port<RegDstUInt>("WRITEBACK_2_EXECUTE_BYPASS", PORT_LATENCY);
-    rps_sources_bypass[1][2] = make_read_port<RegDstUInt>("WRITEBACK_2_EXECUTE_BYPASS", PORT_LATENCY);
+    // execute, each of memory sub-stages and writeback
+    for ( uint8 stage = 0; stage < depth.memory_stages + 2; ++stage)
+        rps_bypass.push_back( make_read_port<RegDstUInt>( BypassingUnit::get_bypass_port_name( stage, depth.memory_stages),
+                                                          BypassingUnit::get_bypass_latency( stage, depth.memory_stages)));
+    bypassed_data.resize( rps_bypass.size());
+    for ( auto& data : bypassed_data)
+        data.reserve( width);
 
+    // instructions in execution are flushed together with the incoming ones
     wp_bypassing_unit_flush_notify = make_write_port<Instr>("EXECUTE_2_BYPASSING_UNIT_FLUSH_NOTIFY",
-                                                            PORT_BW, PORT_FANOUT);
+                                                            static_cast<uint32>( in_execution.capacity()) + width, PORT_FANOUT);
+
+    // ports of branch resolution are shared with memory stage, which owns them otherwise
+    if ( depth.is_branch_resolved_in_execute)
+    {
+        for ( uint32 thread = 0; thread < threads; ++thread)
+        {
+            wps_flush_all.push_back( make_write_port<bool>( get_thread_port_name( "MEMORY_2_ALL_FLUSH", thread),
+                                                            PORT_BW, FLUSHED_STAGES_NUM));
+            wps_flush_target.push_back( make_write_port<Addr>( get_thread_port_name( "MEMORY_2_FETCH_TARGET", thread),
+                                                               PORT_BW, PORT_FANOUT));
+        }
+        wp_bp_update = make_write_port<BPResolution>("MEMORY_2_FETCH", width, PORT_FANOUT);
+    }
 }    
 
 
+template <typename ISA>
+size_t Execute<ISA>::get_max_instrs_in_execution( const FunctionalUnits& units, uint32 width)
+{
+    const auto max_latency = std::max( { units.get_latency( UnitClass::ALU),
+                                         units.get_latency( UnitClass::MUL),
+                                         units.get_latency( UnitClass::DIV),
+                                         units.get_latency( UnitClass::BRANCH),
+                                         units.get_latency( UnitClass::AGU)});
+    return width * ( max_latency.to_size_t() + 1);
+}
+
+
+template <typename ISA>
+void Execute<ISA>::complete( Cycle cycle)
+{
+    if ( in_execution.empty() || in_execution.front().complete_cycle > cycle)
+    {
+        ++wait_cycles;
+        outcome = StageOutcome::WAIT_FOR_UNITS;
+        TRACE( sout) << "wait for multi-cycle units\n";
+        return;
+    }
+
+    outcome = StageOutcome::PASSED;
+    while ( !in_execution.empty() && in_execution.front().complete_cycle <= cycle)
+    {
+        const auto& instr = in_execution.front().instr;
+        const auto thread = instr.get_thread();
+
+        /* bypass data, flushed instructions keep slots of the bundle */
+        wp_bypass->write( instr.get_bypassing_data(), cycle);
+
+        wp_datapath->write( instr, cycle);
+        completed_instrs += instr.is_flushed() ? 0 : 1;
+
+        const bool is_mispredicted = !wps_flush_all.empty() && instr.is_jump() && !instr.is_flushed() && resolve_jump( instr, cycle);
+
+        /* log */
+        TRACE( sout) << instr << std::endl;
+        in_execution.pop_front();
+
+        /* the younger instructions are invalid */
+        if ( is_mispredicted)
+        {
+            flush_in_execution( thread, cycle);
+            if ( !is_smt())
+                return;
+        }
+    }
+}
+
+
+template <typename ISA>
+bool Execute<ISA>::resolve_jump( const Instr& instr, Cycle cycle)
+{
+    /* acquiring real information for BPU */
+    wp_bp_update->write( instr.get_bp_resolution(), cycle);
+    if ( !instr.is_misprediction())
+        return false;
+
+    /* flushing the pipeline */
+    wps_flush_all.at( instr.get_thread())->write( true, cycle);
+
+    /* sending valid PC to fetch stage */
+    wps_flush_target.at( instr.get_thread())->write( instr.get_new_PC(), cycle);
+    ++flushes;
+    TRACE( sout) << "misprediction on ";
+    return true;
+}
+
+
+template <typename ISA>
+void Execute<ISA>::flush_instr( Instr* instr, Cycle cycle)
+{
+    /* notifying bypassing unit about invalid instruction */
+    wp_bypassing_unit_flush_notify->write( *instr, cycle);
+    trace_event( pipeline_trace, PipelineEvent::FLUSH, *instr, cycle);
+    instr->set_flushed();
+}
+
+
+template <typename ISA>
+void Execute<ISA>::flush_in_execution( uint8 thread, Cycle cycle)
+{
+    for ( size_t i = 0; i < in_execution.size(); ++i)
+    {
+        auto& instr = in_execution[ i].instr;
+        if ( instr.get_thread() == thread && !instr.is_flushed())
+            flush_instr( &instr, cycle);
+    }
+
+    if ( !is_smt())
+        in_execution.clear();
+}
+
+
 template <typename ISA>
 void Execute<ISA>::clock( Cycle cycle)
 {
-    sout << "execute cycle " << std::dec << cycle << ": ";
+    SELF_PROFILE( EXECUTE);
+    TRACE( sout) << "execute cycle " << std::dec << cycle << ": ";
 
-    /* receive flush signal */
-    const bool is_flush = rp_flush->is_ready( cycle) && rp_flush->read( cycle);
+    /* receive flush signals */
+    std::bitset<MAX_HW_THREADS> is_flush;
+    for ( size_t i = 0; i < rps_flush.size(); ++i)
+        is_flush[ i] = rps_flush[ i]->is_ready( cycle) && rps_flush[ i]->read( cycle);
+
+    /* receive all bypassed data, it is ordered by slots of producers */
+    for ( size_t i = 0; i < rps_bypass.size(); i++)
+    {
+        bypassed_data[ i].clear();
+        while ( rps_bypass[ i]->is_ready( cycle))
+            bypassed_data[ i].push_back( rps_bypass[ i]->read( cycle));
+    }
 
     /* branch misprediction */
-    if ( is_flush)
+    if ( !is_smt() && is_flush[ 0])
     {
-        /* ignoring the upcoming instruction as it is invalid */
-        if ( rp_datapath->is_ready( cycle))
+        /* ignoring the upcoming instructions as they are invalid */
+        while ( rp_datapath->is_ready( cycle))
         {
-            const auto& instr = rp_datapath->read( cycle);
-            
-            /* notifying bypassing unit about invalid instruction */
-            wp_bypassing_unit_flush_notify->write( instr, cycle);
+            auto instr = rp_datapath->read( cycle);
+            flush_instr( &instr, cycle);
         }
 
+        /* instructions in multi-cycle units are invalid as well */
+        flush_in_execution( 0, cycle);
+
         /* ignoring information from command ports */
-        for ( auto& port:rps_command)
-            port->ignore( cycle);
-        
-        /* ignoring all bypassed data for source registers */
-        for ( auto& rps_src_ports:rps_sources_bypass)
-        {
-            for ( auto& port:rps_src_ports)
+        for ( auto& ports:rps_command)
+            for ( auto& port:ports)
                 port->ignore( cycle);
-        }
         
-        sout << "flush\n";
+        outcome = StageOutcome::FLUSH;
+        TRACE( sout) << "flush\n";
         return;
     }
 
+    /* flushed threads with SMT */
+    for ( size_t i = 0; i < rps_flush.size(); ++i)
+        if ( is_flush[ i])
+            flush_in_execution( static_cast<uint8>( i), cycle);
+
     /* check if there is something to process */
-    if ( !rp_datapath->is_ready( cycle))
+    if ( !rp_datapath->is_ready( cycle) && in_execution.empty())
+    {
+        outcome = is_flush.any() ? StageOutcome::FLUSH : StageOutcome::BUBBLE;
+        TRACE( sout) << "bubble\n";
+        return;
+    }
+
+    for ( size_t slot = 0; rp_datapath->is_ready( cycle); ++slot)
     {
-        /* ignoring all bypassed data for source registers */
-        for ( auto& rps_src_ports:rps_sources_bypass)
+        auto instr = rp_datapath->read( cycle);
+        if ( is_flush[ instr.get_thread()])
         {
-            for ( auto& port:rps_src_ports)
+            flush_instr( &instr, cycle);
+            for ( auto& port : rps_command[ slot])
                 port->ignore( cycle);
         }
+        trace_event( pipeline_trace, PipelineEvent::EXECUTE, instr, cycle);
 
-        sout << "bubble\n";
-        return;
-    }
+        for ( uint8 src_index = 0; src_index < SRC_REGISTERS_NUM && !instr.is_flushed(); src_index++)
+        {   
+            /* check whether bypassing is needed for a source register */ 
+            if ( rps_command[ slot][ src_index]->is_ready( cycle))
+            {
+                const auto bypass_command = rps_command[ slot][ src_index]->read( cycle);
 
-    auto instr = rp_datapath->read( cycle);
+                /* get a port which should be used for bypassing and receive data */
+                const auto bypass_direction = BypassingUnit::get_bypass_direction( bypass_command);
+                const auto data = bypassed_data[ bypass_direction].at( bypass_command.get_slot());
 
+                /* transform received data in accordance with bypass command */
+                const auto adapted_data = BypassingUnit::adapt_bypassed_data( bypass_command, data);
 
-    for ( uint8 src_index = 0; src_index < SRC_REGISTERS_NUM; src_index++)
-    {   
-        /* check whether bypassing is needed for a source register */ 
-        if ( rps_command[src_index]->is_ready( cycle))
-        {
-            const auto bypass_command = rps_command[src_index]->read( cycle);
-
-            /* get a port which should be used for bypassing and receive data */
-            const auto bypass_direction = BypassingUnit::get_bypass_direction( bypass_command);
-            const auto data = rps_sources_bypass[src_index][bypass_direction]->read( cycle);
-
-            /* ignoring all other ports for a source register */
-            for ( uint8 i = 0; i < RegisterStage::BYPASSING_STAGES_NUMBER; i++)
-            {    
-                if ( i != bypass_direction)
-                    rps_sources_bypass[src_index][i]->ignore( cycle);
+                instr.set_v_src( adapted_data, src_index);
             }
+        }
 
-            /* transform received data in accordance with bypass command */
-            const auto adapted_data = BypassingUnit::adapt_bypassed_data( bypass_command, data);
+        /* perform execution, the result is available after the latency of the unit */
+        if ( !instr.is_replayed() && !instr.is_flushed())
+            instr.execute();
 
-            instr.set_v_src( adapted_data, src_index);
-        }
-        else
-        {
-            /* ignoring all bypassed data for a source register */
-            for ( auto& port:rps_sources_bypass[src_index])
-                port->ignore( cycle);
-        }
+        const auto latency = functional_units.get_latency( FunctionalUnits::get_unit_class( instr));
+        if ( in_execution.full())
+            serr << "Too many instructions in execution" << std::endl << critical;
+        in_execution.emplace_back( instr, cycle + latency - 1_Lt);
     }
-    
 
-    /* perform execution */
-    instr.execute();
-    
-    /* bypass data */
-    wp_bypass->write( instr.get_bypassing_data(), cycle);
+    complete( cycle);
+}
 
-    wp_datapath->write( instr, cycle);
 
-    /* log */
-    sout << instr << std::endl;
+template <typename ISA>
+void Execute<ISA>::register_stats( StatsRegistry* stats) const
+{
+    stats->add_counter( "execute.instrs", &completed_instrs);
+    stats->add_counter( "execute.wait_cycles", &wait_cycles);
+    if ( !wps_flush_all.empty())
+        stats->add_counter( "execute.flushes", &flushes);
 }
 
 
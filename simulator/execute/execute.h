@@ -9,9 +9,19 @@
 
 
 #include <infra/ports/ports.h>
+#include <infra/ring_buffer.h>
+#include <infra/stats/stats.h>
+#include <core/cpi_stack.h>
 #include <core/perf_instr.h>
+#include <core/pipeline_depth.h>
+#include <core/pipeline_trace.h>
+#include <core/smt.h>
 #include <bypass/data_bypass.h>
 
+#include "functional_units.h"
+
+#include <vector>
+
 
 template <typename ISA>
 class Execute : public Log
@@ -22,26 +32,79 @@ class Execute : public Log
     using RegDstUInt = typename ISA::RegDstUInt;
 
     private:
+        struct ExecutedInstr
+        {
+            ExecutedInstr( const Instr& instr, Cycle complete_cycle) : instr( instr), complete_cycle( complete_cycle) { }
+
+            Instr instr;
+            Cycle complete_cycle;
+        };
+
+        const FunctionalUnits functional_units;
+
+        // instructions in multi-cycle units, they are completed in program order
+        RingBuffer<ExecutedInstr> in_execution;
+
         std::unique_ptr<WritePort<Instr>> wp_datapath = nullptr;
         std::unique_ptr<ReadPort<Instr>> rp_datapath = nullptr;
 
-        std::unique_ptr<ReadPort<bool>> rp_flush = nullptr;
+        // flush signals of each hardware thread
+        std::vector<std::unique_ptr<ReadPort<bool>>> rps_flush = {};
 
         static constexpr const uint8 SRC_REGISTERS_NUM = 2;
 
-        std::array<std::unique_ptr<ReadPort<typename BypassingUnit::BypassCommand>>, SRC_REGISTERS_NUM>
+        // command ports of each source register of each slot in the bundle
+        std::vector<std::array<std::unique_ptr<ReadPort<typename BypassingUnit::BypassCommand>>, SRC_REGISTERS_NUM>>
             rps_command;
         
-        std::array<std::array<std::unique_ptr<ReadPort<RegDstUInt>>, RegisterStage::BYPASSING_STAGES_NUMBER>, SRC_REGISTERS_NUM>
-            rps_sources_bypass;
+        // bypassed data of each stage, ordered by slots of the producers
+        std::vector<std::unique_ptr<ReadPort<RegDstUInt>>> rps_bypass = {};
         
         std::unique_ptr<WritePort<RegDstUInt>> wp_bypass = nullptr;
 
+        // bypassed data received in the current cycle, memory is kept between cycles
+        std::vector<std::vector<RegDstUInt>> bypassed_data = {};
+
         std::unique_ptr<WritePort<Instr>> wp_bypassing_unit_flush_notify = nullptr;
+
+        // jumps are resolved here instead of memory stage if they are set, flushes are sent to each thread
+        std::vector<std::unique_ptr<WritePort<bool>>> wps_flush_all = {};
+        std::vector<std::unique_ptr<WritePort<Addr>>> wps_flush_target = {};
+        std::unique_ptr<WritePort<BPResolution>> wp_bp_update = nullptr;
+
+        void complete( Cycle cycle);
+
+        // returns true if the jump is mispredicted, then the younger instructions are flushed
+        bool resolve_jump( const Instr& instr, Cycle cycle);
+
+        // instructions of other threads keep their slots in completed bundles with SMT,
+        // so the flushed ones stay in the units doing nothing
+        void flush_in_execution( uint8 thread, Cycle cycle);
+        void flush_instr( Instr* instr, Cycle cycle);
+        bool is_smt() const { return rps_flush.size() > 1; }
+
+        // each unit takes up to width instructions per cycle for this number of cycles
+        static size_t get_max_instrs_in_execution( const FunctionalUnits& units, uint32 width);
+
+        /* Counters of completed instructions, cycles waiting for multi-cycle units and pipeline flushes */
+        uint64 completed_instrs = 0;
+        uint64 wait_cycles = 0;
+        uint64 flushes = 0;
+
+        /* Result of the last clock for CPI stack */
+        StageOutcome outcome = StageOutcome::BUBBLE;
+
+        PipelineTrace* pipeline_trace = nullptr;
     
     public:
-        explicit Execute( bool log);
+        Execute( bool log, uint32 width, const PipelineDepth& depth = PipelineDepth(), uint32 threads = 1);
         void clock( Cycle cycle);
+        void register_stats( StatsRegistry* stats) const;
+        void set_pipeline_trace( PipelineTrace* value) { pipeline_trace = value; }
+        StageOutcome get_outcome() const { return outcome; }
+
+        // true if clocking without input tokens does not change the unit
+        bool is_idle() const { return in_execution.empty(); }
 };
 
 
@@ -0,0 +1,101 @@
+/**
+ * functional_units.cpp - latencies and occupancy of execution units
+ * Copyright 2018 MIPT-MIPS
+ */
+
+
+#include <infra/config/config.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include "functional_units.h"
+
+namespace config {
+    static Value<uint32> alu_latency = { "alu-latency", 1, "Latency of arithmetic and logic units (in cycles)"};
+    static Value<uint32> mul_latency = { "mul-latency", 4, "Latency of multiplication unit (in cycles)"};
+    static Value<uint32> div_latency = { "div-latency", 12, "Latency of division unit (in cycles)"};
+    static Value<uint32> branch_latency = { "branch-latency", 1, "Latency of branch units (in cycles)"};
+    static Value<uint32> agu_latency = { "agu-latency", 1, "Latency of address generation units (in cycles)"};
+    static Value<std::string> iterative_units = { "iterative-units", "div", "units which are not pipelined: none or comma-separated list of alu, mul, div, branch and agu"};
+} // namespace config
+
+static const std::array<std::string, 5> unit_names = {{ "alu", "mul", "div", "branch", "agu"}};
+
+FunctionalUnits::FunctionalUnits( uint32 width, uint32 execute_stages) : width( width)
+{
+    const std::array<uint32, UNIT_CLASSES_NUM> latencies = {{ config::alu_latency, config::mul_latency,
+                                                              config::div_latency, config::branch_latency,
+                                                              config::agu_latency}};
+    const std::array<uint32, UNIT_CLASSES_NUM> units_numbers = {{ width, 1, 1, width, width}};
+
+    for ( size_t i = 0; i < UNIT_CLASSES_NUM; ++i)
+    {
+        // each execute sub-stage after the first one adds a cycle to all the units
+        const uint32 max_latency = MAX_VAL8 - ( execute_stages - 1);
+        if ( latencies[ i] == 0 || latencies[ i] > max_latency)
+        {
+            std::cerr << "ERROR. Latency of " << unit_names[ i] << " units must be from 1 to "
+                      << max_latency << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+        classes[ i].latency = Latency( latencies[ i] + execute_stages - 1);
+        classes[ i].free_cycles.resize( units_numbers[ i], 0_Cl);
+    }
+
+    const std::string& iterative = config::iterative_units;
+    if ( iterative == "none")
+        return;
+
+    std::istringstream iss( iterative);
+    for ( std::string name; std::getline( iss, name, ',');)
+    {
+        const auto it = std::find( unit_names.begin(), unit_names.end(), name);
+        if ( it == unit_names.end())
+        {
+            std::cerr << "ERROR. Invalid functional unit " << name << " in the list of iterative units" << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+        classes.at( static_cast<size_t>( it - unit_names.begin())).is_iterative = true;
+    }
+}
+
+bool FunctionalUnits::is_available( UnitClass unit, Cycle cycle) const
+{
+    const auto& units = get_class( unit);
+    const bool has_free_unit = std::any_of( units.free_cycles.begin(), units.free_cycles.end(),
+                                            [cycle]( Cycle free_cycle) { return free_cycle <= cycle; });
+
+    const auto complete_cycle = get_complete_cycle( unit, cycle);
+    const bool is_in_order = complete_cycle > last_complete_cycle
+                          || ( complete_cycle == last_complete_cycle && last_complete_count < width);
+
+    return has_free_unit && is_in_order;
+}
+
+uint8 FunctionalUnits::issue( UnitClass unit, Cycle cycle)
+{
+    auto& units = get_class( unit);
+    auto free_unit = std::find_if( units.free_cycles.begin(), units.free_cycles.end(),
+                                   [cycle]( Cycle free_cycle) { return free_cycle <= cycle; });
+
+    /* iterative unit is busy until the instruction is completed */
+    *free_unit = units.is_iterative ? cycle + units.latency : cycle + 1_Lt;
+
+    const auto complete_cycle = get_complete_cycle( unit, cycle);
+    if ( complete_cycle != last_complete_cycle)
+        last_complete_count = 0;
+
+    last_complete_cycle = complete_cycle;
+    return static_cast<uint8>( last_complete_count++);
+}
+
+void FunctionalUnits::flush()
+{
+    for ( auto& units : classes)
+        std::fill( units.free_cycles.begin(), units.free_cycles.end(), 0_Cl);
+
+    last_complete_cycle = 0_Cl;
+    last_complete_count = 0;
+}
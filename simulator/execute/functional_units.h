@@ -0,0 +1,92 @@
+/**
+ * functional_units.h - latencies and occupancy of execution units
+ * Copyright 2018 MIPT-MIPS
+ */
+
+
+#ifndef FUNCTIONAL_UNITS_H
+#define FUNCTIONAL_UNITS_H
+
+
+#include <infra/ports/timing.h>
+
+#include <array>
+#include <vector>
+
+
+enum class UnitClass : uint8
+{
+    ALU,
+    MUL,
+    DIV,
+    BRANCH,
+    AGU
+};
+
+/*
+ * Latency of each class of units is configurable, sub-stages of a deeper
+ * execute stage are added to all of them. Pipelined units accept
+ * a new instruction every cycle, iterative ones wait for completion of the previous one.
+ * ALUs, branch units and AGUs are provided for each slot of the bundle,
+ * multiplication and division units are shared by all the slots.
+ *
+ * Instructions leave execute stage in program order, no more than width per cycle,
+ * so an instruction is not issued if it would complete before the older ones.
+ */
+class FunctionalUnits
+{
+    public:
+        explicit FunctionalUnits( uint32 width, uint32 execute_stages = 1);
+
+        template <typename Instr>
+        static UnitClass get_unit_class( const Instr& instr)
+        {
+            if ( instr.is_load() || instr.is_store())
+                return UnitClass::AGU;
+            if ( instr.is_jump())
+                return UnitClass::BRANCH;
+            if ( instr.is_division())
+                return UnitClass::DIV;
+            if ( instr.is_multiplication())
+                return UnitClass::MUL;
+            return UnitClass::ALU;
+        }
+
+        Latency get_latency( UnitClass unit) const { return get_class( unit).latency; }
+
+        // checks whether an instruction issued at the cycle starts execution at the next one
+        bool is_available( UnitClass unit, Cycle cycle) const;
+
+        // occupies a unit by an instruction issued at the cycle,
+        // returns its position in the bundle leaving execute stage
+        uint8 issue( UnitClass unit, Cycle cycle);
+
+        // releases the units as all the instructions in execution are flushed
+        void flush();
+
+    private:
+        struct UnitsOfClass
+        {
+            Latency latency = 1_Lt;
+            bool is_iterative = false;
+            std::vector<Cycle> free_cycles = {}; // the first cycles to issue to each unit
+        };
+
+        static constexpr const size_t UNIT_CLASSES_NUM = 5;
+
+        std::array<UnitsOfClass, UNIT_CLASSES_NUM> classes = {};
+        const uint32 width;
+
+        // the youngest bundle leaving execute stage
+        Cycle last_complete_cycle = 0_Cl;
+        uint32 last_complete_count = 0;
+
+        UnitsOfClass& get_class( UnitClass unit) { return classes.at( static_cast<size_t>( unit)); }
+        const UnitsOfClass& get_class( UnitClass unit) const { return classes.at( static_cast<size_t>( unit)); }
+
+        // last cycle of execution of an instruction issued at the cycle
+        Cycle get_complete_cycle( UnitClass unit, Cycle cycle) const { return cycle + get_latency( unit); }
+};
+
+
+#endif // FUNCTIONAL_UNITS_H
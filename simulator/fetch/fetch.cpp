@@ -3,193 +3,681 @@
  * Copyright 2015-2018 MIPT-MIPS
  */
 
+#include <bpu/folded_history.h>
 #include <infra/config/config.h>
+#include <infra/self_profiler/self_profiler.h>
+
+#include <cstdlib>
+#include <iostream>
  
 #include "fetch.h"
 
 namespace config {
     static Value<std::string> bp_mode = { "bp-mode", "dynamic_two_bit", "branch prediction mode"};
     static Value<uint32> bp_size = { "bp-size", 128, "BTB size in entries"};
+    static Value<uint32> bp_budget = { "bp-budget", 0, "storage budget of BTB in kilobytes, it replaces bp-size if it is not zero"};
     static Value<uint32> bp_ways = { "bp-ways", 16, "number of ways in BTB"};
+    static Value<std::string> bp_replacement = { "bp-replacement", "lru", "replacement policy of BTB: lru, plru, nru or random"};
+    static Value<uint32> bp_direction_size = { "bp-direction-size", 4096, "storage budget of global history direction predictor in bytes"};
+    static Value<uint32> ras_size = { "ras-size", 16, "number of entries in return address stack, 0 disables it"};
+    static Value<uint32> ittage_size = { "ittage-size", 0, "storage budget of ITTAGE indirect target predictor in bytes, 0 disables it"};
+    static Value<uint32> hot_branches = { "hot-branches", 0, "number of branches of the most mispredictions reported at the end of simulation"};
 
     /* Cache parameters */
     static Value<uint32> instruction_cache_size = { "icache-size", 2048, "Size of instruction level 1 cache (in bytes)"};
     static Value<uint32> instruction_cache_ways = { "icache-ways", 4, "Amount of ways in instruction level 1 cache"};
     static Value<uint32> instruction_cache_line_size = { "icache-line-size", 64, "Line size of instruction level 1 cache (in bytes)"};
+    static Value<std::string> instruction_cache_replacement = { "icache-replacement", "lru", "Replacement policy of instruction level 1 cache: lru, plru, nru or random"};
+    static Value<uint32> instruction_cache_miss_latency = { "icache-miss-latency", 30, "Latency of instruction level 1 cache miss (in cycles)"};
+    static Value<uint32> instruction_cache_fills = { "icache-fills", 4, "Maximal number of outstanding line fills of instruction level 1 cache"};
+
+    /* Decoded instructions */
+    static Value<uint32> uop_cache_size = { "uop-cache-size", 0, "number of fetch blocks in decoded micro-op cache, 0 disables it"};
+    static Value<uint32> uop_cache_ways = { "uop-cache-ways", 8, "number of ways in decoded micro-op cache"};
+    static Value<uint32> loop_buffer_size = { "loop-buffer-size", 0, "maximal number of instructions in loop streamed by loop buffer, 0 disables it"};
+
+    /* SMT */
+    static Value<std::string> smt_fetch_policy = { "smt-fetch-policy", "round-robin", "selection of hardware thread fetched in a cycle: round-robin, icount or switch-on-miss"};
+
+    /* Prefetcher parameters */
+    static Value<std::string> instruction_prefetcher = { "icache-prefetch", "none", "instruction prefetcher: none, next-line or stream"};
+    static Value<uint32> instruction_prefetch_degree = { "icache-prefetch-degree", 1, "number of lines prefetched ahead of fetch"};
 } // namespace config
 
+/* jumps are resolved in program order, so older predictions are not needed */
+static const size_t MAX_JUMPS_IN_FLIGHT = 4096;
+
+/* no thread is fetched in the cycle */
+static const uint32 NO_THREAD = MAX_HW_THREADS;
+
+/* reported branches are tracked among many others, so errors of their counts are small */
+static const size_t TRACKED_PER_HOT_BRANCH = 16;
+
+/* each entry of BTB keeps a target and a tag with the state of direction in 8 bytes,
+   the tag array holds an entry per 4 units of the size it is created with */
+static uint32 get_bp_size()
+{
+    if ( config::bp_budget == 0)
+        return config::bp_size;
+
+    return floor_power_of_two( uint64{ config::bp_budget} * 1024 / 8) * 4;
+}
+
 template <typename ISA>
-Fetch<ISA>::Fetch(bool log) : Log( log)
+Fetch<ISA>::Fetch( bool log, uint32 width, uint32 threads_num) : Log( log)
+    , bp( BPFactory().create_any( config::bp_mode, get_bp_size(), config::bp_ways, 32, config::bp_replacement, config::bp_direction_size))
+    , threads( threads_num)
+    , policy( get_policy( config::smt_fetch_policy))
+    , width( width)
+    , predictions( MAX_JUMPS_IN_FLIGHT)
+    , miss_latency( config::instruction_cache_miss_latency)
+    , max_fills( config::instruction_cache_fills)
+    , prefetcher( get_prefetcher( config::instruction_prefetcher))
+    , prefetch_degree( config::instruction_prefetch_degree)
+    , bp_mode( config::bp_mode)
+    , hot_branches( TRACKED_PER_HOT_BRANCH * config::hot_branches)
+    , loop_buffer( config::loop_buffer_size)
 {
-    wp_datapath = make_write_port<Instr>("FETCH_2_DECODE", PORT_BW, PORT_FANOUT);
-    rp_stall = make_read_port<bool>("DECODE_2_FETCH_STALL", PORT_LATENCY);
+    if ( miss_latency == 0_Lt || max_fills == 0)
+        serr << "ERROR. Instruction cache miss latency and number of fills should be greater than zero"
+             << std::endl << critical;
 
-    rp_flush_target = make_read_port<Addr>("MEMORY_2_FETCH_TARGET", PORT_LATENCY);
+    if ( prefetcher != Prefetcher::NONE && prefetch_degree == 0)
+        serr << "ERROR. Degree of instruction prefetcher should be greater than zero"
+             << std::endl << critical;
 
-    wp_target = make_write_port<Addr>("TARGET", PORT_BW, PORT_FANOUT);
-    rp_target = make_read_port<Addr>("TARGET", PORT_LATENCY);
+    for ( uint32 i = 0; i < threads.size(); ++i)
+    {
+        auto& thread = threads[ i];
+        const auto name = [i]( const std::string& port) { return get_thread_port_name( port, i); };
+
+        thread.wp_datapath = make_write_port<Instr>( name( "FETCH_2_DECODE"), width, PORT_FANOUT);
+        thread.rp_stall = make_read_port<bool>( name( "DECODE_2_FETCH_STALL"), PORT_LATENCY);
+
+        thread.rp_flush_target = make_read_port<Addr>( name( "MEMORY_2_FETCH_TARGET"), PORT_LATENCY);
 
-    wp_hold_pc = make_write_port<Addr>("HOLD_PC", PORT_BW, PORT_FANOUT);
-    rp_hold_pc = make_read_port<Addr>("HOLD_PC", PORT_LATENCY);
+        thread.wp_target = make_write_port<Addr>( name( "TARGET"), PORT_BW, PORT_FANOUT);
+        thread.rp_target = make_read_port<Addr>( name( "TARGET"), PORT_LATENCY);
 
-    rp_external_target = make_read_port<Addr>("CORE_2_FETCH_TARGET", PORT_LATENCY);
+        thread.wp_hold_pc = make_write_port<Addr>( name( "HOLD_PC"), PORT_BW, PORT_FANOUT);
+        thread.rp_hold_pc = make_read_port<Addr>( name( "HOLD_PC"), PORT_LATENCY);
+
+        thread.rp_external_target = make_read_port<Addr>( name( "CORE_2_FETCH_TARGET"), PORT_LATENCY);
+    }
 
-    rp_bp_update = make_read_port<BPInterface>("MEMORY_2_FETCH", PORT_LATENCY);
+    if ( threads.size() > 1)
+    {
+        rp_decoded = make_read_port<ThreadCounts>("DECODE_2_FETCH_THREAD_INSTRS", PORT_LATENCY);
+        rp_thread_halt = make_read_port<uint8>("WRITEBACK_2_FETCH_THREAD_HALT", PORT_LATENCY);
+    }
 
-    wp_long_latency_pc_holder = make_write_port<Addr>("LONG_LATENCY_PC_HOLDER", PORT_BW, PORT_FANOUT);
-    rp_long_latency_pc_holder = make_read_port<Addr>("LONG_LATENCY_PC_HOLDER", PORT_LONG_LATENCY);
+    if ( threads.size() > 1 && config::loop_buffer_size != 0)
+        serr << "ERROR. Loop buffer streams a single thread, it is not supported with SMT" << std::endl << critical;
 
-    wp_hit_or_miss = make_write_port<bool>("HIT_OR_MISS", PORT_BW, PORT_FANOUT);
-    rp_hit_or_miss = make_read_port<bool>("HIT_OR_MISS", PORT_LATENCY);
+    rp_bp_update = make_read_port<BPResolution>("MEMORY_2_FETCH", PORT_LATENCY);
 
-    BPFactory bp_factory;
-    bp = bp_factory.create( config::bp_mode, config::bp_size, config::bp_ways);
+    if ( config::ras_size != 0 || config::ittage_size != 0)
+        target_predictors.emplace( config::ras_size, config::ittage_size);
     tags = std::make_unique<CacheTagArray>( config::instruction_cache_size, 
                                             config::instruction_cache_ways, 
-                                            config::instruction_cache_line_size);
+                                            config::instruction_cache_line_size,
+                                            32,
+                                            config::instruction_cache_replacement);
+    prefetched_ways.resize( size_t{ tags->sets} * tags->ways, false);
+
+    /* blocks are tagged by the address of their first instruction */
+    if ( config::uop_cache_size != 0)
+        uop_tags = std::make_unique<CacheTagArray>( config::uop_cache_size * 4, config::uop_cache_ways, 4);
+}
+
+template <typename ISA>
+typename Fetch<ISA>::FetchPolicy Fetch<ISA>::get_policy( const std::string& name)
+{
+    if ( name == "round-robin")
+        return FetchPolicy::ROUND_ROBIN;
+    if ( name == "icount")
+        return FetchPolicy::ICOUNT;
+    if ( name == "switch-on-miss")
+        return FetchPolicy::SWITCH_ON_MISS;
+
+    std::cerr << "ERROR. Invalid SMT fetch policy " << name << std::endl
+              << "Supported policies: round-robin, icount, switch-on-miss" << std::endl;
+    std::exit( EXIT_FAILURE);
+}
+
+template <typename ISA>
+typename Fetch<ISA>::Prefetcher Fetch<ISA>::get_prefetcher( const std::string& name)
+{
+    if ( name == "none")
+        return Prefetcher::NONE;
+    if ( name == "next-line")
+        return Prefetcher::NEXT_LINE;
+    if ( name == "stream")
+        return Prefetcher::STREAM;
+
+    std::cerr << "ERROR. Invalid instruction prefetcher " << name << std::endl
+              << "Supported prefetchers: none, next-line, stream" << std::endl;
+    std::exit( EXIT_FAILURE);
 }
 
 template <typename ISA>
-Addr Fetch<ISA>::get_PC( Cycle cycle) 
+Addr Fetch<ISA>::get_PC( Thread* thread, Cycle cycle)
 {
     /* receive flush and stall signals */
-    const bool is_stall = rp_stall->is_ready( cycle) && rp_stall->read( cycle);
+    const bool is_stall = thread->rp_stall->is_ready( cycle) && thread->rp_stall->read( cycle);
 
     /* Receive all possible PC */
-    const Addr external_PC = rp_external_target->is_ready( cycle) ? rp_external_target->read( cycle) : 0;
-    const Addr hold_PC     = rp_hold_pc->is_ready( cycle) ? rp_hold_pc->read( cycle) : 0;
-    const Addr flushed_PC  = rp_flush_target->is_ready( cycle) ? rp_flush_target->read( cycle) : 0;
-    const Addr target_PC   = rp_target->is_ready( cycle) ? rp_target->read( cycle) : 0;
+    const Addr external_PC = thread->rp_external_target->is_ready( cycle) ? thread->rp_external_target->read( cycle) : 0;
+    const Addr hold_PC     = thread->rp_hold_pc->is_ready( cycle) ? thread->rp_hold_pc->read( cycle) : 0;
+    const bool is_flush    = thread->rp_flush_target->is_ready( cycle);
+    const Addr flushed_PC  = is_flush ? thread->rp_flush_target->read( cycle) : 0;
+    const Addr target_PC   = thread->rp_target->is_ready( cycle) ? thread->rp_target->read( cycle) : 0;
 
     /* Multiplexing */
     if ( external_PC != 0)
         return external_PC;
 
-    if( flushed_PC != 0)
+    /* jump to zero address halts the program, so fetch stops instead of going on the wrong path */
+    if( is_flush)
         return flushed_PC;
 
-    if ( !is_stall && target_PC != 0)
-        return target_PC;
+    const Addr PC = target_PC != 0 ? target_PC : hold_PC;
+
+    /* decode keeps the bundle fetched in the last cycle, so the next PC waits for the end of stall */
+    if ( is_stall && PC != 0)
+    {
+        thread->wp_hold_pc->write( PC, cycle);
+        return 0;
+    }
+
+    return PC;
+}
+
+template <typename ISA>
+void Fetch<ISA>::clock_threads( Cycle cycle)
+{
+    if ( threads.size() == 1)
+        return;
+
+    /* instructions leave the front of pipeline once they are issued or flushed by decode */
+    while ( rp_decoded->is_ready( cycle))
+    {
+        const auto& decoded = rp_decoded->read( cycle);
+        for ( size_t i = 0; i < threads.size(); ++i)
+            threads[ i].icount -= decoded.at( i);
+    }
+
+    while ( rp_thread_halt->is_ready( cycle))
+    {
+        auto& thread = threads.at( rp_thread_halt->read( cycle));
+        thread.is_halted = true;
+        thread.is_miss_pending = false;
+    }
+}
+
+template <typename ISA>
+uint32 Fetch<ISA>::select_thread( const std::array<Addr, MAX_HW_THREADS>& PCs)
+{
+    const auto size = static_cast<uint32>( threads.size());
+
+    /* the current thread is fetched until it misses in instruction cache or halts */
+    if ( policy == FetchPolicy::SWITCH_ON_MISS)
+    {
+        for ( uint32 i = 0; i < size; ++i)
+        {
+            const uint32 thread = ( current_thread + i) % size;
+            if ( threads[ thread].is_miss_pending || threads[ thread].is_halted)
+                continue;
+
+            current_thread = thread;
+            return PCs.at( thread) != 0 ? thread : NO_THREAD;
+        }
+        return NO_THREAD;
+    }
+
+    /* threads are taken in turn, ICOUNT takes the one of the fewest instructions in front of issue */
+    uint32 selected = NO_THREAD;
+    for ( uint32 i = 1; i <= size; ++i)
+    {
+        const uint32 thread = ( current_thread + i) % size;
+        if ( PCs.at( thread) == 0)
+            continue;
+
+        if ( selected == NO_THREAD || threads[ thread].icount < threads[ selected].icount)
+            selected = thread;
+        if ( policy == FetchPolicy::ROUND_ROBIN)
+            break;
+    }
 
-    if ( hold_PC != 0)
-        return hold_PC;
-    
-    return 0;
+    if ( selected != NO_THREAD)
+        current_thread = selected;
+    return selected;
+}
+
+template <typename ISA>
+bool Fetch<ISA>::is_waiting_for_miss() const
+{
+    const auto is_waiting = []( const Thread& thread) { return thread.is_miss_pending || thread.is_halted; };
+    const auto is_missing = []( const Thread& thread) { return thread.is_miss_pending; };
+    return std::all_of( threads.begin(), threads.end(), is_waiting)
+        && std::any_of( threads.begin(), threads.end(), is_missing);
+}
+
+template <typename ISA>
+Cycle Fetch<ISA>::get_miss_ready_cycle() const
+{
+    auto ready = NO_EVENT_CYCLE;
+    for ( const auto& thread : threads)
+        if ( thread.is_miss_pending)
+            ready = std::min( ready, thread.miss_ready);
+    return ready;
 }
 
 template <typename ISA>
 void Fetch<ISA>::clock_bp( Cycle cycle)
 {
     /* Process BP updates */
-    if ( rp_bp_update->is_ready( cycle))
-        bp->update( rp_bp_update->read( cycle));
+    while ( rp_bp_update->is_ready( cycle))
+    {
+        const auto& resolution = rp_bp_update->read( cycle);
+        ++resolved_jumps;
+        mispredictions += resolution.is_misprediction ? 1 : 0;
+        hot_branches.update( resolution.pc, resolution.is_taken, resolution.is_misprediction);
+        if ( profiler != nullptr && resolution.is_misprediction)
+            profiler->count( ProfileEvent::MISPREDICTIONS, resolution.pc);
+        const auto& record = get_prediction( resolution.prediction_id);
+        if ( !record.is_streamed)
+            update_bp( get_bp_update( record.prediction, resolution));
+    }
 }
 
 template <typename ISA>
-void Fetch<ISA>::clock_instr_cache( Cycle cycle) 
+BPInterface Fetch<ISA>::predict( Addr PC, BranchType type)
 {
-    ignore( cycle);
-    
-    if( rp_long_latency_pc_holder->is_ready( cycle))
+    auto info = std::visit( [PC, type]( auto& predictor) { return predictor.predict( PC, type); }, bp);
+    if ( target_predictors.has_value())
+        target_predictors->predict( &info, PC, type);
+    return info;
+}
+
+template <typename ISA>
+void Fetch<ISA>::update_bp( const BPInterface& bp_upd)
+{
+    std::visit( [&bp_upd]( auto& predictor) { predictor.update( bp_upd); }, bp);
+    if ( target_predictors.has_value())
+        target_predictors->update( bp_upd);
+}
+
+template <typename ISA>
+uint32 Fetch<ISA>::save_prediction( const BPInterface& prediction, bool is_streamed)
+{
+    const auto id = next_prediction_id++;
+    predictions[ id % predictions.size()] = { id, prediction, is_streamed};
+    return id;
+}
+
+template <typename ISA>
+auto Fetch<ISA>::get_prediction( uint32 id) const -> const PredictionRecord&
+{
+    const auto& record = predictions[ id % predictions.size()];
+    if ( record.id != id)
+        serr << "ERROR. Too many jumps in flight, prediction " << id << " is overwritten" << std::endl << critical;
+    return record;
+}
+
+template <typename ISA>
+BPInterface Fetch<ISA>::get_bp_update( BPInterface prediction, const BPResolution& resolution)
+{
+    /* speculative state recorded at prediction is sent back for repair */
+    prediction.pc = resolution.pc;
+    prediction.is_taken = resolution.is_taken;
+    prediction.target = resolution.target;
+    prediction.is_misprediction = resolution.is_misprediction;
+    prediction.type = resolution.type;
+    return prediction;
+}
+
+template <typename ISA>
+Cycle Fetch<ISA>::allocate_fill( Addr line, Cycle cycle, bool is_prefetch)
+{
+    auto start = cycle;
+    if ( fills.size() >= max_fills)
     {
-        /* get PC from long-latency port if it's possible */
-        auto PC = rp_long_latency_pc_holder->read( cycle);
-        
-        /* write new PC to tags array */
-        tags->write( PC);
-        
-        /* save PC to the next stage */
-        wp_hold_pc->write( PC, cycle);
-        return;
+        // wait for the earliest fill
+        const auto earliest = std::min_element( fills.begin(), fills.end(),
+                                                []( const LineFill& a, const LineFill& b) { return a.ready < b.ready; });
+        start = earliest->ready;
     }
-    wp_hit_or_miss->write( false, cycle);
+
+    const auto ready = start + miss_latency;
+    fills.push_back( { line, ready, is_prefetch});
+    return ready;
 }
 
 template <typename ISA>
-void Fetch<ISA>::ignore( Cycle cycle)
+void Fetch<ISA>::complete_fills( Cycle cycle)
 {
-    /* ignore PC from other ports in the case of cache miss */ 
-    rp_external_target->ignore( cycle);
-    rp_hold_pc->ignore( cycle);
-    rp_target->ignore( cycle);
+    /* write arrived lines to tags array in order of their arrival */
+    while ( !fills.empty())
+    {
+        const auto fill = std::min_element( fills.begin(), fills.end(),
+                                            []( const LineFill& a, const LineFill& b) { return a.ready < b.ready; });
+        if ( cycle < fill->ready)
+            return;
 
-    /* ignore miss signal */
-    rp_hit_or_miss->ignore( cycle);
+        prefetched_ways[ get_way_index( fill->line, tags->write( fill->line))] = fill->is_prefetch;
+
+        fills.erase( fill);
+    }
 }
 
 template <typename ISA>
-void Fetch<ISA>::save_flush( Cycle cycle)
+void Fetch<ISA>::prefetch_line( Addr line, Cycle cycle)
 {
-    /* save PC in the case of flush signal */
-    if( rp_flush_target->is_ready( cycle))
-        wp_target->write( rp_flush_target->read( cycle), cycle);
-    else if( rp_target->is_ready( cycle))
-        wp_target->write( rp_target->read( cycle), cycle);
+    /* prefetches never wait for free fills */
+    if ( fills.size() >= max_fills || tags->read_no_touch( line).first || find_fill( line) != fills.end())
+        return;
+
+    allocate_fill( line, cycle, true);
+    ++statistics.prefetches;
 }
 
+template <typename ISA>
+void Fetch<ISA>::prefetch( Addr PC, bool is_miss, bool is_prefetched, Cycle cycle)
+{
+    const Addr line = get_line( PC);
+    const Addr line_size = tags->line_size;
 
+    switch ( prefetcher)
+    {
+    case Prefetcher::NONE:
+        break;
+    case Prefetcher::NEXT_LINE:
+        if ( line != last_line)
+            for ( uint32 i = 1; i <= prefetch_degree; ++i)
+                prefetch_line( line + i * line_size, cycle);
+        break;
+    case Prefetcher::STREAM:
+        if ( is_prefetched)
+        {
+            /* stream is kept ahead of fetch */
+            prefetch_line( line + prefetch_degree * line_size, cycle);
+        }
+        else if ( is_miss)
+        {
+            /* sequential misses start a stream */
+            if ( line == last_miss_line + line_size)
+                for ( uint32 i = 1; i <= prefetch_degree; ++i)
+                    prefetch_line( line + i * line_size, cycle);
+            last_miss_line = line;
+        }
+        break;
+    }
+
+    last_line = line;
+}
 
 template <typename ISA>
-Addr Fetch<ISA>::get_cached_PC( Cycle cycle)
+void Fetch<ISA>::ignore( Thread* thread, Cycle cycle)
 {
-    /* simulate request to the memory in the case of cache miss */
-    if( rp_hit_or_miss->is_ready( cycle))
+    /* ignore PC from other ports in the case of cache miss,
+       stalled instructions are kept by decode, so they are not fetched again */
+    thread->rp_external_target->ignore( cycle);
+    thread->rp_hold_pc->ignore( cycle);
+    thread->rp_target->ignore( cycle);
+    thread->rp_stall->ignore( cycle);
+}
+
+template <typename ISA>
+void Fetch<ISA>::save_flush( Thread* thread, Cycle cycle)
+{
+    /* save PC in the case of flush signal */
+    if( thread->rp_flush_target->is_ready( cycle))
+        thread->saved_target = thread->rp_flush_target->read( cycle);
+    else if( thread->rp_target->is_ready( cycle))
+        thread->saved_target = thread->rp_target->read( cycle);
+}
+
+template <typename ISA>
+Addr Fetch<ISA>::get_thread_PC( Thread* thread, Cycle cycle)
+{
+    /* wrong path of the halted program may still be flushed */
+    if ( thread->is_halted)
     {
-        save_flush( cycle);
-        clock_instr_cache( cycle);
+        ignore( thread, cycle);
+        thread->rp_flush_target->ignore( cycle);
         return 0;
     }
 
-    /* getting PC */
-    auto PC = get_PC( cycle);
+    /* simulate request to the memory in the case of cache miss */
+    if( thread->is_miss_pending)
+    {
+        outcome = StageOutcome::ICACHE_MISS;
+        save_flush( thread, cycle);
+        ignore( thread, cycle);
 
-    /* push bubble */
-    if( PC == 0)
+        if ( cycle < thread->miss_ready)
+            return 0;
+
+        /* save PC to the next stage */
+        thread->wp_hold_pc->write( thread->miss_PC, cycle);
+
+        /* release PC saved during the miss */
+        if ( thread->saved_target != 0)
+            thread->wp_target->write( thread->saved_target, cycle);
+
+        thread->is_miss_pending = false;
+        thread->saved_target = 0;
         return 0;
+    }
+
+    return get_PC( thread, cycle);
+}
+
+template <typename ISA>
+Addr Fetch<ISA>::get_cached_PC( Thread* thread, Addr PC, Cycle cycle)
+{
+    outcome = StageOutcome::PASSED;
+    if ( loop_buffer.is_streamed( PC))
+    {
+        source = FetchSource::LOOP_BUFFER;
+        return PC;
+    }
+
+    /* a missed block is decoded from instruction cache and kept */
+    if ( uop_tags != nullptr && uop_tags->lookup( PC))
+    {
+        source = FetchSource::UOP_CACHE;
+        return PC;
+    }
+    source = FetchSource::ICACHE;
 
     /* hit or miss */
-    auto is_hit = tags->lookup( PC);
-    
+    const auto[ is_hit, way] = tags->read( PC);
+    const auto line = get_line( PC);
+
+    /* prefetched line is requested for the first time */
+    bool is_prefetched = is_hit && prefetched_ways[ get_way_index( PC, way)];
+    if ( is_prefetched)
+        prefetched_ways[ get_way_index( PC, way)] = false;
+
     if( !is_hit)
     {
-        /* send miss to the next cycle */
-        wp_hit_or_miss->write( is_hit, cycle);
-
-        /* send PC to cache*/
-        wp_long_latency_pc_holder->write( PC, cycle);
-        return 0;
+        /* line may be requested by prefetcher already */
+        const auto fill = find_fill( line);
+        is_prefetched = fill != fills.end() && fill->is_prefetch;
+        if ( is_prefetched)
+        {
+            fill->is_prefetch = false;
+        }
+        else
+        {
+            ++statistics.demand_misses;
+            if ( profiler != nullptr)
+                profiler->count( ProfileEvent::ICACHE_MISSES, PC);
+        }
+
+        /* wait for the line from the next cycle */
+        thread->is_miss_pending = true;
+        thread->miss_PC = PC;
+        thread->miss_ready = fill != fills.end() ? fill->ready : allocate_fill( line, cycle, false);
     }
-    return PC;
+
+    /* the block is decoded only when instruction cache delivers it */
+    if ( is_hit && uop_tags != nullptr)
+        uop_tags->write( PC);
+
+    if ( is_prefetched)
+        ++statistics.useful_prefetches;
+
+    prefetch( PC, !is_hit, is_prefetched, cycle);
+    outcome = is_hit ? StageOutcome::PASSED : StageOutcome::ICACHE_MISS;
+    return is_hit ? PC : 0;
 }
 
 
+template <typename ISA>
+bool Fetch<ISA>::is_in_trace( Addr PC)
+{
+    /* instructions of the wrong path are not recorded */
+    const auto* record = instr_trace->peek();
+    return record != nullptr && record->PC == PC;
+}
+
+template <typename ISA>
+std::vector<HotBranches::Branch> Fetch<ISA>::get_hot_branches() const
+{
+    return hot_branches.get_top( config::hot_branches);
+}
+
+template <typename ISA>
+typename Fetch<ISA>::FuncInstr Fetch<ISA>::fetch_instr( const Thread& thread, Addr PC)
+{
+    if ( instr_trace == nullptr)
+    {
+        const auto lock = memory_lock == nullptr ? std::unique_lock<std::mutex>() : std::unique_lock<std::mutex>( *memory_lock);
+        return thread.memory->fetch_instr( PC);
+    }
+
+    const auto instr = instr_trace->peek()->template get_instr<FuncInstr>();
+    instr_trace->next();
+    return instr;
+}
+
 template <typename ISA>
 void Fetch<ISA>::clock( Cycle cycle)
 {
+    SELF_PROFILE( FETCH);
     clock_bp( cycle);
+    complete_fills( cycle);
+    clock_threads( cycle);
 
-    /* getting PC */
-    auto PC = get_cached_PC( cycle);
+    /* getting PC of each thread, the ones which are not fetched keep it */
+    outcome = StageOutcome::BUBBLE;
+    std::array<Addr, MAX_HW_THREADS> PCs = {};
+    for ( size_t i = 0; i < threads.size(); ++i)
+        PCs.at( i) = get_thread_PC( &threads[ i], cycle);
+
+    const auto selected = select_thread( PCs);
+    for ( size_t i = 0; i < threads.size(); ++i)
+        if ( i != selected && PCs.at( i) != 0)
+            threads[ i].wp_hold_pc->write( PCs.at( i), cycle);
 
     /* push bubble */
-    if( PC == 0)
-        return;  
+    if ( selected == NO_THREAD)
+        return;
 
-    /* hold PC for the stall case */
-    wp_hold_pc->write( PC, cycle);
+    auto& thread = threads[ selected];
+    auto PC = get_cached_PC( &thread, PCs.at( selected), cycle);
+    if( PC == 0)
+        return;
 
-    Instr instr( memory->fetch_instr( PC), bp->get_bp_info( PC));
+    /* bundle ends on the first predicted taken jump or on the end of cache line,
+       loop buffer is not split into lines */
+    const Addr line = get_line( PC);
+    const bool is_streamed = source == FetchSource::LOOP_BUFFER;
+    for ( uint32 i = 0; i < width; ++i)
+    {
+        /* the trace continues after flush of the wrong path */
+        if ( instr_trace != nullptr && !is_in_trace( PC))
+        {
+            if ( i == 0)
+                outcome = StageOutcome::FLUSH;
+            break;
+        }
+
+        const auto func_instr = fetch_instr( thread, PC);
+        const auto prediction = is_streamed
+            ? BPInterface( PC, loop_buffer.is_loop_end( PC), loop_buffer.get_next_PC( PC))
+            : predict( PC, Instr::get_branch_type( func_instr));
+
+        Instr instr( func_instr, prediction, func_instr.is_jump() ? save_prediction( prediction, is_streamed) : 0);
+        instr.set_thread( static_cast<uint8>( selected));
+        if ( instr_trace != nullptr)
+            instr.set_replayed();
+        if ( pipeline_trace != nullptr)
+            instr.set_trace_id( pipeline_trace->fetch( PC, cycle));
+
+        /* sending to decode */
+        thread.wp_datapath->write( instr, cycle);
+        ++thread.icount;
+        ++fetched_instrs;
+
+        /* log */
+        TRACE( sout) << "fetch   cycle " << std::dec << cycle << ": 0x"
+             << std::hex << PC << ": 0x" << instr << std::endl;
+
+        const auto next_PC = instr.get_predicted_target();
+        if ( is_streamed)
+            loop_buffer.stream( PC);
+        else
+            loop_buffer.train( PC, func_instr.is_jump(), prediction.is_taken, next_PC);
+        if ( source == FetchSource::UOP_CACHE)
+            ++uop_cache_instrs;
+
+        const bool is_sequential = next_PC == PC + 4 && ( is_streamed || get_line( next_PC) == line);
+        PC = next_PC;
+        if ( !is_sequential)
+            break;
+    }
 
     /* updating PC according to prediction */
-    wp_target->write( instr.get_predicted_target(), cycle);
+    thread.wp_target->write( PC, cycle);
+}
 
-    /* sending to decode */
-    wp_datapath->write( instr, cycle);
+template <typename ISA>
+void Fetch<ISA>::register_stats( StatsRegistry* stats) const
+{
+    stats->add_counter( "fetch.instrs", &fetched_instrs);
+    tags->register_stats( stats, "fetch.icache");
+    stats->add_counter( "fetch.icache.demand_misses", &statistics.demand_misses);
+    stats->add_counter( "fetch.icache.prefetches", &statistics.prefetches);
+    stats->add_counter( "fetch.icache.useful_prefetches", &statistics.useful_prefetches);
+    if ( uop_tags != nullptr)
+    {
+        uop_tags->register_stats( stats, "fetch.uop_cache");
+        stats->add_counter( "fetch.uop_cache.instrs", &uop_cache_instrs);
+    }
+    if ( config::loop_buffer_size != 0)
+    {
+        loop_buffer.register_stats( stats, "fetch.loop_buffer");
+    }
+
+    const std::string bp_prefix = "fetch.bp." + bp_mode;
+    stats->add_counter( bp_prefix + ".jumps", &resolved_jumps);
+    stats->add_counter( bp_prefix + ".mispredictions", &mispredictions);
+    std::visit( [stats, &bp_prefix]( const auto& predictor) { predictor.register_stats( stats, bp_prefix); }, bp);
+}
 
-    /* log */
-    sout << "fetch   cycle " << std::dec << cycle << ": 0x"
-         << std::hex << PC << ": 0x" << instr << std::endl;
+template <typename ISA>
+void Fetch<ISA>::warm_up( const FuncInstr& instr)
+{
+    if ( !tags->lookup( instr.get_PC()))
+        tags->write( instr.get_PC());
 
+    const auto prediction = predict( instr.get_PC(), Instr::get_branch_type( instr));
+    if ( instr.is_jump())
+        update_bp( get_bp_update( prediction, Instr( instr, prediction).get_bp_resolution()));
 }
 
 #include <mips/mips.h>
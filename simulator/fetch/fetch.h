@@ -7,9 +7,37 @@
 #define FETCH_H
 
 #include <infra/ports/ports.h>
+#include <core/cpi_stack.h>
 #include <core/perf_instr.h>
+#include <core/pipeline_trace.h>
+#include <core/smt.h>
 #include <bpu/bpu.h>
- 
+#include <bpu/hot_branches.h>
+#include <bpu/target_predictor.h>
+#include <fetch/loop_buffer.h>
+#include <func_sim/instr_trace.h>
+#include <infra/profiler/profiler.h>
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct ICacheStatistics
+{
+    uint64 demand_misses = 0;
+    uint64 prefetches = 0;      // issued prefetches
+    uint64 useful_prefetches = 0; // prefetched lines requested by fetch
+
+    double get_accuracy() const { return prefetches == 0 ? 0. : 1.0 * useful_prefetches / prefetches; }
+    double get_coverage() const
+    {
+        const auto misses = useful_prefetches + demand_misses;
+        return misses == 0 ? 0. : 1.0 * useful_prefetches / misses;
+    }
+};
+
 template <typename ISA>
 class Fetch : public Log
 {
@@ -17,41 +45,167 @@ class Fetch : public Log
     using Instr = PerfInstr<FuncInstr>;
     using Memory = typename ISA::Memory;
 private:
-    Memory* memory = nullptr;
-    std::unique_ptr<BaseBP> bp = nullptr;
+    std::mutex* memory_lock = nullptr; // memory is shared by cores or stages simulated in parallel threads if it is set
+    AnyBP bp; // selected at construction, so predictions are not dispatched virtually
+    std::optional<TargetPredictors> target_predictors = std::nullopt;
     std::unique_ptr<CacheTagArray> tags = nullptr;
-    
-    /* Input signals */
-    std::unique_ptr<ReadPort<bool>> rp_stall = nullptr;
-    std::unique_ptr<ReadPort<bool>> rp_hit_or_miss = nullptr;
 
     /* Input signals - BP */
-    std::unique_ptr<ReadPort<BPInterface>> rp_bp_update = nullptr;
-    
-    /* Input signals - PC values */
-    std::unique_ptr<ReadPort<Addr>> rp_flush_target = nullptr;
-    std::unique_ptr<ReadPort<Addr>> rp_external_target = nullptr;
-    std::unique_ptr<ReadPort<Addr>> rp_hold_pc = nullptr;
-    std::unique_ptr<ReadPort<Addr>> rp_target = nullptr;
-    std::unique_ptr<ReadPort<Addr>> rp_long_latency_pc_holder = nullptr;
-
-    /* Outputs */
-    std::unique_ptr<WritePort<Instr>> wp_datapath = nullptr;
-    std::unique_ptr<WritePort<Addr>> wp_hold_pc = nullptr;
-    std::unique_ptr<WritePort<Addr>> wp_target = nullptr;
-    std::unique_ptr<WritePort<Addr>> wp_long_latency_pc_holder = nullptr;
-    std::unique_ptr<WritePort<bool>> wp_hit_or_miss = nullptr;
-
-    Addr get_PC( Cycle cycle);
-    Addr get_cached_PC( Cycle cycle);
+    std::unique_ptr<ReadPort<BPResolution>> rp_bp_update = nullptr;
+
+    /* Hardware threads, each one has its own program, PC and instruction cache miss */
+    struct Thread
+    {
+        Memory* memory = nullptr;
+
+        /* Input signals */
+        std::unique_ptr<ReadPort<bool>> rp_stall = nullptr;
+
+        /* Input signals - PC values */
+        std::unique_ptr<ReadPort<Addr>> rp_flush_target = nullptr;
+        std::unique_ptr<ReadPort<Addr>> rp_external_target = nullptr;
+        std::unique_ptr<ReadPort<Addr>> rp_hold_pc = nullptr;
+        std::unique_ptr<ReadPort<Addr>> rp_target = nullptr;
+
+        /* Outputs */
+        std::unique_ptr<WritePort<Instr>> wp_datapath = nullptr;
+        std::unique_ptr<WritePort<Addr>> wp_hold_pc = nullptr;
+        std::unique_ptr<WritePort<Addr>> wp_target = nullptr;
+
+        /* Instruction cache miss state, it is kept here instead of ports
+           so nothing is clocked while the miss is served */
+        bool is_miss_pending = false;
+        Addr miss_PC = 0;
+        Cycle miss_ready = 0_Cl;
+        Addr saved_target = 0;
+
+        bool is_halted = false; // the program is over, so nothing is fetched
+        uint64 icount = 0;      // fetched instructions which are not issued yet, they are counted by ICOUNT policy
+    };
+    std::vector<Thread> threads;
+
+    /* Thread selection of SMT, a single thread is fetched in a cycle */
+    enum class FetchPolicy : uint8 { ROUND_ROBIN, ICOUNT, SWITCH_ON_MISS };
+    const FetchPolicy policy;
+    uint32 current_thread = 0; // the last fetched thread
+    std::unique_ptr<ReadPort<ThreadCounts>> rp_decoded = nullptr;
+    std::unique_ptr<ReadPort<uint8>> rp_thread_halt = nullptr;
+
+    /* Maximal number of instructions fetched in a cycle */
+    const uint32 width;
+
+    /* Predictions of jumps in flight, instructions carry only their ids
+       and the speculative state of predictor is taken here on update */
+    struct PredictionRecord
+    {
+        uint32 id = 0;
+        BPInterface prediction = {};
+        bool is_streamed = false; // predicted by loop buffer, so predictor is not updated
+    };
+    std::vector<PredictionRecord> predictions;
+    uint32 next_prediction_id = 0;
+
+    /* Outstanding line fills of instruction cache */
+    struct LineFill
+    {
+        Addr line = 0;
+        Cycle ready = 0_Cl;
+        bool is_prefetch = false;
+    };
+    std::vector<LineFill> fills = {};
+    const Latency miss_latency;
+    const uint32 max_fills;
+
+    /* Prefetcher */
+    enum class Prefetcher : uint8 { NONE, NEXT_LINE, STREAM };
+    const Prefetcher prefetcher;
+    const uint32 prefetch_degree;
+    Addr last_line = NO_VAL32;      // line of the last fetched instruction
+    Addr last_miss_line = NO_VAL32; // line of the last demand miss
+    std::vector<bool> prefetched_ways = {}; // lines not used since prefetch, indexed by set and way of tags
+    ICacheStatistics statistics = {};
+
+    /* Counters of fetched instructions and resolved jumps */
+    const std::string bp_mode;
+    uint64 fetched_instrs = 0;
+    uint64 resolved_jumps = 0;
+    uint64 mispredictions = 0;
+
+    /* Branches of the most mispredictions, tracked if requested */
+    HotBranches hot_branches;
+
+    /* Decoded fetch blocks by their first PC, hits do not access instruction cache */
+    std::unique_ptr<CacheTagArray> uop_tags = nullptr;
+    uint64 uop_cache_instrs = 0;
+
+    /* Small loops streamed without instruction cache and predictor */
+    LoopBuffer loop_buffer;
+
+    /* Source of the bundle fetched in the current cycle */
+    enum class FetchSource : uint8 { ICACHE, UOP_CACHE, LOOP_BUFFER };
+    FetchSource source = FetchSource::ICACHE;
+
+    /* Result of the last clock for CPI stack */
+    StageOutcome outcome = StageOutcome::BUBBLE;
+
+    PipelineTrace* pipeline_trace = nullptr;
+    Profiler* profiler = nullptr;
+
+    /* Replayed instruction trace */
+    InstrTraceReader* instr_trace = nullptr;
+
+    Addr get_line( Addr PC) const { return PC & ~Addr{ tags->line_size - 1}; }
+    size_t get_way_index( Addr addr, CacheTagArray::Way way) const { return size_t{ tags->set( addr)} * tags->ways + way; }
+    auto find_fill( Addr line) { return std::find_if( fills.begin(), fills.end(), [line]( const LineFill& f) { return f.line == line; }); }
+    Cycle allocate_fill( Addr line, Cycle cycle, bool is_prefetch);
+    void complete_fills( Cycle cycle);
+    void prefetch( Addr PC, bool is_miss, bool is_prefetched, Cycle cycle);
+    void prefetch_line( Addr line, Cycle cycle);
+
+    static FetchPolicy get_policy( const std::string& name);
+    static Prefetcher get_prefetcher( const std::string& name);
+    void clock_threads( Cycle cycle);
+    uint32 select_thread( const std::array<Addr, MAX_HW_THREADS>& PCs);
+    Addr get_PC( Thread* thread, Cycle cycle);
+    Addr get_thread_PC( Thread* thread, Cycle cycle);
+    Addr get_cached_PC( Thread* thread, Addr PC, Cycle cycle);
     void clock_bp( Cycle cycle);
-    void clock_instr_cache( Cycle cycle);
-    void save_flush( Cycle cycle);
-    void ignore( Cycle cycle);
+    BPInterface predict( Addr PC, BranchType type);
+    void update_bp( const BPInterface& bp_upd);
+    uint32 save_prediction( const BPInterface& prediction, bool is_streamed = false);
+    const PredictionRecord& get_prediction( uint32 id) const;
+    static BPInterface get_bp_update( BPInterface prediction, const BPResolution& resolution);
+    static void save_flush( Thread* thread, Cycle cycle);
+    static void ignore( Thread* thread, Cycle cycle);
+    bool is_in_trace( Addr PC);
+    FuncInstr fetch_instr( const Thread& thread, Addr PC);
 public:
-    explicit Fetch( bool log);
+    // hardware threads share the unit, caches and predictor
+    Fetch( bool log, uint32 width, uint32 threads = 1);
     void clock( Cycle cycle);
-    void set_memory( Memory* mem) { memory = mem; }
+    void set_memory( Memory* mem, uint32 thread = 0) { threads.at( thread).memory = mem; }
+    void set_memory_lock( std::mutex* value) { memory_lock = value; }
+    void set_pipeline_trace( PipelineTrace* value) { pipeline_trace = value; }
+    void set_profiler( Profiler* value) { profiler = value; }
+    void set_instr_trace( InstrTraceReader* value) { instr_trace = value; }
+
+    // true if the unit does nothing but waits for instruction cache
+    bool is_waiting_for_miss() const;
+    Cycle get_miss_ready_cycle() const;
+
+    const ICacheStatistics& get_icache_statistics() const { return statistics; }
+    // branches of the most mispredictions, empty unless they are requested
+    std::vector<HotBranches::Branch> get_hot_branches() const;
+    uint64 get_mispredictions() const { return mispredictions; }
+    const std::string& get_bp_mode() const { return bp_mode; }
+    StageOutcome get_outcome() const { return outcome; }
+    bool has_prefetcher() const { return prefetcher != Prefetcher::NONE; }
+
+    // counters of predictor are named by its mode, e.g. "fetch.bp.gshare.mispredictions"
+    void register_stats( StatsRegistry* stats) const;
+
+    // trains predictor and instruction cache with functionally executed instruction
+    void warm_up( const FuncInstr& instr);
 };
 
 #endif
@@ -0,0 +1,105 @@
+/*
+ * loop_buffer.h - detector of small loops streamed by fetch
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef LOOP_BUFFER_H
+#define LOOP_BUFFER_H
+
+#include <infra/stats/stats.h>
+#include <infra/types.h>
+
+/* Loop is a predicted taken backward jump whose body up to the jump has
+ * no other jumps and fits into the buffer. The loop is captured after two
+ * sequential iterations, then fetch streams its body from the buffer
+ * without instruction cache and predictor, predicting the jump taken.
+ * Streaming stops when fetch is redirected, e.g. by misprediction of the loop exit.
+ */
+class LoopBuffer
+{
+public:
+    // zero size disables the buffer
+    explicit LoopBuffer( uint32 size) : size( size) { }
+
+    // instruction fetched by instruction cache is observed for loop detection
+    void train( Addr PC, bool is_jump, bool is_taken, Addr next_PC)
+    {
+        if ( size == 0)
+            return;
+
+        // redirected fetch starts a new body
+        if ( PC != expected_PC)
+        {
+            body_start = PC;
+            candidate = NO_VAL32;
+        }
+        expected_PC = next_PC;
+
+        if ( !is_jump)
+            return;
+
+        const bool is_loop = is_taken && next_PC <= PC && ( PC - next_PC) / 4 < size;
+        if ( is_loop && candidate == PC && body_start == next_PC)
+        {
+            start = next_PC;
+            end = PC;
+            is_active = true;
+            ++loops;
+        }
+
+        candidate = is_loop ? PC : NO_VAL32;
+        body_start = is_taken ? next_PC : NO_VAL32;
+    }
+
+    // true if the instruction at PC is the next one of the captured loop
+    bool is_streamed( Addr PC)
+    {
+        if ( is_active && PC != expected_PC)
+            stop();
+        return is_active;
+    }
+
+    // the end of captured loop is predicted taken
+    bool is_loop_end( Addr PC) const { return PC == end; }
+    Addr get_next_PC( Addr PC) const { return PC == end ? start : PC + 4; }
+
+    void stream( Addr PC)
+    {
+        expected_PC = get_next_PC( PC);
+        ++streamed_instrs;
+    }
+
+    uint64 get_loops() const { return loops; }
+    uint64 get_streamed_instrs() const { return streamed_instrs; }
+
+    void register_stats( StatsRegistry* stats, const std::string& prefix) const
+    {
+        stats->add_counter( prefix + ".loops", &loops);
+        stats->add_counter( prefix + ".instrs", &streamed_instrs);
+    }
+
+private:
+    void stop()
+    {
+        is_active = false;
+        body_start = NO_VAL32;
+        candidate = NO_VAL32;
+    }
+
+    const uint32 size;
+
+    /* detection */
+    Addr expected_PC = NO_VAL32; // PC of sequential fetch
+    Addr body_start = NO_VAL32;  // target of the last taken jump if no jumps are fetched after it
+    Addr candidate = NO_VAL32;   // loop jump seen in the previous iteration
+
+    /* captured loop */
+    bool is_active = false;
+    Addr start = NO_VAL32;
+    Addr end = NO_VAL32;
+
+    uint64 loops = 0;
+    uint64 streamed_instrs = 0;
+};
+
+#endif // LOOP_BUFFER_H
@@ -0,0 +1,93 @@
+/*
+ * checkpoint.h - binary checkpoint of architectural state of simulator
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <infra/types.h>
+
+// Checkpoint file consists of a header with PC, values of registers
+// and memory pages written after ELF loading, which are aligned to the page size.
+// Memory image comes from the ELF file, so it must be the same on restore.
+namespace checkpoint {
+
+static constexpr const char MAGIC[8] = { 'M', 'I', 'P', 'T', 'C', 'K', 'P', 'T'};
+static constexpr const uint32 VERSION = 1;
+
+struct Header
+{
+    char magic[8] = {};
+    uint32 version = VERSION;
+    uint32 rf_size = 0;
+    uint32 register_size = 0;
+    uint32 reserved = 0;
+    uint64 PC = NO_VAL64;
+};
+
+template<typename RF, typename Memory>
+void save( std::ostream& out, Addr PC, const RF& rf, const Memory& memory)
+{
+    Header header;
+    std::memcpy( header.magic, MAGIC, sizeof( MAGIC));
+    header.rf_size = RF::get_size();
+    header.register_size = RF::get_register_size();
+    header.PC = PC;
+    out.write( reinterpret_cast<const char*>( &header), sizeof( header));
+
+    rf.save( out);
+    memory.save_pages( out);
+}
+
+template<typename RF, typename Memory>
+void save( const std::string& filename, Addr PC, const RF& rf, const Memory& memory)
+{
+    std::ofstream out( filename, std::ios::binary);
+    if ( !out)
+    {
+        std::cerr << "ERROR. Could not create checkpoint " << filename << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    save( out, PC, rf, memory);
+}
+
+// returns PC of the checkpoint, file name is used only for diagnostics
+template<typename RF, typename Memory>
+Addr load( std::istream& in, RF* rf, Memory* memory, const std::string& filename)
+{
+    Header header;
+    in.read( reinterpret_cast<char*>( &header), sizeof( header));
+    if ( !in || std::memcmp( header.magic, MAGIC, sizeof( MAGIC)) != 0 || header.version != VERSION)
+    {
+        std::cerr << "ERROR. " << filename << " is not a valid checkpoint" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    if ( header.rf_size != RF::get_size() || header.register_size != RF::get_register_size())
+    {
+        std::cerr << "ERROR. Checkpoint " << filename << " is saved for other ISA" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    rf->load( in);
+    memory->load_pages( in);
+    return header.PC;
+}
+
+template<typename RF, typename Memory>
+Addr load( const std::string& filename, RF* rf, Memory* memory)
+{
+    std::ifstream in( filename, std::ios::binary);
+    return load( in, rf, memory, filename);
+}
+
+} // namespace checkpoint
+
+#endif // CHECKPOINT_H
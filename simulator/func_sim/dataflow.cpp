@@ -0,0 +1,177 @@
+/*
+ * dataflow.cpp - dataflow limit of instruction-level parallelism of the functional stream
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "dataflow.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+DataflowAnalyzer::DataflowAnalyzer( const std::vector<uint64>& sizes, uint64 load_latency, uint64 segment_size)
+    : load_latency( load_latency)
+    , segment_size( segment_size)
+    , nodes( segment_size)
+{
+    if ( load_latency == 0 || segment_size == 0)
+    {
+        std::cerr << "ERROR. Load latency and segment of critical path must be positive" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    for ( auto size : sizes)
+        if ( size != 0)
+            windows.push_back( { size, std::vector<uint64>( size, 0)});
+
+    // the critical path is traced by the unlimited window, so it is always analyzed
+    windows.push_back( { 0});
+}
+
+std::vector<uint64> DataflowAnalyzer::parse_windows( const std::string& list)
+{
+    std::vector<uint64> sizes;
+    std::istringstream iss( list);
+    for ( std::string size; std::getline( iss, size, ',');)
+    {
+        if ( size.empty() || size.find_first_not_of( "0123456789") != std::string::npos)
+        {
+            std::cerr << "ERROR. Invalid window size \"" << size << "\" in the list of dataflow windows" << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+        sizes.push_back( std::stoull( size));
+    }
+    return sizes;
+}
+
+DataflowAnalyzer::Value DataflowAnalyzer::get_source( const Window& window, const DataflowInstr& instr)
+{
+    Value source;
+    const auto update = [&source]( const Value& value) {
+        if ( value.ready > source.ready)
+            source = value;
+    };
+
+    for ( size_t i = 0; i < instr.srcs_num; ++i)
+        if ( instr.srcs.at( i) < window.registers.size())
+            update( window.registers[ instr.srcs.at( i)]);
+
+    if ( instr.is_load && instr.mem_size != 0)
+        for ( Addr word = instr.mem_addr / WORD_SIZE; word <= ( instr.mem_addr + instr.mem_size - 1) / WORD_SIZE; ++word)
+        {
+            const auto it = window.words.find( word);
+            if ( it != window.words.end())
+                update( it->second);
+        }
+
+    return source;
+}
+
+DataflowAnalyzer::Value DataflowAnalyzer::execute( Window* window, const DataflowInstr& instr) const
+{
+    auto source = get_source( *window, instr);
+
+    // the instruction enters the window as the one 'size' places before is retired
+    const size_t slot = window->size == 0 ? 0 : instrs % window->size;
+    if ( window->size != 0 && window->retire_cycles[ slot] > source.ready)
+        source = { window->retire_cycles[ slot], NO_PRODUCER};
+
+    const uint64 complete = source.ready + instr.latency;
+    window->last_retire = std::max( window->last_retire, complete);
+    if ( window->size != 0)
+        window->retire_cycles[ slot] = window->last_retire;
+
+    const Value result = { complete, instrs};
+    for ( size_t i = 0; i < instr.dsts_num; ++i)
+    {
+        auto reg = instr.dsts.at( i);
+        if ( reg >= window->registers.size())
+            window->registers.resize( reg + 1);
+        window->registers[ reg] = result;
+    }
+
+    if ( instr.is_store && instr.mem_size != 0)
+        for ( Addr word = instr.mem_addr / WORD_SIZE; word <= ( instr.mem_addr + instr.mem_size - 1) / WORD_SIZE; ++word)
+            window->words[ word] = result;
+
+    return { complete, source.producer};
+}
+
+void DataflowAnalyzer::retire( const DataflowInstr& instr)
+{
+    Value unlimited;
+    for ( auto& window : windows)
+        unlimited = execute( &window, instr);
+
+    nodes[ instrs % segment_size] = { instr.PC, unlimited.producer, unlimited.ready};
+    ++instrs;
+    if ( instrs - segment_start == segment_size)
+        trace_critical_path();
+}
+
+void DataflowAnalyzer::trace_critical_path()
+{
+    const auto get_node = [this]( uint64 instr) -> const Node& { return nodes[ instr % segment_size]; };
+
+    uint64 last = segment_start;
+    for ( uint64 instr = segment_start; instr < instrs; ++instr)
+        if ( get_node( instr).complete > get_node( last).complete)
+            last = instr;
+
+    // producers of the previous segments are overwritten
+    for ( uint64 instr = last; instr != NO_PRODUCER && instr >= segment_start; instr = get_node( instr).producer)
+        ++path_counts[ get_node( instr).PC];
+
+    segment_start = instrs;
+}
+
+void DataflowAnalyzer::finish()
+{
+    if ( instrs != segment_start)
+        trace_critical_path();
+}
+
+const DataflowAnalyzer::Window& DataflowAnalyzer::get_window( uint64 size) const
+{
+    const auto it = std::find_if( windows.begin(), windows.end(), [size]( const Window& window) { return window.size == size; });
+    if ( it == windows.end())
+    {
+        std::cerr << "ERROR. Window of " << size << " instructions is not analyzed" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    return *it;
+}
+
+uint64 DataflowAnalyzer::get_cycles( uint64 window) const
+{
+    return get_window( window).last_retire;
+}
+
+double DataflowAnalyzer::get_ipc( uint64 window) const
+{
+    const auto cycles = get_cycles( window);
+    return cycles == 0 ? 0 : static_cast<double>( instrs) / static_cast<double>( cycles);
+}
+
+std::vector<std::pair<Addr, uint64>> DataflowAnalyzer::get_hot_instrs( size_t number) const
+{
+    std::vector<std::pair<Addr, uint64>> hot( path_counts.begin(), path_counts.end());
+    std::sort( hot.begin(), hot.end(), []( const auto& a, const auto& b) {
+        return a.second > b.second || ( a.second == b.second && a.first < b.first);
+    });
+    hot.resize( std::min( hot.size(), number));
+    return hot;
+}
+
+void DataflowAnalyzer::dump_windows( std::ostream& out) const
+{
+    for ( const auto& window : windows)
+    {
+        if ( window.size == 0)
+            out << "unlimited window: ";
+        else
+            out << "window of " << window.size << ": ";
+        out << window.last_retire << " cycles, IPC " << get_ipc( window.size) << std::endl;
+    }
+}
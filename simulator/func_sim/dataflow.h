@@ -0,0 +1,152 @@
+/*
+ * dataflow.h - dataflow limit of instruction-level parallelism of the functional stream
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <execute/functional_units.h>
+#include <infra/types.h>
+
+#include <array>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Retired instruction as seen by the analyzer: its sources and destinations
+struct DataflowInstr
+{
+    // sources and destinations are up to two registers, or hi and lo pairs
+    static constexpr const size_t MAX_SRCS = 4;
+    static constexpr const size_t MAX_DSTS = 2;
+
+    Addr PC = 0;
+    uint64 latency = 1;
+    std::array<size_t, MAX_SRCS> srcs = {};
+    size_t srcs_num = 0;
+    std::array<size_t, MAX_DSTS> dsts = {};
+    size_t dsts_num = 0;
+    // words of memory read by loads and written by stores
+    bool is_load = false;
+    bool is_store = false;
+    Addr mem_addr = 0;
+    uint32 mem_size = 0;
+};
+
+/*
+ * The ideal machine fetches any number of instructions per cycle, predicts all
+ * the branches and has as many functional units as needed, so an instruction
+ * starts once its register and memory sources are ready. It is limited only by
+ * the window: an instruction enters it when the instruction 'window' places
+ * before is retired, and instructions are retired in program order.
+ * The unlimited window (size 0) gives the dataflow limit, that is
+ * the length of the critical path of the whole stream.
+ *
+ * The critical path is traced back by the producers which were ready last.
+ * Nodes are kept for the latest segment of the stream only, so the path is traced
+ * from the last completed instruction of each segment to its beginning,
+ * and the instructions met are counted.
+ */
+class DataflowAnalyzer
+{
+    public:
+        DataflowAnalyzer( const std::vector<uint64>& windows, uint64 load_latency, uint64 segment_size);
+
+        // comma-separated list of window sizes, 0 is the unlimited window
+        static std::vector<uint64> parse_windows( const std::string& list);
+
+        void retire( const DataflowInstr& instr);
+
+        template <typename Instr>
+        void retire( const Instr& instr)
+        {
+            DataflowInstr record;
+            record.PC = instr.get_PC();
+            record.is_load = instr.is_load();
+            record.is_store = instr.is_store();
+            record.latency = record.is_load ? load_latency : units.get_latency( FunctionalUnits::get_unit_class( instr)).to_size_t();
+            if ( record.is_load || record.is_store) {
+                record.mem_addr = instr.get_mem_addr();
+                record.mem_size = instr.get_mem_size();
+            }
+
+            add_register( instr.get_src_num( 0), &record.srcs, &record.srcs_num);
+            add_register( instr.get_src_num( 1), &record.srcs, &record.srcs_num);
+            add_register( instr.get_dst_num(), &record.dsts, &record.dsts_num);
+            retire( record);
+        }
+
+        // traces the path of the last segment, it is called at the end of the stream
+        void finish();
+
+        uint64 get_instrs() const { return instrs; }
+        uint64 get_cycles( uint64 window) const;
+        double get_ipc( uint64 window) const;
+        uint64 get_critical_path_length() const { return get_cycles( 0); }
+
+        // PCs which are met most often on the critical path, with the numbers of the meetings
+        std::vector<std::pair<Addr, uint64>> get_hot_instrs( size_t number) const;
+
+        void dump_windows( std::ostream& out) const;
+
+    private:
+        static constexpr const uint64 NO_PRODUCER = MAX_VAL64;
+
+        template <typename Register, size_t N>
+        static void add_register( const Register& reg, std::array<size_t, N>* regs, size_t* num)
+        {
+            if ( reg.is_zero())
+                return;
+            if ( reg.is_mips_hi_lo()) {
+                regs->at( ( *num)++) = Register::mips_hi.to_size_t();
+                regs->at( ( *num)++) = Register::mips_lo.to_size_t();
+                return;
+            }
+            regs->at( ( *num)++) = reg.to_size_t();
+        }
+
+        struct Value
+        {
+            uint64 ready = 0;
+            uint64 producer = NO_PRODUCER;
+        };
+
+        struct Window
+        {
+            uint64 size = 0;
+            std::vector<uint64> retire_cycles = {}; // the last 'size' instructions
+            std::vector<Value> registers = {};
+            std::unordered_map<Addr, Value> words = {};
+            uint64 last_retire = 0;
+        };
+
+        struct Node
+        {
+            Addr PC = 0;
+            uint64 producer = NO_PRODUCER;
+            uint64 complete = 0;
+        };
+
+        static constexpr const Addr WORD_SIZE = 4;
+
+        static Value get_source( const Window& window, const DataflowInstr& instr);
+        // returns the completion cycle of the instruction and its critical producer
+        Value execute( Window* window, const DataflowInstr& instr) const;
+        const Window& get_window( uint64 size) const;
+        void trace_critical_path();
+
+        const FunctionalUnits units{ 1};
+        const uint64 load_latency;
+        const uint64 segment_size;
+        std::vector<Window> windows; // the unlimited window is the last one
+
+        uint64 instrs = 0;
+        std::vector<Node> nodes; // ring of the latest segment of the unlimited window
+        uint64 segment_start = 0;
+        std::unordered_map<Addr, uint64> path_counts;
+};
+
+#endif // DATAFLOW_H
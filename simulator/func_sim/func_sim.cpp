@@ -3,9 +3,23 @@
  * Copyright 2018 MIPT-MIPS
  */
 #include <cassert>
+#include <iomanip>
 #include <iostream>
 
+#include <infra/config/config.h>
+#include <infra/profiler/profiler.h>
+
+#include "checkpoint.h"
+#include "dataflow.h"
 #include "func_sim.h"
+#include "translator.h"
+
+namespace config {
+    static Value<bool> translate = { "translate", false, "translate hot basic blocks of MIPS code in functional simulation"};
+    static Value<std::string> dataflow_windows = { "dataflow-windows", "", "comma-separated window sizes of dataflow limit analysis in functional simulation, 0 is the unlimited window"};
+    static Value<uint64> dataflow_load_latency = { "dataflow-load-latency", 2, "latency of loads in dataflow limit analysis (in cycles)"};
+    static Value<uint64> dataflow_segment = { "dataflow-segment", 65536, "number of instructions per segment of the traced critical path"};
+} // namespace config
 
 template <typename ISA>
 FuncSim<ISA>::FuncSim( bool log) : Simulator( log), rf( new RF<ISA>) { }
@@ -30,31 +44,37 @@ void FuncSim<ISA>::update_nop_counter( const typename FuncSim<ISA>::FuncInstr& i
 }
 
 template <typename ISA>
-typename FuncSim<ISA>::FuncInstr FuncSim<ISA>::step()
+void FuncSim<ISA>::execute_instr( FuncInstr* instr)
 {
-    // fetch instruction
-    FuncInstr instr = mem->fetch_instr( PC);
-
     // read sources
-    rf->read_sources( &instr);
+    rf->read_sources( instr);
 
     // execute
-    instr.execute();
+    instr->execute_dispatched();
 
     // load/store
-    mem->load_store( &instr);
+    mem->load_store( instr);
 
     // writeback
-    rf->write_dst( instr);
+    rf->write_dst( *instr);
 
     // trap check
-    instr.check_trap();
+    instr->check_trap();
 
     // PC update
-    PC = instr.get_new_PC();
+    PC = instr->get_new_PC();
 
     // Check whether we execute nops
-    update_nop_counter( instr);
+    update_nop_counter( *instr);
+}
+
+template <typename ISA>
+typename FuncSim<ISA>::FuncInstr FuncSim<ISA>::step()
+{
+    // fetch instruction
+    FuncInstr instr = mem->fetch_instr( PC);
+
+    execute_instr( &instr);
 
     // dump
     return instr;
@@ -67,20 +87,121 @@ void FuncSim<ISA>::init( const std::string& tr)
     mem = new Memory( tr);
     PC = mem->startPC();
     nops_in_a_row = 0;
+
+    if ( !checkpoint_to_load.empty())
+        load_checkpoint( checkpoint_to_load);
+}
+
+template <typename ISA>
+void FuncSim<ISA>::save_checkpoint( const std::string& filename) const
+{
+    checkpoint::save( filename, PC, *rf, *mem);
+}
+
+template <typename ISA>
+void FuncSim<ISA>::load_checkpoint( const std::string& filename)
+{
+    PC = checkpoint::load( filename, rf.get(), mem);
+}
+
+template <typename ISA>
+void FuncSim<ISA>::save_checkpoint( std::ostream& out) const
+{
+    checkpoint::save( out, PC, *rf, *mem);
+}
+
+template <typename ISA>
+void FuncSim<ISA>::load_checkpoint( std::istream& in)
+{
+    PC = checkpoint::load( in, rf.get(), mem, "state");
 }
 
 template <typename ISA>
 void FuncSim<ISA>::run( const std::string& tr, uint64 instrs_to_run)
 {
     init( tr);
-    for ( uint32 i = 0; i < instrs_to_run; ++i) {
-        const auto& instr = step();
-        sout << instr << std::endl;
-        if ( instr.is_halt())
-            break;
+    if ( !instr_trace_to_save.empty())
+        instr_trace = std::make_unique<InstrTraceWriter>( instr_trace_to_save);
+    if ( !profile_to_save.empty())
+        profiler = std::make_unique<Profiler>( tr, profile_period);
+    const std::string& dataflow_windows = config::dataflow_windows;
+    if ( !dataflow_windows.empty())
+        dataflow = std::make_unique<DataflowAnalyzer>( DataflowAnalyzer::parse_windows( dataflow_windows),
+                                                       config::dataflow_load_latency, config::dataflow_segment);
+
+    execute_instrs( instrs_to_run);
+    instr_trace = nullptr;
+    if ( profiler != nullptr)
+        profiler->save( profile_to_save);
+    profiler = nullptr;
+    if ( dataflow != nullptr)
+        dump_dataflow( std::cout);
+    dataflow = nullptr;
+
+    if ( !checkpoint_to_save.empty())
+        save_checkpoint( checkpoint_to_save);
+}
+
+template <typename ISA>
+void FuncSim<ISA>::execute_instrs( uint64 instrs_to_run)
+{
+    halted = false;
+    // translated code is neither traced nor profiled, so traces and profiles are produced by the interpreter
+    if ( config::translate && translator == nullptr && instr_trace == nullptr && profiler == nullptr && dataflow == nullptr && !sout.is_enabled())
+        translator = Translator<ISA>::create( rf.get(), mem);
+
+    executed_instrs = 0;
+    translated_instrs = 0;
+    while ( executed_instrs < instrs_to_run) {
+        // the interpreter executes blocks which are not translated
+        if ( translator != nullptr) {
+            const auto translated = translator->run( &PC, instrs_to_run - executed_instrs, &nops_in_a_row, &halted);
+            executed_instrs += translated;
+            translated_instrs += translated;
+            if ( halted || executed_instrs == instrs_to_run)
+                return;
+        }
+
+        // execute the whole basic block without fetching instructions one by one
+        const auto& block = mem->fetch_block( PC);
+        const auto generation = mem->get_block_generation();
+        for ( size_t i = 0; i < block.size() && executed_instrs < instrs_to_run; ++i) {
+            FuncInstr instr = block[i];
+            execute_instr( &instr);
+            ++executed_instrs;
+            if ( instr_trace != nullptr)
+                instr_trace->write_instr( instr);
+            if ( profiler != nullptr)
+                profiler->retire( instr);
+            if ( dataflow != nullptr)
+                dataflow->retire( instr);
+
+            TRACE( sout) << instr << std::endl;
+            halted = instr.is_halt();
+            if ( halted)
+                return;
+
+            // the block was overwritten by a store, so it must be decoded again
+            if ( mem->get_block_generation() != generation)
+                break;
+        }
     }
 }
 
+template <typename ISA>
+void FuncSim<ISA>::dump_dataflow( std::ostream& out)
+{
+    static const size_t hot_instrs_num = 10;
+
+    dataflow->finish();
+    const auto length = dataflow->get_critical_path_length();
+    out << std::endl << "dataflow limit of " << dataflow->get_instrs() << " instructions:" << std::endl;
+    dataflow->dump_windows( out);
+    out << "critical path: " << length << " cycles, the most frequent instructions on it:" << std::endl;
+    for ( const auto& [PC, count] : dataflow->get_hot_instrs( hot_instrs_num))
+        out << std::setw( 12) << count << ' ' << FuncInstr( mem->fetch( PC), PC) << std::endl;
+}
+
 #include <mips/mips.h>
 #include <risc_v/risc_v.h>
 
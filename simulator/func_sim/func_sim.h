@@ -12,8 +12,15 @@
 
 #include <simulator.h>
 
+#include "instr_trace.h"
 #include "rf/rf.h"
 
+class DataflowAnalyzer;
+class Profiler;
+
+template <typename ISA>
+class Translator;
+
 template <typename ISA>
 class FuncSim : public Simulator
 {
@@ -24,9 +31,19 @@ class FuncSim : public Simulator
         std::unique_ptr<RF<ISA>> rf;
         Addr PC = NO_VAL32;
         Memory* mem = nullptr;
+        std::unique_ptr<InstrTraceWriter> instr_trace = nullptr;
+        std::unique_ptr<Translator<ISA>> translator = nullptr;
+        std::unique_ptr<Profiler> profiler = nullptr;
+        std::unique_ptr<DataflowAnalyzer> dataflow = nullptr;
 
         uint64 nops_in_a_row = 0;
+        uint64 executed_instrs = 0;
+        uint64 translated_instrs = 0;
+        bool halted = false;
         void update_nop_counter( const FuncInstr& instr);
+        void execute_instr( FuncInstr* instr);
+        void execute_instrs( uint64 instrs_to_run);
+        void dump_dataflow( std::ostream& out);
 
     public:
         explicit FuncSim( bool log = false);
@@ -42,6 +59,23 @@ class FuncSim : public Simulator
         FuncInstr step();
         void run(const std::string& tr, uint64 instrs_to_run) final;
         void set_PC(Addr value) final { PC = value; }
+
+        void save_checkpoint( const std::string& filename) const;
+        void load_checkpoint( const std::string& filename);
+        void save_checkpoint( std::ostream& out) const;
+        void load_checkpoint( std::istream& in);
+
+        // true if the last run was stopped by a halting instruction
+        bool is_halted() const { return halted; }
+        uint64 get_executed_instrs() const { return executed_instrs; }
+        // instructions of the last run executed by translated code, not by the interpreter
+        uint64 get_translated_instrs() const { return translated_instrs; }
+
+        const RF<ISA>& get_rf() const { return *rf; }
+        const Memory& get_memory() const { return *mem; }
+
+        // the simulator decodes instructions to the cache of the other memory of the same program
+        void share_instr_cache( const Memory& memory) { mem->share_instr_cache( memory); }
 };
 
 #endif
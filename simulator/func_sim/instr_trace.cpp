@@ -0,0 +1,162 @@
+/*
+ * instr_trace.cpp - compact binary trace of functionally executed instructions
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "instr_trace.h"
+
+#include <infra/varint.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+const char InstrTraceCodec::MAGIC[8] = { 'M', 'I', 'P', 'T', 'I', 'T', '0', '1'};
+
+static const size_t COUNTER_SIZE = sizeof( uint64);
+
+static void report_corrupted_trace()
+{
+    std::cerr << "ERROR. Instruction trace is corrupted" << std::endl;
+    std::exit( EXIT_FAILURE);
+}
+
+InstrTraceWriter::InstrTraceWriter( const std::string& filename) : writer( filename)
+{
+    writer.write( MAGIC, sizeof( MAGIC));
+}
+
+InstrTraceWriter::~InstrTraceWriter()
+{
+    for ( size_t i = 0; i < COUNTER_SIZE; ++i)
+        writer.put( static_cast<char>( instrs >> ( i * 8)));
+}
+
+void InstrTraceWriter::write( const InstrRecord& record)
+{
+    auto& seen = get_seen_bytes( record.PC);
+    const bool is_new_bytes = seen.first != record.PC || seen.second != record.bytes;
+    const bool is_sequential = record.new_PC == record.PC + 4;
+
+    uint8 flags = 0;
+    flags |= record.is_jump_taken ? JUMP_TAKEN : 0;
+    flags |= is_sequential ? 0 : NOT_SEQUENTIAL;
+    flags |= record.has_mem_addr ? HAS_MEM_ADDR : 0;
+    flags |= is_new_bytes ? NEW_BYTES : 0;
+    writer.put( static_cast<char>( flags));
+
+    put_varint( &writer, zigzag_encode( static_cast<int64>( record.PC - last_new_PC)));
+    if ( is_new_bytes)
+    {
+        put_varint( &writer, record.bytes);
+        seen = { record.PC, record.bytes};
+    }
+
+    if ( !is_sequential)
+        put_varint( &writer, zigzag_encode( static_cast<int64>( record.new_PC - record.PC)));
+
+    if ( record.has_mem_addr)
+    {
+        put_varint( &writer, zigzag_encode( static_cast<int64>( record.mem_addr - last_mem_addr)));
+        last_mem_addr = record.mem_addr;
+    }
+
+    last_new_PC = record.new_PC;
+    ++instrs;
+}
+
+InstrTraceReader::InstrTraceReader( const std::string& filename, size_t history_size)
+    : in( filename, std::ios::binary)
+    , buffer( 1 << 16)
+    , history_size( history_size)
+{
+    if ( !in.is_open())
+    {
+        std::cerr << "ERROR. Could not open instruction trace " << filename << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    in.rdbuf()->pubsetbuf( buffer.data(), static_cast<std::streamsize>( buffer.size()));
+
+    std::array<char, sizeof( MAGIC)> magic = {{}};
+    in.read( magic.data(), magic.size());
+    if ( !in || std::memcmp( magic.data(), MAGIC, magic.size()) != 0)
+    {
+        std::cerr << "ERROR. " << filename << " is not an instruction trace" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    // the number of records is written after all of them
+    std::array<char, COUNTER_SIZE> counter = {{}};
+    in.seekg( -static_cast<std::streamoff>( COUNTER_SIZE), std::ios::end);
+    in.read( counter.data(), counter.size());
+    if ( !in || in.tellg() < static_cast<std::streamoff>( sizeof( MAGIC) + COUNTER_SIZE))
+        report_corrupted_trace();
+
+    for ( size_t i = 0; i < COUNTER_SIZE; ++i)
+        instrs |= uint64{ static_cast<uint8>( counter[ i])} << ( i * 8);
+
+    in.seekg( sizeof( MAGIC));
+}
+
+bool InstrTraceReader::read_record()
+{
+    if ( read_instrs == instrs)
+        return false;
+
+    const auto flags = in.get();
+    uint64 PC_distance = 0;
+    if ( flags == std::char_traits<char>::eof() || !get_varint( in, &PC_distance))
+        report_corrupted_trace();
+
+    InstrRecord record;
+    record.PC = last_new_PC + static_cast<Addr>( zigzag_decode( PC_distance));
+    record.new_PC = record.PC + 4;
+    record.is_jump_taken = ( flags & JUMP_TAKEN) != 0;
+    record.has_mem_addr = ( flags & HAS_MEM_ADDR) != 0;
+
+    uint64 value = 0;
+    auto& seen = get_seen_bytes( record.PC);
+    if ( ( flags & NEW_BYTES) != 0)
+    {
+        if ( !get_varint( in, &value))
+            report_corrupted_trace();
+        seen = { record.PC, static_cast<uint32>( value)};
+    }
+    record.bytes = seen.second;
+
+    if ( ( flags & NOT_SEQUENTIAL) != 0)
+    {
+        if ( !get_varint( in, &value))
+            report_corrupted_trace();
+        record.new_PC = record.PC + static_cast<Addr>( zigzag_decode( value));
+    }
+
+    if ( record.has_mem_addr)
+    {
+        if ( !get_varint( in, &value))
+            report_corrupted_trace();
+        last_mem_addr += static_cast<Addr>( zigzag_decode( value));
+        record.mem_addr = last_mem_addr;
+    }
+
+    last_new_PC = record.new_PC;
+    ++read_instrs;
+
+    window.push_back( record);
+    while ( position > history_size)
+    {
+        window.pop_front();
+        --position;
+    }
+    return true;
+}
+
+void InstrTraceReader::rewind( size_t count)
+{
+    if ( count > position)
+    {
+        std::cerr << "ERROR. Instruction trace is rewound beyond the kept records" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    position -= count;
+}
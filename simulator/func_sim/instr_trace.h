@@ -0,0 +1,140 @@
+/*
+ * instr_trace.h - compact binary trace of functionally executed instructions
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef INSTR_TRACE_H
+#define INSTR_TRACE_H
+
+#include <infra/async_writer/async_writer.h>
+#include <infra/types.h>
+
+#include <array>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct InstrRecord
+{
+    Addr PC = 0;
+    uint32 bytes = 0;
+    Addr new_PC = 0;
+    Addr mem_addr = 0;
+    bool is_jump_taken = false;
+    bool has_mem_addr = false;
+
+    // creates the instruction with results of its execution, they are not computed again
+    template <typename FuncInstr>
+    FuncInstr get_instr() const
+    {
+        FuncInstr instr( bytes, PC);
+        instr.set_recorded_result( is_jump_taken, new_PC, mem_addr);
+        return instr;
+    }
+};
+
+/*
+ * Each record starts with a byte of flags. It is followed by the distance
+ * from the next PC of the previous instruction, which is zero unless an
+ * exception or a checkpoint changes the flow, by the instruction word if it
+ * differs from the one seen at the same PC last time, by the distance from PC
+ * to the next PC if it is not sequential, and by the distance from the previous
+ * memory address for loads and stores. Numbers are variable-length, so a record
+ * usually takes two or three bytes. The number of records is kept at the end.
+ */
+class InstrTraceCodec
+{
+    protected:
+        enum Flags : uint8
+        {
+            JUMP_TAKEN = 1,
+            NOT_SEQUENTIAL = 2,
+            HAS_MEM_ADDR = 4,
+            NEW_BYTES = 8
+        };
+
+        static const char MAGIC[8];
+
+        Addr last_new_PC = 0;
+        Addr last_mem_addr = 0;
+
+        // instruction words seen last time at PCs with the same hash
+        std::array<std::pair<Addr, uint32>, 4096> seen_bytes = {};
+        auto& get_seen_bytes( Addr PC) { return seen_bytes[ ( PC >> 2) % seen_bytes.size()]; }
+};
+
+class InstrTraceWriter : private InstrTraceCodec
+{
+    public:
+        explicit InstrTraceWriter( const std::string& filename);
+        ~InstrTraceWriter();
+
+        InstrTraceWriter( const InstrTraceWriter&) = delete;
+        InstrTraceWriter( InstrTraceWriter&&) = delete;
+        InstrTraceWriter& operator=( const InstrTraceWriter&) = delete;
+        InstrTraceWriter& operator=( InstrTraceWriter&&) = delete;
+
+        void write( const InstrRecord& record);
+
+        template <typename FuncInstr>
+        void write_instr( const FuncInstr& instr)
+        {
+            InstrRecord record;
+            record.PC = instr.get_PC();
+            record.bytes = instr.get_bytes();
+            record.new_PC = instr.get_new_PC();
+            record.is_jump_taken = instr.is_jump_taken();
+            record.has_mem_addr = instr.is_load() || instr.is_store();
+            record.mem_addr = record.has_mem_addr ? instr.get_mem_addr() : 0;
+            write( record);
+        }
+
+    private:
+        AsyncWriter writer;
+        uint64 instrs = 0;
+};
+
+/*
+ * The trace is read by parts, so memory does not depend on its size.
+ * The latest records are kept to be read again after rewind.
+ */
+class InstrTraceReader : private InstrTraceCodec
+{
+    public:
+        explicit InstrTraceReader( const std::string& filename, size_t history_size = 256);
+
+        uint64 get_instrs() const { return instrs; }
+        uint64 get_remaining_instrs() const { return instrs - read_instrs + ( window.size() - position); }
+
+        // returns the next record, nullptr at the end of the trace
+        const InstrRecord* peek()
+        {
+            if ( position == window.size() && !read_record())
+                return nullptr;
+            return &window[ position];
+        }
+
+        void next()
+        {
+            if ( peek() != nullptr)
+                ++position;
+        }
+
+        // returns the last records to be read again
+        void rewind( size_t count);
+
+    private:
+        std::ifstream in;
+        std::vector<char> buffer;
+        uint64 instrs = 0;
+        uint64 read_instrs = 0;
+
+        std::deque<InstrRecord> window = {};
+        size_t position = 0; // index of the next record in the window
+        const size_t history_size;
+
+        bool read_record();
+};
+
+#endif // INSTR_TRACE_H
@@ -8,6 +8,10 @@
 #define RF_H
 
 #include <array>
+#include <istream>
+#include <ostream>
+
+#include <infra/macro.h>
 #include <infra/types.h>
 #include <infra/wide_types.h>
 
@@ -23,35 +27,56 @@ class RF
     struct Reg {
         RegisterUInt value = 0u;
     };
-    std::array<Reg, Register::MAX_REG> array = {};
 
-    Reg& get_entry( Register num) { return array.at( num.to_size_t()); }
-    const Reg& get_entry( Register num) const { return array.at( num.to_size_t()); }
+    // Registers are valid by construction, so they are not checked on the hot path.
+    // Writes to $zero go to the sink slot after the registers, so $zero is never changed.
+    static const size_t SINK = Register::MAX_REG;
+    std::array<Reg, Register::MAX_REG + 1> array = {};
+
+    Reg& get_entry( size_t index)
+    {
+        assert( index < array.size());
+        return array[ index];
+    }
+
+    const Reg& get_entry( size_t index) const
+    {
+        assert( index < array.size());
+        return array[ index];
+    }
+
+    static size_t get_write_index( Register num) { return num.is_zero() ? SINK : num.to_size_t(); }
+
+    // HI and LO are written together by multiplication and division
+    void write_hi_lo( uint64 value)
+    {
+        get_entry( Register::mips_hi.to_size_t()).value = static_cast<RegisterUInt>( value >> 32);
+        get_entry( Register::mips_lo.to_size_t()).value = static_cast<RegisterUInt>( value);
+    }
 
 protected:
     RegisterUInt read( Register num) const
     {
         assert( !num.is_mips_hi_lo());
-        return static_cast<RegisterUInt>(get_entry( num).value);
+        return get_entry( num.to_size_t()).value;
     }
 
     template <typename T>
     void write( Register num, const T& val)
     {
-        if ( num.is_zero())
-            return;
-        if ( num.is_mips_hi_lo()) {
-            write( Register::mips_hi, static_cast<uint64>(val) >> 32);
-            write( Register::mips_lo, val);
-            return;
-        }
-        auto& entry = get_entry(num);
-        entry.value = val;
+        // the check is a constant for ISAs without HI/LO
+        if ( num.is_mips_hi_lo())
+            write_hi_lo( static_cast<uint64>( val));
+        else
+            get_entry( get_write_index( num)).value = static_cast<RegisterUInt>( val);
     }
 
 public:
     RF() = default;
 
+    // sets the register before the run, e.g. an argument of the program
+    void set_initial_value( Register num, RegisterUInt value) { write( num, value); }
+
     inline void read_source( FuncInstr* instr, uint8 index) const
     {
         instr->set_v_src( read( instr->get_src_num( index)), index);
@@ -63,14 +88,62 @@ public:
         read_source( instr, 1);
     }
 
+    // old value of a destination which may be kept by conditional moves
+    inline RegisterUInt read_dst( const FuncInstr& instr) const
+    {
+        return read( instr.get_dst_num());
+    }
+
     inline void write_dst( const FuncInstr& instr)
     {
-        Register reg_num  = instr.get_dst_num();
-        bool writes_dst = instr.get_writes_dst();
-        if ( !reg_num.is_zero() && writes_dst)
-            write( reg_num, instr.get_v_dst());
-        else
-            write( reg_num, read(reg_num));
+        // conditional moves which do not write keep the old value
+        if ( instr.get_writes_dst())
+            write( instr.get_dst_num(), instr.get_v_dst());
+    }
+
+    // translated code keeps pointers to values of registers,
+    // so its operations do not look for the registers
+    const RegisterUInt* get_read_ptr( Register num) const
+    {
+        assert( !num.is_mips_hi_lo());
+        return &get_entry( num.to_size_t()).value;
+    }
+
+    RegisterUInt* get_write_ptr( Register num)
+    {
+        assert( !num.is_mips_hi_lo());
+        return &get_entry( get_write_index( num)).value;
+    }
+
+    static constexpr size_t get_size() { return Register::MAX_REG; }
+    static constexpr size_t get_register_size() { return bitwidth<RegisterUInt> / 8; }
+
+    // Values of registers for checkpoints, byte by byte in little-endian order
+    void save( std::ostream& out) const
+    {
+        for ( size_t index = 0; index < get_size(); ++index)
+            for ( size_t i = 0; i < get_register_size(); ++i)
+                out.put( static_cast<char>( static_cast<uint8>( array[ index].value >> ( 8 * i))));
+    }
+
+    void load( std::istream& in)
+    {
+        for ( size_t index = 0; index < get_size(); ++index)
+        {
+            auto& entry = array[ index];
+            entry.value = 0u;
+            for ( size_t i = 0; i < get_register_size(); ++i)
+                entry.value |= static_cast<RegisterUInt>( static_cast<uint8>( in.get())) << ( 8 * i);
+        }
+    }
+
+    // FNV-1a hash of register values to compare final states of simulators
+    uint64 hash() const
+    {
+        uint64 result = 0xcbf29ce484222325ull;
+        for ( size_t index = 0; index < get_size(); ++index)
+            result = ( result ^ static_cast<uint64>( array[ index].value)) * 0x100000001b3ull;
+        return result;
     }
 };
 
@@ -51,6 +51,39 @@ TEST( RF, read_write_rf)
     ASSERT_EQ( rf->read( MIPSRegister::mips_lo), 0u);
 }
 
+TEST( RF, hash_rf)
+{
+    auto rf = std::make_unique<TestRF>();
+    auto other_rf = std::make_unique<TestRF>();
+    ASSERT_EQ( rf->hash(), other_rf->hash());
+
+    rf->write( MIPSRegister(5), 1);
+    ASSERT_NE( rf->hash(), other_rf->hash());
+
+    other_rf->write( MIPSRegister(5), 1);
+    ASSERT_EQ( rf->hash(), other_rf->hash());
+
+    // Writes to zero register are dropped
+    rf->write( MIPSRegister::zero, 1);
+    ASSERT_EQ( rf->hash(), other_rf->hash());
+}
+
+TEST( RF, write_dst_not_taken_conditional_move)
+{
+    auto rf = std::make_unique<TestRF>();
+    rf->write( MIPSRegister(17), 5);
+    rf->write( MIPSRegister(25), 1);
+
+    // "movz $s1, $t1, $t9" does not write as $t9 is not zero
+    MIPSInstr instr( 0x0139880a);
+    rf->read_sources( &instr);
+    instr.execute();
+    ASSERT_FALSE( instr.get_writes_dst());
+
+    rf->write_dst( instr);
+    ASSERT_EQ( rf->read( MIPSRegister(17)), 5u);
+}
+
 TEST( RF, read_sources_write_dst_rf)
 {
     auto rf = std::make_unique<TestRF>();
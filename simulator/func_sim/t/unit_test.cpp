@@ -6,11 +6,18 @@
 #include <gtest/gtest.h>
 
 // Module
+#include <infra/config/config.h>
 #include <mips/mips.h>
+#include "../dataflow.h"
 #include "../func_sim.h"
+#include "../instr_trace.h"
+
+#include <fstream>
+#include <map>
 
 static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
 static const std::string smc_code = TEST_PATH "/smc.out";
+static const std::string smc_loop = TEST_PATH "/smc_loop.out";
 
 #define GTEST_ASSERT_NO_DEATH(statement) \
     ASSERT_EXIT({{ statement } ::exit(EXIT_SUCCESS); }, ::testing::ExitedWithCode(0), "")
@@ -48,6 +55,227 @@ TEST( Func_Sim, Run_SMC_trace)
                  ::testing::ExitedWithCode( EXIT_FAILURE), "Bearings lost:.*");
 }
 
+TEST( Func_Sim, Restore_From_Checkpoint)
+{
+    FuncSim<MIPS> full;
+    full.run_no_limit( valid_elf_file);
+
+    FuncSim<MIPS> first_part;
+    first_part.set_checkpoints( "", "./func_sim.ckpt");
+    first_part.run( valid_elf_file, 5000);
+    ASSERT_NE( first_part.get_rf().hash(), full.get_rf().hash());
+
+    FuncSim<MIPS> second_part;
+    second_part.set_checkpoints( "./func_sim.ckpt", "");
+    second_part.run_no_limit( valid_elf_file);
+    ASSERT_EQ( second_part.get_rf().hash(), full.get_rf().hash());
+    ASSERT_EQ( second_part.get_memory().hash(), full.get_memory().hash());
+
+    FuncSim<MIPS> wrong;
+    wrong.set_checkpoints( valid_elf_file, "");
+    ASSERT_EXIT( wrong.init( valid_elf_file),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Func_Sim, Record_Instr_Trace)
+{
+    FuncSim<MIPS> recorder;
+    recorder.set_instr_trace( "./func_sim.trace");
+    recorder.run( valid_elf_file, 5000);
+
+    // the trace has the same instructions and results as the simulation
+    FuncSim<MIPS> mips;
+    mips.init( valid_elf_file);
+    InstrTraceReader trace( "./func_sim.trace");
+    ASSERT_EQ( trace.get_instrs(), 5000u);
+    for ( uint64 i = 0; i < 5000; ++i)
+    {
+        const auto instr = mips.step();
+        const auto* record = trace.peek();
+        ASSERT_NE( record, nullptr);
+        ASSERT_EQ( record->PC, instr.get_PC());
+        ASSERT_EQ( record->bytes, instr.get_bytes());
+        ASSERT_EQ( record->new_PC, instr.get_new_PC());
+        ASSERT_EQ( record->is_jump_taken, instr.is_jump_taken());
+        if ( instr.is_load() || instr.is_store()) {
+            ASSERT_EQ( record->mem_addr, instr.get_mem_addr());
+        }
+
+        const auto replayed = record->get_instr<MIPSInstr>();
+        ASSERT_TRUE( replayed.is_same( instr));
+        ASSERT_EQ( replayed.get_new_PC(), instr.get_new_PC());
+        trace.next();
+    }
+    ASSERT_EQ( trace.peek(), nullptr);
+
+    // records are compact
+    std::ifstream file( "./func_sim.trace", std::ios::binary | std::ios::ate);
+    ASSERT_LT( file.tellg(), 5000 * 4);
+}
+
+TEST( Func_Sim, Rewind_Instr_Trace)
+{
+    FuncSim<MIPS> recorder;
+    recorder.set_instr_trace( "./func_sim.trace");
+    recorder.run( valid_elf_file, 100);
+
+    InstrTraceReader trace( "./func_sim.trace", 4);
+    ASSERT_EQ( trace.get_remaining_instrs(), 100u);
+    const auto first = *trace.peek();
+    for ( int i = 0; i < 3; ++i)
+        trace.next();
+    ASSERT_EQ( trace.get_remaining_instrs(), 97u);
+
+    trace.rewind( 3);
+    ASSERT_EQ( trace.peek()->PC, first.PC);
+    ASSERT_EQ( trace.get_remaining_instrs(), 100u);
+
+    for ( int i = 0; i < 10; ++i)
+        trace.next();
+    ASSERT_EXIT( trace.rewind( 10), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Func_Sim, Wrong_Instr_Trace)
+{
+    ASSERT_EXIT( InstrTraceReader( "./no/such/file.trace"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( InstrTraceReader{ valid_elf_file}, ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+
+    std::ofstream( "./func_sim.trace", std::ios::binary) << "MIPTIT01" << std::string( 8, '\xff');
+    InstrTraceReader trace( "./func_sim.trace");
+    ASSERT_EXIT( trace.peek(), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+// returns the number of instructions executed by translated code
+static uint64 compare_translated( const std::string& binary, uint64 instrs_to_run)
+{
+    FuncSim<MIPS> interpreted;
+    interpreted.run( binary, instrs_to_run);
+    EXPECT_EQ( interpreted.get_translated_instrs(), 0u);
+
+    config::LocalValues translate( std::map<std::string, std::string>{ { "translate", "true"}});
+    FuncSim<MIPS> translated;
+    translated.run( binary, instrs_to_run);
+    EXPECT_EQ( translated.is_halted(), interpreted.is_halted());
+    EXPECT_EQ( translated.get_executed_instrs(), interpreted.get_executed_instrs());
+    EXPECT_EQ( translated.get_rf().hash(), interpreted.get_rf().hash());
+    EXPECT_EQ( translated.get_memory().hash(), interpreted.get_memory().hash());
+    EXPECT_LE( translated.get_translated_instrs(), translated.get_executed_instrs());
+    return translated.get_translated_instrs();
+}
+
+TEST( Func_Sim, Translated_Blocks)
+{
+    // the loop overwrites its own translated code
+    ASSERT_NE( compare_translated( smc_loop, MAX_VAL64), 0u);
+
+    for ( const auto& binary : { valid_elf_file, std::string( TEST_PATH "/bench/matmul.out"), std::string( TEST_PATH "/bench/sort.out"),
+                                 std::string( TEST_PATH "/bench/pointer_chase.out"), std::string( TEST_PATH "/bench/recursion.out")})
+    {
+        ASSERT_NE( compare_translated( binary, MAX_VAL64), 0u) << binary;
+        // the translated blocks stop exactly on the limit
+        ASSERT_NE( compare_translated( binary, 12345), 0u) << binary;
+    }
+
+    config::LocalValues translate( std::map<std::string, std::string>{ { "translate", "true"}});
+    FuncSim<MIPS> mips;
+    ASSERT_EXIT( mips.run_no_limit( smc_code);,
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "Bearings lost:.*");
+}
+
+static DataflowInstr get_alu( Addr PC, size_t src, size_t dst)
+{
+    DataflowInstr instr;
+    instr.PC = PC;
+    instr.srcs.at( 0) = src;
+    instr.srcs_num = 1;
+    instr.dsts.at( 0) = dst;
+    instr.dsts_num = 1;
+    return instr;
+}
+
+TEST( Dataflow, Windows_Limit_Independent_Instrs)
+{
+    DataflowAnalyzer dataflow( { 2}, 2, 16);
+    for ( size_t i = 0; i < 4; ++i)
+        dataflow.retire( get_alu( 0x100 + 4 * i, 1, 2 + i));
+    dataflow.finish();
+
+    ASSERT_EQ( dataflow.get_instrs(), 4);
+    ASSERT_EQ( dataflow.get_cycles( 0), 1);
+    ASSERT_EQ( dataflow.get_ipc( 0), 4);
+    // the third instruction enters the window as the first one retires
+    ASSERT_EQ( dataflow.get_cycles( 2), 2);
+    ASSERT_EQ( dataflow.get_ipc( 2), 2);
+    ASSERT_EXIT( dataflow.get_cycles( 3), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Dataflow, Critical_Path_Of_Chains)
+{
+    DataflowAnalyzer dataflow( {}, 2, 4);
+    // the long chain goes through the segments, the short one is out of the path
+    for ( size_t i = 0; i < 6; ++i) {
+        dataflow.retire( get_alu( 0x100, 1, 1));
+        if ( i < 2)
+            dataflow.retire( get_alu( 0x200, 2, 2));
+    }
+    dataflow.finish();
+
+    ASSERT_EQ( dataflow.get_critical_path_length(), 6);
+    const auto hot = dataflow.get_hot_instrs( 2);
+    ASSERT_EQ( hot.size(), 1);
+    ASSERT_EQ( hot[ 0].first, 0x100);
+    ASSERT_EQ( hot[ 0].second, 6);
+}
+
+TEST( Dataflow, Loads_Depend_On_Stores)
+{
+    DataflowAnalyzer dataflow( {}, 2, 16);
+    dataflow.retire( get_alu( 0x100, 1, 1));
+
+    DataflowInstr store = get_alu( 0x104, 1, 0);
+    store.dsts_num = 0;
+    store.is_store = true;
+    store.mem_addr = 0x1000;
+    store.mem_size = 4;
+    dataflow.retire( store);
+
+    // the load of the other word does not wait for the store
+    DataflowInstr load = get_alu( 0x108, 3, 4);
+    load.latency = 2;
+    load.is_load = true;
+    load.mem_addr = 0x1004;
+    load.mem_size = 4;
+    dataflow.retire( load);
+    ASSERT_EQ( dataflow.get_critical_path_length(), 2);
+
+    load.mem_addr = 0x1002;
+    load.mem_size = 2;
+    dataflow.retire( load);
+    ASSERT_EQ( dataflow.get_critical_path_length(), 4);
+}
+
+TEST( Dataflow, Parse_Windows)
+{
+    ASSERT_EQ( DataflowAnalyzer::parse_windows( "64,256,0"), std::vector<uint64>( { 64, 256, 0}));
+    ASSERT_EXIT( DataflowAnalyzer::parse_windows( "64,,0"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( DataflowAnalyzer::parse_windows( "-1"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( DataflowAnalyzer( { 64}, 0, 16), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Func_Sim, Dataflow_Limit)
+{
+    config::LocalValues dataflow( std::map<std::string, std::string>{ { "dataflow-windows", "16,0"}, { "translate", "true"}});
+    FuncSim<MIPS> sim;
+    ::testing::internal::CaptureStdout();
+    sim.run( TEST_PATH "/bench/sort.out", 100000);
+    const auto output = ::testing::internal::GetCapturedStdout();
+
+    ASSERT_NE( output.find( "dataflow limit of 100000 instructions"), std::string::npos);
+    ASSERT_NE( output.find( "window of 16: "), std::string::npos);
+    ASSERT_NE( output.find( "unlimited window: "), std::string::npos);
+    ASSERT_NE( output.find( "critical path: "), std::string::npos);
+}
+
 int main( int argc, char* argv[])
 {
     ::testing::InitGoogleTest( &argc, argv);
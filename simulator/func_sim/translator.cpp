@@ -0,0 +1,445 @@
+/*
+ * translator.cpp - translation of MIPS basic blocks to operations on registers and memory
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <infra/instrcache/basic_block_cache.h>
+#include <risc_v/risc_v.h>
+
+#include "translator.h"
+
+template <typename ISA>
+std::unique_ptr<Translator<ISA>> Translator<ISA>::create( RF<ISA>* /* rf */, Memory* /* memory */)
+{
+    return nullptr;
+}
+
+/*
+ * Operations of simple instructions keep pointers to their registers
+ * and pre-computed immediates, the other instructions are copied
+ * to the block and interpreted by the generic operation.
+ */
+class MIPSTranslator : public Translator<MIPS>
+{
+    public:
+        MIPSTranslator( RF<MIPS>* rf, MIPS::Memory* memory)
+            : rf( rf), memory( memory), generation( memory->get_block_generation())
+        { }
+
+        uint64 run( Addr* PC, uint64 instrs_to_run, uint64* nops_in_a_row, bool* halted) final;
+
+    private:
+        // blocks are translated after they are interpreted a few times
+        static const uint32 HOT_BLOCK_EXECUTIONS = 16;
+        // the interpreter aborts the simulation on more nops in a row
+        static const uint64 MAX_NOPS_IN_A_ROW = 10;
+
+        struct Op;
+        // returns false if the operation has overwritten translated code
+        using Handler = bool (*)( MIPSTranslator* translator, const Op& op);
+
+        struct Op
+        {
+            Handler handler = nullptr;
+            uint32* dst = nullptr;
+            uint32* dst_hi = nullptr; // HI register of multiplication and division
+            const uint32* src1 = nullptr;
+            const uint32* src2 = nullptr;
+            uint32 imm = 0;           // extended immediate, shift amount or jump target
+            Addr next_PC = 0;         // PC of the next instruction, it is also the link address
+            uint32 mem_size = 0;
+            const MIPSInstr* instr = nullptr; // instruction interpreted by the generic operation
+        };
+
+        struct Block
+        {
+            std::vector<MIPSInstr> instrs;
+            std::vector<Op> ops;
+            uint32 executions = 0;
+            Addr end_PC = 0;
+            bool ends_with_jump = false;
+
+            // nops at the start and at the end of the block and the longest sequence of them
+            uint64 leading_nops = 0;
+            uint64 trailing_nops = 0;
+            uint64 longest_nops = 0;
+
+            // successors are chained, so the next block is not looked for in the map
+            std::array<Addr, 2> successor_PCs = {};
+            std::array<Block*, 2> successors = {};
+        };
+
+        RF<MIPS>* const rf;
+        MIPS::Memory* const memory;
+        uint64 generation;
+        Addr next_PC = 0;
+        std::unordered_map<Addr, Block> blocks = {};
+
+        void flush();
+        Block* find_block( Addr PC);
+        void translate( Addr PC, Block* block);
+        Op translate_op( const MIPSInstr& instr);
+        size_t execute( const Block& block);
+
+        static Block* get_successor( const Block& block, Addr PC);
+        static void chain( Block* block, Addr PC, Block* successor);
+        static bool can_execute( const Block& block, uint64 instrs_to_run, uint64 nops_in_a_row);
+
+        static Handler get_handler( const MIPSInstr& instr);
+        static Handler get_load_handler( const MIPSInstr& instr);
+        static Handler get_mult_div_handler( const MIPSInstr& instr);
+
+        static bool execute_generic( MIPSTranslator* translator, const Op& op);
+        template<uint32 size, bool is_signed>
+        static bool execute_load( MIPSTranslator* translator, const Op& op);
+        static bool execute_store( MIPSTranslator* translator, const Op& op);
+        template<bool (*predicate)( uint32, uint32)>
+        static bool execute_branch( MIPSTranslator* translator, const Op& op);
+        template<auto function>
+        static bool execute_hi_lo( MIPSTranslator* translator, const Op& op);
+        template<auto function>
+        static bool execute_low( MIPSTranslator* translator, const Op& op);
+
+        static bool eq( uint32 x, uint32 y) { return x == y; }
+        static bool ne( uint32 x, uint32 y) { return x != y; }
+        static bool lez( uint32 x, uint32 /* zero */) { return static_cast<int32>( x) <= 0; }
+        static bool gtz( uint32 x, uint32 /* zero */) { return static_cast<int32>( x) > 0; }
+        static bool ltz( uint32 x, uint32 /* zero */) { return static_cast<int32>( x) < 0; }
+        static bool gez( uint32 x, uint32 /* zero */) { return static_cast<int32>( x) >= 0; }
+};
+
+template<>
+std::unique_ptr<Translator<MIPS>> Translator<MIPS>::create( RF<MIPS>* rf, Memory* memory)
+{
+    return std::make_unique<MIPSTranslator>( rf, memory);
+}
+
+uint64 MIPSTranslator::run( Addr* PC, uint64 instrs_to_run, uint64* nops_in_a_row, bool* halted)
+{
+    uint64 executed_instrs = 0;
+    Block* previous = nullptr;
+    Block* block = nullptr;
+    while ( true)
+    {
+        // stores into code drop decoded blocks, so their translations are dropped as well
+        if ( memory->get_block_generation() != generation || blocks.size() >= BASIC_BLOCK_CACHE_CAPACITY)
+        {
+            flush();
+            previous = block = nullptr;
+        }
+
+        if ( block == nullptr)
+        {
+            block = find_block( *PC);
+            if ( block == nullptr)
+                return executed_instrs;
+            if ( previous != nullptr)
+                chain( previous, *PC, block);
+        }
+
+        if ( !can_execute( *block, instrs_to_run - executed_instrs, *nops_in_a_row))
+            return executed_instrs;
+
+        const size_t executed_ops = execute( *block);
+        executed_instrs += executed_ops;
+
+        // the block has overwritten translated code, so the rest of it may be changed
+        if ( executed_ops < block->ops.size())
+        {
+            for ( size_t i = 0; i < executed_ops; ++i)
+                *nops_in_a_row = block->instrs[ i].is_nop() ? *nops_in_a_row + 1 : 0;
+            *PC = block->instrs[ executed_ops - 1].get_new_PC();
+            previous = block = nullptr;
+            continue;
+        }
+
+        *nops_in_a_row = block->leading_nops == block->ops.size()
+                       ? *nops_in_a_row + block->leading_nops
+                       : block->trailing_nops;
+
+        *PC = block->ends_with_jump ? next_PC : block->end_PC;
+        *halted = block->ends_with_jump && *PC == 0;
+        if ( *halted)
+            return executed_instrs;
+
+        previous = block;
+        block = get_successor( *block, *PC);
+    }
+}
+
+void MIPSTranslator::flush()
+{
+    blocks.clear();
+    generation = memory->get_block_generation();
+}
+
+MIPSTranslator::Block* MIPSTranslator::find_block( Addr PC)
+{
+    auto& block = blocks[ PC];
+    if ( block.ops.empty())
+    {
+        if ( ++block.executions < HOT_BLOCK_EXECUTIONS)
+            return nullptr;
+        translate( PC, &block);
+    }
+    return &block;
+}
+
+MIPSTranslator::Block* MIPSTranslator::get_successor( const Block& block, Addr PC)
+{
+    for ( size_t i = 0; i < block.successors.size(); ++i)
+        if ( block.successors[ i] != nullptr && block.successor_PCs[ i] == PC)
+            return block.successors[ i];
+    return nullptr;
+}
+
+void MIPSTranslator::chain( Block* block, Addr PC, Block* successor)
+{
+    // the last slot is replaced by targets of indirect jumps
+    const size_t slot = block->successors[ 0] == nullptr ? 0 : 1;
+    block->successor_PCs[ slot] = PC;
+    block->successors[ slot] = successor;
+}
+
+bool MIPSTranslator::can_execute( const Block& block, uint64 instrs_to_run, uint64 nops_in_a_row)
+{
+    // the interpreter stops in the middle of the block on the limit and on too many nops
+    return block.ops.size() <= instrs_to_run
+        && nops_in_a_row + block.leading_nops <= MAX_NOPS_IN_A_ROW
+        && block.longest_nops <= MAX_NOPS_IN_A_ROW;
+}
+
+size_t MIPSTranslator::execute( const Block& block)
+{
+    next_PC = block.end_PC;
+    for ( size_t i = 0; i < block.ops.size(); ++i)
+        if ( !block.ops[ i].handler( this, block.ops[ i]))
+            return i + 1;
+    return block.ops.size();
+}
+
+void MIPSTranslator::translate( Addr PC, Block* block)
+{
+    const auto& instrs = memory->fetch_block( PC);
+    block->instrs = std::vector<MIPSInstr>( instrs.begin(), instrs.end());
+
+    block->ops.reserve( block->instrs.size());
+    uint64 nops = 0;
+    for ( const auto& instr : block->instrs)
+    {
+        block->ops.emplace_back( translate_op( instr));
+        nops = instr.is_nop() ? nops + 1 : 0;
+        if ( nops == block->ops.size())
+            block->leading_nops = nops;
+        block->longest_nops = std::max( block->longest_nops, nops);
+    }
+    block->trailing_nops = nops;
+    block->end_PC = block->instrs.back().get_PC() + 4;
+    block->ends_with_jump = block->instrs.back().is_jump();
+}
+
+bool MIPSTranslator::execute_generic( MIPSTranslator* translator, const Op& op)
+{
+    MIPSInstr instr = *op.instr;
+    translator->rf->read_sources( &instr);
+    instr.execute_dispatched();
+    translator->memory->load_store( &instr);
+    translator->rf->write_dst( instr);
+    instr.check_trap();
+    translator->next_PC = instr.get_new_PC();
+    return translator->memory->get_block_generation() == translator->generation;
+}
+
+template<uint32 size, bool is_signed>
+bool MIPSTranslator::execute_load( MIPSTranslator* translator, const Op& op)
+{
+    using Value = std::conditional_t<size == 1, uint8, std::conditional_t<size == 2, uint16, uint32>>;
+    using Result = std::conditional_t<is_signed, sign_t<Value>, Value>;
+    const auto value = static_cast<Result>( translator->memory->load( *op.src1 + op.imm, size));
+    *op.dst = static_cast<uint32>( static_cast<int32>( value));
+    return true;
+}
+
+bool MIPSTranslator::execute_store( MIPSTranslator* translator, const Op& op)
+{
+    translator->memory->store( *op.src1 + op.imm, *op.src2, op.mem_size);
+    return translator->memory->get_block_generation() == translator->generation;
+}
+
+template<bool (*predicate)( uint32, uint32)>
+bool MIPSTranslator::execute_branch( MIPSTranslator* translator, const Op& op)
+{
+    translator->next_PC = predicate( *op.src1, *op.src2) ? op.imm : op.next_PC;
+    return true;
+}
+
+template<auto function>
+bool MIPSTranslator::execute_hi_lo( MIPSTranslator* /* translator */, const Op& op)
+{
+    const uint64 value = function( *op.src1, *op.src2);
+    *op.dst_hi = static_cast<uint32>( value >> 32);
+    *op.dst = static_cast<uint32>( value);
+    return true;
+}
+
+template<auto function>
+bool MIPSTranslator::execute_low( MIPSTranslator* /* translator */, const Op& op)
+{
+    *op.dst = static_cast<uint32>( function( *op.src1, *op.src2));
+    return true;
+}
+
+MIPSTranslator::Op MIPSTranslator::translate_op( const MIPSInstr& instr)
+{
+    Op op;
+    op.handler = get_handler( instr);
+    op.instr = &instr;
+    op.next_PC = instr.get_PC() + 4;
+    op.mem_size = instr.mem_size;
+    op.src1 = rf->get_read_ptr( instr.src1);
+    op.src2 = rf->get_read_ptr( instr.src2);
+    if ( instr.dst.is_mips_hi_lo())
+    {
+        op.dst = rf->get_write_ptr( MIPSRegister::mips_lo);
+        op.dst_hi = rf->get_write_ptr( MIPSRegister::mips_hi);
+    }
+    else
+    {
+        op.dst = rf->get_write_ptr( instr.dst);
+    }
+
+    const auto simm = static_cast<uint32>( sign_extend( static_cast<int16>( instr.v_imm)));
+    switch ( instr.operation)
+    {
+        case MIPSInstr::OUT_R_SHAMT: op.imm = instr.shamt; break;
+        case MIPSInstr::OUT_I_ARITHM:
+            // logical operations extend immediates with zeros
+            op.imm = ( instr.op_id == MIPSInstr::OP_ANDI || instr.op_id == MIPSInstr::OP_ORI || instr.op_id == MIPSInstr::OP_XORI)
+                   ? static_cast<uint32>( zero_extend( static_cast<uint16>( instr.v_imm)))
+                   : simm;
+            break;
+        case MIPSInstr::OUT_I_CONST: op.imm = static_cast<uint32>( static_cast<uint16>( instr.v_imm)) << 16; break;
+        case MIPSInstr::OUT_I_LOAD:
+        case MIPSInstr::OUT_I_LOADU:
+        case MIPSInstr::OUT_I_STORE: op.imm = simm; break;
+        case MIPSInstr::OUT_I_BRANCH:
+        case MIPSInstr::OUT_I_BRANCH_0:
+        case MIPSInstr::OUT_RI_BRANCH_0: op.imm = op.next_PC + ( simm << 2); break;
+        case MIPSInstr::OUT_J_JUMP:
+        case MIPSInstr::OUT_J_JUMP_LINK: op.imm = ( instr.PC & 0xf0000000) | ( instr.v_imm << 2); break;
+        default: break;
+    }
+    return op;
+}
+
+MIPSTranslator::Handler MIPSTranslator::get_handler( const MIPSInstr& instr)
+{
+    switch ( instr.op_id)
+    {
+        case MIPSInstr::OP_SLL:  return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 << op.imm; return true; };
+        case MIPSInstr::OP_SRL:  return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 >> op.imm; return true; };
+        case MIPSInstr::OP_SRA:  return []( MIPSTranslator*, const Op& op) { *op.dst = static_cast<uint32>( static_cast<int32>( *op.src1) >> op.imm); return true; };
+        case MIPSInstr::OP_SLLV: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 << ( *op.src2 & 31u); return true; };
+        case MIPSInstr::OP_SRLV: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 >> ( *op.src2 & 31u); return true; };
+        case MIPSInstr::OP_SRAV: return []( MIPSTranslator*, const Op& op) { *op.dst = static_cast<uint32>( static_cast<int32>( *op.src1) >> ( *op.src2 & 31u)); return true; };
+        case MIPSInstr::OP_MOVE: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1; return true; };
+        case MIPSInstr::OP_MOVZ: return []( MIPSTranslator*, const Op& op) { if ( *op.src2 == 0) *op.dst = *op.src1; return true; };
+        case MIPSInstr::OP_MOVN: return []( MIPSTranslator*, const Op& op) { if ( *op.src2 != 0) *op.dst = *op.src1; return true; };
+        case MIPSInstr::OP_ADD:
+        case MIPSInstr::OP_ADDU: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 + *op.src2; return true; };
+        case MIPSInstr::OP_SUB:
+        case MIPSInstr::OP_SUBU: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 - *op.src2; return true; };
+        case MIPSInstr::OP_AND:  return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 & *op.src2; return true; };
+        case MIPSInstr::OP_OR:   return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 | *op.src2; return true; };
+        case MIPSInstr::OP_XOR:  return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 ^ *op.src2; return true; };
+        case MIPSInstr::OP_NOR:  return []( MIPSTranslator*, const Op& op) { *op.dst = ~( *op.src1 | *op.src2); return true; };
+        case MIPSInstr::OP_SET_LT:  return []( MIPSTranslator*, const Op& op) { *op.dst = static_cast<int32>( *op.src1) < static_cast<int32>( *op.src2); return true; };
+        case MIPSInstr::OP_SET_LTU: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 < *op.src2; return true; };
+        case MIPSInstr::OP_ADDI:
+        case MIPSInstr::OP_ADDIU:   return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 + op.imm; return true; };
+        case MIPSInstr::OP_SET_LTI: return []( MIPSTranslator*, const Op& op) { *op.dst = static_cast<int32>( *op.src1) < static_cast<int32>( op.imm); return true; };
+        case MIPSInstr::OP_SET_LTIU: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 < op.imm; return true; };
+        case MIPSInstr::OP_ANDI: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 & op.imm; return true; };
+        case MIPSInstr::OP_ORI:  return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 | op.imm; return true; };
+        case MIPSInstr::OP_XORI: return []( MIPSTranslator*, const Op& op) { *op.dst = *op.src1 ^ op.imm; return true; };
+        case MIPSInstr::OP_LUI:  return []( MIPSTranslator*, const Op& op) { *op.dst = op.imm; return true; };
+        case MIPSInstr::OP_CLZ:  return []( MIPSTranslator*, const Op& op) { *op.dst = count_zeros( *op.src1); return true; };
+        case MIPSInstr::OP_CLO:  return []( MIPSTranslator*, const Op& op) { *op.dst = count_zeros( ~*op.src1); return true; };
+        case MIPSInstr::OP_MULT:
+        case MIPSInstr::OP_MULTU:
+        case MIPSInstr::OP_DIV:
+        case MIPSInstr::OP_DIVU: return get_mult_div_handler( instr);
+        case MIPSInstr::OP_LOAD_ADDR: return get_load_handler( instr);
+        case MIPSInstr::OP_STORE_ADDR: return instr.operation == MIPSInstr::OUT_I_STORE ? execute_store : execute_generic;
+        case MIPSInstr::OP_BRANCH_EQ:  return execute_branch<eq>;
+        case MIPSInstr::OP_BRANCH_NE:  return execute_branch<ne>;
+        case MIPSInstr::OP_BRANCH_LEZ: return execute_branch<lez>;
+        case MIPSInstr::OP_BRANCH_GTZ: return execute_branch<gtz>;
+        case MIPSInstr::OP_BRANCH_LTZ: return execute_branch<ltz>;
+        case MIPSInstr::OP_BRANCH_GEZ: return execute_branch<gez>;
+        case MIPSInstr::OP_J:
+            return []( MIPSTranslator* translator, const Op& op) { translator->next_PC = op.imm; return true; };
+        case MIPSInstr::OP_JAL:
+            return []( MIPSTranslator* translator, const Op& op) { *op.dst = op.next_PC; translator->next_PC = op.imm; return true; };
+        case MIPSInstr::OP_JR:
+            return []( MIPSTranslator* translator, const Op& op) { translator->next_PC = align_up<2>( *op.src1); return true; };
+        case MIPSInstr::OP_JALR:
+            return []( MIPSTranslator* translator, const Op& op) {
+                // the target is read before the link is written, as they may be the same register
+                translator->next_PC = align_up<2>( *op.src1);
+                *op.dst = op.next_PC;
+                return true;
+            };
+        default:
+            // traps, system calls, branches with link and unaligned accesses are interpreted
+            return execute_generic;
+    }
+}
+
+MIPSTranslator::Handler MIPSTranslator::get_load_handler( const MIPSInstr& instr)
+{
+    if ( instr.operation == MIPSInstr::OUT_I_LOAD)
+        switch ( instr.mem_size)
+        {
+            case 1: return execute_load<1, true>;
+            case 2: return execute_load<2, true>;
+            case 4: return execute_load<4, false>;
+            default: break;
+        }
+
+    if ( instr.operation == MIPSInstr::OUT_I_LOADU)
+        switch ( instr.mem_size)
+        {
+            case 1: return execute_load<1, false>;
+            case 2: return execute_load<2, false>;
+            default: break;
+        }
+
+    return execute_generic;
+}
+
+MIPSTranslator::Handler MIPSTranslator::get_mult_div_handler( const MIPSInstr& instr)
+{
+    // 'mul' writes a general purpose register instead of HI and LO
+    if ( !instr.dst.is_mips_hi_lo())
+        return instr.op_id == MIPSInstr::OP_MULT ? execute_low<mips_multiplication<int32>> : execute_generic;
+
+    switch ( instr.op_id)
+    {
+        case MIPSInstr::OP_MULT:  return execute_hi_lo<mips_multiplication<int32>>;
+        case MIPSInstr::OP_MULTU: return execute_hi_lo<mips_multiplication<uint32>>;
+        case MIPSInstr::OP_DIV:   return execute_hi_lo<mips_division<int32>>;
+        default:                  return execute_hi_lo<mips_division<uint32>>;
+    }
+}
+
+template class Translator<MIPS>;
+template class Translator<RISCV32>;
+template class Translator<RISCV64>;
+template class Translator<RISCV128>;
@@ -0,0 +1,50 @@
+/*
+ * translator.h - execution of translated basic blocks in functional simulation
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef TRANSLATOR_H
+#define TRANSLATOR_H
+
+#include <memory>
+
+#include <infra/types.h>
+#include <mips/mips.h>
+
+#include "rf/rf.h"
+
+/*
+ * Hot basic blocks are translated to sequences of operations which access
+ * registers and memory directly, without decoded instructions and their
+ * interpretation. Blocks are chained to their successors, and stores into
+ * translated code drop all the translations.
+ * The translator returns to the interpreter on the first block it cannot
+ * execute exactly as the interpreter does, e.g. a cold block, the last block
+ * before the instruction limit or a block of ten nops in a row.
+ */
+template <typename ISA>
+class Translator
+{
+    using Memory = typename ISA::Memory;
+
+    public:
+        // returns nullptr if the code of the ISA is not translated
+        static std::unique_ptr<Translator> create( RF<ISA>* rf, Memory* memory);
+
+        Translator() = default;
+        virtual ~Translator() = default;
+
+        Translator( const Translator&) = delete;
+        Translator( Translator&&) = delete;
+        Translator& operator=( const Translator&) = delete;
+        Translator& operator=( Translator&&) = delete;
+
+        // executes up to instrs_to_run instructions from PC, updates PC and the counter of nops,
+        // returns the number of executed instructions
+        virtual uint64 run( Addr* PC, uint64 instrs_to_run, uint64* nops_in_a_row, bool* halted) = 0;
+};
+
+template<>
+std::unique_ptr<Translator<MIPS>> Translator<MIPS>::create( RF<MIPS>* rf, Memory* memory);
+
+#endif // TRANSLATOR_H
@@ -0,0 +1,67 @@
+/**
+ * async_writer.cpp - buffered file output in a background thread
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "async_writer.h"
+
+#include <cstdlib>
+#include <iostream>
+
+AsyncWriter::AsyncWriter( const std::string& filename, size_t buffer_size)
+    : buffer_size( buffer_size)
+    , out( filename, std::ios::binary)
+{
+    if ( !out.is_open())
+    {
+        std::cerr << "ERROR. Could not open file " << filename << " for writing" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    buffer.reserve( buffer_size);
+    pending.reserve( buffer_size);
+    thread = std::thread( [this]() { run(); });
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    flush();
+    {
+        std::lock_guard<std::mutex> lock( mutex);
+        is_done = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+void AsyncWriter::flush()
+{
+    if ( buffer.empty())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock( mutex);
+        cv.wait( lock, [this]() { return pending.empty(); });
+        pending.swap( buffer);
+    }
+    cv.notify_all();
+}
+
+void AsyncWriter::run()
+{
+    std::unique_lock<std::mutex> lock( mutex);
+    while ( true)
+    {
+        cv.wait( lock, [this]() { return is_done || !pending.empty(); });
+        if ( pending.empty())
+            return;
+
+        // the producer fills the other buffer meanwhile
+        lock.unlock();
+        out.write( pending.data(), static_cast<std::streamsize>( pending.size()));
+        lock.lock();
+
+        pending.clear();
+        cv.notify_all();
+    }
+}
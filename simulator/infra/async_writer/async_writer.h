@@ -0,0 +1,67 @@
+/**
+ * async_writer.h - buffered file output in a background thread
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <infra/types.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Bytes are appended to a buffer in memory. The full buffer is passed
+ * to the background thread, which writes it to the file while the next
+ * one is filled, so the producer waits only if the disk is slower.
+ */
+class AsyncWriter
+{
+    public:
+        explicit AsyncWriter( const std::string& filename, size_t buffer_size = 1 << 20);
+        ~AsyncWriter();
+
+        void put( char byte)
+        {
+            buffer.push_back( byte);
+            if ( buffer.size() >= buffer_size)
+                flush();
+        }
+
+        void write( const char* bytes, size_t size)
+        {
+            buffer.insert( buffer.end(), bytes, bytes + size);
+            if ( buffer.size() >= buffer_size)
+                flush();
+        }
+
+        // passes the buffer to the background thread
+        void flush();
+
+        AsyncWriter( const AsyncWriter&) = delete;
+        AsyncWriter( AsyncWriter&&) = delete;
+        AsyncWriter& operator=( const AsyncWriter&) = delete;
+        AsyncWriter& operator=( AsyncWriter&&) = delete;
+
+    private:
+        const size_t buffer_size;
+        std::vector<char> buffer = {};
+
+        // the buffer being written by background thread, empty if the thread is idle
+        std::vector<char> pending = {};
+        bool is_done = false;
+
+        std::ofstream out;
+        std::mutex mutex = {};
+        std::condition_variable cv = {};
+        std::thread thread = {};
+
+        void run();
+};
+
+#endif // ASYNC_WRITER_H
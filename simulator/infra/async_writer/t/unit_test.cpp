@@ -0,0 +1,69 @@
+// Google Test Library
+#include <gtest/gtest.h>
+
+// Module
+#include "../async_writer.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+static std::string read_file( const std::string& filename)
+{
+    std::ifstream file( filename, std::ios::binary);
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+TEST( AsyncWriter, Bytes_Are_Written_On_Destruction)
+{
+    {
+        AsyncWriter writer( "async_writer_test.bin");
+        writer.write( "abc", 3);
+        writer.put( '\0');
+        writer.put( 'd');
+    }
+    ASSERT_EQ( read_file( "async_writer_test.bin"), std::string( "abc\0d", 5));
+}
+
+TEST( AsyncWriter, Small_Buffers_Keep_Order)
+{
+    std::string expected;
+    {
+        AsyncWriter writer( "async_writer_test.bin", 7);
+        for ( int i = 0; i < 10000; ++i)
+        {
+            const auto byte = static_cast<char>( i % 251);
+            writer.put( byte);
+            expected.push_back( byte);
+            if ( i % 1000 == 0)
+            {
+                writer.write( "xyz", 3);
+                expected += "xyz";
+            }
+        }
+    }
+    ASSERT_EQ( read_file( "async_writer_test.bin"), expected);
+}
+
+TEST( AsyncWriter, Empty_File)
+{
+    {
+        AsyncWriter writer( "async_writer_test.bin");
+        writer.flush();
+    }
+    ASSERT_TRUE( read_file( "async_writer_test.bin").empty());
+}
+
+TEST( AsyncWriter, Wrong_File)
+{
+    ASSERT_EXIT( AsyncWriter( "./no/such/dir/file.bin"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,46 @@
+/**
+ * barrier.h - synchronization of a group of threads
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+/*
+ * Threads wait until all of them arrive. The last one runs the completion
+ * before the others are released, so it sees results of all the threads.
+ * Threads are synchronized each simulated cycle, so they spin instead of
+ * sleeping, and they yield the processor to run with more threads than it has.
+ */
+class Barrier
+{
+    public:
+        explicit Barrier( size_t threads) : threads( threads) { }
+
+        template <typename Completion>
+        void wait( Completion completion)
+        {
+            const auto current_phase = phase.load( std::memory_order_relaxed);
+            if ( arrived.fetch_add( 1, std::memory_order_acq_rel) + 1 == threads)
+            {
+                completion();
+                arrived.store( 0, std::memory_order_relaxed);
+                phase.store( current_phase + 1, std::memory_order_release);
+                return;
+            }
+
+            while ( phase.load( std::memory_order_acquire) == current_phase)
+                std::this_thread::yield();
+        }
+
+    private:
+        const size_t threads;
+        std::atomic<size_t> arrived{ 0};
+        std::atomic<size_t> phase{ 0};
+};
+
+#endif // BARRIER_H
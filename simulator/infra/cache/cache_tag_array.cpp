@@ -5,47 +5,17 @@
  * Copyright 2014-2017 MIPT-MIPS
  */
 
-#include <cassert>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 // MIPT-MIPS includes
 #include "infra/cache/cache_tag_array.h"
 
-LRUCacheInfo::LRUCacheInfo( std::size_t ways)
-    : ways( ways)
-{
-    assert( ways != 0u);
-
-    lru_hash.reserve( ways);
-
-    for ( std::size_t i = 0; i < ways; i++)
-    {
-        lru_list.push_front( i);
-        lru_hash.emplace( i, lru_list.begin());
-    }
-}
-
-void LRUCacheInfo::touch( std::size_t way)
-{
-    const auto lru_it = lru_hash.find( way);
-    assert( lru_it != lru_hash.end());
-
-    // Put the way to the head of the list
-    lru_list.splice( lru_list.begin(), lru_list, lru_it->second);
-}
-
-std::size_t LRUCacheInfo::update()
-{
-    // remove the least recently used element from the tail
-    std::size_t lru_elem = lru_list.back();
-    lru_list.pop_back();
-
-    // put it to the head
-    auto ptr = lru_list.insert( lru_list.begin(), lru_elem);
-    lru_hash.insert_or_assign( lru_elem, ptr);
-
-    return lru_elem;
-}
-
 CacheTagArraySizeCheck::CacheTagArraySizeCheck(
     uint32 size_in_bytes,
     uint32 ways,
@@ -104,27 +74,95 @@ CacheTagArraySize::CacheTagArraySize(
     : CacheTagArraySizeCheck( size_in_bytes, ways, line_size, addr_size_in_bits)
     , sets( size_in_bytes / ( ways * line_size))
     , addr_mask( bitmask<Addr>( addr_size_in_bits))
+    , line_bits( static_cast<uint32>( popcount( line_size - 1)))
 { }
 
-uint32 CacheTagArraySize::set( Addr addr) const
+// returns bit mask of ways which store the tag
+static uint64 match_tags( const uint32* set_tags, uint32 ways, uint32 tag)
+{
+    uint64 mask = 0;
+    uint32 way = 0;
+#if defined(__AVX2__)
+    const __m256i key8 = _mm256_set1_epi32( static_cast<int>( tag));
+    for ( ; way + 8 <= ways; way += 8)
+    {
+        const __m256i cmp = _mm256_cmpeq_epi32( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( set_tags + way)), key8);
+        mask |= uint64{ static_cast<uint32>( _mm256_movemask_ps( _mm256_castsi256_ps( cmp)))} << way;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i key4 = _mm_set1_epi32( static_cast<int>( tag));
+    for ( ; way + 4 <= ways; way += 4)
+    {
+        const __m128i cmp = _mm_cmpeq_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( set_tags + way)), key4);
+        mask |= uint64{ static_cast<uint32>( _mm_movemask_ps( _mm_castsi128_ps( cmp)))} << way;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint32x4_t key4 = vdupq_n_u32( tag);
+    const uint32x4_t bits = { 1, 2, 4, 8};
+    for ( ; way + 4 <= ways; way += 4)
+    {
+        const uint32x4_t cmp = vceqq_u32( vld1q_u32( set_tags + way), key4);
+        mask |= uint64{ vaddvq_u32( vandq_u32( cmp, bits))} << way;
+    }
+#endif
+    for ( ; way < ways; ++way)
+        if ( set_tags[ way] == tag)
+            mask |= uint64{ 1} << way;
+
+    return mask;
+}
+
+// the number of ways is known at compile time, so the comparisons are unrolled
+template <uint32 WAYS>
+static uint64 match_tags( const uint32* set_tags, uint32 tag)
 {
-    return ( ( addr & addr_mask) / line_size) & (sets - 1);
+    uint64 mask = 0;
+    for ( uint32 way = 0; way < WAYS; ++way)
+        mask |= uint64{ set_tags[ way] == tag} << way;
+
+    return mask;
 }
 
-Addr CacheTagArraySize::tag( Addr addr) const
+// geometries of the default caches and predictors are specialized,
+// the other ones fall back to comparisons by vectors of the host
+static uint64 match_set_tags( const uint32* set_tags, uint32 ways, uint32 tag)
 {
-    return ( addr & addr_mask) / line_size;
+    switch ( ways)
+    {
+        case 1:  return match_tags<1>( set_tags, tag);
+        case 2:  return match_tags<2>( set_tags, tag);
+        case 4:  return match_tags<4>( set_tags, tag);
+        case 8:  return match_tags<8>( set_tags, tag);
+        case 16: return match_tags<16>( set_tags, tag);
+        default: return match_tags( set_tags, ways, tag);
+    }
+}
+
+static uint32 find_first_way( uint64 mask)
+{
+#if defined(__GNUC__)
+    return static_cast<uint32>( __builtin_ctzll( mask));
+#else
+    uint32 way = 0;
+    for ( ; ( mask & 1u) == 0; mask >>= 1)
+        ++way;
+    return way;
+#endif
 }
 
 CacheTagArray::CacheTagArray(
     uint32 size_in_bytes,
     uint32 ways,
     uint32 line_size,
-    uint32 addr_size_in_bits)
+    uint32 addr_size_in_bits,
+    const std::string& replacement)
     : CacheTagArraySize( size_in_bytes, ways, line_size, addr_size_in_bits)
-    , tags( sets, std::vector<Tag>( ways))
-    , lookup_helper( sets, std::unordered_map<Addr, uint32>( ways))
-    , lru_module( sets, ways)
+    , valid_words( ( ways + 63) / 64)
+    , tags( sets * ways, 0)
+    , valid( sets * valid_words, 0)
+    , lookup_helper( ways > MAX_SCANNED_WAYS ? sets : 0, std::unordered_map<Addr, uint32>( ways))
+    , replacement_module( ReplacementModule::create( replacement, sets, ways))
 { }
 
 std::pair<bool, uint32> CacheTagArray::read( Addr addr)
@@ -135,20 +173,36 @@ std::pair<bool, uint32> CacheTagArray::read( Addr addr)
     if ( is_hit)
     {
         uint32 num_set = set( addr);
-        lru_module.touch( num_set, way);
+        replacement_module->touch( num_set, way);
     }
 
+    ++( is_hit ? hits : misses);
     return lookup_result;
 }
 
+void CacheTagArray::register_stats( StatsRegistry* stats, const std::string& prefix) const
+{
+    stats->add_counter( prefix + ".hits", &hits);
+    stats->add_counter( prefix + ".misses", &misses);
+}
+
 std::pair<bool, uint32> CacheTagArray::read_no_touch( Addr addr) const
 {
     const uint32 num_set = set( addr);
     const Addr   num_tag = tag( addr);
 
-    const auto& result = lookup_helper[ num_set].find( num_tag);
-    return ( result != lookup_helper[ num_set].end())
-           ? std::make_pair( true, result->second)
+    if ( ways > MAX_SCANNED_WAYS)
+    {
+        const auto& result = lookup_helper[ num_set].find( num_tag);
+        return ( result != lookup_helper[ num_set].end())
+               ? std::make_pair( true, result->second)
+               : std::make_pair( false, NO_VAL32);
+    }
+
+    // tags of all the ways are compared at once
+    const uint64 hits = match_set_tags( &tags[ num_set * ways], ways, static_cast<uint32>( num_tag)) & valid[ num_set];
+    return ( hits != 0)
+           ? std::make_pair( true, find_first_way( hits))
            : std::make_pair( false, NO_VAL32);
 }
 
@@ -158,20 +212,24 @@ uint32 CacheTagArray::write( Addr addr)
 
     // get cache coordinates
     const uint32 num_set = set( addr);
-    const uint32 way = lru_module.update( num_set);
+    const uint32 way = replacement_module->update( num_set);
 
     // get an old tag
-    auto& entry = tags[ num_set][ way];
-    const Addr old_tag = entry.tag;
+    auto& entry_tag = tags[ num_set * ways + way];
+    auto& valid_word = valid[ num_set * valid_words + way / 64];
+    const uint64 valid_bit = uint64{ 1} << ( way % 64);
 
     // Remove old tag from lookup helper and add a new tag
-    if ( entry.is_valid)
-        lookup_helper[ num_set].erase( old_tag);
-    lookup_helper[ num_set].emplace( new_tag, way);
+    if ( ways > MAX_SCANNED_WAYS)
+    {
+        if ( ( valid_word & valid_bit) != 0)
+            lookup_helper[ num_set].erase( entry_tag);
+        lookup_helper[ num_set].emplace( new_tag, way);
+    }
 
     // Update tag array
-    entry.tag = new_tag;
-    entry.is_valid = true;
+    entry_tag = static_cast<uint32>( new_tag);
+    valid_word |= valid_bit;
 
     return way;
 }
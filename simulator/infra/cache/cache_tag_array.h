@@ -10,42 +10,15 @@
 #include <infra/types.h>
 #include <infra/log.h>
 #include <infra/macro.h>
+#include <infra/stats/stats.h>
 
+#include "replacement.h"
+
+#include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <utility>
-#include <list>
-
-// Replacement algorithm modules (LRU)
-class LRUCacheInfo
-{
-    public:
-        explicit LRUCacheInfo( std::size_t ways);
-
-        void touch( std::size_t way);
-        std::size_t update();
-
-    private:
-        std::list<std::size_t> lru_list{};
-        std::unordered_map<std::size_t, decltype(lru_list.cbegin())> lru_hash{};
-
-        const std::size_t ways;
-};
-
-class LRUModule
-{
-    public:
-        LRUModule( std::size_t number_of_sets, std::size_t number_of_ways)
-            : lru_info( number_of_sets, LRUCacheInfo( number_of_ways))
-        { }
-
-        void touch( uint32 num_set, uint32 num_way) { lru_info[ num_set].touch( num_way); }
-
-        uint32 update( uint32 num_set) { return lru_info[ num_set].update(); }
-
-    private:
-        std::vector<LRUCacheInfo> lru_info;
-};
 
 // Cache tag array module implementation
 class CacheTagArraySizeCheck : private Log
@@ -77,11 +50,12 @@ class CacheTagArraySize : public CacheTagArraySizeCheck
     public:
         const uint32 sets;
         const Addr   addr_mask;
+        const uint32 line_bits; // line size is a power of 2, so lines are numbered by shifts
 
         // extract set from address
-        uint32 set( Addr addr) const;
+        uint32 set( Addr addr) const { return static_cast<uint32>( tag( addr)) & ( sets - 1); }
         // extract tag from address
-        Addr tag( Addr addr) const;
+        Addr tag( Addr addr) const { return ( addr & addr_mask) >> line_bits; }
 };
 
 class CacheTagArray : public CacheTagArraySize
@@ -93,30 +67,39 @@ class CacheTagArray : public CacheTagArraySize
             uint32 size_in_bytes,
             uint32 ways,
             uint32 line_size,
-            uint32 addr_size_in_bits = 32
+            uint32 addr_size_in_bits = 32,
+            const std::string& replacement = "lru"
         );
 
         // hit or not
         bool lookup( Addr addr) { return read( addr).first; }
-        // lookup the cache and update LRU info
+        // lookup the cache and update replacement info
         std::pair<bool, Way> read( Addr addr);
-        // find in the cache but do not update LRU info
+        // find in the cache but do not update replacement info
         std::pair<bool, Way> read_no_touch( Addr addr) const;
         // create new entry in cache
         Way write( Addr addr);
+
+        // lookups updating replacement info are counted as hits and misses
+        void register_stats( StatsRegistry* stats, const std::string& prefix) const;
     private:
-        struct Tag
-        {
-            bool is_valid = false;
-            Addr tag = 0u;
-        };
+        // sets with more ways are looked up by hash tables instead of tags comparison
+        static constexpr const uint32 MAX_SCANNED_WAYS = 64;
 
-        // tags storage
-        std::vector<std::vector<Tag>> tags;
+        // number of 64-bit words with valid bits of one set
+        const uint32 valid_words;
 
-        // hash tabe to lookup tags in O(1)
+        // tags storage, tags of one set are contiguous; addresses
+        // are not longer than 32 bits, so tags fit 32 bits too
+        std::vector<uint32> tags;
+        std::vector<uint64> valid;
+
+        // hash tabe to lookup tags of highly associative sets in O(1)
         std::vector<std::unordered_map<Addr, Way>> lookup_helper;
-        LRUModule lru_module; // LRU algorithm module
+        std::unique_ptr<ReplacementModule> replacement_module;
+
+        uint64 hits = 0;
+        uint64 misses = 0;
 };
 
 #endif // CACHE_TAG_ARRAY_H
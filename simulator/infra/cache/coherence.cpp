@@ -0,0 +1,91 @@
+/**
+ * coherence.cpp
+ * MSI directory of private data caches
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "infra/cache/coherence.h"
+
+#include <cstdlib>
+#include <iostream>
+
+// sharers of each line are kept in a bit mask
+static const size_t MAX_CACHES = 64;
+
+uint32 CoherenceDirectory::connect( CacheLevel* l1, std::shared_ptr<CacheLevel> l2_cache)
+{
+    if ( caches.size() == MAX_CACHES)
+    {
+        std::cerr << "ERROR. Coherence directory supports up to " << MAX_CACHES << " caches" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    if ( caches.empty())
+        l2 = std::move( l2_cache);
+    caches.push_back( l1);
+    return static_cast<uint32>( caches.size() - 1);
+}
+
+void CoherenceDirectory::write_back( Addr line)
+{
+    // without L2 cache the line goes to memory in background
+    if ( l2 != nullptr)
+        l2->access( line, true);
+}
+
+Latency CoherenceDirectory::read( uint32 cache, Addr line)
+{
+    auto& entry = lines[ line];
+    Latency result = 0_Lt;
+    if ( entry.is_modified && entry.sharers != get_mask( cache))
+    {
+        // the owner keeps the line shared
+        for ( uint32 i = 0; i < caches.size(); ++i)
+            if ( ( entry.sharers & get_mask( i)) != 0 && caches[ i]->clean( line))
+                write_back( line);
+        ++interventions;
+        entry.is_modified = false;
+        result = latency;
+    }
+
+    entry.sharers |= get_mask( cache);
+    return result;
+}
+
+Latency CoherenceDirectory::write( uint32 cache, Addr line)
+{
+    auto& entry = lines[ line];
+    if ( entry.is_modified && entry.sharers == get_mask( cache))
+        return 0_Lt;
+
+    const auto others = entry.sharers & ~get_mask( cache);
+    for ( uint32 i = 0; i < caches.size(); ++i)
+    {
+        if ( ( others & get_mask( i)) == 0)
+            continue;
+        if ( caches[ i]->invalidate( line))
+            write_back( line);
+        ++invalidations;
+    }
+
+    entry.sharers = get_mask( cache);
+    entry.is_modified = true;
+    return others != 0 ? latency : 0_Lt;
+}
+
+void CoherenceDirectory::evict( uint32 cache, Addr line)
+{
+    const auto it = lines.find( line);
+    if ( it == lines.end())
+        return;
+
+    it->second.sharers &= ~get_mask( cache);
+    if ( it->second.sharers == 0)
+        lines.erase( it);
+}
+
+void CoherenceDirectory::register_stats( StatsRegistry* stats, const std::string& prefix) const
+{
+    stats->add_counter( prefix + ".invalidations", &invalidations);
+    stats->add_counter( prefix + ".interventions", &interventions);
+}
@@ -0,0 +1,68 @@
+/**
+ * coherence.h
+ * MSI directory of private data caches
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef COHERENCE_H
+#define COHERENCE_H
+
+#include <infra/ports/timing.h>
+#include <infra/stats/stats.h>
+#include <infra/types.h>
+
+#include "memory_hierarchy.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Private L1 caches of cores share L2 cache. A line is Modified
+ * in one of them or Shared by several ones, lines which are absent
+ * in the directory are Invalid in all the caches. Modified lines
+ * are written back to L2 cache when other caches request them.
+ */
+class CoherenceDirectory
+{
+    public:
+        // latency of invalidation or write-back requested from other caches
+        explicit CoherenceDirectory( Latency latency) : latency( latency) { }
+
+        // returns number of the cache, L2 cache of the first connection is shared
+        uint32 connect( CacheLevel* l1, std::shared_ptr<CacheLevel> l2);
+        const std::shared_ptr<CacheLevel>& get_l2() const { return l2; }
+
+        // cache requests the line to read or to write it,
+        // returns the latency of actions of other caches
+        Latency read( uint32 cache, Addr line);
+        Latency write( uint32 cache, Addr line);
+
+        // the line is replaced in the cache
+        void evict( uint32 cache, Addr line);
+
+        uint64 get_invalidations() const { return invalidations; }
+        uint64 get_interventions() const { return interventions; }
+        void register_stats( StatsRegistry* stats, const std::string& prefix) const;
+
+    private:
+        struct Entry
+        {
+            uint64 sharers = 0; // bit mask of caches holding the line
+            bool is_modified = false;
+        };
+
+        static uint64 get_mask( uint32 cache) { return uint64{ 1} << cache; }
+        void write_back( Addr line);
+
+        const Latency latency;
+        std::vector<CacheLevel*> caches = {};
+        std::shared_ptr<CacheLevel> l2 = nullptr;
+        std::unordered_map<Addr, Entry> lines = {};
+
+        uint64 invalidations = 0; // copies invalidated by writes of other caches
+        uint64 interventions = 0; // modified copies written back for reads of other caches
+};
+
+#endif // COHERENCE_H
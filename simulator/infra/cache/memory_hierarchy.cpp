@@ -0,0 +1,353 @@
+/**
+ * memory_hierarchy.cpp
+ * Timing model of data caches
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+#include "infra/cache/memory_hierarchy.h"
+#include "infra/cache/coherence.h"
+
+CacheLevel::CacheLevel( uint32 size_in_bytes,
+                        uint32 ways,
+                        uint32 line_size,
+                        Latency latency,
+                        const std::string& replacement)
+    : tags( size_in_bytes, ways, line_size, 32, replacement)
+    , line_size( line_size)
+    , latency( latency)
+    , lines( size_in_bytes / line_size, 0)
+    , dirty( size_in_bytes / line_size, false)
+    , valid( size_in_bytes / line_size, false)
+    , prefetched( size_in_bytes / line_size, false)
+    , prefetch_victims( size_in_bytes / line_size, std::nullopt)
+    , next_prefetch_victims( size_in_bytes / line_size / ways, 0)
+{ }
+
+CacheLevel::Result CacheLevel::update( Addr addr, bool is_write, bool is_counted, bool is_prefetch)
+{
+    Result result;
+    const auto[ is_tag_hit, hit_way] = tags.read( addr);
+    const auto way = is_tag_hit ? hit_way : tags.write( addr);
+    const auto index = tags.set( addr) * tags.ways + way;
+
+    // invalidated line is filled again in its way
+    const bool is_hit = is_tag_hit && valid[ index];
+    result.is_hit = is_hit;
+    result.is_prefetched = is_hit && prefetched[ index];
+
+    if ( is_counted)
+        ++( is_hit ? hits : misses);
+
+    if ( !is_hit)
+    {
+        if ( !is_tag_hit && valid[ index])
+            result.eviction = lines[ index];
+        if ( !is_tag_hit && dirty[ index])
+        {
+            writebacks += is_counted ? 1 : 0;
+            result.writeback = lines[ index];
+        }
+
+        // replacement of a prefetched line which is not accessed pollutes nothing
+        if ( is_prefetch && result.eviction.has_value() && !prefetched[ index])
+            remember_prefetch_victim( *result.eviction);
+
+        lines[ index] = get_line( addr);
+        dirty[ index] = false;
+        valid[ index] = true;
+    }
+
+    if ( is_write)
+        dirty[ index] = true;
+
+    prefetched[ index] = is_prefetch;
+    return result;
+}
+
+CacheLevel::Result CacheLevel::access( Addr addr, bool is_write, bool is_counted)
+{
+    auto result = update( addr, is_write, is_counted, false);
+    result.is_polluted = has_prefetches && !result.is_hit && forget_prefetch_victim( get_line( addr));
+    return result;
+}
+
+CacheLevel::Result CacheLevel::prefetch( Addr addr)
+{
+    has_prefetches = true;
+    forget_prefetch_victim( get_line( addr));
+    return update( addr, false, false, true);
+}
+
+void CacheLevel::remember_prefetch_victim( Addr line)
+{
+    // the oldest victim of the set is forgotten
+    const auto set = tags.set( line);
+    auto& next = next_prefetch_victims[ set];
+    prefetch_victims[ set * tags.ways + next] = line;
+    next = ( next + 1) % tags.ways;
+}
+
+bool CacheLevel::forget_prefetch_victim( Addr line)
+{
+    const auto first = tags.set( line) * tags.ways;
+    for ( size_t i = first; i < first + tags.ways; ++i)
+        if ( prefetch_victims[ i] == line)
+        {
+            prefetch_victims[ i] = std::nullopt;
+            return true;
+        }
+    return false;
+}
+
+std::optional<size_t> CacheLevel::find( Addr addr) const
+{
+    const auto[ is_hit, way] = tags.read_no_touch( addr);
+    const auto index = tags.set( addr) * tags.ways + way;
+    if ( !is_hit || !valid[ index])
+        return std::nullopt;
+    return index;
+}
+
+bool CacheLevel::invalidate( Addr addr)
+{
+    const auto index = find( addr);
+    if ( !index.has_value())
+        return false;
+
+    const bool is_dirty = dirty[ *index];
+    valid[ *index] = false;
+    dirty[ *index] = false;
+    prefetched[ *index] = false;
+    return is_dirty;
+}
+
+bool CacheLevel::clean( Addr addr)
+{
+    const auto index = find( addr);
+    if ( !index.has_value())
+        return false;
+
+    const bool is_dirty = dirty[ *index];
+    dirty[ *index] = false;
+    return is_dirty;
+}
+
+void CacheLevel::register_stats( StatsRegistry* stats, const std::string& prefix) const
+{
+    stats->add_counter( prefix + ".hits", &hits);
+    stats->add_counter( prefix + ".misses", &misses);
+    stats->add_counter( prefix + ".writebacks", &writebacks);
+}
+
+MemoryHierarchy::MemoryHierarchy( std::unique_ptr<CacheLevel> l1,
+                                  std::shared_ptr<CacheLevel> l2,
+                                  Latency memory_latency,
+                                  uint32 mshrs_num)
+    : l1( std::move( l1))
+    , l2( std::move( l2))
+    , memory_latency( memory_latency)
+    , mshrs_num( mshrs_num)
+{
+    assert( this->l1 != nullptr);
+    mshrs.reserve( mshrs_num);
+}
+
+void MemoryHierarchy::connect( CoherenceDirectory* value)
+{
+    directory = value;
+    directory_id = directory->connect( l1.get(), l2);
+    l2 = directory->get_l2();
+}
+
+Latency MemoryHierarchy::keep_coherent( Addr line, bool is_store, const CacheLevel::Result& result)
+{
+    if ( directory == nullptr)
+        return 0_Lt;
+
+    if ( result.eviction.has_value())
+        directory->evict( directory_id, *result.eviction);
+
+    // loads hit lines which are shared or modified already
+    if ( is_store)
+        return directory->write( directory_id, line);
+    return result.is_hit ? 0_Lt : directory->read( directory_id, line);
+}
+
+Latency MemoryHierarchy::fill( Addr line, std::optional<Addr> writeback, bool is_counted)
+{
+    if ( l2 == nullptr)
+        return memory_latency;
+
+    // dirty lines are written back in background
+    if ( writeback.has_value())
+        l2->access( *writeback, true, is_counted);
+
+    const auto result = l2->access( line, false, is_counted);
+    return result.is_hit ? l2->get_latency() : l2->get_latency() + memory_latency;
+}
+
+void MemoryHierarchy::release_mshrs( Cycle now)
+{
+    mshrs.erase( std::remove_if( mshrs.begin(), mshrs.end(), [now]( const MSHR& m) { return m.ready <= now; }),
+                 mshrs.end());
+}
+
+bool MemoryHierarchy::account_prefetches( const CacheLevel::Result& result, std::vector<MSHR>::iterator pending)
+{
+    if ( prefetcher == nullptr)
+        return false;
+
+    if ( result.is_polluted)
+        ++prefetch_pollution;
+
+    if ( pending != mshrs.end() && pending->is_prefetch)
+    {
+        ++late_prefetches;
+        pending->is_prefetch = false;
+    }
+
+    // misses and the first accesses of prefetched lines keep the prefetcher ahead
+    useful_prefetches += result.is_prefetched ? 1 : 0;
+    return !result.is_hit || result.is_prefetched;
+}
+
+Latency MemoryHierarchy::access_in_background( Addr addr, bool is_store, Cycle cycle)
+{
+    auto now = cycle + stall_cycles;
+    release_mshrs( now);
+
+    // the first cycle of the access is the cycle of memory stage
+    Latency wait = l1->get_latency() - 1_Lt;
+    const Addr line = l1->get_line( addr);
+    const auto pending = std::find_if( mshrs.begin(), mshrs.end(), [line]( const MSHR& m) { return m.line == line; });
+    if ( pending != mshrs.end())
+    {
+        // line is allocated already, but loads wait for its data
+        const auto result = l1->access( addr, is_store);
+        trigger_line = account_prefetches( result, pending) ? std::optional<Addr>( line) : std::nullopt;
+        wait = wait + keep_coherent( line, is_store, result);
+        if ( !is_store)
+            wait = std::max( wait, pending->ready - now);
+    }
+    else
+    {
+        const auto result = l1->access( addr, is_store);
+        trigger_line = account_prefetches( result, mshrs.end()) ? std::optional<Addr>( line) : std::nullopt;
+        const auto coherence_latency = keep_coherent( line, is_store, result);
+        if ( result.is_hit)
+            wait = wait + coherence_latency;
+        else
+        {
+            Latency mshr_wait = 0_Lt;
+            if ( mshrs_num > 0 && mshrs.size() == mshrs_num)
+            {
+                const auto prefetch = std::find_if( mshrs.begin(), mshrs.end(), []( const MSHR& m) { return m.is_prefetch; });
+                if ( prefetch != mshrs.end())
+                    drop_prefetch( prefetch);
+                else
+                {
+                    const auto earliest = std::min_element( mshrs.begin(), mshrs.end(),
+                                                            []( const MSHR& a, const MSHR& b) { return a.ready < b.ready; });
+                    mshr_wait = earliest->ready - now;
+                    now = earliest->ready;
+                    release_mshrs( now);
+                }
+            }
+
+            const auto miss_latency = fill( line, result.writeback, true) + coherence_latency;
+            if ( !is_store || mshrs_num == 0)
+                wait = mshr_wait + wait + miss_latency;
+            else
+            {
+                mshrs.push_back( { line, now + wait + miss_latency});
+                wait = mshr_wait;
+            }
+        }
+    }
+
+    return wait;
+}
+
+void MemoryHierarchy::warm_up( Addr addr, bool is_store)
+{
+    const auto result = l1->access( addr, is_store, false);
+    keep_coherent( l1->get_line( addr), is_store, result);
+    if ( !result.is_hit)
+        fill( l1->get_line( addr), result.writeback, false);
+}
+
+void MemoryHierarchy::set_prefetcher( std::unique_ptr<DataPrefetcher> value)
+{
+    if ( mshrs_num == 0)
+    {
+        std::cerr << "ERROR. Prefetches need MSHRs of data cache" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    prefetcher = std::move( value);
+}
+
+void MemoryHierarchy::train_prefetcher( Addr PC, Addr addr, Cycle cycle)
+{
+    if ( prefetcher == nullptr)
+        return;
+
+    const Addr line = l1->get_line( addr);
+    const bool is_trigger = trigger_line == line;
+    trigger_line = std::nullopt;
+
+    prefetch_lines.clear();
+    prefetcher->train( PC, addr, is_trigger, &prefetch_lines);
+    if ( prefetch_lines.empty())
+        return;
+
+    const auto now = cycle + stall_cycles;
+    release_mshrs( now);
+    for ( const auto prefetch_line : prefetch_lines)
+        if ( prefetch_line != line)
+            prefetch( prefetch_line, now);
+}
+
+void MemoryHierarchy::prefetch( Addr line, Cycle now)
+{
+    // prefetches do not wait for MSHRs, and they are not counted as accesses of L1
+    if ( mshrs.size() >= mshrs_num || l1->contains( line)
+        || std::any_of( mshrs.begin(), mshrs.end(), [line]( const MSHR& m) { return m.line == line; }))
+        return;
+
+    const auto result = l1->prefetch( line);
+    const auto coherence_latency = keep_coherent( line, false, result);
+
+    mshrs.push_back( { line, now + l1->get_latency() + fill( line, result.writeback, true) + coherence_latency, true});
+    ++prefetches;
+}
+
+void MemoryHierarchy::drop_prefetch( std::vector<MSHR>::iterator mshr)
+{
+    // the line is allocated at the start of the prefetch, so it is invalidated unless it is evicted already
+    if ( l1->contains( mshr->line))
+    {
+        l1->invalidate( mshr->line);
+        if ( directory != nullptr)
+            directory->evict( directory_id, mshr->line);
+    }
+    mshrs.erase( mshr);
+}
+
+void MemoryHierarchy::register_stats( StatsRegistry* stats, const std::string& prefix) const
+{
+    l1->register_stats( stats, prefix + ".l1");
+    if ( l2 != nullptr)
+        l2->register_stats( stats, prefix + ".l2");
+    if ( prefetcher == nullptr)
+        return;
+
+    stats->add_counter( prefix + ".prefetches", &prefetches);
+    stats->add_counter( prefix + ".useful_prefetches", &useful_prefetches);
+    stats->add_counter( prefix + ".late_prefetches", &late_prefetches);
+    stats->add_counter( prefix + ".prefetch_pollution", &prefetch_pollution);
+}
@@ -0,0 +1,192 @@
+/**
+ * memory_hierarchy.h
+ * Timing model of data caches
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef MEMORY_HIERARCHY_H
+#define MEMORY_HIERARCHY_H
+
+#include <infra/ports/timing.h>
+#include <infra/types.h>
+
+#include "cache_tag_array.h"
+#include "prefetcher.h"
+
+class CoherenceDirectory;
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Cache level with write-back and write-allocate policies
+class CacheLevel
+{
+    public:
+        CacheLevel( uint32 size_in_bytes,
+                    uint32 ways,
+                    uint32 line_size,
+                    Latency latency,
+                    const std::string& replacement = "lru");
+
+        struct Result
+        {
+            bool is_hit = false;
+            std::optional<Addr> writeback = std::nullopt; // evicted dirty line
+            std::optional<Addr> eviction = std::nullopt;  // evicted line, dirty or not
+            bool is_prefetched = false; // the first demand access of a prefetched line
+            bool is_polluted = false;   // the missed line was evicted by a prefetch
+        };
+
+        // looks the line up, allocates it on miss;
+        // accesses of warm-up and prefetches are not counted in statistics
+        Result access( Addr addr, bool is_write, bool is_counted = true);
+        Result prefetch( Addr addr);
+
+        // coherence actions requested by other caches, they return true if the line was dirty
+        bool invalidate( Addr addr);
+        bool clean( Addr addr);
+
+        // looks the line up without changes of replacement state
+        bool contains( Addr addr) const { return find( addr).has_value(); }
+
+        Addr get_line( Addr addr) const { return addr & ~Addr{ line_size - 1}; }
+        Latency get_latency() const { return latency; }
+
+        uint64 get_hits() const { return hits; }
+        uint64 get_misses() const { return misses; }
+        uint64 get_writebacks() const { return writebacks; }
+
+        void register_stats( StatsRegistry* stats, const std::string& prefix) const;
+
+    private:
+        CacheTagArray tags;
+        const uint32 line_size;
+        const Latency latency;
+
+        // data of each way, indexed in the same way as tags,
+        // tags of invalidated lines are kept until the way is replaced
+        std::vector<Addr> lines;
+        std::vector<bool> dirty;
+        std::vector<bool> valid;
+        std::vector<bool> prefetched; // the line is not accessed since prefetch
+
+        // lines evicted by prefetches and not accessed since, each set keeps as many of them as it has ways
+        std::vector<std::optional<Addr>> prefetch_victims;
+        std::vector<uint32> next_prefetch_victims; // slot of the next victim in each set
+        bool has_prefetches = false;
+
+        // returns index of the way holding the valid line, nullopt if it is absent
+        std::optional<size_t> find( Addr addr) const;
+        // records of lines evicted by prefetches, forget() returns true if the line was recorded
+        void remember_prefetch_victim( Addr line);
+        bool forget_prefetch_victim( Addr line);
+        Result update( Addr addr, bool is_write, bool is_counted, bool is_prefetch);
+
+        uint64 hits = 0;
+        uint64 misses = 0;
+        uint64 writebacks = 0;
+};
+
+/*
+ * L1 data cache backed by optional L2 cache and memory.
+ *
+ * Loads wait for their misses, while store misses are filled in background
+ * by MSHRs (miss status holding registers). An access waits for a free MSHR
+ * if all of them are busy, and loads wait for lines being filled by MSHRs.
+ *
+ * Prefetches take free MSHRs only, and a demand miss takes the MSHR
+ * of a prefetch instead of waiting, so the prefetched line is dropped.
+ * A prefetch is useful if its line is accessed before eviction, and late
+ * if the line is still being filled then. Pollution is the number of misses
+ * on lines evicted by prefetches, each set remembers as many of the latest
+ * evicted lines as it has ways.
+ */
+class MemoryHierarchy
+{
+    public:
+        MemoryHierarchy( std::unique_ptr<CacheLevel> l1,
+                         std::shared_ptr<CacheLevel> l2,
+                         Latency memory_latency,
+                         uint32 mshrs_num);
+
+        // L1 cache is kept coherent with caches of other cores connected to the directory,
+        // L2 cache of the first connected hierarchy is shared by all of them
+        void connect( CoherenceDirectory* value);
+
+        // returns number of cycles the pipeline waits for the access issued at the cycle,
+        // the cycle does not include the cycles waited before
+        Latency access( Addr addr, bool is_store, Cycle cycle)
+        {
+            const auto wait = access_in_background( addr, is_store, cycle);
+            stall( wait);
+            return wait;
+        }
+
+        // returns latency of the access which does not stop the pipeline, e.g. of a drained store
+        Latency access_in_background( Addr addr, bool is_store, Cycle cycle);
+
+        // the pipeline waits for something else than the access, e.g. for a full store buffer
+        void stall( Latency cycles) { stall_cycles = stall_cycles + cycles; }
+
+        // updates caches without timing
+        void warm_up( Addr addr, bool is_store);
+
+        // the load trains the prefetcher after its access, and the requested lines are prefetched at the cycle
+        void set_prefetcher( std::unique_ptr<DataPrefetcher> value);
+        void train_prefetcher( Addr PC, Addr addr, Cycle cycle);
+
+        Latency get_stall_cycles() const { return stall_cycles; }
+        const CacheLevel& get_l1() const { return *l1; }
+        const CacheLevel* get_l2() const { return l2.get(); }
+        bool has_prefetcher() const { return prefetcher != nullptr; }
+        uint64 get_prefetches() const { return prefetches; }
+        uint64 get_useful_prefetches() const { return useful_prefetches; }
+        uint64 get_late_prefetches() const { return late_prefetches; }
+        uint64 get_prefetch_pollution() const { return prefetch_pollution; }
+
+        // levels are registered as "<prefix>.l1" and "<prefix>.l2"
+        void register_stats( StatsRegistry* stats, const std::string& prefix) const;
+
+    private:
+        struct MSHR
+        {
+            Addr line = 0;
+            Cycle ready = 0_Cl;
+            bool is_prefetch = false;
+        };
+
+        // accesses levels below L1 for a missed line, returns their latency
+        Latency fill( Addr line, std::optional<Addr> writeback, bool is_counted);
+
+        // returns latency of coherence actions of other caches needed by the access
+        Latency keep_coherent( Addr line, bool is_store, const CacheLevel::Result& result);
+
+        // usefulness of prefetches accessed by the demand access, returns true if it is a trigger of prefetcher
+        bool account_prefetches( const CacheLevel::Result& result, std::vector<MSHR>::iterator pending);
+        void prefetch( Addr line, Cycle now);
+        void drop_prefetch( std::vector<MSHR>::iterator mshr);
+        void release_mshrs( Cycle now);
+
+        std::unique_ptr<CacheLevel> l1;
+        std::shared_ptr<CacheLevel> l2;
+        CoherenceDirectory* directory = nullptr;
+        uint32 directory_id = 0;
+        const Latency memory_latency;
+        const uint32 mshrs_num;
+
+        std::vector<MSHR> mshrs = {};
+        Latency stall_cycles = 0_Lt;
+
+        std::unique_ptr<DataPrefetcher> prefetcher = nullptr;
+        std::vector<Addr> prefetch_lines = {};
+        std::optional<Addr> trigger_line = std::nullopt; // line of the last demand access if it is a trigger
+
+        uint64 prefetches = 0;
+        uint64 useful_prefetches = 0;
+        uint64 late_prefetches = 0;
+        uint64 prefetch_pollution = 0;
+};
+
+#endif // MEMORY_HIERARCHY_H
@@ -0,0 +1,124 @@
+/**
+ * prefetcher.cpp
+ * Data prefetchers trained by loads
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "prefetcher.h"
+
+DataPrefetcher::DataPrefetcher( uint32 line_size, uint32 degree, uint32 distance)
+    : line_size( line_size)
+    , degree( degree)
+    , distance( distance)
+{
+    if ( line_size == 0 || ( line_size & ( line_size - 1)) != 0 || degree == 0 || distance == 0)
+    {
+        std::cerr << "ERROR. Degree and distance of prefetcher must be positive, and line size must be a power of two" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+}
+
+std::unique_ptr<DataPrefetcher> DataPrefetcher::create( const std::string& name, uint32 line_size, uint32 degree, uint32 distance, uint32 entries)
+{
+    if ( entries == 0)
+    {
+        std::cerr << "ERROR. Prefetcher must track at least one entry" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    if ( name == "stride")
+        return std::make_unique<StridePrefetcher>( line_size, degree, distance, entries);
+    if ( name == "stream")
+        return std::make_unique<StreamPrefetcher>( line_size, degree, distance, entries);
+
+    std::cerr << "ERROR. Invalid data prefetcher " << name << ", supported prefetchers: stride, stream" << std::endl;
+    std::exit( EXIT_FAILURE);
+}
+
+StridePrefetcher::StridePrefetcher( uint32 line_size, uint32 degree, uint32 distance, uint32 entries)
+    : DataPrefetcher( line_size, degree, distance)
+    , table( entries)
+{ }
+
+void StridePrefetcher::train( Addr PC, Addr addr, bool /* is_trigger */, std::vector<Addr>* lines)
+{
+    // instructions are aligned, so the lowest bits of PC do not index the table
+    auto& entry = table[ ( PC >> 2) % table.size()];
+    if ( !entry.is_valid || entry.PC != PC)
+    {
+        entry = { true, PC, addr, 0, 0};
+        return;
+    }
+
+    const int64 stride = int64{ addr} - int64{ entry.last_addr};
+    entry.last_addr = addr;
+    if ( stride == entry.stride)
+        entry.confidence = std::min<uint8>( entry.confidence + 1, MAX_CONFIDENCE);
+    else if ( entry.confidence > 0)
+        --entry.confidence;
+    else
+        entry.stride = stride;
+
+    if ( entry.confidence < STEADY_CONFIDENCE || entry.stride == 0)
+        return;
+
+    const int64 line = line_size;
+    const int64 step = std::abs( entry.stride) >= line ? entry.stride : ( entry.stride > 0 ? line : -line);
+    for ( uint32 i = 0; i < degree; ++i)
+    {
+        const int64 target = int64{ addr} + step * ( distance + i);
+        if ( target < 0 || target > int64{ MAX_VAL32})
+            return;
+        lines->push_back( get_line( static_cast<Addr>( target)));
+    }
+}
+
+StreamPrefetcher::StreamPrefetcher( uint32 line_size, uint32 degree, uint32 distance, uint32 entries)
+    : DataPrefetcher( line_size, degree, distance)
+    , streams( entries)
+{ }
+
+void StreamPrefetcher::train( Addr /* PC */, Addr addr, bool is_trigger, std::vector<Addr>* lines)
+{
+    if ( !is_trigger)
+        return;
+
+    ++triggers;
+    const int64 line = addr / line_size;
+    const auto get_delta = [line, this]( const Stream& stream) { return line - int64{ stream.last_line / line_size}; };
+
+    // streams are used since their first triggers
+    Stream* nearest = nullptr;
+    for ( auto& stream : streams)
+        if ( stream.last_use != 0 && std::abs( get_delta( stream)) <= WINDOW
+            && ( nearest == nullptr || std::abs( get_delta( stream)) < std::abs( get_delta( *nearest))))
+            nearest = &stream;
+
+    if ( nearest == nullptr)
+    {
+        auto& oldest = *std::min_element( streams.begin(), streams.end(),
+                                          []( const Stream& a, const Stream& b) { return a.last_use < b.last_use; });
+        oldest = { get_line( addr), 0, triggers};
+        return;
+    }
+
+    const auto delta = get_delta( *nearest);
+    if ( delta != 0)
+        nearest->direction = delta > 0 ? 1 : -1;
+    nearest->last_line = get_line( addr);
+    nearest->last_use = triggers;
+    if ( nearest->direction == 0)
+        return;
+
+    for ( uint32 i = 0; i < degree; ++i)
+    {
+        const int64 target = ( line + nearest->direction * ( distance + i)) * line_size;
+        if ( target < 0 || target > int64{ MAX_VAL32})
+            return;
+        lines->push_back( static_cast<Addr>( target));
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ * prefetcher.h
+ * Data prefetchers trained by loads
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef CACHE_PREFETCHER_H
+#define CACHE_PREFETCHER_H
+
+#include <infra/types.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Prefetcher interface, it is trained by each load and returns the lines to be prefetched
+class DataPrefetcher
+{
+    public:
+        // the prefetcher requests 'degree' lines starting 'distance' lines or strides ahead of the access
+        DataPrefetcher( uint32 line_size, uint32 degree, uint32 distance);
+        virtual ~DataPrefetcher() = default;
+        DataPrefetcher( const DataPrefetcher&) = delete;
+        DataPrefetcher( DataPrefetcher&&) = delete;
+        DataPrefetcher& operator=( const DataPrefetcher&) = delete;
+        DataPrefetcher& operator=( DataPrefetcher&&) = delete;
+
+        // the access is a trigger if it misses or hits a prefetched line for the first time,
+        // the lines are appended to the vector
+        virtual void train( Addr PC, Addr addr, bool is_trigger, std::vector<Addr>* lines) = 0;
+
+        // supported names: "stride", "stream", entries are PCs or streams tracked by the prefetcher
+        static std::unique_ptr<DataPrefetcher> create( const std::string& name, uint32 line_size, uint32 degree, uint32 distance, uint32 entries);
+
+    protected:
+        Addr get_line( Addr addr) const { return addr & ~Addr{ line_size - 1}; }
+
+        const uint32 line_size;
+        const uint32 degree;
+        const uint32 distance;
+};
+
+/*
+ * Reference prediction table: the last address and stride of each load PC.
+ * Stride is predicted once it repeats, the confident one survives a single
+ * mismatch, and it is replaced after a mismatch if it is not predicted.
+ * Strides shorter than a line are rounded up to it, so a stride
+ * over the same line prefetches the next lines.
+ */
+class StridePrefetcher final : public DataPrefetcher
+{
+    public:
+        StridePrefetcher( uint32 line_size, uint32 degree, uint32 distance, uint32 entries);
+
+        void train( Addr PC, Addr addr, bool is_trigger, std::vector<Addr>* lines) final;
+
+    private:
+        static constexpr const uint8 MAX_CONFIDENCE = 2;
+        static constexpr const uint8 STEADY_CONFIDENCE = 1;
+
+        struct Entry
+        {
+            bool is_valid = false;
+            Addr PC = 0;
+            Addr last_addr = 0;
+            int64 stride = 0;
+            uint8 confidence = 0;
+        };
+
+        std::vector<Entry> table;
+};
+
+/*
+ * Stream detector: a trigger near the last trigger of a stream
+ * sets its direction, then each of its triggers prefetches the following lines.
+ * Triggers out of all the windows start new streams instead of the least recent ones.
+ */
+class StreamPrefetcher final : public DataPrefetcher
+{
+    public:
+        StreamPrefetcher( uint32 line_size, uint32 degree, uint32 distance, uint32 entries);
+
+        void train( Addr PC, Addr addr, bool is_trigger, std::vector<Addr>* lines) final;
+
+    private:
+        // number of lines around the last trigger of a stream which are taken by it
+        static constexpr const int64 WINDOW = 8;
+
+        struct Stream
+        {
+            Addr last_line = 0;
+            int64 direction = 0; // +1 or -1 lines, 0 until the second trigger
+            uint64 last_use = 0;
+        };
+
+        std::vector<Stream> streams;
+        uint64 triggers = 0;
+};
+
+#endif // CACHE_PREFETCHER_H
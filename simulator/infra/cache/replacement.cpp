@@ -0,0 +1,192 @@
+/**
+ * replacement.cpp
+ * Implementation of replacement policies of cache tag arrays
+ * @author Oleg Ladin, Denis Los
+ * Copyright 2014-2018 MIPT-MIPS
+ */
+
+#include <cassert>
+
+#include <algorithm>
+#include <iostream>
+
+#include <infra/macro.h>
+
+#include "infra/cache/replacement.h"
+
+std::unique_ptr<ReplacementModule> ReplacementModule::create( const std::string& name, uint32 number_of_sets, uint32 number_of_ways)
+{
+    assert( number_of_ways != 0u);
+
+    if ( name == "lru" && number_of_ways <= PackedLRUModule::MAX_WAYS)
+        return std::make_unique<PackedLRUModule>( number_of_sets, number_of_ways);
+    if ( name == "lru")
+        return std::make_unique<ListLRUModule>( number_of_sets, number_of_ways);
+    if ( name == "plru")
+        return std::make_unique<PLRUModule>( number_of_sets, number_of_ways);
+    if ( name == "nru")
+        return std::make_unique<NRUModule>( number_of_sets, number_of_ways);
+    if ( name == "random")
+        return std::make_unique<RandomModule>( number_of_sets, number_of_ways);
+
+    std::cerr << "ERROR. Invalid cache replacement policy " << name << std::endl
+              << "Supported policies:" << std::endl
+              << "\tlru" << std::endl << "\tplru" << std::endl
+              << "\tnru" << std::endl << "\trandom" << std::endl;
+    std::exit( EXIT_FAILURE);
+}
+
+PackedLRUModule::PackedLRUModule( uint32 number_of_sets, uint32 number_of_ways)
+    : ages( number_of_sets, 0), ways( number_of_ways)
+{
+    assert( ways <= MAX_WAYS);
+
+    // way 0 is the least recently used one
+    uint64 initial_ages = 0;
+    for ( uint32 i = 0; i < ways; ++i)
+        initial_ages |= uint64{ ways - 1 - i} << ( i * AGE_BITS);
+
+    for ( auto& set_ages : ages)
+        set_ages = initial_ages;
+}
+
+void PackedLRUModule::touch( uint32 num_set, uint32 num_way)
+{
+    auto& set_ages = ages[ num_set];
+    const auto age = get_age( set_ages, num_way);
+
+    // ways used more recently than the touched one become older
+    for ( uint32 i = 0; i < ways; ++i)
+        if ( get_age( set_ages, i) < age)
+            set_ages += uint64{ 1} << ( i * AGE_BITS);
+
+    set_ages &= ~( uint64{ MAX_WAYS - 1} << ( num_way * AGE_BITS));
+}
+
+uint32 PackedLRUModule::update( uint32 num_set)
+{
+    uint32 way = 0;
+    while ( get_age( ages[ num_set], way) != ways - 1)
+        ++way;
+
+    touch( num_set, way);
+    return way;
+}
+
+ListLRUModule::ListLRUModule( uint32 number_of_sets, uint32 number_of_ways)
+    : prev( number_of_sets * number_of_ways)
+    , next( number_of_sets * number_of_ways)
+    , head( number_of_sets, number_of_ways - 1)
+    , tail( number_of_sets, 0)
+    , ways( number_of_ways)
+{
+    // way 0 is the least recently used one
+    for ( uint32 set = 0; set < number_of_sets; ++set)
+        for ( uint32 way = 0; way < ways; ++way)
+        {
+            prev[ index( set, way)] = way + 1 < ways ? way + 1 : NO_VAL32;
+            next[ index( set, way)] = way > 0 ? way - 1 : NO_VAL32;
+        }
+}
+
+void ListLRUModule::touch( uint32 num_set, uint32 num_way)
+{
+    auto& set_head = head[ num_set];
+    if ( set_head == num_way)
+        return;
+
+    // unlink the way, it is not the head, so it has a previous one
+    const auto way_prev = prev[ index( num_set, num_way)];
+    const auto way_next = next[ index( num_set, num_way)];
+    next[ index( num_set, way_prev)] = way_next;
+    if ( way_next != NO_VAL32)
+        prev[ index( num_set, way_next)] = way_prev;
+    else
+        tail[ num_set] = way_prev;
+
+    // put it to the head
+    prev[ index( num_set, num_way)] = NO_VAL32;
+    next[ index( num_set, num_way)] = set_head;
+    prev[ index( num_set, set_head)] = num_way;
+    set_head = num_way;
+}
+
+uint32 ListLRUModule::update( uint32 num_set)
+{
+    const auto way = tail[ num_set];
+    touch( num_set, way);
+    return way;
+}
+
+PLRUModule::PLRUModule( uint32 number_of_sets, uint32 number_of_ways)
+    : nodes( number_of_sets * number_of_ways, 0), ways( number_of_ways)
+{
+    if ( !is_power_of_two( ways))
+    {
+        std::cerr << "ERROR. Number of ways should be a power of 2 for pseudo-LRU replacement" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+}
+
+void PLRUModule::touch( uint32 num_set, uint32 num_way)
+{
+    auto set_nodes = nodes.begin() + num_set * ways;
+
+    // nodes on the path to the way point to the other halves
+    for ( uint32 node = 1, half = ways / 2; half > 0; half /= 2)
+    {
+        const uint32 direction = ( num_way & half) != 0 ? 1 : 0;
+        set_nodes[ node] = static_cast<uint8>( direction ^ 1u);
+        node = 2 * node + direction;
+    }
+}
+
+uint32 PLRUModule::update( uint32 num_set)
+{
+    const auto set_nodes = nodes.begin() + num_set * ways;
+
+    uint32 way = 0;
+    for ( uint32 node = 1; node < ways; node = 2 * node + set_nodes[ node])
+        way = 2 * way + set_nodes[ node];
+
+    touch( num_set, way);
+    return way;
+}
+
+NRUModule::NRUModule( uint32 number_of_sets, uint32 number_of_ways)
+    : used( number_of_sets * number_of_ways, 0), ways( number_of_ways)
+{ }
+
+void NRUModule::touch( uint32 num_set, uint32 num_way)
+{
+    const auto set_used = used.begin() + num_set * ways;
+    set_used[ num_way] = 1;
+
+    if ( std::find( set_used, set_used + ways, 0) == set_used + ways)
+    {
+        std::fill( set_used, set_used + ways, 0);
+        set_used[ num_way] = 1;
+    }
+}
+
+uint32 NRUModule::update( uint32 num_set)
+{
+    const auto set_used = used.begin() + num_set * ways;
+    const auto it = std::find( set_used, set_used + ways, 0);
+    const auto way = it == set_used + ways ? 0 : static_cast<uint32>( it - set_used);
+
+    touch( num_set, way);
+    return way;
+}
+
+uint32 RandomModule::update( uint32 num_set)
+{
+    if ( filled[ num_set] < ways)
+        return filled[ num_set]++;
+
+    // xorshift64 generator
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return static_cast<uint32>( ( state >> 32) % ways);
+}
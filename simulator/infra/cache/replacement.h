@@ -0,0 +1,125 @@
+/**
+ * replacement.h
+ * Replacement policies of cache tag arrays
+ * @author Oleg Ladin, Denis Los
+ * Copyright 2014-2018 MIPT-MIPS
+ */
+
+#ifndef CACHE_REPLACEMENT_H
+#define CACHE_REPLACEMENT_H
+
+#include <infra/types.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Replacement algorithm module interface.
+// All the modules keep the state of all sets in flat arrays
+class ReplacementModule
+{
+    public:
+        ReplacementModule() = default;
+        virtual ~ReplacementModule() = default;
+        ReplacementModule( const ReplacementModule&) = delete;
+        ReplacementModule( ReplacementModule&&) = delete;
+        ReplacementModule& operator=( const ReplacementModule&) = delete;
+        ReplacementModule& operator=( ReplacementModule&&) = delete;
+
+        // marks the way as the used one
+        virtual void touch( uint32 num_set, uint32 num_way) = 0;
+
+        // returns the way to be replaced and marks it as the used one
+        virtual uint32 update( uint32 num_set) = 0;
+
+        // supported names: "lru", "plru", "nru", "random"
+        static std::unique_ptr<ReplacementModule> create( const std::string& name, uint32 number_of_sets, uint32 number_of_ways);
+};
+
+// True LRU, ways of the set are ordered by 4-bit ages packed into one word
+class PackedLRUModule final : public ReplacementModule
+{
+    public:
+        static constexpr const uint32 MAX_WAYS = 16;
+
+        PackedLRUModule( uint32 number_of_sets, uint32 number_of_ways);
+
+        void touch( uint32 num_set, uint32 num_way) final;
+        uint32 update( uint32 num_set) final;
+
+    private:
+        static constexpr const uint32 AGE_BITS = 4;
+
+        static uint32 get_age( uint64 ages, uint32 way) { return ( ages >> ( way * AGE_BITS)) & ( MAX_WAYS - 1); }
+
+        std::vector<uint64> ages;
+        const uint32 ways;
+};
+
+// True LRU for highly associative caches, ways of the set are linked by indices
+class ListLRUModule final : public ReplacementModule
+{
+    public:
+        ListLRUModule( uint32 number_of_sets, uint32 number_of_ways);
+
+        void touch( uint32 num_set, uint32 num_way) final;
+        uint32 update( uint32 num_set) final;
+
+    private:
+        uint32 index( uint32 num_set, uint32 num_way) const { return num_set * ways + num_way; }
+
+        std::vector<uint32> prev; // way used more recently
+        std::vector<uint32> next; // way used less recently
+        std::vector<uint32> head; // the most recently used way of each set
+        std::vector<uint32> tail; // the least recently used way of each set
+        const uint32 ways;
+};
+
+// Tree pseudo-LRU, each node of the binary tree over ways points to the older half
+class PLRUModule final : public ReplacementModule
+{
+    public:
+        PLRUModule( uint32 number_of_sets, uint32 number_of_ways);
+
+        void touch( uint32 num_set, uint32 num_way) final;
+        uint32 update( uint32 num_set) final;
+
+    private:
+        // nodes of the set are numbered from 1, children of node N are 2N and 2N + 1
+        std::vector<uint8> nodes;
+        const uint32 ways;
+};
+
+// Not recently used, one bit per way is reset when all the ways of the set are used
+class NRUModule final : public ReplacementModule
+{
+    public:
+        NRUModule( uint32 number_of_sets, uint32 number_of_ways);
+
+        void touch( uint32 num_set, uint32 num_way) final;
+        uint32 update( uint32 num_set) final;
+
+    private:
+        std::vector<uint8> used;
+        const uint32 ways;
+};
+
+// Random replacement with a deterministic pseudo-random sequence,
+// ways of the set are filled in order first
+class RandomModule final : public ReplacementModule
+{
+    public:
+        RandomModule( uint32 number_of_sets, uint32 number_of_ways)
+            : filled( number_of_sets, 0), ways( number_of_ways)
+        { }
+
+        void touch( uint32 /* num_set */, uint32 /* num_way */) final { }
+        uint32 update( uint32 num_set) final;
+
+    private:
+        std::vector<uint32> filled;
+        uint64 state = 0x2545F4914F6CDD1Dull;
+        const uint32 ways;
+};
+
+#endif // CACHE_REPLACEMENT_H
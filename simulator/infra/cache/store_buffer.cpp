@@ -0,0 +1,96 @@
+/**
+ * store_buffer.cpp
+ * Timing model of stores waiting to be written to data cache
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+
+#include "store_buffer.h"
+
+void StoreBuffer::start_oldest( MemoryHierarchy* cache)
+{
+    if ( is_oldest_started)
+        return;
+
+    // the write of a hit takes one cycle of the cache port, misses wait as stores of the pipeline do
+    const auto& store = stores.front();
+    const auto start = std::max( write_end, store.issue);
+    write_end = start + 1_Lt + cache->access_in_background( store.addr, true, start - cache->get_stall_cycles());
+    is_oldest_started = true;
+}
+
+void StoreBuffer::drain( MemoryHierarchy* cache, Cycle now)
+{
+    while ( !stores.empty() && ( is_oldest_started || std::max( write_end, stores.front().issue) <= now))
+    {
+        start_oldest( cache);
+        if ( write_end > now)
+            return;
+
+        stores.pop_front();
+        is_oldest_started = false;
+    }
+}
+
+Cycle StoreBuffer::wait_for_oldest( MemoryHierarchy* cache)
+{
+    start_oldest( cache);
+    stores.pop_front();
+    is_oldest_started = false;
+    return write_end;
+}
+
+Latency StoreBuffer::access( MemoryHierarchy* cache, Addr addr, uint32 size, bool is_store, Cycle cycle)
+{
+    const auto now = cycle + cache->get_stall_cycles();
+    drain( cache, now);
+
+    if ( is_store)
+    {
+        Latency wait = 0_Lt;
+        if ( stores.full())
+        {
+            const auto free = wait_for_oldest( cache);
+            wait = free > now ? free - now : 0_Lt;
+            ++full_stalls;
+            full_stall_cycles += wait.to_size_t();
+            cache->stall( wait);
+        }
+        stores.emplace_back( Store{ addr, size, now + wait});
+        return wait;
+    }
+
+    // the youngest overlapping store has the latest data
+    for ( size_t i = stores.size(); i > 0; --i)
+    {
+        const auto& store = stores[ i - 1];
+        if ( addr >= store.addr + store.size || store.addr >= addr + size)
+            continue;
+
+        if ( store.addr <= addr && addr + size <= store.addr + store.size)
+        {
+            ++forwards;
+            return 0_Lt;
+        }
+
+        Cycle written = now;
+        for ( size_t older = 0; older < i; ++older)
+            written = wait_for_oldest( cache);
+
+        const auto wait = written > now ? written - now : 0_Lt;
+        ++partial_forwards;
+        cache->stall( wait);
+        return wait + cache->access( addr, false, cycle);
+    }
+
+    return cache->access( addr, false, cycle);
+}
+
+void StoreBuffer::register_stats( StatsRegistry* stats, const std::string& prefix) const
+{
+    stats->add_counter( prefix + ".forwards", &forwards);
+    stats->add_counter( prefix + ".partial_forwards", &partial_forwards);
+    stats->add_counter( prefix + ".full_stalls", &full_stalls);
+    stats->add_counter( prefix + ".full_stall_cycles", &full_stall_cycles);
+}
@@ -0,0 +1,68 @@
+/**
+ * store_buffer.h
+ * Timing model of stores waiting to be written to data cache
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef STORE_BUFFER_H
+#define STORE_BUFFER_H
+
+#include <infra/ports/timing.h>
+#include <infra/ring_buffer.h>
+#include <infra/stats/stats.h>
+#include <infra/types.h>
+
+#include "memory_hierarchy.h"
+
+/*
+ * Stores leave memory stage to the buffer and are written to the cache
+ * in program order, one at a time, while the pipeline goes on. A store stays
+ * in the buffer until its write is done. Loads take data from the youngest
+ * store covering all their bytes; a load overlapping it partially waits until
+ * that store is written and then accesses the cache. A store waits for
+ * a free entry only if the buffer is full.
+ * Values are written to functional memory in memory stage still,
+ * so the buffer models only the time.
+ */
+class StoreBuffer
+{
+    public:
+        explicit StoreBuffer( uint32 depth) : stores( depth) { }
+
+        // returns number of cycles the pipeline waits for the access issued at the cycle,
+        // as MemoryHierarchy::access does
+        Latency access( MemoryHierarchy* cache, Addr addr, uint32 size, bool is_store, Cycle cycle);
+
+        uint64 get_forwards() const { return forwards; }
+        uint64 get_partial_forwards() const { return partial_forwards; }
+        uint64 get_full_stalls() const { return full_stalls; }
+        uint64 get_full_stall_cycles() const { return full_stall_cycles; }
+        size_t size() const { return stores.size(); }
+
+        void register_stats( StatsRegistry* stats, const std::string& prefix) const;
+
+    private:
+        struct Store
+        {
+            Addr addr = 0;
+            uint32 size = 0;
+            Cycle issue = 0_Cl; // cycles of the buffer include the cycles the pipeline waited
+        };
+
+        // starts writes of the stores which can be written by the cycle, the written ones leave the buffer
+        void drain( MemoryHierarchy* cache, Cycle now);
+        void start_oldest( MemoryHierarchy* cache);
+        // the oldest store is written whenever it is possible, returns the cycle it leaves the buffer
+        Cycle wait_for_oldest( MemoryHierarchy* cache);
+
+        RingBuffer<Store> stores;
+        bool is_oldest_started = false;
+        Cycle write_end = 0_Cl; // the last write, or the current write of the oldest store if it is started
+
+        uint64 forwards = 0;
+        uint64 partial_forwards = 0;
+        uint64 full_stalls = 0;
+        uint64 full_stall_cycles = 0;
+};
+
+#endif // STORE_BUFFER_H
@@ -8,6 +8,10 @@
 
 // Module
 #include "../cache_tag_array.h"
+#include "../coherence.h"
+#include "../memory_hierarchy.h"
+#include "../prefetcher.h"
+#include "../store_buffer.h"
 
 #include <infra/types.h>
 
@@ -149,6 +153,397 @@ TEST( miss_rate_sim, Miss_Rate_Sim_Test)
     miss_rate_file.close();
 }
 
+TEST( tag_match, Ways_Of_Set_Are_Found)
+{
+    // sets of up to 16 ways are compared by specialized code, sets of 64 ways
+    // are compared in parallel, larger ones use a hash table
+    for ( uint32 ways : { 1u, 2u, 4u, 8u, 16u, 32u, 64u, 128u})
+    {
+        CacheTagArray cta( 2 * ways * LINE_SIZE, ways, LINE_SIZE);
+
+        std::vector<uint32> written_ways;
+        for ( Addr addr = 0; addr < 2 * ways * LINE_SIZE; addr += LINE_SIZE)
+            written_ways.push_back( cta.write( addr));
+
+        for ( Addr addr = 0; addr < 2 * ways * LINE_SIZE; addr += LINE_SIZE)
+        {
+            const auto[ is_hit, way] = cta.read_no_touch( addr);
+            ASSERT_TRUE( is_hit);
+            ASSERT_EQ( way, written_ways[ addr / LINE_SIZE]);
+        }
+
+        // tag of other set is not matched
+        ASSERT_FALSE( cta.lookup( 2 * ways * LINE_SIZE + LINE_SIZE));
+
+        // the least recently used line is replaced
+        cta.write( 2 * ways * LINE_SIZE);
+        ASSERT_FALSE( cta.lookup( 0)) << ways;
+        ASSERT_TRUE( cta.lookup( 2 * ways * LINE_SIZE)) << ways;
+    }
+}
+
+TEST( replacement, LRU_Implementations_Are_Equal)
+{
+    PackedLRUModule packed( 4, 16);
+    ListLRUModule list( 4, 16);
+
+    uint64 value = 1;
+    for ( uint32 i = 0; i < 10000; ++i)
+    {
+        value = value * 6364136223846793005ull + 1442695040888963407ull;
+        const auto set = static_cast<uint32>( value >> 60) % 4;
+        if ( ( value >> 40) % 3 == 0)
+            ASSERT_EQ( packed.update( set), list.update( set));
+        else
+        {
+            const auto way = static_cast<uint32>( value >> 48) % 16;
+            packed.touch( set, way);
+            list.touch( set, way);
+        }
+    }
+}
+
+TEST( replacement, LRU_Order)
+{
+    auto lru = ReplacementModule::create( "lru", 1, 4);
+
+    lru->touch( 0, 0);
+    lru->touch( 0, 2);
+    ASSERT_EQ( lru->update( 0), 1u);
+    ASSERT_EQ( lru->update( 0), 3u);
+    ASSERT_EQ( lru->update( 0), 0u);
+    ASSERT_EQ( lru->update( 0), 2u);
+}
+
+TEST( replacement, PLRU_Tree)
+{
+    auto plru = ReplacementModule::create( "plru", 2, 4);
+
+    for ( uint32 way = 0; way < 4; ++way)
+        plru->touch( 1, way);
+
+    ASSERT_EQ( plru->update( 1), 0u);
+    ASSERT_EQ( plru->update( 1), 2u);
+    ASSERT_EQ( plru->update( 1), 1u);
+    ASSERT_EQ( plru->update( 1), 3u);
+
+    // the other set is not affected
+    ASSERT_EQ( plru->update( 0), 0u);
+
+    ASSERT_EXIT( ReplacementModule::create( "plru", 1, 3), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( replacement, NRU_Bits)
+{
+    auto nru = ReplacementModule::create( "nru", 1, 4);
+
+    nru->touch( 0, 0);
+    nru->touch( 0, 1);
+    nru->touch( 0, 2);
+    ASSERT_EQ( nru->update( 0), 3u);
+
+    // all the ways were used, so only the last one is recent
+    ASSERT_EQ( nru->update( 0), 0u);
+    ASSERT_EQ( nru->update( 0), 1u);
+}
+
+TEST( replacement, Random_And_Invalid_Policies)
+{
+    auto random = ReplacementModule::create( "random", 1, 8);
+    for ( uint32 i = 0; i < 100; ++i)
+        ASSERT_LT( random->update( 0), 8u);
+
+    ASSERT_EXIT( ReplacementModule::create( "mru", 1, 8), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( replacement, Cache_With_Replacement_Policies)
+{
+    for ( const auto& policy : { "lru", "plru", "nru", "random"})
+    {
+        CacheTagArray cta( 256, 4, LINE_SIZE, 32, policy);
+
+        // a working set of the cache size stays in it
+        for ( Addr addr = 0; addr < 256; addr += LINE_SIZE)
+            if ( !cta.lookup( addr))
+                cta.write( addr);
+
+        for ( Addr addr = 0; addr < 256; addr += LINE_SIZE)
+            ASSERT_TRUE( cta.lookup( addr)) << policy;
+    }
+}
+
+TEST( memory_hierarchy, Load_Misses_And_Hits)
+{
+    MemoryHierarchy hierarchy( std::make_unique<CacheLevel>( 256, 2, 64, 2_Lt), nullptr, 30_Lt, 2);
+
+    // L1 hit takes one cycle more than memory stage
+    ASSERT_EQ( hierarchy.access( 0x1000, false, 10_Cl), 31_Lt);
+    ASSERT_EQ( hierarchy.access( 0x1004, false, 11_Cl), 1_Lt);
+    ASSERT_EQ( hierarchy.get_stall_cycles(), 32_Lt);
+    ASSERT_EQ( hierarchy.get_l1().get_hits(), 1u);
+    ASSERT_EQ( hierarchy.get_l1().get_misses(), 1u);
+}
+
+TEST( memory_hierarchy, Store_Misses_Use_MSHRs)
+{
+    MemoryHierarchy hierarchy( std::make_unique<CacheLevel>( 256, 2, 64, 1_Lt), nullptr, 30_Lt, 2);
+
+    // store misses do not stop the pipeline while there are free MSHRs
+    ASSERT_EQ( hierarchy.access( 0x1000, true, 0_Cl), 0_Lt);
+    ASSERT_EQ( hierarchy.access( 0x2040, true, 1_Cl), 0_Lt);
+
+    // the third one waits for the first fill
+    ASSERT_EQ( hierarchy.access( 0x3000, true, 2_Cl), 28_Lt);
+
+    // load waits for the line being filled
+    ASSERT_EQ( hierarchy.access( 0x3008, false, 3_Cl), 29_Lt);
+
+    // filled line is hit
+    ASSERT_EQ( hierarchy.access( 0x2048, false, 4_Cl), 0_Lt);
+    ASSERT_EQ( hierarchy.get_l1().get_misses(), 3u);
+}
+
+TEST( memory_hierarchy, Dirty_Lines_Are_Written_Back)
+{
+    MemoryHierarchy hierarchy( std::make_unique<CacheLevel>( 128, 1, 64, 1_Lt),
+                               std::make_unique<CacheLevel>( 1024, 4, 64, 10_Lt),
+                               30_Lt, 0);
+
+    // blocking store miss goes to memory through L2
+    ASSERT_EQ( hierarchy.access( 0x1000, true, 0_Cl), 40_Lt);
+
+    // conflicting load evicts the dirty line to L2
+    ASSERT_EQ( hierarchy.access( 0x1080, false, 1_Cl), 40_Lt);
+    ASSERT_EQ( hierarchy.get_l1().get_writebacks(), 1u);
+
+    // and it is hit in L2 then
+    ASSERT_EQ( hierarchy.access( 0x1000, false, 2_Cl), 10_Lt);
+    ASSERT_EQ( hierarchy.get_l2()->get_hits(), 2u);
+    ASSERT_EQ( hierarchy.get_l2()->get_misses(), 2u);
+
+    // warm-up is not timed and not counted
+    hierarchy.warm_up( 0x4000, false);
+    ASSERT_EQ( hierarchy.get_l1().get_misses(), 3u);
+    ASSERT_EQ( hierarchy.access( 0x4000, false, 3_Cl), 0_Lt);
+}
+
+TEST( prefetcher, Stride_Is_Predicted_After_Repeat)
+{
+    const auto stride = DataPrefetcher::create( "stride", 64, 2, 1, 16);
+    std::vector<Addr> lines;
+    stride->train( 0x400, 0x1000, true, &lines);
+    stride->train( 0x400, 0x1100, true, &lines);
+    ASSERT_TRUE( lines.empty());
+
+    // the same stride is predicted for the next two accesses
+    stride->train( 0x400, 0x1200, false, &lines);
+    ASSERT_EQ( lines, ( std::vector<Addr>{ 0x1300, 0x1400}));
+
+    // short strides prefetch the next lines, other PCs are tracked separately
+    lines.clear();
+    for ( Addr addr = 0x2000; addr <= 0x2008; addr += 4)
+        stride->train( 0x404, addr, false, &lines);
+    ASSERT_EQ( lines, ( std::vector<Addr>{ 0x2040, 0x2080}));
+
+    // a single mismatch keeps the confirmed stride
+    stride->train( 0x400, 0x1300, false, &lines);
+    lines.clear();
+    stride->train( 0x400, 0x5000, false, &lines);
+    ASSERT_EQ( lines, ( std::vector<Addr>{ 0x5100, 0x5200}));
+    lines.clear();
+    stride->train( 0x400, 0x7000, false, &lines);
+    ASSERT_TRUE( lines.empty());
+}
+
+TEST( prefetcher, Stream_Is_Detected_By_Triggers)
+{
+    const auto stream = DataPrefetcher::create( "stream", 64, 2, 1, 4);
+    std::vector<Addr> lines;
+    stream->train( 0x400, 0x1000, true, &lines);
+    stream->train( 0x404, 0x1010, false, &lines);
+    ASSERT_TRUE( lines.empty());
+
+    // the second miss sets the direction
+    stream->train( 0x408, 0x1040, true, &lines);
+    ASSERT_EQ( lines, ( std::vector<Addr>{ 0x1080, 0x10c0}));
+
+    // descending stream far from the first one
+    lines.clear();
+    stream->train( 0x400, 0x9000, true, &lines);
+    stream->train( 0x400, 0x8fc0, true, &lines);
+    ASSERT_EQ( lines, ( std::vector<Addr>{ 0x8f80, 0x8f40}));
+}
+
+TEST( prefetcher, Invalid_Parameters)
+{
+    ASSERT_EXIT( DataPrefetcher::create( "markov", 64, 1, 1, 16), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( DataPrefetcher::create( "stride", 64, 0, 1, 16), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( DataPrefetcher::create( "stream", 64, 1, 1, 0), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+
+    MemoryHierarchy blocking( std::make_unique<CacheLevel>( 256, 2, 64, 1_Lt), nullptr, 30_Lt, 0);
+    ASSERT_EXIT( blocking.set_prefetcher( DataPrefetcher::create( "stream", 64, 1, 1, 4)), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( memory_hierarchy, Prefetches_Use_Free_MSHRs)
+{
+    MemoryHierarchy hierarchy( std::make_unique<CacheLevel>( 1024, 4, 64, 1_Lt), nullptr, 30_Lt, 2);
+    hierarchy.set_prefetcher( DataPrefetcher::create( "stream", 64, 2, 1, 4));
+
+    // two misses start the stream, the next two lines are prefetched
+    ASSERT_EQ( hierarchy.access( 0x1000, false, 0_Cl), 30_Lt);
+    hierarchy.train_prefetcher( 0x400, 0x1000, 0_Cl);
+    ASSERT_EQ( hierarchy.access( 0x1040, false, 1_Cl), 30_Lt);
+    hierarchy.train_prefetcher( 0x400, 0x1040, 1_Cl);
+    ASSERT_EQ( hierarchy.get_prefetches(), 2u);
+
+    // the load of the first prefetched line waits for its fill, the second one is ready later
+    ASSERT_EQ( hierarchy.access( 0x1080, false, 2_Cl), 30_Lt);
+    hierarchy.train_prefetcher( 0x400, 0x1080, 2_Cl);
+    ASSERT_EQ( hierarchy.get_useful_prefetches(), 1u);
+    ASSERT_EQ( hierarchy.get_late_prefetches(), 1u);
+    ASSERT_EQ( hierarchy.access( 0x10c0, false, 100_Cl), 0_Lt);
+    ASSERT_EQ( hierarchy.get_useful_prefetches(), 2u);
+    ASSERT_EQ( hierarchy.get_late_prefetches(), 1u);
+
+    // prefetches are not counted as accesses of L1
+    ASSERT_EQ( hierarchy.get_l1().get_misses(), 2u);
+    ASSERT_EQ( hierarchy.get_l1().get_hits(), 2u);
+}
+
+TEST( memory_hierarchy, Demand_Misses_Take_MSHRs_Of_Prefetches)
+{
+    MemoryHierarchy hierarchy( std::make_unique<CacheLevel>( 1024, 4, 64, 1_Lt), nullptr, 30_Lt, 2);
+    hierarchy.set_prefetcher( DataPrefetcher::create( "stride", 64, 2, 1, 4));
+    for ( Addr addr = 0x1000; addr <= 0x1008; addr += 4)
+    {
+        hierarchy.access( addr, false, 0_Cl);
+        hierarchy.train_prefetcher( 0x400, addr, 0_Cl);
+    }
+    ASSERT_EQ( hierarchy.get_prefetches(), 2u);
+
+    // the store miss does not wait for the prefetches, and the dropped line misses
+    const auto stall = hierarchy.get_stall_cycles();
+    ASSERT_EQ( hierarchy.access( 0x8000, true, 1_Cl), 0_Lt);
+    ASSERT_EQ( hierarchy.access( 0x1040, false, 2_Cl) + hierarchy.access( 0x1080, false, 3_Cl), 59_Lt);
+    ASSERT_EQ( hierarchy.get_useful_prefetches(), 1u);
+    ASSERT_EQ( hierarchy.get_stall_cycles(), stall + 59_Lt);
+}
+
+TEST( memory_hierarchy, Misses_Of_Lines_Evicted_By_Prefetches)
+{
+    // direct-mapped cache of two lines
+    MemoryHierarchy hierarchy( std::make_unique<CacheLevel>( 128, 1, 64, 1_Lt), nullptr, 30_Lt, 2);
+    hierarchy.set_prefetcher( DataPrefetcher::create( "stream", 64, 1, 1, 4));
+    hierarchy.access( 0x1000, false, 0_Cl);
+    hierarchy.train_prefetcher( 0x400, 0x1000, 0_Cl);
+    hierarchy.access( 0x1040, false, 1_Cl);
+    hierarchy.train_prefetcher( 0x400, 0x1040, 1_Cl);
+
+    // prefetch of 0x1080 evicts 0x1000
+    ASSERT_EQ( hierarchy.get_prefetches(), 1u);
+    ASSERT_EQ( hierarchy.get_prefetch_pollution(), 0u);
+    hierarchy.access( 0x1000, false, 100_Cl);
+    ASSERT_EQ( hierarchy.get_prefetch_pollution(), 1u);
+}
+
+TEST( store_buffer, Loads_Are_Forwarded)
+{
+    MemoryHierarchy hierarchy( std::make_unique<CacheLevel>( 256, 2, 64, 1_Lt), nullptr, 30_Lt, 0);
+    StoreBuffer buffer( 2);
+
+    // blocking store miss does not stop the pipeline
+    ASSERT_EQ( buffer.access( &hierarchy, 0x1000, 4, true, 0_Cl), 0_Lt);
+
+    // loads covered by the store being written take its data
+    ASSERT_EQ( buffer.access( &hierarchy, 0x1000, 4, false, 1_Cl), 0_Lt);
+    ASSERT_EQ( buffer.access( &hierarchy, 0x1002, 1, false, 2_Cl), 0_Lt);
+    ASSERT_EQ( buffer.get_forwards(), 2u);
+
+    // partially overlapping load waits for the write, which is done by cycle 31, and misses then
+    ASSERT_EQ( buffer.access( &hierarchy, 0x0ffe, 4, false, 3_Cl), 58_Lt);
+    ASSERT_EQ( buffer.get_partial_forwards(), 1u);
+    ASSERT_EQ( buffer.size(), 0u);
+    ASSERT_EQ( hierarchy.get_stall_cycles(), 58_Lt);
+
+    // other loads do not wait for stores
+    ASSERT_EQ( buffer.access( &hierarchy, 0x2000, 4, true, 4_Cl), 0_Lt);
+    ASSERT_EQ( buffer.access( &hierarchy, 0x1004, 4, false, 5_Cl), 0_Lt);
+    ASSERT_EQ( buffer.size(), 1u);
+    ASSERT_EQ( buffer.get_full_stalls(), 0u);
+}
+
+TEST( store_buffer, Full_Buffer_Stalls)
+{
+    MemoryHierarchy hierarchy( std::make_unique<CacheLevel>( 256, 2, 64, 1_Lt), nullptr, 30_Lt, 0);
+    StoreBuffer buffer( 2);
+
+    ASSERT_EQ( buffer.access( &hierarchy, 0x1000, 4, true, 0_Cl), 0_Lt);
+    ASSERT_EQ( buffer.access( &hierarchy, 0x1040, 4, true, 1_Cl), 0_Lt);
+
+    // the first store is written by cycle 31
+    ASSERT_EQ( buffer.access( &hierarchy, 0x1080, 4, true, 2_Cl), 29_Lt);
+    ASSERT_EQ( buffer.get_full_stalls(), 1u);
+    ASSERT_EQ( buffer.get_full_stall_cycles(), 29u);
+    ASSERT_EQ( hierarchy.get_stall_cycles(), 29_Lt);
+
+    // hits are written in a cycle each, so the buffer is drained by the time
+    ASSERT_EQ( buffer.access( &hierarchy, 0x2000, 4, false, 200_Cl), 30_Lt);
+    ASSERT_EQ( buffer.size(), 0u);
+    for ( uint32 i = 0; i < 4; ++i)
+        ASSERT_EQ( buffer.access( &hierarchy, 0x2000 + 4 * i, 4, true, Cycle( 300 + 2 * i)), 0_Lt);
+    ASSERT_EQ( buffer.get_full_stalls(), 1u);
+}
+
+TEST( coherence, Writes_Invalidate_Shared_Copies)
+{
+    CoherenceDirectory directory( 10_Lt);
+    MemoryHierarchy first( std::make_unique<CacheLevel>( 256, 2, 64, 1_Lt),
+                           std::make_unique<CacheLevel>( 1024, 4, 64, 10_Lt), 30_Lt, 0);
+    MemoryHierarchy second( std::make_unique<CacheLevel>( 256, 2, 64, 1_Lt), nullptr, 30_Lt, 0);
+    first.connect( &directory);
+    second.connect( &directory);
+
+    // L2 cache of the first hierarchy is shared
+    ASSERT_EQ( second.get_l2(), first.get_l2());
+
+    // both caches read the line from L2 and memory
+    ASSERT_EQ( first.access( 0x1000, false, 0_Cl), 40_Lt);
+    ASSERT_EQ( second.access( 0x1000, false, 0_Cl), 10_Lt);
+
+    // write of the shared line invalidates the other copy
+    ASSERT_EQ( first.access( 0x1000, true, 1_Cl), 10_Lt);
+    ASSERT_EQ( directory.get_invalidations(), 1u);
+
+    // modified line is written back to L2 for the other cache
+    ASSERT_EQ( second.access( 0x1004, false, 2_Cl), 20_Lt);
+    ASSERT_EQ( directory.get_interventions(), 1u);
+    ASSERT_EQ( second.get_l1().get_misses(), 2u);
+
+    // both copies are shared again, so reads hit them
+    ASSERT_EQ( first.access( 0x1008, false, 3_Cl), 0_Lt);
+    ASSERT_EQ( second.access( 0x1008, false, 3_Cl), 0_Lt);
+
+    // modified line is written without coherence actions
+    ASSERT_EQ( second.access( 0x1000, true, 4_Cl), 10_Lt);
+    ASSERT_EQ( second.access( 0x1000, true, 5_Cl), 0_Lt);
+}
+
+TEST( coherence, Evicted_Lines_Are_Not_Invalidated)
+{
+    CoherenceDirectory directory( 10_Lt);
+    MemoryHierarchy first( std::make_unique<CacheLevel>( 128, 1, 64, 1_Lt), nullptr, 30_Lt, 0);
+    MemoryHierarchy second( std::make_unique<CacheLevel>( 128, 1, 64, 1_Lt), nullptr, 30_Lt, 0);
+    first.connect( &directory);
+    second.connect( &directory);
+
+    first.access( 0x1000, false, 0_Cl);
+    // conflicting line replaces the copy of the first cache
+    first.access( 0x1080, false, 1_Cl);
+
+    ASSERT_EQ( second.access( 0x1000, true, 2_Cl), 30_Lt);
+    ASSERT_EQ( directory.get_invalidations(), 0u);
+}
+
 int main( int argc, char** argv)
 {
     ::testing::InitGoogleTest( &argc, argv);
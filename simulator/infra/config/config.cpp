@@ -3,7 +3,10 @@
  * Copyright 2017-2018 MIPT-MIPS
  */
 
+#include <algorithm>
+
 /* Boost */
+#include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
 
 #include <infra/ports/timing.h>
@@ -15,6 +18,50 @@ namespace config {
 
 namespace po = boost::program_options;
 
+static std::map<const BaseValue*, std::any>& local_values()
+{
+    thread_local std::map<const BaseValue*, std::any> instance;
+    return instance;
+}
+
+const std::any* BaseValue::find_local() const
+{
+    const auto& values = local_values();
+    if ( values.empty())
+        return nullptr;
+
+    const auto it = values.find( this);
+    return it == values.end() ? nullptr : &it->second;
+}
+
+void BaseValue::set_local_value( std::any&& local)
+{
+    local_values()[ this] = std::move( local);
+}
+
+template<>
+void RequiredValue<bool>::set_local( const std::string& str)
+{
+    if ( str != "true" && str != "false" && str != "1" && str != "0")
+    {
+        std::cerr << "ERROR. Invalid value " << str << " of option " << name << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    set_local_value( str == "true" || str == "1");
+}
+
+template<typename T>
+void RequiredValue<T>::set_local( const std::string& str)
+{
+    try {
+        set_local_value( boost::lexical_cast<T>( str));
+    }
+    catch ( const boost::bad_lexical_cast&) {
+        std::cerr << "ERROR. Invalid value " << str << " of option " << name << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+}
+
 template<>
 void RequiredValue<bool>::reg(bod* d)
 {
@@ -47,18 +94,53 @@ void Value<T>::reg(bod* d)
                 this->desc.c_str());
 }
 
+template class RequiredValue<bool>;
 template class RequiredValue<std::string>;
 template class RequiredValue<uint64>;
 template class RequiredValue<uint32>;
 template class RequiredValue<int32>;
 template class RequiredValue<Latency>;
 template class RequiredValue<Cycle>;
+template class RequiredValue<double>;
 template class Value<std::string>;
 template class Value<uint64>;
 template class Value<uint32>;
 template class Value<int32>;
 template class Value<Latency>;
 template class Value<Cycle>;
+template class Value<double>;
+
+LocalValues::LocalValues( const std::map<std::string, std::string>& values)
+{
+    for ( const auto& value : values)
+    {
+        // options are registered with their short aliases, like "binary,b"
+        const auto it = std::find_if( BaseValue::values().begin(), BaseValue::values().end(),
+            [&value]( const auto& option) { return option.first.substr( 0, option.first.find( ',')) == value.first; });
+
+        if ( it == BaseValue::values().end())
+        {
+            std::cerr << "ERROR. Unknown option " << value.first << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+
+        const auto* previous = it->second->find_local();
+        saved.emplace_back( it->second, previous == nullptr ? std::nullopt : std::optional<std::any>( *previous));
+        it->second->set_local( value.second);
+    }
+}
+
+LocalValues::~LocalValues()
+{
+    auto& values = local_values();
+    for ( auto it = saved.rbegin(); it != saved.rend(); ++it)
+    {
+        if ( it->second.has_value())
+            values[ it->first] = std::move( *it->second);
+        else
+            values.erase( it->first);
+    }
+}
 
 /* basic method */
 void handleArgs( int argc, const char* argv[])
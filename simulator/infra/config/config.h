@@ -6,10 +6,13 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <any>
 #include <cstdlib>
 #include <iostream>
 #include <string>
 #include <map>
+#include <optional>
+#include <vector>
 
 #include <infra/types.h>
 
@@ -26,8 +29,12 @@ using bod = boost::program_options::options_description;
 class BaseValue
 {
     friend void handleArgs( int argc, const char* argv[]);
+    friend class LocalValues;
     virtual void reg( bod* d) = 0;
 
+    // Parses the string and sets it as value of the current thread
+    virtual void set_local( const std::string& str) = 0;
+
     static std::map<std::string, BaseValue*>& values() {
         static std::map<std::string, BaseValue*> instance;
         return instance;
@@ -47,6 +54,10 @@ protected:
         values()[name] = this;
     }
     virtual ~BaseValue() = default;
+
+    // Returns value set for the current thread or nullptr
+    const std::any* find_local() const;
+    void set_local_value( std::any&& local);
 public:
     // Do not move or copy
     BaseValue( const BaseValue&) = delete;
@@ -61,6 +72,7 @@ protected:
     T value;
 
     void reg( bod* d) override;
+    void set_local( const std::string& str) final;
 public:
     RequiredValue<T>( const char* name, const char* desc) noexcept
         : BaseValue( name, desc)
@@ -70,11 +82,14 @@ public:
     RequiredValue<T>() = delete;
 
     // NOLINTNEXTLINE(hicpp-explicit-conversions)
-    operator const T&() const { return value; }
-    
+    operator const T&() const {
+        const auto local = find_local();
+        return local == nullptr ? value : *std::any_cast<T>( local);
+    }
+
     friend std::ostream& operator<<( std::ostream& out, const RequiredValue& rhs)
     {
-        return out << rhs.value;
+        return out << static_cast<const T&>( rhs);
     }
 };
 
@@ -92,6 +107,27 @@ public:
     Value<T>() = delete;
 };
 
+// Overrides values of options in the current thread while the object exists,
+// so simulators running in different threads may be configured differently.
+// Objects may be nested, the destructor restores the values of an enclosing one
+class LocalValues
+{
+public:
+    // Option names go without short aliases, values are parsed like arguments
+    explicit LocalValues( const std::map<std::string, std::string>& values);
+    ~LocalValues();
+
+    // Do not move or copy
+    LocalValues( const LocalValues&) = delete;
+    LocalValues( LocalValues&&) = delete;
+    LocalValues& operator=( const LocalValues&) = delete;
+    LocalValues& operator=( LocalValues&&) = delete;
+
+private:
+    // Local values which were set before, empty if option was not overridden
+    std::vector<std::pair<const BaseValue*, std::optional<std::any>>> saved;
+};
+
 /* methods */
 void handleArgs( int argc, const char* argv[]);
 
@@ -12,6 +12,8 @@
 // Utils
 #include "infra/macro.h"
 
+#include <thread>
+
 namespace config {
     RequiredValue<std::string> string_config = { "string_config_name,b", "string config description"};
     RequiredValue<uint64> uint64_config = { "uint64_config_name,n", "uint64 config description"};
@@ -224,6 +226,80 @@ TEST( config_provide_options, Provide_Config_Parser_With_Binary_Option_Twice)
     ASSERT_EXIT( test_function(), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
 }
 
+//
+// To check that local values are visible only in their thread
+//
+TEST( config_local_values, Override_Values_In_Thread)
+{
+    using Values = std::map<std::string, std::string>;
+
+    const char* argv[] =
+    {
+        "mipt-mips",
+        "-b", "test.elf",
+        "-n", "100"
+    };
+    const int argc = countof(argv);
+    ASSERT_NO_THROW( config::handleArgs( argc, argv));
+
+    uint64 thread_value = 0;
+    bool thread_bool = false;
+    std::thread thread( [&]() {
+        config::LocalValues local( Values{ { "uint64_config_name", "200"}, { "bool_config_1", "true"}});
+        thread_value = config::uint64_config;
+        thread_bool = config::bool_config_1;
+    });
+    thread.join();
+
+    ASSERT_EQ( thread_value, 200u);
+    ASSERT_TRUE( thread_bool);
+    ASSERT_EQ( config::uint64_config, 100u);
+    ASSERT_FALSE( config::bool_config_1);
+
+    {
+        config::LocalValues local( Values{ { "string_config_name", "local.elf"}});
+        ASSERT_EQ( static_cast<const std::string&>( config::string_config), "local.elf");
+    }
+    ASSERT_EQ( static_cast<const std::string&>( config::string_config), "test.elf");
+
+    ASSERT_EXIT( config::LocalValues( Values{ { "unknown_config_name", "1"}}),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( config::LocalValues( Values{ { "uint64_config_name", "many"}}),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+//
+// To check that inner local values restore the outer ones
+//
+TEST( config_local_values, Nested_Scopes)
+{
+    using Values = std::map<std::string, std::string>;
+
+    const char* argv[] =
+    {
+        "mipt-mips",
+        "-b", "test.elf",
+        "-n", "100"
+    };
+    const int argc = countof(argv);
+    ASSERT_NO_THROW( config::handleArgs( argc, argv));
+
+    {
+        config::LocalValues outer( Values{ { "uint64_config_name", "200"}, { "string_config_name", "outer.elf"}});
+        {
+            config::LocalValues inner( Values{ { "uint64_config_name", "300"}, { "bool_config_1", "true"}});
+            ASSERT_EQ( config::uint64_config, 300u);
+            ASSERT_TRUE( config::bool_config_1);
+            ASSERT_EQ( static_cast<const std::string&>( config::string_config), "outer.elf");
+        }
+        ASSERT_EQ( config::uint64_config, 200u);
+        ASSERT_FALSE( config::bool_config_1);
+        ASSERT_EQ( static_cast<const std::string&>( config::string_config), "outer.elf");
+    }
+    ASSERT_EQ( config::uint64_config, 100u);
+    ASSERT_EQ( static_cast<const std::string&>( config::string_config), "test.elf");
+}
+
 int main( int argc, char** argv)
 {
     ::testing::InitGoogleTest( &argc, argv);
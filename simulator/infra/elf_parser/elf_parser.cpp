@@ -12,9 +12,12 @@
 #include <cassert>
 
 // Generic C++
+#include <algorithm>
+
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <mutex>
 
 // LibELF
 #include <libelf.h>
@@ -31,6 +34,41 @@ ElfSection::ElfSection( const ElfSection& that)
 
 std::list<ElfSection> ElfSection::getAllElfSections( const std::string& elf_file_name)
 {
+    const auto extents = getAllElfSectionExtents( elf_file_name);
+    if ( extents.empty())
+        return {};
+
+    std::unique_ptr<FILE, decltype(&fclose)> file( fopen( elf_file_name.c_str(), "rb"), fclose);
+    if ( file == nullptr)
+    {
+        std::cerr << "ERROR: Could not open file " << elf_file_name << ": "
+                  << std::strerror( errno) << std::endl;
+        return {};
+    }
+
+    std::list<ElfSection> sections;
+    for ( const auto& extent : extents)
+    {
+        auto content = std::make_unique<uint8[]>( extent.size);
+
+        fseek( file.get(), static_cast<long>( extent.file_offset), SEEK_SET);
+
+        // fill the content by the section data
+        ignored( std::fread( content.get(), sizeof( uint8), extent.size, file.get()));
+        sections.emplace( sections.end(), extent.name, extent.start_addr, extent.size, std::move(content));
+    }
+
+    return sections;
+}
+
+// opens the binary as ELF file and passes it to the reader, returns false on failure
+template<typename Reader>
+static bool read_elf( const std::string& elf_file_name, Reader reader)
+{
+    // libelf keeps global state, so simulators of different threads load binaries in turn
+    static std::mutex libelf_mutex;
+    std::lock_guard<std::mutex> lock( libelf_mutex);
+
     // open the binary file, we have to use C-style open,
     // because it is required by elf_begin function
     std::unique_ptr<FILE, decltype(&fclose)> file( fopen( elf_file_name.c_str(), "rb"), fclose);
@@ -38,7 +76,7 @@ std::list<ElfSection> ElfSection::getAllElfSections( const std::string& elf_file
     {
         std::cerr << "ERROR: Could not open file " << elf_file_name << ": "
                   << std::strerror( errno) << std::endl;
-        return {};
+        return false;
     }
 
     // set ELF library operating version
@@ -46,7 +84,7 @@ std::list<ElfSection> ElfSection::getAllElfSections( const std::string& elf_file
     {
         std::cerr << "ERROR: Could not set ELF library operating version:"
                   <<  elf_errmsg( elf_errno()) << std::endl;
-        return {};
+        return false;
     }
 
     // open the file in ELF format
@@ -56,42 +94,82 @@ std::list<ElfSection> ElfSection::getAllElfSections( const std::string& elf_file
         std::cerr << "ERROR: Could not open file " << elf_file_name
                   << " as ELF file: "
                   <<  elf_errmsg( elf_errno()) << std::endl;
-        return {};
+        return false;
     }
 
-    size_t shstrndx;
-    elf_getshdrstrndx( elf, &shstrndx);
-
-    std::list<ElfSection> sections;
+    reader( elf);
 
-    Elf_Scn *section = nullptr;
-    while ( (section = elf_nextscn( elf, section)) != nullptr)
-    {
-        Elf32_Shdr shdr = *elf32_getshdr( section);
+    // close all used files
+    elf_end( elf);
 
-        char* name = elf_strptr( elf, shstrndx, shdr.sh_name);
-        Addr start_addr = shdr.sh_addr;
+    return true;
+}
 
-        if ( start_addr == 0)
-            continue;
+std::vector<ElfSectionExtent> ElfSection::getAllElfSectionExtents( const std::string& elf_file_name)
+{
+    std::vector<ElfSectionExtent> sections;
+    read_elf( elf_file_name, [&sections]( Elf* elf) {
+        size_t shstrndx;
+        elf_getshdrstrndx( elf, &shstrndx);
 
-        size_t size = shdr.sh_size;
-        auto offset = shdr.sh_offset;
-        auto content = std::make_unique<uint8[]>( size);
+        Elf_Scn *section = nullptr;
+        while ( (section = elf_nextscn( elf, section)) != nullptr)
+        {
+            Elf32_Shdr shdr = *elf32_getshdr( section);
 
-        fseek( file.get(), offset, SEEK_SET);
+            char* name = elf_strptr( elf, shstrndx, shdr.sh_name);
+            Addr start_addr = shdr.sh_addr;
 
-        // fill the content by the section data
-        ignored( std::fread( content.get(), sizeof( uint8), size, file.get()));
-        sections.emplace( sections.end(), name, start_addr, size, std::move(content));
-    }
+            if ( start_addr == 0)
+                continue;
 
-    // close all used files
-    elf_end( elf);
+            sections.push_back( { name, start_addr, shdr.sh_size, shdr.sh_offset});
+        }
+    });
 
     return sections;
 }
 
+std::vector<ElfSymbol> ElfSection::getAllElfSymbols( const std::string& elf_file_name)
+{
+    std::vector<ElfSymbol> symbols;
+    read_elf( elf_file_name, [&symbols]( Elf* elf) {
+        // sections are numbered from one
+        std::vector<bool> is_code( 1, false);
+        Elf_Scn *section = nullptr;
+        while ( (section = elf_nextscn( elf, section)) != nullptr)
+            is_code.push_back( ( elf32_getshdr( section)->sh_flags & SHF_EXECINSTR) != 0);
+
+        while ( (section = elf_nextscn( elf, section)) != nullptr)
+        {
+            Elf32_Shdr shdr = *elf32_getshdr( section);
+            Elf_Data* data = elf_getdata( section, nullptr);
+            if ( shdr.sh_type != SHT_SYMTAB || data == nullptr)
+                continue;
+
+            const auto* entries = static_cast<const Elf32_Sym*>( data->d_buf);
+            for ( size_t i = 0; i < data->d_size / sizeof( Elf32_Sym); ++i)
+            {
+                const auto& entry = entries[ i];
+                const auto type = ELF32_ST_TYPE( entry.st_info);
+
+                // sections, files and data objects are not code, undefined and absolute symbols have no code
+                if ( ( type != STT_FUNC && type != STT_NOTYPE) || entry.st_shndx >= is_code.size() || !is_code[ entry.st_shndx])
+                    continue;
+
+                const char* name = elf_strptr( elf, shdr.sh_link, entry.st_name);
+                if ( name != nullptr && *name != '\0')
+                    symbols.push_back( { name, entry.st_value, entry.st_size});
+            }
+        }
+    });
+
+    std::stable_sort( symbols.begin(), symbols.end(), []( const auto& lhs, const auto& rhs) {
+        return lhs.start_addr < rhs.start_addr;
+    });
+    return symbols;
+}
+
 std::string ElfSection::dump( const std::string& indent) const
 {
     std::ostringstream oss;
@@ -12,10 +12,28 @@
 #include <string>
 #include <list>
 #include <memory>
+#include <vector>
 
 // uArchSim modules
 #include <infra/types.h>
 
+// placement of a section in the file, so its content can be read on demand
+struct ElfSectionExtent
+{
+    std::string name;
+    Addr start_addr = 0;
+    size_t size = 0;
+    size_t file_offset = 0;
+};
+
+// function or label of the symbol table, the size is zero for labels
+struct ElfSymbol
+{
+    std::string name;
+    Addr start_addr = 0;
+    size_t size = 0;
+};
+
 class ElfSection
 {
     const std::string name; // name of the elf section (e.g. ".text", ".data", etc)
@@ -39,6 +57,12 @@ public:
     // Use this function to extract all sections from the ELF binary file.
     static std::list<ElfSection> getAllElfSections( const std::string& elf_file_name);
 
+    // Returns placement of the sections without reading their contents.
+    static std::vector<ElfSectionExtent> getAllElfSectionExtents( const std::string& elf_file_name);
+
+    // Returns symbols of functions and labels in code sections sorted by their addresses.
+    static std::vector<ElfSymbol> getAllElfSymbols( const std::string& elf_file_name);
+
     std::string dump( const std::string& indent) const;
     std::string strByBytes() const;
     std::string strByWords() const;
@@ -47,6 +71,7 @@ public:
     Addr  get_size()              const { return size; }
     Addr  get_start_addr()        const { return start_addr; }
     uint8 get_byte(size_t offset) const { return content.get()[offset]; }
+    const uint8* get_content()    const { return content.get(); }
 };
 
 #endif // #ifndef ELF_PARSER__ELF_PARSER_H
@@ -26,6 +26,24 @@ TEST( Elf_parser_init, Process_Wrong_Args_Of_Constr)
     ASSERT_TRUE( ElfSection::getAllElfSections( std::string("./1234567890/qwertyuiop")).empty());
 }
 
+TEST( Elf_parser_symbols, Symbols_Of_Functions)
+{
+    const auto symbols = ElfSection::getAllElfSymbols( TEST_PATH "/bench/recursion.out");
+    ASSERT_EQ( symbols.size(), 3);
+    ASSERT_EQ( symbols[ 0].name, "__start");
+    ASSERT_EQ( symbols[ 0].start_addr, 0x400000);
+    ASSERT_EQ( symbols[ 1].name, "fib");
+    ASSERT_EQ( symbols[ 1].start_addr, 0x400018);
+    ASSERT_EQ( symbols[ 2].name, "recurse");
+    ASSERT_EQ( symbols[ 2].start_addr, 0x400028);
+}
+
+TEST( Elf_parser_symbols, No_Symbols)
+{
+    ASSERT_TRUE( ElfSection::getAllElfSymbols( valid_elf_file).empty());
+    ASSERT_TRUE( ElfSection::getAllElfSymbols( std::string("./1234567890/qwertyuiop")).empty());
+}
+
 int main( int argc, char* argv[])
 {
     ::testing::InitGoogleTest( &argc, argv);
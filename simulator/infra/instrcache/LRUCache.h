@@ -8,21 +8,70 @@
 
 #include <cassert>
 
-#include <list>
-#include <unordered_map>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
 #include <utility>
+#include <vector>
 
-template <typename Key, typename Value, size_t CAPACITY>
+#include <infra/types.h>
+
+// Fixed-capacity LRU cache, the capacity is set at construction.
+// All the storage is allocated in the constructor: elements live in
+// a preallocated array of nodes, which are linked into the LRU list
+// by indices, and keys are resolved by an open-addressed hash table
+template <typename Key, typename Value>
 class LRUCache
 {
+        using Index = uint32;
+        static constexpr const Index NO_INDEX = MAX_VAL32;
+
+        static size_t get_table_size( size_t capacity)
+        {
+            // keep load factor of the hash table not greater than 1/2
+            size_t size = 1;
+            while ( size < 2 * capacity)
+                size <<= 1;
+            return size;
+        }
+
+        static size_t check_capacity( size_t capacity)
+        {
+            if ( capacity == 0 || capacity >= NO_INDEX / 2) {
+                std::cerr << "ERROR. LRU cache should have from 1 to " << NO_INDEX / 2 - 1 << " elements, not " << capacity << "\n";
+                std::exit( EXIT_FAILURE);
+            }
+            return capacity;
+        }
+
     public:
-        LRUCache()
+        explicit LRUCache( size_t capacity)
+            : capacity( check_capacity( capacity))
+            , table_size( get_table_size( capacity))
+            , table_mask( table_size - 1)
+            , nodes( capacity)
+            , table( table_size, NO_INDEX)
+        {
+            // chain all the nodes into the free list
+            for ( Index i = 0; i < capacity; ++i)
+                nodes[i].next = i + 1 < capacity ? i + 1 : NO_INDEX;
+            free_head = 0;
+        }
+
+        ~LRUCache()
         {
-            data.reserve( CAPACITY);
-            lru_hash.reserve( CAPACITY);
+            for ( Index i = lru_head; i != NO_INDEX; i = nodes[i].next)
+                nodes[i].destroy_value();
         }
 
-        static auto get_capacity() { return CAPACITY; }
+        // Rule of five
+        LRUCache( const LRUCache&) = delete;
+        LRUCache( LRUCache&&) = delete;
+        LRUCache& operator=( const LRUCache&) = delete;
+        LRUCache& operator=( LRUCache&&) = delete;
+
+        auto get_capacity() const { return capacity; }
 
         auto size() const { return number_of_elements; }
         bool empty() const { return size() == 0; }
@@ -31,70 +80,170 @@ class LRUCache
         // Second return value is dereferenceable only if first value if 'true'
         auto find( const Key& key) const
         {
-            auto result = data.find( key);
-            return std::pair<bool, const Value&>( result != data.end(), result->second);
+            const auto slot = find_slot( key);
+            const Index index = slot == table_size ? 0 : table[ slot];
+            return std::pair<bool, const Value&>( slot != table_size, nodes[ index].value());
         }
 
         void update( const Key& key, const Value& value)
         {
-            auto data_it = data.find( key);
-            auto lru_it  = lru_hash.find( key);
-            assert ( ( data_it == data.end()) == ( lru_it == lru_hash.end()));
-            if ( data_it == data.end())
+            const auto slot = find_slot( key);
+            if ( slot == table_size)
             {
                 allocate( key, value);
             }
             else
             {
-                assert( data_it->second.is_same( value));
-                lru_list.splice( lru_list.begin(), lru_list, lru_it->second);
+                const Index index = table[ slot];
+                assert( nodes[ index].value().is_same( value));
+                unlink( index);
+                link_front( index);
             }
         }
 
         void erase( const Key& key)
         {
-            auto data_it = data.find( key);
-            auto lru_it  = lru_hash.find( key);
-            assert ( ( data_it == data.end()) == ( lru_it == lru_hash.end()));
-            if ( data_it != data.end())
+            const auto slot = find_slot( key);
+            if ( slot != table_size)
             {
                 assert( !empty());
-                data.erase( data_it);
-                lru_list.erase( lru_it->second);
-                lru_hash.erase( lru_it);
+                const Index index = table[ slot];
+                erase_slot( slot);
+                unlink( index);
+                release( index);
 
                 number_of_elements--;
             }
         }
 
     private:
+        struct Node
+        {
+            Key key = {};
+            Index prev = NO_INDEX;
+            Index next = NO_INDEX; // next in LRU list or in free list
+            alignas( Value) unsigned char storage[ sizeof( Value)];
+
+            Node() = default; // NOLINT(cppcoreguidelines-pro-type-member-init) Storage is raw memory
+
+            const Value& value() const { return *std::launder( reinterpret_cast<const Value*>( storage)); }
+            void construct_value( const Value& v) { new ( storage) Value( v); }
+            void destroy_value() { std::launder( reinterpret_cast<Value*>( storage))->~Value(); }
+        };
+
+        size_t get_home_slot( const Key& key) const
+        {
+            // Fibonacci hashing spreads aligned keys like PCs over the table
+            const uint64 hash = static_cast<uint64>( std::hash<Key>()( key)) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>( hash >> 32) & table_mask;
+        }
+
+        // returns slot of the key or table_size if there is no such key
+        size_t find_slot( const Key& key) const
+        {
+            for ( size_t slot = get_home_slot( key); ; slot = ( slot + 1) & table_mask)
+            {
+                const Index index = table[ slot];
+                if ( index == NO_INDEX)
+                    return table_size;
+                if ( nodes[ index].key == key)
+                    return slot;
+            }
+        }
+
+        void insert_slot( const Key& key, Index index)
+        {
+            size_t slot = get_home_slot( key);
+            while ( table[ slot] != NO_INDEX)
+                slot = ( slot + 1) & table_mask;
+            table[ slot] = index;
+        }
+
+        // backward shift deletion keeps probe sequences without tombstones
+        void erase_slot( size_t hole)
+        {
+            for ( size_t slot = ( hole + 1) & table_mask; table[ slot] != NO_INDEX; slot = ( slot + 1) & table_mask)
+            {
+                const size_t home = get_home_slot( nodes[ table[ slot]].key);
+                if ( ( ( slot - home) & table_mask) >= ( ( slot - hole) & table_mask))
+                {
+                    table[ hole] = table[ slot];
+                    hole = slot;
+                }
+            }
+            table[ hole] = NO_INDEX;
+        }
+
+        void unlink( Index index)
+        {
+            auto& node = nodes[ index];
+            if ( node.prev != NO_INDEX)
+                nodes[ node.prev].next = node.next;
+            else
+                lru_head = node.next;
+
+            if ( node.next != NO_INDEX)
+                nodes[ node.next].prev = node.prev;
+            else
+                lru_tail = node.prev;
+        }
+
+        void link_front( Index index)
+        {
+            auto& node = nodes[ index];
+            node.prev = NO_INDEX;
+            node.next = lru_head;
+            if ( lru_head != NO_INDEX)
+                nodes[ lru_head].prev = index;
+            else
+                lru_tail = index;
+            lru_head = index;
+        }
+
+        void release( Index index)
+        {
+            nodes[ index].destroy_value();
+            nodes[ index].next = free_head;
+            free_head = index;
+        }
+
         void allocate( const Key& key, const Value& value)
         {
-            if ( number_of_elements == CAPACITY)
+            if ( number_of_elements == capacity)
             {
                 // Delete least recently used element
-                const auto& lru_elem = lru_list.back();
-                lru_hash.erase( lru_elem);
-                data.erase( lru_elem);
-                lru_list.pop_back();
+                const Index lru_elem = lru_tail;
+                erase_slot( find_slot( nodes[ lru_elem].key));
+                unlink( lru_elem);
+                release( lru_elem);
             }
             else {
                  number_of_elements++;
             }
             // Add a new element
-            data.emplace( key, value);
-            auto ptr = lru_list.insert( lru_list.begin(), key);
-            lru_hash.emplace( key, ptr);
+            const Index index = free_head;
+            free_head = nodes[ index].next;
+
+            auto& node = nodes[ index];
+            node.key = key;
+            node.construct_value( value);
+            link_front( index);
+            insert_slot( key, index);
         }
 
-        std::unordered_map<Key, Value> data{};
+        const size_t capacity;
+        const size_t table_size;
+        const size_t table_mask;
+
+        std::vector<Node> nodes;
+        std::vector<Index> table;
 
-        std::list<Key> lru_list{};
-        std::unordered_map<Key, typename std::list<Key>::const_iterator> lru_hash{};
+        Index lru_head = NO_INDEX; // most recently used
+        Index lru_tail = NO_INDEX; // least recently used
+        Index free_head = NO_INDEX;
 
         std::size_t number_of_elements = 0u;
 };
 
 
 #endif // LRUCACHE_H
-
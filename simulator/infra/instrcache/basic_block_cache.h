@@ -0,0 +1,86 @@
+/**
+ * basic_block_cache.h - cache of decoded straight-line code sequences
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef BASIC_BLOCK_CACHE_H
+#define BASIC_BLOCK_CACHE_H
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <infra/types.h>
+
+#ifndef BASIC_BLOCK_CACHE_CAPACITY
+#define BASIC_BLOCK_CACHE_CAPACITY 4096
+#endif
+
+// Basic block is a sequence of decoded instructions which ends
+// with the first control flow instruction, so if the first instruction
+// of a block is executed, all the others are executed in order as well.
+template<typename Instr>
+class BasicBlockCache
+{
+    public:
+        using Block = std::vector<Instr>;
+
+        static constexpr const size_t MAX_BLOCK_SIZE = 64;
+
+        // returns nullptr if there is no block starting at PC
+        const Block* find( Addr PC) const
+        {
+            const auto it = blocks.find( PC);
+            return it == blocks.end() ? nullptr : &it->second;
+        }
+
+        const Block& insert( Addr PC, Block&& block)
+        {
+            // flush everything on overflow, the blocks will be decoded again
+            if ( blocks.size() >= BASIC_BLOCK_CACHE_CAPACITY)
+                flush();
+
+            const Addr last_PC = block.back().get_PC();
+            for ( Addr page = get_code_page( PC); page <= get_code_page( last_PC); ++page)
+                pages[ page].push_back( PC);
+
+            return blocks.emplace( PC, std::move( block)).first->second;
+        }
+
+        // drop all the blocks which may contain the written address.
+        // References to dropped blocks become invalid,
+        // users should check get_generation() to detect that
+        void invalidate( Addr addr)
+        {
+            const auto it = pages.find( get_code_page( addr));
+            if ( it == pages.end())
+                return;
+
+            for ( const auto& PC : it->second)
+                blocks.erase( PC);
+
+            pages.erase( it);
+            ++generation;
+        }
+
+        void flush()
+        {
+            blocks.clear();
+            pages.clear();
+            ++generation;
+        }
+
+        auto size() const { return blocks.size(); }
+        auto get_generation() const { return generation; }
+
+    private:
+        // blocks are invalidated with code page granularity
+        static constexpr const uint32 CODE_PAGE_BITS = 12;
+        static Addr get_code_page( Addr addr) { return addr >> CODE_PAGE_BITS; }
+
+        std::unordered_map<Addr, Block> blocks = {};
+        std::unordered_map<Addr, std::vector<Addr>> pages = {};
+        uint64 generation = 0;
+};
+
+#endif // BASIC_BLOCK_CACHE_H
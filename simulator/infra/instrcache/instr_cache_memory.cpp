@@ -0,0 +1,17 @@
+/**
+ * instr_cache_memory.cpp - configuration of the cache for decoded instructions
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <infra/config/config.h>
+
+#include "instr_cache_memory.h"
+
+namespace config {
+    static Value<uint32> instr_cache_size = { "instr-cache-size", 8192, "number of decoded instructions cached, the cache is shared by the pipeline and the checker"};
+} // namespace config
+
+size_t get_instr_cache_capacity()
+{
+    return config::instr_cache_size;
+}
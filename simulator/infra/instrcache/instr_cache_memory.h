@@ -6,46 +6,135 @@
 #ifndef INSTR_CACHE_H
 #define INSTR_CACHE_H
 
+#include <algorithm>
+#include <memory>
+
+#include <infra/macro.h>
 #include <infra/types.h>
 #include <infra/instrcache/LRUCache.h>
+#include <infra/instrcache/basic_block_cache.h>
 #include <infra/memory/memory.h>
+#include <infra/self_profiler/self_profiler.h>
 
-#ifndef INSTR_CACHE_CAPACITY
-#define INSTR_CACHE_CAPACITY 8192
-#endif
+// number of decoded instructions kept by the cache, it is set by configuration
+size_t get_instr_cache_capacity();
 
 template<typename Instr>
 class InstrMemory : private FuncMemory
 {
     private:
-        LRUCache<Addr, Instr, INSTR_CACHE_CAPACITY> instr_cache{};
+        using InstrCache = LRUCache<Addr, Instr>;
+
+        // Decoded instructions may be shared with the other memory of the same program,
+        // like the memory of the checker. Then the other memory may be written
+        // in a different order, so the cached instructions are checked against
+        // the fetched bytes, and stores of both memories drop them.
+        std::shared_ptr<InstrCache> instr_cache = std::make_shared<InstrCache>( get_instr_cache_capacity());
+        BasicBlockCache<Instr> block_cache{};
 
     public:
         explicit InstrMemory( const std::string& tr) : FuncMemory( tr) { }
 
         using FuncMemory::startPC;
+        using FuncMemory::get_instr_tlb;
+        using FuncMemory::get_data_tlb;
+        using FuncMemory::hash;
+        // decoded instructions are not invalidated, so pages are loaded before simulation
+        using FuncMemory::save_pages;
+        using FuncMemory::load_pages;
+
+        uint32 fetch( Addr pc) const { return FuncMemory::fetch( pc); }
 
-        uint32 fetch( Addr pc) const { return read( pc); }
+        void share_instr_cache( const InstrMemory& other) { instr_cache = other.instr_cache; }
+        bool is_instr_cache_shared() const { return instr_cache.use_count() > 1; }
 
         Instr fetch_instr( Addr PC)
         {
+            SELF_PROFILE( INSTR_MEMORY);
             // NOLINTNEXTLINE(clang-analyzer-deadcode) https://bugs.llvm.org/show_bug.cgi?id=36283
-            const auto [found, value] = instr_cache.find( PC);
-            Instr instr = found ? value : Instr( fetch( PC), PC);
-            instr_cache.update( PC, instr);
+            const auto [found, value] = instr_cache->find( PC);
+            if ( found && ( !is_instr_cache_shared() || value.get_bytes() == fetch( PC)))
+            {
+                const Instr instr = value;
+                instr_cache->update( PC, instr);
+                return instr;
+            }
+
+            if ( found)
+                instr_cache->erase( PC);
+
+            const Instr instr( fetch( PC), PC);
+            instr_cache->update( PC, instr);
             return instr;
         }
 
+        // returns decoded instructions from PC up to the first control flow instruction
+        const auto& fetch_block( Addr PC)
+        {
+            const auto* block = block_cache.find( PC);
+            if ( block != nullptr)
+                return *block;
+
+            typename BasicBlockCache<Instr>::Block new_block;
+            new_block.reserve( BasicBlockCache<Instr>::MAX_BLOCK_SIZE);
+            for ( Addr addr = PC; new_block.size() < BasicBlockCache<Instr>::MAX_BLOCK_SIZE; addr += 4)
+            {
+                new_block.emplace_back( fetch( addr), addr);
+                if ( new_block.back().is_jump())
+                    break;
+            }
+            return block_cache.insert( PC, std::move( new_block));
+        }
+
+        // changes each time when previously fetched blocks are invalidated
+        auto get_block_generation() const { return block_cache.get_generation(); }
+
+        uint64 load( Addr addr, uint32 size) const { return read( addr, size); }
+
+        // values wider than 64 bits are accessed by 8-byte parts in little-endian order
+        template<typename T>
+        T load_value( Addr addr, uint32 size) const
+        {
+            if constexpr ( bitwidth<T> <= bitwidth<uint64>)
+            {
+                return static_cast<T>( load( addr, size));
+            }
+            else
+            {
+                T value = 0;
+                for ( uint32 offset = 0; offset < size; offset += 8)
+                    value = value | ( T( load( addr + offset, std::min( size - offset, 8u))) << ( 8 * offset));
+                return value;
+            }
+        }
+
         void load( Instr* instr) const
         {
-            instr->set_v_dst(read(instr->get_mem_addr(), instr->get_mem_size()));
+            using Value = decltype( instr->get_v_dst());
+            instr->set_v_dst( load_value<Value>( instr->get_mem_addr(), instr->get_mem_size()));
+        }
+
+        // stores drop decoded instructions of the written address
+        void store( Addr addr, uint64 value, uint32 size)
+        {
+            instr_cache->erase( addr);
+            block_cache.invalidate( addr);
+            write( value, addr, size);
+        }
+
+        template<typename T>
+        void store_value( Addr addr, const T& value, uint32 size)
+        {
+            if constexpr ( bitwidth<T> <= bitwidth<uint64>)
+                store( addr, static_cast<uint64>( value), size);
+            else
+                for ( uint32 offset = 0; offset < size; offset += 8)
+                    store( addr + offset, static_cast<uint64>( value >> ( 8 * offset)), std::min( size - offset, 8u));
         }
 
         void store( const Instr& instr)
         {
-            instr_cache.erase( instr.get_mem_addr());
-            // potential bug for RISCV128
-            write(static_cast<uint64>(instr.get_v_src2()), instr.get_mem_addr(), instr.get_mem_size());
+            store_value( instr.get_mem_addr(), instr.get_v_src2(), instr.get_mem_size());
         }
 
         void load_store(Instr* instr)
@@ -9,9 +9,13 @@
 
 // Modules
 #include "../LRUCache.h"
+#include "../basic_block_cache.h"
+#include "../instr_cache_memory.h"
 
 #include <infra/types.h>
+#include <infra/wide_types.h>
 #include <mips/mips_instr.h>
+#include <risc_v/riscv_instr.h>
 
 
 class Dummy {
@@ -28,7 +32,7 @@ public:
 
 TEST( update_and_find_int, Update_Find_And_Check_Using_Int)
 {
-    LRUCache<Addr, Dummy, 8192> cache{};
+    LRUCache<Addr, Dummy> cache( 8192);
 
     const Addr PC = 0x401c04;
     const Dummy test_number( 0x103abf9);
@@ -42,7 +46,7 @@ TEST( update_and_find_int, Update_Find_And_Check_Using_Int)
 
 TEST( update_and_find, Update_Find_And_Check)
 {
-    LRUCache<Addr, MIPSInstr, 8192> instr_cache{};
+    LRUCache<Addr, MIPSInstr> instr_cache( 8192);
 
     const uint32 instr_bytes = 0x3c010400;
     const Addr PC = 0x401c04;
@@ -54,7 +58,7 @@ TEST( update_and_find, Update_Find_And_Check)
 
 TEST( check_method_erase, Check_Method_Erase)
 {
-    LRUCache<Addr, MIPSInstr, 8192> instr_cache{};
+    LRUCache<Addr, MIPSInstr> instr_cache( 8192);
 
     const uint32 instr_bytes = 0x3c010400;
     const Addr PC = 0x401c04;
@@ -68,7 +72,7 @@ TEST( check_method_erase, Check_Method_Erase)
 
 TEST( check_method_empty, Check_Method_Empty)
 {
-    LRUCache<Addr, MIPSInstr, 8192> instr_cache{};
+    LRUCache<Addr, MIPSInstr> instr_cache( 8192);
 
     const uint32 instr_bytes = 0x2484ae10;
     const Addr PC = 0x400d05;
@@ -82,11 +86,11 @@ TEST( check_method_empty, Check_Method_Empty)
 
 TEST( check_method_size, Check_Method_Size)
 {
-    LRUCache<Addr, MIPSInstr, 8192> instr_cache{};
+    LRUCache<Addr, MIPSInstr> instr_cache( 8192);
 
     uint32 instr_bytes = 0x2484ae10;
     Addr PC = 0x30ae17;
-    const std::size_t SIZE = LRUCache<Addr, MIPSInstr, 8192>::get_capacity() / 12;
+    const std::size_t SIZE = instr_cache.get_capacity() / 12;
 
     for ( std::size_t i = 0; i < SIZE; ++i)
     {
@@ -103,7 +107,7 @@ TEST( exceed_capacity_and_test_lru, Add_More_Elements_Than_Capacity_And_Check)
 {
     constexpr const auto CAPACITY = 8192u;
 
-    LRUCache<std::size_t, Dummy, CAPACITY> cache;
+    LRUCache<std::size_t, Dummy> cache( CAPACITY);
 
     for ( std::size_t i = 1; i <= CAPACITY; ++i) // note the <=
         cache.update( i, Dummy( i));
@@ -118,6 +122,103 @@ TEST( exceed_capacity_and_test_lru, Add_More_Elements_Than_Capacity_And_Check)
     ASSERT_FALSE( cache.find( 2).first);
 }
 
+TEST( erase_and_reuse, Erase_Elements_And_Fill_The_Cache_Again)
+{
+    constexpr const auto CAPACITY = 16u;
+
+    LRUCache<std::size_t, Dummy> cache( CAPACITY);
+
+    // keys are aligned like PCs, so they collide in the low bits
+    for ( std::size_t i = 0; i < CAPACITY; ++i)
+        cache.update( i * 4, Dummy( i));
+
+    for ( std::size_t i = 0; i < CAPACITY; i += 2)
+        cache.erase( i * 4);
+
+    ASSERT_EQ( cache.size(), CAPACITY / 2);
+    for ( std::size_t i = 0; i < CAPACITY; ++i)
+        ASSERT_EQ( cache.find( i * 4).first, i % 2 == 1);
+
+    // refill erased entries, then overflow the cache
+    for ( std::size_t i = 0; i < CAPACITY; i += 2)
+        cache.update( i * 4, Dummy( i));
+
+    cache.update( CAPACITY * 4, Dummy( CAPACITY));
+
+    ASSERT_EQ( cache.size(), CAPACITY);
+    ASSERT_FALSE( cache.find( 4).first); // the oldest one is evicted
+    ASSERT_EQ( cache.find( 0).second, Dummy( 0));
+    ASSERT_EQ( cache.find( CAPACITY * 4).second, Dummy( CAPACITY));
+}
+
+TEST( basic_block_cache, Insert_Find_And_Invalidate)
+{
+    BasicBlockCache<MIPSInstr> cache;
+
+    const Addr PC = 0x401ffc;
+    BasicBlockCache<MIPSInstr>::Block block;
+    block.emplace_back( 0x2484ae10, PC);     // addiu
+    block.emplace_back( 0x3c010400, PC + 4); // lui, the next code page
+
+    const auto generation = cache.get_generation();
+    ASSERT_EQ( cache.insert( PC, std::move( block)).size(), 2u);
+    ASSERT_NE( cache.find( PC), nullptr);
+    ASSERT_EQ( cache.find( PC + 4), nullptr);
+
+    // store to the other data page does not affect the block
+    cache.invalidate( 0x10000000);
+    ASSERT_NE( cache.find( PC), nullptr);
+    ASSERT_EQ( cache.get_generation(), generation);
+
+    // store to the second page of the block drops it
+    cache.invalidate( PC + 4);
+    ASSERT_EQ( cache.find( PC), nullptr);
+    ASSERT_NE( cache.get_generation(), generation);
+    ASSERT_EQ( cache.size(), 0u);
+}
+
+TEST( instr_memory, Share_Decoded_Instructions)
+{
+    InstrMemory<MIPSInstr> memory( TEST_PATH "/tt.core.out");
+    InstrMemory<MIPSInstr> checker_memory( TEST_PATH "/tt.core.out");
+    ASSERT_FALSE( memory.is_instr_cache_shared());
+    checker_memory.share_instr_cache( memory);
+    ASSERT_TRUE( memory.is_instr_cache_shared());
+
+    const Addr PC = memory.startPC();
+    const auto instr = memory.fetch_instr( PC);
+    ASSERT_TRUE( checker_memory.fetch_instr( PC).is_same( instr));
+
+    // the instruction is overwritten in one memory, the other one still has the old code
+    MIPSInstr store( 0xad310000, PC - 4); // sw $s1, 0($t1)
+    store.set_v_src( PC, 0);
+    store.set_v_src( 0x2484ae10, 1);      // addiu
+    store.execute_dispatched();
+    memory.store( store);
+
+    ASSERT_EQ( memory.fetch_instr( PC).get_bytes(), 0x2484ae10u);
+    ASSERT_TRUE( checker_memory.fetch_instr( PC).is_same( instr));
+    ASSERT_EQ( memory.fetch_instr( PC).get_bytes(), 0x2484ae10u);
+}
+
+TEST( instr_memory, Wide_Values)
+{
+    InstrMemory<RISCVInstr<uint128>> memory( TEST_PATH "/tt.core.out");
+    const Addr addr = 0x10000000;
+    const auto value = ( uint128{ 0x0123456789abcdefULL} << 64) | uint128{ 0xfedcba9876543210ULL};
+
+    // 16-byte values are written by 8-byte parts in little-endian order
+    memory.store_value( addr, value, 16);
+    ASSERT_EQ( memory.load( addr, 8), 0xfedcba9876543210ULL);
+    ASSERT_EQ( memory.load( addr + 8, 8), 0x0123456789abcdefULL);
+    ASSERT_TRUE( memory.load_value<uint128>( addr, 16) == value);
+
+    // parts of the last word are not written
+    memory.store_value( addr + 16, value, 12);
+    ASSERT_EQ( memory.load( addr + 24, 8), 0x89abcdefULL);
+    ASSERT_TRUE( memory.load_value<uint128>( addr + 16, 12) == ( value & ( ( uint128{ 1} << 96) - 1)));
+    ASSERT_EQ( memory.load_value<uint32>( addr, 4), 0x76543210u);
+}
 
 int main( int argc, char** argv)
 {
@@ -21,6 +21,8 @@ public:
 
     LogOstream(bool value, std::ostream& _out) : enable(value), stream(_out) { }
 
+    bool is_enabled() const { return enable; }
+
     friend LogOstream& operator<<(LogOstream& /*stream*/, const Critical& /* dummy */) {
          exit( EXIT_FAILURE);
     }
@@ -41,6 +43,15 @@ public:
     }
 };
 
+// Tracing statement, which does not evaluate its arguments if the stream is disabled:
+//     TRACE( sout) << "fetch   cycle " << cycle << ": " << instr << std::endl;
+// Build with TRACES_DISABLED to remove tracing from the code completely
+#ifdef TRACES_DISABLED
+#define TRACE( log_stream) if ( true) { } else ( log_stream)
+#else
+#define TRACE( log_stream) if ( !( log_stream).is_enabled()) { } else ( log_stream)
+#endif
+
 class Log
 {
 public:
@@ -6,10 +6,16 @@
  */
 
 // Generic C++
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 // MIPT-MIPS modules
 #include <infra/macro.h>
@@ -23,60 +29,312 @@ union uint64_8
     explicit uint64_8( uint64 value) : val( value) { }
 };
 
-FuncMemory::FuncMemory( const std::string& executable_file_name,
-                        uint32 addr_bits,
+// page number takes the address bits above the offset, each level of tables indexes page_bits of them
+static uint32 get_levels( uint32 addr_bits, uint32 page_bits, uint32 offset_bits)
+{
+    const uint32 index_bits = addr_bits > offset_bits ? addr_bits - offset_bits : 0;
+    return page_bits == 0 ? 1 : std::max<uint32>( 1, ( index_bits + page_bits - 1) / page_bits);
+}
+
+FuncMemory::FuncMemory( uint32 addr_bits,
                         uint32 page_bits,
                         uint32 offset_bits) :
-    page_bits( page_bits),
+    table_bits( page_bits),
     offset_bits( offset_bits),
-    set_bits( addr_bits - offset_bits - page_bits),
-    addr_mask( addr_bits >= 64 ? MAX_VAL32 : ( 1ull << addr_bits) - 1),
-    offset_mask( ( 1ull << offset_bits) - 1),
-    page_mask ( ( ( 1ull << page_bits) - 1) << offset_bits),
-    set_mask ( (( 1ull << set_bits) - 1) << ( page_bits + offset_bits)),
-    page_cnt ( 1ull << page_bits ),
-    set_cnt ( 1ull << set_bits ),
-    page_size ( 1ull << offset_bits)
-{
-    if ( set_bits >= min_sizeof<uint32, size_t>() * 8) {
-        std::cerr << "ERROR. Memory is divided to too many (" << set_cnt << ") sets\n";
+    levels( get_levels( addr_bits, page_bits, offset_bits)),
+    root_bits( addr_bits > offset_bits ? addr_bits - offset_bits - ( levels - 1) * page_bits : 0),
+    addr_mask( bitmask<Addr>( std::min<uint32>( addr_bits, bitwidth<Addr>))),
+    offset_mask( bitmask<Addr>( std::min<uint32>( offset_bits, bitwidth<Addr>))),
+    page_size ( offset_bits < bitwidth<size_t> ? size_t{ 1} << offset_bits : 0),
+    instr_tlb( offset_bits),
+    data_tlb( offset_bits)
+{
+    if ( addr_bits > 64) {
+        std::cerr << "ERROR. Address is too long (" << addr_bits << " bits)\n";
         std::exit( EXIT_FAILURE);
     }
-    if ( page_bits >= min_sizeof<uint32, size_t>() * 8) {
-        std::cerr << "ERROR. Each set is divided to too many (" << page_cnt << ") pages\n";
+    if ( page_bits == 0 || page_bits >= min_sizeof<uint32, size_t>() * 8) {
+        std::cerr << "ERROR. Tables of pages should have from 2 to 2^31 (" << page_bits << " bits) entries\n";
         std::exit( EXIT_FAILURE);
     }
     if ( offset_bits >= min_sizeof<uint32, size_t>() * 8) {
-        std::cerr << "ERROR. Each page is too large (" << page_size << " bytes)\n";
+        std::cerr << "ERROR. Each page is too large (2^" << offset_bits << " bytes)\n";
         std::exit( EXIT_FAILURE);
     }
+}
 
-    memory.resize(set_cnt);
+FuncMemory::FuncMemory( const std::string& executable_file_name,
+                        uint32 addr_bits,
+                        uint32 page_bits,
+                        uint32 offset_bits) :
+    FuncMemory( addr_bits, page_bits, offset_bits)
+{
+    // pages are taken from the image on the first access
+    image = get_image( executable_file_name, addr_bits, page_bits, offset_bits);
+    startPC_addr = image->startPC_addr;
+}
 
-    const auto& sections_array = ElfSection::getAllElfSections( executable_file_name);
+std::unique_ptr<FuncMemory::Table> FuncMemory::create_table( uint32 level) const
+{
+    auto table = std::make_unique<Table>();
+    if ( level + 1 < levels) {
+        table->tables = std::make_unique<std::unique_ptr<Table>[]>( get_table_size( level));
+    }
+    else {
+        table->pages = std::make_unique<Page[]>( get_table_size( level));
+        table->states = std::make_unique<PageState[]>( get_table_size( level));
+    }
+    return table;
+}
 
-    if ( sections_array.empty()) {
+FuncMemory::Table& FuncMemory::get_last_table( Addr addr) const
+{
+    if ( root == nullptr)
+        root = create_table( 0);
+
+    Table* table = root.get();
+    for ( uint32 level = 0; level + 1 < levels; ++level)
+    {
+        auto& next = table->tables[ get_index( addr, level)];
+        if ( next == nullptr)
+            next = create_table( level + 1);
+        table = next.get();
+    }
+
+    return *table;
+}
+
+template<typename Visitor>
+void FuncMemory::visit_pages( const Table& table, uint32 level, uint64 page_number, Visitor&& visitor) const
+{
+    for ( size_t i = 0; i < get_table_size( level); ++i)
+    {
+        const uint64 number = ( page_number << ( level == 0 ? root_bits : table_bits)) | i;
+        if ( level + 1 == levels && table.pages[ i] != nullptr)
+            visitor( static_cast<Addr>( number << offset_bits), table.pages[ i], table.states[ i]);
+        else if ( level + 1 < levels && table.tables[ i] != nullptr)
+            visit_pages( *table.tables[ i], level + 1, number, visitor);
+    }
+}
+
+std::shared_ptr<const FuncMemory> FuncMemory::get_image( const std::string& executable_file_name,
+                                                         uint32 addr_bits,
+                                                         uint32 page_bits,
+                                                         uint32 offset_bits)
+{
+    using Key = std::tuple<std::string, uint32, uint32, uint32>;
+    static std::map<Key, std::weak_ptr<const FuncMemory>> images;
+    static std::mutex images_mutex;
+
+    std::lock_guard<std::mutex> lock( images_mutex);
+    auto& cached_image = images[ Key( executable_file_name, addr_bits, page_bits, offset_bits)];
+    auto result = cached_image.lock();
+    if ( result == nullptr)
+    {
+        // memory is not constructible by make_shared outside of the class
+        std::shared_ptr<FuncMemory> new_image( new FuncMemory( addr_bits, page_bits, offset_bits));
+        new_image->load_elf( executable_file_name);
+        result = new_image;
+        cached_image = result;
+    }
+    return result;
+}
+
+void FuncMemory::load_elf( const std::string& executable_file_name)
+{
+    sections = ElfSection::getAllElfSectionExtents( executable_file_name);
+    elf_file.open( executable_file_name, std::ios::binary);
+
+    if ( sections.empty() || !elf_file) {
         std::cerr << "ERROR. No ELF sections read from " << executable_file_name << "\n";
         std::exit( EXIT_FAILURE);
     }
 
-    for ( const auto& section : sections_array)
+    for ( const auto& section : sections)
     {
-        if ( section.get_name() == ".text")
-            startPC_addr = section.get_start_addr();
+        if ( section.name == ".text")
+            startPC_addr = section.start_addr;
+
+        if ( section.size != 0)
+            section_pages.emplace_back( get_page_addr( section.start_addr),
+                                        get_page_addr( static_cast<Addr>( section.start_addr + section.size - 1)));
+    }
+
+    // adjacent and overlapping ranges are merged
+    std::sort( section_pages.begin(), section_pages.end());
+    std::vector<std::pair<uint64, uint64>> merged;
+    for ( const auto& range : section_pages)
+    {
+        if ( !merged.empty() && range.first <= merged.back().second + page_size)
+            merged.back().second = std::max( merged.back().second, range.second);
+        else
+            merged.push_back( range);
+    }
+    section_pages = std::move( merged);
+}
+
+bool FuncMemory::has_section_page( Addr addr) const
+{
+    const uint64 page_addr = get_page_addr( addr);
+    auto range = std::upper_bound( section_pages.begin(), section_pages.end(), std::make_pair( page_addr, MAX_VAL64));
+    return range != section_pages.begin() && page_addr <= std::prev( range)->second;
+}
+
+// sections are read in the order of the file, so the later ones overwrite the earlier ones
+void FuncMemory::read_sections( Addr page_addr, uint8* page) const
+{
+    const uint64 page_end = uint64{ page_addr} + page_size;
+    for ( const auto& section : sections)
+    {
+        const uint64 start = std::max<uint64>( section.start_addr, page_addr);
+        const uint64 end = std::min<uint64>( uint64{ section.start_addr} + section.size, page_end);
+        if ( start >= end)
+            continue;
+
+        // the content beyond the end of file is zero
+        elf_file.clear();
+        elf_file.seekg( static_cast<std::streamoff>( section.file_offset + ( start - section.start_addr)));
+        elf_file.read( reinterpret_cast<char*>( page + ( start - page_addr)), static_cast<std::streamsize>( end - start));
+    }
+}
+
+FuncMemory::Page FuncMemory::get_section_page( Addr addr) const
+{
+    std::lock_guard<std::mutex> lock( image_mutex);
+    auto& page = get_page_slot( addr);
+    if ( page == nullptr)
+    {
+        page = Page( new uint8[ page_size]()); // value-initialized with zeroes
+        read_sections( get_page_addr( addr), page.get());
+    }
+    return page;
+}
+
+uint64 FuncMemory::get_section_page_hash( Addr addr) const
+{
+    std::lock_guard<std::mutex> lock( image_mutex);
+    auto& table = get_last_table( addr);
+    const auto index = get_index( addr, levels - 1);
+    auto& state = table.states[ index];
+    if ( state.is_hashed)
+        return state.hash;
+
+    const Addr page_addr = get_page_addr( addr);
+    const auto& page = table.pages[ index];
+    if ( page != nullptr) {
+        state.hash = hash_page( page_addr, page.get());
+    }
+    else {
+        std::vector<uint8> buffer( page_size);
+        read_sections( page_addr, buffer.data());
+        state.hash = hash_page( page_addr, buffer.data());
+    }
+    state.is_hashed = true;
+    return state.hash;
+}
+
+void FuncMemory::read_section_page( Addr page_addr, uint8* page) const
+{
+    std::lock_guard<std::mutex> lock( image_mutex);
+    const auto* entry = find_page_entry( page_addr);
+    if ( is_allocated( entry))
+    {
+        std::memcpy( page, entry->get(), page_size);
+        return;
+    }
+
+    std::fill_n( page, page_size, 0);
+    read_sections( page_addr, page);
+}
+
+const FuncMemory::Page* FuncMemory::take_image_page( Addr addr) const
+{
+    auto& page = get_page_slot( addr);
+    page = image->get_section_page( addr);
+    return &page;
+}
+
+template<typename Visitor, typename ImageVisitor>
+void FuncMemory::visit_data_pages( Visitor&& visitor, ImageVisitor&& image_visitor) const
+{
+    if ( image == nullptr)
+    {
+        visit_pages( visitor);
+        return;
+    }
+
+    struct OwnPage { Addr addr; const Page* page; PageState* state; };
+    std::vector<OwnPage> own_pages;
+    visit_pages( [&own_pages]( Addr page_addr, const Page& page, PageState& state) {
+        own_pages.push_back( { page_addr, &page, &state});
+    });
+
+    auto own = own_pages.begin();
+    for ( const auto& range : image->section_pages)
+        for ( uint64 page_addr = range.first; page_addr <= range.second; page_addr += page_size)
+        {
+            for ( ; own != own_pages.end() && own->addr < page_addr; ++own)
+                visitor( own->addr, *own->page, *own->state);
+
+            if ( own != own_pages.end() && own->addr == page_addr)
+                continue;
+
+            image_visitor( static_cast<Addr>( page_addr));
+        }
+
+    for ( ; own != own_pages.end(); ++own)
+        visitor( own->addr, *own->page, *own->state);
+}
+
+uint64 FuncMemory::read_in_page( const uint8* ptr, uint32 num_of_bytes) const
+{
+    switch ( num_of_bytes)
+    {
+        case 1: return read_aligned<uint8>( ptr);
+        case 2: return read_aligned<uint16>( ptr);
+        case 4: return read_aligned<uint32>( ptr);
+        case 8: return read_aligned<uint64>( ptr);
+        default: break;
+    }
+
+    uint64_8 value(0ull);
+    std::memcpy( value.bytes, ptr, num_of_bytes);
+    return value.val;
+}
 
-        for ( size_t offset = 0; offset < section.get_size(); ++offset)
-            write( section.get_byte(offset), section.get_start_addr() + offset, 1);
+void FuncMemory::write_in_page( uint8* ptr, uint64 value, uint32 num_of_bytes)
+{
+    switch ( num_of_bytes)
+    {
+        case 1: write_aligned<uint8>( ptr, value); return;
+        case 2: write_aligned<uint16>( ptr, value); return;
+        case 4: write_aligned<uint32>( ptr, value); return;
+        case 8: write_aligned<uint64>( ptr, value); return;
+        default: break;
     }
+
+    const uint64_8 value_( value);
+    std::memcpy( ptr, value_.bytes, num_of_bytes);
 }
 
-uint64 FuncMemory::read( Addr addr, uint32 num_of_bytes) const
+uint64 FuncMemory::read( Addr addr, uint32 num_of_bytes, TLB* tlb) const
 {
     if ( num_of_bytes == 0 || num_of_bytes > 8) {
         std::cerr << "ERROR. Reading " << num_of_bytes << " bytes)\n";
         std::exit( EXIT_FAILURE);
     }
     assert( addr <= addr_mask);
+
+    // fast path: the whole access is covered by a single page
+    if ( fits_in_page( addr, num_of_bytes))
+    {
+        const uint8* page = translate( addr, tlb);
+        if ( page == nullptr)
+            return NO_VAL64;
+
+        return read_in_page( page + get_offset( addr), num_of_bytes);
+    }
+
     if ( !check( addr) || !check( addr + num_of_bytes - 1))
          return NO_VAL64;
 
@@ -98,6 +356,14 @@ void FuncMemory::write( uint64 value, Addr addr, uint32 num_of_bytes)
         std::exit( EXIT_FAILURE);
     }
 
+    // fast path: the whole access is covered by a single page
+    if ( fits_in_page( addr, num_of_bytes))
+    {
+        uint8* page = translate_for_write( addr);
+        write_in_page( page + get_offset( addr), value, num_of_bytes);
+        return;
+    }
+
     alloc( addr);
     alloc( addr + num_of_bytes - 1);
 
@@ -107,21 +373,53 @@ void FuncMemory::write( uint64 value, Addr addr, uint32 num_of_bytes)
         write_byte( addr + i, value_.bytes[i]);
 }
 
-void FuncMemory::alloc( Addr addr)
+void FuncMemory::write_block( Addr addr, const uint8* data, size_t size)
 {
-    auto& set = memory[get_set(addr)];
-    if ( set.empty())
-        set.resize(page_cnt);
+    assert( addr != 0);
+    assert( size == 0 || addr + size - 1 <= addr_mask);
+
+    while ( size > 0)
+    {
+        const size_t offset = get_offset( addr);
+        const size_t chunk_size = std::min<size_t>( size, page_size - offset);
+        std::memcpy( alloc( addr) + offset, data, chunk_size);
 
-    auto& page = set[get_page(addr)];
-    if ( page.empty())
-        page.resize(page_size, 0);
+        addr += chunk_size;
+        data += chunk_size;
+        size -= chunk_size;
+    }
+}
+
+uint8* FuncMemory::alloc( Addr addr)
+{
+    auto& table = get_last_table( addr);
+    const auto index = get_index( addr, levels - 1);
+    auto& page = table.pages[ index];
+    if ( page == nullptr && is_in_image( addr))
+        page = image->get_section_page( addr);
+
+    if ( page == nullptr || is_shared( page)) {
+        Page new_page( new uint8[ page_size]()); // value-initialized with zeroes
+        if ( page != nullptr)
+            std::memcpy( new_page.get(), page.get(), page_size);
+        page = std::move( new_page);
+
+        // keep translation caches coherent with the page table
+        instr_tlb.invalidate();
+        data_tlb.invalidate();
+    }
+
+    // the page is going to be written
+    auto& state = table.states[ index];
+    state.is_dirty = true;
+    state.is_hashed = false;
+
+    return page.get();
 }
 
 bool FuncMemory::check( Addr addr) const
 {
-    const auto& set = memory[get_set(addr)];
-    return !set.empty() && !set[get_page(addr)].empty();
+    return is_allocated( find_page_entry( addr)) || is_in_image( addr);
 }
 
 std::string FuncMemory::dump() const
@@ -129,21 +427,173 @@ std::string FuncMemory::dump() const
     std::ostringstream oss;
     oss << std::setfill( '0') << std::hex;
 
-    for ( size_t set_n = 0; set_n < memory.size(); ++set_n)
-    {
-        const auto& set = memory[ set_n];
-        for ( size_t page_n = 0; page_n < set.size(); ++page_n)
+    auto dump_page = [&]( Addr page_addr, const uint8* page) {
+        for ( size_t byte_n = 0; byte_n < page_size; ++byte_n)
         {
-            const auto& page = set[ page_n];
-            for ( size_t byte_n = 0; byte_n < page.size(); ++byte_n)
-            {
-                const auto& byte = page[ byte_n];
-                if ( byte != 0)
-                    oss << "addr 0x" << get_addr( set_n, page_n, byte_n)
-                        << ": data 0x" << byte << std::endl;
-            }
+            const auto& byte = page[ byte_n];
+            if ( byte != 0)
+                oss << "addr 0x" << page_addr + byte_n
+                    << ": data 0x" << byte << std::endl;
         }
-    }
+    };
+
+    // pages of the image are read to the buffer, so they are not kept
+    std::vector<uint8> buffer( page_size);
+    visit_data_pages( [&]( Addr page_addr, const Page& page, const PageState&) { dump_page( page_addr, page.get()); },
+                      [&]( Addr page_addr) {
+                          image->read_section_page( page_addr, buffer.data());
+                          dump_page( page_addr, buffer.data());
+                      });
 
     return oss.str();
 }
+
+// rounds of xxHash64 over the words of the page seeded by its address
+static constexpr const uint64 HASH_PRIME_1 = 0x9e3779b185ebca87ull;
+static constexpr const uint64 HASH_PRIME_2 = 0xc2b2ae3d27d4eb4full;
+static constexpr const uint64 HASH_PRIME_3 = 0x165667b19e3779f9ull;
+static constexpr const uint64 HASH_PRIME_4 = 0x85ebca77c2b2ae63ull;
+static constexpr const uint64 HASH_PRIME_5 = 0x27d4eb2f165667c5ull;
+
+static uint64 rotate_left( uint64 value, uint32 shift)
+{
+    return ( value << shift) | ( value >> ( 64 - shift));
+}
+
+static uint64 hash_round( uint64 acc, uint64 value)
+{
+    return rotate_left( acc + value * HASH_PRIME_2, 31) * HASH_PRIME_1;
+}
+
+static uint64 hash_merge( uint64 acc, uint64 value)
+{
+    return rotate_left( acc ^ hash_round( 0, value), 27) * HASH_PRIME_1 + HASH_PRIME_4;
+}
+
+static uint64 hash_avalanche( uint64 acc)
+{
+    acc = ( acc ^ ( acc >> 33)) * HASH_PRIME_2;
+    acc = ( acc ^ ( acc >> 29)) * HASH_PRIME_3;
+    return acc ^ ( acc >> 32);
+}
+
+uint64 FuncMemory::hash_page( Addr page_addr, const uint8* page) const
+{
+    uint64 acc = HASH_PRIME_5 + page_addr;
+    uint64 any_bits = 0;
+    for ( size_t i = 0; i < page_size; i += sizeof( uint64))
+    {
+        uint64 word = 0;
+        std::memcpy( &word, page + i, std::min( sizeof( uint64), page_size - i));
+        any_bits |= word;
+        acc = hash_merge( acc, word);
+    }
+
+    return any_bits == 0 ? 0 : hash_avalanche( acc);
+}
+
+uint64 FuncMemory::get_page_hash( Addr page_addr, const Page& page, PageState* state) const
+{
+    // pages shared with the image keep its content, so it holds their hashes
+    if ( image != nullptr && is_shared( page))
+        return image->get_section_page_hash( page_addr);
+
+    if ( !state->is_hashed) {
+        state->hash = hash_page( page_addr, page.get());
+        state->is_hashed = true;
+    }
+    return state->hash;
+}
+
+uint64 FuncMemory::hash() const
+{
+    // the next write to any page is not hit in the translation cache, so its hash is dropped
+    data_tlb.protect();
+
+    uint64 result = HASH_PRIME_5;
+    auto mix = [&result]( uint64 page_hash) {
+        if ( page_hash != 0)
+            result = hash_merge( result, page_hash);
+    };
+
+    visit_data_pages( [&]( Addr page_addr, const Page& page, PageState& state) { mix( get_page_hash( page_addr, page, &state)); },
+                      [&]( Addr page_addr) { mix( image->get_section_page_hash( page_addr)); });
+
+    return hash_avalanche( result);
+}
+
+std::vector<Addr> FuncMemory::get_dirty_pages() const
+{
+    std::vector<Addr> addrs;
+    visit_pages( [&addrs]( Addr page_addr, const Page&, const PageState& state) {
+        if ( state.is_dirty)
+            addrs.push_back( page_addr);
+    });
+    return addrs;
+}
+
+void FuncMemory::clear_dirty_pages()
+{
+    data_tlb.protect();
+    visit_pages( []( Addr, const Page&, PageState& state) { state.is_dirty = false; });
+}
+
+void FuncMemory::save_pages( std::ostream& out) const
+{
+    std::vector<Addr> addrs;
+    visit_pages( [&addrs]( Addr page_addr, const Page& page, const PageState&) {
+        if ( !is_shared( page))
+            addrs.push_back( page_addr);
+    });
+
+    const uint64 header[] = { page_size, addrs.size()};
+    out.write( reinterpret_cast<const char*>( header), sizeof( header));
+    for ( uint64 addr : addrs)
+        out.write( reinterpret_cast<const char*>( &addr), sizeof( addr));
+
+    const auto padding = ( page_size - static_cast<size_t>( out.tellp()) % page_size) % page_size;
+    std::fill_n( std::ostreambuf_iterator<char>( out), padding, '\0');
+
+    for ( Addr addr : addrs)
+        out.write( reinterpret_cast<const char*>( get_page_ptr( addr)), page_size);
+}
+
+void FuncMemory::load_pages( std::istream& in)
+{
+    uint64 header[2] = {};
+    in.read( reinterpret_cast<char*>( header), sizeof( header));
+    if ( !in || header[0] != page_size) {
+        std::cerr << "ERROR. Checkpoint pages do not match memory page size (" << page_size << " bytes)\n";
+        std::exit( EXIT_FAILURE);
+    }
+
+    // each page takes its address and its data in the stream
+    const auto start = in.tellg();
+    in.seekg( 0, std::ios::end);
+    const auto size = static_cast<uint64>( in.tellg() - start);
+    in.seekg( start);
+    if ( !in || header[1] > size / ( sizeof( uint64) + page_size)) {
+        std::cerr << "ERROR. Checkpoint pages are truncated\n";
+        std::exit( EXIT_FAILURE);
+    }
+
+    std::vector<uint64> addrs( header[1]);
+    in.read( reinterpret_cast<char*>( addrs.data()), addrs.size() * sizeof( uint64));
+
+    const auto padding = ( page_size - static_cast<size_t>( in.tellg()) % page_size) % page_size;
+    in.ignore( padding);
+
+    for ( uint64 addr : addrs)
+    {
+        if ( addr > addr_mask || get_offset( static_cast<Addr>( addr)) != 0) {
+            std::cerr << "ERROR. Invalid address of checkpoint page 0x" << std::hex << addr << std::dec << "\n";
+            std::exit( EXIT_FAILURE);
+        }
+        in.read( reinterpret_cast<char*>( alloc( static_cast<Addr>( addr))), page_size);
+    }
+
+    if ( !in) {
+        std::cerr << "ERROR. Checkpoint pages are truncated\n";
+        std::exit( EXIT_FAILURE);
+    }
+}
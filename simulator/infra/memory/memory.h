@@ -10,43 +10,91 @@
 #define FUNC_MEMORY__FUNC_MEMORY_H
 
 // Generic C++
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 // uArchSim modules
 #include <infra/types.h>
 #include <infra/elf_parser/elf_parser.h>
 
+#include "tlb.h"
+
 class FuncMemory
 {
+    public:
+        using TLB = SoftTLB<64>;
+
     private:
-        const uint32 page_bits;
+        const uint32 table_bits;
         const uint32 offset_bits;
-        const uint32 set_bits;
+        const uint32 levels;
+        const uint32 root_bits;
 
         const Addr addr_mask;
         const Addr offset_mask;
-        const Addr page_mask;
-        const Addr set_mask;
-
-        const size_t page_cnt;
-        const size_t set_cnt;
         const size_t page_size;
 
-        using Page = std::vector<uint8>;
-        using Set  = std::vector<Page>;
-        using Mem  = std::vector<Set>;
-        Mem memory = {};
+        // Radix tree of page tables: each level is indexed by the next
+        // table_bits of the page number, the root takes the remaining upper
+        // bits, and tables of the last level point to pages, which are flat
+        // arrays of bytes. Null pointers are unmapped, so only the tables on
+        // the paths to touched pages are allocated even in sparse address spaces.
+        // Pages of ELF image are shared by all the memories loaded from it
+        // and are copied on the first write. Tables are mutable, as pages
+        // of the image are taken on the first read.
+        using Page = std::shared_ptr<uint8[]>;
+
+        // Pages are marked dirty if they are written since the last checkpoint
+        // and keep their hashes until the next write. Writable translations
+        // are made only by the allocation of page, and they are protected
+        // once the flags are cleared, so the flags are kept without checks
+        // of the fast path.
+        struct PageState
+        {
+            uint64 hash = 0;
+            bool is_hashed = false;
+            bool is_dirty = false;
+        };
+
+        struct Table
+        {
+            std::unique_ptr<std::unique_ptr<Table>[]> tables = nullptr; // inner levels
+            std::unique_ptr<Page[]> pages = nullptr;                     // the last level
+            std::unique_ptr<PageState[]> states = nullptr;               // the last level
+        };
+        mutable std::unique_ptr<Table> root = nullptr;
         Addr startPC_addr = NO_VAL32;
 
-        inline size_t get_set( Addr addr) const
+        std::shared_ptr<const FuncMemory> image = nullptr;
+
+        // ELF image reads a page of sections from the file on the first access
+        // of any memory loaded from it, so untouched data takes neither time nor space
+        std::vector<ElfSectionExtent> sections = {};
+        std::vector<std::pair<uint64, uint64>> section_pages = {}; // sorted ranges of addresses of the first and the last pages
+        mutable std::ifstream elf_file;
+        mutable std::mutex image_mutex;
+
+        // separate translation caches for instruction fetches and data accesses
+        mutable TLB instr_tlb;
+        mutable TLB data_tlb;
+
+        inline size_t get_table_size( uint32 level) const
         {
-            return ( addr & set_mask) >> ( page_bits + offset_bits);
+            return size_t{ 1} << ( level == 0 ? root_bits : table_bits);
         }
 
-        inline size_t get_page( Addr addr) const
+        // the address is widened, as upper levels may cover the bits beyond its type
+        inline size_t get_index( Addr addr, uint32 level) const
         {
-            return ( addr & page_mask) >> offset_bits;
+            const uint32 shift = offset_bits + ( levels - 1 - level) * table_bits;
+            return static_cast<size_t>( uint64{ addr} >> shift) & ( get_table_size( level) - 1);
         }
 
         inline size_t get_offset( Addr addr) const
@@ -54,33 +102,175 @@ class FuncMemory
             return ( addr & offset_mask);
         }
 
-        inline Addr get_addr( Addr set, Addr page, Addr offset) const
+        // walks the tree, O(levels)
+        inline const Page* find_page_entry( Addr addr) const
+        {
+            const Table* table = root.get();
+            for ( uint32 level = 0; level + 1 < levels && table != nullptr; ++level)
+                table = table->tables[ get_index( addr, level)].get();
+
+            return table == nullptr ? nullptr : &table->pages[ get_index( addr, levels - 1)];
+        }
+
+        static bool is_allocated( const Page* entry) { return entry != nullptr && *entry != nullptr; }
+
+        // page of ELF image is taken on the first access
+        inline const Page* get_page_entry( Addr addr) const
+        {
+            const Page* entry = find_page_entry( addr);
+            return !is_allocated( entry) && is_in_image( addr) ? take_image_page( addr) : entry;
+        }
+
+        // returns host pointer to the beginning of the page, nullptr if not allocated
+        inline uint8* get_page_ptr( Addr addr) const
+        {
+            const auto* page = get_page_entry( addr);
+            return page == nullptr ? nullptr : page->get();
+        }
+
+        static bool is_shared( const Page& page) { return page.use_count() > 1; }
+
+        inline Addr get_page_addr( Addr addr) const
+        {
+            return addr & ~offset_mask;
+        }
+
+        // returns host pointer to the page using the translation cache
+        inline uint8* translate( Addr addr, TLB* tlb) const
+        {
+            const Addr page_addr = get_page_addr( addr);
+            uint8* page = tlb->lookup( page_addr);
+            if ( page == nullptr) {
+                const auto* entry = get_page_entry( addr);
+                page = entry == nullptr ? nullptr : entry->get();
+                if ( page != nullptr)
+                    tlb->insert( page_addr, page, false);
+            }
+            return page;
+        }
+
+        // returns host pointer to the private page, which is allocated or copied if needed
+        inline uint8* translate_for_write( Addr addr)
         {
-            return (set << (page_bits + offset_bits)) | (page << offset_bits) | offset;
+            const Addr page_addr = get_page_addr( addr);
+            uint8* page = data_tlb.lookup_writable( page_addr);
+            if ( page == nullptr) {
+                page = alloc( addr);
+                data_tlb.insert( page_addr, page, true);
+            }
+            return page;
+        }
+
+        inline bool fits_in_page( Addr addr, uint32 num_of_bytes) const
+        {
+            return get_offset( addr) + num_of_bytes <= page_size;
         }
 
         inline uint8 read_byte( Addr addr) const
         {
-            return memory[get_set(addr)][get_page(addr)][get_offset(addr)];
+            return get_page_ptr( addr)[get_offset(addr)];
         }
 
         inline void write_byte( Addr addr, uint8 value)
         {
-            memory[get_set(addr)][get_page(addr)][get_offset(addr)] = value;
+            get_page_ptr( addr)[get_offset(addr)] = value;
+        }
+
+        template<typename T>
+        static T read_aligned( const uint8* ptr)
+        {
+            T value;
+            std::memcpy( &value, ptr, sizeof( T));
+            return value;
+        }
+
+        template<typename T>
+        static void write_aligned( uint8* ptr, uint64 value)
+        {
+            const auto narrow_value = static_cast<T>( value);
+            std::memcpy( ptr, &narrow_value, sizeof( T));
         }
 
-        void alloc( Addr addr);
+        uint64 read_in_page( const uint8* ptr, uint32 num_of_bytes) const;
+        void write_in_page( uint8* ptr, uint64 value, uint32 num_of_bytes);
+
+        uint64 read( Addr addr, uint32 num_of_bytes, TLB* tlb) const;
+
+        uint8* alloc( Addr addr);
         bool check( Addr addr) const;
+
+        // the tables on the path to the page are allocated
+        Table& get_last_table( Addr addr) const;
+        Page& get_page_slot( Addr addr) const { return get_last_table( addr).pages[ get_index( addr, levels - 1)]; }
+
+        // zero pages are hashed to zero, so the digest does not depend on which pages are allocated
+        uint64 hash_page( Addr page_addr, const uint8* page) const;
+        uint64 get_page_hash( Addr page_addr, const Page& page, PageState* state) const;
+
+        bool is_in_image( Addr addr) const { return image != nullptr && image->has_section_page( addr); }
+        const Page* take_image_page( Addr addr) const;
+
+        // methods of ELF image, they are called by the loaded memories from different threads
+        bool has_section_page( Addr addr) const;
+        Page get_section_page( Addr addr) const;
+        void read_section_page( Addr page_addr, uint8* page) const;
+        void read_sections( Addr page_addr, uint8* page) const;
+        uint64 get_section_page_hash( Addr addr) const;
+
+        std::unique_ptr<Table> create_table( uint32 level) const;
+
+        // calls the visitor for each allocated page and its state in the order of addresses
+        template<typename Visitor>
+        void visit_pages( const Table& table, uint32 level, uint64 page_number, Visitor&& visitor) const;
+        template<typename Visitor>
+        void visit_pages( Visitor&& visitor) const
+        {
+            if ( root != nullptr)
+                visit_pages( *root, 0, 0, std::forward<Visitor>( visitor));
+        }
+        // visits the pages of ELF image which are not taken yet as well,
+        // they are passed to the second visitor by their addresses
+        template<typename Visitor, typename ImageVisitor>
+        void visit_data_pages( Visitor&& visitor, ImageVisitor&& image_visitor) const;
+
+        // empty memory
+        FuncMemory( uint32 addr_bits, uint32 page_bits, uint32 offset_bits);
+        void load_elf( const std::string& executable_file_name);
+
+        // ELF files are parsed once and cached while there are memories loaded from them
+        static std::shared_ptr<const FuncMemory> get_image( const std::string& executable_file_name,
+                                                            uint32 addr_bits,
+                                                            uint32 page_bits,
+                                                            uint32 offset_bits);
     public:
         explicit FuncMemory ( const std::string& executable_file_name,
                      uint32 addr_bits = 32,
                      uint32 page_bits = 10,
                      uint32 offset_bits = 12);
 
-        uint64 read( Addr addr, uint32 num_of_bytes = 4) const;
+        uint64 read( Addr addr, uint32 num_of_bytes = 4) const { return read( addr, num_of_bytes, &data_tlb); }
+        uint32 fetch( Addr addr) const { return static_cast<uint32>( read( addr, 4, &instr_tlb)); }
         void write( uint64 value, Addr addr, uint32 num_of_bytes = 4);
+        // copies a buffer of any size, page by page
+        void write_block( Addr addr, const uint8* data, size_t size);
         inline uint64 startPC() const { return startPC_addr; }
         std::string dump() const;
+
+        // digest of the whole memory, only the pages written since the previous call are hashed
+        uint64 hash() const;
+
+        // pages written since the last checkpoint, in the order of addresses
+        std::vector<Addr> get_dirty_pages() const;
+        void clear_dirty_pages();
+
+        // Checkpoint of pages which are not shared with ELF image.
+        // Pages are aligned in the stream to the page size, so they are read
+        // directly into memory. Memory must be loaded from the same ELF file.
+        void save_pages( std::ostream& out) const;
+        void load_pages( std::istream& in);
+
+        const TLB& get_instr_tlb() const { return instr_tlb; }
+        const TLB& get_data_tlb() const { return data_tlb; }
 };
 
 #endif // #ifndef FUNC_MEMORY__FUNC_MEMORY_H
@@ -2,6 +2,9 @@
 #include <cassert>
 #include <cstdlib>
 
+// generic C++
+#include <sstream>
+
 // Google Test library
 #include <gtest/gtest.h>
 
@@ -115,6 +118,224 @@ TEST( Func_memory, Write_Read_Not_Initialized_Mem_Test)
     ASSERT_EQ( func_mem.read( write_addr + 2, sizeof( uint16)), right_ret);
 }
 
+TEST( Func_memory, Write_Read_Aligned_And_Page_Crossing_Test)
+{
+    FuncMemory func_mem( valid_elf_file);
+
+    // the last aligned double word of the page
+    const uint64 page_end_addr = 0x300FF8;
+
+    func_mem.write( 0x0706050403020100, page_end_addr, sizeof( uint64));
+    ASSERT_EQ( func_mem.read( page_end_addr, sizeof( uint64)), 0x0706050403020100u);
+    ASSERT_EQ( func_mem.read( page_end_addr + 4, sizeof( uint32)), 0x07060504u);
+
+    // next page is not allocated yet
+    ASSERT_EQ( func_mem.read( page_end_addr + 4, sizeof( uint64)), NO_VAL64);
+
+    // write across the page boundary and read it back in parts
+    func_mem.write( 0x1122334455667788, page_end_addr + 4, sizeof( uint64));
+    ASSERT_EQ( func_mem.read( page_end_addr + 4, sizeof( uint64)), 0x1122334455667788u);
+    ASSERT_EQ( func_mem.read( page_end_addr, sizeof( uint32)), 0x03020100u);
+    ASSERT_EQ( func_mem.read( page_end_addr + 8, sizeof( uint32)), 0x11223344u);
+}
+
+TEST( Func_memory, TLB_Hits_And_Misses_Test)
+{
+    FuncMemory func_mem( valid_elf_file);
+
+    // the address of the ".data" section
+    const uint64 data_sect_addr = 0x4100c0;
+
+    // pages shared with ELF image are translated on the first access
+    const auto& data_tlb = func_mem.get_data_tlb();
+    ASSERT_EQ( func_mem.read( data_sect_addr), 0x03020100u);
+    ASSERT_EQ( data_tlb.get_misses(), 1u);
+
+    const auto hits = data_tlb.get_hits();
+    const auto misses = data_tlb.get_misses();
+
+    ASSERT_EQ( func_mem.read( data_sect_addr), 0x03020100u);
+    ASSERT_EQ( func_mem.read( data_sect_addr + 4), 0x07060504u);
+    ASSERT_EQ( data_tlb.get_hits(), hits + 2);
+    ASSERT_EQ( data_tlb.get_misses(), misses);
+
+    // instruction fetches use their own TLB
+    ASSERT_EQ( func_mem.fetch( data_sect_addr), 0x03020100u);
+    ASSERT_EQ( func_mem.fetch( data_sect_addr + 4), 0x07060504u);
+    ASSERT_EQ( func_mem.get_instr_tlb().get_misses(), 1u);
+    ASSERT_EQ( func_mem.get_instr_tlb().get_hits(), 1u);
+    ASSERT_EQ( data_tlb.get_hits(), hits + 2);
+
+    // allocation of a new page invalidates translations
+    func_mem.write( 0xdeadbeef, 0x300000);
+    ASSERT_EQ( data_tlb.get_misses(), misses + 1);
+    ASSERT_EQ( func_mem.read( data_sect_addr), 0x03020100u);
+    ASSERT_EQ( data_tlb.get_misses(), misses + 2);
+    ASSERT_EQ( func_mem.read( 0x300000), 0xdeadbeefu);
+}
+
+TEST( Func_memory, Write_Block_Test)
+{
+    FuncMemory func_mem( valid_elf_file);
+
+    // block covers the end of one page, the whole next page and the beginning of the third one
+    const uint64 block_addr = 0x300ffe;
+    std::vector<uint8> block( 2 + 4096 + 3);
+    for ( size_t i = 0; i < block.size(); ++i)
+        block[ i] = static_cast<uint8>( i + 1);
+
+    func_mem.write_block( block_addr, block.data(), block.size());
+    ASSERT_EQ( func_mem.read( block_addr, sizeof( uint16)), 0x0201u);
+    ASSERT_EQ( func_mem.read( block_addr + 2, sizeof( uint8)), 0x03u);
+    ASSERT_EQ( func_mem.read( block_addr + block.size() - 3, 3), 0x050403u);
+    ASSERT_EQ( func_mem.read( block_addr + block.size(), sizeof( uint8)), 0u);
+
+    // writes to the ELF image are copied as well
+    const uint8 data[] = { 0xaa, 0xbb};
+    func_mem.write_block( 0x4100c0, data, sizeof( data));
+    ASSERT_EQ( func_mem.read( 0x4100c0), 0x0302bbaau);
+}
+
+TEST( Func_memory, Hash_Test)
+{
+    FuncMemory func_mem( valid_elf_file);
+    FuncMemory other_mem( valid_elf_file);
+    ASSERT_EQ( func_mem.hash(), other_mem.hash());
+
+    // allocation of a page with zeroes does not change the state
+    ASSERT_EQ( other_mem.read( 0x300000), NO_VAL64);
+    other_mem.write( 0, 0x300000);
+    ASSERT_EQ( func_mem.hash(), other_mem.hash());
+
+    other_mem.write( 1, 0x4100c0, sizeof( uint8));
+    ASSERT_NE( func_mem.hash(), other_mem.hash());
+}
+
+TEST( Func_memory, Dirty_Pages_Test)
+{
+    FuncMemory func_mem( valid_elf_file);
+    FuncMemory other_mem( valid_elf_file);
+    ASSERT_TRUE( func_mem.get_dirty_pages().empty());
+
+    // reads do not make pages dirty
+    ASSERT_EQ( func_mem.read( 0x4100c0), 0x03020100u);
+    ASSERT_TRUE( func_mem.get_dirty_pages().empty());
+
+    func_mem.write( 0xdeadbeef, 0x4100c0);
+    func_mem.write( 0xcafe, 0x300ffe, sizeof( uint32)); // crosses the page boundary
+    ASSERT_EQ( func_mem.get_dirty_pages(), std::vector<Addr>( { 0x300000, 0x301000, 0x410000}));
+    ASSERT_NE( func_mem.hash(), other_mem.hash());
+
+    // pages written after the checkpoint are tracked even if they are in the translation cache
+    func_mem.clear_dirty_pages();
+    ASSERT_TRUE( func_mem.get_dirty_pages().empty());
+    func_mem.write( 0x03020100, 0x4100c0);
+    ASSERT_EQ( func_mem.get_dirty_pages(), std::vector<Addr>( { 0x410000}));
+
+    // hashes of pages are updated after the writes hit in the translation cache
+    func_mem.write( 0, 0x300ffe, sizeof( uint32));
+    ASSERT_EQ( func_mem.hash(), other_mem.hash());
+    func_mem.write( 1, 0x4100c0, sizeof( uint8));
+    ASSERT_NE( func_mem.hash(), other_mem.hash());
+    func_mem.write( 0, 0x4100c0, sizeof( uint8));
+    ASSERT_EQ( func_mem.hash(), other_mem.hash());
+}
+
+TEST( Func_memory, Copy_On_Write_Test)
+{
+    FuncMemory func_mem( valid_elf_file);
+    FuncMemory other_mem( valid_elf_file);
+
+    // the data page is shared until the first write
+    const uint64 data_sect_addr = 0x4100c0;
+    ASSERT_EQ( func_mem.read( data_sect_addr), other_mem.read( data_sect_addr));
+
+    func_mem.write( 0xdeadbeef, data_sect_addr);
+    ASSERT_EQ( func_mem.read( data_sect_addr), 0xdeadbeefu);
+    ASSERT_EQ( func_mem.read( data_sect_addr + 4), 0x07060504u);
+    ASSERT_EQ( other_mem.read( data_sect_addr), 0x03020100u);
+
+    // memory loaded later is not affected by the writes too
+    FuncMemory new_mem( valid_elf_file);
+    ASSERT_EQ( new_mem.read( data_sect_addr), 0x03020100u);
+    ASSERT_EQ( new_mem.hash(), other_mem.hash());
+
+    // instruction fetches see the private copy of the page
+    ASSERT_EQ( func_mem.fetch( data_sect_addr), 0xdeadbeefu);
+    func_mem.write( 0x01234567, data_sect_addr);
+    ASSERT_EQ( func_mem.fetch( data_sect_addr), 0x01234567u);
+}
+
+TEST( Func_memory, Lazy_Loading_Test)
+{
+    // untouched pages of ELF file are dumped as they are in the file
+    FuncMemory func_mem( valid_elf_file);
+    const auto dump = func_mem.dump();
+    ASSERT_NE( dump.find( "addr 0x4100c1"), std::string::npos);
+
+    // pages are read on the first access
+    FuncMemory other_mem( valid_elf_file);
+    ASSERT_EQ( other_mem.read( 0x4100c0), 0x03020100u);
+    ASSERT_EQ( other_mem.fetch( 0x4000b0), func_mem.fetch( 0x4000b0));
+    ASSERT_EQ( other_mem.dump(), dump);
+    ASSERT_EQ( other_mem.hash(), func_mem.hash());
+
+    // addresses out of sections are not mapped
+    ASSERT_EQ( func_mem.read( 0x500000), NO_VAL64);
+}
+
+TEST( Func_memory, Sparse_Address_Space_Test)
+{
+    // tables of 1K entries over 64-bit addresses, pages at both ends of the space
+    FuncMemory func_mem( valid_elf_file, 64, 10, 12);
+    FuncMemory default_mem( valid_elf_file);
+    ASSERT_EQ( func_mem.read( 0x4100c0), 0x03020100u);
+    ASSERT_EQ( func_mem.hash(), default_mem.hash());
+
+    const Addr stack_addr = 0xfffffff8;
+    ASSERT_EQ( func_mem.read( stack_addr), NO_VAL64);
+    func_mem.write( 0xdeadbeef, stack_addr);
+    default_mem.write( 0xdeadbeef, stack_addr);
+    ASSERT_EQ( func_mem.read( stack_addr), 0xdeadbeefu);
+    ASSERT_EQ( func_mem.read( stack_addr - 0x1000), NO_VAL64);
+
+    // pages are visited by their addresses
+    ASSERT_EQ( func_mem.dump(), default_mem.dump());
+    ASSERT_EQ( func_mem.hash(), default_mem.hash());
+}
+
+TEST( Func_memory, Checkpoint_Pages_Test)
+{
+    FuncMemory func_mem( valid_elf_file);
+    func_mem.write( 0xdeadbeef, 0x10000000);
+    std::stringstream pages;
+    func_mem.save_pages( pages);
+
+    FuncMemory restored( valid_elf_file);
+    restored.load_pages( pages);
+    ASSERT_EQ( restored.read( 0x10000000), 0xdeadbeefu);
+    ASSERT_EQ( restored.hash(), func_mem.hash());
+
+    // checkpoint of a page: its size, number of pages, address and data aligned to the page size
+    const auto get_checkpoint = []( uint64 pages_num, uint64 addr) {
+        const uint64 header[] = { 4096, pages_num, addr};
+        std::string checkpoint( reinterpret_cast<const char*>( header), sizeof( header));
+        checkpoint.resize( 2 * 4096, '\x5a');
+        return checkpoint;
+    };
+    std::istringstream valid( get_checkpoint( 1, 0x10000000));
+    restored.load_pages( valid);
+    ASSERT_EQ( restored.read( 0x10000000), 0x5a5a5a5au);
+
+    // address out of 32 bits is not truncated to page 0
+    std::istringstream out_of_range( get_checkpoint( 1, 0x100000000));
+    ASSERT_EXIT( restored.load_pages( out_of_range), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR. Invalid address.*");
+
+    // the number of pages is checked before allocation
+    std::istringstream too_many( get_checkpoint( uint64{ 1} << 60, 0x10000000));
+    ASSERT_EXIT( restored.load_pages( too_many), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR. Checkpoint pages are truncated.*");
+}
+
 int main( int argc, char* argv[])
 {
     ::testing::InitGoogleTest( &argc, argv);
@@ -0,0 +1,88 @@
+/**
+ * tlb.h - software translation cache from guest pages to host pages
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef FUNC_MEMORY__TLB_H
+#define FUNC_MEMORY__TLB_H
+
+#include <array>
+
+#include <infra/macro.h>
+#include <infra/types.h>
+
+// Direct-mapped cache of host page pointers indexed by guest page address.
+// A hit costs a single tag comparison, so accesses to a small working set
+// of pages avoid walking the page table.
+template<size_t ENTRIES>
+class SoftTLB
+{
+    static_assert( is_power_of_two( ENTRIES));
+
+    struct Entry
+    {
+        // page addresses are page-aligned, so an odd tag never matches
+        Addr page_addr = 1u;
+        uint8* host_page = nullptr;
+        bool writable = false;
+    };
+
+    std::array<Entry, ENTRIES> entries = {};
+    const uint32 offset_bits;
+
+    uint64 hits = 0;
+    uint64 misses = 0;
+
+    Entry& get_entry( Addr page_addr) { return entries[ ( page_addr >> offset_bits) & ( ENTRIES - 1)]; }
+
+public:
+    explicit SoftTLB( uint32 offset_bits) : offset_bits( offset_bits) { }
+
+    // returns host pointer to the page or nullptr if there is no translation
+    uint8* lookup( Addr page_addr)
+    {
+        const auto& entry = get_entry( page_addr);
+        if ( entry.page_addr == page_addr) {
+            ++hits;
+            return entry.host_page;
+        }
+
+        ++misses;
+        return nullptr;
+    }
+
+    // the same, but translations of read-only pages are not hit
+    uint8* lookup_writable( Addr page_addr)
+    {
+        const auto& entry = get_entry( page_addr);
+        if ( entry.page_addr == page_addr && entry.writable) {
+            ++hits;
+            return entry.host_page;
+        }
+
+        ++misses;
+        return nullptr;
+    }
+
+    void insert( Addr page_addr, uint8* host_page, bool writable)
+    {
+        auto& entry = get_entry( page_addr);
+        entry.page_addr = page_addr;
+        entry.host_page = host_page;
+        entry.writable = writable;
+    }
+
+    void invalidate() { entries.fill( Entry()); }
+
+    // translations are kept for reads, but the next write to each page misses
+    void protect()
+    {
+        for ( auto& entry : entries)
+            entry.writable = false;
+    }
+
+    auto get_hits() const { return hits; }
+    auto get_misses() const { return misses; }
+};
+
+#endif // FUNC_MEMORY__TLB_H
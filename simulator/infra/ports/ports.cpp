@@ -6,23 +6,68 @@
 
 #include "ports.h"
 
-std::list<BasePort::BaseMap*> BasePort::BaseMap::all_maps;
+#include <infra/self_profiler/self_profiler.h>
+
+BasePort::BasePort( std::string key) : Log( true), _key( std::move( key)), _portMap( PortMap::get_instance()) { }
+
+std::shared_ptr<PortMap>& PortMap::current_map()
+{
+    thread_local std::shared_ptr<PortMap> instance = nullptr;
+    return instance;
+}
+
+std::shared_ptr<PortMap> PortMap::create_port_map()
+{
+    current_map() = std::make_shared<PortMap>();
+    return current_map();
+}
+
+std::shared_ptr<PortMap> PortMap::get_instance()
+{
+    if ( current_map() == nullptr)
+        return create_port_map();
+    return current_map();
+}
+
+void PortMap::init() const
+{
+    for ( const auto& map : maps)
+        map.second->init();
+}
+
+void PortMap::check( Cycle cycle) const
+{
+    for ( const auto& map : maps)
+        map.second->check( cycle);
+}
+
+Cycle PortMap::get_next_event_cycle() const
+{
+    SELF_PROFILE( PORTS);
+    Cycle next = NO_EVENT_CYCLE;
+    for ( const auto& map : maps)
+        next = std::min( next, map.second->get_next_event_cycle());
+    return next;
+}
+
+void PortMap::destroy()
+{
+    for ( const auto& map : maps)
+        map.second->destroy();
+}
 
 void init_ports()
 {
-    for ( auto map : BasePort::BaseMap::all_maps)
-        map->init();
+    PortMap::get_instance()->init();
 }
 
 void check_ports( Cycle cycle)
 {
-    for ( auto map : BasePort::BaseMap::all_maps)
-        map->check( cycle);
+    SELF_PROFILE( PORTS);
+    PortMap::get_instance()->check( cycle);
 }
 
 void destroy_ports()
 {
-    for ( auto map : BasePort::BaseMap::all_maps)
-        map->destroy();
+    PortMap::get_instance()->destroy();
 }
-
@@ -9,11 +9,17 @@
 
 #include <cstdlib>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <unordered_map>
-#include <queue>
 #include <list>
+#include <map>
 #include <string>
 #include <memory>
+#include <optional>
+#include <typeindex>
+#include <vector>
 
 #include "../types.h"
 #include "../log.h"
@@ -24,34 +30,42 @@
  * but different type
  */
 
+template<class T> class Port;
 template<class T> class ReadPort;
 template<class T> class WritePort;
+class PortMap;
 
-// Global port handlers
+// Global port handlers, they work with the current PortMap
 extern void init_ports();
+// Full search of lost tokens, ReadPorts detect them anyway
+// when they are polled or written, so it is needed only for debugging
 extern void check_ports( Cycle cycle);
 extern void destroy_ports();
 
+// Cycle of a port without tokens, it is later than any other cycle
+static constexpr const Cycle NO_EVENT_CYCLE = Cycle();
+
 class BasePort : protected Log
 {
-        friend void init_ports();
-        friend void check_ports( Cycle cycle);
-        friend void destroy_ports();
+        friend class PortMap;
 
     protected:
         class BaseMap : public Log
         {
-                friend void init_ports();
-                friend void check_ports( Cycle cycle);
-                friend void destroy_ports();
+                friend class PortMap;
 
                 virtual void init() const = 0;
                 virtual void check( Cycle cycle) const = 0;
+                virtual Cycle get_next_event_cycle() const = 0;
                 virtual void destroy() = 0;
-
-                static std::list<BaseMap*> all_maps;
             protected:
-                BaseMap() : Log(true) { all_maps.push_back( this); }
+                BaseMap() : Log(true) { }
+            public:
+                ~BaseMap() override = default;
+                BaseMap( const BaseMap&) = delete;
+                BaseMap( BaseMap&&) = delete;
+                BaseMap& operator=( const BaseMap&) = delete;
+                BaseMap& operator=( BaseMap&&) = delete;
         };
 
         // Key of port
@@ -60,8 +74,46 @@ class BasePort : protected Log
         // Init flag
         bool _init = false;
 
+        // Map, in which the port is connected
+        const std::shared_ptr<PortMap> _portMap;
+
         // Constructor of port
-        explicit BasePort( std::string key) : Log( true), _key( std::move( key)) { }
+        explicit BasePort( std::string key);
+};
+
+/*
+ * Topology of the simulated ports.
+ *
+ * Ports are connected by keys within the map which is current
+ * on their construction. Each simulator creates its own map,
+ * so several simulators may exist in one process, and
+ * being thread-local, maps can be created in parallel threads.
+ */
+class PortMap : public Log
+{
+    public:
+        PortMap() : Log( true) { }
+
+        // Creates a new map and makes it current for new ports
+        static std::shared_ptr<PortMap> create_port_map();
+
+        // Returns the current map, it is created on first request
+        static std::shared_ptr<PortMap> get_instance();
+
+        void init() const;
+        void check( Cycle cycle) const;
+        void destroy();
+
+        // Returns the earliest cycle when some token becomes ready,
+        // NO_EVENT_CYCLE if all the ports are empty
+        Cycle get_next_event_cycle() const;
+
+        template<class T> typename Port<T>::Map& get_map();
+
+    private:
+        std::map<std::type_index, std::unique_ptr<BasePort::BaseMap>> maps = {};
+
+        static std::shared_ptr<PortMap>& current_map();
 };
 
 /*
@@ -69,6 +121,7 @@ class BasePort : protected Log
 */
 template<class T> class Port : public BasePort
 {
+        friend class PortMap;
     protected:
         using ReadListType = std::list<ReadPort<T>* >;
 
@@ -78,6 +131,7 @@ template<class T> class Port : public BasePort
     protected:
         class Map : public BasePort::BaseMap
         {
+            friend class PortMap;
         private:
         // Cluster of portMap — one writer and list of readers
             struct Cluster
@@ -94,6 +148,9 @@ template<class T> class Port : public BasePort
             // Finding lost elements
             void check( Cycle cycle) const final;
 
+            // Finding the earliest token
+            Cycle get_next_event_cycle() const final;
+
             // Destroy connections
             void destroy() final;
 
@@ -101,21 +158,22 @@ template<class T> class Port : public BasePort
             Map() noexcept : BaseMap() { }
         public:
             decltype(auto) operator[]( const std::string& v) { return _map.operator[]( v); }
-
-            // Singletone
-            static Map& get_instance()
-            {
-                static Map instance;
-                return instance;
-            }
         };
 
         explicit Port( std::string key) : BasePort( std::move( key)) { }
 
         // ports Map to connect ports between for themselves;
-        Map& portMap = Map::get_instance();
+        Map& portMap = this->_portMap->template get_map<T>();
 };
 
+template<class T> typename Port<T>::Map& PortMap::get_map()
+{
+    auto& map = maps[ std::type_index( typeid( T))];
+    if ( map == nullptr)
+        map.reset( new typename Port<T>::Map());
+    return static_cast<typename Port<T>::Map&>( *map);
+}
+
 /*
  * WritePort
  */
@@ -133,8 +191,13 @@ template<class T> class WritePort : public Port<T>
         // Number of reader that can read from this port
         const uint32 _fanout;
 
-        // List of readers
-        ReadListType _destinations = {};
+        // Readers are stored inline, so writing does not walk a list
+        static constexpr const uint32 MAX_FANOUT = 8;
+        std::array<ReadPort<T>*, MAX_FANOUT> _destinations = {};
+        uint32 _destinationsNum = 0;
+
+        auto destinations_begin() const { return _destinations.begin(); }
+        auto destinations_end() const { return _destinations.begin() + _destinationsNum; }
 
         // Variables for counting token in the last cycle
         Cycle _lastCycle = 0_Cl;
@@ -143,8 +206,15 @@ template<class T> class WritePort : public Port<T>
         void init( const ReadListType& readers);
 
         void check( Cycle cycle) const {
-            for ( const auto& reader : _destinations)
-                reader->check( cycle);
+            for ( auto it = destinations_begin(); it != destinations_end(); ++it)
+                (*it)->check( cycle);
+        }
+
+        Cycle get_next_event_cycle() const {
+            Cycle next = NO_EVENT_CYCLE;
+            for ( auto it = destinations_begin(); it != destinations_end(); ++it)
+                next = std::min( next, (*it)->get_next_event_cycle());
+            return next;
         }
 
         // destroy all ports
@@ -162,15 +232,18 @@ template<class T> class WritePort : public Port<T>
         WritePort<T>( std::string key, uint32 bandwidth, uint32 fanout) :
             Port<T>::Port( std::move( key)), _bandwidth(bandwidth), _fanout(fanout)
         {
+            if ( _fanout > MAX_FANOUT)
+                serr << this->_key << " WritePort fanout exceeds " << MAX_FANOUT << std::endl << critical;
+
             if ( this->portMap[ this->_key].writer != nullptr)
-                serr << "Reusing of " << key
+                serr << "Reusing of " << this->_key
                      << " key for WritePort. Last WritePort will be used." << std::endl;
 
             this->portMap[ this->_key].writer = this;
         }
 
-        // Write Method
-        void write( const T& what, Cycle cycle);
+        // Write Method, data is copied only for additional readers
+        void write( T what, Cycle cycle);
 
         // Returns fanout for test of connection
         uint32 getFanout() const { return _fanout; }
@@ -189,24 +262,69 @@ template<class T> class ReadPort: public Port<T>
         // Latency is the number of cycles after which we may take data from port.
         const Latency _latency;
 
-        // Queue of data that should be released
+        // Queue of data that should be released.
+        // It is a ring buffer allocated on initialization: a token stays
+        // in the port for latency cycles, and all of them are read
+        // or lost on the cycle they are ready.
+        // The head is moved only by the reader and the tail only by the writer,
+        // so the stages may be clocked in parallel threads: tokens written
+        // in a cycle are not ready in it, and the reader does not touch them.
         struct Cell
         {
-            T data = T();
+            std::optional<T> data = std::nullopt;
             Cycle cycle = 0_Cl;
-            Cell() = delete;
-            Cell( T v, Cycle c) : data( std::move( v)), cycle( c) { }
         };
-        std::queue<Cell> _dataQueue;
+        std::vector<Cell> _dataQueue = {};
+        size_t _queueHead = 0;
+        size_t _queueTail = 0;
+        std::atomic<size_t> _pushed{ 0};
+        std::atomic<size_t> _popped{ 0};
+
+        size_t next_cell( size_t index) const { return index + 1 == _dataQueue.size() ? 0 : index + 1; }
+
+        bool is_queue_empty() const { return _popped.load( std::memory_order_relaxed) == _pushed.load( std::memory_order_acquire); }
+        const Cell& queue_front() const { return _dataQueue[ _queueHead]; }
+        void queue_pop()
+        {
+            _dataQueue[ _queueHead].data.reset();
+            _queueHead = next_cell( _queueHead);
+            _popped.store( _popped.load( std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Allocates the queue for tokens of writer with given bandwidth
+        void init( uint32 bandwidth)
+        {
+            _dataQueue.clear();
+            _dataQueue.resize( ( _latency.to_size_t() + 1) * bandwidth);
+            _queueHead = 0;
+            _queueTail = 0;
+            _pushed.store( 0, std::memory_order_relaxed);
+            _popped.store( 0, std::memory_order_relaxed);
+            this->_init = true;
+        }
 
         // Pushes data from WritePort
-        void pushData( const T& what, Cycle cycle)
+        void pushData( T&& what, Cycle cycle)
         {
-             _dataQueue.emplace( what, cycle + _latency); // NOTE: we copy data here
+            // queue may be full only if some tokens were never read
+            const size_t pushed = _pushed.load( std::memory_order_relaxed);
+            if ( pushed - _popped.load( std::memory_order_acquire) == _dataQueue.size())
+            {
+                check( cycle);
+                serr << this->_key << " ReadPort is overloaded" << std::endl << critical;
+            }
+            auto& cell = _dataQueue[ _queueTail];
+            cell.data.emplace( std::move( what));
+            cell.cycle = cycle + _latency;
+            _queueTail = next_cell( _queueTail);
+            _pushed.store( pushed + 1, std::memory_order_release);
         }
 
         // Tests if there is any ungot data
         void check( Cycle cycle) const;
+
+        // tokens are queued in order of their cycles
+        Cycle get_next_event_cycle() const { return is_queue_empty() ? NO_EVENT_CYCLE : queue_front().cycle; }
     public:
         /*
          * Constructor
@@ -217,7 +335,7 @@ template<class T> class ReadPort: public Port<T>
          * Adds port to needed Map.
         */
         ReadPort<T>( std::string key, Latency latency) :
-            Port<T>::Port( std::move( key)), _latency( latency), _dataQueue()
+            Port<T>::Port( std::move( key)), _latency( latency)
         {
             this->portMap[ this->_key].readers.push_front( this);
         }
@@ -230,6 +348,17 @@ template<class T> class ReadPort: public Port<T>
 
         // Read but ignore the data
         void ignore( Cycle cycle);
+
+        // Drops the data written before the cycle including the tokens in flight,
+        // they are passed to the handler
+        template<typename Handler> void drop_in_flight( Cycle cycle, Handler on_drop)
+        {
+            while ( !is_queue_empty() && queue_front().cycle < cycle + _latency)
+            {
+                on_drop( *_dataQueue[ _queueHead].data);
+                queue_pop();
+            }
+        }
 };
 
 /*
@@ -243,7 +372,7 @@ template<class T> class ReadPort: public Port<T>
  * If port wasn't initialized, asserts.
  * If port is overloaded by bandwidth (more than _bandwidth token during one cycle, asserts).
 */
-template<class T> void WritePort<T>::write( const T& what, Cycle cycle)
+template<class T> void WritePort<T>::write( T what, Cycle cycle)
 {
     if ( !this->_init)
     {
@@ -261,8 +390,11 @@ template<class T> void WritePort<T>::write( const T& what, Cycle cycle)
     {
     // If we can add something more on that cycle, forwarding it to all ReadPorts.
         _writeCounter++;
-        for ( auto dst : this->_destinations)
-            dst->pushData( what, cycle);
+
+        // the last reader takes the data itself, others get copies
+        for ( uint32 i = 0; i + 1 < _destinationsNum; ++i)
+            _destinations[ i]->pushData( T( what), cycle);
+        _destinations[ _destinationsNum - 1]->pushData( std::move( what), cycle);
     }
     else
     {
@@ -279,20 +411,23 @@ template<class T> void WritePort<T>::write( const T& what, Cycle cycle)
 */
 template<class T> void WritePort<T>::init( const ReadListType& readers)
 {
-    _destinations = readers;
     this->_init = true;
 
-    // Initializing ports with setting their init flags.
-    uint32 readersCounter = _destinations.size();
-    for ( const auto reader : _destinations)
-        reader->_init = true;
-
+    uint32 readersCounter = readers.size();
     if ( readersCounter == 0)
         serr << "No ReadPorts for " << this->_key << " key" << std::endl << critical;
     else if ( readersCounter > _fanout)
         serr << this->_key << " WritePort is overloaded by fanout" << std::endl << critical;
     else if ( readersCounter != _fanout)
         serr << this->_key << " WritePort is underloaded by fanout" << std::endl;
+
+    // Initializing ports with setting their init flags.
+    _destinationsNum = 0;
+    for ( const auto reader : readers)
+    {
+        _destinations[ _destinationsNum++] = reader;
+        reader->init( _bandwidth);
+    }
 }
 
 /*
@@ -308,14 +443,14 @@ template<class T> void WritePort<T>::destroy()
 
     this->_init = false;
 
-    for ( const auto reader : _destinations)
+    for ( auto it = destinations_begin(); it != destinations_end(); ++it)
     {
-        if ( !reader->_init)
+        if ( !(*it)->_init)
             serr << "Destroying uninitialized ReadPort " << this->_key << std::endl << critical;
 
-        reader->_init = false;
+        (*it)->_init = false;
     }
-    _destinations.clear();
+    _destinationsNum = 0;
 }
 
 /*
@@ -335,8 +470,16 @@ template<class T> bool ReadPort<T>::is_ready( Cycle cycle) const
         return false;
     }
 
+    if ( is_queue_empty())
+        return false;
+
+    // tokens left from previous cycles are lost, that is checked
+    // here instead of a sweep over all ports each cycle
+    if ( queue_front().cycle < cycle)
+        check( cycle);
+
     // there are some entries and they are ready to be read
-    return !_dataQueue.empty() && _dataQueue.front().cycle == cycle;
+    return queue_front().cycle == cycle;
 }
 
 /*
@@ -351,12 +494,12 @@ template<class T> T ReadPort<T>::read( Cycle cycle)
     if ( !this->_init)
         serr << this->_key << " ReadPort was not initializated" << std::endl << critical;
 
-    if ( _dataQueue.empty() || _dataQueue.front().cycle != cycle)
+    if ( is_queue_empty() || queue_front().cycle != cycle)
         serr << this->_key << " ReadPort was not ready for read at cycle=" << cycle << std::endl << critical;
 
     // data is successfully read
-    auto tmp = _dataQueue.front().data; // NOTE: we copy data here
-    _dataQueue.pop();
+    T tmp = std::move( *_dataQueue[ _queueHead].data);
+    queue_pop();
     return tmp;
 }
 
@@ -368,7 +511,7 @@ template<class T> T ReadPort<T>::read( Cycle cycle)
 template<class T> void ReadPort<T>::ignore( Cycle cycle)
 {
     while ( this->is_ready( cycle))
-         _dataQueue.pop();
+         queue_pop();
 }
 
 /*
@@ -376,9 +519,9 @@ template<class T> void ReadPort<T>::ignore( Cycle cycle)
 */
 template<class T> void ReadPort<T>::check( Cycle cycle) const
 {
-    if ( !_dataQueue.empty() && _dataQueue.front().cycle < cycle)
+    if ( !is_queue_empty() && queue_front().cycle < cycle)
         serr << "In " << this->_key << " port data was added at "
-             << (_dataQueue.front().cycle - _latency)
+             << (queue_front().cycle - _latency)
              << " clock and will not be readed" << std::endl << critical;
 }
 
@@ -425,6 +568,17 @@ template<class T> void Port<T>::Map::check( Cycle cycle) const
         cluster.second.writer->check( cycle);
 }
 
+/*
+ * Find the earliest token inside ports
+ */
+template<class T> Cycle Port<T>::Map::get_next_event_cycle() const
+{
+    Cycle next = NO_EVENT_CYCLE;
+    for ( const auto& cluster : _map)
+        next = std::min( next, cluster.second.writer->get_next_event_cycle());
+    return next;
+}
+
 // External methods
 template<typename T, typename... Args>
 decltype(auto) make_write_port(Args... args)
@@ -439,7 +593,6 @@ decltype(auto) make_read_port(Args... args)
 }
 
 static constexpr const Latency PORT_LATENCY = 1_Lt;
-static constexpr const Latency PORT_LONG_LATENCY = 30_Lt;
 static constexpr const uint32 PORT_FANOUT = 1;
 static constexpr const uint32 PORT_BW = 1;
 
@@ -0,0 +1,89 @@
+/**
+ * stall_latch.h - input of a pipeline stage keeping stalled instructions in place
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef STALL_LATCH_H
+#define STALL_LATCH_H
+
+#include "ports.h"
+
+#include <infra/ring_buffer.h>
+
+/*
+ * The stage processes the oldest bundle of the latch and passes some of its
+ * instructions further, the remaining ones stay in place and the stall signal
+ * makes the previous stage hold its input. The signal reaches that stage in
+ * the next cycle, so the bundles sent in the meantime and the ones in flight
+ * wait after the stalled one, and the latch keeps up to latency + 1 bundles.
+ */
+template <typename T>
+class StallLatch
+{
+    public:
+        StallLatch( const std::string& input, const std::string& stall, uint32 width, Latency latency = PORT_LATENCY)
+            : buffer( ( latency.to_size_t() + 1) * width)
+            , bundle_sizes( latency.to_size_t() + 1)
+            , rp_input( make_read_port<T>( input, latency))
+            , wp_stall( make_write_port<bool>( stall, PORT_BW, PORT_FANOUT))
+        { }
+
+        // moves instructions arriving in the cycle after the kept ones
+        void receive( Cycle cycle)
+        {
+            const auto size = buffer.size();
+            while ( rp_input->is_ready( cycle))
+                buffer.emplace_back( rp_input->read( cycle));
+            if ( buffer.size() != size)
+                bundle_sizes.emplace_back( buffer.size() - size);
+        }
+
+        bool empty() const { return buffer.empty(); }
+        size_t size() const { return buffer.size(); }
+        size_t get_bundle_size() const { return bundle_sizes.empty() ? 0 : bundle_sizes.front(); }
+
+        // instructions of the oldest bundle are indexed by their slots
+        T& operator[]( size_t slot) { return buffer[ slot]; }
+        const T& operator[]( size_t slot) const { return buffer[ slot]; }
+
+        // the oldest instructions leave the latch, the rest of the bundle stalls the previous stage
+        void pass( size_t count, Cycle cycle)
+        {
+            if ( bundle_sizes.empty())
+                return;
+
+            for ( size_t i = 0; i < count; ++i)
+                buffer.pop_front();
+            bundle_sizes.front() -= count;
+
+            if ( bundle_sizes.front() != 0)
+                wp_stall->write( true, cycle);
+            else
+                bundle_sizes.pop_front();
+        }
+
+        // drops the kept instructions and the ones in flight, they are passed to the handler
+        template <typename Handler>
+        void flush( Cycle cycle, Handler on_drop)
+        {
+            for ( size_t i = 0; i < buffer.size(); ++i)
+                on_drop( buffer[ i]);
+            rp_input->drop_in_flight( cycle, on_drop);
+            buffer.clear();
+            bundle_sizes.clear();
+        }
+
+        void flush( Cycle cycle)
+        {
+            flush( cycle, []( const T&) { });
+        }
+
+    private:
+        RingBuffer<T> buffer;
+        RingBuffer<size_t> bundle_sizes;
+
+        std::unique_ptr<ReadPort<T>> rp_input;
+        std::unique_ptr<WritePort<bool>> wp_stall;
+};
+
+#endif // STALL_LATCH_H
@@ -6,10 +6,13 @@
 
 // Module
 #include "../ports.h"
+#include "../stall_latch.h"
 
 
 #include <cassert>
 #include <map>
+#include <string>
+#include <vector>
 
 
 namespace ports {
@@ -168,6 +171,94 @@ TEST( test_ports, Test_Ports_A_B)
     GTEST_ASSERT_NO_DEATH( destroy_ports(););
 }
 
+TEST( test_ports, Test_Ports_Wide_And_Long)
+{
+    // the queue is filled completely with tokens in flight
+    WritePort<std::string> wp( "wide_and_long", 2, 2);
+    ReadPort<std::string> rp_1( "wide_and_long", 3_Lt);
+    ReadPort<std::string> rp_2( "wide_and_long", 3_Lt);
+    init_ports();
+
+    for ( auto cycle = 0_Cl; cycle < 20_Cl; cycle.inc())
+    {
+        wp.write( std::to_string( cycle % 1000) + "a", cycle);
+        wp.write( std::to_string( cycle % 1000) + "b", cycle);
+
+        if ( cycle >= 3_Cl)
+        {
+            const auto expected = std::to_string( ( cycle - 3_Lt) % 1000);
+            for ( auto* rp : { &rp_1, &rp_2})
+            {
+                ASSERT_TRUE( rp->is_ready( cycle));
+                ASSERT_EQ( rp->read( cycle), expected + "a");
+                ASSERT_EQ( rp->read( cycle), expected + "b");
+                ASSERT_FALSE( rp->is_ready( cycle));
+            }
+        }
+        check_ports( cycle);
+    }
+
+    destroy_ports();
+}
+
+TEST( test_ports, Test_Lost_Token)
+{
+    WritePort<int> wp( "lost_token", 1, 1);
+    ReadPort<int> rp( "lost_token", 1_Lt);
+    init_ports();
+
+    wp.write( 1, 0_Cl);
+    ASSERT_EXIT( check_ports( 2_Cl), ::testing::ExitedWithCode( EXIT_FAILURE), ".*will not be readed.*");
+
+    // lost token is detected when the port is polled
+    ASSERT_EXIT( rp.is_ready( 2_Cl), ::testing::ExitedWithCode( EXIT_FAILURE), ".*will not be readed.*");
+
+    // overflow of the queue is detected when it is written
+    wp.write( 2, 1_Cl);
+    ASSERT_EXIT( wp.write( 3, 2_Cl), ::testing::ExitedWithCode( EXIT_FAILURE), ".*will not be readed.*");
+
+    destroy_ports();
+}
+
+TEST( test_ports, Stall_Latch_Keeps_Instructions_In_Place)
+{
+    WritePort<int> wp( "latch_input", 2, 1);
+    ReadPort<bool> rp_stall( "latch_stall", 1_Lt);
+    StallLatch<int> latch( "latch_input", "latch_stall", 2);
+    init_ports();
+
+    // the second instruction of the bundle is stalled
+    wp.write( 1, 0_Cl);
+    wp.write( 2, 0_Cl);
+    latch.receive( 1_Cl);
+    ASSERT_EQ( latch.get_bundle_size(), 2u);
+    latch.pass( 1, 1_Cl);
+
+    // the next bundle is sent before the stall signal is received
+    wp.write( 3, 1_Cl);
+    ASSERT_TRUE( rp_stall.is_ready( 2_Cl));
+    ASSERT_TRUE( rp_stall.read( 2_Cl));
+    latch.receive( 2_Cl);
+    ASSERT_EQ( latch.get_bundle_size(), 1u);
+    ASSERT_EQ( latch[ 0], 2);
+    latch.pass( 1, 2_Cl);
+
+    // the kept bundle goes next without stall
+    ASSERT_FALSE( rp_stall.is_ready( 3_Cl));
+    latch.receive( 3_Cl);
+    ASSERT_EQ( latch.get_bundle_size(), 1u);
+    ASSERT_EQ( latch[ 0], 3);
+
+    // both the kept and the arriving instructions are flushed
+    wp.write( 4, 3_Cl);
+    std::vector<int> dropped;
+    latch.flush( 4_Cl, [&dropped]( int value) { dropped.push_back( value); });
+    ASSERT_EQ( dropped, std::vector<int>( { 3, 4}));
+    ASSERT_TRUE( latch.empty());
+
+    destroy_ports();
+}
+
 
 
 
@@ -63,6 +63,7 @@ class Latency : public boost::totally_ordered<Latency>
         constexpr auto operator-( const Latency& rhs) const { return Latency( value - rhs.value); }
         constexpr auto operator/( int64 number) const { return Latency( value / number); }
         constexpr auto operator*( int64 number) const { return Latency( value * number); }
+        constexpr size_t to_size_t() const { return static_cast<size_t>( value); }
 
         friend std::ostream& operator<<( std::ostream& os, const Latency& latency)
         {
@@ -0,0 +1,204 @@
+/*
+ * profiler.cpp - counters of simulation events in guest functions
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+
+#include "profiler.h"
+
+Profiler::Profiler( const std::string& binary, uint64 period)
+    : period( period)
+    , symbols( ElfSection::getAllElfSymbols( binary))
+    , nodes( 1)
+{
+    if ( period == 0)
+    {
+        std::cerr << "ERROR. Sampling period of profile must be positive" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+}
+
+const char* Profiler::get_event_name( ProfileEvent event)
+{
+    switch ( event)
+    {
+        case ProfileEvent::INSTRS:         return "instrs";
+        case ProfileEvent::CYCLES:         return "cycles";
+        case ProfileEvent::ICACHE_MISSES:  return "icache_misses";
+        case ProfileEvent::MISPREDICTIONS: return "mispredictions";
+        default: return "";
+    }
+}
+
+size_t Profiler::find_function( Addr PC) const
+{
+    const size_t unknown = symbols.size();
+    auto it = std::upper_bound( symbols.begin(), symbols.end(), PC, []( Addr value, const auto& symbol) {
+        return value < symbol.start_addr;
+    });
+    if ( it == symbols.begin())
+        return unknown;
+
+    // labels without size span up to the next symbol
+    --it;
+    if ( it->size != 0 && PC - it->start_addr >= it->size)
+        return unknown;
+
+    return static_cast<size_t>( it - symbols.begin());
+}
+
+size_t Profiler::get_child( size_t node, size_t function)
+{
+    const auto [it, is_new] = children.emplace( ( static_cast<uint64>( node) << 32) | function, nodes.size());
+    if ( is_new)
+        nodes.push_back( { node, function, {}});
+    return it->second;
+}
+
+size_t Profiler::get_leaf( Addr PC)
+{
+    const size_t top = calls.empty() ? ROOT : calls.back().node;
+    const size_t function = find_function( PC);
+    if ( top != ROOT && nodes[ top].function == function)
+        return top;
+
+    return get_child( top, function);
+}
+
+void Profiler::sample( ProfileEvent event, Addr PC)
+{
+    auto& pending = pending_events[ static_cast<size_t>( event)];
+    const uint64 weight = pending - pending % period;
+    pending -= weight;
+    nodes[ get_leaf( PC)].counts[ static_cast<size_t>( event)] += weight;
+}
+
+void Profiler::retire( Addr PC, Addr new_PC, bool is_call, bool is_return)
+{
+    count( ProfileEvent::INSTRS, PC);
+
+    // too deep stacks are recursions which are never unwound, their calls are not pushed
+    if ( is_call && calls.size() < MAX_STACK_DEPTH)
+    {
+        const size_t caller = get_leaf( PC);
+        calls.push_back( { PC + 4, get_child( caller, find_function( new_PC))});
+    }
+    else if ( is_return && !calls.empty() && calls.back().return_address == new_PC)
+    {
+        calls.pop_back();
+    }
+}
+
+std::string Profiler::get_stack( size_t node) const
+{
+    std::vector<size_t> functions;
+    for ( ; node != ROOT; node = nodes[ node].parent)
+        functions.push_back( nodes[ node].function);
+
+    std::string stack;
+    for ( auto it = functions.rbegin(); it != functions.rend(); ++it)
+    {
+        if ( !stack.empty())
+            stack += ';';
+        stack += *it < symbols.size() ? symbols[ *it].name : "[unknown]";
+    }
+    return stack;
+}
+
+uint64 Profiler::get_total( ProfileEvent event) const
+{
+    uint64 total = 0;
+    for ( const auto& node : nodes)
+        total += node.counts[ static_cast<size_t>( event)];
+    return total;
+}
+
+uint64 Profiler::get_count( const std::string& function, ProfileEvent event) const
+{
+    uint64 result = 0;
+    for ( size_t i = 1; i < nodes.size(); ++i)
+    {
+        const size_t id = nodes[ i].function;
+        const std::string& name = id < symbols.size() ? symbols[ id].name : "[unknown]";
+        if ( name == function)
+            result += nodes[ i].counts[ static_cast<size_t>( event)];
+    }
+    return result;
+}
+
+void Profiler::dump_flat( std::ostream& out) const
+{
+    // different symbols may have the same name, so they are merged by names
+    std::unordered_map<std::string, std::array<uint64, EVENTS_NUM>> functions;
+    for ( size_t i = 1; i < nodes.size(); ++i)
+    {
+        const size_t id = nodes[ i].function;
+        auto& counts = functions[ id < symbols.size() ? symbols[ id].name : "[unknown]"];
+        for ( size_t event = 0; event < EVENTS_NUM; ++event)
+            counts[ event] += nodes[ i].counts[ event];
+    }
+
+    std::vector<std::pair<std::string, std::array<uint64, EVENTS_NUM>>> rows( functions.begin(), functions.end());
+    std::sort( rows.begin(), rows.end(), []( const auto& lhs, const auto& rhs) {
+        const auto key = []( const auto& row) {
+            return std::make_tuple( row.second[ static_cast<size_t>( ProfileEvent::CYCLES)],
+                                    row.second[ static_cast<size_t>( ProfileEvent::INSTRS)]);
+        };
+        return key( lhs) != key( rhs) ? key( lhs) > key( rhs) : lhs.first < rhs.first;
+    });
+
+    out << "function";
+    for ( size_t event = 0; event < EVENTS_NUM; ++event)
+        out << ',' << get_event_name( static_cast<ProfileEvent>( event));
+    out << std::endl;
+
+    for ( const auto& row : rows)
+    {
+        out << row.first;
+        for ( const auto count : row.second)
+            out << ',' << count;
+        out << std::endl;
+    }
+}
+
+void Profiler::dump_folded( std::ostream& out, ProfileEvent event) const
+{
+    for ( size_t i = 1; i < nodes.size(); ++i)
+    {
+        const auto count = nodes[ i].counts[ static_cast<size_t>( event)];
+        if ( count != 0)
+            out << get_stack( i) << ' ' << count << std::endl;
+    }
+}
+
+static std::ofstream open_profile_file( const std::string& filename)
+{
+    std::ofstream out( filename);
+    if ( !out.is_open())
+    {
+        std::cerr << "ERROR. Could not open profile file " << filename << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    return out;
+}
+
+void Profiler::save( const std::string& prefix) const
+{
+    auto flat = open_profile_file( prefix + ".csv");
+    dump_flat( flat);
+
+    for ( size_t i = 0; i < EVENTS_NUM; ++i)
+    {
+        const auto event = static_cast<ProfileEvent>( i);
+        if ( get_total( event) == 0)
+            continue;
+
+        auto folded = open_profile_file( prefix + "." + get_event_name( event) + ".folded");
+        dump_folded( folded, event);
+    }
+}
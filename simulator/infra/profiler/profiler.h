@@ -0,0 +1,103 @@
+/*
+ * profiler.h - counters of simulation events in guest functions
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <infra/elf_parser/elf_parser.h>
+#include <infra/types.h>
+
+enum class ProfileEvent : uint8
+{
+    INSTRS,
+    CYCLES,         // cycles since the previous retirement are counted to the retired instruction
+    ICACHE_MISSES,
+    MISPREDICTIONS,
+    EVENTS_NUM
+};
+
+/*
+ * Functions are resolved by the symbol table of the binary, instructions out
+ * of symbols are counted to "[unknown]". Calls push the callee and the return
+ * address to the stack of calls, a jump to the return address of the top call
+ * pops it, so stacks unwound by other jumps keep their calls. Stacks are kept
+ * as nodes of the call tree, and each event is counted to the node of its stack.
+ * Events are sampled: each period-th event of a type is counted with the weight
+ * of the period, so the overhead of large periods is a few additions per event.
+ */
+class Profiler
+{
+    public:
+        Profiler( const std::string& binary, uint64 period);
+
+        void count( ProfileEvent event, Addr PC, uint64 weight = 1)
+        {
+            auto& pending = pending_events[ static_cast<size_t>( event)];
+            pending += weight;
+            if ( pending >= period)
+                sample( event, PC);
+        }
+
+        // the retired instruction is counted and moves the stack of calls
+        void retire( Addr PC, Addr new_PC, bool is_call, bool is_return);
+
+        template<typename Instr>
+        void retire( const Instr& instr)
+        {
+            retire( instr.get_PC(), instr.get_new_PC(), instr.is_call(), instr.is_return());
+        }
+
+        // events of functions without their callees in CSV, the hottest functions go first
+        void dump_flat( std::ostream& out) const;
+        // stacks of events in folded format of flamegraph.pl and speedscope
+        void dump_folded( std::ostream& out, ProfileEvent event) const;
+        // writes <prefix>.csv and <prefix>.<event>.folded for every counted event
+        void save( const std::string& prefix) const;
+
+        uint64 get_count( const std::string& function, ProfileEvent event) const;
+
+        static const char* get_event_name( ProfileEvent event);
+
+    private:
+        static constexpr const size_t EVENTS_NUM = static_cast<size_t>( ProfileEvent::EVENTS_NUM);
+        static constexpr const size_t MAX_STACK_DEPTH = 1024;
+        static constexpr const size_t ROOT = 0;
+
+        struct Node
+        {
+            size_t parent = ROOT;
+            size_t function = 0;
+            std::array<uint64, EVENTS_NUM> counts = {};
+        };
+
+        struct Call
+        {
+            Addr return_address = NO_VAL32;
+            size_t node = ROOT;
+        };
+
+        size_t find_function( Addr PC) const;
+        size_t get_child( size_t node, size_t function);
+        size_t get_leaf( Addr PC);
+        void sample( ProfileEvent event, Addr PC);
+        std::string get_stack( size_t node) const;
+        uint64 get_total( ProfileEvent event) const;
+
+        const uint64 period;
+        std::vector<ElfSymbol> symbols;
+        std::array<uint64, EVENTS_NUM> pending_events = {};
+
+        std::vector<Node> nodes;
+        std::unordered_map<uint64, size_t> children; // keyed by the parent node and the function
+        std::vector<Call> calls;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,168 @@
+// generic C
+#include <cstdlib>
+
+// generic C++
+#include <fstream>
+#include <sstream>
+
+// Google Test library
+#include <gtest/gtest.h>
+
+// Module
+#include <func_sim/func_sim.h>
+#include <mips/mips.h>
+#include "../profiler.h"
+
+static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
+static const std::string recursion = TEST_PATH "/bench/recursion.out";
+
+static uint64 profile( Profiler* profiler, const std::string& binary)
+{
+    FuncSim<MIPS> sim;
+    sim.init( binary);
+    uint64 executed_instrs = 0;
+    for ( bool is_halt = false; !is_halt; ++executed_instrs)
+    {
+        const auto instr = sim.step();
+        profiler->retire( instr);
+        is_halt = instr.is_halt();
+    }
+    return executed_instrs;
+}
+
+static std::string read_file( const std::string& filename)
+{
+    std::ifstream in( filename);
+    std::ostringstream oss;
+    oss << in.rdbuf();
+    return oss.str();
+}
+
+TEST( Profiler, Instructions_Of_Functions)
+{
+    Profiler profiler( recursion, 1);
+    const auto executed_instrs = profile( &profiler, recursion);
+
+    const auto start = profiler.get_count( "__start", ProfileEvent::INSTRS);
+    const auto fib = profiler.get_count( "fib", ProfileEvent::INSTRS);
+    const auto recurse = profiler.get_count( "recurse", ProfileEvent::INSTRS);
+    ASSERT_EQ( start, 6);
+    ASSERT_NE( fib, 0);
+    ASSERT_NE( recurse, 0);
+    ASSERT_EQ( start + fib + recurse, executed_instrs);
+    ASSERT_EQ( profiler.get_count( "[unknown]", ProfileEvent::INSTRS), 0);
+    ASSERT_EQ( profiler.get_count( "fib", ProfileEvent::CYCLES), 0);
+}
+
+TEST( Profiler, Stacks_Of_Calls)
+{
+    Profiler profiler( recursion, 1);
+    profile( &profiler, recursion);
+
+    std::ostringstream oss;
+    profiler.dump_folded( oss, ProfileEvent::INSTRS);
+    const auto folded = oss.str();
+
+    // the label inside fib is shown as its callee, recursive calls are unwound by returns
+    ASSERT_NE( folded.find( "\n__start;fib;recurse;fib "), std::string::npos);
+    ASSERT_NE( folded.find( "\n__start;fib;recurse;fib;recurse;fib "), std::string::npos);
+    ASSERT_EQ( folded.find( "[unknown]"), std::string::npos);
+
+    // the stack of the last instruction is the stack of the first one
+    ASSERT_EQ( folded.find( "__start 6\n"), 0);
+}
+
+TEST( Profiler, Flat_Profile)
+{
+    Profiler profiler( recursion, 1);
+    const auto executed_instrs = profile( &profiler, recursion);
+    profiler.count( ProfileEvent::CYCLES, 0x400000, 10);
+
+    std::ostringstream oss;
+    profiler.dump_flat( oss);
+    std::istringstream iss( oss.str());
+    std::string line;
+    std::getline( iss, line);
+    ASSERT_EQ( line, "function,instrs,cycles,icache_misses,mispredictions");
+
+    // functions of more cycles go first
+    std::getline( iss, line);
+    ASSERT_EQ( line, "__start,6,10,0,0");
+
+    uint64 instrs = 0;
+    for ( uint32 rows = 0; rows < 2; ++rows)
+    {
+        std::getline( iss, line);
+        std::istringstream row( line.substr( line.find( ',') + 1));
+        uint64 value = 0;
+        row >> value;
+        instrs += value;
+    }
+    ASSERT_EQ( instrs + 6, executed_instrs);
+    ASSERT_FALSE( std::getline( iss, line));
+}
+
+TEST( Profiler, Sampled_Events)
+{
+    Profiler exact( recursion, 1);
+    Profiler sampled( recursion, 1000);
+    const auto executed_instrs = profile( &exact, recursion);
+    profile( &sampled, recursion);
+
+    // samples of 1000 instructions miss only the tail of the run
+    uint64 total = 0;
+    for ( const auto& function : { "__start", "fib", "recurse"})
+    {
+        const auto count = sampled.get_count( function, ProfileEvent::INSTRS);
+        const auto exact_count = exact.get_count( function, ProfileEvent::INSTRS);
+        ASSERT_EQ( count % 1000, 0);
+        ASSERT_NEAR( count, exact_count, exact_count / 20 + 1000);
+        total += count;
+    }
+    ASSERT_EQ( total, executed_instrs - executed_instrs % 1000);
+}
+
+TEST( Profiler, Binary_Without_Symbols)
+{
+    Profiler profiler( valid_elf_file, 1);
+    const auto executed_instrs = profile( &profiler, valid_elf_file);
+    ASSERT_EQ( profiler.get_count( "[unknown]", ProfileEvent::INSTRS), executed_instrs);
+}
+
+TEST( Profiler, Zero_Period)
+{
+    ASSERT_EXIT( Profiler( recursion, 0), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR. Sampling period of profile must be positive");
+}
+
+TEST( Profiler, Functional_Simulation)
+{
+    FuncSim<MIPS> sim;
+    sim.set_profile( "./func_profile", 1);
+    sim.run_no_limit( recursion);
+
+    Profiler profiler( recursion, 1);
+    profile( &profiler, recursion);
+    std::ostringstream flat;
+    profiler.dump_flat( flat);
+    std::ostringstream folded;
+    profiler.dump_folded( folded, ProfileEvent::INSTRS);
+
+    ASSERT_EQ( read_file( "./func_profile.csv"), flat.str());
+    ASSERT_EQ( read_file( "./func_profile.instrs.folded"), folded.str());
+
+    // events which are not counted have no stacks
+    ASSERT_FALSE( std::ifstream( "./func_profile.cycles.folded").is_open());
+}
+
+TEST( Profiler, Unwritable_Profile)
+{
+    Profiler profiler( recursion, 1);
+    ASSERT_EXIT( profiler.save( "./1234567890/qwertyuiop"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR. Could not open profile file");
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
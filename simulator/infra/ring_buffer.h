@@ -0,0 +1,68 @@
+/**
+ * ring_buffer.h - queue of fixed capacity allocated once
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cassert>
+#include <optional>
+#include <vector>
+
+/*
+ * Elements are constructed in place and destroyed on pop,
+ * so they need neither default constructor nor assignment.
+ * Memory is not allocated after construction.
+ */
+template <typename T>
+class RingBuffer
+{
+    public:
+        explicit RingBuffer( size_t capacity) : cells( capacity) { }
+
+        bool empty() const { return count == 0; }
+        bool full() const { return count == cells.size(); }
+        size_t size() const { return count; }
+        size_t capacity() const { return cells.size(); }
+
+        // elements are indexed from the oldest one
+        T& operator[]( size_t index) { return *cells[ position( index)]; }
+        const T& operator[]( size_t index) const { return *cells[ position( index)]; }
+
+        T& front() { return operator[]( 0); }
+        const T& front() const { return operator[]( 0); }
+
+        template <typename ... Args>
+        T& emplace_back( Args&& ... args)
+        {
+            assert( !full());
+            auto& cell = cells[ position( count)];
+            cell.emplace( std::forward<Args>( args)...);
+            ++count;
+            return *cell;
+        }
+
+        void pop_front()
+        {
+            assert( !empty());
+            cells[ head].reset();
+            head = ( head + 1) % cells.size();
+            --count;
+        }
+
+        void clear()
+        {
+            while ( !empty())
+                pop_front();
+        }
+
+    private:
+        std::vector<std::optional<T>> cells;
+        size_t head = 0;
+        size_t count = 0;
+
+        size_t position( size_t index) const { return ( head + index) % cells.size(); }
+};
+
+#endif // RING_BUFFER_H
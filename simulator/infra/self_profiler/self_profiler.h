@@ -0,0 +1,133 @@
+/**
+ * self_profiler.h - host time spent by components of the simulator
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef SELF_PROFILER_H
+#define SELF_PROFILER_H
+
+#include <infra/types.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SELF_PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SELF_PROFILER_RDTSC 1
+#endif
+
+enum class HostComponent : uint8
+{
+    FETCH,
+    DECODE,
+    EXECUTE,
+    MEM,
+    WRITEBACK,
+    CHECKER,
+    INSTR_MEMORY,
+    PORTS,
+    COMPONENTS_NUM
+};
+
+/*
+ * Scopes add host clock ticks passed between their construction and destruction
+ * to the counter of the component, they are read by rdtsc where it is available.
+ * Ticks are converted to nanoseconds by the ratio of steady clock and ticks
+ * passed since the start of the program. Scopes of components may be nested,
+ * e.g. checker is called by writeback, so the time of the outer one includes
+ * the inner one. Stages may be clocked in parallel threads, so counters are atomic.
+ */
+class SelfProfiler
+{
+    public:
+#ifdef SELF_PROFILING
+        static constexpr const bool is_enabled = true;
+#else
+        static constexpr const bool is_enabled = false;
+#endif
+
+        class Scope
+        {
+            public:
+                explicit Scope( HostComponent component) : component( component), start( read_clock()) { }
+                ~Scope() { add( component, read_clock() - start); }
+
+                Scope( const Scope&) = delete;
+                Scope( Scope&&) = delete;
+                Scope& operator=( const Scope&) = delete;
+                Scope& operator=( Scope&&) = delete;
+
+            private:
+                const HostComponent component;
+                const uint64 start;
+        };
+
+        static uint64 read_clock()
+        {
+#ifdef SELF_PROFILER_RDTSC
+            return __rdtsc();
+#else
+            return static_cast<uint64>( std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        static void add( HostComponent component, uint64 ticks) { counters.at( index( component)).fetch_add( ticks, std::memory_order_relaxed); }
+        static uint64 get_ticks( HostComponent component) { return counters.at( index( component)).load( std::memory_order_relaxed); }
+        static double get_nanoseconds( HostComponent component) { return static_cast<double>( get_ticks( component)) * get_nanoseconds_per_tick(); }
+
+        static void reset()
+        {
+            for ( auto& counter : counters)
+                counter.store( 0, std::memory_order_relaxed);
+        }
+
+        // nanoseconds of each component per simulated cycle and their shares of the run of milliseconds
+        static void print( std::ostream& out, double time, double cycles)
+        {
+            const double total = time * 1e6;
+            const auto per_cycle = [cycles]( double nanoseconds) { return cycles == 0 ? 0. : nanoseconds / cycles; };
+            out << "host time:  " << per_cycle( total) << " ns per cycle";
+            for ( size_t i = 0; i < counters.size(); ++i)
+            {
+                const double nanoseconds = get_nanoseconds( static_cast<HostComponent>( i));
+                out << std::endl << "  " << std::left << std::setw( 17) << names.at( i) << std::right
+                    << per_cycle( nanoseconds) << " (" << ( total == 0 ? 0. : nanoseconds * 100 / total) << "%)";
+            }
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        static constexpr const size_t COMPONENTS_NUM = static_cast<size_t>( HostComponent::COMPONENTS_NUM);
+
+        static size_t index( HostComponent component) { return static_cast<size_t>( component); }
+
+        static double get_nanoseconds_per_tick()
+        {
+            const double ticks = static_cast<double>( read_clock() - start_ticks);
+            const double nanoseconds = std::chrono::duration<double, std::nano>( Clock::now() - start_time).count();
+            return ticks == 0 ? 0. : nanoseconds / ticks;
+        }
+
+        static inline std::array<std::atomic<uint64>, COMPONENTS_NUM> counters = {};
+        static inline const uint64 start_ticks = read_clock();
+        static inline const Clock::time_point start_time = Clock::now();
+        static inline const std::array<std::string, COMPONENTS_NUM> names =
+            {{ "fetch", "decode", "execute", "mem", "writeback", "checker", "instr_memory", "ports"}};
+};
+
+// Scope of the component till the end of the block, e.g. SELF_PROFILE( FETCH);
+// Build with SELF_PROFILING to measure components, otherwise the scopes are removed from the code
+#ifdef SELF_PROFILING
+#define SELF_PROFILE( component) const SelfProfiler::Scope self_profile_scope( HostComponent::component)
+#else
+#define SELF_PROFILE( component) static_cast<void>( 0)
+#endif
+
+#endif // SELF_PROFILER_H
@@ -0,0 +1,51 @@
+// Google Test library
+#include <gtest/gtest.h>
+
+// Module
+#include "../self_profiler.h"
+
+#include <sstream>
+#include <thread>
+
+TEST( Self_Profiler, Scopes)
+{
+    SelfProfiler::reset();
+    {
+        const SelfProfiler::Scope scope( HostComponent::WRITEBACK);
+        const SelfProfiler::Scope nested( HostComponent::CHECKER);
+        std::this_thread::sleep_for( std::chrono::milliseconds( 2));
+    }
+    ASSERT_EQ( SelfProfiler::get_ticks( HostComponent::FETCH), 0u);
+    ASSERT_GE( SelfProfiler::get_ticks( HostComponent::WRITEBACK), SelfProfiler::get_ticks( HostComponent::CHECKER));
+    ASSERT_GE( SelfProfiler::get_nanoseconds( HostComponent::CHECKER), 1e6);
+
+    SelfProfiler::reset();
+    ASSERT_EQ( SelfProfiler::get_ticks( HostComponent::WRITEBACK), 0u);
+}
+
+TEST( Self_Profiler, Print)
+{
+    SelfProfiler::reset();
+    std::ostringstream out;
+    SelfProfiler::print( out, 1, 1000);
+    ASSERT_EQ( out.str().find( "host time:  1000 ns per cycle\n  fetch            0 (0%)\n"), 0u);
+    ASSERT_NE( out.str().find( "  ports            0 (0%)"), std::string::npos);
+}
+
+// scopes are compiled only with SELF_PROFILING
+TEST( Self_Profiler, Macro)
+{
+    SelfProfiler::reset();
+    {
+        SELF_PROFILE( PORTS);
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1));
+    }
+    ASSERT_EQ( SelfProfiler::get_ticks( HostComponent::PORTS) != 0, SelfProfiler::is_enabled);
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+/**
+ * phases.cpp - statistics of simulation intervals and detection of program phases
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "phases.h"
+
+#include <cmath>
+#include <numeric>
+#include <sstream>
+
+PhaseDetector::PhaseDetector( double threshold, size_t max_phases)
+    : threshold( threshold)
+    , max_phases( std::max<size_t>( max_phases, 1))
+{ }
+
+double PhaseDetector::distance( const std::vector<double>& lhs, const std::vector<double>& rhs)
+{
+    double difference = 0;
+    double total = 0;
+    for ( size_t i = 0; i < std::min( lhs.size(), rhs.size()); ++i)
+    {
+        difference += std::abs( lhs[ i] - rhs[ i]);
+        total += lhs[ i] + rhs[ i];
+    }
+    return total == 0 ? 0 : difference / total;
+}
+
+size_t PhaseDetector::find_nearest( const std::vector<double>& signature) const
+{
+    size_t nearest = 0;
+    for ( size_t i = 1; i < phases.size(); ++i)
+        if ( distance( signature, phases[ i].centroid) < distance( signature, phases[ nearest].centroid))
+            nearest = i;
+    return nearest;
+}
+
+size_t PhaseDetector::classify( const std::vector<double>& signature)
+{
+    size_t id = current;
+    if ( phases.empty())
+    {
+        phases.push_back( { signature, 0});
+    }
+    else if ( distance( signature, phases[ current].centroid) >= threshold)
+    {
+        id = find_nearest( signature);
+        if ( distance( signature, phases[ id].centroid) >= threshold && phases.size() < max_phases)
+        {
+            id = phases.size();
+            phases.push_back( { signature, 0});
+        }
+    }
+
+    is_changed = id != current;
+    changes += is_changed ? 1 : 0;
+    current = id;
+
+    auto& phase = phases[ id];
+    ++phase.intervals;
+    for ( size_t i = 0; i < std::min( signature.size(), phase.centroid.size()); ++i)
+        phase.centroid[ i] += ( signature[ i] - phase.centroid[ i]) / static_cast<double>( phase.intervals);
+
+    return id;
+}
+
+PhaseFile::PhaseFile( const StatsRegistry& registry, const std::string& filename, std::vector<Metric> metrics, double threshold)
+    : writer( filename, 1 << 16)
+    , metrics( std::move( metrics))
+    , detector( threshold)
+{
+    std::ostringstream header;
+    header << "interval,cycle,cycles,instrs";
+    for ( const auto& metric : this->metrics)
+    {
+        header << ',' << metric.name;
+
+        Counters entry;
+        for ( const auto& name : metric.numerator)
+            entry.numerator.push_back( registry.get_counter_address( name));
+        for ( const auto& name : metric.denominator)
+            entry.denominator.push_back( registry.get_counter_address( name));
+        entry.last_numerator = sum( entry.numerator);
+        entry.last_denominator = sum( entry.denominator);
+        counters.push_back( std::move( entry));
+    }
+    header << ",phase,change" << std::endl;
+
+    const auto row = header.str();
+    writer.write( row.data(), row.size());
+}
+
+uint64 PhaseFile::sum( const std::vector<const uint64*>& counters)
+{
+    return std::accumulate( counters.begin(), counters.end(), uint64{ 0}, []( uint64 total, const uint64* counter) { return total + *counter; });
+}
+
+void PhaseFile::write( Cycle cycle, uint64 instrs)
+{
+    // the end of simulation may coincide with the end of the last interval
+    if ( cycle == last_cycle)
+        return;
+
+    const uint64 cycles = ( cycle - last_cycle).to_size_t();
+    std::ostringstream row;
+    row << intervals++ << ',' << cycle << ',' << cycles << ',' << instrs - last_instrs;
+
+    std::vector<double> signature;
+    for ( size_t i = 0; i < metrics.size(); ++i)
+    {
+        auto& entry = counters[ i];
+        const uint64 numerator = sum( entry.numerator);
+        const uint64 denominator = entry.denominator.empty() ? cycles : sum( entry.denominator) - entry.last_denominator;
+        const double ratio = denominator == 0 ? 0 : static_cast<double>( numerator - entry.last_numerator) / static_cast<double>( denominator);
+        const double value = metrics[ i].is_complement ? 1 - ratio : ratio;
+        entry.last_numerator = numerator;
+        entry.last_denominator = entry.denominator.empty() ? 0 : sum( entry.denominator);
+
+        row << ',' << value;
+        if ( metrics[ i].is_signature)
+            signature.push_back( value);
+    }
+
+    const auto phase = detector.classify( signature);
+    row << ',' << phase << ',' << ( detector.is_change() ? 1 : 0) << std::endl;
+
+    const auto text = row.str();
+    writer.write( text.data(), text.size());
+    last_cycle = cycle;
+    last_instrs = instrs;
+}
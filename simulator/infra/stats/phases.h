@@ -0,0 +1,103 @@
+/**
+ * phases.h - statistics of simulation intervals and detection of program phases
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef PHASES_H
+#define PHASES_H
+
+#include <infra/async_writer/async_writer.h>
+#include <infra/ports/timing.h>
+#include <infra/types.h>
+
+#include "stats.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * Intervals are classified online by signatures of non-negative values.
+ * The interval joins the phase of the nearest centroid if their relative
+ * Manhattan distance is below the threshold, and the current phase is preferred,
+ * so noise does not switch phases. Otherwise, a new phase is started;
+ * if there are too many phases, the nearest one is taken anyway.
+ * Centroids are running means of signatures of their intervals.
+ */
+class PhaseDetector
+{
+    public:
+        explicit PhaseDetector( double threshold, size_t max_phases = 16);
+
+        // returns the phase of the interval
+        size_t classify( const std::vector<double>& signature);
+
+        bool is_change() const { return is_changed; }
+        size_t get_phases() const { return phases.size(); }
+        size_t get_changes() const { return changes; }
+
+        // relative Manhattan distance from 0 for the same vectors to 1 for disjoint ones
+        static double distance( const std::vector<double>& lhs, const std::vector<double>& rhs);
+
+    private:
+        struct Phase
+        {
+            std::vector<double> centroid;
+            uint64 intervals = 0;
+        };
+
+        const double threshold;
+        const size_t max_phases;
+        std::vector<Phase> phases = {};
+        size_t current = 0;
+        bool is_changed = false;
+        size_t changes = 0;
+
+        size_t find_nearest( const std::vector<double>& signature) const;
+};
+
+/*
+ * CSV table with a row per interval: its cycles, instructions and metrics,
+ * which are ratios of increments of the counters during the interval,
+ * then the detected phase and whether it is changed. Rows are written
+ * by a background thread, so the simulation does not wait for the disk.
+ */
+class PhaseFile
+{
+    public:
+        struct Metric
+        {
+            std::string name;
+            std::vector<std::string> numerator;   // counters which are summed up
+            std::vector<std::string> denominator; // counters which are summed up, cycles if it is empty
+            bool is_complement = false;           // the value is 1 minus the ratio
+            bool is_signature = false;            // the value is used to detect phases
+        };
+
+        PhaseFile( const StatsRegistry& registry, const std::string& filename, std::vector<Metric> metrics, double threshold);
+
+        // ends the interval at the cycle with the total number of executed instructions
+        void write( Cycle cycle, uint64 instrs);
+        const PhaseDetector& get_detector() const { return detector; }
+
+    private:
+        struct Counters
+        {
+            std::vector<const uint64*> numerator;
+            std::vector<const uint64*> denominator;
+            uint64 last_numerator = 0;
+            uint64 last_denominator = 0;
+        };
+
+        static uint64 sum( const std::vector<const uint64*>& counters);
+
+        AsyncWriter writer;
+        const std::vector<Metric> metrics;
+        std::vector<Counters> counters;
+        PhaseDetector detector;
+
+        uint64 intervals = 0;
+        Cycle last_cycle = 0_Cl;
+        uint64 last_instrs = 0;
+};
+
+#endif // PHASES_H
@@ -0,0 +1,142 @@
+/**
+ * stats.cpp - registry of performance counters of simulated units
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "stats.h"
+
+#include <cstdlib>
+#include <iostream>
+
+void StatsRegistry::check_name( const std::string& name) const
+{
+    const auto is_same = [&name]( const auto& entry) { return entry.first == name; };
+    if ( name.empty()
+      || std::any_of( counters.begin(), counters.end(), is_same)
+      || std::any_of( histograms.begin(), histograms.end(), is_same))
+    {
+        std::cerr << "ERROR. Invalid or duplicated statistics counter \"" << name << "\"" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+}
+
+void StatsRegistry::add_counter( const std::string& name, const uint64* counter)
+{
+    check_name( name);
+    counters.emplace_back( name, counter);
+}
+
+void StatsRegistry::add_histogram( const std::string& name, const Histogram* histogram)
+{
+    check_name( name);
+    histograms.emplace_back( name, histogram);
+}
+
+const uint64* StatsRegistry::find_counter( const std::string& name) const
+{
+    const auto it = std::find_if( counters.begin(), counters.end(),
+                                  [&name]( const auto& entry) { return entry.first == name; });
+    return it == counters.end() ? nullptr : it->second;
+}
+
+const uint64* StatsRegistry::get_counter_address( const std::string& name) const
+{
+    const auto* counter = find_counter( name);
+    if ( counter == nullptr)
+    {
+        std::cerr << "ERROR. Unknown statistics counter \"" << name << "\"" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+    return counter;
+}
+
+std::map<std::string, uint64> StatsRegistry::get_values() const
+{
+    std::map<std::string, uint64> values;
+    for ( const auto& entry : counters)
+        values.emplace( entry.first, *entry.second);
+    return values;
+}
+
+void StatsRegistry::dump_json( std::ostream& out, Cycle cycle) const
+{
+    out << "{ \"cycle\": " << cycle;
+    for ( const auto& [name, counter] : counters)
+        out << ", \"" << name << "\": " << *counter;
+
+    for ( const auto& [name, histogram] : histograms)
+    {
+        out << ", \"" << name << "\": [";
+        for ( size_t i = 0; i < histogram->size(); ++i)
+            out << ( i == 0 ? "" : ", ") << ( *histogram)[ i];
+        out << "]";
+    }
+    out << " }";
+}
+
+void StatsRegistry::dump_csv_header( std::ostream& out) const
+{
+    out << "cycle";
+    for ( const auto& entry : counters)
+        out << ',' << entry.first;
+
+    for ( const auto& [name, histogram] : histograms)
+        for ( size_t i = 0; i < histogram->size(); ++i)
+            out << ',' << name << '.' << i;
+    out << std::endl;
+}
+
+void StatsRegistry::dump_csv_row( std::ostream& out, Cycle cycle) const
+{
+    out << cycle;
+    for ( const auto& entry : counters)
+        out << ',' << *entry.second;
+
+    for ( const auto& entry : histograms)
+        for ( size_t i = 0; i < entry.second->size(); ++i)
+            out << ',' << ( *entry.second)[ i];
+    out << std::endl;
+}
+
+StatsFile::StatsFile( const StatsRegistry& registry, const std::string& filename, const std::string& format)
+    : registry( registry)
+    , out( filename)
+    , is_json( format == "json")
+{
+    if ( format != "json" && format != "csv")
+    {
+        std::cerr << "ERROR. Invalid statistics format " << format << ", supported formats: json, csv" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    if ( !out.is_open())
+    {
+        std::cerr << "ERROR. Could not open statistics file " << filename << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    if ( is_json)
+        out << "[";
+    else
+        registry.dump_csv_header( out);
+}
+
+StatsFile::~StatsFile()
+{
+    if ( is_json)
+        out << std::endl << "]" << std::endl;
+}
+
+void StatsFile::write( Cycle cycle)
+{
+    if ( is_json)
+    {
+        out << ( is_empty ? "" : ",") << std::endl << "  ";
+        registry.dump_json( out, cycle);
+    }
+    else
+    {
+        registry.dump_csv_row( out, cycle);
+    }
+    is_empty = false;
+}
@@ -0,0 +1,92 @@
+/**
+ * stats.h - registry of performance counters of simulated units
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <infra/ports/timing.h>
+#include <infra/types.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Number of events of each value, values out of range are counted by the last bucket
+class Histogram
+{
+    public:
+        explicit Histogram( size_t size) : buckets( std::max<size_t>( size, 1), 0) { }
+
+        void add( size_t value) { ++buckets[ std::min( value, buckets.size() - 1)]; }
+
+        size_t size() const { return buckets.size(); }
+        uint64 operator[]( size_t index) const { return buckets.at( index); }
+
+    private:
+        std::vector<uint64> buckets;
+};
+
+/*
+ * Counters are plain integers owned by units, which increment them in place.
+ * The registry keeps their addresses together with hierarchical names
+ * like "fetch.icache.misses", so all of them are dumped at once.
+ * Units register their counters once, and they must outlive the registry.
+ */
+class StatsRegistry
+{
+    public:
+        void add_counter( const std::string& name, const uint64* counter);
+        void add_histogram( const std::string& name, const Histogram* histogram);
+
+        bool has_counter( const std::string& name) const { return find_counter( name) != nullptr; }
+        uint64 get_counter( const std::string& name) const { return *get_counter_address( name); }
+        // counter is read in place by the address, e.g. at the ends of intervals
+        const uint64* get_counter_address( const std::string& name) const;
+        // current values of all the counters by their names
+        std::map<std::string, uint64> get_values() const;
+
+        // writes values of all the counters at the cycle as one JSON object
+        void dump_json( std::ostream& out, Cycle cycle) const;
+
+        // CSV table has a column per counter and per bucket of histogram
+        void dump_csv_header( std::ostream& out) const;
+        void dump_csv_row( std::ostream& out, Cycle cycle) const;
+
+    private:
+        // counters are kept in order of registration, which is the order of columns
+        std::vector<std::pair<std::string, const uint64*>> counters = {};
+        std::vector<std::pair<std::string, const Histogram*>> histograms = {};
+
+        const uint64* find_counter( const std::string& name) const;
+        void check_name( const std::string& name) const;
+};
+
+/*
+ * File with snapshots of the registry: JSON array of objects
+ * or CSV table with a row per snapshot
+ */
+class StatsFile
+{
+    public:
+        StatsFile( const StatsRegistry& registry, const std::string& filename, const std::string& format);
+        ~StatsFile();
+
+        void write( Cycle cycle);
+
+        StatsFile( const StatsFile&) = delete;
+        StatsFile( StatsFile&&) = delete;
+        StatsFile& operator=( const StatsFile&) = delete;
+        StatsFile& operator=( StatsFile&&) = delete;
+
+    private:
+        const StatsRegistry& registry;
+        std::ofstream out;
+        const bool is_json;
+        bool is_empty = true;
+};
+
+#endif // STATS_H
@@ -0,0 +1,209 @@
+// Google Test Library
+#include <gtest/gtest.h>
+
+// Module
+#include "../phases.h"
+#include "../stats.h"
+#include "../telemetry.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+TEST( Stats, Histogram)
+{
+    Histogram histogram( 3);
+    histogram.add( 0);
+    histogram.add( 2);
+    histogram.add( 10);
+
+    ASSERT_EQ( histogram.size(), 3u);
+    ASSERT_EQ( histogram[ 0], 1u);
+    ASSERT_EQ( histogram[ 1], 0u);
+    ASSERT_EQ( histogram[ 2], 2u);
+}
+
+TEST( Stats, Counters_Are_Read_In_Place)
+{
+    StatsRegistry stats;
+    uint64 counter = 0;
+    stats.add_counter( "unit.events", &counter);
+
+    ++counter;
+    ++counter;
+    ASSERT_TRUE( stats.has_counter( "unit.events"));
+    ASSERT_FALSE( stats.has_counter( "unit.other"));
+    ASSERT_EQ( stats.get_counter( "unit.events"), 2u);
+}
+
+TEST( Stats, Invalid_Names)
+{
+    StatsRegistry stats;
+    uint64 counter = 0;
+    Histogram histogram( 2);
+    stats.add_counter( "unit.events", &counter);
+
+    ASSERT_EXIT( stats.add_counter( "unit.events", &counter), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( stats.add_histogram( "unit.events", &histogram), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( stats.add_counter( "", &counter), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( stats.get_counter( "unit.other"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Stats, Dump)
+{
+    StatsRegistry stats;
+    uint64 hits = 5;
+    uint64 misses = 1;
+    Histogram histogram( 2);
+    histogram.add( 1);
+    stats.add_counter( "cache.hits", &hits);
+    stats.add_counter( "cache.misses", &misses);
+    stats.add_histogram( "decode.width", &histogram);
+
+    std::ostringstream json;
+    stats.dump_json( json, 100_Cl);
+    ASSERT_EQ( json.str(), "{ \"cycle\": 100, \"cache.hits\": 5, \"cache.misses\": 1, \"decode.width\": [0, 1] }");
+
+    std::ostringstream csv;
+    stats.dump_csv_header( csv);
+    stats.dump_csv_row( csv, 100_Cl);
+    ASSERT_EQ( csv.str(), "cycle,cache.hits,cache.misses,decode.width.0,decode.width.1\n100,5,1,0,1\n");
+}
+
+TEST( Stats, File)
+{
+    StatsRegistry stats;
+    uint64 counter = 0;
+    stats.add_counter( "unit.events", &counter);
+    {
+        StatsFile file( stats, "stats_test.json", "json");
+        file.write( 10_Cl);
+        counter = 3;
+        file.write( 20_Cl);
+    }
+    {
+        StatsFile file( stats, "stats_test.csv", "csv");
+        file.write( 20_Cl);
+    }
+
+    std::ifstream json( "stats_test.json");
+    const std::string json_content( ( std::istreambuf_iterator<char>( json)), std::istreambuf_iterator<char>());
+    ASSERT_EQ( json_content, "[\n  { \"cycle\": 10, \"unit.events\": 0 },\n  { \"cycle\": 20, \"unit.events\": 3 }\n]\n");
+
+    std::ifstream csv( "stats_test.csv");
+    const std::string csv_content( ( std::istreambuf_iterator<char>( csv)), std::istreambuf_iterator<char>());
+    ASSERT_EQ( csv_content, "cycle,unit.events\n20,3\n");
+
+    ASSERT_EXIT( StatsFile( stats, "stats_test.xml", "xml"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( StatsFile( stats, "./no/such/dir/stats.json", "json"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Phases, Distance)
+{
+    ASSERT_EQ( PhaseDetector::distance( { 1, 2}, { 1, 2}), 0);
+    ASSERT_EQ( PhaseDetector::distance( { 1, 0}, { 0, 1}), 1);
+    ASSERT_EQ( PhaseDetector::distance( { 0, 0}, { 0, 0}), 0);
+    ASSERT_DOUBLE_EQ( PhaseDetector::distance( { 3, 1}, { 1, 1}), 1. / 3);
+}
+
+TEST( Phases, Detector)
+{
+    PhaseDetector detector( 0.2, 2);
+    ASSERT_EQ( detector.classify( { 1, 0.1}), 0u);
+    ASSERT_FALSE( detector.is_change());
+    ASSERT_EQ( detector.classify( { 1.1, 0.1}), 0u);
+    ASSERT_EQ( detector.classify( { 0.1, 2}), 1u);
+    ASSERT_TRUE( detector.is_change());
+    ASSERT_EQ( detector.classify( { 0.1, 2.1}), 1u);
+    ASSERT_FALSE( detector.is_change());
+
+    // the phase returns, and the limit of phases joins a new one to the nearest
+    ASSERT_EQ( detector.classify( { 1, 0.1}), 0u);
+    ASSERT_EQ( detector.classify( { 5, 5}), 1u);
+    ASSERT_EQ( detector.get_phases(), 2u);
+    ASSERT_EQ( detector.get_changes(), 3u);
+}
+
+TEST( Phases, File)
+{
+    StatsRegistry stats;
+    uint64 instrs = 10;
+    uint64 hits = 0;
+    uint64 misses = 0;
+    stats.add_counter( "unit.instrs", &instrs);
+    stats.add_counter( "unit.hits", &hits);
+    stats.add_counter( "unit.misses", &misses);
+    {
+        PhaseFile file( stats, "phases_test.csv", {
+            { "ipc", { "unit.instrs"}, { }, false, true},
+            { "hit_rate", { "unit.misses"}, { "unit.hits", "unit.misses"}, true, false}
+        }, 0.25);
+
+        // counters are taken by increments since the file is opened
+        instrs += 50;
+        hits = 3;
+        misses = 1;
+        file.write( 100_Cl, 50);
+        instrs += 200;
+        file.write( 200_Cl, 250);
+        file.write( 200_Cl, 250);
+        ASSERT_EQ( file.get_detector().get_phases(), 2u);
+    }
+
+    std::ifstream csv( "phases_test.csv");
+    const std::string csv_content( ( std::istreambuf_iterator<char>( csv)), std::istreambuf_iterator<char>());
+    ASSERT_EQ( csv_content, "interval,cycle,cycles,instrs,ipc,hit_rate,phase,change\n"
+                            "0,100,100,50,0.5,0.75,0,0\n"
+                            "1,200,100,200,2,1,1,1\n");
+
+    ASSERT_EXIT( PhaseFile( stats, "phases_test.csv", { { "ipc", { "unit.cycles"}, { }, false, true}}, 0.25),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( Telemetry, Values_Are_Shared)
+{
+    StatsRegistry stats;
+    uint64 misses = 3;
+    stats.add_counter( "unit.misses", &misses);
+
+    TelemetryFile file( stats, "telemetry_test.bin", { "unit.misses"});
+    const TelemetryReader reader( "telemetry_test.bin");
+    ASSERT_EQ( reader.read().updates, 0u);
+
+    file.publish( 200_Cl, 100);
+    auto sample = reader.read();
+    ASSERT_EQ( sample.updates, 1u);
+    ASSERT_FALSE( sample.is_finished);
+    ASSERT_EQ( sample.instrs, 100u);
+    ASSERT_EQ( sample.cycles, 200u);
+    ASSERT_DOUBLE_EQ( sample.get_ipc(), 0.5);
+    ASSERT_EQ( sample.counters, ( std::vector<std::pair<std::string, uint64>>{ { "unit.misses", 3}}));
+
+    misses = 5;
+    file.finish( 300_Cl, 240);
+    sample = reader.read();
+    ASSERT_EQ( sample.updates, 2u);
+    ASSERT_TRUE( sample.is_finished);
+    ASSERT_EQ( sample.instrs, 240u);
+    ASSERT_EQ( sample.counters.at( 0).second, 5u);
+    ASSERT_GT( sample.pid, 0u);
+}
+
+TEST( Telemetry, Invalid)
+{
+    StatsRegistry stats;
+    ASSERT_EXIT( TelemetryFile( stats, "telemetry_test.bin", { "unit.other"}), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( TelemetryFile( stats, "telemetry_test.bin", std::vector<std::string>( 100, "unit.other")),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+
+    std::ofstream( "telemetry_other.bin") << "not a telemetry file";
+    ASSERT_EXIT( TelemetryReader( "telemetry_other.bin"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( TelemetryReader( "telemetry_missing.bin"), ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,145 @@
+/**
+ * telemetry.cpp - progress and counters of running simulation shared with other processes
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include "telemetry.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+#ifdef _WIN32
+#include <process.h>
+static uint64 get_process_id() { return static_cast<uint64>( _getpid()); }
+#else
+#include <unistd.h>
+static uint64 get_process_id() { return static_cast<uint64>( getpid()); }
+#endif
+
+namespace ipc = boost::interprocess;
+
+struct TelemetryFile::Mapping
+{
+    ipc::file_mapping file;
+    ipc::mapped_region region;
+};
+
+struct TelemetryReader::Mapping
+{
+    ipc::file_mapping file;
+    ipc::mapped_region region;
+};
+
+TelemetryFile::TelemetryFile( const StatsRegistry& registry, const std::string& filename, const std::vector<std::string>& names)
+{
+    if ( names.size() > TelemetryRecord::MAX_COUNTERS)
+    {
+        std::cerr << "ERROR. Telemetry file keeps up to " << TelemetryRecord::MAX_COUNTERS << " counters" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    // the file is filled with zeroes, so the record is not valid until the magic is written
+    {
+        std::ofstream out( filename, std::ios::binary | std::ios::trunc);
+        const std::vector<char> zeroes( sizeof( TelemetryRecord), 0);
+        out.write( zeroes.data(), static_cast<std::streamsize>( zeroes.size()));
+        if ( !out)
+        {
+            std::cerr << "ERROR. Could not create telemetry file " << filename << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+    }
+
+    try {
+        ipc::file_mapping file( filename.c_str(), ipc::read_write);
+        ipc::mapped_region region( file, ipc::read_write, 0, sizeof( TelemetryRecord));
+        mapping = std::make_unique<Mapping>( Mapping{ std::move( file), std::move( region)});
+    }
+    catch ( const ipc::interprocess_exception& e) {
+        std::cerr << "ERROR. Could not map telemetry file " << filename << ": " << e.what() << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    record = new ( mapping->region.get_address()) TelemetryRecord;
+    for ( size_t i = 0; i < names.size(); ++i)
+    {
+        if ( names[ i].size() >= TelemetryRecord::NAME_SIZE)
+        {
+            std::cerr << "ERROR. Too long name of telemetry counter \"" << names[ i] << "\"" << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+        names[ i].copy( record->names.at( i).data(), names[ i].size());
+        counters.push_back( registry.get_counter_address( names[ i]));
+    }
+
+    record->pid = get_process_id();
+    record->counters_num = names.size();
+    record->magic = TelemetryRecord::MAGIC;
+    record->updates.store( 0, std::memory_order_release);
+}
+
+TelemetryFile::~TelemetryFile() = default;
+
+void TelemetryFile::publish( Cycle cycle, uint64 instrs)
+{
+    const auto host_time = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start_time);
+    record->instrs.store( instrs, std::memory_order_relaxed);
+    record->cycles.store( ( cycle - 0_Cl).to_size_t(), std::memory_order_relaxed);
+    record->host_nanoseconds.store( static_cast<uint64>( host_time.count()), std::memory_order_relaxed);
+    for ( size_t i = 0; i < counters.size(); ++i)
+        record->values.at( i).store( *counters[ i], std::memory_order_relaxed);
+    record->updates.fetch_add( 1, std::memory_order_release);
+}
+
+void TelemetryFile::finish( Cycle cycle, uint64 instrs)
+{
+    record->is_finished.store( 1, std::memory_order_relaxed);
+    publish( cycle, instrs);
+}
+
+TelemetryReader::TelemetryReader( const std::string& filename)
+{
+    try {
+        ipc::file_mapping file( filename.c_str(), ipc::read_only);
+        ipc::mapped_region region( file, ipc::read_only);
+        mapping = std::make_unique<Mapping>( Mapping{ std::move( file), std::move( region)});
+    }
+    catch ( const ipc::interprocess_exception& e) {
+        std::cerr << "ERROR. Could not map telemetry file " << filename << ": " << e.what() << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    record = static_cast<const TelemetryRecord*>( mapping->region.get_address());
+    if ( mapping->region.get_size() < sizeof( TelemetryRecord) || record->magic != TelemetryRecord::MAGIC
+        || record->counters_num > TelemetryRecord::MAX_COUNTERS)
+    {
+        std::cerr << "ERROR. " << filename << " is not a telemetry file" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+}
+
+TelemetryReader::~TelemetryReader() = default;
+
+TelemetryReader::Sample TelemetryReader::read() const
+{
+    Sample sample;
+    sample.updates = record->updates.load( std::memory_order_acquire);
+    sample.pid = record->pid;
+    sample.is_finished = record->is_finished.load( std::memory_order_relaxed) != 0;
+    sample.instrs = record->instrs.load( std::memory_order_relaxed);
+    sample.cycles = record->cycles.load( std::memory_order_relaxed);
+    sample.host_nanoseconds = record->host_nanoseconds.load( std::memory_order_relaxed);
+    for ( size_t i = 0; i < record->counters_num; ++i)
+    {
+        const auto& name = record->names.at( i);
+        sample.counters.emplace_back( std::string( name.begin(), std::find( name.begin(), name.end(), '\0')),
+                                      record->values.at( i).load( std::memory_order_relaxed));
+    }
+    return sample;
+}
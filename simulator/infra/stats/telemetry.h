@@ -0,0 +1,116 @@
+/**
+ * telemetry.h - progress and counters of running simulation shared with other processes
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <infra/ports/timing.h>
+#include <infra/types.h>
+
+#include "stats.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Fixed layout of the memory-mapped file. The writer fills the names once,
+ * then each publication is a few relaxed stores of the values, and the number
+ * of updates is stored last with release order, so readers see the values
+ * of the same or a later publication. Fields are native integers,
+ * so the file is read on the same host only.
+ */
+struct TelemetryRecord
+{
+    static constexpr const uint64 MAGIC = 0x4d49505354454c45; // "MIPSTELE"
+    static constexpr const size_t MAX_COUNTERS = 32;
+    static constexpr const size_t NAME_SIZE = 64;
+
+    uint64 magic;
+    uint64 pid;
+    uint64 counters_num;
+    std::array<std::array<char, NAME_SIZE>, MAX_COUNTERS> names;
+
+    std::atomic<uint64> updates;
+    std::atomic<uint64> is_finished;
+    std::atomic<uint64> instrs;
+    std::atomic<uint64> cycles;
+    std::atomic<uint64> host_nanoseconds;
+    std::array<std::atomic<uint64>, MAX_COUNTERS> values;
+};
+
+static_assert( std::atomic<uint64>::is_always_lock_free, "atomic integers in shared memory must be lock-free");
+
+/*
+ * The file is created at the start of simulation and mapped to its memory,
+ * so publication does no I/O, and the pages are written back by the host.
+ * Counters are read in place from the registry.
+ */
+class TelemetryFile
+{
+    public:
+        TelemetryFile( const StatsRegistry& registry, const std::string& filename, const std::vector<std::string>& counters);
+        ~TelemetryFile();
+
+        // progress at the cycle with the total number of executed instructions
+        void publish( Cycle cycle, uint64 instrs);
+        // the last publication, readers stop waiting for the simulation
+        void finish( Cycle cycle, uint64 instrs);
+
+        TelemetryFile( const TelemetryFile&) = delete;
+        TelemetryFile( TelemetryFile&&) = delete;
+        TelemetryFile& operator=( const TelemetryFile&) = delete;
+        TelemetryFile& operator=( TelemetryFile&&) = delete;
+
+    private:
+        struct Mapping;
+
+        std::unique_ptr<Mapping> mapping;
+        TelemetryRecord* record = nullptr;
+        std::vector<const uint64*> counters;
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+};
+
+// Reads files of other processes, e.g. with mipt-mips-top
+class TelemetryReader
+{
+    public:
+        struct Sample
+        {
+            uint64 pid = 0;
+            uint64 updates = 0;
+            bool is_finished = false;
+            uint64 instrs = 0;
+            uint64 cycles = 0;
+            uint64 host_nanoseconds = 0;
+            std::vector<std::pair<std::string, uint64>> counters = {};
+
+            double get_ipc() const { return cycles == 0 ? 0 : static_cast<double>( instrs) / static_cast<double>( cycles); }
+            // thousands of simulated instructions per second of the host
+            double get_kips() const { return host_nanoseconds == 0 ? 0 : static_cast<double>( instrs) * 1e6 / static_cast<double>( host_nanoseconds); }
+        };
+
+        explicit TelemetryReader( const std::string& filename);
+        ~TelemetryReader();
+
+        Sample read() const;
+
+        TelemetryReader( const TelemetryReader&) = delete;
+        TelemetryReader( TelemetryReader&&) = delete;
+        TelemetryReader& operator=( const TelemetryReader&) = delete;
+        TelemetryReader& operator=( TelemetryReader&&) = delete;
+
+    private:
+        struct Mapping;
+
+        std::unique_ptr<Mapping> mapping;
+        const TelemetryRecord* record = nullptr;
+};
+
+#endif // TELEMETRY_H
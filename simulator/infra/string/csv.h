@@ -0,0 +1,29 @@
+/**
+ * csv.h - fields of comma-separated tables
+ * Copyright 2026 MIPT-MIPS team
+ */
+
+#ifndef INFRA_CSV_H
+#define INFRA_CSV_H
+
+#include <infra/string/string_view.h>
+
+#include <string>
+
+// Quotes the field if it has separators, quotes or line breaks, as RFC 4180 requires
+inline std::string csv_field( std::string_view value)
+{
+    if ( value.find_first_of( ",\"\r\n") == std::string_view::npos)
+        return std::string( value);
+
+    std::string result = "\"";
+    for ( const char c : value)
+    {
+        if ( c == '"')
+            result += '"';
+        result += c;
+    }
+    return result + '"';
+}
+
+#endif // INFRA_CSV_H
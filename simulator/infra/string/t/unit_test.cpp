@@ -5,6 +5,7 @@
 
 // uArchSim modules
 #include "../cow_string.h"
+#include "../csv.h"
 
 TEST( Cow_String, Equality)
 {
@@ -112,6 +113,15 @@ TEST( Cow_String, At)
     ASSERT_EQ( a[4], 'o');
 }
 
+TEST( CSV_Field, Quoting)
+{
+    ASSERT_EQ( csv_field( "fetch"), "fetch");
+    ASSERT_EQ( csv_field( ""), "");
+    ASSERT_EQ( csv_field( "fetch,writeback"), "\"fetch,writeback\"");
+    ASSERT_EQ( csv_field( "say \"hi\""), "\"say \"\"hi\"\"\"");
+    ASSERT_EQ( csv_field( "two\nlines"), "\"two\nlines\"");
+}
+
 int main( int argc, char* argv[])
 {
     ::testing::InitGoogleTest( &argc, argv);
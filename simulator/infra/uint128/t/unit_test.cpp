@@ -0,0 +1,141 @@
+// generic C++
+#include <random>
+#include <vector>
+
+// Google Test library
+#include <gtest/gtest.h>
+
+// Module
+#include <infra/macro.h>
+#include <infra/wide_types.h>
+#include "../uint128.h"
+
+static_assert( bitwidth<UInt128> == 128);
+static_assert( bitwidth<SInt128> == 128);
+static_assert( sizeof( UInt128) == 16);
+static_assert( UInt128( -1).get_high() == MAX_VAL64);
+static_assert( UInt128( MAX_VAL64).get_high() == 0);
+static_assert( ( UInt128( 1) << 64).get_high() == 1);
+static_assert( ( SInt128( -8) >> 1) == -4);
+static_assert( std::numeric_limits<SInt128>::max() == ~std::numeric_limits<SInt128>::min());
+static_assert( bitmask<UInt128>( 96) == ~UInt128() >> 32);
+
+TEST( UInt128, Limbs)
+{
+    const auto value = UInt128::from_limbs( 0x0123456789abcdefULL, 0xfedcba9876543210ULL);
+    ASSERT_EQ( value.get_high(), 0x0123456789abcdefULL);
+    ASSERT_EQ( value.get_low(), 0xfedcba9876543210ULL);
+    ASSERT_EQ( static_cast<uint32>( value), 0x76543210u);
+    ASSERT_EQ( static_cast<uint64>( value >> 64), 0x0123456789abcdefULL);
+    ASSERT_EQ( static_cast<uint64>( value >> 60), 0x123456789abcdeffULL);
+    ASSERT_EQ( ( value << 68).get_high(), 0xedcba98765432100ULL);
+    ASSERT_TRUE( static_cast<bool>( value));
+    ASSERT_FALSE( static_cast<bool>( UInt128()));
+}
+
+TEST( UInt128, Carries)
+{
+    const UInt128 max64 = MAX_VAL64;
+    ASSERT_EQ( max64 + 1, UInt128::from_limbs( 1, 0));
+    ASSERT_EQ( UInt128::from_limbs( 1, 0) - 1, max64);
+    ASSERT_EQ( UInt128() - 1, std::numeric_limits<UInt128>::max());
+    ASSERT_EQ( max64 * max64, UInt128::from_limbs( MAX_VAL64 - 1, 1));
+    ASSERT_EQ( -UInt128( 1), std::numeric_limits<UInt128>::max());
+}
+
+TEST( SInt128, Signed_Arithmetic)
+{
+    const SInt128 min = std::numeric_limits<SInt128>::min();
+    ASSERT_LT( min, SInt128( -1));
+    ASSERT_LT( SInt128( -1), SInt128( 0));
+    ASSERT_GT( UInt128( min), UInt128( 1));
+    ASSERT_EQ( SInt128( -7) / 2, -3);
+    ASSERT_EQ( SInt128( -7) % 2, -1);
+    ASSERT_EQ( SInt128( 7) / -2, -3);
+    ASSERT_EQ( SInt128( 7) % -2, 1);
+    ASSERT_EQ( min >> 127, -1);
+    ASSERT_EQ( static_cast<int64>( SInt128( -5) * 3), -15);
+}
+
+#if defined(__SIZEOF_INT128__)
+
+// the limbs are checked against the native type
+static std::vector<uint128> get_values()
+{
+    std::vector<uint128> values = { 0, 1, 2, 3, MAX_VAL64, uint128{ MAX_VAL64} + 1, ~uint128{ 0}, uint128{ 1} << 127, ( uint128{ 1} << 127) - 1};
+    std::mt19937_64 random( 42);
+    for ( size_t i = 0; i < 64; ++i)
+    {
+        const uint128 high = random() >> ( i % 64);
+        values.push_back( ( high << 64) | random());
+        values.push_back( random() >> ( i % 64));
+    }
+    return values;
+}
+
+static UInt128 to_limbs( uint128 value)
+{
+    return UInt128::from_limbs( static_cast<uint64>( value >> 64), static_cast<uint64>( value));
+}
+
+TEST( UInt128, Native_Unsigned)
+{
+    const auto values = get_values();
+    for ( const auto lhs : values)
+        for ( const auto rhs : values)
+        {
+            const auto a = to_limbs( lhs);
+            const auto b = to_limbs( rhs);
+            ASSERT_EQ( a + b, to_limbs( lhs + rhs));
+            ASSERT_EQ( a - b, to_limbs( lhs - rhs));
+            ASSERT_EQ( a * b, to_limbs( lhs * rhs));
+            ASSERT_EQ( a < b, lhs < rhs);
+            ASSERT_EQ( a == b, lhs == rhs);
+            if ( rhs != 0)
+            {
+                ASSERT_EQ( a / b, to_limbs( lhs / rhs));
+                ASSERT_EQ( a % b, to_limbs( lhs % rhs));
+            }
+        }
+
+    for ( const auto value : values)
+        for ( uint32 shift = 0; shift < 128; ++shift)
+        {
+            ASSERT_EQ( to_limbs( value) << shift, to_limbs( value << shift));
+            ASSERT_EQ( to_limbs( value) >> shift, to_limbs( value >> shift));
+        }
+}
+
+// signed operands are the regular values of the same bits
+TEST( SInt128, Native_Signed)
+{
+    const auto values = get_values();
+    for ( const auto lhs : values)
+        for ( const auto rhs : values)
+        {
+            const auto a = SInt128( to_limbs( lhs));
+            const auto b = SInt128( to_limbs( rhs));
+            const auto native_lhs = static_cast<int128>( lhs);
+            const auto native_rhs = static_cast<int128>( rhs);
+            ASSERT_EQ( a < b, native_lhs < native_rhs);
+            const bool is_overflow = native_lhs == std::numeric_limits<int128>::min() && native_rhs == -1;
+            if ( native_rhs != 0 && !is_overflow)
+            {
+                ASSERT_EQ( UInt128( a / b), to_limbs( static_cast<uint128>( native_lhs / native_rhs)));
+                ASSERT_EQ( UInt128( a % b), to_limbs( static_cast<uint128>( native_lhs % native_rhs)));
+            }
+        }
+
+    for ( const auto value : values)
+        for ( uint32 shift = 0; shift < 128; ++shift)
+            ASSERT_EQ( UInt128( SInt128( to_limbs( value)) >> shift), to_limbs( static_cast<uint128>( static_cast<int128>( value) >> shift)));
+}
+
+#endif // __SIZEOF_INT128__
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,251 @@
+/**
+ * uint128.h - 128-bit integers of two 64-bit limbs
+ * Copyright 2018 MIPT-MIPS project
+ */
+
+#ifndef UINT128_H
+#define UINT128_H
+
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include <infra/types.h>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+/*
+ * Integer of two's complement arithmetic on 128 bits, it behaves as the native
+ * unsigned __int128 or __int128, so it is used by compilers without them.
+ * Operations are inline, additions and multiplications of limbs use
+ * carry and wide multiplication intrinsics where they are available.
+ * Integers convert implicitly to the type, and explicitly from it.
+ */
+template<bool IS_SIGNED>
+class BasicInt128
+{
+public:
+    constexpr BasicInt128() noexcept = default;
+
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    constexpr BasicInt128( T value) noexcept : lo( static_cast<uint64>( value)), hi( extend_sign( value)) { }
+
+    explicit constexpr BasicInt128( BasicInt128<!IS_SIGNED> value) noexcept
+        : lo( value.get_low()), hi( value.get_high())
+    { }
+
+    static constexpr BasicInt128 from_limbs( uint64 high, uint64 low) noexcept
+    {
+        BasicInt128 result;
+        result.hi = high;
+        result.lo = low;
+        return result;
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    explicit constexpr operator T() const noexcept { return static_cast<T>( lo); }
+    explicit constexpr operator bool() const noexcept { return ( lo | hi) != 0; }
+
+    constexpr uint64 get_low() const noexcept { return lo; }
+    constexpr uint64 get_high() const noexcept { return hi; }
+    constexpr bool is_negative() const noexcept { return IS_SIGNED && ( hi >> 63) != 0; }
+
+    /* bitwise */
+    friend constexpr BasicInt128 operator~( BasicInt128 value) noexcept { return from_limbs( ~value.hi, ~value.lo); }
+    friend constexpr BasicInt128 operator&( BasicInt128 lhs, BasicInt128 rhs) noexcept { return from_limbs( lhs.hi & rhs.hi, lhs.lo & rhs.lo); }
+    friend constexpr BasicInt128 operator|( BasicInt128 lhs, BasicInt128 rhs) noexcept { return from_limbs( lhs.hi | rhs.hi, lhs.lo | rhs.lo); }
+    friend constexpr BasicInt128 operator^( BasicInt128 lhs, BasicInt128 rhs) noexcept { return from_limbs( lhs.hi ^ rhs.hi, lhs.lo ^ rhs.lo); }
+
+    // shift amount is less than 128, as for native types; right shift of signed integer is arithmetic
+    friend constexpr BasicInt128 operator<<( BasicInt128 value, uint32 shift) noexcept
+    {
+        if ( shift == 0)
+            return value;
+        if ( shift >= 64)
+            return from_limbs( value.lo << ( shift - 64), 0);
+        return from_limbs( ( value.hi << shift) | ( value.lo >> ( 64 - shift)), value.lo << shift);
+    }
+
+    friend constexpr BasicInt128 operator>>( BasicInt128 value, uint32 shift) noexcept
+    {
+        const uint64 fill = value.is_negative() ? ~uint64{ 0} : 0;
+        if ( shift == 0)
+            return value;
+        if ( shift >= 64)
+            return from_limbs( fill, shift == 64 ? value.hi : ( value.hi >> ( shift - 64)) | ( fill << ( 128 - shift)));
+        return from_limbs( ( value.hi >> shift) | ( fill << ( 64 - shift)), ( value.lo >> shift) | ( value.hi << ( 64 - shift)));
+    }
+
+    /* arithmetic */
+    friend constexpr BasicInt128 operator-( BasicInt128 value) noexcept { return from_limbs( ~value.hi + ( value.lo == 0 ? 1 : 0), ~value.lo + 1); }
+    friend constexpr BasicInt128 operator+( BasicInt128 value) noexcept { return value; }
+
+    friend BasicInt128 operator+( BasicInt128 lhs, BasicInt128 rhs) noexcept
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long long low = 0;
+        unsigned long long high = 0;
+        _addcarry_u64( _addcarry_u64( 0, lhs.lo, rhs.lo, &low), lhs.hi, rhs.hi, &high);
+        return from_limbs( high, low);
+#else
+        const uint64 low = lhs.lo + rhs.lo;
+        return from_limbs( lhs.hi + rhs.hi + ( low < lhs.lo ? 1 : 0), low);
+#endif
+    }
+
+    friend BasicInt128 operator-( BasicInt128 lhs, BasicInt128 rhs) noexcept
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long long low = 0;
+        unsigned long long high = 0;
+        _subborrow_u64( _subborrow_u64( 0, lhs.lo, rhs.lo, &low), lhs.hi, rhs.hi, &high);
+        return from_limbs( high, low);
+#else
+        return from_limbs( lhs.hi - rhs.hi - ( lhs.lo < rhs.lo ? 1 : 0), lhs.lo - rhs.lo);
+#endif
+    }
+
+    // low 128 bits of the product are the same for signed and unsigned operands
+    friend BasicInt128 operator*( BasicInt128 lhs, BasicInt128 rhs) noexcept
+    {
+        const auto low = multiply( lhs.lo, rhs.lo);
+        return from_limbs( low.hi + lhs.hi * rhs.lo + lhs.lo * rhs.hi, low.lo);
+    }
+
+    // division by zero is undefined, as for native types
+    friend BasicInt128 operator/( BasicInt128 lhs, BasicInt128 rhs) noexcept { return divide( lhs, rhs).first; }
+    friend BasicInt128 operator%( BasicInt128 lhs, BasicInt128 rhs) noexcept { return divide( lhs, rhs).second; }
+
+    BasicInt128& operator&=( BasicInt128 rhs) noexcept { return *this = *this & rhs; }
+    BasicInt128& operator|=( BasicInt128 rhs) noexcept { return *this = *this | rhs; }
+    BasicInt128& operator^=( BasicInt128 rhs) noexcept { return *this = *this ^ rhs; }
+    BasicInt128& operator<<=( uint32 shift) noexcept { return *this = *this << shift; }
+    BasicInt128& operator>>=( uint32 shift) noexcept { return *this = *this >> shift; }
+    BasicInt128& operator+=( BasicInt128 rhs) noexcept { return *this = *this + rhs; }
+    BasicInt128& operator-=( BasicInt128 rhs) noexcept { return *this = *this - rhs; }
+    BasicInt128& operator*=( BasicInt128 rhs) noexcept { return *this = *this * rhs; }
+    BasicInt128& operator/=( BasicInt128 rhs) noexcept { return *this = *this / rhs; }
+    BasicInt128& operator%=( BasicInt128 rhs) noexcept { return *this = *this % rhs; }
+    BasicInt128& operator++() noexcept { return *this = *this + 1; }
+    BasicInt128& operator--() noexcept { return *this = *this - 1; }
+
+    /* comparison, high limbs of signed integers are compared with sign */
+    friend constexpr bool operator==( BasicInt128 lhs, BasicInt128 rhs) noexcept { return lhs.hi == rhs.hi && lhs.lo == rhs.lo; }
+    friend constexpr bool operator!=( BasicInt128 lhs, BasicInt128 rhs) noexcept { return !( lhs == rhs); }
+    friend constexpr bool operator<( BasicInt128 lhs, BasicInt128 rhs) noexcept
+    {
+        if ( lhs.hi != rhs.hi)
+            return IS_SIGNED ? static_cast<int64>( lhs.hi) < static_cast<int64>( rhs.hi) : lhs.hi < rhs.hi;
+        return lhs.lo < rhs.lo;
+    }
+    friend constexpr bool operator>( BasicInt128 lhs, BasicInt128 rhs) noexcept { return rhs < lhs; }
+    friend constexpr bool operator<=( BasicInt128 lhs, BasicInt128 rhs) noexcept { return !( rhs < lhs); }
+    friend constexpr bool operator>=( BasicInt128 lhs, BasicInt128 rhs) noexcept { return !( lhs < rhs); }
+
+private:
+    template<typename T>
+    static constexpr uint64 extend_sign( T value) noexcept
+    {
+        if constexpr ( std::is_signed_v<T>)
+            return value < 0 ? ~uint64{ 0} : 0;
+        else
+            return 0;
+    }
+
+    struct Limbs
+    {
+        uint64 hi;
+        uint64 lo;
+    };
+
+    static Limbs multiply( uint64 lhs, uint64 rhs) noexcept
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long long high = 0;
+        const uint64 low = _umul128( lhs, rhs, &high);
+        return { high, low};
+#else
+        /* schoolbook multiplication of 32-bit halves */
+        const uint64 mask = MAX_VAL32;
+        const uint64 low = ( lhs & mask) * ( rhs & mask);
+        const uint64 cross1 = ( lhs >> 32) * ( rhs & mask);
+        const uint64 cross2 = ( lhs & mask) * ( rhs >> 32);
+        const uint64 high = ( lhs >> 32) * ( rhs >> 32);
+        const uint64 middle = ( low >> 32) + ( cross1 & mask) + ( cross2 & mask);
+        return { high + ( cross1 >> 32) + ( cross2 >> 32) + ( middle >> 32), ( middle << 32) | ( low & mask)};
+#endif
+    }
+
+    using Unsigned = BasicInt128<false>;
+
+    // quotient is rounded towards zero, remainder has the sign of dividend
+    static std::pair<BasicInt128, BasicInt128> divide( BasicInt128 lhs, BasicInt128 rhs) noexcept
+    {
+        const bool is_negative_quotient = lhs.is_negative() != rhs.is_negative();
+        const auto dividend = lhs.is_negative() ? Unsigned( -lhs) : Unsigned( lhs);
+        const auto divisor = rhs.is_negative() ? Unsigned( -rhs) : Unsigned( rhs);
+        const auto [quotient, remainder] = divide_unsigned( dividend, divisor);
+        return {
+            is_negative_quotient ? -BasicInt128( quotient) : BasicInt128( quotient),
+            lhs.is_negative() ? -BasicInt128( remainder) : BasicInt128( remainder)
+        };
+    }
+
+    static std::pair<Unsigned, Unsigned> divide_unsigned( Unsigned lhs, Unsigned rhs) noexcept
+    {
+        if ( lhs.get_high() == 0 && rhs.get_high() == 0)
+            return { lhs.get_low() / rhs.get_low(), lhs.get_low() % rhs.get_low()};
+
+        if ( lhs < rhs)
+            return { 0, lhs};
+
+        /* restoring division starting from the highest bit of the dividend not below the divisor */
+        const uint32 shift = leading_zeroes( rhs) - leading_zeroes( lhs);
+        Unsigned divisor = rhs << shift;
+        Unsigned quotient = 0;
+        Unsigned remainder = lhs;
+        for ( uint32 i = 0; i <= shift; ++i)
+        {
+            quotient <<= 1;
+            if ( remainder >= divisor)
+            {
+                remainder -= divisor;
+                quotient |= 1;
+            }
+            divisor >>= 1;
+        }
+        return { quotient, remainder};
+    }
+
+    static constexpr uint32 leading_zeroes( Unsigned value) noexcept
+    {
+        uint32 count = 0;
+        for ( uint64 limb = value.get_high() != 0 ? value.get_high() : value.get_low(); ( limb >> 63) == 0 && count < 64; limb <<= 1)
+            ++count;
+        return value.get_high() != 0 ? count : count + 64;
+    }
+
+    uint64 lo = 0;
+    uint64 hi = 0;
+};
+
+using UInt128 = BasicInt128<false>;
+using SInt128 = BasicInt128<true>;
+
+namespace std {
+    template<bool IS_SIGNED>
+    class numeric_limits<BasicInt128<IS_SIGNED>> : public numeric_limits<conditional_t<IS_SIGNED, int64, uint64>>
+    {
+        using Type = BasicInt128<IS_SIGNED>;
+    public:
+        static constexpr int digits = IS_SIGNED ? 127 : 128;
+        static constexpr int digits10 = 38;
+        static constexpr Type min() noexcept { return IS_SIGNED ? Type::from_limbs( uint64{ 1} << 63, 0) : Type(); }
+        static constexpr Type lowest() noexcept { return min(); }
+        static constexpr Type max() noexcept { return ~min(); }
+    };
+} // namespace std
+
+#endif // UINT128_H
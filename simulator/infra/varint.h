@@ -0,0 +1,57 @@
+/**
+ * varint.h - variable-length encoding of integers in binary traces
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <infra/types.h>
+
+#include <istream>
+
+/*
+ * Each byte keeps 7 bits of the value starting from the lowest ones,
+ * the highest bit is set if more bytes follow. Signed values are mapped
+ * to unsigned ones by zigzag encoding, so small negative values are short too.
+ */
+static inline uint64 zigzag_encode( int64 value)
+{
+    return ( static_cast<uint64>( value) << 1) ^ static_cast<uint64>( value >> 63);
+}
+
+static inline int64 zigzag_decode( uint64 value)
+{
+    return static_cast<int64>( value >> 1) ^ -static_cast<int64>( value & 1);
+}
+
+// Output is any type with put( char) method
+template <typename Output>
+void put_varint( Output* out, uint64 value)
+{
+    while ( value >= 0x80)
+    {
+        out->put( static_cast<char>( ( value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out->put( static_cast<char>( value));
+}
+
+// returns false if the stream ends before the value
+static inline bool get_varint( std::istream& in, uint64* value)
+{
+    *value = 0;
+    for ( uint32 shift = 0; shift < 64; shift += 7)
+    {
+        const auto byte = in.get();
+        if ( byte == std::char_traits<char>::eof())
+            return false;
+
+        *value |= uint64{ static_cast<uint8>( byte) & 0x7fu} << shift;
+        if ( ( byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+#endif // VARINT_H
@@ -11,8 +11,8 @@
 
 #include <infra/types.h>
 
-// Use native GCC type if available, as Boost <= 1.60 + GCC 7 generate a bug
-#if defined(__GNUC__) && !defined(__clang__) && defined(__SIZEOF_INT128__)
+// Use native type of GCC and Clang if available, it is the fastest one
+#if defined(__SIZEOF_INT128__)
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic"
@@ -24,10 +24,10 @@ using uint128 = unsigned __int128;
 
 #else // __SIZEOF_INT128__
 
-#include <boost/multiprecision/cpp_int.hpp>
+#include <infra/uint128/uint128.h>
 
-using int128 = boost::multiprecision::int128_t;
-using uint128 = boost::multiprecision::uint128_t;
+using int128 = SInt128;
+using uint128 = UInt128;
 
 #endif // __SIZEOF_INT128__
 
@@ -10,10 +10,18 @@
 
 /* Generic C++ */
 #include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 
 /* Simulator modules. */
+#include <batch/batch.h>
+#include <cluster/cluster.h>
+#include <core/pipeline_trace.h>
 #include <infra/config/config.h>
 #include <simulator.h>
+#include <simpoint/simpoint.h>
+#include <sweep/sweep.h>
 
 namespace config {
     static RequiredValue<std::string> binary_filename = { "binary,b", "input binary file"};
@@ -22,24 +30,161 @@ namespace config {
     static Value<std::string> isa = { "isa,I", "mips", "modeled ISA"};
     static Value<bool> disassembly_on = { "disassembly,d", false, "print disassembly"};
     static Value<bool> functional_only = { "functional-only,f", false, "run functional simulation only"};
+    static Value<bool> out_of_order = { "out-of-order", false, "simulate out-of-order core instead of in-order pipeline"};
+    static Value<uint32> cores = { "cores", 1, "number of in-order cores sharing memory and L2 cache in performance simulation"};
+
+    static Value<std::string> checkpoint_load = { "checkpoint-load", "", "binary checkpoint to start simulation from"};
+    static Value<std::string> checkpoint_save = { "checkpoint-save", "", "binary checkpoint to save at the end of simulation"};
+    static Value<std::string> instr_trace = { "instr-trace", "", "file to record instructions of functional simulation to, it is replayed with --trace-replay"};
+    static Value<std::string> profile = { "profile", "", "prefix of files with profile of guest functions"};
+    static Value<uint64> profile_period = { "profile-period", 1, "number of events per sample of the profile"};
+    static Value<std::string> pipeline_view = { "pipeline-view", "", "pipeline trace of the binary to print in Konata format instead of simulation"};
+
+    static Value<std::string> sweep = { "sweep", "", "JSON file with configurations of performance simulation to sweep"};
+    static Value<uint32> jobs = { "jobs,j", 1, "number of simulation threads in sweep, sampled or batch simulation"};
+    static Value<uint32> coordinator = { "coordinator", 0, "TCP port where jobs of the sweep are given to workers, 0 runs the sweep in the process"};
+    static Value<std::string> sweep_checkpoints = { "sweep-checkpoints", "", "comma-separated checkpoints of the binary, the sweep of coordinator is run from each of them"};
+    static Value<std::string> worker = { "worker", "", "host:port of sweep coordinator, its jobs are run with the binary in -j threads"};
+    static Value<bool> batch = { "batch", false, "treat the binary file as a list of binaries to run functionally in one process"};
+
+    static Value<uint64> simpoint_interval = { "simpoint-interval", 0, "size of intervals of sampled simulation, 0 disables sampling"};
+    static Value<uint32> simpoints = { "simpoints", 10, "maximal number of intervals simulated in sampled simulation"};
+    static Value<uint64> simpoint_warmup = { "simpoint-warmup", 0, "number of instructions warming up predictor and caches before each interval of sampled simulation"};
+    static Value<std::string> simpoint_checkpoints = { "simpoint-checkpoints", "simpoint", "prefix of checkpoint files of sampled simulation"};
 } // namespace config
 
 auto create_simulator()
 {
-    auto simulator = Simulator::create_simulator( config::isa, config::functional_only, config::disassembly_on);
+    if ( config::cores == 0) {
+       std::cerr << "ERROR. Performance simulation needs at least one core" << std::endl;
+       std::exit( EXIT_FAILURE);
+    }
+
+    auto simulator = Simulator::create_simulator( config::isa, config::functional_only, config::disassembly_on, config::out_of_order, config::cores);
     if ( simulator == nullptr) {
-       std::cerr << "ERROR. Invalid simulation mode " << config::isa << ( config::functional_only ? "-functional" : "-performance") << std::endl;
+       std::cerr << "ERROR. Invalid simulation mode " << config::isa << ( config::functional_only ? "-functional" : "-performance")
+                 << ( config::cores > 1 ? "-multicore" : "") << std::endl;
        std::exit( EXIT_FAILURE);
     }
     return simulator;
 }
 
+void run_simulator()
+{
+    if ( !static_cast<const std::string&>( config::instr_trace).empty() && !config::functional_only) {
+       std::cerr << "ERROR. Instruction trace is recorded only by functional simulation" << std::endl;
+       std::exit( EXIT_FAILURE);
+    }
+
+    auto simulator = create_simulator();
+    simulator->set_checkpoints( config::checkpoint_load, config::checkpoint_save);
+    simulator->set_instr_trace( config::instr_trace);
+    simulator->set_profile( config::profile, config::profile_period);
+    simulator->run( config::binary_filename, config::num_steps);
+}
+
+void run_sweep()
+{
+    const std::string& isa = config::isa;
+    if ( isa != "mips" || config::functional_only) {
+       std::cerr << "ERROR. Sweep is supported only in mips-performance mode" << std::endl;
+       std::exit( EXIT_FAILURE);
+    }
+
+    auto sweep = Sweep::load( config::sweep);
+    if ( config::coordinator == 0) {
+       if ( !static_cast<const std::string&>( config::sweep_checkpoints).empty()) {
+          std::cerr << "ERROR. Checkpoints of sweep are supported only by coordinator" << std::endl;
+          std::exit( EXIT_FAILURE);
+       }
+       sweep.run( config::binary_filename, config::num_steps, config::jobs);
+       sweep.dump_csv( std::cout);
+       return;
+    }
+
+    if ( config::coordinator > MAX_VAL16) {
+       std::cerr << "ERROR. Invalid port " << config::coordinator << " of coordinator" << std::endl;
+       std::exit( EXIT_FAILURE);
+    }
+
+    std::vector<std::string> checkpoints;
+    std::istringstream list( config::sweep_checkpoints);
+    for ( std::string checkpoint; std::getline( list, checkpoint, ',');)
+        checkpoints.push_back( checkpoint);
+
+    Coordinator coordinator( sweep.get_points(), checkpoints, isa, config::num_steps);
+    coordinator.listen( static_cast<uint16>( config::coordinator));
+    coordinator.serve();
+    coordinator.dump_csv( std::cout);
+}
+
+void run_worker()
+{
+    const std::string& address = config::worker;
+    const auto separator = address.rfind( ':');
+    uint32 port = 0;
+    try {
+        port = separator == std::string::npos ? 0 : std::stoul( address.substr( separator + 1));
+    }
+    catch ( const std::logic_error&) {
+        port = 0;
+    }
+
+    if ( port == 0 || port > MAX_VAL16) {
+       std::cerr << "ERROR. Address of coordinator " << address << " is not host:port" << std::endl;
+       std::exit( EXIT_FAILURE);
+    }
+
+    Worker worker( config::binary_filename);
+    worker.run( address.substr( 0, separator), static_cast<uint16>( port), config::jobs);
+}
+
+void run_simpoint()
+{
+    const std::string& isa = config::isa;
+    if ( isa != "mips" || config::functional_only) {
+       std::cerr << "ERROR. Sampled simulation is supported only in mips-performance mode" << std::endl;
+       std::exit( EXIT_FAILURE);
+    }
+
+    SimPoint simpoint( config::binary_filename, config::simpoint_interval);
+    simpoint.profile( config::num_steps);
+    simpoint.choose( config::simpoints);
+    simpoint.save_checkpoints( config::simpoint_checkpoints, config::simpoint_warmup);
+    simpoint.simulate( config::jobs);
+    simpoint.dump( std::cout);
+}
+
+void run_batch()
+{
+    const std::string& isa = config::isa;
+    if ( isa != "mips") {
+       std::cerr << "ERROR. Batch is supported only in mips-functional mode" << std::endl;
+       std::exit( EXIT_FAILURE);
+    }
+
+    auto batch = Batch::load( config::binary_filename);
+    batch.run( config::num_steps, config::jobs);
+    batch.dump_csv( std::cout);
+}
+
 int main( int argc, const char* argv[])
 {
     try {
         /* Analysing and handling of inserted arguments */
         config::handleArgs( argc, argv);
-        create_simulator()->run( config::binary_filename, config::num_steps);
+        if ( !static_cast<const std::string&>( config::pipeline_view).empty())
+            convert_pipeline_trace( config::isa, config::pipeline_view, config::binary_filename, std::cout);
+        else if ( !static_cast<const std::string&>( config::worker).empty())
+            run_worker();
+        else if ( !static_cast<const std::string&>( config::sweep).empty())
+            run_sweep();
+        else if ( config::simpoint_interval != 0)
+            run_simpoint();
+        else if ( config::batch)
+            run_batch();
+        else
+            run_simulator();
     }
     catch (const std::exception& e) {
         std::cerr << *argv << ": " << e.what()
@@ -4,90 +4,260 @@
  */
 
 
+#include <infra/config/config.h>
+#include <infra/self_profiler/self_profiler.h>
+
+#include <bitset>
+
 #include "mem.h"
 
+namespace config {
+    static Value<uint32> data_cache_size = { "dcache-size", 4096, "Size of data level 1 cache (in bytes), 0 disables data caches"};
+    static Value<uint32> data_cache_ways = { "dcache-ways", 4, "Amount of ways in data level 1 cache"};
+    static Value<uint32> data_cache_line_size = { "dcache-line-size", 64, "Line size of data level 1 cache (in bytes)"};
+    static Value<std::string> data_cache_replacement = { "dcache-replacement", "lru", "Replacement policy of data level 1 cache: lru, plru, nru or random"};
+    static Value<uint32> data_cache_latency = { "dcache-latency", 1, "Hit latency of data level 1 cache (in cycles)"};
+
+    static Value<uint32> l2_cache_size = { "l2-size", 0, "Size of level 2 cache (in bytes), 0 disables it"};
+    static Value<uint32> l2_cache_ways = { "l2-ways", 8, "Amount of ways in level 2 cache"};
+    static Value<uint32> l2_cache_line_size = { "l2-line-size", 64, "Line size of level 2 cache (in bytes)"};
+    static Value<std::string> l2_cache_replacement = { "l2-replacement", "lru", "Replacement policy of level 2 cache: lru, plru, nru or random"};
+    static Value<uint32> l2_cache_latency = { "l2-latency", 10, "Hit latency of level 2 cache (in cycles)"};
+
+    static Value<uint32> memory_latency = { "memory-latency", 30, "Latency of memory access after cache misses (in cycles)"};
+    static Value<uint32> mshrs = { "mshrs", 4, "Number of outstanding store misses of data level 1 cache, 0 makes them blocking"};
+    static Value<std::string> data_prefetcher = { "dcache-prefetch", "none", "data prefetcher trained by loads: none, stride or stream"};
+    static Value<uint32> data_prefetch_degree = { "dcache-prefetch-degree", 2, "number of lines requested by data prefetcher at once"};
+    static Value<uint32> data_prefetch_distance = { "dcache-prefetch-distance", 1, "number of lines or strides between the load and the first line requested by data prefetcher"};
+    static Value<uint32> data_prefetch_entries = { "dcache-prefetch-entries", 32, "number of load PCs or streams tracked by data prefetcher"};
+    static Value<uint32> store_buffer = { "store-buffer", 0, "Number of stores waiting for data level 1 cache in store buffer, 0 disables it"};
+} // namespace config
 
 static constexpr const uint32 FLUSHED_STAGES_NUM = 3;
 
 
 template <typename ISA>
-Mem<ISA>::Mem( bool log) : Log( log)
+Mem<ISA>::Mem( bool log, uint32 width, const PipelineDepth& depth, uint32 threads) : Log( log)
+    , memories( threads, nullptr)
 {
-    wp_datapath = make_write_port<Instr>("MEMORY_2_WRITEBACK", PORT_BW, PORT_FANOUT);
+    wp_datapath = make_write_port<Instr>("MEMORY_2_WRITEBACK", width, PORT_FANOUT);
     rp_datapath = make_read_port<Instr>("EXECUTE_2_MEMORY", PORT_LATENCY);
 
-    wp_flush_all = make_write_port<bool>("MEMORY_2_ALL_FLUSH", PORT_BW, FLUSHED_STAGES_NUM);
-    rp_flush = make_read_port<bool>("MEMORY_2_ALL_FLUSH", PORT_LATENCY);
+    if ( !depth.is_branch_resolved_in_execute)
+    {
+        for ( uint32 thread = 0; thread < threads; ++thread)
+        {
+            wps_flush_all.push_back( make_write_port<bool>( get_thread_port_name( "MEMORY_2_ALL_FLUSH", thread),
+                                                            PORT_BW, FLUSHED_STAGES_NUM));
+            rps_flush.push_back( make_read_port<bool>( get_thread_port_name( "MEMORY_2_ALL_FLUSH", thread), PORT_LATENCY));
 
-    wp_flush_target = make_write_port<Addr>("MEMORY_2_FETCH_TARGET", PORT_BW, PORT_FANOUT);
-    wp_bp_update = make_write_port<BPInterface>("MEMORY_2_FETCH", PORT_BW, PORT_FANOUT);
+            wps_flush_target.push_back( make_write_port<Addr>( get_thread_port_name( "MEMORY_2_FETCH_TARGET", thread),
+                                                               PORT_BW, PORT_FANOUT));
+        }
+        wp_bp_update = make_write_port<BPResolution>("MEMORY_2_FETCH", width, PORT_FANOUT);
+    }
 
-    wp_bypass = make_write_port<RegDstUInt>("MEMORY_2_EXECUTE_BYPASS", PORT_BW, SRC_REGISTERS_NUM);
+    // the instructions pass through the sub-stages in order, so data of all of them are sent at the first one
+    for ( uint8 stage = 1; stage <= depth.memory_stages; ++stage)
+        wps_bypass.push_back( make_write_port<RegDstUInt>( DataBypass<ISA>::get_bypass_port_name( stage, depth.memory_stages),
+                                                           width, PORT_FANOUT));
 
     wp_bypassing_unit_flush_notify = make_write_port<Instr>("MEMORY_2_BYPASSING_UNIT_FLUSH_NOTIFY", 
-                                                            PORT_BW, PORT_FANOUT);
+                                                            width, PORT_FANOUT);
+
+    if ( config::data_cache_size == 0)
+        return;
+
+    if ( config::data_cache_latency == 0 || ( config::l2_cache_size != 0 && config::l2_cache_latency == 0))
+        serr << "ERROR: Wrong arguments! Cache latency should be greater than zero" << std::endl << critical;
+
+    auto l1 = std::make_unique<CacheLevel>( config::data_cache_size,
+                                            config::data_cache_ways,
+                                            config::data_cache_line_size,
+                                            Latency( config::data_cache_latency),
+                                            config::data_cache_replacement);
+
+    auto l2 = config::l2_cache_size == 0 ? nullptr
+            : std::make_unique<CacheLevel>( config::l2_cache_size,
+                                            config::l2_cache_ways,
+                                            config::l2_cache_line_size,
+                                            Latency( config::l2_cache_latency),
+                                            config::l2_cache_replacement);
+
+    data_cache = std::make_unique<MemoryHierarchy>( std::move( l1), std::move( l2),
+                                                    Latency( config::memory_latency), config::mshrs);
+
+    const std::string& prefetcher = config::data_prefetcher;
+    if ( prefetcher != "none")
+        data_cache->set_prefetcher( DataPrefetcher::create( prefetcher, config::data_cache_line_size, config::data_prefetch_degree,
+                                                            config::data_prefetch_distance, config::data_prefetch_entries));
+
+    if ( config::store_buffer != 0)
+        store_buffer = std::make_unique<StoreBuffer>( config::store_buffer);
 }
 
 
 template <typename ISA>
 void Mem<ISA>::clock( Cycle cycle)
 {
-    sout << "memory  cycle " << std::dec << cycle << ": ";
+    SELF_PROFILE( MEM);
+    TRACE( sout) << "memory  cycle " << std::dec << cycle << ": ";
 
-    /* receieve flush signal */
-    const bool is_flush = rp_flush->is_ready( cycle) && rp_flush->read( cycle);
+    /* receieve flush signals */
+    std::bitset<MAX_HW_THREADS> is_flush;
+    for ( size_t i = 0; i < rps_flush.size(); ++i)
+        is_flush[ i] = rps_flush[ i]->is_ready( cycle) && rps_flush[ i]->read( cycle);
 
     /* branch misprediction */
-    if ( is_flush)
+    if ( !is_smt() && is_flush[ 0])
     {
-        /* drop instruction as it is invalid */
-        if ( rp_datapath->is_ready( cycle))
+        /* drop instructions as they are invalid */
+        while ( rp_datapath->is_ready( cycle))
         {
-            const auto& instr = rp_datapath->read( cycle);
-            
-            /* notifying bypassing unit about invalid instruction */
-            wp_bypassing_unit_flush_notify->write( instr, cycle);
+            auto instr = rp_datapath->read( cycle);
+            flush_instr( &instr, cycle);
         }
 
-        sout << "flush\n";
+        outcome = StageOutcome::FLUSH;
+        TRACE( sout) << "flush\n";
         return;
     }
 
     /* check if there is something to process */
     if ( !rp_datapath->is_ready( cycle))
     {
-        sout << "bubble\n";
+        outcome = is_flush.any() ? StageOutcome::FLUSH : StageOutcome::BUBBLE;
+        TRACE( sout) << "bubble\n";
         return;
     }
 
-    auto instr = rp_datapath->read( cycle);
+    outcome = StageOutcome::PASSED;
+    while ( rp_datapath->is_ready( cycle))
+    {
+        auto instr = rp_datapath->read( cycle);
+
+        /* instructions of the bundle younger than mispredicted jump are invalid */
+        if ( is_flush[ instr.get_thread()])
+        {
+            flush_instr( &instr, cycle);
+            if ( !is_smt())
+                continue;
+        }
 
-    if ( instr.is_jump()) {
-        /* acquiring real information for BPU */
-        wp_bp_update->write( instr.get_bp_upd(), cycle);
-        
-        /* handle misprediction */
-        if ( instr.is_misprediction())
+        trace_event( pipeline_trace, PipelineEvent::MEM, instr, cycle);
+
+        /* flushed instructions pass doing nothing */
+        if ( !instr.is_flushed())
         {
-            /* flushing the pipeline */
-            wp_flush_all->write( true, cycle);
+            if ( instr.is_jump() && !wps_flush_all.empty() && resolve_jump( instr, cycle))
+                is_flush[ instr.get_thread()] = true;
 
-            /* sending valid PC to fetch stage */
-            wp_flush_target->write( instr.get_new_PC(), cycle);
-            sout << "misprediction on ";
+            access_memory( &instr, cycle);
         }
+
+        /* bypass data */
+        for ( auto& port : wps_bypass)
+            port->write( instr.get_bypassing_data(), cycle);
+
+        wp_datapath->write( instr, cycle);
+
+        /* log */
+        TRACE( sout) << instr << std::endl;
     }
+}
 
-    /* perform required loads and stores */
-    memory->load_store( &instr);
-    
-    /* bypass data */
-    wp_bypass->write( instr.get_bypassing_data(), cycle);
 
-    wp_datapath->write( instr, cycle);
+template <typename ISA>
+void Mem<ISA>::flush_instr( Instr* instr, Cycle cycle)
+{
+    /* notifying bypassing unit about invalid instruction */
+    wp_bypassing_unit_flush_notify->write( *instr, cycle);
+    trace_event( pipeline_trace, PipelineEvent::FLUSH, *instr, cycle);
+    instr->set_flushed();
+}
+
+
+template <typename ISA>
+bool Mem<ISA>::resolve_jump( const Instr& instr, Cycle cycle)
+{
+    /* acquiring real information for BPU */
+    wp_bp_update->write( instr.get_bp_resolution(), cycle);
+    if ( !instr.is_misprediction())
+        return false;
+
+    /* flushing the pipeline */
+    wps_flush_all.at( instr.get_thread())->write( true, cycle);
+
+    /* sending valid PC to fetch stage */
+    wps_flush_target.at( instr.get_thread())->write( instr.get_new_PC(), cycle);
+    ++flushes;
+    TRACE( sout) << "misprediction on ";
+    return true;
+}
+
+
+template <typename ISA>
+void Mem<ISA>::access_memory( Instr* instr, Cycle cycle)
+{
+    /* memory is shared with other cores or with fetch clocked in parallel thread */
+    const auto lock = memory_lock == nullptr ? std::unique_lock<std::mutex>() : std::unique_lock<std::mutex>( *memory_lock);
+
+    /* perform required loads and stores, replayed instructions have their addresses only */
+    auto* memory = memories.at( instr->get_thread());
+    if ( memory != nullptr)
+        memory->load_store( instr);
+    loads += instr->is_load() ? 1 : 0;
+    stores += instr->is_store() ? 1 : 0;
+
+    /* data cache miss stops the pipeline */
+    if ( data_cache != nullptr && ( instr->is_load() || instr->is_store()))
+    {
+        const auto addr = get_cache_addr( *instr);
+        const auto stall = store_buffer == nullptr
+                         ? data_cache->access( addr, instr->is_store(), cycle)
+                         : store_buffer->access( data_cache.get(), addr, instr->get_mem_size(), instr->is_store(), cycle);
+        if ( stall != 0_Lt) {
+            ++dcache_stalls;
+            dcache_stall_cycles += stall.to_size_t();
+            TRACE( sout) << "(data cache stall for " << stall << " cycles) ";
+        }
+
+        if ( instr->is_load())
+            data_cache->train_prefetcher( instr->get_PC(), addr, cycle);
+    }
+}
+
+
+template <typename ISA>
+void Mem<ISA>::connect( CoherenceDirectory* directory)
+{
+    if ( data_cache != nullptr)
+        data_cache->connect( directory);
+}
+
+
+template <typename ISA>
+void Mem<ISA>::warm_up( const FuncInstr& instr)
+{
+    if ( data_cache != nullptr && ( instr.is_load() || instr.is_store()))
+        data_cache->warm_up( instr.get_mem_addr(), instr.is_store());
+}
+
+
+template <typename ISA>
+void Mem<ISA>::register_stats( StatsRegistry* stats) const
+{
+    stats->add_counter( "mem.loads", &loads);
+    stats->add_counter( "mem.stores", &stores);
+    stats->add_counter( "mem.flushes", &flushes);
+    if ( data_cache == nullptr)
+        return;
 
-    /* log */
-    sout << instr << std::endl;
+    stats->add_counter( "mem.dcache.stalls", &dcache_stalls);
+    stats->add_counter( "mem.dcache.stall_cycles", &dcache_stall_cycles);
+    data_cache->register_stats( stats, "mem.dcache");
+    if ( store_buffer != nullptr)
+        store_buffer->register_stats( stats, "mem.store_buffer");
 }
 
 
@@ -8,9 +8,21 @@
 #define MEM_H
 
 
+#include <infra/cache/coherence.h>
+#include <infra/cache/memory_hierarchy.h>
+#include <infra/cache/store_buffer.h>
 #include <infra/ports/ports.h>
+#include <infra/stats/stats.h>
+#include <core/cpi_stack.h>
 #include <core/perf_instr.h>
+#include <core/pipeline_depth.h>
+#include <core/pipeline_trace.h>
+#include <core/smt.h>
 #include <bpu/bpu.h>
+#include <bypass/data_bypass.h>
+
+#include <mutex>
+#include <vector>
 
 
 template <typename ISA>
@@ -23,27 +35,75 @@ class Mem : public Log
     using RegDstUInt = typename ISA::RegDstUInt;
 
     private:
-        Memory* memory = nullptr;
+        // memories of hardware threads, they run separate programs
+        std::vector<Memory*> memories;
+
+        // memory and caches are shared by cores simulated in parallel threads if it is set
+        std::mutex* memory_lock = nullptr;
+
+        // data caches, nullptr if memory is accessed without delays
+        std::unique_ptr<MemoryHierarchy> data_cache = nullptr;
+
+        // stores wait for data cache there, nullptr if they access the cache in memory stage
+        std::unique_ptr<StoreBuffer> store_buffer = nullptr;
 
         std::unique_ptr<WritePort<Instr>> wp_datapath = nullptr;
         std::unique_ptr<ReadPort<Instr>> rp_datapath = nullptr;
 
-        std::unique_ptr<WritePort<bool>> wp_flush_all = nullptr;
-        std::unique_ptr<ReadPort<bool>> rp_flush = nullptr;
+        // ports of branch resolution of each thread, empty if jumps are resolved by execute stage
+        std::vector<std::unique_ptr<WritePort<bool>>> wps_flush_all = {};
+        std::vector<std::unique_ptr<ReadPort<bool>>> rps_flush = {};
 
-        std::unique_ptr<WritePort<Addr>> wp_flush_target = nullptr;
-        std::unique_ptr<WritePort<BPInterface>> wp_bp_update = nullptr;
+        std::vector<std::unique_ptr<WritePort<Addr>>> wps_flush_target = {};
+        std::unique_ptr<WritePort<BPResolution>> wp_bp_update = nullptr;
 
-        static constexpr const uint8 SRC_REGISTERS_NUM = 2;
-
-        std::unique_ptr<WritePort<RegDstUInt>> wp_bypass = nullptr;
+        // bypassed data of each memory sub-stage
+        std::vector<std::unique_ptr<WritePort<RegDstUInt>>> wps_bypass = {};
 
         std::unique_ptr<WritePort<Instr>> wp_bypassing_unit_flush_notify = nullptr;
-    
+
+        /* Counters of memory accesses, pipeline flushes and data cache stalls */
+        uint64 loads = 0;
+        uint64 stores = 0;
+        uint64 flushes = 0;
+        uint64 dcache_stalls = 0;
+        uint64 dcache_stall_cycles = 0;
+
+        /* Result of the last clock for CPI stack */
+        StageOutcome outcome = StageOutcome::BUBBLE;
+
+        PipelineTrace* pipeline_trace = nullptr;
+
+        // flushed instructions keep their slots in bundles of other threads with SMT
+        void flush_instr( Instr* instr, Cycle cycle);
+        bool is_smt() const { return memories.size() > 1; }
+
+        // threads run copies of the program, so their data are kept apart in the cache by the highest bits
+        static Addr get_cache_addr( const Instr& instr) { return instr.get_mem_addr() ^ ( Addr{ instr.get_thread()} << 30U); }
+
+        // returns true if the jump is mispredicted, then the younger instructions of the thread are flushed
+        bool resolve_jump( const Instr& instr, Cycle cycle);
+        void access_memory( Instr* instr, Cycle cycle);
+
     public:
-        explicit Mem( bool log);
+        Mem( bool log, uint32 width, const PipelineDepth& depth = PipelineDepth(), uint32 threads = 1);
         void clock( Cycle cycle);
-        void set_memory( Memory* mem) { memory = mem; }
+        void set_memory( Memory* mem, uint32 thread = 0) { memories.at( thread) = mem; }
+        void set_memory_lock( std::mutex* value) { memory_lock = value; }
+
+        // data cache of the core is kept coherent with caches of other cores
+        void connect( CoherenceDirectory* directory);
+        void register_stats( StatsRegistry* stats) const;
+        void set_pipeline_trace( PipelineTrace* value) { pipeline_trace = value; }
+        StageOutcome get_outcome() const { return outcome; }
+
+        // updates data caches by functionally executed instruction
+        void warm_up( const FuncInstr& instr);
+
+        // Data cache misses stop the whole pipeline, so the cycles are added to the clock
+        Latency get_stall_cycles() const { return data_cache == nullptr ? 0_Lt : data_cache->get_stall_cycles(); }
+        const MemoryHierarchy* get_data_cache() const { return data_cache.get(); }
+        const StoreBuffer* get_store_buffer() const { return store_buffer.get(); }
 };
 
 
@@ -10,336 +10,305 @@
 
 #include "mips_instr.h"
 
-//unordered map for R-instructions
-const std::unordered_map <uint8, MIPSInstr::ISAEntry> MIPSInstr::isaMapR =
+constexpr MIPSInstr::ISAEntry MIPSInstr::invalid_entry =
+    { "", OUT_UNKNOWN, 0, &MIPSInstr::execute_unknown, OP_UNKNOWN, 0 };
+
+constexpr MIPSInstr::ISATable MIPSInstr::get_isa_table( std::initializer_list<std::pair<uint8, ISAEntry>> entries)
+{
+    ISATable table = {};
+    for ( auto& entry : table)
+        entry = invalid_entry;
+    for ( const auto& entry : entries)
+        table[ entry.first] = entry.second;
+    return table;
+}
+
+// table for R-instructions
+constexpr MIPSInstr::ISATable MIPSInstr::isaMapR = get_isa_table(
 {
     // **************** R INSTRUCTIONS ****************
     // Constant shifts
-    //key      name  operation  memsize           pointer
-    {0x0, { "sll" , OUT_R_SHAMT, 0, &MIPSInstr::execute_sll, 1} },
+    //key      name  operation  memsize           pointer  op id
+    {0x0, { "sll" , OUT_R_SHAMT, 0, &MIPSInstr::execute_sll, OP_SLL, 1} },
     //       0x1 movci
-    {0x2, { "srl", OUT_R_SHAMT, 0, &MIPSInstr::execute_srl, 1} },
-    {0x3, { "sra", OUT_R_SHAMT, 0, &MIPSInstr::execute_sra, 1} },
+    {0x2, { "srl", OUT_R_SHAMT, 0, &MIPSInstr::execute_srl, OP_SRL, 1} },
+    {0x3, { "sra", OUT_R_SHAMT, 0, &MIPSInstr::execute_sra, OP_SRA, 1} },
 
     // Variable shifts
-    //key      name  operation  memsize           pointer
-    {0x4, { "sllv", OUT_R_SHIFT, 0, &MIPSInstr::execute_sllv, 1} },
+    //key      name  operation  memsize           pointer  op id
+    {0x4, { "sllv", OUT_R_SHIFT, 0, &MIPSInstr::execute_sllv, OP_SLLV, 1} },
     //        0x5 reserved
-    {0x6, { "srlv", OUT_R_SHIFT, 0, &MIPSInstr::execute_srlv, 1} },
-    {0x7, { "srav", OUT_R_SHIFT, 0, &MIPSInstr::execute_srav, 1} },
+    {0x6, { "srlv", OUT_R_SHIFT, 0, &MIPSInstr::execute_srlv, OP_SRLV, 1} },
+    {0x7, { "srav", OUT_R_SHIFT, 0, &MIPSInstr::execute_srav, OP_SRAV, 1} },
 
     // Indirect branches
-    //key      name   operation  memsize           pointer
-    {0x8, { "jr"  , OUT_R_JUMP,      0, &MIPSInstr::execute_jr,   1} },
-    {0x9, { "jalr", OUT_R_JUMP_LINK, 0, &MIPSInstr::execute_jalr, 1} },
+    //key      name   operation  memsize           pointer  op id
+    {0x8, { "jr"  , OUT_R_JUMP,      0, &MIPSInstr::execute_jr,   OP_JR, 1} },
+    {0x9, { "jalr", OUT_R_JUMP_LINK, 0, &MIPSInstr::execute_jalr, OP_JALR, 1} },
 
     // Conditional moves (MIPS IV)
-    //key      name    operation  memsize           pointer
-    {0xA,  { "movz", OUT_R_CONDM, 0, &MIPSInstr::execute_movz, 4} },
-    {0xB,  { "movn", OUT_R_CONDM, 0, &MIPSInstr::execute_movn, 4} },
+    //key      name    operation  memsize           pointer  op id
+    {0xA,  { "movz", OUT_R_CONDM, 0, &MIPSInstr::execute_movz, OP_MOVZ, 4} },
+    {0xB,  { "movn", OUT_R_CONDM, 0, &MIPSInstr::execute_movn, OP_MOVN, 4} },
 
     // System calls
-    //key      name     operation  memsize           pointer
-    {0xC, { "syscall", OUT_R_SPECIAL, 0, &MIPSInstr::execute_syscall, 1} },
-    {0xD, { "break",   OUT_R_SPECIAL, 0, &MIPSInstr::execute_break,   1} },
+    //key      name     operation  memsize           pointer  op id
+    {0xC, { "syscall", OUT_R_SPECIAL, 0, &MIPSInstr::execute_syscall, OP_SYSCALL, 1} },
+    {0xD, { "break",   OUT_R_SPECIAL, 0, &MIPSInstr::execute_break,   OP_BREAK, 1} },
     //          0xE reserved
     //          0xF SYNC
 
     // HI/LO manipulations
-    //key      name   operation  memsize           pointer
-    {0x10, { "mfhi", OUT_R_MFHI, 0, &MIPSInstr::execute_move, 1} },
-    {0x11, { "mthi", OUT_R_MTHI, 0, &MIPSInstr::execute_move, 1} },
-    {0x12, { "mflo", OUT_R_MFLO, 0, &MIPSInstr::execute_move, 1} },
-    {0x13, { "mtlo", OUT_R_MTLO, 0, &MIPSInstr::execute_move, 1} },
+    //key      name   operation  memsize           pointer  op id
+    {0x10, { "mfhi", OUT_R_MFHI, 0, &MIPSInstr::execute_move, OP_MOVE, 1} },
+    {0x11, { "mthi", OUT_R_MTHI, 0, &MIPSInstr::execute_move, OP_MOVE, 1} },
+    {0x12, { "mflo", OUT_R_MFLO, 0, &MIPSInstr::execute_move, OP_MOVE, 1} },
+    {0x13, { "mtlo", OUT_R_MTLO, 0, &MIPSInstr::execute_move, OP_MOVE, 1} },
 
     // 0x14 - 0x17 double width shifts
 
     // Multiplication/Division
-    //key      name    operation  memsize           pointer
-    {0x18, { "mult",  OUT_R_DIVMULT, 0, &MIPSInstr::execute_mult,  1} },
-    {0x19, { "multu", OUT_R_DIVMULT, 0, &MIPSInstr::execute_multu, 1} },
-    {0x1A, { "div",   OUT_R_DIVMULT, 0, &MIPSInstr::execute_div,   1} },
-    {0x1B, { "divu",  OUT_R_DIVMULT, 0, &MIPSInstr::execute_divu,  1} },
+    //key      name    operation  memsize           pointer  op id
+    {0x18, { "mult",  OUT_R_DIVMULT, 0, &MIPSInstr::execute_mult,  OP_MULT, 1} },
+    {0x19, { "multu", OUT_R_DIVMULT, 0, &MIPSInstr::execute_multu, OP_MULTU, 1} },
+    {0x1A, { "div",   OUT_R_DIVMULT, 0, &MIPSInstr::execute_div,   OP_DIV, 1} },
+    {0x1B, { "divu",  OUT_R_DIVMULT, 0, &MIPSInstr::execute_divu,  OP_DIVU, 1} },
 
     // 0x1C - 0x1F double width multiplication/division
 
     // Addition/Subtraction
-    //key      name   operation  memsize           pointer
-    {0x20, { "add",  OUT_R_ARITHM, 0, &MIPSInstr::execute_add,  1} },
-    {0x21, { "addu", OUT_R_ARITHM, 0, &MIPSInstr::execute_addu, 1} },
-    {0x22, { "sub",  OUT_R_ARITHM, 0, &MIPSInstr::execute_sub,  1} },
-    {0x23, { "subu", OUT_R_ARITHM, 0, &MIPSInstr::execute_subu, 1} },
+    //key      name   operation  memsize           pointer  op id
+    {0x20, { "add",  OUT_R_ARITHM, 0, &MIPSInstr::execute_add,  OP_ADD, 1} },
+    {0x21, { "addu", OUT_R_ARITHM, 0, &MIPSInstr::execute_addu, OP_ADDU, 1} },
+    {0x22, { "sub",  OUT_R_ARITHM, 0, &MIPSInstr::execute_sub,  OP_SUB, 1} },
+    {0x23, { "subu", OUT_R_ARITHM, 0, &MIPSInstr::execute_subu, OP_SUBU, 1} },
 
     // Logical operations
-    //key      name   operation  memsize           pointer
-    {0x24, { "and", OUT_R_ARITHM, 0, &MIPSInstr::execute_and,  1} },
-    {0x25, { "or",  OUT_R_ARITHM, 0, &MIPSInstr::execute_or,   1} },
-    {0x26, { "xor", OUT_R_ARITHM, 0, &MIPSInstr::execute_xor,  1} },
-    {0x27, { "nor", OUT_R_ARITHM, 0, &MIPSInstr::execute_nor,  1} },
+    //key      name   operation  memsize           pointer  op id
+    {0x24, { "and", OUT_R_ARITHM, 0, &MIPSInstr::execute_and,  OP_AND, 1} },
+    {0x25, { "or",  OUT_R_ARITHM, 0, &MIPSInstr::execute_or,   OP_OR, 1} },
+    {0x26, { "xor", OUT_R_ARITHM, 0, &MIPSInstr::execute_xor,  OP_XOR, 1} },
+    {0x27, { "nor", OUT_R_ARITHM, 0, &MIPSInstr::execute_nor,  OP_NOR, 1} },
     //        0x28 reserved
     //        0x29 reserved
-    {0x2A, { "slt",  OUT_R_ARITHM, 0, &MIPSInstr::execute_set<&MIPSInstr::lt>,  1} },
-    {0x2B, { "sltu", OUT_R_ARITHM, 0, &MIPSInstr::execute_set<&MIPSInstr::ltu>, 1} },
+    {0x2A, { "slt",  OUT_R_ARITHM, 0, &MIPSInstr::execute_set<&MIPSInstr::lt>,  OP_SET_LT, 1} },
+    {0x2B, { "sltu", OUT_R_ARITHM, 0, &MIPSInstr::execute_set<&MIPSInstr::ltu>, OP_SET_LTU, 1} },
 
     // 0x2C - 0x2F double width addition/substraction
 
     // Conditional traps (MIPS II)
-    //key      name operation  memsize           pointer
-    {0x30, { "tge",  OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::ge>,  2} },
-    {0x31, { "tgeu", OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::geu>, 2} },
-    {0x32, { "tlt",  OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::lt>,  2} },
-    {0x33, { "tltu", OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::ltu>, 2} },
-    {0x34, { "teq",  OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::eq>,  2} },
+    //key      name operation  memsize           pointer  op id
+    {0x30, { "tge",  OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::ge>,  OP_TRAP_GE, 2} },
+    {0x31, { "tgeu", OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::geu>, OP_TRAP_GEU, 2} },
+    {0x32, { "tlt",  OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::lt>,  OP_TRAP_LT, 2} },
+    {0x33, { "tltu", OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::ltu>, OP_TRAP_LTU, 2} },
+    {0x34, { "teq",  OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::eq>,  OP_TRAP_EQ, 2} },
     //        0x35 reserved
-    {0x36, { "tne", OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::ne>,  2} }
+    {0x36, { "tne", OUT_R_TRAP, 0, &MIPSInstr::execute_trap<&MIPSInstr::ne>,  OP_TRAP_NE, 2} }
     //        0x37 reserved
     // 0x38 - 0x3F double width shifts
-};
+});
 
-//unordered map for RI-instructions
-const std::unordered_map <uint8, MIPSInstr::ISAEntry> MIPSInstr::isaMapRI =
+// table for RI-instructions
+constexpr MIPSInstr::ISATable MIPSInstr::isaMapRI = get_isa_table(
 {
 // ********************** REGIMM INSTRUCTIONS *************************
     // Branches
-    //key     name    operation     memsize       pointer
-    {0x0,  { "bltz",  OUT_RI_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::ltz>, 1} },
-    {0x1,  { "bgez",  OUT_RI_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::gez>, 1} },
-    {0x2,  { "bltzl", OUT_RI_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::ltz>, 2} },
-    {0x3,  { "bgezl", OUT_RI_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::gez>, 2} },
-
-    {0x8,  { "tgei",  OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::gei>,  2} },
-    {0x9,  { "tgeiu", OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::geiu>, 2} },
-    {0xA,  { "tlti",  OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::lti>,  2} },
-    {0xB,  { "tltiu", OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::ltiu>, 2} },
-    {0xC,  { "teqi",  OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::eqi>,  2} },
-    {0xE,  { "tnei",  OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::nei>,  2} },
-
-    {0x10, { "bltzal",  OUT_RI_BRANCH_LINK, 0, &MIPSInstr::execute_branch_and_link<&MIPSInstr::ltz>, 1} },
-    {0x11, { "bgezal",  OUT_RI_BRANCH_LINK, 0, &MIPSInstr::execute_branch_and_link<&MIPSInstr::gez>, 1} },
-    {0x12, { "bltzall", OUT_RI_BRANCH_LINK, 0, &MIPSInstr::execute_branch_and_link<&MIPSInstr::ltz>, 2} },
-    {0x13, { "bgezall", OUT_RI_BRANCH_LINK, 0, &MIPSInstr::execute_branch_and_link<&MIPSInstr::gez>, 2} }
-};
-
-//unordered map for I-instructions and J-instructions
-const std::unordered_map <uint8, MIPSInstr::ISAEntry> MIPSInstr::isaMapIJ =
+    //key     name    operation     memsize       pointer  op id
+    {0x0,  { "bltz",  OUT_RI_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::ltz>, OP_BRANCH_LTZ, 1} },
+    {0x1,  { "bgez",  OUT_RI_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::gez>, OP_BRANCH_GEZ, 1} },
+    {0x2,  { "bltzl", OUT_RI_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::ltz>, OP_BRANCH_LTZ, 2} },
+    {0x3,  { "bgezl", OUT_RI_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::gez>, OP_BRANCH_GEZ, 2} },
+
+    {0x8,  { "tgei",  OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::gei>,  OP_TRAP_GEI, 2} },
+    {0x9,  { "tgeiu", OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::geiu>, OP_TRAP_GEIU, 2} },
+    {0xA,  { "tlti",  OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::lti>,  OP_TRAP_LTI, 2} },
+    {0xB,  { "tltiu", OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::ltiu>, OP_TRAP_LTIU, 2} },
+    {0xC,  { "teqi",  OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::eqi>,  OP_TRAP_EQI, 2} },
+    {0xE,  { "tnei",  OUT_RI_TRAP,      0, &MIPSInstr::execute_trap<&MIPSInstr::nei>,  OP_TRAP_NEI, 2} },
+
+    {0x10, { "bltzal",  OUT_RI_BRANCH_LINK, 0, &MIPSInstr::execute_branch_and_link<&MIPSInstr::ltz>, OP_BRANCH_AND_LINK_LTZ, 1} },
+    {0x11, { "bgezal",  OUT_RI_BRANCH_LINK, 0, &MIPSInstr::execute_branch_and_link<&MIPSInstr::gez>, OP_BRANCH_AND_LINK_GEZ, 1} },
+    {0x12, { "bltzall", OUT_RI_BRANCH_LINK, 0, &MIPSInstr::execute_branch_and_link<&MIPSInstr::ltz>, OP_BRANCH_AND_LINK_LTZ, 2} },
+    {0x13, { "bgezall", OUT_RI_BRANCH_LINK, 0, &MIPSInstr::execute_branch_and_link<&MIPSInstr::gez>, OP_BRANCH_AND_LINK_GEZ, 2} }
+});
+
+// table for I-instructions and J-instructions
+constexpr MIPSInstr::ISATable MIPSInstr::isaMapIJ = get_isa_table(
 {
     // ********************* I and J INSTRUCTIONS *************************
     // Branches
-    //key     name operation  memsize       pointer
-    {0x2, { "j",   OUT_J_JUMP,      0, &MIPSInstr::execute_j,    1 } },
-    {0x3, { "jal", OUT_J_JUMP_LINK, 0, &MIPSInstr::execute_jal,  1 } },
+    //key     name operation  memsize       pointer  op id
+    {0x2, { "j",   OUT_J_JUMP,      0, &MIPSInstr::execute_j,    OP_J, 1 } },
+    {0x3, { "jal", OUT_J_JUMP_LINK, 0, &MIPSInstr::execute_jal,  OP_JAL, 1 } },
 
-    {0x4, { "beq",  OUT_I_BRANCH,    0, &MIPSInstr::execute_branch<&MIPSInstr::eq>,  1} },
-    {0x5, { "bne",  OUT_I_BRANCH,    0, &MIPSInstr::execute_branch<&MIPSInstr::ne>,  1} },
-    {0x6, { "blez", OUT_I_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::lez>, 1} },
-    {0x7, { "bgtz", OUT_I_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::gtz>, 1} },
+    {0x4, { "beq",  OUT_I_BRANCH,    0, &MIPSInstr::execute_branch<&MIPSInstr::eq>,  OP_BRANCH_EQ, 1} },
+    {0x5, { "bne",  OUT_I_BRANCH,    0, &MIPSInstr::execute_branch<&MIPSInstr::ne>,  OP_BRANCH_NE, 1} },
+    {0x6, { "blez", OUT_I_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::lez>, OP_BRANCH_LEZ, 1} },
+    {0x7, { "bgtz", OUT_I_BRANCH_0,  0, &MIPSInstr::execute_branch<&MIPSInstr::gtz>, OP_BRANCH_GTZ, 1} },
 
     // Addition/Subtraction
-    //key     name  operation  memsize       pointer
-    {0x8, { "addi",  OUT_I_ARITHM, 0, &MIPSInstr::execute_addi,  1} },
-    {0x9, { "addiu", OUT_I_ARITHM, 0, &MIPSInstr::execute_addiu, 1} },
+    //key     name  operation  memsize       pointer  op id
+    {0x8, { "addi",  OUT_I_ARITHM, 0, &MIPSInstr::execute_addi,  OP_ADDI, 1} },
+    {0x9, { "addiu", OUT_I_ARITHM, 0, &MIPSInstr::execute_addiu, OP_ADDIU, 1} },
 
     // Logical operations
-    //key     name   operation  memsize       pointer
-    {0xA, { "slti",  OUT_I_ARITHM, 0, &MIPSInstr::execute_set<&MIPSInstr::lti>,  1} },
-    {0xB, { "sltiu", OUT_I_ARITHM, 0, &MIPSInstr::execute_set<&MIPSInstr::ltiu>, 1} },
-    {0xC, { "andi",  OUT_I_ARITHM, 0, &MIPSInstr::execute_andi,  1} },
-    {0xD, { "ori",  OUT_I_ARITHM, 0, &MIPSInstr::execute_ori,   1} },
-    {0xE, { "xori", OUT_I_ARITHM, 0, &MIPSInstr::execute_xori,  1} },
-    {0xF, { "lui",  OUT_I_CONST,  0, &MIPSInstr::execute_lui,   1} },
+    //key     name   operation  memsize       pointer  op id
+    {0xA, { "slti",  OUT_I_ARITHM, 0, &MIPSInstr::execute_set<&MIPSInstr::lti>,  OP_SET_LTI, 1} },
+    {0xB, { "sltiu", OUT_I_ARITHM, 0, &MIPSInstr::execute_set<&MIPSInstr::ltiu>, OP_SET_LTIU, 1} },
+    {0xC, { "andi",  OUT_I_ARITHM, 0, &MIPSInstr::execute_andi,  OP_ANDI, 1} },
+    {0xD, { "ori",  OUT_I_ARITHM, 0, &MIPSInstr::execute_ori,   OP_ORI, 1} },
+    {0xE, { "xori", OUT_I_ARITHM, 0, &MIPSInstr::execute_xori,  OP_XORI, 1} },
+    {0xF, { "lui",  OUT_I_CONST,  0, &MIPSInstr::execute_lui,   OP_LUI, 1} },
 
     // 0x10 - 0x13 coprocessor operations
 
     // Likely branches (MIPS II)
-    //key     name   operation  memsize       pointer
-    {0x14, { "beql",  OUT_I_BRANCH,   0, &MIPSInstr::execute_branch<&MIPSInstr::eq>,  2} },
-    {0x15, { "bnel",  OUT_I_BRANCH,   0, &MIPSInstr::execute_branch<&MIPSInstr::ne>,  2} },
-    {0x16, { "blezl", OUT_I_BRANCH_0, 0, &MIPSInstr::execute_branch<&MIPSInstr::lez>, 2} },
-    {0x17, { "bgtzl", OUT_I_BRANCH_0, 0, &MIPSInstr::execute_branch<&MIPSInstr::gtz>, 2} },
+    //key     name   operation  memsize       pointer  op id
+    {0x14, { "beql",  OUT_I_BRANCH,   0, &MIPSInstr::execute_branch<&MIPSInstr::eq>,  OP_BRANCH_EQ, 2} },
+    {0x15, { "bnel",  OUT_I_BRANCH,   0, &MIPSInstr::execute_branch<&MIPSInstr::ne>,  OP_BRANCH_NE, 2} },
+    {0x16, { "blezl", OUT_I_BRANCH_0, 0, &MIPSInstr::execute_branch<&MIPSInstr::lez>, OP_BRANCH_LEZ, 2} },
+    {0x17, { "bgtzl", OUT_I_BRANCH_0, 0, &MIPSInstr::execute_branch<&MIPSInstr::gtz>, OP_BRANCH_GTZ, 2} },
 
     // 0x18 - 0x19 double width addition
     // 0x1A - 0x1B load double word left/right
 
     // Loads
-    //key     name  operation  memsize       pointer
-    {0x20, { "lb",  OUT_I_LOAD,  1, &MIPSInstr::calculate_load_addr, 1} },
-    {0x21, { "lh",  OUT_I_LOAD,  2, &MIPSInstr::calculate_load_addr, 1} },
-    {0x22, { "lwl", OUT_I_LOADL, 4, &MIPSInstr::calculate_load_addr, 1} },
-    {0x23, { "lw",  OUT_I_LOAD,  4, &MIPSInstr::calculate_load_addr, 1} },
-    {0x24, { "lbu", OUT_I_LOADU, 1, &MIPSInstr::calculate_load_addr, 1} },
-    {0x25, { "lhu", OUT_I_LOADU, 2, &MIPSInstr::calculate_load_addr, 1} },
-    {0x26, { "lwr", OUT_I_LOADR, 4, &MIPSInstr::calculate_load_addr, 1} },
-    {0x27, { "lwu", OUT_I_LOADU, 4, &MIPSInstr::calculate_load_addr, 1} },
+    //key     name  operation  memsize       pointer  op id
+    {0x20, { "lb",  OUT_I_LOAD,  1, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
+    {0x21, { "lh",  OUT_I_LOAD,  2, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
+    {0x22, { "lwl", OUT_I_LOADL, 4, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
+    {0x23, { "lw",  OUT_I_LOAD,  4, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
+    {0x24, { "lbu", OUT_I_LOADU, 1, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
+    {0x25, { "lhu", OUT_I_LOADU, 2, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
+    {0x26, { "lwr", OUT_I_LOADR, 4, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
+    {0x27, { "lwu", OUT_I_LOADU, 4, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
 
     // Store
-    //key     name   operation  memsize       pointer
-    {0x28, { "sb",  OUT_I_STORE,  1, &MIPSInstr::calculate_store_addr, 1} },
-    {0x29, { "sh",  OUT_I_STORE,  2, &MIPSInstr::calculate_store_addr, 1} },
-    {0x2A, { "swl", OUT_I_STOREL, 4, &MIPSInstr::calculate_store_addr, 1} },
-    {0x2B, { "sw",  OUT_I_STORE,  4, &MIPSInstr::calculate_store_addr, 1} },
+    //key     name   operation  memsize       pointer  op id
+    {0x28, { "sb",  OUT_I_STORE,  1, &MIPSInstr::calculate_store_addr, OP_STORE_ADDR, 1} },
+    {0x29, { "sh",  OUT_I_STORE,  2, &MIPSInstr::calculate_store_addr, OP_STORE_ADDR, 1} },
+    {0x2A, { "swl", OUT_I_STOREL, 4, &MIPSInstr::calculate_store_addr, OP_STORE_ADDR, 1} },
+    {0x2B, { "sw",  OUT_I_STORE,  4, &MIPSInstr::calculate_store_addr, OP_STORE_ADDR, 1} },
     //       0x2C   store double word left
     //       0x2D   store double word right
-    {0x2E, { "swr", OUT_I_STORER, 4, &MIPSInstr::calculate_store_addr, 1 } },
+    {0x2E, { "swr", OUT_I_STORER, 4, &MIPSInstr::calculate_store_addr, OP_STORE_ADDR, 1 } },
     //       0x2F   cache
 
     // Advanced loads and stores
-    {0x30, { "ll",  OUT_I_LOAD,   2, &MIPSInstr::calculate_load_addr, 1} },
-    {0x38, { "sc",  OUT_I_STORE,  2, &MIPSInstr::calculate_store_addr, 1} },
-};
+    {0x30, { "ll",  OUT_I_LOAD,   2, &MIPSInstr::calculate_load_addr, OP_LOAD_ADDR, 1} },
+    {0x38, { "sc",  OUT_I_STORE,  2, &MIPSInstr::calculate_store_addr, OP_STORE_ADDR, 1} },
+});
 
-const std::unordered_map <uint8, MIPSInstr::ISAEntry> MIPSInstr::isaMapMIPS32 =
+// table for MIPS32 SPECIAL2 instructions
+constexpr MIPSInstr::ISATable MIPSInstr::isaMapMIPS32 = get_isa_table(
 {
     // ********************* MIPS32 INSTRUCTIONS *************************
     //SPECIAL 2
-    //key     name    operation  memsize      pointer       mips version
-    {0x00, { "madd",  OUT_R_DIVMULT, 0, &MIPSInstr::execute_unknown, 32} },
-    {0x01, { "maddu", OUT_R_DIVMULT, 0, &MIPSInstr::execute_unknown, 32} },
-    {0x02, { "mul",   OUT_R_ARITHM,  0, &MIPSInstr::execute_mult,    32} },
-    {0x04, { "msub",  OUT_R_DIVMULT, 0, &MIPSInstr::execute_unknown, 32} },
-    {0x05, { "msubu", OUT_R_DIVMULT, 0, &MIPSInstr::execute_unknown, 32} },
-    {0x20, { "clz",   OUT_SP2_COUNT, 0, &MIPSInstr::execute_clz,     32} },
-    {0x21, { "clo",   OUT_SP2_COUNT, 0, &MIPSInstr::execute_clo,     32} },
-};
-
-MIPSInstr::MIPSInstr( uint32 bytes, Addr PC) :
-    instr( bytes),
-    new_PC( PC + 4),
-    PC( PC)
+    //key     name    operation  memsize      pointer  op id       mips version
+    {0x00, { "madd",  OUT_R_DIVMULT, 0, &MIPSInstr::execute_unknown, OP_UNKNOWN, 32} },
+    {0x01, { "maddu", OUT_R_DIVMULT, 0, &MIPSInstr::execute_unknown, OP_UNKNOWN, 32} },
+    {0x02, { "mul",   OUT_R_ARITHM,  0, &MIPSInstr::execute_mult,    OP_MULT, 32} },
+    {0x04, { "msub",  OUT_R_DIVMULT, 0, &MIPSInstr::execute_unknown, OP_UNKNOWN, 32} },
+    {0x05, { "msubu", OUT_R_DIVMULT, 0, &MIPSInstr::execute_unknown, OP_UNKNOWN, 32} },
+    {0x20, { "clz",   OUT_SP2_COUNT, 0, &MIPSInstr::execute_clz,     OP_CLZ, 32} },
+    {0x21, { "clo",   OUT_SP2_COUNT, 0, &MIPSInstr::execute_clo,     OP_CLO, 32} },
+});
+
+const MIPSInstr::ISAEntry& MIPSInstr::get_isa_entry() const
 {
-    bool valid = false;
-    auto it = isaMapRI.cbegin();
-
     switch ( instr.asR.opcode)
     {
         case 0x0: // R instruction
-            it = isaMapR.find( instr.asR.funct);
-            valid = ( it != isaMapR.end());
-            break;
+            return isaMapR[ instr.asR.funct];
 
         case 0x1: // RegIMM instruction
-            it = isaMapRI.find( instr.asI.rt);
-            valid = ( it != isaMapRI.end());
-            break;
+            return isaMapRI[ instr.asI.rt];
 
         case 0x1C: // MIPS32 instruction
-            it = isaMapMIPS32.find( instr.asR.funct);
-            valid = ( it != isaMapMIPS32.end());
-            break;
+            return isaMapMIPS32[ instr.asR.funct];
 
         default: // I and J instructions
-            it = isaMapIJ.find( instr.asR.opcode);
-            valid = ( it != isaMapIJ.end());
-            break;
+            return isaMapIJ[ instr.asR.opcode];
     }
+}
 
-    if ( valid)
-    {
-        init( it->second);
-    }
-    else {
-        std::ostringstream oss;
-        if ( PC != 0)
-            oss << std::hex << "0x" << PC << ": ";
-        oss << std::hex << std::setfill( '0')
-            << "0x" << std::setw( 8) << instr.raw << '\t' << "Unknown";
-        disasm = oss.str();
-    }
+MIPSInstr::MIPSInstr( uint32 bytes, Addr PC) :
+    instr( bytes),
+    new_PC( PC + 4),
+    PC( PC),
+    complete( false),
+    loaded( false),
+    trap_checked( false),
+    writes_dst( true),
+    _is_jump_taken( false)
+{
+    const auto& entry = get_isa_entry();
+    if ( entry.operation != OUT_UNKNOWN)
+        init( entry);
 }
 
 void MIPSInstr::init( const MIPSInstr::ISAEntry& entry)
 {
     operation = entry.operation;
     mem_size  = entry.mem_size;
-    function  = entry.function;
-
-    std::ostringstream oss;
-    if ( PC != 0)
-        oss << std::hex << "0x" << PC << ": ";
-    oss << entry.name;
+    op_id     = entry.op_id;
 
     switch ( operation)
     {
         case OUT_R_MFHI:
             src1 = MIPSRegister::mips_hi;
             dst  = MIPSRegister(instr.asR.rd);
-            oss <<  " $" << dst;
             break;
         case OUT_R_MFLO:
             src1 = MIPSRegister::mips_lo;
             dst  = MIPSRegister(instr.asR.rd);
-            oss <<  " $" << dst;
             break;
         case OUT_R_MTHI:
             src1 = MIPSRegister(instr.asR.rs);
             dst  = MIPSRegister::mips_hi;
-            oss <<  " $" << src1;
             break;
         case OUT_R_MTLO:
             src1 = MIPSRegister(instr.asR.rs);
             dst  = MIPSRegister::mips_lo;
-            oss <<  " $" << src1;
             break;
         case OUT_R_DIVMULT:
             src2 = MIPSRegister(instr.asR.rt);
             src1 = MIPSRegister(instr.asR.rs);
             dst  = MIPSRegister::mips_hi_lo;
-            oss <<  " $" << src1
-                << ", $" << src2;
             break;
         case OUT_R_ARITHM:
         case OUT_R_CONDM:
             src2 = MIPSRegister(instr.asR.rt);
             src1 = MIPSRegister(instr.asR.rs);
             dst  = MIPSRegister(instr.asR.rd);
-
-            oss <<  " $" << dst
-                << ", $" << src1
-                << ", $" << src2;
             break;
         case OUT_R_SHIFT:
             src2 = MIPSRegister(instr.asR.rs);
             src1 = MIPSRegister(instr.asR.rt);
             dst  = MIPSRegister(instr.asR.rd);
-
-            oss <<  " $" << dst
-                << ", $" << src1
-                << ", $" << src2;
             break;
         case OUT_R_SHAMT:
             src1  = MIPSRegister(instr.asR.rt);
             dst   = MIPSRegister(instr.asR.rd);
             shamt = instr.asR.shamt;
-
-            oss <<  " $" << dst
-                << ", $" << src1
-                <<  ", " << std::dec << shamt;
             break;
         case OUT_R_JUMP_LINK:
             src1  = MIPSRegister(instr.asR.rs);
             dst   = MIPSRegister(instr.asR.rd);
-            oss <<  " $" << dst
-                << ", $" << src1;
             break;
         case OUT_R_JUMP:
             dst = MIPSRegister::zero;
             src1  = MIPSRegister(instr.asR.rs);
-            oss << " $" << src1;
             break;
         case OUT_R_TRAP:
             dst = MIPSRegister::zero;
             src1 = MIPSRegister(instr.asR.rs);
             src2 = MIPSRegister(instr.asR.rt);
-
-            oss <<  " $" << src1
-                << ", $" << src2;
             break;
         case OUT_RI_TRAP:
             v_imm = instr.asI.imm;
             src1 = MIPSRegister(instr.asI.rs);
-
-            oss << " $" << src1 << ", "
-                << std::hex << "0x"
-                << static_cast<int16>(v_imm) << std::dec;
             break;
         case OUT_R_SPECIAL:
             break;
@@ -347,39 +316,23 @@ void MIPSInstr::init( const MIPSInstr::ISAEntry& entry)
             v_imm = instr.asI.imm;
             src1 = MIPSRegister(instr.asI.rs);
             dst  = MIPSRegister(instr.asI.rt);
-
-            oss << " $" << dst << ", $"
-                << src1 << ", "
-                << std::hex << "0x" << v_imm << std::dec;
             break;
         case OUT_I_BRANCH:
             v_imm = instr.asI.imm;
             src1 = MIPSRegister(instr.asI.rs);
             src2 = MIPSRegister(instr.asI.rt);
-
-            oss << " $" << src1 << ", $"
-                << src2 << ", "
-                << std::dec << static_cast<int16>(v_imm);
             break;
         case OUT_RI_BRANCH_0:
             v_imm = instr.asI.imm;
             src1 = MIPSRegister(instr.asI.rs);
-            oss << " $" << src1 << ", "
-                << std::dec << static_cast<int16>(v_imm);
             break;
         case OUT_I_BRANCH_0:
             v_imm = instr.asI.imm;
             src1 = MIPSRegister(instr.asI.rs);
-
-            oss << " $" << src1 << ", "
-                << std::dec << static_cast<int16>(v_imm);
             break;
         case OUT_I_CONST:
             v_imm = instr.asI.imm;
             dst  = MIPSRegister(instr.asI.rt);
-
-            oss << " $" << dst << std::hex
-                << ", 0x" << v_imm << std::dec;
             break;
 
         case OUT_I_LOAD:
@@ -389,10 +342,6 @@ void MIPSInstr::init( const MIPSInstr::ISAEntry& entry)
             v_imm = instr.asI.imm;
             src1 = MIPSRegister(instr.asI.rs);
             dst  = MIPSRegister(instr.asI.rt);
-
-            oss << " $" << dst << ", 0x"
-                << std::hex << v_imm
-                << "($" << src1 << ")" << std::dec;
             break;
 
         case OUT_I_STORE:
@@ -402,60 +351,252 @@ void MIPSInstr::init( const MIPSInstr::ISAEntry& entry)
             src2 = MIPSRegister(instr.asI.rt);
             src1 = MIPSRegister(instr.asI.rs);
             dst  = MIPSRegister::zero;
-
-            oss << " $" << src2 << ", 0x"
-                << std::hex << v_imm
-                << "($" << src1 << ")" << std::dec;
             break;
         case OUT_RI_BRANCH_LINK:
             v_imm = instr.asI.imm;
             src1 = MIPSRegister(instr.asI.rs);
             dst = MIPSRegister::return_address;
-            oss << " $" << src1 << ", "
-                << std::dec << static_cast<int16>(v_imm);
             break;
         case OUT_J_JUMP_LINK:
             v_imm = instr.asJ.imm;
             dst = MIPSRegister::return_address;
-            oss << " 0x"
-                << std::hex << static_cast<uint16>(v_imm) << std::dec;
             break;
         case OUT_J_JUMP:
             v_imm = instr.asJ.imm;
             dst = MIPSRegister::zero;
-            oss << " 0x"
-                << std::hex << static_cast<uint16>(v_imm) << std::dec;
             break;
         case OUT_SP2_COUNT:
             src1 = MIPSRegister(instr.asR.rs);
             dst  = MIPSRegister(instr.asR.rd);
+            break;
+        default:
+            assert( false);
+    }
+}
+
+void MIPSInstr::dump_instr( std::ostream& oss) const
+{
+    if ( operation == OUT_UNKNOWN)
+    {
+        if ( PC != 0)
+            oss << std::hex << "0x" << PC << ": ";
+        oss << std::hex << std::setfill( '0')
+            << "0x" << std::setw( 8) << instr.raw << '\t' << "Unknown";
+        return;
+    }
+
+    if ( instr.raw == 0x0ul)
+    {
+        oss << "nop ";
+        return;
+    }
+
+    if ( PC != 0)
+        oss << std::hex << "0x" << PC << ": ";
+    oss << get_isa_entry().name;
+
+    switch ( operation)
+    {
+        case OUT_R_MFHI:
+            oss <<  " $" << dst;
+            break;
+        case OUT_R_MFLO:
+            oss <<  " $" << dst;
+            break;
+        case OUT_R_MTHI:
+            oss <<  " $" << src1;
+            break;
+        case OUT_R_MTLO:
+            oss <<  " $" << src1;
+            break;
+        case OUT_R_DIVMULT:
+            oss <<  " $" << src1
+                << ", $" << src2;
+            break;
+        case OUT_R_ARITHM:
+        case OUT_R_CONDM:
+            oss <<  " $" << dst
+                << ", $" << src1
+                << ", $" << src2;
+            break;
+        case OUT_R_SHIFT:
+            oss <<  " $" << dst
+                << ", $" << src1
+                << ", $" << src2;
+            break;
+        case OUT_R_SHAMT:
+            oss <<  " $" << dst
+                << ", $" << src1
+                <<  ", " << std::dec << static_cast<uint32>( shamt);
+            break;
+        case OUT_R_JUMP_LINK:
+            oss <<  " $" << dst
+                << ", $" << src1;
+            break;
+        case OUT_R_JUMP:
+            oss << " $" << src1;
+            break;
+        case OUT_R_TRAP:
+            oss <<  " $" << src1
+                << ", $" << src2;
+            break;
+        case OUT_RI_TRAP:
+            oss << " $" << src1 << ", "
+                << std::hex << "0x"
+                << static_cast<int16>(v_imm) << std::dec;
+            break;
+        case OUT_R_SPECIAL:
+            break;
+        case OUT_I_ARITHM:
+            oss << " $" << dst << ", $"
+                << src1 << ", "
+                << std::hex << "0x" << v_imm << std::dec;
+            break;
+        case OUT_I_BRANCH:
+            oss << " $" << src1 << ", $"
+                << src2 << ", "
+                << std::dec << static_cast<int16>(v_imm);
+            break;
+        case OUT_RI_BRANCH_0:
+            oss << " $" << src1 << ", "
+                << std::dec << static_cast<int16>(v_imm);
+            break;
+        case OUT_I_BRANCH_0:
+            oss << " $" << src1 << ", "
+                << std::dec << static_cast<int16>(v_imm);
+            break;
+        case OUT_I_CONST:
+            oss << " $" << dst << std::hex
+                << ", 0x" << v_imm << std::dec;
+            break;
+
+        case OUT_I_LOAD:
+        case OUT_I_LOADU:
+        case OUT_I_LOADL:
+        case OUT_I_LOADR:
+            oss << " $" << dst << ", 0x"
+                << std::hex << v_imm
+                << "($" << src1 << ")" << std::dec;
+            break;
 
+        case OUT_I_STORE:
+        case OUT_I_STOREL:
+        case OUT_I_STORER:
+            oss << " $" << src2 << ", 0x"
+                << std::hex << v_imm
+                << "($" << src1 << ")" << std::dec;
+            break;
+        case OUT_RI_BRANCH_LINK:
+            oss << " $" << src1 << ", "
+                << std::dec << static_cast<int16>(v_imm);
+            break;
+        case OUT_J_JUMP_LINK:
+            oss << " 0x"
+                << std::hex << static_cast<uint16>(v_imm) << std::dec;
+            break;
+        case OUT_J_JUMP:
+            oss << " 0x"
+                << std::hex << static_cast<uint16>(v_imm) << std::dec;
+            break;
+        case OUT_SP2_COUNT:
             oss <<  " $" << dst 
                 << ", $" << src1;
             break;
         default:
             assert( false);
     }
-    if ( instr.raw == 0x0ul)
-        disasm = "nop ";
-    else
-        disasm = oss.str();
 }
 
 void MIPSInstr::execute_unknown()
 {
-    std::cerr << "ERROR.Incorrect instruction: " << disasm << std::endl;
+    std::cerr << "ERROR.Incorrect instruction: " << *this << std::endl;
     exit(EXIT_FAILURE);
 }
 
 void MIPSInstr::execute()
 {
-    (this->*function)();
+    // handler is not kept in the instruction to keep it compact
+    (this->*get_isa_entry().function)();
     complete = true;
+}
+
+void MIPSInstr::execute_dispatched()
+{
+    // predicates are template arguments here, so each case
+    // is compiled into a handler with the predicate inlined
+    switch ( op_id)
+    {
+        case OP_UNKNOWN: execute_unknown(); break;
+        case OP_SLL: execute_sll(); break;
+        case OP_SRL: execute_srl(); break;
+        case OP_SRA: execute_sra(); break;
+        case OP_SLLV: execute_sllv(); break;
+        case OP_SRLV: execute_srlv(); break;
+        case OP_SRAV: execute_srav(); break;
+        case OP_JR: execute_jr(); break;
+        case OP_JALR: execute_jalr(); break;
+        case OP_MOVZ: execute_movz(); break;
+        case OP_MOVN: execute_movn(); break;
+        case OP_SYSCALL: execute_syscall(); break;
+        case OP_BREAK: execute_break(); break;
+        case OP_MOVE: execute_move(); break;
+        case OP_MULT: execute_mult(); break;
+        case OP_MULTU: execute_multu(); break;
+        case OP_DIV: execute_div(); break;
+        case OP_DIVU: execute_divu(); break;
+        case OP_ADD: execute_add(); break;
+        case OP_ADDU: execute_addu(); break;
+        case OP_SUB: execute_sub(); break;
+        case OP_SUBU: execute_subu(); break;
+        case OP_AND: execute_and(); break;
+        case OP_OR: execute_or(); break;
+        case OP_XOR: execute_xor(); break;
+        case OP_NOR: execute_nor(); break;
+        case OP_SET_LT: execute_set<&MIPSInstr::lt>(); break;
+        case OP_SET_LTU: execute_set<&MIPSInstr::ltu>(); break;
+        case OP_TRAP_GE: execute_trap<&MIPSInstr::ge>(); break;
+        case OP_TRAP_GEU: execute_trap<&MIPSInstr::geu>(); break;
+        case OP_TRAP_LT: execute_trap<&MIPSInstr::lt>(); break;
+        case OP_TRAP_LTU: execute_trap<&MIPSInstr::ltu>(); break;
+        case OP_TRAP_EQ: execute_trap<&MIPSInstr::eq>(); break;
+        case OP_TRAP_NE: execute_trap<&MIPSInstr::ne>(); break;
+        case OP_BRANCH_LTZ: execute_branch<&MIPSInstr::ltz>(); break;
+        case OP_BRANCH_GEZ: execute_branch<&MIPSInstr::gez>(); break;
+        case OP_TRAP_GEI: execute_trap<&MIPSInstr::gei>(); break;
+        case OP_TRAP_GEIU: execute_trap<&MIPSInstr::geiu>(); break;
+        case OP_TRAP_LTI: execute_trap<&MIPSInstr::lti>(); break;
+        case OP_TRAP_LTIU: execute_trap<&MIPSInstr::ltiu>(); break;
+        case OP_TRAP_EQI: execute_trap<&MIPSInstr::eqi>(); break;
+        case OP_TRAP_NEI: execute_trap<&MIPSInstr::nei>(); break;
+        case OP_BRANCH_AND_LINK_LTZ: execute_branch_and_link<&MIPSInstr::ltz>(); break;
+        case OP_BRANCH_AND_LINK_GEZ: execute_branch_and_link<&MIPSInstr::gez>(); break;
+        case OP_J: execute_j(); break;
+        case OP_JAL: execute_jal(); break;
+        case OP_BRANCH_EQ: execute_branch<&MIPSInstr::eq>(); break;
+        case OP_BRANCH_NE: execute_branch<&MIPSInstr::ne>(); break;
+        case OP_BRANCH_LEZ: execute_branch<&MIPSInstr::lez>(); break;
+        case OP_BRANCH_GTZ: execute_branch<&MIPSInstr::gtz>(); break;
+        case OP_ADDI: execute_addi(); break;
+        case OP_ADDIU: execute_addiu(); break;
+        case OP_SET_LTI: execute_set<&MIPSInstr::lti>(); break;
+        case OP_SET_LTIU: execute_set<&MIPSInstr::ltiu>(); break;
+        case OP_ANDI: execute_andi(); break;
+        case OP_ORI: execute_ori(); break;
+        case OP_XORI: execute_xori(); break;
+        case OP_LUI: execute_lui(); break;
+        case OP_LOAD_ADDR: calculate_load_addr(); break;
+        case OP_STORE_ADDR: calculate_store_addr(); break;
+        case OP_CLZ: execute_clz(); break;
+        case OP_CLO: execute_clo(); break;
+        default: assert( false);
+    }
+    complete = true;
+}
 
-    if ( !dst.is_zero() && !is_load() && get_writes_dst())
+void MIPSInstr::dump_results( std::ostream& oss) const
+{
+    if ( complete && !dst.is_zero() && !is_load() && get_writes_dst())
     {
-        std::ostringstream oss;
         oss << "\t [ $" << std::hex;
         if ( dst.is_mips_hi_lo())
             oss <<  MIPSRegister::mips_hi << " = 0x" << static_cast<uint32>( v_dst >> 32) << ", $"
@@ -464,8 +605,38 @@ void MIPSInstr::execute()
             oss <<  dst;
 
         oss << " = 0x" << static_cast<uint32>( v_dst) << " ]";
-        disasm += oss.str();
     }
+
+    if ( loaded && !dst.is_zero())
+    {
+        oss << "\t [ $" << dst
+            << " = 0x" << std::hex << v_dst << "]";
+    }
+
+    if ( trap_checked && trap != TrapType::NO_TRAP)
+        oss << "\t trap";
+}
+
+void MIPSInstr::dump( std::ostream& out) const
+{
+    // output formatting is restored, so rendering does not depend on stream state
+    const auto flags = out.flags( std::ios_base::dec);
+    const auto fill = out.fill( ' ');
+
+    dump_instr( out);
+    dump_results( out);
+
+    out.flags( flags);
+    out.fill( fill);
+}
+
+std::string MIPSInstr::Dump() const
+{
+    // the stream is reused, as its construction costs more than the rendering
+    thread_local std::ostringstream oss;
+    oss.str( std::string());
+    dump( oss);
+    return oss.str();
 }
 
 void MIPSInstr::set_v_dst( uint32 value)
@@ -489,22 +660,11 @@ void MIPSInstr::set_v_dst( uint32 value)
         assert( false);
     }
 
-    if ( !dst.is_zero())
-    {
-        std::ostringstream oss;
-        oss << "\t [ $" << dst
-            << " = 0x" << std::hex << v_dst << "]";
-        disasm += oss.str();
-    }
+    loaded = true;
 }
 
 void MIPSInstr::check_trap()
 {
-    if ( trap != TrapType::NO_TRAP)
-    {
-        std::ostringstream oss;
-        oss << "\t trap";
-        disasm += oss.str();
-    }
+    trap_checked = true;
 }
 
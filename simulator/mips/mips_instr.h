@@ -11,12 +11,14 @@
 // Generic C++
 #include <cassert>
 #include <array>
-#include <unordered_map>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <utility>
 
 // MIPT-MIPS modules
 #include <infra/types.h>
 #include <infra/macro.h>
-#include <infra/string/cow_string.h>
 
 #include "mips_register/mips_register.h"
 
@@ -53,8 +55,13 @@ uint64 mips_division(T x, T y) {
     return static_cast<uint64>(static_cast<uint32>(x1 / y1)) | (static_cast<uint64>(static_cast<uint32>(x1 % y1)) << 32);
 }
 
+class MIPSTranslator;
+
 class MIPSInstr
 {
+    // translator reads decoded fields to select operations of translated code
+    friend class MIPSTranslator;
+
     private:
         enum OperationType : uint8
         {
@@ -92,12 +99,84 @@ class MIPSInstr
             OUT_UNKNOWN
         } operation = OUT_UNKNOWN;
 
+        // Dense ids of execution handlers for switch dispatch,
+        // branches and traps have a separate id for each predicate
+        enum OpId : uint8
+        {
+            OP_UNKNOWN,
+            OP_SLL,
+            OP_SRL,
+            OP_SRA,
+            OP_SLLV,
+            OP_SRLV,
+            OP_SRAV,
+            OP_JR,
+            OP_JALR,
+            OP_MOVZ,
+            OP_MOVN,
+            OP_SYSCALL,
+            OP_BREAK,
+            OP_MOVE,
+            OP_MULT,
+            OP_MULTU,
+            OP_DIV,
+            OP_DIVU,
+            OP_ADD,
+            OP_ADDU,
+            OP_SUB,
+            OP_SUBU,
+            OP_AND,
+            OP_OR,
+            OP_XOR,
+            OP_NOR,
+            OP_SET_LT,
+            OP_SET_LTU,
+            OP_TRAP_GE,
+            OP_TRAP_GEU,
+            OP_TRAP_LT,
+            OP_TRAP_LTU,
+            OP_TRAP_EQ,
+            OP_TRAP_NE,
+            OP_BRANCH_LTZ,
+            OP_BRANCH_GEZ,
+            OP_TRAP_GEI,
+            OP_TRAP_GEIU,
+            OP_TRAP_LTI,
+            OP_TRAP_LTIU,
+            OP_TRAP_EQI,
+            OP_TRAP_NEI,
+            OP_BRANCH_AND_LINK_LTZ,
+            OP_BRANCH_AND_LINK_GEZ,
+            OP_J,
+            OP_JAL,
+            OP_BRANCH_EQ,
+            OP_BRANCH_NE,
+            OP_BRANCH_LEZ,
+            OP_BRANCH_GTZ,
+            OP_ADDI,
+            OP_ADDIU,
+            OP_SET_LTI,
+            OP_SET_LTIU,
+            OP_ANDI,
+            OP_ORI,
+            OP_XORI,
+            OP_LUI,
+            OP_LOAD_ADDR,
+            OP_STORE_ADDR,
+            OP_CLZ,
+            OP_CLO
+        } op_id = OP_UNKNOWN;
+
         enum class TrapType : uint8
         {
             NO_TRAP,
             EXPLICIT_TRAP,
         } trap = TrapType::NO_TRAP;
 
+        // Fields are ordered to avoid padding: instructions are copied
+        // through all ports of performance simulator, so size matters
+        uint8 shamt = NO_VAL8;
+
         const union _instr
         {
             const struct AsR
@@ -142,43 +221,50 @@ class MIPSInstr
             OperationType operation;
             uint8 mem_size;
             MIPSInstr::Execute function;
+            OpId op_id;
             uint8 mips_version;
         };
 
-        static const std::unordered_map <uint8, MIPSInstr::ISAEntry> isaMapR;
-        static const std::unordered_map <uint8, MIPSInstr::ISAEntry> isaMapRI;
-        static const std::unordered_map <uint8, MIPSInstr::ISAEntry> isaMapIJ;
-        static const std::unordered_map <uint8, MIPSInstr::ISAEntry> isaMapMIPS32;
+        // Tables are indexed directly by 6-bit opcode or funct field,
+        // holes are filled by the invalid entry
+        using ISATable = std::array<ISAEntry, 64>;
+        static constexpr ISATable get_isa_table( std::initializer_list<std::pair<uint8, ISAEntry>> entries);
+        static const ISAEntry invalid_entry;
+
+        static const ISATable isaMapR;
+        static const ISATable isaMapRI;
+        static const ISATable isaMapIJ;
+        static const ISATable isaMapMIPS32;
 
         MIPSRegister src1 = MIPSRegister::zero;
         MIPSRegister src2 = MIPSRegister::zero;
         MIPSRegister dst = MIPSRegister::zero;
+        uint8 mem_size = NO_VAL8;
 
         uint32 v_imm = NO_VAL32;
         uint32 v_src1 = NO_VAL32;
         uint32 v_src2 = NO_VAL32;
         uint64 v_dst = NO_VAL64;
-        uint16 shamt = NO_VAL16;
         Addr mem_addr = NO_VAL32;
-        uint32 mem_size = NO_VAL32;
-
-        // convert this to bitset
-        bool complete   = false;
-        bool writes_dst = true;
-        bool _is_jump_taken = false;      // actual result
 
         Addr new_PC = NO_VAL32;
 
         const Addr PC = NO_VAL32;
 
-#if 0
-        std::string disasm = {};
-#else
-        CowString disasm = {};
-#endif
+        // bit-fields are initialized by constructor
+        bool complete       : 1;
+        bool loaded         : 1; // load result is received
+        bool trap_checked   : 1;
+        bool writes_dst     : 1;
+        bool _is_jump_taken : 1; // actual result
 
+        const ISAEntry& get_isa_entry() const;
         void init( const ISAEntry& entry);
 
+        // Disassembly is rendered on demand from the decoded fields
+        void dump_instr( std::ostream& oss) const;
+        void dump_results( std::ostream& oss) const;
+
         // Predicate helpers - unary
         bool lez() const { return static_cast<int32>( v_src1) <= 0; }
         bool gez() const { return static_cast<int32>( v_src1) >= 0; }
@@ -285,14 +371,14 @@ class MIPSInstr
         void calculate_load_addr()  { mem_addr = v_src1 + sign_extend(v_imm); }
         void calculate_store_addr() { mem_addr = v_src1 + sign_extend(v_imm); }
 
-        Execute function = &MIPSInstr::execute_unknown;
     public:
         MIPSInstr() = delete;
 
         explicit
         MIPSInstr( uint32 bytes, Addr PC = 0);
 
-        const std::string_view Dump() const { return static_cast<std::string_view>(disasm); }
+        void dump( std::ostream& out) const;
+        std::string Dump() const;
         bool is_same( const MIPSInstr& rhs) const {
             return PC == rhs.PC && instr.raw == rhs.instr.raw;
         }
@@ -311,6 +397,11 @@ class MIPSInstr
                                       operation == OUT_I_BRANCH;     }
         bool is_jump_taken() const { return  _is_jump_taken; }
 
+        /* Kinds of jumps for target prediction */
+        bool is_call() const { return operation == OUT_J_JUMP_LINK || operation == OUT_R_JUMP_LINK; }
+        bool is_indirect_jump() const { return operation == OUT_R_JUMP || operation == OUT_R_JUMP_LINK; }
+        bool is_return() const { return operation == OUT_R_JUMP && src1 == MIPSRegister::return_address; }
+
         bool is_load()  const { return operation == OUT_I_LOAD  ||
                                        operation == OUT_I_LOADU ||
                                        operation == OUT_I_LOADR ||
@@ -323,6 +414,10 @@ class MIPSInstr
 
         bool is_conditional_move() const { return operation == OUT_R_CONDM; }
 
+        /* Kinds of arithmetic executed by dedicated functional units */
+        bool is_multiplication() const { return op_id == OP_MULT || op_id == OP_MULTU; }
+        bool is_division() const { return op_id == OP_DIV || op_id == OP_DIVU; }
+
         bool has_trap() const { return trap != TrapType::NO_TRAP; }
 
         bool get_writes_dst() const { return writes_dst; }
@@ -343,6 +438,15 @@ class MIPSInstr
         uint32 get_mem_size() const { return mem_size; }
         Addr get_new_PC() const { return new_PC; }
         Addr get_PC() const { return PC; }
+        uint32 get_bytes() const { return instr.raw; }
+
+        // results recorded in instruction trace are used instead of execution
+        void set_recorded_result( bool is_taken, Addr target, Addr addr)
+        {
+            _is_jump_taken = is_taken;
+            new_PC = target;
+            mem_addr = addr;
+        }
 
         void set_v_dst(uint32 value); // for loads
         uint32 get_v_src2() const { return v_src2; } // for stores
@@ -353,12 +457,16 @@ class MIPSInstr
         }
 
         void execute();
+        // Same as execute(), but dispatched by a switch over op id
+        // instead of a call through Execute member pointer
+        void execute_dispatched();
         void check_trap();
 };
 
 static inline std::ostream& operator<<( std::ostream& out, const MIPSInstr& instr)
 {
-    return out << instr.Dump();
+    instr.dump( out);
+    return out;
 }
 
 #endif //MIPS_INSTR_H
@@ -10,6 +10,7 @@ const MIPSRegister MIPSRegister::mips_lo = MIPSRegister( MIPS_REG_lo);
 const MIPSRegister MIPSRegister::mips_hi_lo = MIPSRegister( MIPS_REG_hi_lo);
 const MIPSRegister MIPSRegister::zero = MIPSRegister( MIPS_REG_zero);
 const MIPSRegister MIPSRegister::return_address = MIPSRegister( MIPS_REG_ra);
+const MIPSRegister MIPSRegister::first_argument = MIPSRegister( MIPS_REG_a0);
 
 std::array<std::string_view, MIPSRegister::MAX_REG> MIPSRegister::regTable =
 {{
@@ -32,7 +32,7 @@ public:
     explicit MIPSRegister( uint8 id) : MIPSRegister( static_cast<RegNum>( id))
     {
         if ( id >= 32u) {
-            std::cerr << "ERROR: Invalid MIPS register id = " << id;
+            std::cerr << "ERROR: Invalid MIPS register id = " << static_cast<uint32>( id) << std::endl;
             exit( EXIT_FAILURE);
         }
     }
@@ -53,6 +53,7 @@ public:
     static const MIPSRegister mips_hi_lo;
     static const MIPSRegister zero;
     static const MIPSRegister return_address;
+    static const MIPSRegister first_argument;
 
     bool operator==( const MIPSRegister& rhs) const { return value == rhs.value; }
     bool operator!=( const MIPSRegister& rhs) const { return !operator==(rhs); }
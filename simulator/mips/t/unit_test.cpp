@@ -2,6 +2,12 @@
 #include <cassert>
 #include <cstdlib>
 
+// generic C++
+#include <array>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
 // Google Test library
 #include <gtest/gtest.h>
 
@@ -154,6 +160,79 @@ TEST( MIPS_instr_disasm, Process_Disasm)
     ASSERT_EQ(MIPSInstr(0x0c0004d2).Dump(), "jal 0x4d2");
 }
 
+TEST( MIPS_instr_disasm, Dump_Into_Stream)
+{
+    MIPSInstr instr( 0x2484ae10, 0x400000); // addiu $a0, $a0, 0xae10
+    instr.set_v_src( 1, 0);
+    instr.execute();
+
+    // rendering does not depend on stream formatting and keeps it
+    std::ostringstream oss;
+    oss << std::hex << std::setfill( '*') << instr << ' ' << 17;
+    ASSERT_EQ( oss.str(), "0x400000: addiu $a0, $a0, 0xae10\t [ $a0 = 0xffffae11 ] 11");
+    ASSERT_EQ( oss.fill(), '*');
+    ASSERT_EQ( instr.Dump(), "0x400000: addiu $a0, $a0, 0xae10\t [ $a0 = 0xffffae11 ]");
+}
+
+// instructions which do not write registers, so execution
+// does not touch disassembly
+static const std::array<uint32, 16> dispatch_test_instrs =
+{
+    0x01390020, // add $zero, $t1, $t9
+    0x0139002a, // slt $zero, $t1, $t9
+    0x0139002b, // sltu $zero, $t1, $t9
+    0x1229000e, // beq $s1, $t1, 14
+    0x16290000, // bne $s1, $t1, 0
+    0x0621000c, // bgez $s1, 12
+    0x06200002, // bltz $s1, 2
+    0x1e200008, // bgtz $s1, 8
+    0x1a200006, // blez $s1, 6
+    0x02290030, // tge $s1, $t1
+    0x02290033, // tltu $s1, $t1
+    0x02290034, // teq $s1, $t1
+    0xae3104d2, // sw $s1, 0x4d2($t1)
+    0xa23104d2, // sb $s1, 0x4d2($t1)
+    0x080004d2, // j 0x4d2
+    0x02200008  // jr $s1
+};
+
+TEST( MIPS_instr_dispatch, Dispatch_Matches_Member_Pointers)
+{
+    const std::array<std::pair<uint32, uint32>, 4> sources =
+    {{
+        { 0, 0 }, { 1, 1 }, { 0xffffffff, 2 }, { 7, 0x80000000 }
+    }};
+
+    for ( uint32 bytes : dispatch_test_instrs)
+        for ( const auto& src : sources)
+        {
+            MIPSInstr by_pointer( bytes, 0x400000);
+            MIPSInstr by_switch( bytes, 0x400000);
+            for ( auto* instr : { &by_pointer, &by_switch})
+            {
+                instr->set_v_src( src.first, 0);
+                instr->set_v_src( src.second, 1);
+            }
+
+            by_pointer.execute();
+            by_switch.execute_dispatched();
+
+            ASSERT_EQ( by_pointer.get_v_dst(), by_switch.get_v_dst());
+            ASSERT_EQ( by_pointer.get_new_PC(), by_switch.get_new_PC());
+            ASSERT_EQ( by_pointer.is_jump_taken(), by_switch.is_jump_taken());
+            ASSERT_EQ( by_pointer.has_trap(), by_switch.has_trap());
+            ASSERT_EQ( by_pointer.get_mem_addr(), by_switch.get_mem_addr());
+            ASSERT_EQ( by_pointer.Dump(), by_switch.Dump());
+        }
+
+    // register-writing instructions have the same disassembly
+    MIPSInstr by_pointer( 0x01398820); // add $s1, $t1, $t9
+    MIPSInstr by_switch( 0x01398820);
+    by_pointer.execute();
+    by_switch.execute_dispatched();
+    ASSERT_EQ( by_pointer.Dump(), by_switch.Dump());
+}
+
 int main( int argc, char* argv[])
 {
     ::testing::InitGoogleTest( &argc, argv);
@@ -0,0 +1,325 @@
+/**
+ * ooo_core.cpp - out-of-order execution core
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <infra/config/config.h>
+
+#include <algorithm>
+
+#include "ooo_core.h"
+
+namespace config {
+    static Value<uint32> rob_size = { "rob-size", 64, "number of entries in reorder buffer of out-of-order core"};
+    static Value<uint32> iq_size = { "iq-size", 32, "number of entries in issue queue of out-of-order core"};
+    static Value<uint32> lsq_size = { "lsq-size", 16, "number of entries in load/store queue of out-of-order core"};
+    static Value<uint32> load_latency = { "load-latency", 2, "latency of loads in out-of-order core (in cycles)"};
+} // namespace config
+
+template <typename ISA>
+OOOCore<ISA>::OOOCore( bool log, uint32 width) : Log( log)
+    , width( width)
+    , rob_size( config::rob_size)
+    , iq_size( config::iq_size)
+    , lsq_size( config::lsq_size)
+    , load_latency( config::load_latency)
+    , input( "FETCH_2_DECODE", "DECODE_2_FETCH_STALL", width)
+{
+    if ( rob_size == 0 || iq_size == 0 || lsq_size == 0 || load_latency == 0_Lt)
+        serr << "ERROR. Sizes of out-of-order structures and load latency should be greater than zero"
+             << std::endl << critical;
+
+    wp_flush_target = make_write_port<Addr>("MEMORY_2_FETCH_TARGET", PORT_BW, PORT_FANOUT);
+    // retired jumps and one mispredicted jump may update predictor at the same cycle
+    wp_bp_update = make_write_port<BPResolution>("MEMORY_2_FETCH", width + 1, PORT_FANOUT);
+
+    wp_writeback = make_write_port<Instr>("MEMORY_2_WRITEBACK", width, PORT_FANOUT);
+    rp_writeback_bypass = make_read_port<RegDstUInt>("WRITEBACK_2_EXECUTE_BYPASS", PORT_LATENCY);
+}
+
+template <typename ISA>
+typename OOOCore<ISA>::Operand OOOCore<ISA>::rename_register( Register num) const
+{
+    Operand operand;
+    if ( num.is_zero())
+        return operand;
+
+    const auto& producer = rename_table.at( num.to_size_t());
+    if ( !producer)
+        return operand;
+
+    const auto& entry = get_entry( *producer);
+    if ( !entry.is_completed)
+    {
+        operand.producer = producer;
+        return operand;
+    }
+
+    operand.is_bypassed = true;
+    operand.value = num.is_mips_hi() ? entry.result >> 32 : entry.result;
+    return operand;
+}
+
+template <typename ISA>
+void OOOCore<ISA>::rename_dst( Register num, std::optional<uint64> producer)
+{
+    if ( num.is_zero())
+        return;
+
+    if ( num.is_mips_hi_lo())
+    {
+        rename_table.at( Register::mips_hi.to_size_t()) = producer;
+        rename_table.at( Register::mips_lo.to_size_t()) = producer;
+        return;
+    }
+
+    rename_table.at( num.to_size_t()) = producer;
+}
+
+template <typename ISA>
+void OOOCore<ISA>::rebuild_rename_table()
+{
+    rename_table.fill( std::nullopt);
+    for ( const auto& entry : rob)
+        rename_dst( entry.instr.get_dst_num(), entry.id);
+}
+
+template <typename ISA>
+void OOOCore<ISA>::dispatch( Cycle cycle)
+{
+    /* kept instructions and the ones fetched in the last cycle are invalid after flush */
+    if ( is_flushed)
+    {
+        input.flush( cycle);
+        is_flushed = false;
+        return;
+    }
+
+    input.receive( cycle);
+    const auto bundle_size = input.get_bundle_size();
+    for ( size_t i = 0; i < bundle_size; ++i)
+    {
+        const auto& instr = input[ i];
+        const bool is_memory = instr.is_load() || instr.is_store();
+
+        const bool is_rob_full = rob.size() >= rob_size;
+        const bool is_iq_full = iq_occupancy >= iq_size;
+        const bool is_lsq_full = is_memory && lsq_occupancy >= lsq_size;
+        if ( is_rob_full || is_iq_full || is_lsq_full)
+        {
+            statistics.rob_full += is_rob_full ? 1 : 0;
+            statistics.iq_full += is_iq_full ? 1 : 0;
+            statistics.lsq_full += is_lsq_full ? 1 : 0;
+
+            TRACE( sout) << "dispatch cycle " << std::dec << cycle << ": " << instr << " (structural hazard)" << std::endl;
+            input.pass( i, cycle);
+            return;
+        }
+
+        auto& entry = rob.emplace_back( instr, next_id++);
+        for ( uint8 src_index = 0; src_index < entry.sources.size(); ++src_index)
+        {
+            entry.sources[ src_index] = rename_register( instr.get_src_num( src_index));
+            if ( !entry.sources[ src_index].producer && !entry.sources[ src_index].is_bypassed)
+                rf->read_source( &entry.instr, src_index);
+        }
+
+        if ( instr.is_conditional_move())
+        {
+            entry.old_dst = rename_register( instr.get_dst_num());
+            if ( !entry.old_dst.producer && !entry.old_dst.is_bypassed)
+                entry.old_dst.value = rf->read_dst( instr);
+        }
+
+        rename_dst( instr.get_dst_num(), entry.id);
+
+        ++iq_occupancy;
+        lsq_occupancy += is_memory ? 1 : 0;
+        TRACE( sout) << "dispatch cycle " << std::dec << cycle << ": " << instr << std::endl;
+    }
+    input.pass( bundle_size, cycle);
+}
+
+template <typename ISA>
+void OOOCore<ISA>::retire( Cycle cycle)
+{
+    for ( uint32 i = 0; i < width && !rob.empty() && rob.front().is_completed; ++i)
+    {
+        auto& entry = rob.front();
+
+        /* stores write memory in program order */
+        if ( entry.instr.is_store())
+            memory->load_store( &entry.instr);
+
+        if ( entry.instr.is_jump() && !entry.is_bp_updated)
+            wp_bp_update->write( entry.instr.get_bp_resolution(), cycle);
+
+        /* the register is read from RF if there are no younger producers */
+        for ( auto& producer : rename_table)
+            if ( producer == entry.id)
+                producer = std::nullopt;
+
+        lsq_occupancy -= ( entry.instr.is_load() || entry.instr.is_store()) ? 1 : 0;
+        wp_writeback->write( entry.instr, cycle);
+        TRACE( sout) << "retire   cycle " << std::dec << cycle << ": " << entry.instr << std::endl;
+        rob.pop_front();
+    }
+}
+
+template <typename ISA>
+void OOOCore<ISA>::wake_up( Cycle cycle)
+{
+    for ( auto& producer : rob)
+    {
+        if ( !producer.is_issued || producer.is_completed || producer.complete_cycle > cycle)
+            continue;
+
+        producer.is_completed = true;
+
+        /* results are broadcasted to the waiting younger instructions */
+        for ( auto& consumer : rob)
+        {
+            for ( uint8 src_index = 0; src_index < consumer.sources.size(); ++src_index)
+            {
+                auto& operand = consumer.sources[ src_index];
+                if ( operand.producer != producer.id)
+                    continue;
+
+                operand.producer = std::nullopt;
+                operand.is_bypassed = true;
+                operand.value = consumer.instr.get_src_num( src_index).is_mips_hi() ? producer.result >> 32 : producer.result;
+            }
+
+            if ( consumer.old_dst.producer == producer.id)
+            {
+                consumer.old_dst.producer = std::nullopt;
+                consumer.old_dst.is_bypassed = true;
+                consumer.old_dst.value = producer.result;
+            }
+        }
+    }
+}
+
+template <typename ISA>
+bool OOOCore<ISA>::is_ready( const Entry& entry) const
+{
+    return std::none_of( entry.sources.begin(), entry.sources.end(), []( const Operand& o) { return o.producer.has_value(); })
+        && !entry.old_dst.producer;
+}
+
+template <typename ISA>
+void OOOCore<ISA>::execute( Instr* instr, const Entry& entry)
+{
+    for ( uint8 src_index = 0; src_index < entry.sources.size(); ++src_index)
+        if ( entry.sources[ src_index].is_bypassed)
+            instr->set_v_src( entry.sources[ src_index].value, src_index);
+
+    instr->execute();
+}
+
+template <typename ISA>
+bool OOOCore<ISA>::is_blocked_by_stores( const Entry& load) const
+{
+    /* address of the load is calculated in advance */
+    auto instr = load.instr;
+    execute( &instr, load);
+    const Addr begin = instr.get_mem_addr();
+    const Addr end = begin + instr.get_mem_size();
+
+    for ( const auto& entry : rob)
+    {
+        if ( entry.id == load.id)
+            return false;
+
+        if ( !entry.instr.is_store())
+            continue;
+
+        /* address of the store is unknown yet */
+        if ( !entry.is_issued)
+            return true;
+
+        const Addr store_begin = entry.instr.get_mem_addr();
+        const Addr store_end = store_begin + entry.instr.get_mem_size();
+        if ( store_begin < end && begin < store_end)
+            return true;
+    }
+    return false;
+}
+
+template <typename ISA>
+void OOOCore<ISA>::flush_younger( const Entry& jump, Cycle cycle)
+{
+    while ( rob.back().id != jump.id)
+    {
+        const auto& entry = rob.back();
+        iq_occupancy -= entry.is_issued ? 0 : 1;
+        lsq_occupancy -= ( entry.instr.is_load() || entry.instr.is_store()) ? 1 : 0;
+        rob.pop_back();
+    }
+
+    // sequence numbers of entries are contiguous, so they index the buffer
+    next_id = jump.id + 1;
+    rebuild_rename_table();
+    is_flushed = true;
+
+    /* sending valid PC to fetch stage */
+    wp_flush_target->write( jump.instr.get_new_PC(), cycle);
+    ++statistics.mispredictions;
+}
+
+template <typename ISA>
+void OOOCore<ISA>::issue( Cycle cycle)
+{
+    uint32 issued = 0;
+    for ( size_t i = 0; i < rob.size() && issued < width; ++i)
+    {
+        auto& entry = rob[ i];
+        if ( entry.is_issued || !is_ready( entry))
+            continue;
+
+        if ( entry.instr.is_load() && is_blocked_by_stores( entry))
+            continue;
+
+        execute( &entry.instr, entry);
+        entry.is_issued = true;
+        --iq_occupancy;
+        ++issued;
+
+        auto latency = 1_Lt;
+        if ( entry.instr.is_load())
+        {
+            memory->load_store( &entry.instr);
+            latency = load_latency;
+        }
+
+        entry.result = entry.instr.get_writes_dst() ? entry.instr.get_bypassing_data() : entry.old_dst.value;
+        entry.complete_cycle = cycle + latency;
+        TRACE( sout) << "issue    cycle " << std::dec << cycle << ": " << entry.instr << std::endl;
+
+        if ( entry.instr.is_jump() && entry.instr.is_misprediction())
+        {
+            /* predictor is repaired immediately */
+            wp_bp_update->write( entry.instr.get_bp_resolution(), cycle);
+            entry.is_bp_updated = true;
+            flush_younger( entry, cycle);
+            TRACE( sout) << "misprediction, flush" << std::endl;
+            return;
+        }
+    }
+}
+
+template <typename ISA>
+void OOOCore<ISA>::clock( Cycle cycle)
+{
+    rp_writeback_bypass->ignore( cycle);
+
+    dispatch( cycle);
+    retire( cycle);
+    wake_up( cycle);
+    issue( cycle);
+}
+
+
+#include <mips/mips.h>
+
+template class OOOCore<MIPS>;
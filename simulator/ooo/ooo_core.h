@@ -0,0 +1,129 @@
+/**
+ * ooo_core.h - out-of-order execution core
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef OOO_CORE_H
+#define OOO_CORE_H
+
+#include <infra/ports/ports.h>
+#include <infra/ports/stall_latch.h>
+#include <core/perf_instr.h>
+#include <func_sim/rf/rf.h>
+
+#include <array>
+#include <deque>
+#include <optional>
+#include <vector>
+
+/*
+ * Backend of out-of-order pipeline, it replaces decode, execute and memory stages.
+ *
+ * Instructions are renamed and dispatched to the reorder buffer in program order.
+ * Registers are renamed to reorder buffer entries of their youngest producers,
+ * so the entries play a role of physical registers. Instructions wait in the
+ * unified issue queue until their sources are woken up by completed producers,
+ * the oldest ready ones are selected for execution.
+ *
+ * Loads and stores occupy the load/store queue. A load is issued only after
+ * addresses of all older stores are known, and it waits for retirement of the older
+ * stores to the same bytes. Stores write memory on retirement.
+ *
+ * Mispredicted jumps flush the younger instructions when they are executed.
+ * Instructions are retired in order through the writeback stage.
+ */
+template <typename ISA>
+class OOOCore : public Log
+{
+    using FuncInstr = typename ISA::FuncInstr;
+    using Instr = PerfInstr<FuncInstr>;
+    using Memory = typename ISA::Memory;
+    using Register = typename ISA::Register;
+    using RegDstUInt = typename ISA::RegDstUInt;
+
+    public:
+        struct Statistics
+        {
+            uint64 mispredictions = 0;
+            uint64 rob_full = 0; // cycles when dispatch waits for a reorder buffer entry
+            uint64 iq_full = 0;  // ... for an issue queue entry
+            uint64 lsq_full = 0; // ... for a load/store queue entry
+        };
+
+        OOOCore( bool log, uint32 width);
+        void clock( Cycle cycle);
+        void set_RF( RF<ISA>* value) { rf = value; }
+        void set_memory( Memory* value) { memory = value; }
+
+        const Statistics& get_statistics() const { return statistics; }
+
+    private:
+        // source value or the reorder buffer entry which produces it
+        struct Operand
+        {
+            std::optional<uint64> producer = std::nullopt;
+            bool is_bypassed = false; // value is taken from the producer, not from RF
+            RegDstUInt value = 0;
+        };
+
+        struct Entry
+        {
+            Entry( const Instr& instr, uint64 id) : instr( instr), id( id) { }
+
+            Instr instr;
+            const uint64 id; // sequence number in program order
+            std::array<Operand, 2> sources = {};
+            Operand old_dst = {}; // value kept by conditional moves which do not write
+            RegDstUInt result = 0;
+            Cycle complete_cycle = 0_Cl;
+            bool is_issued = false;
+            bool is_completed = false;
+            bool is_bp_updated = false;
+        };
+
+        const uint32 width;
+        const uint32 rob_size;
+        const uint32 iq_size;
+        const uint32 lsq_size;
+        const Latency load_latency;
+
+        RF<ISA>* rf = nullptr;
+        Memory* memory = nullptr;
+
+        std::deque<Entry> rob = {};
+        uint64 next_id = 0;
+        uint32 iq_occupancy = 0;
+        uint32 lsq_occupancy = 0;
+
+        // youngest in-flight producer of each architectural register
+        std::array<std::optional<uint64>, Register::MAX_REG> rename_table = {};
+
+        // fetched instructions, the ones which are not dispatched because of full queues are kept there
+        StallLatch<Instr> input;
+        bool is_flushed = false;
+
+        Statistics statistics = {};
+
+        std::unique_ptr<WritePort<Addr>> wp_flush_target = nullptr;
+        std::unique_ptr<WritePort<BPResolution>> wp_bp_update = nullptr;
+        std::unique_ptr<WritePort<Instr>> wp_writeback = nullptr;
+        std::unique_ptr<ReadPort<RegDstUInt>> rp_writeback_bypass = nullptr;
+
+        const Entry& get_entry( uint64 id) const { return rob[ id - rob.front().id]; }
+
+        Operand rename_register( Register num) const;
+        void rename_dst( Register num, std::optional<uint64> producer);
+        void rebuild_rename_table();
+
+        void dispatch( Cycle cycle);
+        void retire( Cycle cycle);
+        void wake_up( Cycle cycle);
+        void issue( Cycle cycle);
+
+        bool is_ready( const Entry& entry) const;
+        bool is_blocked_by_stores( const Entry& load) const;
+        static void execute( Instr* instr, const Entry& entry);
+        void flush_younger( const Entry& jump, Cycle cycle);
+};
+
+#endif // OOO_CORE_H
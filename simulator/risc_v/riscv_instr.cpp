@@ -0,0 +1,408 @@
+/* riscv_instr.cpp - instruction parser for risc_v
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "riscv_instr.h"
+
+static constexpr const uint32 MASK_U = 0x7f;
+static constexpr const uint32 MASK_I = 0x707f;
+static constexpr const uint32 MASK_R = 0xfe00707f;
+static constexpr const uint32 MASK_SHIFT = 0xfc00707f; // shift amount has 6 bits in RV64I
+
+template <typename T>
+const typename RISCVInstr<T>::ISAEntry* RISCVInstr<T>::find_entry( uint32 bytes)
+{
+    static const std::array<ISAEntry, 63> table =
+    {{
+        // name      match       mask        format     operation    op id     memsize xlen
+        { "lui",     0x00000037, MASK_U,     Format::U, OUT_ARITHM, OP_LUI,    0, 32},
+        { "auipc",   0x00000017, MASK_U,     Format::U, OUT_ARITHM, OP_AUIPC,  0, 32},
+        { "jal",     0x0000006f, MASK_U,     Format::J, OUT_JUMP,   OP_JAL,    0, 32},
+        { "jalr",    0x00000067, MASK_I,     Format::I, OUT_JUMP,   OP_JALR,   0, 32},
+        { "beq",     0x00000063, MASK_I,     Format::B, OUT_BRANCH, OP_BEQ,    0, 32},
+        { "bne",     0x00001063, MASK_I,     Format::B, OUT_BRANCH, OP_BNE,    0, 32},
+        { "blt",     0x00004063, MASK_I,     Format::B, OUT_BRANCH, OP_BLT,    0, 32},
+        { "bge",     0x00005063, MASK_I,     Format::B, OUT_BRANCH, OP_BGE,    0, 32},
+        { "bltu",    0x00006063, MASK_I,     Format::B, OUT_BRANCH, OP_BLTU,   0, 32},
+        { "bgeu",    0x00007063, MASK_I,     Format::B, OUT_BRANCH, OP_BGEU,   0, 32},
+        { "lb",      0x00000003, MASK_I,     Format::I, OUT_LOAD,   OP_LOAD,   1, 32},
+        { "lh",      0x00001003, MASK_I,     Format::I, OUT_LOAD,   OP_LOAD,   2, 32},
+        { "lw",      0x00002003, MASK_I,     Format::I, OUT_LOAD,   OP_LOAD,   4, 32},
+        { "lbu",     0x00004003, MASK_I,     Format::I, OUT_LOADU,  OP_LOAD,   1, 32},
+        { "lhu",     0x00005003, MASK_I,     Format::I, OUT_LOADU,  OP_LOAD,   2, 32},
+        { "sb",      0x00000023, MASK_I,     Format::S, OUT_STORE,  OP_STORE,  1, 32},
+        { "sh",      0x00001023, MASK_I,     Format::S, OUT_STORE,  OP_STORE,  2, 32},
+        { "sw",      0x00002023, MASK_I,     Format::S, OUT_STORE,  OP_STORE,  4, 32},
+        { "addi",    0x00000013, MASK_I,     Format::I, OUT_ARITHM, OP_ADDI,   0, 32},
+        { "slti",    0x00002013, MASK_I,     Format::I, OUT_ARITHM, OP_SLTI,   0, 32},
+        { "sltiu",   0x00003013, MASK_I,     Format::I, OUT_ARITHM, OP_SLTIU,  0, 32},
+        { "xori",    0x00004013, MASK_I,     Format::I, OUT_ARITHM, OP_XORI,   0, 32},
+        { "ori",     0x00006013, MASK_I,     Format::I, OUT_ARITHM, OP_ORI,    0, 32},
+        { "andi",    0x00007013, MASK_I,     Format::I, OUT_ARITHM, OP_ANDI,   0, 32},
+        { "slli",    0x00001013, MASK_SHIFT, Format::I, OUT_ARITHM, OP_SLLI,   0, 32},
+        { "srli",    0x00005013, MASK_SHIFT, Format::I, OUT_ARITHM, OP_SRLI,   0, 32},
+        { "srai",    0x40005013, MASK_SHIFT, Format::I, OUT_ARITHM, OP_SRAI,   0, 32},
+        { "add",     0x00000033, MASK_R,     Format::R, OUT_ARITHM, OP_ADD,    0, 32},
+        { "sub",     0x40000033, MASK_R,     Format::R, OUT_ARITHM, OP_SUB,    0, 32},
+        { "sll",     0x00001033, MASK_R,     Format::R, OUT_ARITHM, OP_SLL,    0, 32},
+        { "slt",     0x00002033, MASK_R,     Format::R, OUT_ARITHM, OP_SLT,    0, 32},
+        { "sltu",    0x00003033, MASK_R,     Format::R, OUT_ARITHM, OP_SLTU,   0, 32},
+        { "xor",     0x00004033, MASK_R,     Format::R, OUT_ARITHM, OP_XOR,    0, 32},
+        { "srl",     0x00005033, MASK_R,     Format::R, OUT_ARITHM, OP_SRL,    0, 32},
+        { "sra",     0x40005033, MASK_R,     Format::R, OUT_ARITHM, OP_SRA,    0, 32},
+        { "or",      0x00006033, MASK_R,     Format::R, OUT_ARITHM, OP_OR,     0, 32},
+        { "and",     0x00007033, MASK_R,     Format::R, OUT_ARITHM, OP_AND,    0, 32},
+        { "fence",   0x0000000f, MASK_I,     Format::U, OUT_ARITHM, OP_FENCE,  0, 32},
+        // RV64I
+        { "lwu",     0x00006003, MASK_I,     Format::I, OUT_LOADU,  OP_LOAD,   4, 64},
+        { "ld",      0x00003003, MASK_I,     Format::I, OUT_LOAD,   OP_LOAD,   8, 64},
+        { "sd",      0x00003023, MASK_I,     Format::S, OUT_STORE,  OP_STORE,  8, 64},
+        { "addiw",   0x0000001b, MASK_I,     Format::I, OUT_ARITHM, OP_ADDIW,  0, 64},
+        { "slliw",   0x0000101b, MASK_R,     Format::I, OUT_ARITHM, OP_SLLIW,  0, 64},
+        { "srliw",   0x0000501b, MASK_R,     Format::I, OUT_ARITHM, OP_SRLIW,  0, 64},
+        { "sraiw",   0x4000501b, MASK_R,     Format::I, OUT_ARITHM, OP_SRAIW,  0, 64},
+        { "addw",    0x0000003b, MASK_R,     Format::R, OUT_ARITHM, OP_ADDW,   0, 64},
+        { "subw",    0x4000003b, MASK_R,     Format::R, OUT_ARITHM, OP_SUBW,   0, 64},
+        { "sllw",    0x0000103b, MASK_R,     Format::R, OUT_ARITHM, OP_SLLW,   0, 64},
+        { "srlw",    0x0000503b, MASK_R,     Format::R, OUT_ARITHM, OP_SRLW,   0, 64},
+        { "sraw",    0x4000503b, MASK_R,     Format::R, OUT_ARITHM, OP_SRAW,   0, 64},
+        // RV32M
+        { "mul",     0x02000033, MASK_R,     Format::R, OUT_ARITHM, OP_MUL,    0, 32},
+        { "mulh",    0x02001033, MASK_R,     Format::R, OUT_ARITHM, OP_MULH,   0, 32},
+        { "mulhsu",  0x02002033, MASK_R,     Format::R, OUT_ARITHM, OP_MULHSU, 0, 32},
+        { "mulhu",   0x02003033, MASK_R,     Format::R, OUT_ARITHM, OP_MULHU,  0, 32},
+        { "div",     0x02004033, MASK_R,     Format::R, OUT_ARITHM, OP_DIV,    0, 32},
+        { "divu",    0x02005033, MASK_R,     Format::R, OUT_ARITHM, OP_DIVU,   0, 32},
+        { "rem",     0x02006033, MASK_R,     Format::R, OUT_ARITHM, OP_REM,    0, 32},
+        { "remu",    0x02007033, MASK_R,     Format::R, OUT_ARITHM, OP_REMU,   0, 32},
+        // RV64M
+        { "mulw",    0x0200003b, MASK_R,     Format::R, OUT_ARITHM, OP_MULW,   0, 64},
+        { "divw",    0x0200403b, MASK_R,     Format::R, OUT_ARITHM, OP_DIVW,   0, 64},
+        { "divuw",   0x0200503b, MASK_R,     Format::R, OUT_ARITHM, OP_DIVUW,  0, 64},
+        { "remw",    0x0200603b, MASK_R,     Format::R, OUT_ARITHM, OP_REMW,   0, 64},
+        { "remuw",   0x0200703b, MASK_R,     Format::R, OUT_ARITHM, OP_REMUW,  0, 64},
+    }};
+
+    for ( const auto& entry : table)
+        if ( ( bytes & entry.mask) == entry.match && bitwidth<T> >= entry.xlen)
+            return &entry;
+
+    return nullptr;
+}
+
+template <typename T>
+RISCVInstr<T>::RISCVInstr( uint32 bytes, Addr PC) : instr( bytes), PC( PC), new_PC( PC + 4)
+{
+    const auto* entry = find_entry( bytes);
+
+    /* shift amount of RV32I has 5 bits */
+    const bool is_wide_shift = bitwidth<T> == 32 && ( bytes & 0x02000000) != 0;
+    if ( entry != nullptr && !( is_wide_shift && entry->op_id >= OP_SLLI && entry->op_id <= OP_SRAI))
+        init( *entry);
+}
+
+template <typename T>
+int32 RISCVInstr<T>::decode_immediate() const
+{
+    const auto word = static_cast<int32>( instr);
+    switch ( format)
+    {
+        case Format::I: return word >> 20;
+        case Format::S: return ( ( word >> 20) & ~0x1f) | ( ( word >> 7) & 0x1f);
+        case Format::B: return ( ( word >> 19) & ~0xfff)    // imm[12]
+                             | ( static_cast<int32>( instr << 4) & 0x800) // imm[11]
+                             | ( ( word >> 20) & 0x7e0)     // imm[10:5]
+                             | ( ( word >> 7) & 0x1e);      // imm[4:1]
+        case Format::U: return word & ~0xfff;
+        case Format::J: return ( ( word >> 11) & ~0xfffff)  // imm[20]
+                             | ( word & 0xff000)            // imm[19:12]
+                             | ( ( word >> 9) & 0x800)      // imm[11]
+                             | ( ( word >> 20) & 0x7fe);    // imm[10:1]
+        default: return 0;
+    }
+}
+
+template <typename T>
+void RISCVInstr<T>::init( const ISAEntry& entry)
+{
+    format    = entry.format;
+    operation = entry.operation;
+    op_id     = entry.op_id;
+    mem_size  = entry.mem_size;
+    v_imm     = decode_immediate();
+
+    const auto rd  = RISCVRegister( static_cast<uint8>( ( instr >> 7) & 0x1f));
+    const auto rs1 = RISCVRegister( static_cast<uint8>( ( instr >> 15) & 0x1f));
+    const auto rs2 = RISCVRegister( static_cast<uint8>( ( instr >> 20) & 0x1f));
+
+    switch ( format)
+    {
+        case Format::R:
+            src1 = rs1;
+            src2 = rs2;
+            dst  = rd;
+            break;
+        case Format::I:
+            src1 = rs1;
+            dst  = rd;
+            break;
+        case Format::S:
+        case Format::B:
+            src1 = rs1;
+            src2 = rs2;
+            break;
+        case Format::U:
+        case Format::J:
+            dst = op_id == OP_FENCE ? RISCVRegister::zero : rd;
+            break;
+        default:
+            assert( false);
+    }
+
+    writes_dst = !dst.is_zero();
+}
+
+template <typename T>
+typename RISCVInstr<T>::RegisterUInt RISCVInstr<T>::multiply_high_unsigned( RegisterUInt lhs, RegisterUInt rhs)
+{
+    /* schoolbook multiplication of halves, so no wider type is needed */
+    constexpr auto half = bitwidth<T> / 2;
+    const auto mask = bitmask<RegisterUInt>( half);
+
+    const RegisterUInt low = ( lhs & mask) * ( rhs & mask);
+    const RegisterUInt cross1 = ( lhs >> half) * ( rhs & mask);
+    const RegisterUInt cross2 = ( lhs & mask) * ( rhs >> half);
+    const RegisterUInt high = ( lhs >> half) * ( rhs >> half);
+
+    const RegisterUInt middle = ( low >> half) + ( cross1 & mask) + ( cross2 & mask);
+    return high + ( cross1 >> half) + ( cross2 >> half) + ( middle >> half);
+}
+
+template <typename T>
+template <typename U, typename S>
+U RISCVInstr<T>::divide( U lhs, U rhs, bool is_signed)
+{
+    /* division by zero and overflow do not trap in RISC-V */
+    if ( rhs == 0)
+        return ~U{ 0};
+
+    if ( !is_signed)
+        return lhs / rhs;
+
+    const auto min = U{ 1} << ( bitwidth<U> - 1);
+    if ( lhs == min && rhs == ~U{ 0})
+        return lhs;
+
+    return static_cast<U>( static_cast<S>( lhs) / static_cast<S>( rhs));
+}
+
+template <typename T>
+template <typename U, typename S>
+U RISCVInstr<T>::remainder( U lhs, U rhs, bool is_signed)
+{
+    if ( rhs == 0)
+        return lhs;
+
+    if ( !is_signed)
+        return lhs % rhs;
+
+    const auto min = U{ 1} << ( bitwidth<U> - 1);
+    if ( lhs == min && rhs == ~U{ 0})
+        return 0;
+
+    return static_cast<U>( static_cast<S>( lhs) % static_cast<S>( rhs));
+}
+
+template <typename T>
+void RISCVInstr<T>::execute_unknown()
+{
+    std::cerr << "ERROR.Incorrect instruction: " << *this << std::endl;
+    exit( EXIT_FAILURE);
+}
+
+template <typename T>
+void RISCVInstr<T>::execute()
+{
+    const auto imm = extend_immediate();
+    const auto word1 = static_cast<uint32>( v_src1);
+    const auto word2 = static_cast<uint32>( v_src2);
+
+    switch ( op_id)
+    {
+        case OP_UNKNOWN: execute_unknown(); break;
+        case OP_LUI:   v_dst = imm; break;
+        case OP_AUIPC: v_dst = static_cast<RegisterUInt>( PC) + imm; break;
+        case OP_JAL:   v_dst = new_PC; execute_jump( PC + static_cast<Addr>( v_imm)); break;
+        case OP_JALR:  v_dst = new_PC; execute_jump( static_cast<Addr>( v_src1 + imm) & ~Addr{ 1}); break;
+        case OP_BEQ:   execute_branch( v_src1 == v_src2); break;
+        case OP_BNE:   execute_branch( v_src1 != v_src2); break;
+        case OP_BLT:   execute_branch( sign_value( v_src1) <  sign_value( v_src2)); break;
+        case OP_BGE:   execute_branch( sign_value( v_src1) >= sign_value( v_src2)); break;
+        case OP_BLTU:  execute_branch( v_src1 <  v_src2); break;
+        case OP_BGEU:  execute_branch( v_src1 >= v_src2); break;
+        case OP_LOAD:
+        case OP_STORE: mem_addr = static_cast<Addr>( v_src1 + imm); break;
+        case OP_ADDI:  v_dst = v_src1 + imm; break;
+        case OP_SLTI:  v_dst = sign_value( v_src1) < sign_value( imm) ? 1 : 0; break;
+        case OP_SLTIU: v_dst = v_src1 < imm ? 1 : 0; break;
+        case OP_XORI:  v_dst = v_src1 ^ imm; break;
+        case OP_ORI:   v_dst = v_src1 | imm; break;
+        case OP_ANDI:  v_dst = v_src1 & imm; break;
+        case OP_SLLI:  v_dst = v_src1 << get_shamt( imm); break;
+        case OP_SRLI:  v_dst = v_src1 >> get_shamt( imm); break;
+        case OP_SRAI:  v_dst = static_cast<RegisterUInt>( sign_value( v_src1) >> get_shamt( imm)); break;
+        case OP_ADD:   v_dst = v_src1 + v_src2; break;
+        case OP_SUB:   v_dst = v_src1 - v_src2; break;
+        case OP_SLL:   v_dst = v_src1 << get_shamt( v_src2); break;
+        case OP_SLT:   v_dst = sign_value( v_src1) < sign_value( v_src2) ? 1 : 0; break;
+        case OP_SLTU:  v_dst = v_src1 < v_src2 ? 1 : 0; break;
+        case OP_XOR:   v_dst = v_src1 ^ v_src2; break;
+        case OP_SRL:   v_dst = v_src1 >> get_shamt( v_src2); break;
+        case OP_SRA:   v_dst = static_cast<RegisterUInt>( sign_value( v_src1) >> get_shamt( v_src2)); break;
+        case OP_OR:    v_dst = v_src1 | v_src2; break;
+        case OP_AND:   v_dst = v_src1 & v_src2; break;
+        case OP_FENCE: break;
+        case OP_ADDIW: v_dst = extend_word( word1 + static_cast<uint32>( v_imm)); break;
+        case OP_SLLIW: v_dst = extend_word( word1 << ( v_imm & 0x1f)); break;
+        case OP_SRLIW: v_dst = extend_word( word1 >> ( v_imm & 0x1f)); break;
+        case OP_SRAIW: v_dst = extend_word( static_cast<uint32>( static_cast<int32>( word1) >> ( v_imm & 0x1f))); break;
+        case OP_ADDW:  v_dst = extend_word( word1 + word2); break;
+        case OP_SUBW:  v_dst = extend_word( word1 - word2); break;
+        case OP_SLLW:  v_dst = extend_word( word1 << ( word2 & 0x1f)); break;
+        case OP_SRLW:  v_dst = extend_word( word1 >> ( word2 & 0x1f)); break;
+        case OP_SRAW:  v_dst = extend_word( static_cast<uint32>( static_cast<int32>( word1) >> ( word2 & 0x1f))); break;
+        case OP_MUL:   v_dst = v_src1 * v_src2; break;
+        case OP_MULHU: v_dst = multiply_high_unsigned( v_src1, v_src2); break;
+        case OP_MULH:
+            /* signed product is corrected by the operands with the sign bits set */
+            v_dst = multiply_high_unsigned( v_src1, v_src2)
+                  - ( sign_value( v_src1) < 0 ? v_src2 : 0)
+                  - ( sign_value( v_src2) < 0 ? v_src1 : 0);
+            break;
+        case OP_MULHSU:
+            v_dst = multiply_high_unsigned( v_src1, v_src2) - ( sign_value( v_src1) < 0 ? v_src2 : 0);
+            break;
+        case OP_DIV:   v_dst = divide<RegisterUInt, RegisterSInt>( v_src1, v_src2, true); break;
+        case OP_DIVU:  v_dst = divide<RegisterUInt, RegisterSInt>( v_src1, v_src2, false); break;
+        case OP_REM:   v_dst = remainder<RegisterUInt, RegisterSInt>( v_src1, v_src2, true); break;
+        case OP_REMU:  v_dst = remainder<RegisterUInt, RegisterSInt>( v_src1, v_src2, false); break;
+        case OP_MULW:  v_dst = extend_word( word1 * word2); break;
+        case OP_DIVW:  v_dst = extend_word( divide<uint32, int32>( word1, word2, true)); break;
+        case OP_DIVUW: v_dst = extend_word( divide<uint32, int32>( word1, word2, false)); break;
+        case OP_REMW:  v_dst = extend_word( remainder<uint32, int32>( word1, word2, true)); break;
+        case OP_REMUW: v_dst = extend_word( remainder<uint32, int32>( word1, word2, false)); break;
+        default: assert( false);
+    }
+    complete = true;
+}
+
+template <typename T>
+void RISCVInstr<T>::set_v_dst( const T& value)
+{
+    assert( is_load());
+
+    if ( operation == OUT_LOAD && mem_size < sizeof( RegisterUInt))
+    {
+        /* the loaded value is sign-extended from its top bit */
+        const auto shift = bitwidth<T> - 8 * mem_size;
+        v_dst = static_cast<RegisterUInt>( sign_value( value << shift) >> shift);
+    }
+    else
+    {
+        v_dst = value;
+    }
+
+    loaded = true;
+}
+
+// values are printed in hexadecimal by 64-bit halves
+template <typename T>
+static void dump_value( std::ostream& out, T value)
+{
+    if constexpr ( bitwidth<T> > bitwidth<uint64>)
+        if ( static_cast<uint64>( value >> bitwidth<uint64>) != 0)
+            out << static_cast<uint64>( value >> bitwidth<uint64>) << std::setw( 16) << std::setfill( '0');
+
+    out << static_cast<uint64>( value);
+}
+
+template <typename T>
+void RISCVInstr<T>::dump_results( std::ostream& out) const
+{
+    if ( writes_dst && ( loaded || ( complete && !is_load())))
+    {
+        out << "\t [ " << dst << " = 0x" << std::hex;
+        dump_value( out, v_dst);
+        out << " ]";
+    }
+}
+
+template <typename T>
+void RISCVInstr<T>::dump( std::ostream& out) const
+{
+    // output formatting is restored, so rendering does not depend on stream state
+    const auto flags = out.flags( std::ios_base::dec);
+    const auto fill = out.fill( ' ');
+
+    if ( PC != 0)
+        out << std::hex << "0x" << PC << ": ";
+
+    if ( operation == OUT_UNKNOWN)
+    {
+        out << std::hex << std::setfill( '0') << "0x" << std::setw( 8) << instr << '\t' << "Unknown";
+        out.flags( flags);
+        out.fill( fill);
+        return;
+    }
+
+    out << find_entry( instr)->name << std::dec;
+    switch ( format)
+    {
+        case Format::R:
+            out << ' ' << dst << ", " << src1 << ", " << src2;
+            break;
+        case Format::I:
+            if ( is_load() || op_id == OP_JALR)
+                out << ' ' << dst << ", " << v_imm << "(" << src1 << ")";
+            else
+                out << ' ' << dst << ", " << src1 << ", " << ( op_id >= OP_SLLI && op_id <= OP_SRAI ? static_cast<int32>( get_shamt( extend_immediate())) : v_imm);
+            break;
+        case Format::S:
+            out << ' ' << src2 << ", " << v_imm << "(" << src1 << ")";
+            break;
+        case Format::B:
+            out << ' ' << src1 << ", " << src2 << ", " << v_imm;
+            break;
+        case Format::U:
+            if ( op_id != OP_FENCE)
+                out << ' ' << dst << ", 0x" << std::hex << ( static_cast<uint32>( v_imm) >> 12);
+            break;
+        case Format::J:
+            out << ' ' << dst << ", " << v_imm;
+            break;
+        default:
+            assert( false);
+    }
+
+    dump_results( out);
+
+    out.flags( flags);
+    out.fill( fill);
+}
+
+template <typename T>
+std::string RISCVInstr<T>::Dump() const
+{
+    std::ostringstream oss;
+    dump( oss);
+    return oss.str();
+}
+
+
+template class RISCVInstr<uint32>;
+template class RISCVInstr<uint64>;
+template class RISCVInstr<uint128>;
@@ -9,81 +9,182 @@
 // Generic C++
 #include <cassert>
 #include <array>
-#include <unordered_map>
+#include <ostream>
+#include <string>
+#include <string_view>
 
 // MIPT-MIPS modules
 #include <infra/types.h>
 #include <infra/macro.h>
-#include <infra/string/cow_string.h>
+#include <infra/wide_types.h>
 
 #include "riscv_register/riscv_register.h"
-#include "risc_v.h"
 
+/*
+ * RV32I and RV64I base integer instruction sets with M extension.
+ * Instructions with 32-bit operands of RV64I are decoded only if registers are wider.
+ */
 template <typename T>
 class RISCVInstr
 {
     using RegisterUInt = T;
+    using RegisterSInt = sign_t<T>;
     private:
+        enum OperationType : uint8
+        {
+            OUT_UNKNOWN,
+            OUT_ARITHM,
+            OUT_BRANCH,
+            OUT_JUMP,
+            OUT_LOAD,
+            OUT_LOADU,
+            OUT_STORE
+        } operation = OUT_UNKNOWN;
+
+        // layouts of operands in the instruction word
+        enum class Format : uint8
+        {
+            R, I, S, B, U, J
+        };
+
+        enum OpId : uint8
+        {
+            OP_UNKNOWN,
+            OP_LUI, OP_AUIPC, OP_JAL, OP_JALR,
+            OP_BEQ, OP_BNE, OP_BLT, OP_BGE, OP_BLTU, OP_BGEU,
+            OP_LOAD, OP_STORE,
+            OP_ADDI, OP_SLTI, OP_SLTIU, OP_XORI, OP_ORI, OP_ANDI, OP_SLLI, OP_SRLI, OP_SRAI,
+            OP_ADD, OP_SUB, OP_SLL, OP_SLT, OP_SLTU, OP_XOR, OP_SRL, OP_SRA, OP_OR, OP_AND,
+            OP_FENCE,
+            OP_ADDIW, OP_SLLIW, OP_SRLIW, OP_SRAIW,
+            OP_ADDW, OP_SUBW, OP_SLLW, OP_SRLW, OP_SRAW,
+            OP_MUL, OP_MULH, OP_MULHSU, OP_MULHU, OP_DIV, OP_DIVU, OP_REM, OP_REMU,
+            OP_MULW, OP_DIVW, OP_DIVUW, OP_REMW, OP_REMUW
+        } op_id = OP_UNKNOWN;
+
+        struct ISAEntry
+        {
+            std::string_view name;
+            uint32 match;
+            uint32 mask;
+            Format format;
+            OperationType operation;
+            OpId op_id;
+            uint8 mem_size;
+            uint8 xlen; // minimal width of registers
+        };
+
+        // returns nullptr if the instruction is not supported
+        static const ISAEntry* find_entry( uint32 bytes);
+
+        // Fields are ordered to avoid padding: instructions are copied
+        // through all ports of performance simulator, so size matters.
+        // Mnemonic is not kept, it is found by instruction word on dump.
+        Format format = Format::U;
+        uint8 mem_size = 0;
         uint32 instr = NO_VAL32;
 
         RISCVRegister src1 = RISCVRegister::zero;
         RISCVRegister src2 = RISCVRegister::zero;
         RISCVRegister dst = RISCVRegister::zero;
-        
+
+        bool complete = false;
+        bool loaded = false; // load result is received
+        bool writes_dst = false;
+        bool _is_jump_taken = false;
+
+        int32 v_imm = 0;
+        Addr PC = NO_VAL32;
+        Addr new_PC = NO_VAL32;
+        Addr mem_addr = NO_VAL32;
+
         RegisterUInt v_src1 = NO_VAL32;
         RegisterUInt v_src2 = NO_VAL32;
         RegisterUInt v_dst = NO_VAL32;
 
-        Addr mem_addr = NO_VAL32;
-        uint32 mem_size = NO_VAL32;
+        void init( const ISAEntry& entry);
+        int32 decode_immediate() const;
+        void dump_results( std::ostream& out) const;
 
-        Addr PC = NO_VAL32;
-        Addr new_PC = NO_VAL32;
+        auto sign_value( RegisterUInt value) const { return static_cast<RegisterSInt>( value); }
+        auto extend_immediate() const { return static_cast<RegisterUInt>( static_cast<RegisterSInt>( v_imm)); }
+        auto get_shamt( RegisterUInt value) const { return static_cast<uint32>( value & ( bitwidth<T> - 1)); }
+
+        // results of operations on 32-bit words are sign-extended to register width
+        static auto extend_word( uint32 value) { return static_cast<RegisterUInt>( static_cast<RegisterSInt>( static_cast<int32>( value))); }
 
-#if 0
-        std::string disasm = {};
-#else
-        CowString disasm = {};
-#endif
+        static RegisterUInt multiply_high_unsigned( RegisterUInt lhs, RegisterUInt rhs);
+
+        template <typename U, typename S>
+        static U divide( U lhs, U rhs, bool is_signed);
+
+        template <typename U, typename S>
+        static U remainder( U lhs, U rhs, bool is_signed);
+
+        void execute_jump( Addr target)
+        {
+            _is_jump_taken = true;
+            new_PC = target;
+        }
+
+        void execute_branch( bool is_taken)
+        {
+            _is_jump_taken = is_taken;
+            if ( is_taken)
+                new_PC = PC + static_cast<Addr>( v_imm);
+        }
+
+        void execute_unknown();
 
     public:
         RISCVInstr() = delete;
 
         explicit
-        RISCVInstr( uint32 bytes, Addr PC = 0) : instr( bytes), PC( PC), 
-                                                 new_PC( PC + 4)
-                                                 {};
-        
+        RISCVInstr( uint32 bytes, Addr PC = 0);
+
         bool is_same( const RISCVInstr& rhs) const {
             return PC == rhs.PC && instr == rhs.instr;
         }
 
-        const std::string_view Dump() const { return static_cast<std::string_view>(disasm); }
-        
+        void dump( std::ostream& out) const;
+        std::string Dump() const;
+
         RISCVRegister get_src_num( uint8 index) const { return ( index == 0) ? src1 : src2; }
         RISCVRegister get_dst_num()  const { return dst; }
 
         /* Checks if instruction can change PC in unusual way. */
-        constexpr bool is_jump() const { return false; }
-        
-        constexpr bool is_jump_taken() const { return false; }
-
-        constexpr bool is_load()  const { return false; }
-        
-        constexpr bool is_store() const { return false; }
-        
-        constexpr bool is_nop() const { return false; }
-        
-        constexpr bool is_halt() const { return false; }
+        bool is_jump() const { return operation == OUT_JUMP || operation == OUT_BRANCH; }
+
+        bool is_jump_taken() const { return _is_jump_taken; }
+
+        /* Kinds of jumps for target prediction, link registers are ra and t0 */
+        bool is_call() const { return operation == OUT_JUMP && ( dst.to_size_t() == 1 || dst.to_size_t() == 5); }
+
+        bool is_indirect_jump() const { return op_id == OP_JALR; }
+
+        bool is_return() const { return op_id == OP_JALR && dst.is_zero() && src1 == RISCVRegister::return_address; }
+
+        bool is_load()  const { return operation == OUT_LOAD || operation == OUT_LOADU; }
+
+        bool is_store() const { return operation == OUT_STORE; }
+
+        bool is_nop() const { return instr == 0x13u; } // addi zero, zero, 0
+
+        bool is_halt() const { return is_jump() && new_PC == 0; }
 
         constexpr bool is_conditional_move() const { return false; }
 
+        /* Kinds of arithmetic executed by dedicated functional units */
+        bool is_multiplication() const { return ( op_id >= OP_MUL && op_id <= OP_MULHU) || op_id == OP_MULW; }
+
+        bool is_division() const { return ( op_id >= OP_DIV && op_id <= OP_REMU) || op_id >= OP_DIVW; }
+
         constexpr bool has_trap() const { return false; }
 
-        constexpr bool get_writes_dst() const { return false; }
+        bool get_writes_dst() const { return writes_dst; }
+
+        bool is_bubble() const { return is_nop() && PC == 0; }
 
-        constexpr bool is_bubble() const { return false; }
-        
         void set_v_src( const T& value, uint8 index)
         {
             if ( index == 0)
@@ -98,23 +199,34 @@ class RISCVInstr
         uint32 get_mem_size() const { return mem_size; }
         Addr get_new_PC() const { return new_PC; }
         Addr get_PC() const { return PC; }
+        uint32 get_bytes() const { return instr; }
+
+        // results recorded in instruction trace are used instead of execution
+        void set_recorded_result( bool is_taken, Addr target, Addr addr)
+        {
+            _is_jump_taken = is_taken;
+            new_PC = target;
+            mem_addr = addr;
+        }
 
-        void set_v_dst( const T& value) { v_dst = value; } // for loads
+        void set_v_dst( const T& value); // for loads
         auto get_v_src2() const { return v_src2; } // for stores
 
         RegisterUInt get_bypassing_data() const
         {
-            return v_dst; 
+            return v_dst;
         }
 
-        void execute() {};
+        void execute();
+        void execute_dispatched() { execute(); }
         void check_trap() {};
 };
 
 template <typename T>
 static inline std::ostream& operator<<( std::ostream& out, const RISCVInstr<T>& instr)
 {
-        return out << instr.Dump();
+        instr.dump( out);
+        return out;
 }
 
 #endif //RISCV_INSTR_H
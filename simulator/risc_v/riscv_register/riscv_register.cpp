@@ -6,7 +6,8 @@
 #include "riscv_register.h"
 
 const RISCVRegister RISCVRegister::zero = RISCVRegister( RISCV_REG_zero);
-const RISCVRegister RISCVRegister::return_address = RISCVRegister( RISCV_REG_rs);
+const RISCVRegister RISCVRegister::return_address = RISCVRegister( RISCV_REG_ra);
+const RISCVRegister RISCVRegister::first_argument = RISCVRegister( RISCV_REG_a0);
 const RISCVRegister RISCVRegister::mips_hi = RISCVRegister( MAX_VAL_RegNum);
 const RISCVRegister RISCVRegister::mips_lo = RISCVRegister( MAX_VAL_RegNum);
 const RISCVRegister RISCVRegister::mips_hi_lo = RISCVRegister( MAX_VAL_RegNum);
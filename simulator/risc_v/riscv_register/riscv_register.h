@@ -33,7 +33,7 @@ public:
     explicit RISCVRegister( uint8 id) : RISCVRegister( static_cast<RegNum>( id))
     {
         if ( id >= 32u) {
-            std::cerr << "ERROR: Invalid RISCV register id = " << id;
+            std::cerr << "ERROR: Invalid RISCV register id = " << static_cast<uint32>( id) << std::endl;
             exit( EXIT_FAILURE);
         }
     }
@@ -51,6 +51,7 @@ public:
 
     static const RISCVRegister zero;
     static const RISCVRegister return_address;
+    static const RISCVRegister first_argument;
     static const RISCVRegister mips_hi;
     static const RISCVRegister mips_lo;
     static const RISCVRegister mips_hi_lo;
@@ -0,0 +1,162 @@
+// generic C
+#include <cassert>
+#include <cstdlib>
+
+// Google Test library
+#include <gtest/gtest.h>
+
+// uArchSim modules
+#include "../riscv_instr.h"
+
+TEST( RISCV_instr_init, Process_Wrong_Args_Of_Constr)
+{
+    ASSERT_EQ( RISCVInstr<uint32>( 0x0).Dump(), "0x00000000\tUnknown");
+
+    // must exit and return EXIT_FAILURE
+    ASSERT_EXIT( RISCVInstr<uint32>( 0xFFFFFFFF).execute(),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+TEST( RISCV_instr_disasm, Process_Disasm)
+{
+    ASSERT_EQ( RISCVInstr<uint32>( 0x00c58533).Dump(), "add a0, a1, a2");
+    ASSERT_EQ( RISCVInstr<uint32>( 0x40c58533).Dump(), "sub a0, a1, a2");
+    ASSERT_EQ( RISCVInstr<uint32>( 0x02c5c533).Dump(), "div a0, a1, a2");
+    ASSERT_EQ( RISCVInstr<uint32>( 0xfff58513).Dump(), "addi a0, a1, -1");
+    ASSERT_EQ( RISCVInstr<uint32>( 0x4035d513).Dump(), "srai a0, a1, 3");
+    ASSERT_EQ( RISCVInstr<uint32>( 0x00020437).Dump(), "lui s0, 0x20");
+    ASSERT_EQ( RISCVInstr<uint32>( 0xffc42503).Dump(), "lw a0, -4(s0)");
+    ASSERT_EQ( RISCVInstr<uint32>( 0x00a42223).Dump(), "sw a0, 4(s0)");
+    ASSERT_EQ( RISCVInstr<uint32>( 0xfe5ff0ef).Dump(), "jal ra, -28");
+    ASSERT_EQ( RISCVInstr<uint32>( 0x00008067).Dump(), "jalr zero, 0(ra)");
+    ASSERT_EQ( RISCVInstr<uint32>( 0xfec5c0e3).Dump(), "blt a1, a2, -32");
+    ASSERT_EQ( RISCVInstr<uint32>( 0x00013537, 0x400).Dump(), "0x400: lui a0, 0x13");
+
+    // RV64I instructions
+    ASSERT_EQ( RISCVInstr<uint32>( 0x00c5853b).Dump(), "0x00c5853b\tUnknown");
+    ASSERT_EQ( RISCVInstr<uint64>( 0x00c5853b).Dump(), "addw a0, a1, a2");
+    ASSERT_EQ( RISCVInstr<uint64>( 0x00843503).Dump(), "ld a0, 8(s0)");
+}
+
+TEST( RISCV_instr_execute, Arithmetic)
+{
+    RISCVInstr<uint32> add( 0x00c58533);
+    add.set_v_src( 7, 0);
+    add.set_v_src( 0xfffffffe, 1);
+    add.execute();
+    ASSERT_EQ( add.get_v_dst(), 5u);
+    ASSERT_EQ( add.Dump(), "add a0, a1, a2\t [ a0 = 0x5 ]");
+
+    RISCVInstr<uint32> srai( 0x4035d513);
+    srai.set_v_src( 0x80000000, 0);
+    srai.execute();
+    ASSERT_EQ( srai.get_v_dst(), 0xf0000000u);
+
+    RISCVInstr<uint64> addw( 0x00c5853b);
+    addw.set_v_src( 0x7fffffff, 0);
+    addw.set_v_src( 1, 1);
+    addw.execute();
+    ASSERT_EQ( addw.get_v_dst(), 0xffffffff80000000ull);
+}
+
+TEST( RISCV_instr_execute, Multiplication_And_Division)
+{
+    RISCVInstr<uint32> mulh( 0x02c59533);
+    mulh.set_v_src( 0xffffffff, 0);
+    mulh.set_v_src( 30, 1);
+    mulh.execute();
+    ASSERT_TRUE( mulh.is_multiplication());
+    ASSERT_EQ( mulh.get_v_dst(), 0xffffffffu);
+
+    RISCVInstr<uint64> mulhu( 0x02c5b533);
+    mulhu.set_v_src( 0xffffffffffffffffull, 0);
+    mulhu.set_v_src( 0xffffffffffffffffull, 1);
+    mulhu.execute();
+    ASSERT_EQ( mulhu.get_v_dst(), 0xfffffffffffffffeull);
+
+    // division by zero and overflow do not trap
+    RISCVInstr<uint32> div( 0x02c5c533);
+    div.set_v_src( 5, 0);
+    div.set_v_src( 0, 1);
+    div.execute();
+    ASSERT_TRUE( div.is_division());
+    ASSERT_EQ( div.get_v_dst(), 0xffffffffu);
+
+    RISCVInstr<uint32> overflow( 0x02c5c533);
+    overflow.set_v_src( 0x80000000, 0);
+    overflow.set_v_src( 0xffffffff, 1);
+    overflow.execute();
+    ASSERT_EQ( overflow.get_v_dst(), 0x80000000u);
+
+    RISCVInstr<uint32> rem( 0x02c5e533);
+    rem.set_v_src( 7, 0);
+    rem.set_v_src( 0, 1);
+    rem.execute();
+    ASSERT_EQ( rem.get_v_dst(), 7u);
+}
+
+TEST( RISCV_instr_execute, Loads_And_Stores)
+{
+    RISCVInstr<uint32> lb( 0xffc40503);
+    lb.set_v_src( 0x1004, 0);
+    lb.execute();
+    ASSERT_TRUE( lb.is_load());
+    ASSERT_EQ( lb.get_mem_addr(), 0x1000u);
+    ASSERT_EQ( lb.get_mem_size(), 1u);
+    lb.set_v_dst( 0x80);
+    ASSERT_EQ( lb.get_v_dst(), 0xffffff80u);
+
+    RISCVInstr<uint32> lbu( 0xffc44503);
+    lbu.set_v_src( 0x1004, 0);
+    lbu.execute();
+    lbu.set_v_dst( 0x80);
+    ASSERT_EQ( lbu.get_v_dst(), 0x80u);
+
+    RISCVInstr<uint32> sw( 0x00a42223);
+    sw.set_v_src( 0x1000, 0);
+    sw.set_v_src( 42, 1);
+    sw.execute();
+    ASSERT_TRUE( sw.is_store());
+    ASSERT_FALSE( sw.get_writes_dst());
+    ASSERT_EQ( sw.get_mem_addr(), 0x1004u);
+    ASSERT_EQ( sw.get_v_src2(), 42u);
+}
+
+TEST( RISCV_instr_execute, Jumps)
+{
+    RISCVInstr<uint32> jal( 0xfe5ff0ef, 0x1000);
+    jal.execute();
+    ASSERT_TRUE( jal.is_jump());
+    ASSERT_TRUE( jal.is_call());
+    ASSERT_TRUE( jal.is_jump_taken());
+    ASSERT_EQ( jal.get_new_PC(), 0x1000u - 28);
+    ASSERT_EQ( jal.get_v_dst(), 0x1004u);
+
+    RISCVInstr<uint32> ret( 0x00008067, 0x2000);
+    ret.set_v_src( 0, 0);
+    ret.execute();
+    ASSERT_TRUE( ret.is_return());
+    ASSERT_TRUE( ret.is_indirect_jump());
+    ASSERT_TRUE( ret.is_halt());
+
+    RISCVInstr<uint32> blt( 0xfec5c0e3, 0x1000);
+    blt.set_v_src( 0xffffffff, 0);
+    blt.set_v_src( 1, 1);
+    blt.execute();
+    ASSERT_TRUE( blt.is_jump_taken());
+    ASSERT_EQ( blt.get_new_PC(), 0x1000u - 32);
+
+    RISCVInstr<uint32> bltu( 0xfec5e0e3, 0x1000);
+    bltu.set_v_src( 0xffffffff, 0);
+    bltu.set_v_src( 1, 1);
+    bltu.execute();
+    ASSERT_FALSE( bltu.is_jump_taken());
+    ASSERT_EQ( bltu.get_new_PC(), 0x1004u);
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
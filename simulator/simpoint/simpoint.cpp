@@ -0,0 +1,263 @@
+/*
+ * simpoint.cpp - sampled performance simulation of representative intervals
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+#include <core/perf_sim.h>
+#include <func_sim/func_sim.h>
+#include <infra/config/config.h>
+#include <mips/mips.h>
+
+#include "simpoint.h"
+
+SimPoint::SimPoint( std::string binary, uint64 interval_size)
+    : binary( std::move( binary)), interval_size( interval_size)
+{
+    if ( interval_size == 0)
+    {
+        std::cerr << "ERROR. Size of SimPoint interval must be positive" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+}
+
+void SimPoint::profile( uint64 instrs_to_run)
+{
+    FuncSim<MIPS> sim;
+    sim.init( binary);
+
+    intervals.clear();
+    Interval current;
+    uint64 instrs_in_block = 0;
+    for ( uint64 executed_instrs = 0; executed_instrs < instrs_to_run;)
+    {
+        const auto instr = sim.step();
+        ++executed_instrs;
+        ++instrs_in_block;
+        ++current.size;
+
+        const bool is_halt = instr.is_halt();
+        const bool is_interval_end = current.size == interval_size || is_halt || executed_instrs == instrs_to_run;
+
+        // the block cut by the end of interval is accounted by its last executed instruction
+        if ( instr.is_jump_taken() || is_interval_end)
+        {
+            current.bbv[ instr.get_PC()] += instrs_in_block;
+            instrs_in_block = 0;
+        }
+
+        if ( is_interval_end)
+        {
+            intervals.emplace_back( std::move( current));
+            current = Interval();
+            current.start = executed_instrs;
+        }
+
+        if ( is_halt)
+            break;
+    }
+}
+
+// Random projection reduces dimensions of basic block vectors,
+// coefficients are generated from PCs, so they are the same for all intervals
+SimPoint::Vector SimPoint::project( const Interval& interval) const
+{
+    Vector result( PROJECTION_DIMENSIONS, 0.0);
+    for ( const auto& [PC, instrs] : interval.bbv)
+    {
+        const double frequency = static_cast<double>( instrs) / static_cast<double>( interval.size);
+        for ( size_t i = 0; i < PROJECTION_DIMENSIONS; ++i)
+        {
+            // SplitMix64 finalizer
+            uint64 hash = ( static_cast<uint64>( PC) * PROJECTION_DIMENSIONS + i) + 0x9E3779B97F4A7C15ull;
+            hash = ( hash ^ ( hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+            hash = ( hash ^ ( hash >> 27)) * 0x94D049BB133111EBull;
+            hash = hash ^ ( hash >> 31);
+
+            const double coefficient = static_cast<double>( hash >> 11) / static_cast<double>( 1ull << 53) * 2.0 - 1.0;
+            result[ i] += frequency * coefficient;
+        }
+    }
+    return result;
+}
+
+static double get_distance( const std::vector<double>& lhs, const std::vector<double>& rhs)
+{
+    double result = 0;
+    for ( size_t i = 0; i < lhs.size(); ++i)
+        result += ( lhs[ i] - rhs[ i]) * ( lhs[ i] - rhs[ i]);
+    return result;
+}
+
+// k-means clustering, the initial centroids are the most distant vectors
+void SimPoint::choose( uint32 max_points)
+{
+    std::vector<Vector> vectors;
+    std::transform( intervals.begin(), intervals.end(), std::back_inserter( vectors),
+                    [this]( const Interval& interval) { return project( interval); });
+
+    const size_t clusters_num = std::min<size_t>( max_points, vectors.size());
+    if ( clusters_num == 0)
+    {
+        std::cerr << "ERROR. No intervals to choose SimPoints from" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    std::vector<Vector> centroids = { vectors.front()};
+    std::vector<double> distances( vectors.size(), std::numeric_limits<double>::max());
+    while ( centroids.size() < clusters_num)
+    {
+        for ( size_t i = 0; i < vectors.size(); ++i)
+            distances[ i] = std::min( distances[ i], get_distance( vectors[ i], centroids.back()));
+
+        const auto farthest = std::max_element( distances.begin(), distances.end()) - distances.begin();
+        centroids.push_back( vectors[ farthest]);
+    }
+
+    std::vector<size_t> clusters( vectors.size(), 0);
+    for ( uint32 iteration = 0; iteration < 100; ++iteration)
+    {
+        bool is_changed = false;
+        for ( size_t i = 0; i < vectors.size(); ++i)
+        {
+            size_t nearest = 0;
+            for ( size_t c = 1; c < centroids.size(); ++c)
+                if ( get_distance( vectors[ i], centroids[ c]) < get_distance( vectors[ i], centroids[ nearest]))
+                    nearest = c;
+
+            is_changed = is_changed || clusters[ i] != nearest || iteration == 0;
+            clusters[ i] = nearest;
+        }
+
+        if ( !is_changed)
+            break;
+
+        for ( size_t c = 0; c < centroids.size(); ++c)
+        {
+            Vector sum( PROJECTION_DIMENSIONS, 0.0);
+            size_t members = 0;
+            for ( size_t i = 0; i < vectors.size(); ++i)
+                if ( clusters[ i] == c)
+                {
+                    for ( size_t d = 0; d < PROJECTION_DIMENSIONS; ++d)
+                        sum[ d] += vectors[ i][ d];
+                    ++members;
+                }
+
+            // empty cluster keeps its centroid
+            if ( members > 0)
+                for ( size_t d = 0; d < PROJECTION_DIMENSIONS; ++d)
+                    centroids[ c][ d] = sum[ d] / static_cast<double>( members);
+        }
+    }
+
+    // the interval nearest to the centroid represents the cluster,
+    // which is weighted by number of instructions in it
+    const auto total_instrs = std::accumulate( intervals.begin(), intervals.end(), uint64{ 0},
+                                               []( uint64 sum, const Interval& interval) { return sum + interval.size; });
+    points.clear();
+    for ( size_t c = 0; c < centroids.size(); ++c)
+    {
+        Point point;
+        uint64 cluster_instrs = 0;
+        double min_distance = std::numeric_limits<double>::max();
+        for ( size_t i = 0; i < vectors.size(); ++i)
+            if ( clusters[ i] == c)
+            {
+                cluster_instrs += intervals[ i].size;
+                const double distance = get_distance( vectors[ i], centroids[ c]);
+                if ( distance < min_distance)
+                {
+                    min_distance = distance;
+                    point.interval = i;
+                }
+            }
+
+        if ( cluster_instrs == 0)
+            continue;
+
+        point.weight = static_cast<double>( cluster_instrs) / static_cast<double>( total_instrs);
+        points.push_back( point);
+    }
+
+    std::sort( points.begin(), points.end(), []( const Point& lhs, const Point& rhs) { return lhs.interval < rhs.interval; });
+}
+
+void SimPoint::save_checkpoints( const std::string& prefix, uint64 warmup_instrs)
+{
+    FuncSim<MIPS> sim;
+    sim.init( binary);
+
+    // points are sorted, so the program is executed only once
+    uint64 executed_instrs = 0;
+    for ( size_t i = 0; i < points.size(); ++i)
+    {
+        const auto& interval = intervals.at( points[ i].interval);
+        const uint64 checkpoint_instrs = std::max( executed_instrs, interval.start - std::min( interval.start, warmup_instrs));
+        for ( ; executed_instrs < checkpoint_instrs; ++executed_instrs)
+            sim.step();
+
+        points[ i].warmup = interval.start - checkpoint_instrs;
+        points[ i].checkpoint = prefix + "." + std::to_string( i) + ".ckpt";
+        sim.save_checkpoint( points[ i].checkpoint);
+    }
+}
+
+void SimPoint::simulate( uint32 jobs)
+{
+    if ( jobs == 0)
+    {
+        std::cerr << "ERROR. SimPoint simulation needs at least one job" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    std::atomic<size_t> next_point{ 0};
+    auto worker = [&]() {
+        for ( size_t i = next_point++; i < points.size(); i = next_point++)
+        {
+            auto& point = points[ i];
+            config::LocalValues local( std::map<std::string, std::string>{ { "fast-forward", "0"}, { "warmup", std::to_string( point.warmup)}});
+            PerfSim<MIPS> sim( false);
+            sim.set_statistics_output( false);
+            sim.set_checkpoints( point.checkpoint, "");
+            sim.run( binary, intervals.at( point.interval).size);
+            point.executed_instrs = sim.get_executed_instrs();
+            point.cycles = sim.get_cycles();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    const auto threads_num = std::min<size_t>( jobs, points.size());
+    for ( size_t i = 0; i < threads_num; ++i)
+        threads.emplace_back( worker);
+
+    for ( auto& thread : threads)
+        thread.join();
+}
+
+double SimPoint::get_estimated_cpi() const
+{
+    double result = 0;
+    for ( const auto& point : points)
+        result += point.weight * static_cast<double>( point.cycles) / static_cast<double>( point.executed_instrs);
+    return result;
+}
+
+void SimPoint::dump( std::ostream& out) const
+{
+    out << "interval,start,weight,instrs,cycles,cpi" << std::endl;
+    for ( const auto& point : points)
+        out << point.interval << ',' << intervals.at( point.interval).start << ','
+            << point.weight << ',' << point.executed_instrs << ',' << point.cycles << ','
+            << static_cast<double>( point.cycles) / static_cast<double>( point.executed_instrs) << std::endl;
+
+    out << "estimated CPI: " << get_estimated_cpi() << std::endl
+        << "estimated IPC: " << 1.0 / get_estimated_cpi() << std::endl;
+}
@@ -0,0 +1,69 @@
+/*
+ * simpoint.h - sampled performance simulation of representative intervals
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef SIMPOINT_H
+#define SIMPOINT_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <infra/types.h>
+#include <infra/ports/timing.h>
+
+// SimPoint-style sampling. Functional simulation splits the program into
+// intervals of fixed size and collects basic block vectors of them; vectors
+// are clustered and only one interval per cluster is simulated in details,
+// starting from a checkpoint. CPI of the program is estimated as the average
+// of CPIs of simulated intervals weighted by sizes of their clusters.
+class SimPoint
+{
+public:
+    struct Interval
+    {
+        uint64 start = 0; // number of instructions before the interval
+        uint64 size = 0;
+        // instructions executed in basic blocks, keyed by PC of the taken branch ending the block
+        std::map<Addr, uint64> bbv;
+    };
+
+    struct Point
+    {
+        size_t interval = 0;
+        double weight = 0;
+        std::string checkpoint;
+        uint64 warmup = 0; // instructions between the checkpoint and the interval
+        uint64 executed_instrs = 0;
+        Cycle cycles = 0_Cl;
+    };
+
+    SimPoint( std::string binary, uint64 interval_size);
+
+    void profile( uint64 instrs_to_run);
+    void choose( uint32 max_points);
+    // checkpoints are taken before intervals to warm up predictor and caches
+    void save_checkpoints( const std::string& prefix, uint64 warmup_instrs);
+    void simulate( uint32 jobs);
+
+    double get_estimated_cpi() const;
+    const auto& get_intervals() const { return intervals; }
+    const auto& get_points() const { return points; }
+
+    void dump( std::ostream& out) const;
+
+private:
+    static constexpr const size_t PROJECTION_DIMENSIONS = 15;
+    using Vector = std::vector<double>;
+
+    Vector project( const Interval& interval) const;
+
+    const std::string binary;
+    const uint64 interval_size;
+    std::vector<Interval> intervals;
+    std::vector<Point> points;
+};
+
+#endif // SIMPOINT_H
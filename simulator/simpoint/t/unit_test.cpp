@@ -0,0 +1,69 @@
+// generic C
+#include <cmath>
+#include <cstdlib>
+
+// Google Test library
+#include <gtest/gtest.h>
+
+// Module
+#include <core/perf_sim.h>
+#include <mips/mips.h>
+#include "../simpoint.h"
+
+static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
+
+TEST( SimPoint, Profile_Intervals)
+{
+    SimPoint simpoint( valid_elf_file, 1000);
+    simpoint.profile( MAX_VAL64);
+
+    const auto& intervals = simpoint.get_intervals();
+    ASSERT_EQ( intervals.size(), 15u);
+    for ( size_t i = 0; i < intervals.size(); ++i)
+    {
+        uint64 instrs = 0;
+        for ( const auto& block : intervals[ i].bbv)
+            instrs += block.second;
+
+        ASSERT_EQ( intervals[ i].start, i * 1000);
+        ASSERT_EQ( instrs, intervals[ i].size);
+    }
+    ASSERT_EQ( intervals.back().size, 406u);
+}
+
+TEST( SimPoint, Estimate_IPC)
+{
+    PerfSim<MIPS> full( false);
+    full.set_statistics_output( false);
+    full.run_no_limit( valid_elf_file);
+    const double full_cpi = static_cast<double>( full.get_cycles()) / static_cast<double>( full.get_executed_instrs());
+
+    SimPoint simpoint( valid_elf_file, 1000);
+    simpoint.profile( MAX_VAL64);
+    simpoint.choose( 4);
+    simpoint.save_checkpoints( "./simpoint_test", 2000);
+    simpoint.simulate( 2);
+
+    double weights = 0;
+    for ( const auto& point : simpoint.get_points())
+        weights += point.weight;
+
+    ASSERT_LE( simpoint.get_points().size(), 4u);
+    ASSERT_NEAR( weights, 1.0, 1e-9);
+    ASSERT_NEAR( simpoint.get_estimated_cpi(), full_cpi, full_cpi * 0.1);
+}
+
+TEST( SimPoint, Wrong_Args)
+{
+    ASSERT_EXIT( SimPoint( valid_elf_file, 0),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( SimPoint( valid_elf_file, 1000).choose( 4),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
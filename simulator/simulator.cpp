@@ -6,6 +6,8 @@
 // Simulators
 #include <func_sim/func_sim.h>
 #include <core/perf_sim.h>
+#include <core/ooo_perf_sim.h>
+#include <core/multicore_sim.h>
 
 // ISAs
 #include <mips/mips.h>
@@ -13,14 +15,41 @@
 
 #include "simulator.h"
 
+template <typename ISA>
+static std::unique_ptr<Simulator> create_in_order_simulator( bool functional_only, bool log, uint32 cores)
+{
+    if (functional_only)
+        return std::make_unique<FuncSim<ISA>>( log);
+    if (cores > 1)
+        return std::make_unique<MultiCoreSim<ISA>>( log, cores);
+    return std::make_unique<PerfSim<ISA>>( log);
+}
+
 std::unique_ptr<Simulator>
-Simulator::create_simulator( const std::string& isa, bool functional_only, bool log)
+Simulator::create_simulator( const std::string& isa, bool functional_only, bool log, bool out_of_order, uint32 cores)
 {
+    // functional simulation and out-of-order core are single-core only
+    if ( cores > 1 && ( functional_only || out_of_order))
+        return nullptr;
+
     if ( isa == "mips") {
-        if (functional_only)
-            return std::make_unique<FuncSim<MIPS>>( log);
-        return std::make_unique<PerfSim<MIPS>>( log);
+        if (out_of_order && !functional_only)
+            return std::make_unique<OOOPerfSim<MIPS>>( log);
+        return create_in_order_simulator<MIPS>( functional_only, log, cores);
     }
 
+    // out-of-order core is modeled only for MIPS
+    if ( out_of_order && !functional_only)
+        return nullptr;
+
+    if ( isa == "riscv32")
+        return create_in_order_simulator<RISCV32>( functional_only, log, cores);
+
+    if ( isa == "riscv64")
+        return create_in_order_simulator<RISCV64>( functional_only, log, cores);
+
+    if ( isa == "riscv128")
+        return create_in_order_simulator<RISCV128>( functional_only, log, cores);
+
     return nullptr;
 }
@@ -7,11 +7,19 @@
 #define SIMULATOR_H
  
 #include <memory>
+#include <string>
  
 #include <infra/types.h>
 #include <infra/log.h>
  
 class Simulator : public Log {
+protected:
+    std::string checkpoint_to_load;
+    std::string checkpoint_to_save;
+    std::string instr_trace_to_save;
+    std::string profile_to_save;
+    uint64 profile_period = 1;
+
 public:
     explicit Simulator( bool log = false) : Log( log) {}
 
@@ -19,7 +27,29 @@ public:
     void run_no_limit( const std::string& tr) { run( tr, MAX_VAL64); }
     virtual void set_PC( Addr value) = 0;
 
-    static std::unique_ptr<Simulator> create_simulator( const std::string& isa, bool functional_only, bool log);
+    // State is restored from a checkpoint at the start of the run and saved at its end,
+    // empty file names disable that
+    void set_checkpoints( const std::string& load_file, const std::string& save_file)
+    {
+        checkpoint_to_load = load_file;
+        checkpoint_to_save = save_file;
+    }
+
+    // Executed instructions are recorded to the file if the simulator supports that
+    void set_instr_trace( const std::string& save_file) { instr_trace_to_save = save_file; }
+
+    // Events of guest functions are sampled once in the period and saved to the files
+    // of the prefix if the simulator supports that, an empty prefix disables profiling
+    void set_profile( const std::string& prefix, uint64 period)
+    {
+        profile_to_save = prefix;
+        profile_period = period;
+    }
+
+    // out-of-order core is simulated instead of in-order pipeline if requested,
+    // several in-order cores share memory if requested
+    static std::unique_ptr<Simulator> create_simulator( const std::string& isa, bool functional_only, bool log,
+                                                        bool out_of_order = false, uint32 cores = 1);
 };
 
 #endif // SIMULATOR_H
@@ -0,0 +1,134 @@
+/*
+ * sweep.cpp - design-space sweep over configurations of performance simulator
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <api/simulation.h>
+#include <infra/string/csv.h>
+
+#include "sweep.h"
+
+namespace pt = boost::property_tree;
+
+Sweep::Sweep( std::vector<Point> points) : points( std::move( points)), results( this->points.size()) { }
+
+// all the combinations of values of options, the first option changes the slowest
+static std::vector<Sweep::Point> get_space_points( const pt::ptree& tree, const std::string& filename)
+{
+    std::vector<Sweep::Point> points = { Sweep::Point()};
+    for ( const auto& option : tree)
+    {
+        std::vector<std::string> values;
+        if ( option.second.empty())
+            values.push_back( option.second.get_value<std::string>());
+
+        for ( const auto& value : option.second)
+        {
+            if ( !value.first.empty() || !value.second.empty())
+            {
+                std::cerr << "ERROR. Option " << option.first << " in sweep file " << filename << " is not an array of values" << std::endl;
+                std::exit( EXIT_FAILURE);
+            }
+            values.push_back( value.second.get_value<std::string>());
+        }
+
+        std::vector<Sweep::Point> product;
+        for ( const auto& point : points)
+            for ( const auto& value : values)
+            {
+                auto next = point;
+                next[ option.first] = value;
+                product.emplace_back( std::move( next));
+            }
+        points = std::move( product);
+    }
+    return points;
+}
+
+Sweep Sweep::load( const std::string& filename)
+{
+    pt::ptree tree;
+    try {
+        pt::read_json( filename, tree);
+    }
+    catch ( const pt::json_parser_error& e) {
+        std::cerr << "ERROR. Could not parse sweep file " << e.what() << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    // members of JSON objects have names
+    if ( !tree.empty() && !tree.begin()->first.empty())
+        return Sweep( get_space_points( tree, filename));
+
+    std::vector<Point> points;
+    for ( const auto& node : tree)
+    {
+        // elements of JSON arrays have no names
+        if ( !node.first.empty())
+        {
+            std::cerr << "ERROR. Sweep file " << filename << " is not an array of points" << std::endl;
+            std::exit( EXIT_FAILURE);
+        }
+
+        Point point;
+        for ( const auto& value : node.second)
+        {
+            if ( !value.second.empty())
+            {
+                std::cerr << "ERROR. Option " << value.first << " in sweep file " << filename << " is not a value" << std::endl;
+                std::exit( EXIT_FAILURE);
+            }
+            point[ value.first] = value.second.get_value<std::string>();
+        }
+        points.emplace_back( std::move( point));
+    }
+
+    return Sweep( std::move( points));
+}
+
+void Sweep::run( const std::string& binary, uint64 instrs_to_run, uint32 jobs)
+{
+    if ( jobs == 0)
+    {
+        std::cerr << "ERROR. Sweep needs at least one job" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    // the binary is loaded once for all the points
+    const Simulation simulation( binary);
+    results.clear();
+    for ( const auto& result : simulation.run_all( points, instrs_to_run, jobs))
+        results.push_back( Result{ result.executed_instrs, Cycle( result.cycles)});
+}
+
+void Sweep::dump_csv( std::ostream& out) const
+{
+    std::set<std::string> options;
+    for ( const auto& point : points)
+        for ( const auto& value : point)
+            options.insert( value.first);
+
+    for ( const auto& option : options)
+        out << csv_field( option) << ',';
+    out << "instrs,cycles,ipc" << std::endl;
+
+    for ( size_t i = 0; i < points.size(); ++i)
+    {
+        for ( const auto& option : options)
+        {
+            const auto it = points[ i].find( option);
+            out << ( it == points[ i].end() ? "" : csv_field( it->second)) << ',';
+        }
+
+        const auto& result = results.at( i);
+        out << result.executed_instrs << ',' << result.cycles << ','
+            << ( result.cycles == 0_Cl ? 0. : 1.0 * result.executed_instrs / static_cast<double>( result.cycles)) << std::endl;
+    }
+}
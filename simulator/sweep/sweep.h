@@ -0,0 +1,48 @@
+/*
+ * sweep.h - design-space sweep over configurations of performance simulator
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <infra/types.h>
+#include <infra/ports/timing.h>
+
+// Runs independent performance simulations of the same binary
+// with different options on a pool of threads
+class Sweep
+{
+public:
+    // Values of options, they override command line in a simulation thread
+    using Point = std::map<std::string, std::string>;
+
+    explicit Sweep( std::vector<Point> points);
+
+    // Loads JSON array of objects, e.g. [ { "bp-mode": "static_always_taken", "bp-size": 64 } ],
+    // or the space of all the combinations of values, e.g. { "bp-mode": [ "gshare", "dynamic_two_bit" ], "width": [ 1, 2 ] }
+    static Sweep load( const std::string& filename);
+    const std::vector<Point>& get_points() const { return points; }
+
+    void run( const std::string& binary, uint64 instrs_to_run, uint32 jobs);
+
+    // Values of all the swept options and results, one line per point
+    void dump_csv( std::ostream& out) const;
+
+private:
+    struct Result
+    {
+        uint64 executed_instrs = 0;
+        Cycle cycles = 0_Cl;
+    };
+
+    const std::vector<Point> points;
+    std::vector<Result> results;
+};
+
+#endif // SWEEP_H
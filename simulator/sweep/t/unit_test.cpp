@@ -0,0 +1,69 @@
+// generic C
+#include <cstdlib>
+
+// generic C++
+#include <sstream>
+
+// Google Test library
+#include <gtest/gtest.h>
+
+// Module
+#include "../sweep.h"
+
+static const std::string valid_elf_file = TEST_PATH "/tt.core.out";
+
+static std::string run_sweep( uint32 jobs)
+{
+    auto sweep = Sweep::load( "./sweep.json");
+    sweep.run( valid_elf_file, MAX_VAL64, jobs);
+
+    std::ostringstream oss;
+    sweep.dump_csv( oss);
+    return oss.str();
+}
+
+TEST( Sweep, Load_And_Dump)
+{
+    auto sweep = Sweep::load( "./sweep.json");
+
+    std::ostringstream oss;
+    sweep.dump_csv( oss);
+
+    std::istringstream iss( oss.str());
+    std::string header;
+    std::getline( iss, header);
+    ASSERT_EQ( header, "bp-mode,bp-size,icache-size,instrs,cycles,ipc");
+
+    std::string line;
+    std::getline( iss, line);
+    ASSERT_EQ( line.substr( 0, 22), "dynamic_two_bit,,2048,");
+}
+
+TEST( Sweep, Quoted_Values)
+{
+    Sweep sweep( { Sweep::Point{ { "trace-stages", "fetch,writeback"}, { "width", "2"}}});
+
+    std::ostringstream oss;
+    sweep.dump_csv( oss);
+    ASSERT_EQ( oss.str(), "trace-stages,width,instrs,cycles,ipc\n\"fetch,writeback\",2,0,0,0\n");
+}
+
+TEST( Sweep, Parallel_Run_Is_Same_As_Serial)
+{
+    ASSERT_EQ( run_sweep( 1), run_sweep( 3));
+}
+
+TEST( Sweep, Wrong_Sweep_File)
+{
+    ASSERT_EXIT( Sweep::load( "./1234567890/qwertyuiop"),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+    ASSERT_EXIT( Sweep( { Sweep::Point{ { "bp-mode", "dynamic_two_bit"}}}).run( valid_elf_file, MAX_VAL64, 0),
+                 ::testing::ExitedWithCode( EXIT_FAILURE), "ERROR.*");
+}
+
+int main( int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, argv);
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,110 @@
+/*
+ * main.cpp - monitor of running simulations by their telemetry files
+ * Copyright 2018 MIPT-MIPS
+ */
+
+#include <infra/stats/telemetry.h>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace po = boost::program_options;
+
+struct Simulation
+{
+    std::string filename;
+    std::unique_ptr<TelemetryReader> reader;
+    TelemetryReader::Sample last = {};
+};
+
+// current IPC is taken since the previous refresh, so slow phases are seen at once
+static void print( std::ostream& out, std::vector<Simulation>* simulations)
+{
+    out << std::left << std::setw( 8) << "pid" << std::setw( 9) << "state" << std::right
+        << std::setw( 14) << "instrs" << std::setw( 14) << "cycles"
+        << std::setw( 8) << "IPC" << std::setw( 9) << "IPC now" << std::setw( 10) << "kIPS" << "  file" << std::endl;
+
+    out << std::fixed << std::setprecision( 3);
+    for ( auto& simulation : *simulations)
+    {
+        const auto sample = simulation.reader->read();
+        const auto instrs = sample.instrs - std::min( simulation.last.instrs, sample.instrs);
+        const auto cycles = sample.cycles - std::min( simulation.last.cycles, sample.cycles);
+        const double current_ipc = cycles == 0 ? sample.get_ipc() : static_cast<double>( instrs) / static_cast<double>( cycles);
+        simulation.last = sample;
+
+        out << std::left << std::setw( 8) << sample.pid << std::setw( 9) << ( sample.is_finished ? "done" : "running") << std::right
+            << std::setw( 14) << sample.instrs << std::setw( 14) << sample.cycles
+            << std::setw( 8) << sample.get_ipc() << std::setw( 9) << current_ipc
+            << std::setw( 10) << std::setprecision( 1) << sample.get_kips() << std::setprecision( 3)
+            << "  " << simulation.filename << std::endl;
+
+        for ( const auto& [name, value] : sample.counters)
+            out << "        " << name << ": " << value << std::endl;
+    }
+}
+
+static bool is_finished( const std::vector<Simulation>& simulations)
+{
+    return std::all_of( simulations.begin(), simulations.end(),
+                        []( const auto& simulation) { return simulation.last.is_finished; });
+}
+
+int main( int argc, const char* argv[])
+{
+    uint32 interval = 1000;
+    bool is_once = false;
+    std::vector<std::string> filenames;
+
+    po::options_description description( "Usage: mipt-mips-top [options] <telemetry files>\nAllowed options");
+    description.add_options()
+        ( "help,h", "print this message")
+        ( "interval,i", po::value<uint32>( &interval)->default_value( interval), "milliseconds between refreshes")
+        ( "once", po::bool_switch( &is_once), "print the values once instead of refreshing them until the simulations are done");
+    po::options_description hidden;
+    hidden.add_options()( "files", po::value<std::vector<std::string>>( &filenames));
+    po::options_description all;
+    all.add( description).add( hidden);
+    po::positional_options_description positional;
+    positional.add( "files", -1);
+
+    try {
+        po::variables_map vm;
+        po::store( po::command_line_parser( argc, argv).options( all).positional( positional).run(), vm);
+        po::notify( vm);
+        if ( vm.count( "help") != 0 || filenames.empty())
+        {
+            std::cout << description << std::endl;
+            return vm.count( "help") != 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    catch ( const std::exception& e) {
+        std::cerr << "ERROR. " << e.what() << std::endl << description << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Simulation> simulations;
+    for ( const auto& filename : filenames)
+        simulations.push_back( { filename, std::make_unique<TelemetryReader>( filename)});
+
+    for ( ;;)
+    {
+        // the screen is cleared by ANSI escape sequence before each refresh
+        if ( !is_once)
+            std::cout << "\033[H\033[2J";
+        print( std::cout, &simulations);
+        if ( is_once || is_finished( simulations))
+            return EXIT_SUCCESS;
+
+        std::this_thread::sleep_for( std::chrono::milliseconds( interval));
+    }
+}
@@ -1,27 +1,47 @@
+#include <algorithm>
 #include <cassert>
 
 #include <iostream>
 #include <chrono>
 
+#include <infra/config/config.h>
+#include <infra/self_profiler/self_profiler.h>
+
 #include "writeback.h"
 
+namespace config {
+    static Value<std::string> checker_mode = { "checker", "structured", "checker mode: off, structured, string or final"};
+    static Value<uint64> checker_period = { "checker-period", 1, "compare each Nth instruction with the checker"};
+} // namespace config
+
 template <typename ISA>
-Writeback<ISA>::Writeback(bool log) : Log( log), checker( false)
+Writeback<ISA>::Writeback( bool log, uint32 width, const PipelineDepth& depth, uint32 threads) : Log( log), threads( threads), checker_mode( get_checker_mode( config::checker_mode)), checker_period( config::checker_period)
 {
-    rp_datapath = make_read_port<Instr>("MEMORY_2_WRITEBACK", PORT_LATENCY);
-    wp_bypass = make_write_port<RegDstUInt>("WRITEBACK_2_EXECUTE_BYPASS", PORT_BW, SRC_REGISTERS_NUM);
+    if ( checker_period == 0)
+    {
+        std::cerr << "ERROR. Checker period must be positive" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    // instructions pass all the memory sub-stages
+    rp_datapath = make_read_port<Instr>("MEMORY_2_WRITEBACK", Latency( depth.memory_stages));
+    wp_bypass = make_write_port<RegDstUInt>("WRITEBACK_2_EXECUTE_BYPASS", width, PORT_FANOUT);
     wp_halt = make_write_port<bool>("WRITEBACK_2_CORE_HALT", PORT_BW, PORT_FANOUT);
+    if ( threads > 1)
+        wp_thread_halt = make_write_port<uint8>("WRITEBACK_2_FETCH_THREAD_HALT", width, PORT_FANOUT);
 }
 
 template <typename ISA>
 void Writeback<ISA>::clock( Cycle cycle)
 {
-    sout << "wb      cycle " << std::dec << cycle << ": ";
+    SELF_PROFILE( WRITEBACK);
+    TRACE( sout) << "wb      cycle " << std::dec << cycle << ": ";
+    outcome = StageOutcome::BUBBLE;
 
     /* check if there is something to process */
     if ( !rp_datapath->is_ready( cycle))
     {
-        sout << "bubble\n";
+        TRACE( sout) << "bubble\n";
         if ( cycle >= last_writeback_cycle + 100_Lt)
         {
             serr << "Deadlock was detected. The process will be aborted."
@@ -30,10 +50,32 @@ void Writeback<ISA>::clock( Cycle cycle)
         return;
     }
 
-    auto instr = rp_datapath->read( cycle);
+    /* instructions after the last one are not retired */
+    while ( rp_datapath->is_ready( cycle))
+    {
+        const auto& instr = rp_datapath->read( cycle);
+        auto& thread = threads[ instr.get_thread()];
+        if ( !is_done( thread) && !instr.is_flushed())
+            writeback_instr( &thread, instr, cycle);
+        else if ( threads.size() > 1)
+            wp_bypass->write( instr.get_bypassing_data(), cycle); // the slot is kept for other threads
+    }
+}
+
+template <typename ISA>
+bool Writeback<ISA>::is_done() const
+{
+    return std::all_of( threads.begin(), threads.end(), [this]( const Thread& thread) { return is_done( thread); });
+}
 
+template <typename ISA>
+void Writeback<ISA>::writeback_instr( Thread* thread, Instr instr, Cycle cycle)
+{
     /* perform writeback */
-    rf->write_dst( instr);
+    thread->rf->write_dst( instr);
+
+    /* bypass data, bubbles keep slots of the bundle */
+    wp_bypass->write( instr.get_bypassing_data(), cycle);
 
     /* check for bubble */
     if ( instr.is_bubble())
@@ -42,37 +84,158 @@ void Writeback<ISA>::clock( Cycle cycle)
     /* check for traps */
     instr.check_trap();
 
-    /* bypass data */
-    wp_bypass->write( instr.get_bypassing_data(), cycle);
-
     /* log */
-    sout << instr << std::endl;
+    TRACE( sout) << instr << std::endl;
 
     /* perform checks */
-    check( instr);
+    check( thread, instr);
 
     /* update simulator cycles info */
+    ++thread->executed_instrs;
     ++executed_instrs;
+    outcome = StageOutcome::PASSED;
+    trace_event( pipeline_trace, PipelineEvent::WRITEBACK, instr, cycle);
+    if ( profiler != nullptr)
+    {
+        profiler->count( ProfileEvent::CYCLES, instr.get_PC(), ( cycle - last_writeback_cycle).to_size_t());
+        profiler->retire( instr);
+    }
     last_writeback_cycle = cycle;
-    if ( executed_instrs >= instrs_to_run || instr.is_halt())
+    thread->is_halted_by_instr = instr.is_halt();
+    if ( is_done())
         wp_halt->write( true, cycle);
-    
-    sout << "Executed instructions: " << executed_instrs
+    else if ( is_done( *thread))
+        wp_thread_halt->write( instr.get_thread(), cycle);
+
+    TRACE( sout) << "Executed instructions: " << executed_instrs
          << std::endl << std::endl;
 }
 
 template <typename ISA>
-void Writeback<ISA>::check( const FuncInstr& instr)
+typename Writeback<ISA>::CheckerMode Writeback<ISA>::get_checker_mode( const std::string& name)
+{
+    if ( name == "off")
+        return CheckerMode::OFF;
+    if ( name == "structured")
+        return CheckerMode::STRUCTURED;
+    if ( name == "string")
+        return CheckerMode::STRING;
+    if ( name == "final")
+        return CheckerMode::FINAL;
+
+    std::cerr << "ERROR. Invalid checker mode " << name << std::endl
+              << "Supported modes: off, structured, string, final" << std::endl;
+    std::exit( EXIT_FAILURE);
+}
+
+template <typename ISA>
+void Writeback<ISA>::init_checker( const std::string& tr, const Memory* memory, uint32 thread)
+{
+    checker_trace = tr;
+    if ( checker_mode != CheckerMode::OFF && checker_mode != CheckerMode::FINAL) {
+        auto& checker = *threads.at( thread).checker;
+        checker.init( tr);
+        if ( memory != nullptr)
+            checker.share_instr_cache( *memory);
+    }
+}
+
+template <typename ISA>
+void Writeback<ISA>::check_final_state( const Memory& memory, uint32 thread)
+{
+    if ( checker_mode != CheckerMode::FINAL)
+        return;
+
+    const auto& state = threads.at( thread);
+    auto& checker = *state.checker;
+    checker.run( checker_trace, skipped_instrs + state.executed_instrs);
+
+    if ( checker.get_rf().hash() != state.rf->hash())
+        serr << "Mismatch: final register file differs from functional simulation"
+             << std::endl << critical;
+
+    // If the run was stopped by instruction limit, younger instructions
+    // may have already accessed memory, so it is compared only after a halt
+    if ( state.is_halted_by_instr && checker.get_memory().hash() != memory.hash())
+        serr << "Mismatch: final memory differs from functional simulation"
+             << std::endl << critical;
+}
+
+template <typename ISA>
+void Writeback<ISA>::set_checkpoints( const std::string& load_file, const std::string& save_file)
+{
+    if ( !save_file.empty() && checker_mode == CheckerMode::OFF)
+    {
+        std::cerr << "ERROR. Checkpoint of performance simulation is saved from the checker, which is off" << std::endl;
+        std::exit( EXIT_FAILURE);
+    }
+
+    // the final checker runs the whole simulation itself
+    checkpoint_to_save = checker_mode == CheckerMode::FINAL ? "" : save_file;
+    threads[ 0].checker->set_checkpoints( load_file, checker_mode == CheckerMode::FINAL ? save_file : "");
+}
+
+template <typename ISA>
+void Writeback<ISA>::save_checkpoint() const
+{
+    if ( !checkpoint_to_save.empty())
+        threads[ 0].checker->save_checkpoint( checkpoint_to_save);
+}
+
+template <typename ISA>
+void Writeback<ISA>::fast_forward( std::istream& state, uint64 instrs)
+{
+    // the final checker repeats the whole run, so it just skips more instructions
+    skipped_instrs += instrs;
+    if ( checker_mode != CheckerMode::OFF && checker_mode != CheckerMode::FINAL)
+        threads[ 0].checker->load_checkpoint( state);
+}
+
+// Compares architectural results of instructions without their disassembly
+template <typename ISA>
+bool Writeback<ISA>::is_same_result( const FuncInstr& lhs, const FuncInstr& rhs)
+{
+    return lhs.is_same( rhs)
+        && lhs.get_new_PC() == rhs.get_new_PC()
+        && lhs.get_dst_num() == rhs.get_dst_num()
+        && lhs.get_v_dst() == rhs.get_v_dst()
+        && lhs.get_mem_addr() == rhs.get_mem_addr()
+        && ( !lhs.is_store() || lhs.get_v_src2() == rhs.get_v_src2())
+        && lhs.has_trap() == rhs.has_trap();
+}
+
+template <typename ISA>
+void Writeback<ISA>::check( Thread* thread, const FuncInstr& instr)
 {
-    const auto func_dump = checker.step();
+    SELF_PROFILE( CHECKER);
+    if ( checker_mode == CheckerMode::OFF || checker_mode == CheckerMode::FINAL)
+        return;
+
+    // the checker executes every instruction to keep its state,
+    // but only each Nth one is compared
+    const auto func_dump = thread->checker->step();
+    if ( thread->executed_instrs % checker_period != 0)
+        return;
 
-    if ( func_dump.Dump() != instr.Dump())
+    // strings are formatted only to report a mismatch in structured mode
+    const bool is_mismatch = checker_mode == CheckerMode::STRING
+                           ? func_dump.Dump() != instr.Dump()
+                           : !is_same_result( func_dump, instr);
+    if ( is_mismatch)
         serr << "Mismatch: " << std::endl
              << "Checker output: " << func_dump    << std::endl
              << "PerfSim output: " << instr.Dump() << std::endl
              << critical;
 }
 
+template <typename ISA>
+void Writeback<ISA>::register_stats( StatsRegistry* stats) const
+{
+    stats->add_counter( "writeback.instrs", &executed_instrs);
+    for ( size_t i = 0; threads.size() > 1 && i < threads.size(); ++i)
+        stats->add_counter( "writeback.thread" + std::to_string( i) + ".instrs", &threads[ i].executed_instrs);
+}
+
 #include <mips/mips.h>
 #include <risc_v/risc_v.h>
 
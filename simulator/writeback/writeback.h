@@ -8,27 +8,55 @@
 
 #include <infra/ports/ports.h>
 #include <func_sim/func_sim.h>
+#include <core/cpi_stack.h>
 #include <core/perf_instr.h>
+#include <core/pipeline_depth.h>
+#include <core/pipeline_trace.h>
+#include <core/smt.h>
+#include <infra/profiler/profiler.h>
+#include <infra/stats/stats.h>
+
+#include <memory>
+#include <vector>
 
 template <typename ISA>
 class Writeback : public Log
 {
     using FuncInstr = typename ISA::FuncInstr;
+    using Memory = typename ISA::Memory;
     using Instr = PerfInstr<FuncInstr>;
     using RegisterUInt = typename ISA::RegisterUInt;
     using RegDstUInt = typename ISA::RegDstUInt;
 private:
+    /* Hardware threads retire their own programs, each of them is checked apart */
+    struct Thread
+    {
+        RF<ISA>* rf = nullptr;
+        std::unique_ptr<FuncSim<ISA>> checker = std::make_unique<FuncSim<ISA>>( false);
+        uint64 executed_instrs = 0;
+        bool is_halted_by_instr = false;
+    };
+    std::vector<Thread> threads;
+
     /* Instrumentation */
     uint64 instrs_to_run = 0;
     uint64 executed_instrs = 0;
     Cycle last_writeback_cycle = 0_Cl;
-    FuncSim<ISA> checker;
-    void check( const FuncInstr& instr);
-
-    /* Simulator internals */
-    RF<ISA>* rf = nullptr;
-
-    static constexpr const uint8 SRC_REGISTERS_NUM = 2;
+    StageOutcome outcome = StageOutcome::BUBBLE; // instructions are retired in the last clock
+    PipelineTrace* pipeline_trace = nullptr;
+    Profiler* profiler = nullptr;
+    std::string checker_trace;
+    std::string checkpoint_to_save;
+    uint64 skipped_instrs = 0;
+    enum class CheckerMode { OFF, STRUCTURED, STRING, FINAL } checker_mode = CheckerMode::STRUCTURED;
+    uint64 checker_period = 1;
+    static CheckerMode get_checker_mode( const std::string& name);
+    static bool is_same_result( const FuncInstr& lhs, const FuncInstr& rhs);
+    void check( Thread* thread, const FuncInstr& instr);
+    void writeback_instr( Thread* thread, Instr instr, Cycle cycle);
+    // the instructions after the last one are not retired
+    bool is_done( const Thread& thread) const { return thread.executed_instrs >= instrs_to_run || thread.is_halted_by_instr; }
+    bool is_done() const;
 
     /* Input */
     std::unique_ptr<ReadPort<Instr>> rp_datapath = nullptr;
@@ -36,15 +64,35 @@ private:
     /* Output */
     std::unique_ptr<WritePort<RegDstUInt>> wp_bypass = nullptr;
     std::unique_ptr<WritePort<bool>> wp_halt = nullptr;
+    std::unique_ptr<WritePort<uint8>> wp_thread_halt = nullptr; // fetch stops the thread which is done with SMT
 
 public:
-    explicit Writeback( bool log);
+    Writeback( bool log, uint32 width, const PipelineDepth& depth = PipelineDepth(), uint32 threads = 1);
     void clock( Cycle cycle);
-    void set_RF( RF<ISA>* value) { rf = value; }
-    void set_PC( Addr value) { checker.set_PC( value); }
+    void set_RF( RF<ISA>* value, uint32 thread = 0) { threads.at( thread).rf = value; }
+    void set_pipeline_trace( PipelineTrace* value) { pipeline_trace = value; }
+    void set_profiler( Profiler* value) { profiler = value; }
+    void set_PC( Addr value, uint32 thread = 0) { threads.at( thread).checker->set_PC( value); }
+    // the limit is applied to each thread
     void set_instrs_to_run( uint64 value) { instrs_to_run = value; }
-    void init_checker( const std::string& tr) { checker.init( tr); }
+    // the checker shares decoded instructions with the memory of the pipeline if it is passed
+    void init_checker( const std::string& tr, const Memory* memory, uint32 thread = 0);
+    void disable_checker() { checker_mode = CheckerMode::OFF; }
+    void check_final_state( const Memory& memory, uint32 thread = 0);
+
+    // The checker has exactly the state of retired instructions,
+    // so checkpoints of performance simulation are saved from it
+    void set_checkpoints( const std::string& load_file, const std::string& save_file);
+    void save_checkpoint() const;
+
+    // the state goes to the checker after functional simulation of skipped instructions
+    void fast_forward( std::istream& state, uint64 instrs);
     auto get_executed_instrs() const { return executed_instrs; }
+    auto get_executed_instrs( uint32 thread) const { return threads.at( thread).executed_instrs; }
+    StageOutcome get_outcome() const { return outcome; }
+
+    // instructions of each thread are counted as "writeback.thread<N>.instrs" with SMT
+    void register_stats( StatsRegistry* stats) const;
 };
 
 #endif
@@ -0,0 +1,67 @@
+# matmul.s - MIPS kernel of integer matrix multiplication
+# Two 24x24 matrices are multiplied 8 times, loads are regular
+# and the inner loop is dominated by multiplications.
+# MIPT-MIPS does not simulate delay slots, so branches are not followed by nops.
+#
+# llvm-mc -triple=mipsel -filetype=obj -o matmul.o matmul.s
+# ld.lld -Ttext=0x400000 -e __start -o matmul.out matmul.o
+
+    .set noreorder
+    .text
+    .globl __start
+__start:
+    lui   $s0, 0x1000            # A
+    addiu $s1, $s0, 0x1000       # B
+    addiu $s2, $s0, 0x2000       # C
+    addiu $s3, $zero, 24         # size of matrices
+    sll   $s5, $s3, 2            # size of row in bytes
+
+    addiu $t0, $zero, 0          # i
+    addu  $t4, $zero, $s0        # pointer to A[i][j]
+    addu  $t5, $zero, $s1        # pointer to B[i][j]
+init_row:
+    addiu $t1, $zero, 0          # j
+init:
+    addu  $t6, $t0, $t1
+    sw    $t6, 0($t4)            # A[i][j] = i + j
+    subu  $t6, $t0, $t1
+    sw    $t6, 0($t5)            # B[i][j] = i - j
+    addiu $t4, $t4, 4
+    addiu $t5, $t5, 4
+    addiu $t1, $t1, 1
+    bne   $t1, $s3, init
+    addiu $t0, $t0, 1
+    bne   $t0, $s3, init_row
+
+    addiu $s4, $zero, 8          # repetitions
+repeat:
+    addiu $t0, $zero, 0          # i
+    addu  $t8, $zero, $s2        # pointer to C[i][j]
+row:
+    addiu $t1, $zero, 0          # j
+column:
+    mul   $t4, $t0, $s5
+    addu  $t4, $t4, $s0          # pointer to A[i][k]
+    sll   $t5, $t1, 2
+    addu  $t5, $t5, $s1          # pointer to B[k][j]
+    addiu $t2, $zero, 0          # k
+    addiu $t3, $zero, 0          # sum
+dot:
+    lw    $t6, 0($t4)
+    lw    $t7, 0($t5)
+    mul   $t6, $t6, $t7
+    addu  $t3, $t3, $t6
+    addiu $t4, $t4, 4
+    addu  $t5, $t5, $s5
+    addiu $t2, $t2, 1
+    bne   $t2, $s3, dot
+    sw    $t3, 0($t8)
+    addiu $t8, $t8, 4
+    addiu $t1, $t1, 1
+    bne   $t1, $s3, column
+    addiu $t0, $t0, 1
+    bne   $t0, $s3, row
+    addiu $s4, $s4, -1
+    bne   $s4, $zero, repeat
+
+    jr    $zero              # halt
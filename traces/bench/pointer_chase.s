@@ -0,0 +1,38 @@
+# pointer_chase.s - MIPS kernel of dependent loads missing in caches
+# A list of 16384 words is linked with a stride of 2053 words,
+# so each load depends on the previous one and touches a new line.
+# MIPT-MIPS does not simulate delay slots, so branches are not followed by nops.
+#
+# llvm-mc -triple=mipsel -filetype=obj -o pointer_chase.o pointer_chase.s
+# ld.lld -Ttext=0x400000 -e __start -o pointer_chase.out pointer_chase.o
+
+    .set noreorder
+    .text
+    .globl __start
+__start:
+    lui   $s0, 0x1000            # list base
+    addiu $t0, $zero, 0          # node
+    addiu $t1, $zero, 16384      # number of nodes
+    addiu $t2, $zero, 16383      # mask of node index
+init:
+    addiu $t3, $t0, 2053
+    and   $t3, $t3, $t2
+    sll   $t3, $t3, 2
+    addu  $t3, $t3, $s0          # address of the next node
+    sll   $t4, $t0, 2
+    addu  $t4, $t4, $s0          # address of the node
+    sw    $t3, 0($t4)
+    addiu $t0, $t0, 1
+    bne   $t0, $t1, init
+
+    lui   $t5, 0x3               # 196608 loads
+    addu  $t6, $zero, $s0
+    addiu $s1, $zero, 0          # checksum
+chase:
+    lw    $t6, 0($t6)
+    addu  $s1, $s1, $t6
+    addiu $t5, $t5, -1
+    bne   $t5, $zero, chase
+
+    sw    $s1, -4($s0)
+    jr    $zero              # halt
@@ -0,0 +1,41 @@
+# recursion.s - MIPS kernel of call-heavy recursion
+# The 23rd Fibonacci number is computed by naive recursion,
+# so the program is dominated by calls, returns and stack accesses.
+# MIPT-MIPS does not simulate delay slots, so branches are not followed by nops.
+#
+# llvm-mc -triple=mipsel -filetype=obj -o recursion.o recursion.s
+# ld.lld -Ttext=0x400000 -e __start -o recursion.out recursion.o
+
+    .set noreorder
+    .text
+    .globl __start
+__start:
+    lui   $sp, 0x7fff            # stack
+    addiu $a0, $zero, 23
+    jal   fib
+    lui   $s0, 0x1000
+    sw    $v0, 0($s0)
+    jr    $zero              # halt
+
+# returns Fibonacci number of $a0 in $v0
+fib:
+    slti  $t0, $a0, 2
+    beq   $t0, $zero, recurse
+    addu  $v0, $zero, $a0
+    jr    $ra
+recurse:
+    addiu $sp, $sp, -12
+    sw    $ra, 8($sp)
+    sw    $s0, 4($sp)
+    sw    $a0, 0($sp)
+    addiu $a0, $a0, -1
+    jal   fib
+    addu  $s0, $zero, $v0
+    lw    $a0, 0($sp)
+    addiu $a0, $a0, -2
+    jal   fib
+    addu  $v0, $v0, $s0
+    lw    $s0, 4($sp)
+    lw    $ra, 8($sp)
+    addiu $sp, $sp, 12
+    jr    $ra
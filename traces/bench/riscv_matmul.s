@@ -0,0 +1,70 @@
+# riscv_matmul.s - RV32IM kernel of integer matrix multiplication
+# Two 24x24 matrices are multiplied 8 times, loads are regular
+# and the inner loop is dominated by multiplications.
+#
+# llvm-mc -triple=riscv32 -mattr=+m,-relax -filetype=obj -o riscv_matmul.o riscv_matmul.s
+# ld.lld -Ttext=0x10000 -e _start -o riscv_matmul.out riscv_matmul.o
+
+    .text
+    .globl _start
+_start:
+    lui   s0, 0x100              # A
+    lui   s1, 0x101              # B
+    lui   s2, 0x102              # C
+    addi  s3, zero, 24           # size of matrices
+    slli  s5, s3, 2              # size of row in bytes
+
+    addi  t0, zero, 0            # i
+    add   t4, zero, s0           # pointer to A[i][j]
+    add   t5, zero, s1           # pointer to B[i][j]
+init_row:
+    addi  t1, zero, 0            # j
+init:
+    add   t6, t0, t1
+    sw    t6, 0(t4)              # A[i][j] = i + j
+    sub   t6, t0, t1
+    sw    t6, 0(t5)              # B[i][j] = i - j
+    addi  t4, t4, 4
+    addi  t5, t5, 4
+    addi  t1, t1, 1
+    bne   t1, s3, init
+    addi  t0, t0, 1
+    bne   t0, s3, init_row
+
+    addi  s4, zero, 8            # repetitions
+repeat:
+    addi  t0, zero, 0            # i
+    add   s6, zero, s2           # pointer to C[i][j]
+row:
+    addi  t1, zero, 0            # j
+column:
+    mul   t4, t0, s5
+    add   t4, t4, s0             # pointer to A[i][k]
+    slli  t5, t1, 2
+    add   t5, t5, s1             # pointer to B[k][j]
+    addi  t2, zero, 0            # k
+    addi  t3, zero, 0            # sum
+dot:
+    lw    t6, 0(t4)
+    lw    a0, 0(t5)
+    mul   t6, t6, a0
+    add   t3, t3, t6
+    addi  t4, t4, 4
+    add   t5, t5, s5
+    addi  t2, t2, 1
+    bne   t2, s3, dot
+    sw    t3, 0(s6)
+    addi  s6, s6, 4
+    addi  t1, t1, 1
+    bne   t1, s3, column
+    addi  t0, t0, 1
+    bne   t0, s3, row
+    addi  s4, s4, -1
+    bne   s4, zero, repeat
+
+    jalr  zero, 0(zero)          # halt
+
+    # instructions fetched after the halt until it is executed must be valid
+    .rept 16
+    nop
+    .endr
@@ -0,0 +1,43 @@
+# riscv_pointer_chase.s - RV32IM kernel of dependent loads missing in caches
+# A list of 16384 words is linked with a stride of 2053 words,
+# so each load depends on the previous one and touches a new line.
+#
+# llvm-mc -triple=riscv32 -mattr=+m,-relax -filetype=obj -o riscv_pointer_chase.o riscv_pointer_chase.s
+# ld.lld -Ttext=0x10000 -e _start -o riscv_pointer_chase.out riscv_pointer_chase.o
+
+    .text
+    .globl _start
+_start:
+    lui   s0, 0x100              # list base
+    addi  t0, zero, 0            # node
+    lui   t1, 0x4                # number of nodes
+    addi  t2, t1, -1             # mask of node index
+    lui   s2, 0x1
+    addi  s2, s2, -2043          # stride
+init:
+    add   t3, t0, s2
+    and   t3, t3, t2
+    slli  t3, t3, 2
+    add   t3, t3, s0             # address of the next node
+    slli  t4, t0, 2
+    add   t4, t4, s0             # address of the node
+    sw    t3, 0(t4)
+    addi  t0, t0, 1
+    bne   t0, t1, init
+
+    lui   t5, 0x30               # 196608 loads
+    add   t6, zero, s0
+    addi  s1, zero, 0            # checksum
+chase:
+    lw    t6, 0(t6)
+    add   s1, s1, t6
+    addi  t5, t5, -1
+    bne   t5, zero, chase
+
+    sw    s1, -4(s0)
+    jalr  zero, 0(zero)          # halt
+
+    # instructions fetched after the halt until it is executed must be valid
+    .rept 16
+    nop
+    .endr
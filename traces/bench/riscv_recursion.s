@@ -0,0 +1,38 @@
+# riscv_recursion.s - RV32IM kernel of call-heavy recursion
+# The 23rd Fibonacci number is computed by naive recursion,
+# so the program is dominated by calls, returns and stack accesses.
+#
+# llvm-mc -triple=riscv32 -mattr=+m,-relax -filetype=obj -o riscv_recursion.o riscv_recursion.s
+# ld.lld -Ttext=0x10000 -e _start -o riscv_recursion.out riscv_recursion.o
+
+    .text
+    .globl _start
+_start:
+    lui   sp, 0x7fff0            # stack
+    addi  a0, zero, 23
+    jal   ra, fib
+    lui   s0, 0x100
+    sw    a0, 0(s0)
+    jalr  zero, 0(zero)          # halt
+
+# returns Fibonacci number of a0 in a0
+fib:
+    addi  t0, zero, 2
+    bge   a0, t0, recurse
+    jalr  zero, 0(ra)
+recurse:
+    addi  sp, sp, -12
+    sw    ra, 8(sp)
+    sw    s0, 4(sp)
+    sw    a0, 0(sp)
+    addi  a0, a0, -1
+    jal   ra, fib
+    add   s0, zero, a0
+    lw    a0, 0(sp)
+    addi  a0, a0, -2
+    jal   ra, fib
+    add   a0, a0, s0
+    lw    s0, 4(sp)
+    lw    ra, 8(sp)
+    addi  sp, sp, 12
+    jalr  zero, 0(ra)
@@ -0,0 +1,53 @@
+# riscv_sort.s - RV32IM kernel of branchy insertion sort
+# An array of 400 pseudo-random numbers is sorted 4 times,
+# so directions of branches of the inner loop depend on data.
+#
+# llvm-mc -triple=riscv32 -mattr=+m,-relax -filetype=obj -o riscv_sort.o riscv_sort.s
+# ld.lld -Ttext=0x10000 -e _start -o riscv_sort.out riscv_sort.o
+
+    .text
+    .globl _start
+_start:
+    lui   s0, 0x100              # array
+    addi  s2, s0, 1600           # end of array
+    lui   s3, 0x41c65
+    addi  s3, s3, -403           # multiplier of random generator
+    addi  s1, zero, 1            # random seed
+    addi  s4, zero, 4            # repetitions
+    lui   s5, 0x3
+    addi  s5, s5, 57             # increment of random generator
+repeat:
+    add   t0, zero, s0
+fill:
+    mul   s1, s1, s3
+    add   s1, s1, s5
+    srli  t1, s1, 16
+    sw    t1, 0(t0)
+    addi  t0, t0, 4
+    bne   t0, s2, fill
+
+    addi  t0, s0, 4              # pointer to the next unsorted number
+outer:
+    lw    t1, 0(t0)              # number to insert
+    addi  t2, t0, -4             # pointer to a sorted number
+inner:
+    bltu  t2, s0, insert         # all the sorted numbers are greater
+    lw    t4, 0(t2)
+    bge   t1, t4, insert         # position is found
+    sw    t4, 4(t2)              # move the greater number forward
+    addi  t2, t2, -4
+    jal   zero, inner
+insert:
+    sw    t1, 4(t2)
+    addi  t0, t0, 4
+    bne   t0, s2, outer
+
+    addi  s4, s4, -1
+    bne   s4, zero, repeat
+
+    jalr  zero, 0(zero)          # halt
+
+    # instructions fetched after the halt until it is executed must be valid
+    .rept 16
+    nop
+    .endr
@@ -0,0 +1,50 @@
+# sort.s - MIPS kernel of branchy insertion sort
+# An array of 400 pseudo-random numbers is sorted 4 times,
+# so directions of branches of the inner loop depend on data.
+# MIPT-MIPS does not simulate delay slots, so branches are not followed by nops.
+#
+# llvm-mc -triple=mipsel -filetype=obj -o sort.o sort.s
+# ld.lld -Ttext=0x400000 -e __start -o sort.out sort.o
+
+    .set noreorder
+    .text
+    .globl __start
+__start:
+    lui   $s0, 0x1000            # array
+    addiu $s2, $s0, 1600         # end of array
+    lui   $s3, 0x41c6
+    ori   $s3, $s3, 0x4e6d       # multiplier of random generator
+    addiu $s1, $zero, 1          # random seed
+    addiu $s4, $zero, 4          # repetitions
+repeat:
+    addu  $t0, $zero, $s0
+fill:
+    mul   $s1, $s1, $s3
+    addiu $s1, $s1, 12345
+    srl   $t1, $s1, 16
+    sw    $t1, 0($t0)
+    addiu $t0, $t0, 4
+    bne   $t0, $s2, fill
+
+    addiu $t0, $s0, 4            # pointer to the next unsorted number
+outer:
+    lw    $t1, 0($t0)            # number to insert
+    addiu $t2, $t0, -4           # pointer to a sorted number
+inner:
+    sltu  $t3, $t2, $s0
+    bne   $t3, $zero, insert     # all the sorted numbers are greater
+    lw    $t4, 0($t2)
+    slt   $t3, $t1, $t4
+    beq   $t3, $zero, insert     # position is found
+    sw    $t4, 4($t2)            # move the greater number forward
+    addiu $t2, $t2, -4
+    beq   $zero, $zero, inner
+insert:
+    sw    $t1, 4($t2)
+    addiu $t0, $t0, 4
+    bne   $t0, $s2, outer
+
+    addiu $s4, $s4, -1
+    bne   $s4, $zero, repeat
+
+    jr    $zero              # halt
@@ -0,0 +1,49 @@
+# riscv_fib.s - RV32IM test of performance simulation
+# Fibonacci numbers are stored to memory and mixed with
+# multiplications, divisions, narrow memory accesses and calls.
+# The program returns to zero address to halt the simulation.
+
+    .text
+    .globl _start
+_start:
+    addi  s2, ra, 0          # halt address
+    lui   s0, 0x20           # data section
+    addi  t0, zero, 0        # iteration
+    addi  t1, zero, 30       # number of iterations
+    addi  a0, zero, 0
+    addi  a1, zero, 1
+loop:
+    add   a2, a0, a1
+    addi  a0, a1, 0
+    addi  a1, a2, 0
+    slli  t2, t0, 2
+    add   t2, t2, s0
+    sw    a2, 0(t2)
+    lw    t3, 0(t2)
+    mul   t4, t3, t1
+    divu  t5, t4, t1
+    rem   t6, t4, t0         # remainder of division by zero is the dividend
+    add   s1, s1, t5
+    add   s1, s1, t6
+    sb    t0, 200(s0)
+    lb    a3, 200(s0)
+    lhu   a4, 0(t2)
+    sh    a4, 202(s0)
+    xori  a5, a3, -1
+    sltu  a6, a5, a4
+    slt   a7, a5, a4
+    sra   a5, a5, t0
+    mulh  s5, a5, t4
+    div   s6, a5, t1
+    jal   ra, func
+    addi  t0, t0, 1
+    blt   t0, t1, loop
+    bne   t0, t1, loop
+    sw    s1, 256(s0)
+    jalr  zero, 0(s2)
+func:
+    srai  s3, a2, 3
+    or    s1, s1, s3
+    auipc s4, 0
+    sub   s1, s1, s4
+    jalr  zero, 0(ra)
@@ -0,0 +1,29 @@
+# smc_loop.s - MIPS loop which overwrites its own hot code
+# The loop counts iterations in $t6, and the store makes it increment $t0 by 2
+# instead of 1, so simulators which do not drop stale code make more iterations.
+#
+# llvm-mc -triple=mipsel -filetype=obj -o smc_loop.o smc_loop.s
+# ld.lld -Ttext=0x400000 -e __start -o smc_loop.out smc_loop.o
+
+    .set noreorder
+    .text
+    .globl __start
+__start:
+    addiu $t0, $zero, 0
+    addiu $t1, $zero, 100        # limit of $t0
+    addiu $t4, $zero, 0          # number of stores
+    addiu $t5, $zero, 2
+    addiu $t6, $zero, 0          # iterations
+    lui   $t2, 0x2508
+    ori   $t2, $t2, 0x0002       # addiu $t0, $t0, 2
+    lui   $t3, %hi(loop)
+    addiu $t3, $t3, %lo(loop)
+loop:
+    addiu $t0, $t0, 1
+    addiu $t6, $t6, 1
+    bne   $t0, $t1, loop
+    sw    $t2, 0($t3)            # patch the first instruction of the loop
+    addiu $t4, $t4, 1
+    addiu $t1, $t1, 200
+    bne   $t4, $t5, loop
+    jr    $zero